@@ -37,6 +37,26 @@ const char *superuser_password;
 
 int access_noacl;
 
+/*
+ * Generation counter for memoized authorization results.  Any change to
+ * the access, password or IP blocking entries bumps it; holders of a
+ * cached access_t (e.g. the HTTP connection) compare generations
+ * instead of re-walking the entry lists on every request.
+ */
+static int access_generation_cnt;
+
+static void
+access_generation_bump(void)
+{
+  atomic_add(&access_generation_cnt, 1);
+}
+
+int
+access_generation(void)
+{
+  return atomic_get(&access_generation_cnt);
+}
+
 static int passwd_verify(access_t *a, const char *username, verify_callback_t verify, void *aux);
 static int passwd_verify2(const char *username, verify_callback_t verify, void *aux,
                           const char *username2, const char *passwd2);
@@ -1151,6 +1171,8 @@ access_entry_create(const char *uuid, htsmsg_t *conf)
   if (TAILQ_FIRST(&ae->ae_ipmasks) == NULL)
     access_set_prefix_default(&ae->ae_ipmasks);
 
+  access_generation_bump();
+
   return ae;
 }
 
@@ -1187,6 +1209,8 @@ access_entry_destroy(access_entry_t *ae, int delconf)
   free(ae->ae_lang_ui);
   free(ae->ae_theme);
   free(ae);
+
+  access_generation_bump();
 }
 
 /*
@@ -1245,6 +1269,7 @@ access_entry_class_save(idnode_t *self, char *filename, size_t fsize)
   char ubuf[UUID_HEX_SIZE];
   htsmsg_t *c = htsmsg_create_map();
   access_entry_update_rights((access_entry_t *)self);
+  access_generation_bump();
   idnode_save(&ae->ae_id, c);
   if (filename)
     snprintf(filename, fsize, "accesscontrol/%s", idnode_uuid_as_str(&ae->ae_id, ubuf));
@@ -2096,6 +2121,8 @@ passwd_entry_create(const char *uuid, htsmsg_t *conf)
 
   TAILQ_INSERT_TAIL(&passwd_entries, pw, pw_link);
 
+  access_generation_bump();
+
   return pw;
 }
 
@@ -2119,6 +2146,8 @@ passwd_entry_destroy(passwd_entry_t *pw, int delconf)
   free(pw->pw_auth);
   free(pw->pw_comment);
   free(pw);
+
+  access_generation_bump();
 }
 
 static htsmsg_t *
@@ -2127,6 +2156,7 @@ passwd_entry_class_save(idnode_t *self, char *filename, size_t fsize)
   passwd_entry_t *pw = (passwd_entry_t *)self;
   char ubuf[UUID_HEX_SIZE];
   htsmsg_t *c = htsmsg_create_map();
+  access_generation_bump();
   idnode_save(&pw->pw_id, c);
   if (filename)
     snprintf(filename, fsize, "passwd/%s", idnode_uuid_as_str(&pw->pw_id, ubuf));
@@ -2374,6 +2404,8 @@ ipblock_entry_create(const char *uuid, htsmsg_t *conf)
 
   TAILQ_INSERT_TAIL(&ipblock_entries, ib, ib_link);
 
+  access_generation_bump();
+
   return ib;
 }
 
@@ -2387,6 +2419,8 @@ ipblock_entry_destroy(ipblock_entry_t *ib, int delconf)
   idnode_unlink(&ib->ib_id);
   free(ib->ib_comment);
   free(ib);
+
+  access_generation_bump();
 }
 
 static htsmsg_t *
@@ -2395,6 +2429,7 @@ ipblock_entry_class_save(idnode_t *self, char *filename, size_t fsize)
   ipblock_entry_t *ib = (ipblock_entry_t *)self;
   htsmsg_t *c = htsmsg_create_map();
   char ubuf[UUID_HEX_SIZE];
+  access_generation_bump();
   idnode_save(&ib->ib_id, c);
   if (filename)
     snprintf(filename, fsize, "ipblock/%s", idnode_uuid_as_str(&ib->ib_id, ubuf));
@@ -297,6 +297,12 @@ int access_verify_list(htsmsg_t *list, const char *item);
  */
 typedef int (*verify_callback_t)(void *aux, const char *passwd);
 
+/**
+ * Generation counter for memoized authorization results; bumped on any
+ * access/password/ipblock entry change
+ */
+int access_generation(void);
+
 access_t *access_get(struct sockaddr_storage *src, const char *username,
                      verify_callback_t verify, void *aux);
 
@@ -129,11 +129,61 @@ api_pathlist
   return 0;
 }
 
+/*
+ * Execute several API calls in one request.  The webui issues bursts
+ * of dependent calls on page load (grid + meta + counts), each paying
+ * the HTTP parse and authentication cost; batching runs them all in
+ * the already verified context.  Each entry in the "calls" list is a
+ * map with "path" (the subsystem) and optional "args"; the results
+ * come back in order as {"path", "error"?, "response"?} maps.  Access
+ * is still verified per call by api_exec().
+ */
+static int
+api_batch
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  htsmsg_t *calls, *call, *cargs, *cresp, *l, *e;
+  htsmsg_field_t *f;
+  const char *path;
+  int err;
+
+  if (!(calls = htsmsg_get_list(args, "calls")))
+    return EINVAL;
+
+  l = htsmsg_create_list();
+  HTSMSG_FOREACH(f, calls) {
+    e = htsmsg_create_map();
+    if ((call = htsmsg_field_get_map(f)) == NULL ||
+        (path = htsmsg_get_str(call, "path")) == NULL) {
+      htsmsg_add_u32(e, "error", EINVAL);
+    } else {
+      htsmsg_add_str(e, "path", path);
+      if ((cargs = htsmsg_get_map(call, "args")) == NULL)
+        cargs = htsmsg_create_map();
+      else
+        cargs = htsmsg_copy(cargs);
+      cresp = NULL;
+      err = api_exec(perm, path, cargs, &cresp);
+      htsmsg_destroy(cargs);
+      if (err)
+        htsmsg_add_u32(e, "error", err);
+      if (cresp)
+        htsmsg_add_msg(e, "response", cresp);
+    }
+    htsmsg_add_msg(l, NULL, e);
+  }
+
+  *resp = htsmsg_create_map();
+  htsmsg_add_msg(*resp, "results", l);
+  return 0;
+}
+
 void api_init ( void )
 {
   static api_hook_t h[] = {
     { "serverinfo", ACCESS_ANONYMOUS, api_serverinfo, NULL },
     { "pathlist", ACCESS_ANONYMOUS, api_pathlist, NULL },
+    { "batch", ACCESS_ANONYMOUS, api_batch, NULL },
     { NULL, 0, NULL, NULL }
   };
   api_register_all(h);
@@ -99,6 +99,10 @@ typedef struct api_idnode_grid_conf
   uint32_t        limit;
   idnode_filter_t filter;
   idnode_sort_t   sort;
+  /* optional row serializer set by the grid callback, replaces the
+   * plain idnode_read0 (e.g. to satisfy rows from a cache) */
+  void          (*read)(idnode_t *in, htsmsg_t *e,
+                        htsmsg_t *flist, const char *lang);
 } api_idnode_grid_conf_t;
 
 typedef void (*api_idnode_grid_callback_t)
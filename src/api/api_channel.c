@@ -132,7 +132,8 @@ api_channel_tag_list
   char buf[128], ubuf[UUID_HEX_SIZE], *name;
 
   l = htsmsg_create_list();
-  tvh_mutex_lock(&global_lock);
+  /* read-only walk, a channel domain read lock is enough */
+  tvh_domain_read_lock(TVH_DOMAIN_CHANNEL);
   TAILQ_FOREACH(ct, &channel_tags, ct_link)
     if (cfg || channel_tag_access(ct, perm, 0)) {
       if (ct->ct_enabled) {
@@ -143,7 +144,7 @@ api_channel_tag_list
       }
       htsmsg_add_msg(l, NULL, htsmsg_create_key_val(idnode_uuid_as_str(&ct->ct_id, ubuf), name));
     }
-  tvh_mutex_unlock(&global_lock);
+  tvh_domain_read_unlock(TVH_DOMAIN_CHANNEL);
   *resp = htsmsg_create_map();
   htsmsg_add_msg(*resp, "entries", l);
   return 0;
@@ -191,7 +192,9 @@ api_channel_cat_list
   string_list_t *sl = string_list_create();
   const string_list_item_t *item;
 
-  tvh_mutex_lock(&global_lock);
+  /* Reads channels and their schedules only, take both domains */
+  tvh_domain_read_lock(TVH_DOMAIN_CHANNEL);
+  tvh_domain_read_lock(TVH_DOMAIN_EPG);
   /* Build string_list of all categories the user is allowed
    * to see.
    */
@@ -209,7 +212,8 @@ api_channel_cat_list
       }
     }
   }
-  tvh_mutex_unlock(&global_lock);
+  tvh_domain_read_unlock(TVH_DOMAIN_EPG);
+  tvh_domain_read_unlock(TVH_DOMAIN_CHANNEL);
 
   /* Now we have the unique list, convert it for GUI. */
   RB_FOREACH(item, sl, h_link) {
@@ -71,6 +71,7 @@ api_dvr_entry_grid
 {
   dvr_entry_t *de;
 
+  dvr_entry_hydrate();
   LIST_FOREACH(de, &dvrentries, de_global_link)
     idnode_set_add(ins, (idnode_t*)de, &conf->filter, perm->aa_lang_ui);
 }
@@ -99,6 +100,7 @@ api_dvr_entry_grid_finished
 {
   dvr_entry_t *de;
 
+  dvr_entry_hydrate();
   LIST_FOREACH(de, &dvrentries, de_global_link)
     if (dvr_entry_is_finished(de, DVR_FINISHED_SUCCESS))
       idnode_set_add(ins, (idnode_t*)de, &conf->filter, perm->aa_lang_ui);
@@ -110,6 +112,7 @@ api_dvr_entry_grid_failed
 {
   dvr_entry_t *de;
 
+  dvr_entry_hydrate();
   LIST_FOREACH(de, &dvrentries, de_global_link)
     if (dvr_entry_is_finished(de, DVR_FINISHED_FAILED))
       idnode_set_add(ins, (idnode_t*)de, &conf->filter, perm->aa_lang_ui);
@@ -121,6 +124,7 @@ api_dvr_entry_grid_removed
 {
   dvr_entry_t *de;
 
+  dvr_entry_hydrate();
   LIST_FOREACH(de, &dvrentries, de_global_link)
     if (dvr_entry_is_finished(de, DVR_FINISHED_REMOVED_SUCCESS | DVR_FINISHED_REMOVED_FAILED))
       idnode_set_add(ins, (idnode_t*)de, &conf->filter, perm->aa_lang_ui);
@@ -27,6 +27,28 @@
 #include "lang_codes.h"
 #include "string_list.h"
 #include "epggrab.h"  //Needed to be able to test for epggrab_conf.epgdb_processparentallabels
+#include "htsmsg_binary2.h"
+
+/*
+ * EPG reads resolve the channel, the broadcast and any linked DVR entry
+ * per event, so they need those three domains.  Read handlers using
+ * these helpers must stay strictly read-only (see tvh_thread.h).
+ */
+static void
+api_epg_read_lock ( void )
+{
+  tvh_domain_read_lock(TVH_DOMAIN_CHANNEL);
+  tvh_domain_read_lock(TVH_DOMAIN_EPG);
+  tvh_domain_read_lock(TVH_DOMAIN_DVR);
+}
+
+static void
+api_epg_read_unlock ( void )
+{
+  tvh_domain_read_unlock(TVH_DOMAIN_DVR);
+  tvh_domain_read_unlock(TVH_DOMAIN_EPG);
+  tvh_domain_read_unlock(TVH_DOMAIN_CHANNEL);
+}
 
 static htsmsg_t *
 api_epg_get_list ( const char *s )
@@ -55,7 +77,7 @@ static void
 api_epg_add_channel ( htsmsg_t *m, channel_t *ch, const char *blank )
 {
   int64_t chnum;
-  char buf[128];
+  char buf[128], icobuf[512];
   const char *s;
   htsmsg_add_str(m, "channelName", channel_get_name(ch, blank));
   htsmsg_add_uuid(m, "channelUuid", &ch->ch_id.in_uuid);
@@ -68,7 +90,8 @@ api_epg_add_channel ( htsmsg_t *m, channel_t *ch, const char *blank )
       snprintf(buf, sizeof(buf), "%u", maj);
     htsmsg_add_str(m, "channelNumber", buf);
   }
-  s = channel_get_icon(ch);
+  /* read-only - we may run under a domain read lock only */
+  s = channel_get_icon_ro(ch, icobuf, sizeof(icobuf));
   if (!strempty(s)) {
     s = imagecache_get_propstr(s, buf, sizeof(buf));
     if (s)
@@ -348,15 +371,109 @@ api_epg_decode_channel_num ( const char *s )
    return v;
 }
 
+/*
+ * Grid query result cache
+ *
+ * The webui polls the grid aggressively and usually just pages through one
+ * query, so remember the broadcast id lists of the last few queries.  A
+ * cached list is valid only while the global epg_version is unchanged, thus
+ * a repeated poll costs O(page) id lookups instead of a full traversal and
+ * sort of the EPG.  The grid runs under domain read locks, so the slots
+ * have their own mutex which the callers hold across get/put and any use
+ * of the returned entry.
+ */
+#define API_EPG_GRID_CACHE_SLOTS 8
+
+static tvh_mutex_t api_epg_grid_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+
+typedef struct api_epg_grid_cache {
+  uint32_t  key;        /* CRC over the canonicalized query args + user */
+  uint64_t  version;    /* epg_version the result was built against */
+  uint32_t *ids;        /* broadcast ids in query sort order */
+  uint32_t  entries;
+  int64_t   lastused;
+} api_epg_grid_cache_t;
+
+static api_epg_grid_cache_t api_epg_grid_cache_slots[API_EPG_GRID_CACHE_SLOTS];
+
+static int
+api_epg_grid_cache_key ( access_t *perm, htsmsg_t *args, uint32_t *key )
+{
+  htsmsg_t *m;
+  void *data = NULL;
+  size_t len;
+
+  /* "now" mode filters on the wallclock, don't cache it */
+  if (htsmsg_get_str(args, "mode"))
+    return -1;
+  m = htsmsg_copy(args);
+  htsmsg_delete_field(m, "start");
+  htsmsg_delete_field(m, "limit");
+  htsmsg_add_str(m, "__user", perm->aa_username ?: "");
+  if (htsmsg_binary2_serialize(m, &data, &len, 2*1024*1024)) {
+    htsmsg_destroy(m);
+    return -1;
+  }
+  htsmsg_destroy(m);
+  *key = tvh_crc32(data, len, 0xffffffff);
+  free(data);
+  return 0;
+}
+
+static api_epg_grid_cache_t *
+api_epg_grid_cache_get ( uint32_t key )
+{
+  api_epg_grid_cache_t *c = api_epg_grid_cache_slots;
+  int i;
+
+  lock_assert(&api_epg_grid_cache_mutex);
+  for (i = 0; i < API_EPG_GRID_CACHE_SLOTS; i++, c++)
+    if (c->ids && c->key == key && c->version == epg_version) {
+      c->lastused = mclk();
+      return c;
+    }
+  return NULL;
+}
+
+static void
+api_epg_grid_cache_put ( uint32_t key, const epg_query_t *eq )
+{
+  api_epg_grid_cache_t *c = api_epg_grid_cache_slots, *sel = NULL;
+  uint32_t n;
+  int i;
+
+  lock_assert(&api_epg_grid_cache_mutex);
+  for (i = 0; i < API_EPG_GRID_CACHE_SLOTS; i++, c++) {
+    if (c->ids == NULL || c->key == key || c->version != epg_version) {
+      sel = c;
+      break;
+    }
+    if (sel == NULL || c->lastused < sel->lastused)
+      sel = c;
+  }
+  free(sel->ids);
+  sel->ids = malloc(MAX(eq->entries, 1) * sizeof(uint32_t));
+  if (sel->ids == NULL)
+    return;
+  for (n = 0; n < eq->entries; n++)
+    sel->ids[n] = eq->result[n]->id;
+  sel->key = key;
+  sel->version = epg_version;
+  sel->entries = eq->entries;
+  sel->lastused = mclk();
+}
+
 static int
 api_epg_grid
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
 {
-  int i;
+  int i, usecache;
   epg_query_t eq;
+  epg_broadcast_t *ebc;
+  api_epg_grid_cache_t *cc;
   const char *str, *blank = NULL;
   char *lang;
-  uint32_t start, limit, end, genre;
+  uint32_t start, limit, end, genre, ckey = 0;
   int64_t duration_min, duration_max;
   htsmsg_field_t *f, *f2;
   htsmsg_t *l = NULL, *e, *filter;
@@ -365,6 +482,38 @@ api_epg_grid
   memset(&eq, 0, sizeof(eq));
 
   lang = access_get_lang(perm, htsmsg_get_str(args, "lang"));
+
+  /* Pagination settings */
+  start = htsmsg_get_u32_or_default(args, "start", 0);
+  limit = htsmsg_get_u32_or_default(args, "limit", 50);
+
+  /* Serve a repeated query from the result cache (O(page)) */
+  usecache = !api_epg_grid_cache_key(perm, args, &ckey);
+  if (usecache) {
+    api_epg_read_lock();
+    tvh_mutex_lock(&api_epg_grid_cache_mutex);
+    if ((cc = api_epg_grid_cache_get(ckey)) != NULL) {
+      start = MIN(cc->entries, start);
+      end   = MIN(cc->entries, start + limit);
+      l     = htsmsg_create_list();
+      for (i = start; i < end; i++) {
+        if (!(ebc = epg_broadcast_find_by_id(cc->ids[i]))) continue;
+        if (!(e = api_epg_entry(ebc, lang, perm, &blank))) continue;
+        htsmsg_add_msg(l, NULL, e);
+      }
+      i = cc->entries;
+      tvh_mutex_unlock(&api_epg_grid_cache_mutex);
+      api_epg_read_unlock();
+      free(lang);
+      *resp = htsmsg_create_map();
+      htsmsg_add_u32(*resp, "totalCount", i);
+      htsmsg_add_msg(*resp, "entries", l);
+      return 0;
+    }
+    tvh_mutex_unlock(&api_epg_grid_cache_mutex);
+    api_epg_read_unlock();
+  }
+
   if (lang)
     eq.lang = strdup(lang);
   mode = htsmsg_get_str(args, "mode");
@@ -395,6 +544,7 @@ api_epg_grid
         eq.start.comp = EC_LT;
         eq.stop.comp = EC_GT;
         eq.start.val1 = eq.stop.val1 = gclk();
+        eq.now = 1;
       }
   }
 
@@ -514,13 +664,14 @@ api_epg_grid
     }
   } /* else.. keep default start time ascending sorting */
 
-  /* Pagination settings */
-  start = htsmsg_get_u32_or_default(args, "start", 0);
-  limit = htsmsg_get_u32_or_default(args, "limit", 50);
-
   /* Query the EPG */
-  tvh_mutex_lock(&global_lock);
+  api_epg_read_lock();
   epg_query(&eq, perm);
+  if (usecache) {
+    tvh_mutex_lock(&api_epg_grid_cache_mutex);
+    api_epg_grid_cache_put(ckey, &eq);
+    tvh_mutex_unlock(&api_epg_grid_cache_mutex);
+  }
 
   /* Build response */
   start = MIN(eq.entries, start);
@@ -530,7 +681,7 @@ api_epg_grid
     if (!(e = api_epg_entry(eq.result[i], lang, perm, &blank))) continue;
     htsmsg_add_msg(l, NULL, e);
   }
-  tvh_mutex_unlock(&global_lock);
+  api_epg_read_unlock();
 
   epg_query_free(&eq);
   free(lang);
@@ -636,11 +787,11 @@ api_epg_alternative
 
   /* Main Job */
   lang = access_get_lang(perm, htsmsg_get_str(args, "lang"));
-  tvh_mutex_lock(&global_lock);
+  api_epg_read_lock();
   e = epg_broadcast_find_by_id(id);
   if (e)
     api_epg_episode_broadcasts(perm, l, lang, e, &entries, e);
-  tvh_mutex_unlock(&global_lock);
+  api_epg_read_unlock();
   free(lang);
 
   /* Build response */
@@ -669,7 +820,7 @@ api_epg_related
 
   /* Main Job */
   lang = access_get_lang(perm, htsmsg_get_str(args, "lang"));
-  tvh_mutex_lock(&global_lock);
+  api_epg_read_lock();
   e = epg_broadcast_find_by_id(id);
   /* e might not exist if it is a dvr entry that does not exist in the epg */
   if (e)
@@ -692,7 +843,7 @@ api_epg_related
       free(title_esc);
 
       /* Have to unlock here since grid will re-lock */
-      tvh_mutex_unlock(&global_lock);
+      api_epg_read_unlock();
       free(lang);
       htsmsg_destroy(l);
       /* And let the grid do the query for us */
@@ -701,7 +852,7 @@ api_epg_related
     /*FALLTHRU*/
   }
 
-  tvh_mutex_unlock(&global_lock);
+  api_epg_read_unlock();
   free(lang);
 
   /* Build response */
@@ -732,7 +883,7 @@ api_epg_load
   l = htsmsg_create_list();
 
   /* Main Job */
-  tvh_mutex_lock(&global_lock);
+  api_epg_read_lock();
   lang = access_get_lang(perm, htsmsg_get_str(args, "lang"));
   if (ids) {
     HTSMSG_FOREACH(f, ids) {
@@ -750,7 +901,7 @@ api_epg_load
       entries++;
     }
   }
-  tvh_mutex_unlock(&global_lock);
+  api_epg_read_unlock();
   free(lang);
 
   /* Build response */
@@ -776,6 +927,46 @@ api_epg_content_type_list(access_t *perm, void *opaque, const char *op,
   return 0;
 }
 
+/*
+ * Resumable delta feed for external guide mirrors.  Consumers remember
+ * the last sequence number they saw, wait for the "epgFeed" comet
+ * message and pull everything newer; "detail" inlines the full event
+ * for update entries so no follow-up load is needed.
+ */
+static int
+api_epg_changefeed
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  int64_t since = 0;
+  uint32_t limit, id, detail;
+  htsmsg_t *l, *e, *m;
+  htsmsg_field_t *f;
+  epg_broadcast_t *ebc;
+  const char *s;
+  char *lang;
+
+  htsmsg_get_s64(args, "since", &since);
+  limit  = htsmsg_get_u32_or_default(args, "limit", 500);
+  detail = htsmsg_get_u32_or_default(args, "detail", 0);
+
+  api_epg_read_lock();
+  *resp = epg_changefeed_get(since < 0 ? 0 : since, limit);
+  if (detail && (l = htsmsg_get_list(*resp, "entries")) != NULL) {
+    lang = access_get_lang(perm, htsmsg_get_str(args, "lang"));
+    HTSMSG_FOREACH(f, l) {
+      if (!(e = htsmsg_field_get_map(f))) continue;
+      if ((s = htsmsg_get_str(e, "op")) == NULL || strcmp(s, "update")) continue;
+      if (htsmsg_get_u32(e, "eventId", &id)) continue;
+      if ((ebc = epg_broadcast_find_by_id(id)) == NULL) continue;
+      if ((m = api_epg_entry(ebc, lang, perm, NULL)) == NULL) continue;
+      htsmsg_add_msg(e, "event", m);
+    }
+    free(lang);
+  }
+  api_epg_read_unlock();
+  return 0;
+}
+
 void api_epg_init ( void )
 {
   static api_hook_t ah[] = {
@@ -783,6 +974,7 @@ void api_epg_init ( void )
     { "epg/events/alternative", ACCESS_ANONYMOUS, api_epg_alternative, NULL },
     { "epg/events/related",     ACCESS_ANONYMOUS, api_epg_related, NULL },
     { "epg/events/load",        ACCESS_ANONYMOUS, api_epg_load, NULL },
+    { "epg/events/changefeed",  ACCESS_ANONYMOUS, api_epg_changefeed, NULL },
     { "epg/content_type/list",  ACCESS_ANONYMOUS, api_epg_content_type_list, NULL },
 
     { NULL },
@@ -146,7 +146,10 @@ api_idnode_grid
       continue;
     e = htsmsg_create_map();
     htsmsg_add_uuid(e, "uuid", &in->in_uuid);
-    idnode_read0(in, e, flist, 0, conf.sort.lang);
+    if (conf.read)
+      conf.read(in, e, flist, conf.sort.lang);
+    else
+      idnode_read0(in, e, flist, 0, conf.sort.lang);
     idnode_perm_unset(in);
     htsmsg_add_msg(list, NULL, e);
     if (conf.limit > 0) conf.limit--;
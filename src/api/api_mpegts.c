@@ -26,6 +26,176 @@
 #include "input/mpegts/scanfile.h"
 #endif
 
+/*
+ * Grid caches
+ *
+ * Large DVB setups easily hold hundreds of muxes and thousands of
+ * services, and every grid page used to re-serialize each row and
+ * re-sort the full set.  Rows are serialized once into a cache and
+ * sorted orders are memoized; both are validated against the idnode
+ * change serial, so any node change, create or delete drops them
+ * wholesale.  All consumers run under the global lock.
+ */
+
+typedef struct api_mpegts_row {
+  RB_ENTRY(api_mpegts_row) amr_link;
+  idnode_t *amr_node;
+  htsmsg_t *amr_msg;     /* full property serialization */
+} api_mpegts_row_t;
+
+typedef struct api_mpegts_order {
+  TAILQ_ENTRY(api_mpegts_order) amo_link;
+  char amo_key[80];      /* grid kind, hide mode, sort column/dir */
+  idnode_set_t amo_set;
+} api_mpegts_order_t;
+
+#define API_MPEGTS_ORDERS_MAX 8
+
+static RB_HEAD(,api_mpegts_row) api_mpegts_rows;
+static TAILQ_HEAD(,api_mpegts_order) api_mpegts_orders =
+  TAILQ_HEAD_INITIALIZER(api_mpegts_orders);
+static uint32_t api_mpegts_cache_serial;
+static char api_mpegts_cache_lang[32];
+
+static int
+api_mpegts_row_cmp ( const api_mpegts_row_t *a, const api_mpegts_row_t *b )
+{
+  if (a->amr_node < b->amr_node) return -1;
+  return a->amr_node != b->amr_node;
+}
+
+static void
+api_mpegts_cache_flush ( void )
+{
+  api_mpegts_row_t *amr;
+  api_mpegts_order_t *amo;
+
+  while ((amr = RB_FIRST(&api_mpegts_rows)) != NULL) {
+    RB_REMOVE(&api_mpegts_rows, amr, amr_link);
+    htsmsg_destroy(amr->amr_msg);
+    free(amr);
+  }
+  while ((amo = TAILQ_FIRST(&api_mpegts_orders)) != NULL) {
+    TAILQ_REMOVE(&api_mpegts_orders, amo, amo_link);
+    free(amo->amo_set.is_array);
+    free(amo);
+  }
+}
+
+static void
+api_mpegts_cache_check ( const char *lang )
+{
+  uint32_t serial = idnode_change_serial();
+
+  lock_assert(&global_lock);
+  if (serial == api_mpegts_cache_serial &&
+      !strcmp(api_mpegts_cache_lang, lang ?: ""))
+    return;
+  api_mpegts_cache_flush();
+  api_mpegts_cache_serial = serial;
+  strlcpy(api_mpegts_cache_lang, lang ?: "", sizeof(api_mpegts_cache_lang));
+}
+
+/*
+ * Row serializer - satisfies the requested field list from the cached
+ * full serialization (the flist semantics mirror prop_read_values)
+ */
+static void
+api_mpegts_grid_read
+  ( idnode_t *in, htsmsg_t *e, htsmsg_t *flist, const char *lang )
+{
+  api_mpegts_row_t skel, *amr;
+  htsmsg_field_t *f;
+  int b, total = 0, count = 0;
+
+  skel.amr_node = in;
+  amr = RB_FIND(&api_mpegts_rows, &skel, amr_link, api_mpegts_row_cmp);
+  if (amr == NULL) {
+    amr = malloc(sizeof(*amr));
+    amr->amr_node = in;
+    amr->amr_msg = htsmsg_create_map();
+    idnode_read0(in, amr->amr_msg, NULL, 0, lang);
+    RB_INSERT_SORTED(&api_mpegts_rows, amr, amr_link, api_mpegts_row_cmp);
+  }
+  if (flist == NULL) {
+    HTSMSG_FOREACH(f, amr->amr_msg)
+      htsmsg_copy_field(e, htsmsg_field_name(f), amr->amr_msg, NULL);
+    return;
+  }
+  HTSMSG_FOREACH(f, flist) {
+    total++;
+    if (!htsmsg_field_get_bool(f, &b)) {
+      if (b > 0)
+        htsmsg_copy_field(e, htsmsg_field_name(f), amr->amr_msg, NULL);
+      count++;
+    }
+  }
+  if (total && !count) {
+    /* negative list - everything not named */
+    HTSMSG_FOREACH(f, amr->amr_msg)
+      if (!htsmsg_field_find(flist, htsmsg_field_name(f)))
+        htsmsg_copy_field(e, htsmsg_field_name(f), amr->amr_msg, NULL);
+  }
+}
+
+/*
+ * Memoized sort orders (unfiltered queries only)
+ */
+static int
+api_mpegts_order_find
+  ( const char *kind, int hide, api_idnode_grid_conf_t *conf,
+    idnode_set_t *ins )
+{
+  api_mpegts_order_t *amo;
+  char key[sizeof(amo->amo_key)];
+  size_t i;
+
+  if (conf->sort.key == NULL || LIST_FIRST(&conf->filter) != NULL)
+    return 0;
+  snprintf(key, sizeof(key), "%s:%d:%s:%d",
+           kind, hide, conf->sort.key, conf->sort.dir);
+  TAILQ_FOREACH(amo, &api_mpegts_orders, amo_link)
+    if (!strcmp(amo->amo_key, key))
+      break;
+  if (amo == NULL)
+    return 0;
+  TAILQ_REMOVE(&api_mpegts_orders, amo, amo_link);
+  TAILQ_INSERT_HEAD(&api_mpegts_orders, amo, amo_link);
+  for (i = 0; i < amo->amo_set.is_count; i++)
+    idnode_set_add(ins, amo->amo_set.is_array[i], NULL, NULL);
+  conf->sort.key = NULL;   /* already in order */
+  return 1;
+}
+
+static void
+api_mpegts_order_store
+  ( const char *kind, int hide, api_idnode_grid_conf_t *conf,
+    idnode_set_t *ins )
+{
+  api_mpegts_order_t *amo;
+  size_t i;
+  int count = 0;
+
+  if (conf->sort.key == NULL || LIST_FIRST(&conf->filter) != NULL)
+    return;
+  idnode_set_sort(ins, &conf->sort);
+  amo = calloc(1, sizeof(*amo));
+  snprintf(amo->amo_key, sizeof(amo->amo_key), "%s:%d:%s:%d",
+           kind, hide, conf->sort.key, conf->sort.dir);
+  for (i = 0; i < ins->is_count; i++)
+    idnode_set_add(&amo->amo_set, ins->is_array[i], NULL, NULL);
+  TAILQ_INSERT_HEAD(&api_mpegts_orders, amo, amo_link);
+  TAILQ_FOREACH(amo, &api_mpegts_orders, amo_link)
+    if (++count > API_MPEGTS_ORDERS_MAX)
+      break;
+  if (amo) {
+    TAILQ_REMOVE(&api_mpegts_orders, amo, amo_link);
+    free(amo->amo_set.is_array);
+    free(amo);
+  }
+  conf->sort.key = NULL;   /* spare api_idnode_grid the qsort */
+}
+
 /*
  * Inputs
  */
@@ -243,6 +413,11 @@ api_mpegts_mux_grid
       hide = 0;
   }
 
+  api_mpegts_cache_check(perm->aa_lang_ui);
+  conf->read = api_mpegts_grid_read;
+  if (api_mpegts_order_find("mux", hide, conf, ins))
+    return;
+
   LIST_FOREACH(mn, &mpegts_network_all, mn_global_link) {
     if (hide && !mn->mn_enabled) continue;
     LIST_FOREACH(mm, &mn->mn_muxes, mm_network_link) {
@@ -250,6 +425,8 @@ api_mpegts_mux_grid
       idnode_set_add(ins, (idnode_t*)mm, &conf->filter, perm->aa_lang_ui);
     }
   }
+
+  api_mpegts_order_store("mux", hide, conf, ins);
 }
 
 /*
@@ -271,6 +448,11 @@ api_mpegts_service_grid
       hide = 0;
   }
 
+  api_mpegts_cache_check(perm->aa_lang_ui);
+  conf->read = api_mpegts_grid_read;
+  if (api_mpegts_order_find("service", hide, conf, ins))
+    return;
+
   LIST_FOREACH(mn, &mpegts_network_all, mn_global_link) {
     if (hide && !mn->mn_enabled) continue;
     LIST_FOREACH(mm, &mn->mn_muxes, mm_network_link) {
@@ -282,6 +464,8 @@ api_mpegts_service_grid
       }
     }
   }
+
+  api_mpegts_order_store("service", hide, conf, ins);
 }
 
 /*
@@ -169,6 +169,70 @@ api_service_streams
   return 0;
 }
 
+static int
+api_service_quality
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  const char *uuid;
+  service_t *s;
+
+  /* No UUID */
+  if (!(uuid = htsmsg_get_str(args, "uuid")))
+    return EINVAL;
+
+  tvh_mutex_lock(&global_lock);
+
+  /* Couldn't find */
+  if (!(s = service_find_by_uuid(uuid))) {
+    tvh_mutex_unlock(&global_lock);
+    return EINVAL;
+  }
+
+  tvh_mutex_lock(&s->s_stream_mutex);
+  *resp = service_qual_msg(s);
+  htsmsg_add_str(*resp, "name", s->s_nicename);
+  tvh_mutex_unlock(&s->s_stream_mutex);
+
+  tvh_mutex_unlock(&global_lock);
+  return 0;
+}
+
+static int
+api_service_tsring
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  const char *uuid;
+  service_t *s;
+  int ret = 0;
+
+  /* No UUID */
+  if (!(uuid = htsmsg_get_str(args, "uuid")))
+    return EINVAL;
+
+  tvh_mutex_lock(&global_lock);
+
+  /* Couldn't find */
+  if (!(s = service_find_by_uuid(uuid))) {
+    tvh_mutex_unlock(&global_lock);
+    return EINVAL;
+  }
+
+  if (!strcmp(op, "service/tsring/arm")) {
+    if (service_tsring_arm(s, htsmsg_get_u32_or_default(args, "entries", 0)))
+      ret = ENOMEM;
+  } else if (!strcmp(op, "service/tsring/disarm")) {
+    service_tsring_disarm(s);
+  } else {
+    tvh_mutex_lock(&s->s_stream_mutex);
+    *resp = service_tsring_msg(s);
+    htsmsg_add_str(*resp, "name", s->s_nicename);
+    tvh_mutex_unlock(&s->s_stream_mutex);
+  }
+
+  tvh_mutex_unlock(&global_lock);
+  return ret;
+}
+
 static int
 api_service_remove_unseen
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
@@ -192,6 +256,10 @@ void api_service_init ( void )
     { "service/mapper/status",  ACCESS_ADMIN, api_mapper_status, NULL },
     { "service/list",           ACCESS_ADMIN, api_idnode_load_by_class, (void*)&service_class },
     { "service/streams",        ACCESS_ADMIN, api_service_streams, NULL },
+    { "service/quality",        ACCESS_ADMIN, api_service_quality, NULL },
+    { "service/tsring/arm",     ACCESS_ADMIN, api_service_tsring, NULL },
+    { "service/tsring/disarm",  ACCESS_ADMIN, api_service_tsring, NULL },
+    { "service/tsring/dump",    ACCESS_ADMIN, api_service_tsring, NULL },
     { "service/removeunseen",   ACCESS_ADMIN, api_service_remove_unseen, NULL },
     { NULL },
   };
@@ -29,16 +29,42 @@
 #include "epggrab.h"  //Needed to get the next EPG grab times
 #include "dvr/dvr.h"  //Needed to get the next schedule dvr time
 
-static int
-api_status_inputs
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+/*
+ * Status snapshots
+ *
+ * Monitoring tools poll the inputs/subscriptions/connections status
+ * endpoints every couple of seconds.  Instead of grabbing global_lock
+ * on every poll (and risking micro-stalls in the input threads), a
+ * periodic timer on the main loop serializes the state into ready-made
+ * response messages and swaps them in under a private mutex.  The API
+ * handlers then only copy the published snapshot.  The timer idles
+ * when nobody has polled recently; a cold poll falls back to a direct
+ * (locked) serialization while the snapshots warm up again.
+ */
+
+#define API_STATUS_SNAP_INPUTS        0
+#define API_STATUS_SNAP_SUBSCRIPTIONS 1
+#define API_STATUS_SNAP_CONNECTIONS   2
+#define API_STATUS_SNAP_COUNT         3
+
+#define API_STATUS_SNAP_PERIOD        2   /* refresh interval (seconds) */
+#define API_STATUS_SNAP_IDLE          10  /* stop refreshing after (seconds) */
+
+static tvh_mutex_t api_status_snap_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static htsmsg_t *api_status_snap[API_STATUS_SNAP_COUNT];
+static int64_t   api_status_snap_time;    /* when the snapshots were built */
+static int64_t   api_status_snap_access;  /* last poll from a monitor */
+static gtimer_t  api_status_snap_timer;
+
+static htsmsg_t *
+api_status_inputs_msg ( void )
 {
   int c = 0;
-  htsmsg_t *l, *e;
+  htsmsg_t *m, *l, *e;
   tvh_input_t *ti;
   tvh_input_stream_t *st;
   tvh_input_stream_list_t stl = { 0 };
-  
+
   tvh_mutex_lock(&global_lock);
   TVH_INPUT_FOREACH(ti)
     ti->ti_get_streams(ti, &stl);
@@ -53,32 +79,148 @@ api_status_inputs
     free(st);
     c++;
   }
-    
-  *resp = htsmsg_create_map();
-  htsmsg_add_msg(*resp, "entries", l);
-  htsmsg_add_u32(*resp, "totalCount", c);
 
-  return 0;
+  m = htsmsg_create_map();
+  htsmsg_add_msg(m, "entries", l);
+  htsmsg_add_u32(m, "totalCount", c);
+  return m;
 }
 
-static int
-api_status_subscriptions
-  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+static htsmsg_t *
+api_status_subscriptions_msg ( const char *lang )
 {
   int c;
-  htsmsg_t *l, *e;
+  htsmsg_t *m, *l, *e;
   th_subscription_t *ths;
 
   l = htsmsg_create_list();
   c = 0;
   tvh_mutex_lock(&global_lock);
   LIST_FOREACH(ths, &subscriptions, ths_global_link) {
-    e = subscription_create_msg(ths, perm->aa_lang_ui);
+    e = subscription_create_msg(ths, lang);
     htsmsg_add_msg(l, NULL, e);
     c++;
   }
   tvh_mutex_unlock(&global_lock);
 
+  m = htsmsg_create_map();
+  htsmsg_add_msg(m, "entries", l);
+  htsmsg_add_u32(m, "totalCount", c);
+  return m;
+}
+
+static htsmsg_t *
+api_status_connections_msg ( void )
+{
+  htsmsg_t *m;
+
+  tvh_mutex_lock(&global_lock);
+  m = tcp_server_connections();
+  tvh_mutex_unlock(&global_lock);
+  return m;
+}
+
+/* Return a copy of the published snapshot or NULL when it is missing
+ * or stale; always records the access so the refresh timer keeps (or
+ * resumes) rebuilding them */
+static htsmsg_t *
+api_status_snap_get ( int idx )
+{
+  htsmsg_t *m = NULL;
+
+  tvh_mutex_lock(&api_status_snap_mutex);
+  api_status_snap_access = mclk();
+  if (api_status_snap[idx] &&
+      mclk() - api_status_snap_time <= sec2mono(2 * API_STATUS_SNAP_PERIOD))
+    m = htsmsg_copy(api_status_snap[idx]);
+  tvh_mutex_unlock(&api_status_snap_mutex);
+  return m;
+}
+
+static void
+api_status_snap_cb ( void *aux )
+{
+  htsmsg_t *n[API_STATUS_SNAP_COUNT];
+  int64_t access;
+  int i;
+
+  lock_assert(&global_lock);
+  tvh_mutex_lock(&api_status_snap_mutex);
+  access = api_status_snap_access;
+  tvh_mutex_unlock(&api_status_snap_mutex);
+  if (mclk() - access <= sec2mono(API_STATUS_SNAP_IDLE)) {
+    n[API_STATUS_SNAP_INPUTS]        = api_status_inputs_msg();
+    n[API_STATUS_SNAP_SUBSCRIPTIONS] = api_status_subscriptions_msg(NULL);
+    n[API_STATUS_SNAP_CONNECTIONS]   = api_status_connections_msg();
+    tvh_mutex_lock(&api_status_snap_mutex);
+    for (i = 0; i < API_STATUS_SNAP_COUNT; i++) {
+      htsmsg_destroy(api_status_snap[i]);
+      api_status_snap[i] = n[i];
+    }
+    api_status_snap_time = mclk();
+    tvh_mutex_unlock(&api_status_snap_mutex);
+  }
+  gtimer_arm_rel(&api_status_snap_timer, api_status_snap_cb, NULL,
+                 API_STATUS_SNAP_PERIOD);
+}
+
+static int
+api_status_inputs
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  if ((*resp = api_status_snap_get(API_STATUS_SNAP_INPUTS)) == NULL)
+    *resp = api_status_inputs_msg();
+  return 0;
+}
+
+static int
+api_status_subscriptions
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  /* the snapshots are serialized with the default language */
+  if (perm->aa_lang_ui == NULL &&
+      (*resp = api_status_snap_get(API_STATUS_SNAP_SUBSCRIPTIONS)) != NULL)
+    return 0;
+  *resp = api_status_subscriptions_msg(perm->aa_lang_ui);
+  return 0;
+}
+
+static int
+api_status_descrambler
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  int c, i;
+  htsmsg_t *l, *e, *h;
+  service_t *t;
+  th_descrambler_t *td;
+  th_descrambler_runtime_t *dr;
+
+  l = htsmsg_create_list();
+  c = 0;
+  tvh_mutex_lock(&global_lock);
+  TAILQ_FOREACH(t, &service_all, s_all_link) {
+    tvh_mutex_lock(&t->s_stream_mutex);
+    if ((dr = t->s_descramble) != NULL) {
+      e = htsmsg_create_map();
+      htsmsg_add_str(e, "service", t->s_nicename ?: "");
+      if ((td = t->s_descrambler) != NULL)
+        htsmsg_add_str(e, "descrambler", td->td_nicename ?: "");
+      htsmsg_add_u32(e, "queue_bytes", dr->dr_queue_total);
+      htsmsg_add_u32(e, "queue_max_bytes", dr->dr_queue_max);
+      htsmsg_add_s64(e, "key_last_ms", mono2ms(dr->dr_key_lat_last));
+      htsmsg_add_s64(e, "key_max_ms", mono2ms(dr->dr_key_lat_max));
+      h = htsmsg_create_list();
+      for (i = 0; i < DESCRAMBLER_KEY_LAT_BUCKETS; i++)
+        htsmsg_add_u32(h, NULL, dr->dr_key_lat_hist[i]);
+      htsmsg_add_msg(e, "key_latency_hist", h);
+      htsmsg_add_u32(e, "key_latency_base_ms", DESCRAMBLER_KEY_LAT_BASE);
+      htsmsg_add_msg(l, NULL, e);
+      c++;
+    }
+    tvh_mutex_unlock(&t->s_stream_mutex);
+  }
+  tvh_mutex_unlock(&global_lock);
+
   *resp = htsmsg_create_map();
   htsmsg_add_msg(*resp, "entries", l);
   htsmsg_add_u32(*resp, "totalCount", c);
@@ -90,9 +232,8 @@ static int
 api_status_connections
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
 {
-  tvh_mutex_lock(&global_lock);
-  *resp = tcp_server_connections();
-  tvh_mutex_unlock(&global_lock);
+  if ((*resp = api_status_snap_get(API_STATUS_SNAP_CONNECTIONS)) == NULL)
+    *resp = api_status_connections_msg();
   return 0;
 }
 
@@ -173,6 +314,36 @@ api_status_input_clear_stats
   return 0;
 }
 
+static int
+api_status_tprofile
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  if (!tprofile_running)
+    return ENOSYS;
+  *resp = tprofile_get_stats();
+  return 0;
+}
+
+static int
+api_status_lockstats
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  int32_t on;
+
+  if (!htsmsg_get_s32(args, "enable", &on))
+    tvh_mutex_prof_start(on);
+  *resp = tvh_mutex_prof_stats();
+  return 0;
+}
+
+static int
+api_status_startup
+  ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
+{
+  *resp = tvh_startup_phases_msg();
+  return 0;
+}
+
 static int
 api_status_activity
   ( access_t *perm, void *opaque, const char *op, htsmsg_t *args, htsmsg_t **resp )
@@ -247,14 +418,21 @@ void api_status_init ( void )
   static api_hook_t ah[] = {
     { "status/connections",   ACCESS_ADMIN, api_status_connections, NULL },
     { "status/subscriptions", ACCESS_ADMIN, api_status_subscriptions, NULL },
+    { "status/descrambler",   ACCESS_ADMIN, api_status_descrambler, NULL },
     { "status/inputs",        ACCESS_ADMIN, api_status_inputs, NULL },
     { "status/inputclrstats", ACCESS_ADMIN, api_status_input_clear_stats, NULL },
+    { "status/tprofile",      ACCESS_ADMIN, api_status_tprofile, NULL },
+    { "status/lockstats",     ACCESS_ADMIN, api_status_lockstats, NULL },
+    { "status/startup",       ACCESS_ADMIN, api_status_startup, NULL },
     { "status/activity",      ACCESS_ADMIN, api_status_activity, NULL },
     { "connections/cancel",   ACCESS_ADMIN, api_connections_cancel, NULL },
     { NULL },
   };
 
   api_register_all(ah);
+
+  gtimer_arm_rel(&api_status_snap_timer, api_status_snap_cb, NULL,
+                 API_STATUS_SNAP_PERIOD);
 }
 
 
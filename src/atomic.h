@@ -276,6 +276,27 @@ atomic_exchange_ptr(atomic_refptr_t ptr, void *val)
 #endif
 }
 
+/*
+ * Atomic COMPARE and EXCHANGE operation
+ */
+
+static inline int
+atomic_cas_ptr(atomic_refptr_t ptr, void *cmp, void *val)
+{
+#if ENABLE_ATOMIC_PTR
+  return __sync_bool_compare_and_swap(ptr, cmp, val);
+#else
+  int ret = 0;
+  tvh_mutex_lock(&atomic_lock);
+  if (*ptr == cmp) {
+    *ptr = val;
+    ret = 1;
+  }
+  tvh_mutex_unlock(&atomic_lock);
+  return ret;
+#endif
+}
+
 /*
  * Atomic get operation
  */
@@ -304,6 +325,21 @@ atomic_get_time_t(volatile time_t *ptr)
   return atomic_add_time_t(ptr, 0);
 }
 
+static inline void *
+atomic_get_ptr(atomic_refptr_t ptr)
+{
+#if ENABLE_ATOMIC_PTR
+  __sync_synchronize();
+  return *ptr;
+#else
+  void *ret;
+  tvh_mutex_lock(&atomic_lock);
+  ret = *ptr;
+  tvh_mutex_unlock(&atomic_lock);
+  return ret;
+#endif
+}
+
 /*
  * Atomic set operation
  */
@@ -71,6 +71,7 @@ bouquet_free(bouquet_t *bq)
   idnode_set_free(bq->bq_services);
   htsmsg_destroy(bq->bq_services_waiting);
   free((char *)bq->bq_chtag_waiting);
+  free(bq->bq_fastscan_crc);
   free(bq->bq_name);
   free(bq->bq_ext_url);
   free(bq->bq_src);
@@ -95,6 +96,7 @@ bouquet_create(const char *uuid, htsmsg_t *conf,
   bq = calloc(1, sizeof(bouquet_t));
   bq->bq_services = idnode_set_create(1);
   bq->bq_active_services = idnode_set_create(1);
+  bq->bq_scan_generation = 1;
   bq->bq_ext_url_period = 60;
   bq->bq_mapencrypted = 1;
   bq->bq_mapradio = 1;
@@ -327,7 +329,7 @@ bouquet_map_channel(bouquet_t *bq, service_t *t)
     ch = (channel_t *)ilm->ilm_in2;
   if (ch && bq->bq_chtag)
     if (channel_tag_map(bouquet_tag(bq, 1), ch, ch))
-      idnode_changed(&ch->ch_id);
+      channel_changed(ch);
 }
 
 
@@ -484,12 +486,21 @@ bouquet_add_service(bouquet_t *bq, service_t *s, uint64_t lcn, const char *tag)
   service_lcn_t *tl;
   idnode_list_mapping_t *ilm;
   bouquet_t *global_bq = NULL;
+  uint32_t hash;
 
   lock_assert(&global_lock);
 
   if (!bq->bq_enabled)
     return;
 
+  /* Fold this entry into the scan hash for differential update detection */
+  hash = tvh_crc32(s->s_id.in_uuid.bin, sizeof(s->s_id.in_uuid.bin),
+                   bq->bq_scan_hash);
+  hash = tvh_crc32((const uint8_t *)&lcn, sizeof(lcn), hash);
+  if (tag)
+    hash = tvh_crc32((const uint8_t *)tag, strlen(tag) + 1, hash);
+  bq->bq_scan_hash = hash;
+
   if (!idnode_set_exists(bq->bq_services, &s->s_id)) {
     tvhtrace(LS_BOUQUET, "add service %s [%p] to %s lcn %"PRIu64"(.%"PRIu64")",
              s->s_nicename, s, bq->bq_name ?: "<unknown>",
@@ -513,10 +524,11 @@ bouquet_add_service(bouquet_t *bq, service_t *s, uint64_t lcn, const char *tag)
   }
   if (lcn != tl->sl_lcn) {
     tl->sl_lcn = lcn;
+    channel_number_index_invalidate();
     LIST_FOREACH(ilm, &s->s_channels, ilm_in1_link)
       idnode_notify_changed(ilm->ilm_in2);
   }
-  tl->sl_seen = 1;
+  tl->sl_seen = bq->bq_scan_generation;
 
   if (bq->bq_enabled && bq->bq_maptoch)
     bouquet_map_channel(bq, s);
@@ -641,6 +653,16 @@ bouquet_completed(bouquet_t *bq, uint32_t seen)
   if (!bq->bq_enabled)
     goto save;
 
+  /* Operator bouquets rebroadcast every few minutes; when the hashed
+   * service set matches the last completed scan there is no delta to
+   * apply, so skip the add/remove diff and the LCN sweep entirely */
+  if (bq->bq_scan_hash == bq->bq_update_hash &&
+      bq->bq_active_services->is_count == bq->bq_services->is_count) {
+    tvhtrace(LS_BOUQUET, "%s: unchanged update, dropped", bq->bq_name ?: "");
+    goto done;
+  }
+  bq->bq_update_hash = bq->bq_scan_hash;
+
   /* Add/Remove services */
   remove = idnode_set_create(0);
   for (z = 0; z < bq->bq_services->is_count; z++)
@@ -656,20 +678,20 @@ bouquet_completed(bouquet_t *bq, uint32_t seen)
     for (lcn = LIST_FIRST(&s->s_lcns); lcn; lcn = lcn_next) {
       lcn_next = LIST_NEXT(lcn, sl_link);
       if (lcn->sl_bouquet != bq) continue;
-      if (!lcn->sl_seen) {
+      if (lcn->sl_seen != bq->bq_scan_generation) {
         LIST_REMOVE(lcn, sl_link);
         free(lcn);
-      } else {
-        lcn->sl_seen = 0;
       }
     }
   }
 
-
+done:
   idnode_set_free(bq->bq_active_services);
   bq->bq_active_services = idnode_set_create(1);
 
 save:
+  bq->bq_scan_hash = 0;
+  bq->bq_scan_generation++;
   if (bq->bq_saveflag) {
     bq->bq_saveflag = 0;
     idnode_changed(&bq->bq_id);
@@ -684,15 +706,23 @@ bouquet_map_to_channels(bouquet_t *bq)
 {
   service_t *t;
   size_t z;
+  int map = bq->bq_enabled && bq->bq_maptoch;
 
+  /* Coalesce the per-channel saves into one pass over the bouquet */
+  channel_update_batch_begin();
+  if (map)
+    service_mapper_index_begin();
   for (z = 0; z < bq->bq_services->is_count; z++) {
     t = (service_t *)bq->bq_services->is_array[z];
-    if (bq->bq_enabled && bq->bq_maptoch) {
+    if (map) {
       bouquet_map_channel(bq, t);
     } else {
       bouquet_unmap_channel(bq, t);
     }
   }
+  if (map)
+    service_mapper_index_end();
+  channel_update_batch_end();
 
   if (!bq->bq_enabled) {
     if (bq->bq_services->is_count) {
@@ -717,6 +747,7 @@ bouquet_notify_channels(bouquet_t *bq)
   service_t *t;
   size_t z;
 
+  channel_number_index_invalidate();
   for (z = 0; z < bq->bq_services->is_count; z++) {
     t = (service_t *)bq->bq_services->is_array[z];
     LIST_FOREACH(ilm, &t->s_channels, ilm_in1_link)
@@ -58,12 +58,16 @@ typedef struct bouquet {
   idnode_set_t *bq_active_services;
   htsmsg_t     *bq_services_waiting;
   uint32_t      bq_services_seen;
+  uint32_t      bq_scan_hash;       /* running hash of the scan in progress */
+  uint32_t      bq_update_hash;     /* hash of the last completed scan */
+  uint32_t      bq_scan_generation; /* marks service LCNs seen this scan */
   uint32_t      bq_lcn_offset;
 
   /* fastscan bouquet helpers */
   int           bq_fastscan_nit;
   int           bq_fastscan_sdt;
   void         *bq_fastscan_bi;
+  void         *bq_fastscan_crc; /* fastscan SDT section dedup cache */
 
   void         *bq_download;
 
@@ -51,6 +51,7 @@ static void channel_tag_init ( void );
 static void channel_tag_done ( void );
 static void channel_tag_mapping_destroy(idnode_list_mapping_t *ilm, void *origin);
 static void channel_epg_update_all ( channel_t *ch );
+static channel_t **channel_number_index_get ( int *count );
 
 static int
 ch_id_cmp ( channel_t *a, channel_t *b )
@@ -58,9 +59,112 @@ ch_id_cmp ( channel_t *a, channel_t *b )
   return channel_get_id(a) - channel_get_id(b);
 }
 
+/* **************************************************************************
+ * Icon resolution
+ *
+ * Resolving a channel name to an icon URL probes the filesystem for
+ * every path candidate, which stalled bouquet imports of thousands of
+ * channels under the global lock.  Unresolved icons are handed to a
+ * small worker pool instead, and successful name -> URL resolutions
+ * are memoized and persisted so re-imports skip the probing entirely.
+ * *************************************************************************/
+
+#define CHANNEL_ICON_RESOLVERS 2
+
+typedef struct channel_icon_job {
+  TAILQ_ENTRY(channel_icon_job) cij_link;
+  char cij_uuid[UUID_HEX_SIZE];
+} channel_icon_job_t;
+
+static htsmsg_t *channel_icon_memo;
+static int       channel_icon_memo_dirty;
+static mtimer_t  channel_icon_memo_timer;
+
+static tvh_mutex_t channel_icon_resolve_lock = TVH_THREAD_MUTEX_INITIALIZER;
+static tvh_cond_t  channel_icon_resolve_cond;
+static TAILQ_HEAD(,channel_icon_job) channel_icon_resolve_queue;
+static pthread_t   channel_icon_resolve_tid[CHANNEL_ICON_RESOLVERS];
+static int         channel_icon_resolve_running;
+
+static const char *
+channel_icon_memo_get ( const char *name )
+{
+  return channel_icon_memo ? htsmsg_get_str(channel_icon_memo, name) : NULL;
+}
+
+static void
+channel_icon_memo_save_cb ( void *aux )
+{
+  if (!channel_icon_memo_dirty)
+    return;
+  channel_icon_memo_dirty = 0;
+  hts_settings_save(channel_icon_memo, "channel/iconmemo");
+}
+
+static void
+channel_icon_memo_put ( const char *name, const char *url )
+{
+  const char *s = channel_icon_memo_get(name);
+
+  if (s && !strcmp(s, url))
+    return;
+  if (channel_icon_memo == NULL)
+    channel_icon_memo = htsmsg_create_map();
+  htsmsg_set_str(channel_icon_memo, name, url);
+  channel_icon_memo_dirty = 1;
+  mtimer_arm_rel(&channel_icon_memo_timer, channel_icon_memo_save_cb,
+                 NULL, sec2mono(10));
+}
+
+static void *
+channel_icon_resolve_thread ( void *aux )
+{
+  channel_icon_job_t *cij;
+  channel_t *ch;
+
+  tvh_mutex_lock(&channel_icon_resolve_lock);
+  while (atomic_get(&channel_icon_resolve_running)) {
+    cij = TAILQ_FIRST(&channel_icon_resolve_queue);
+    if (cij == NULL) {
+      tvh_cond_wait(&channel_icon_resolve_cond, &channel_icon_resolve_lock);
+      continue;
+    }
+    TAILQ_REMOVE(&channel_icon_resolve_queue, cij, cij_link);
+    tvh_mutex_unlock(&channel_icon_resolve_lock);
+    tvh_mutex_lock(&global_lock);
+    if (atomic_get(&channel_icon_resolve_running) &&
+        (ch = channel_find_by_uuid(cij->cij_uuid)) != NULL)
+      (void)imagecache_get_id(channel_get_icon(ch));
+    tvh_mutex_unlock(&global_lock);
+    free(cij);
+    tvh_mutex_lock(&channel_icon_resolve_lock);
+  }
+  tvh_mutex_unlock(&channel_icon_resolve_lock);
+  return NULL;
+}
+
+static void
+channel_icon_resolve_push ( channel_t *ch )
+{
+  channel_icon_job_t *cij = malloc(sizeof(*cij));
+
+  idnode_uuid_as_str(&ch->ch_id, cij->cij_uuid);
+  tvh_mutex_lock(&channel_icon_resolve_lock);
+  TAILQ_INSERT_TAIL(&channel_icon_resolve_queue, cij, cij_link);
+  tvh_cond_signal(&channel_icon_resolve_cond, 0);
+  tvh_mutex_unlock(&channel_icon_resolve_lock);
+}
+
 static void
 channel_load_icon ( channel_t *ch )
 {
+  /* unresolved icons go through the worker pool - the filesystem
+     probing must not stall imports under the global lock */
+  if (tvh_str_default(ch->ch_icon, NULL) == NULL &&
+      atomic_get(&channel_icon_resolve_running)) {
+    channel_icon_resolve_push(ch);
+    return;
+  }
   (void)imagecache_get_id(channel_get_icon(ch));
 }
 
@@ -79,6 +183,8 @@ channel_class_changed ( idnode_t *self )
 {
   channel_t *ch = (channel_t *)self;
 
+  channel_number_index_invalidate();
+
   if (atomic_add(&ch->ch_changed_ref, 1) > 0)
     goto end;
 
@@ -629,7 +735,7 @@ channel_find_by_name(const char *name)
 
 /// Copy name without space and (U)HD suffix, lowercase in to a new
 /// buffer
-static char *
+char *
 channel_make_fuzzy_name(const char *name)
 {
   if (!name) return NULL;
@@ -707,9 +813,10 @@ channel_find_by_id ( uint32_t i )
 channel_t *
 channel_find_by_number ( const char *no )
 {
-  channel_t *ch;
+  channel_t *ch, **chlist;
   uint32_t maj, min = 0;
   uint64_t cno;
+  int count, a, b, i;
   char *s;
 
   if (no == NULL)
@@ -720,10 +827,22 @@ channel_find_by_number ( const char *no )
   }
   maj = atoi(no);
   cno = (uint64_t)maj * CHANNEL_SPLIT + (uint64_t)min;
-  CHANNEL_FOREACH(ch)
-    if(channel_get_number(ch) == cno)
-      break;
-  return ch;
+  chlist = channel_number_index_get(&count);
+  a = 0;
+  b = count;
+  while (a < b) {
+    i = (a + b) / 2;
+    if (channel_get_number(chlist[i]) < (int64_t)cno)
+      a = i + 1;
+    else
+      b = i;
+  }
+  if (a < count) {
+    ch = chlist[a];
+    if (channel_get_number(ch) == (int64_t)cno)
+      return ch;
+  }
+  return NULL;
 }
 
 /**
@@ -1079,6 +1198,17 @@ channel_get_icon ( channel_t *ch )
     }
   }
 
+  /*
+   * Memoized resolution from an earlier run or import
+   */
+  if (icon == NULL &&
+      (chname = channel_get_name(ch, NULL)) != NULL && chname[0] &&
+      (icn = channel_icon_memo_get(chname)) != NULL) {
+    icon = ch->ch_icon = strdup(icn);
+    idnode_changed(&ch->ch_id);
+    goto found;
+  }
+
   /*
    * 4 iterations:
    * 0,1: try channel name or picon
@@ -1189,6 +1319,10 @@ found:
   if (!icon || !*icon)
     return NULL;
 
+  /* Remember name -> URL for future imports */
+  if ((chname = channel_get_name(ch, NULL)) != NULL && chname[0])
+    channel_icon_memo_put(chname, icon);
+
   /* Picon? */
   if (!strncmp(icon, "picon://", 8)) {
     if (!picon) return NULL;
@@ -1199,6 +1333,29 @@ found:
   return icon;
 }
 
+/**
+ * Read-only variant for handlers holding only a domain read lock: no
+ * resolution is attempted (an unresolved icon stays unresolved until
+ * channel_get_icon() or the resolver threads run under the global
+ * lock) and the picon rewrite lands in the caller's buffer instead of
+ * the shared static one.
+ */
+const char *
+channel_get_icon_ro ( channel_t *ch, char *buf, size_t buflen )
+{
+  const char *picon = config.picon_path,
+             *icon  = tvh_str_default(ch->ch_icon, NULL);
+
+  if (icon == NULL)
+    return NULL;
+  if (!strncmp(icon, "picon://", 8)) {
+    if (!picon) return NULL;
+    snprintf(buf, buflen, "%s/%s", picon, icon + 8);
+    icon = buf;
+  }
+  return icon;
+}
+
 int channel_set_icon ( channel_t *ch, const char *icon )
 {
   int save = 0;
@@ -1222,6 +1379,59 @@ channel_get_epgid ( channel_t *ch )
   return channel_get_name(ch, NULL);
 }
 
+/* **************************************************************************
+ * Batched updates
+ * *************************************************************************/
+
+static int channel_update_batch_depth;
+static idnode_set_t *channel_update_batch_pending;
+
+/**
+ * Record a channel modification. Outside a batch this is equivalent to
+ * idnode_changed(). Inside a batch the channel is only queued, so repeated
+ * updates to the same channel (e.g. during a bouquet mapping pass) collapse
+ * into a single notify/save when the batch completes.
+ */
+void
+channel_changed ( channel_t *ch )
+{
+  lock_assert(&global_lock);
+
+  if (channel_update_batch_depth) {
+    if (channel_update_batch_pending == NULL)
+      channel_update_batch_pending = idnode_set_create(1);
+    idnode_set_add(channel_update_batch_pending, &ch->ch_id, NULL, NULL);
+  } else {
+    idnode_changed(&ch->ch_id);
+  }
+}
+
+void
+channel_update_batch_begin ( void )
+{
+  lock_assert(&global_lock);
+  channel_update_batch_depth++;
+}
+
+void
+channel_update_batch_end ( void )
+{
+  idnode_set_t *is;
+  size_t z;
+
+  lock_assert(&global_lock);
+  assert(channel_update_batch_depth > 0);
+
+  if (--channel_update_batch_depth)
+    return;
+  if ((is = channel_update_batch_pending) == NULL)
+    return;
+  channel_update_batch_pending = NULL;
+  for (z = 0; z < is->is_count; z++)
+    idnode_changed(is->is_array[z]);
+  idnode_set_free(is);
+}
+
 /* **************************************************************************
  * Creation/Deletion
  * *************************************************************************/
@@ -1250,6 +1460,7 @@ channel_create0
     abort();
   }
   channels_count++;
+  channel_number_index_invalidate();
 
   /* Defaults */
   ch->ch_enabled  = 1;
@@ -1343,8 +1554,11 @@ channel_delete ( channel_t *ch, int delconf )
     hts_settings_remove("channel/config/%s", idnode_uuid_as_str(&ch->ch_id, ubuf));
 
   /* Free memory */
+  if (channel_update_batch_pending)
+    idnode_set_remove(channel_update_batch_pending, &ch->ch_id);
   RB_REMOVE(&channels, ch, ch_link);
   channels_count--;
+  channel_number_index_invalidate();
   idnode_unlink(&ch->ch_id);
   free(ch->ch_epg_parent);
   free(ch->ch_name);
@@ -1388,18 +1602,66 @@ static sortfcn_t *channel_sort_fcn(const char *sort_type)
   return &channel_cmp1;
 }
 
+/*
+ * Cached number/name sorted list of all channels. channel_get_number()
+ * walks the mapped services and bouquet LCNs per call, so re-sorting on
+ * every API/webui request is expensive. The cache is rebuilt lazily and
+ * invalidated whenever a channel changes or a bouquet updates its LCNs.
+ */
+static channel_t **channel_number_index;
+static int channel_number_index_count;
+static int channel_number_index_dirty = 1;
+
+void
+channel_number_index_invalidate ( void )
+{
+  channel_number_index_dirty = 1;
+}
+
+static channel_t **
+channel_number_index_get ( int *count )
+{
+  channel_t *ch;
+  int n = 0;
+
+  lock_assert(&global_lock);
+
+  if (channel_number_index_dirty) {
+    channel_number_index = realloc(channel_number_index,
+                                   channels_count * sizeof(channel_t *));
+    CHANNEL_FOREACH(ch)
+      channel_number_index[n++] = ch;
+    assert(n == channels_count);
+    qsort(channel_number_index, n, sizeof(channel_t *), channel_cmp1);
+    channel_number_index_count = n;
+    channel_number_index_dirty = 0;
+  }
+
+  *count = channel_number_index_count;
+  return channel_number_index;
+}
+
 channel_t **
 channel_get_sorted_list(const char *sort_type, int all, int *_count)
 {
-  int count = 0;
+  int count = 0, idx_count, i;
   channel_t *ch, **chlist = malloc(channels_count * sizeof(channel_t *));
-
-  CHANNEL_FOREACH(ch)
-    if (all || ch->ch_enabled)
-      chlist[count++] = ch;
+  sortfcn_t *fcn = channel_sort_fcn(sort_type);
+
+  if (fcn == &channel_cmp1) {
+    /* Filter the maintained index, no per-request sort */
+    channel_t **idx = channel_number_index_get(&idx_count);
+    for (i = 0; i < idx_count; i++)
+      if (all || idx[i]->ch_enabled)
+        chlist[count++] = idx[i];
+  } else {
+    CHANNEL_FOREACH(ch)
+      if (all || ch->ch_enabled)
+        chlist[count++] = ch;
+    qsort(chlist, count, sizeof(channel_t *), fcn);
+  }
 
   assert(count <= channels_count);
-  qsort(chlist, count, sizeof(channel_t *), channel_sort_fcn(sort_type));
 
   *_count = count;
   return chlist;
@@ -1460,6 +1722,7 @@ channel_init ( void )
   htsmsg_field_t *f;
   channel_t *ch, *parent;
   char *s;
+  int id;
 
   channels_count = 0;
   RB_INIT(&channels);
@@ -1467,6 +1730,15 @@ channel_init ( void )
   idclass_register(&channel_class);
   idclass_register(&channel_tag_class);
 
+  /* Icon resolvers */
+  channel_icon_memo = hts_settings_load("channel/iconmemo");
+  TAILQ_INIT(&channel_icon_resolve_queue);
+  tvh_cond_init(&channel_icon_resolve_cond, 1);
+  atomic_set(&channel_icon_resolve_running, 1);
+  for (id = 0; id < CHANNEL_ICON_RESOLVERS; id++)
+    tvh_thread_create(&channel_icon_resolve_tid[id], NULL,
+                      channel_icon_resolve_thread, NULL, "chicon");
+
   /* Tags */
   channel_tag_init();
 
@@ -1500,10 +1772,35 @@ void
 channel_done ( void )
 {
   channel_t *ch;
+  channel_icon_job_t *cij;
+  int id;
+
+  /* Stop the icon resolvers (they take the global lock per job) */
+  atomic_set(&channel_icon_resolve_running, 0);
+  tvh_mutex_lock(&channel_icon_resolve_lock);
+  tvh_cond_signal(&channel_icon_resolve_cond, 1);
+  tvh_mutex_unlock(&channel_icon_resolve_lock);
+  for (id = 0; id < CHANNEL_ICON_RESOLVERS; id++)
+    pthread_join(channel_icon_resolve_tid[id], NULL);
+  while ((cij = TAILQ_FIRST(&channel_icon_resolve_queue)) != NULL) {
+    TAILQ_REMOVE(&channel_icon_resolve_queue, cij, cij_link);
+    free(cij);
+  }
 
   tvh_mutex_lock(&global_lock);
+  mtimer_disarm(&channel_icon_memo_timer);
+  if (channel_icon_memo) {
+    if (channel_icon_memo_dirty)
+      hts_settings_save(channel_icon_memo, "channel/iconmemo");
+    htsmsg_destroy(channel_icon_memo);
+    channel_icon_memo = NULL;
+  }
   while ((ch = RB_FIRST(&channels)) != NULL)
     channel_delete(ch, 0);
+  free(channel_number_index);
+  channel_number_index = NULL;
+  channel_number_index_count = 0;
+  channel_number_index_dirty = 1;
   memoryinfo_unregister(&channels_memoryinfo);
   tvh_mutex_unlock(&global_lock);
   channel_tag_done();
@@ -132,6 +132,16 @@ channel_t *channel_create0
 
 void channel_delete(channel_t *ch, int delconf);
 
+/* Like idnode_changed() for a channel, but deduplicated inside a batch */
+void channel_changed(channel_t *ch);
+
+/* Defer per-channel notify/save storms (e.g. bouquet renumbering); may nest */
+void channel_update_batch_begin(void);
+void channel_update_batch_end(void);
+
+/* Drop the cached number-sorted channel list (bouquet LCN changes etc.) */
+void channel_number_index_invalidate(void);
+
 void channel_remove_subscriber(channel_t *ch, int reason);
 
 channel_t *channel_find_by_name_and_bouquet(const char *name, const struct bouquet *bq);
@@ -151,6 +161,9 @@ channel_t *channel_find_by_id(uint32_t id);
 
 channel_t *channel_find_by_number(const char *no);
 
+/* Normalized (lowercase, no spaces, no (U/F)HD suffix) copy of a name */
+char *channel_make_fuzzy_name(const char *name);
+
 #define channel_find channel_find_by_uuid
 
 htsmsg_t * channel_class_get_list(void *o, const char *lang);
@@ -208,6 +221,7 @@ int64_t channel_get_number_from_str ( const char *str );
 char *channel_get_source ( channel_t *ch, char *dst, size_t dstlen );
 
 const char *channel_get_icon ( channel_t *ch );
+const char *channel_get_icon_ro ( channel_t *ch, char *buf, size_t buflen );
 int channel_set_icon ( channel_t *ch, const char *icon );
 
 const char *channel_get_epgid ( channel_t *ch );
@@ -229,6 +229,7 @@ int
 cron_next ( cron_t *c, const time_t now, time_t *ret )
 {
   struct tm nxt, tmp;
+  uint64_t rem;
   int endyear, loops = 1000;
   localtime_r(&now, &nxt);
   endyear = nxt.tm_year + 10;
@@ -252,23 +253,23 @@ cron_next ( cron_t *c, const time_t now, time_t *ret )
     ++nxt.tm_min;
   }
 
-  /* Minute */
-  while (!(c->c_min & (0x1LL << nxt.tm_min))) {
-    if (nxt.tm_min == 60) {
-      ++nxt.tm_hour;
-      nxt.tm_min = 0;
-    } else
-      nxt.tm_min++;
+  /* Minute - jump to the next set bit instead of walking the mask */
+  rem = nxt.tm_min < 60 ? c->c_min >> nxt.tm_min : 0;
+  if (rem) {
+    nxt.tm_min += __builtin_ctzll(rem);
+  } else {
+    ++nxt.tm_hour;
+    nxt.tm_min = __builtin_ctzll(c->c_min);
   }
 
   /* Hour */
-  while (!(c->c_hour & (0x1LL << nxt.tm_hour))) {
-    if (nxt.tm_hour == 24) {
-      ++nxt.tm_mday;
-      ++nxt.tm_wday;
-      nxt.tm_hour = 0;
-    } else
-      ++nxt.tm_hour;
+  rem = nxt.tm_hour < 24 ? c->c_hour >> nxt.tm_hour : 0;
+  if (rem) {
+    nxt.tm_hour += __builtin_ctzll(rem);
+  } else {
+    ++nxt.tm_mday;
+    ++nxt.tm_wday;
+    nxt.tm_hour = __builtin_ctzll(c->c_hour);
   }
 
   /* Date */
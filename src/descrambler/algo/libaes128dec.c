@@ -14,21 +14,176 @@
 
 #include "libaes128dec.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define AES128_HWACCEL 1
+#define AES128_HWACCEL_RUNTIME 1
+#include <immintrin.h>
+typedef struct aes128_hwkey {
+  __m128i rk[11];
+} aes128_hwkey_t;
+static int aes128_use_hw = -1; /* lazy runtime detection */
+#elif defined(__ARM_FEATURE_CRYPTO)
+#define AES128_HWACCEL 1
+#include <arm_neon.h>
+typedef struct aes128_hwkey {
+  uint8x16_t rk[11];
+} aes128_hwkey_t;
+static const int aes128_use_hw = 1;
+#endif
+
 /* key structure */
 typedef struct aes128_priv {
   AES_KEY keys[2]; /* 0 = even, 1 = odd */
+#if AES128_HWACCEL
+  aes128_hwkey_t hwkeys[2];
+#endif
 } aes128_priv_t;
 
+#if AES128_HWACCEL
+
+static const uint8_t aes128_sbox[256] = {
+  0x63,0x7c,0x77,0x7b,0xf2,0x6b,0x6f,0xc5,0x30,0x01,0x67,0x2b,0xfe,0xd7,0xab,0x76,
+  0xca,0x82,0xc9,0x7d,0xfa,0x59,0x47,0xf0,0xad,0xd4,0xa2,0xaf,0x9c,0xa4,0x72,0xc0,
+  0xb7,0xfd,0x93,0x26,0x36,0x3f,0xf7,0xcc,0x34,0xa5,0xe5,0xf1,0x71,0xd8,0x31,0x15,
+  0x04,0xc7,0x23,0xc3,0x18,0x96,0x05,0x9a,0x07,0x12,0x80,0xe2,0xeb,0x27,0xb2,0x75,
+  0x09,0x83,0x2c,0x1a,0x1b,0x6e,0x5a,0xa0,0x52,0x3b,0xd6,0xb3,0x29,0xe3,0x2f,0x84,
+  0x53,0xd1,0x00,0xed,0x20,0xfc,0xb1,0x5b,0x6a,0xcb,0xbe,0x39,0x4a,0x4c,0x58,0xcf,
+  0xd0,0xef,0xaa,0xfb,0x43,0x4d,0x33,0x85,0x45,0xf9,0x02,0x7f,0x50,0x3c,0x9f,0xa8,
+  0x51,0xa3,0x40,0x8f,0x92,0x9d,0x38,0xf5,0xbc,0xb6,0xda,0x21,0x10,0xff,0xf3,0xd2,
+  0xcd,0x0c,0x13,0xec,0x5f,0x97,0x44,0x17,0xc4,0xa7,0x7e,0x3d,0x64,0x5d,0x19,0x73,
+  0x60,0x81,0x4f,0xdc,0x22,0x2a,0x90,0x88,0x46,0xee,0xb8,0x14,0xde,0x5e,0x0b,0xdb,
+  0xe0,0x32,0x3a,0x0a,0x49,0x06,0x24,0x5c,0xc2,0xd3,0xac,0x62,0x91,0x95,0xe4,0x79,
+  0xe7,0xc8,0x37,0x6d,0x8d,0xd5,0x4e,0xa9,0x6c,0x56,0xf4,0xea,0x65,0x7a,0xae,0x08,
+  0xba,0x78,0x25,0x2e,0x1c,0xa6,0xb4,0xc6,0xe8,0xdd,0x74,0x1f,0x4b,0xbd,0x8b,0x8a,
+  0x70,0x3e,0xb5,0x66,0x48,0x03,0xf6,0x0e,0x61,0x35,0x57,0xb9,0x86,0xc1,0x1d,0x9e,
+  0xe1,0xf8,0x98,0x11,0x69,0xd9,0x8e,0x94,0x9b,0x1e,0x87,0xe9,0xce,0x55,0x28,0xdf,
+  0x8c,0xa1,0x89,0x0d,0xbf,0xe6,0x42,0x68,0x41,0x99,0x2d,0x0f,0xb0,0x54,0xbb,0x16
+};
+
+/* expand the control word to plain round key bytes (FIPS-197 order);
+   the OpenSSL AES_KEY layout differs between builds, so do it here */
+static void aes128_round_keys(const uint8_t *pk, uint8_t rk[11][16])
+{
+  uint8_t rcon = 0x01, t;
+  int i;
+
+  memcpy(rk[0], pk, 16);
+  for (i = 1; i < 11; i++) {
+    const uint8_t *prev = rk[i-1];
+    uint8_t *w = rk[i];
+    w[0] = prev[0] ^ aes128_sbox[prev[13]] ^ rcon;
+    w[1] = prev[1] ^ aes128_sbox[prev[14]];
+    w[2] = prev[2] ^ aes128_sbox[prev[15]];
+    w[3] = prev[3] ^ aes128_sbox[prev[12]];
+    w[4] = prev[4] ^ w[0];   w[5] = prev[5] ^ w[1];
+    w[6] = prev[6] ^ w[2];   w[7] = prev[7] ^ w[3];
+    w[8] = prev[8] ^ w[4];   w[9] = prev[9] ^ w[5];
+    w[10] = prev[10] ^ w[6]; w[11] = prev[11] ^ w[7];
+    w[12] = prev[12] ^ w[8]; w[13] = prev[13] ^ w[9];
+    w[14] = prev[14] ^ w[10]; w[15] = prev[15] ^ w[11];
+    t = rcon << 1;
+    rcon = (rcon & 0x80) ? t ^ 0x1b : t;
+  }
+}
+
+#endif /* AES128_HWACCEL */
+
+#if AES128_HWACCEL_RUNTIME /* x86-64 AES-NI */
+
+/* equivalent inverse cipher: reverse the schedule and run the middle
+   round keys through InvMixColumns */
+__attribute__((target("aes")))
+static void aes128_hw_set_key(aes128_hwkey_t *hk, const uint8_t *pk)
+{
+  uint8_t rk[11][16];
+  int i;
+
+  aes128_round_keys(pk, rk);
+  hk->rk[0] = _mm_loadu_si128((const __m128i *)rk[10]);
+  for (i = 1; i < 10; i++)
+    hk->rk[i] = _mm_aesimc_si128(_mm_loadu_si128((const __m128i *)rk[10 - i]));
+  hk->rk[10] = _mm_loadu_si128((const __m128i *)rk[0]);
+}
+
+/* ECB decrypt, four blocks in flight to fill the AES unit pipeline */
+__attribute__((target("aes")))
+static void aes128_hw_decrypt(const aes128_hwkey_t *hk, uint8_t *data, int blocks)
+{
+  __m128i b[4];
+  int i, j, n;
+
+  while (blocks > 0) {
+    n = blocks > 4 ? 4 : blocks;
+    for (i = 0; i < n; i++)
+      b[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(data + i * 16)),
+                           hk->rk[0]);
+    for (j = 1; j < 10; j++)
+      for (i = 0; i < n; i++)
+        b[i] = _mm_aesdec_si128(b[i], hk->rk[j]);
+    for (i = 0; i < n; i++) {
+      b[i] = _mm_aesdeclast_si128(b[i], hk->rk[10]);
+      _mm_storeu_si128((__m128i *)(data + i * 16), b[i]);
+    }
+    data += n * 16;
+    blocks -= n;
+  }
+}
+
+#elif AES128_HWACCEL /* ARMv8 crypto extensions */
+
+static void aes128_hw_set_key(aes128_hwkey_t *hk, const uint8_t *pk)
+{
+  uint8_t rk[11][16];
+  int i;
+
+  aes128_round_keys(pk, rk);
+  hk->rk[0] = vld1q_u8(rk[10]);
+  for (i = 1; i < 10; i++)
+    hk->rk[i] = vaesimcq_u8(vld1q_u8(rk[10 - i]));
+  hk->rk[10] = vld1q_u8(rk[0]);
+}
+
+static void aes128_hw_decrypt(const aes128_hwkey_t *hk, uint8_t *data, int blocks)
+{
+  uint8x16_t b[4];
+  int i, j, n;
+
+  while (blocks > 0) {
+    n = blocks > 4 ? 4 : blocks;
+    for (i = 0; i < n; i++)
+      b[i] = vld1q_u8(data + i * 16);
+    for (j = 0; j < 9; j++)
+      for (i = 0; i < n; i++)
+        b[i] = vaesimcq_u8(vaesdq_u8(b[i], hk->rk[j]));
+    for (i = 0; i < n; i++) {
+      b[i] = veorq_u8(vaesdq_u8(b[i], hk->rk[9]), hk->rk[10]);
+      vst1q_u8(data + i * 16, b[i]);
+    }
+    data += n * 16;
+    blocks -= n;
+  }
+}
+
+#endif /* AES128_HWACCEL */
+
 /* even cw represents one full 128-bit AES key */
 void aes128_set_even_control_word(void *keys, const uint8_t *pk)
 {
   AES_set_decrypt_key(pk, 128, &((aes128_priv_t *) keys)->keys[0]);
+#if AES128_HWACCEL
+  if (aes128_use_hw > 0)
+    aes128_hw_set_key(&((aes128_priv_t *) keys)->hwkeys[0], pk);
+#endif
 }
 
 /* odd cw represents one full 128-bit AES key */
 void aes128_set_odd_control_word(void *keys, const uint8_t *pk)
 {
   AES_set_decrypt_key(pk, 128, &((aes128_priv_t *) keys)->keys[1]);
+#if AES128_HWACCEL
+  if (aes128_use_hw > 0)
+    aes128_hw_set_key(&((aes128_priv_t *) keys)->hwkeys[1], pk);
+#endif
 }
 
 /* set control words */
@@ -36,8 +191,8 @@ void aes128_set_control_words(void *keys,
                            const uint8_t *ev,
                            const uint8_t *od)
 {
-  AES_set_decrypt_key(ev, 128, &((aes128_priv_t *) keys)->keys[0]);
-  AES_set_decrypt_key(od, 128, &((aes128_priv_t *) keys)->keys[1]);
+  aes128_set_even_control_word(keys, ev);
+  aes128_set_odd_control_word(keys, od);
 }
 
 /* allocate key structure */
@@ -45,6 +200,10 @@ void * aes128_get_priv_struct(void)
 {
   aes128_priv_t *keys;
 
+#if AES128_HWACCEL_RUNTIME
+  if (aes128_use_hw < 0)
+    aes128_use_hw = __builtin_cpu_supports("aes") ? 1 : 0;
+#endif
   keys = (aes128_priv_t *) malloc(sizeof(aes128_priv_t));
   if (keys) {
     static const uint8_t pk[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
@@ -81,6 +240,14 @@ void aes128_decrypt_packet(void *keys, const uint8_t *pkt)
     offset = 4;
   }
 
+#if AES128_HWACCEL
+  if (aes128_use_hw > 0) {
+    aes128_hw_decrypt(&((aes128_priv_t *) keys)->hwkeys[ev_od],
+                      (uint8_t *)pkt + offset, (188 - offset) / 16);
+    return;
+  }
+#endif
+
   k = &((aes128_priv_t *) keys)->keys[ev_od];
   for (; offset <= (188 - 16); offset += 16) {
     AES_ecb_encrypt(pkt + offset, (uint8_t *)(pkt + offset), k, AES_DECRYPT);
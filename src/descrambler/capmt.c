@@ -19,6 +19,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <ctype.h>
 
@@ -281,6 +282,7 @@ typedef struct capmt {
   capmt_demuxes_t capmt_demuxes;
   capmt_adapter_t capmt_adapters[MAX_CA];
   TAILQ_HEAD(, capmt_message) capmt_writeq;
+  int             capmt_wakeup_pending;
   tvh_mutex_t capmt_mutex;
   uint8_t         capmt_pmtversion;
 
@@ -662,10 +664,12 @@ capmt_write_msg(capmt_t *capmt, int adapter, int sid, const uint8_t *buf, size_t
 #endif
 
     // check if the socket is still alive by writing 0 bytes
-    if (capmt->capmt_sock[i] >= 0) {
+    // (the new protocol modes detect a dead peer on the real send below,
+    // so skip the extra per-message syscall there)
+    if (capmt->capmt_sock[i] >= 0 && !capmt_oscam_new(capmt)) {
       if (send(capmt->capmt_sock[i], NULL, 0, MSG_DONTWAIT) < 0)
         capmt->capmt_sock[i] = -1;
-      else if (!capmt_oscam_new(capmt) && found)
+      else if (found)
         return 0;
     }
 
@@ -750,31 +754,104 @@ capmt_queue_msg
     }
   } else
     TAILQ_INSERT_TAIL(&capmt->capmt_writeq, msg, cm_link);
-  tvh_write(capmt->capmt_pipe.wr, "c", 1);
+  /* coalesce wakeups - one pipe write is enough until the writer runs */
+  if (atomic_exchange(&capmt->capmt_wakeup_pending, 1) == 0)
+    tvh_write(capmt->capmt_pipe.wr, "c", 1);
 }
 
 /**
  *
  */
+static int
+capmt_write_msg_batch(capmt_t *capmt, struct iovec *iov, int iovcnt, size_t totlen)
+{
+  struct msghdr mh;
+  ssize_t res;
+  int i, fd = capmt->capmt_sock[0];
+
+  if (fd <= 0)
+    return -1;
+
+  for (i = 0; i < iovcnt; i++) {
+    tvhtrace(LS_CAPMT, "%s: Sending message to socket %i (batch)", capmt_name(capmt), fd);
+    tvhlog_hexdump(LS_CAPMT, iov[i].iov_base, iov[i].iov_len);
+  }
+
+  memset(&mh, 0, sizeof(mh));
+  mh.msg_iov = iov;
+  mh.msg_iovlen = iovcnt;
+  res = sendmsg(fd, &mh, MSG_DONTWAIT);
+  if (res < totlen) {
+#if ENABLE_ANDROID
+    tvhdebug(LS_CAPMT, "%s: Batch send failed to socket %i (%li)", capmt_name(capmt), fd, (long int)res);
+#else
+    tvhdebug(LS_CAPMT, "%s: Batch send failed to socket %i (%zi)", capmt_name(capmt), fd, res);
+#endif
+    capmt_socket_close_lock(capmt, 0);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ *
+ */
+#define CAPMT_BATCH_MSGS 32
+
 static void
 capmt_flush_queue(capmt_t *capmt, int del_only)
 {
-  capmt_message_t *msg;
+  capmt_message_t *msg, *batch[CAPMT_BATCH_MSGS];
+  struct iovec iov[CAPMT_BATCH_MSGS];
+  TAILQ_HEAD(, capmt_message) q;
+  size_t totlen;
+  int i, n, r;
+
+  /* grab the whole queue in one go, messages queued while we are
+     sending trigger a new wakeup */
+  atomic_set(&capmt->capmt_wakeup_pending, 0);
+  tvh_mutex_lock(&capmt->capmt_mutex);
+  TAILQ_MOVE(&q, &capmt->capmt_writeq, cm_link);
+  tvh_mutex_unlock(&capmt->capmt_mutex);
 
-  while (1) {
-    tvh_mutex_lock(&capmt->capmt_mutex);
-    msg = TAILQ_FIRST(&capmt->capmt_writeq);
-    if (msg)
-      TAILQ_REMOVE(&capmt->capmt_writeq, msg, cm_link);
-    tvh_mutex_unlock(&capmt->capmt_mutex);
-    if (msg == NULL)
-      break;
+  while ((msg = TAILQ_FIRST(&q)) != NULL) {
+    TAILQ_REMOVE(&q, msg, cm_link);
 
-    if (!del_only)
-      capmt_write_msg(capmt, msg->cm_adapter, msg->cm_sid,
-                      msg->cm_sb.sb_data, msg->cm_sb.sb_ptr);
+    if (del_only) {
+      sbuf_free(&msg->cm_sb);
+      free(msg);
+      continue;
+    }
+
+    r = capmt_write_msg(capmt, msg->cm_adapter, msg->cm_sid,
+                        msg->cm_sb.sb_data, msg->cm_sb.sb_ptr);
     sbuf_free(&msg->cm_sb);
     free(msg);
+
+    /* the new protocol modes share one connected socket, so gather the
+       remaining messages into vectored sends instead of one syscall per
+       filter match */
+    if (r || !capmt_oscam_new(capmt) || capmt->capmt_sock[0] <= 0)
+      continue;
+    while ((msg = TAILQ_FIRST(&q)) != NULL) {
+      n = 0;
+      totlen = 0;
+      do {
+        TAILQ_REMOVE(&q, msg, cm_link);
+        batch[n] = msg;
+        iov[n].iov_base = msg->cm_sb.sb_data;
+        iov[n].iov_len = msg->cm_sb.sb_ptr;
+        totlen += msg->cm_sb.sb_ptr;
+        n++;
+      } while (n < CAPMT_BATCH_MSGS && (msg = TAILQ_FIRST(&q)) != NULL);
+      r = capmt_write_msg_batch(capmt, iov, n, totlen);
+      for (i = 0; i < n; i++) {
+        sbuf_free(&batch[i]->cm_sb);
+        free(batch[i]);
+      }
+      if (r)
+        break;
+    }
   }
 }
 
@@ -414,12 +414,29 @@ cc_ecm_reply(cc_service_t *ct, cc_ecm_section_t *es,
   int i, resolved = 0;
   int64_t delay = (getfastmonoclock() - es->es_time) / 1000LL; // in ms
 
-  es->es_pending = 0;
+  /* drop this seq from the outstanding fan-out set */
+  for (i = 0; i < es->es_fanout; i++)
+    if (es->es_fanout_seq[i] == seq) {
+      es->es_fanout_seq[i] = es->es_fanout_seq[es->es_fanout - 1];
+      es->es_fanout--;
+      break;
+    }
+  es->es_pending = es->es_fanout > 0;
 
   snprintf(chaninfo, sizeof(chaninfo), " (PID %d CAID %04X)", es->es_capid, es->es_caid);
 
   if (key_even == NULL || key_odd == NULL) {
 
+    if (es->es_pending && es->es_keystate != ES_FORBIDDEN) {
+      /* parallel requests still in flight - wait for the other readers */
+      tvhdebug(cc->cc_subsys,
+               "%s: Received NOK for service \"%s\"%s, "
+               "waiting for %d more reader%s (seqno: %d)",
+               cc->cc_name, t->s_dvb_svcname, chaninfo,
+               es->es_fanout, es->es_fanout != 1 ? "s" : "", seq);
+      return;
+    }
+
     /* ERROR */
     if (es->es_nok < CC_MAX_NOKS)
       es->es_nok++;
@@ -540,12 +557,16 @@ cc_find_pending_section(cclient_t *cc, uint32_t seq, cc_service_t **_ct)
   cc_service_t *ct;
   cc_ecm_pid_t *ep;
   cc_ecm_section_t *es;
+  int i;
 
   if (_ct) *_ct = NULL;
   LIST_FOREACH(ct, &cc->cc_services, cs_link)
     LIST_FOREACH(ep, &ct->cs_ecm_pids, ep_link)
-      LIST_FOREACH(es, &ep->ep_sections, es_link)
-        if(es->es_seq == seq) {
+      LIST_FOREACH(es, &ep->ep_sections, es_link) {
+        for (i = 0; i < es->es_fanout; i++)
+          if (es->es_fanout_seq[i] == seq)
+            break;
+        if(es->es_seq == seq || i < es->es_fanout) {
           if (es->es_resolved) {
             mpegts_service_t *t = (mpegts_service_t *)ct->td_service;
             tvhdebug(cc->cc_subsys,
@@ -561,6 +582,7 @@ cc_find_pending_section(cclient_t *cc, uint32_t seq, cc_service_t **_ct)
             return es;
           }
         }
+      }
   tvhwarn(cc->cc_subsys, "%s: Got unexpected ECM reply (seqno: %d)",
           cc->cc_name, seq);
   return NULL;
@@ -905,7 +927,7 @@ cc_table_input(void *opaque, int pid, const uint8_t *data, int len, int emm)
   elementary_stream_t *st;
   mpegts_service_t *t = (mpegts_service_t*)ct->td_service;
   cclient_t *cc = ct->cs_client;
-  int section, ecm;
+  int section, ecm, sent;
   cc_ecm_pid_t *ep;
   cc_ecm_section_t *es;
   char chaninfo[40];
@@ -1045,11 +1067,30 @@ found:
       goto end;
     }
 
-    if (cc->cc_send_ecm(cc, ct, es, pcard, data, len) == 0) {
+    /* Until a reader has answered for this service, fan the request out
+     * to every matching card in parallel - the first valid CW wins and
+     * the late replies are dropped as duplicates.  Once validated, stick
+     * to the first (preferred) reader as before. */
+    es->es_fanout = 0;
+    sent = 0;
+    LIST_FOREACH(pcard, &cc->cc_cards, cs_card) {
+      if (!pcard->cs_running ||
+          pcard->cs_ra.caid != caid ||
+          !verify_provider(pcard, provid))
+        continue;
+      if (cc->cc_send_ecm(cc, ct, es, pcard, data, len))
+        continue;
+      if (es->es_fanout < CC_ECM_FANOUT)
+        es->es_fanout_seq[es->es_fanout++] = es->es_seq;
+      sent++;
       tvhdebug(cc->cc_subsys,
                "%s: Sending ECM%s section=%d/%d for service \"%s\" (seqno: %d)",
                cc->cc_name, chaninfo, section,
                ep->ep_last_section, t->s_dvb_svcname, es->es_seq);
+      if (ct->ecm_state == ECM_VALID)
+        break;
+    }
+    if (sent) {
       es->es_time = getfastmonoclock();
     } else {
       es->es_pending = 0;
@@ -28,6 +28,7 @@
  */
 #define CC_KEEPALIVE_INTERVAL 30
 #define CC_MAX_NOKS           3
+#define CC_ECM_FANOUT         8
 
 /**
  *
@@ -52,6 +53,8 @@ typedef struct cc_ecm_section {
   uint32_t es_provid;
 
   uint32_t es_seq;
+  uint32_t es_fanout_seq[CC_ECM_FANOUT]; /* outstanding parallel requests */
+  uint8_t  es_fanout;
   uint8_t  es_nok;
   uint8_t  es_pending;
   uint8_t  es_resolved;
@@ -106,6 +106,14 @@ descrambler_data_destroy(th_descrambler_runtime_t *dr, th_descrambler_data_t *dd
   }
 }
 
+static inline void
+descrambler_data_total_add(th_descrambler_runtime_t *dr, int len)
+{
+  dr->dr_queue_total += len;
+  if (dr->dr_queue_total > dr->dr_queue_max)
+    dr->dr_queue_max = dr->dr_queue_total;
+}
+
 static void
 descrambler_data_append(th_descrambler_runtime_t *dr, const uint8_t *tsb, int len)
 {
@@ -128,7 +136,7 @@ descrambler_data_append(th_descrambler_runtime_t *dr, const uint8_t *tsb, int le
         pid1 == pid2) {
       debug2("%p: data append %d, timestamp %ld, %s[%d]", dr, len, dd->dd_timestamp, keystr(tsb0), extractpid(tsb0));
       sbuf_append(&dd->dd_sbuf, tsb, len);
-      dr->dr_queue_total += len;
+      descrambler_data_total_add(dr, len);
       return;
     }
   }
@@ -139,7 +147,7 @@ descrambler_data_append(th_descrambler_runtime_t *dr, const uint8_t *tsb, int le
   sbuf_init(&dd->dd_sbuf);
   sbuf_append(&dd->dd_sbuf, tsb, len);
   TAILQ_INSERT_TAIL(&dr->dr_queue, dd, dd_link);
-  dr->dr_queue_total += len;
+  descrambler_data_total_add(dr, len);
 }
 
 static void
@@ -393,6 +401,134 @@ descrambler_quick_ecm ( mpegts_service_t *t, int pid )
   return 0;
 }
 
+/*
+ * Short-lived control word cache
+ *
+ * Zapping back to a recently watched service used to pay the full ECM
+ * round trip again.  On service stop the resolved control words are
+ * stashed here and on restart any word still inside its crypto period
+ * is installed immediately, so decryption resumes while the fresh ECM
+ * exchange runs in the background.  Words older than the observed ECM
+ * interval are never reused - they would decode garbage.
+ */
+#define DESCRAMBLER_CW_CACHE_SIZE 8
+
+typedef struct th_descrambler_cw_cache {
+  char     cc_uuid[UUID_HEX_SIZE];
+  uint8_t  cc_multipid;
+  struct {
+    uint16_t pid;
+    int      csa_type;
+    uint8_t  valid;
+    uint8_t  data[2][16];
+    int64_t  timestamp[2];
+    uint64_t interval;
+  } cc_keys[DESCRAMBLER_MAX_KEYS];
+} th_descrambler_cw_cache_t;
+
+static th_descrambler_cw_cache_t descrambler_cw_cache[DESCRAMBLER_CW_CACHE_SIZE];
+static int descrambler_cw_cache_pos;
+static tvh_mutex_t descrambler_cw_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+
+static void
+descrambler_cw_cache_store ( service_t *t, th_descrambler_runtime_t *dr )
+{
+  th_descrambler_cw_cache_t *cc;
+  th_descrambler_key_t *tk;
+  char ubuf[UUID_HEX_SIZE];
+  int i, valid = 0;
+
+  if (dr->dr_key_const)
+    return;
+  for (i = 0; i < DESCRAMBLER_MAX_KEYS; i++) {
+    valid |= dr->dr_keys[i].key_valid;
+    if (!dr->dr_key_multipid) break;
+  }
+  if (!valid)
+    return;
+  idnode_uuid_as_str(&t->s_id, ubuf);
+  tvh_mutex_lock(&descrambler_cw_cache_mutex);
+  for (i = 0; i < DESCRAMBLER_CW_CACHE_SIZE; i++)
+    if (!strcmp(descrambler_cw_cache[i].cc_uuid, ubuf))
+      break;
+  if (i >= DESCRAMBLER_CW_CACHE_SIZE) {
+    i = descrambler_cw_cache_pos;
+    descrambler_cw_cache_pos = (i + 1) % DESCRAMBLER_CW_CACHE_SIZE;
+  }
+  cc = &descrambler_cw_cache[i];
+  memset(cc, 0, sizeof(*cc));
+  strlcpy(cc->cc_uuid, ubuf, sizeof(cc->cc_uuid));
+  cc->cc_multipid = dr->dr_key_multipid;
+  for (i = 0; i < DESCRAMBLER_MAX_KEYS; i++) {
+    tk = &dr->dr_keys[i];
+    cc->cc_keys[i].pid       = tk->key_pid;
+    cc->cc_keys[i].csa_type  = tk->key_csa.csa_type;
+    cc->cc_keys[i].valid     = tk->key_valid & 0xc0;
+    cc->cc_keys[i].interval  = tk->key_interval;
+    memcpy(cc->cc_keys[i].data[0], tk->key_data[0], 16);
+    memcpy(cc->cc_keys[i].data[1], tk->key_data[1], 16);
+    cc->cc_keys[i].timestamp[0] = tk->key_timestamp[0];
+    cc->cc_keys[i].timestamp[1] = tk->key_timestamp[1];
+    if (!dr->dr_key_multipid) break;
+  }
+  tvh_mutex_unlock(&descrambler_cw_cache_mutex);
+}
+
+/* it's called inside s_stream_mutex lock! */
+static void
+descrambler_cw_cache_restore ( service_t *t, th_descrambler_runtime_t *dr )
+{
+  th_descrambler_cw_cache_t *cc;
+  th_descrambler_key_t *tk;
+  char ubuf[UUID_HEX_SIZE];
+  int64_t now = mclk();
+  int i, p, restored = 0;
+  uint8_t mask;
+
+  idnode_uuid_as_str(&t->s_id, ubuf);
+  tvh_mutex_lock(&descrambler_cw_cache_mutex);
+  for (i = 0; i < DESCRAMBLER_CW_CACHE_SIZE; i++)
+    if (!strcmp(descrambler_cw_cache[i].cc_uuid, ubuf))
+      break;
+  if (i >= DESCRAMBLER_CW_CACHE_SIZE)
+    goto out;
+  cc = &descrambler_cw_cache[i];
+  if (cc->cc_multipid != dr->dr_key_multipid)
+    goto out;
+  for (i = 0; i < DESCRAMBLER_MAX_KEYS; i++) {
+    if (cc->cc_keys[i].valid == 0) {
+      if (!dr->dr_key_multipid) break;
+      continue;
+    }
+    tk = &dr->dr_keys[i];
+    if (tvhcsa_set_type(&tk->key_csa, (mpegts_service_t *)t,
+                        cc->cc_keys[i].csa_type) < 0)
+      continue;
+    for (p = 0; p < 2; p++) {
+      mask = 0x40 << p;
+      if (!(cc->cc_keys[i].valid & mask)) continue;
+      /* reuse only words still inside their crypto period */
+      if (cc->cc_keys[i].timestamp[p] + cc->cc_keys[i].interval < now)
+        continue;
+      memcpy(tk->key_data[p], cc->cc_keys[i].data[p], 16);
+      tk->key_timestamp[p] = cc->cc_keys[i].timestamp[p];
+      if (p == 0)
+        tvhcsa_set_key_even(&tk->key_csa, tk->key_data[0]);
+      else
+        tvhcsa_set_key_odd(&tk->key_csa, tk->key_data[1]);
+      tk->key_pid = cc->cc_keys[i].pid;
+      tk->key_valid |= mask;
+      restored = 1;
+    }
+    if (!dr->dr_key_multipid) break;
+  }
+  if (restored)
+    tvhdebug(LS_DESCRAMBLER, "reusing cached control words for service \"%s\"",
+             t->s_nicename);
+out:
+  tvh_mutex_unlock(&descrambler_cw_cache_mutex);
+}
+
 /*
  * This routine is called from two places
  * a) start a new service
@@ -474,6 +610,8 @@ descrambler_service_start ( service_t *t )
     dr->dr_force_skip = 0;
     if (t->s_dvb_forcecaid == 0xffff)
       dr->dr_descramble = descrambler_pass;
+    else if (!constcw)
+      descrambler_cw_cache_restore(t, dr);
   }
   tvh_mutex_unlock(&t->s_stream_mutex);
 
@@ -502,6 +640,7 @@ descrambler_service_stop ( service_t *t )
   tvh_mutex_unlock(&t->s_stream_mutex);
   free(p);
   if (dr) {
+    descrambler_cw_cache_store(t, dr);
     for (i = 0; i < DESCRAMBLER_MAX_KEYS; i++) {
       tk = &dr->dr_keys[i];
       tvhcsa_destroy(&tk->key_csa);
@@ -690,6 +829,27 @@ descrambler_keytype2str( th_descrambler_keystate_t keytype )
   return val2str(keytype, keytypetab) ?: "INVALID";
 }
 
+/* account the delay between the ECM request and the received control word */
+static void
+descrambler_key_latency( th_descrambler_runtime_t *dr, int kidx, int64_t now )
+{
+  int64_t lat;
+  int i;
+
+  if (dr->dr_ecm_start[kidx] == 0)
+    return;
+  lat = now - dr->dr_ecm_start[kidx];
+  if (lat < 0)
+    return;
+  for (i = 0; i < DESCRAMBLER_KEY_LAT_BUCKETS - 1; i++)
+    if (lat < ms2mono(DESCRAMBLER_KEY_LAT_BASE << i))
+      break;
+  dr->dr_key_lat_hist[i]++;
+  dr->dr_key_lat_last = lat;
+  if (lat > dr->dr_key_lat_max)
+    dr->dr_key_lat_max = lat;
+}
+
 void
 descrambler_keys ( th_descrambler_t *td, int type, uint16_t pid,
                    const uint8_t *even, const uint8_t *odd )
@@ -793,6 +953,7 @@ cont:
         descrambler_data_key_check(dr, 0x80, dr->dr_queue_total) >= 0)
       insert |= 1;
     tk->key_timestamp[0] = mclk();
+    descrambler_key_latency(dr, 0, tk->key_timestamp[0]);
     if (dr->dr_ecm_start[0] < dr->dr_ecm_start[1]) {
       dr->dr_ecm_start[0] = dr->dr_ecm_start[1];
       tvhdebug(LS_DESCRAMBLER,
@@ -810,6 +971,7 @@ cont:
         descrambler_data_key_check(dr, 0xc0, dr->dr_queue_total) >= 0)
       insert |= 2;
     tk->key_timestamp[1] = mclk();
+    descrambler_key_latency(dr, 1, tk->key_timestamp[1]);
     if (dr->dr_ecm_start[1] < dr->dr_ecm_start[0]) {
       dr->dr_ecm_start[1] = dr->dr_ecm_start[0];
       tvhdebug(LS_DESCRAMBLER,
@@ -1263,6 +1425,12 @@ queue:
        * streaming faster.
        */
       dbuflen = MAX(300, config.descrambler_buffer);
+      if (dr->dr_queue_total >= (dbuflen / 2) * 188 &&
+          tvhlog_limit(&dr->dr_loglimit_stall, 10))
+        tvhwarn(LS_DESCRAMBLER, "key wait stalls service \"%s\": %u bytes buffered, "
+                "last ECM %"PRId64"ms ago",
+                ((mpegts_service_t *)t)->s_dvb_svcname, dr->dr_queue_total,
+                mono2ms(mclk() - MAX(dr->dr_ecm_start[0], dr->dr_ecm_start[1])));
       if (dr->dr_queue_total >= dbuflen * 188) {
         descrambler_data_cut(dr, MAX((dbuflen / 10) * 188, len));
         if (dr->dr_last_err + sec2mono(10) < mclk()) {
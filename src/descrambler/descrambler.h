@@ -85,6 +85,11 @@ typedef struct th_descrambler_key {
   tvhlog_limit_t key_loglimit;
 } th_descrambler_key_t;
 
+/* key latency (ECM seen -> CW applied) histogram, power-of-two
+   millisecond buckets starting at DESCRAMBLER_KEY_LAT_BASE */
+#define DESCRAMBLER_KEY_LAT_BUCKETS 8
+#define DESCRAMBLER_KEY_LAT_BASE    64
+
 typedef struct th_descrambler_runtime {
   th_descrambler_t *dr_descrambler;
   struct service *dr_service;
@@ -109,9 +114,14 @@ typedef struct th_descrambler_runtime {
   th_descrambler_key_t *dr_key_last;
   TAILQ_HEAD(, th_descrambler_data) dr_queue;
   uint32_t dr_queue_total;
+  uint32_t dr_queue_max;
   uint32_t dr_paritycheck;
   uint32_t dr_initial_paritycheck;
+  uint32_t dr_key_lat_hist[DESCRAMBLER_KEY_LAT_BUCKETS];
+  int64_t  dr_key_lat_last;
+  int64_t  dr_key_lat_max;
   tvhlog_limit_t dr_loglimit_key;
+  tvhlog_limit_t dr_loglimit_stall;
 } th_descrambler_runtime_t;
 
 typedef void (*descrambler_section_callback_t)
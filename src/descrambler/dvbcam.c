@@ -276,6 +276,57 @@ dvbcam_ca_lookup(dvbcam_active_cam_t *ac, mpegts_input_t *input, uint16_t caid)
   return 0;
 }
 
+/*
+ * Program all services of the CAM in one first/more/last transaction.
+ * Returns -1 when less than two services carry a PMT (the caller falls
+ * back to the single service command).
+ */
+static int
+dvbcam_capmt_send_list(dvbcam_active_cam_t *ac)
+{
+  dvbcam_active_service_t *as;
+  mpegts_service_t *s;
+  uint8_t **capmts;
+  size_t *capmtlens;
+  int bcmd, count = 0, i, r = 0;
+
+  TAILQ_FOREACH(as, &dvbcam_active_services, global_link)
+    if (as->ac == ac && as->last_pmt)
+      count++;
+  if (count < 2)
+    return -1;
+
+  capmts = alloca(count * sizeof(*capmts));
+  capmtlens = alloca(count * sizeof(*capmtlens));
+  i = 0;
+  TAILQ_FOREACH(as, &dvbcam_active_services, global_link) {
+    if (as->ac != ac || as->last_pmt == NULL)
+      continue;
+    if (i == 0)
+      bcmd = EN50221_CAPMT_BUILD_FIRST;
+    else if (i == count - 1)
+      bcmd = EN50221_CAPMT_BUILD_LAST;
+    else
+      bcmd = EN50221_CAPMT_BUILD_MORE;
+    s = (mpegts_service_t *)as->td_service;
+    r = en50221_capmt_build(s, bcmd,
+                            service_id16(s),
+                            ac->caids, ac->caids_count,
+                            as->last_pmt, as->last_pmt_len,
+                            &capmts[i], &capmtlens[i]);
+    if (r < 0)
+      break;
+    i++;
+  }
+  if (r >= 0) {
+    tvhtrace(LS_DVBCAM, "CAPMT list sent to CAM (%d services)", count);
+    linuxdvb_ca_enqueue_capmt_list(ac->ca, capmts, capmtlens, count, 1);
+  }
+  for (i--; i >= 0; i--)
+    free(capmts[i]);
+  return r < 0 ? r : 0;
+}
+
 /*
  *
  */
@@ -331,6 +382,11 @@ dvbcam_pmt_data(mpegts_service_t *s, const uint8_t *ptr, int len)
     ac->active_programs++;
   }
 
+  /* multi-descrambling - reprogram all services in one transaction,
+     coalescing the storm of per-service updates after a profile change */
+  if (dvbcam_capmt_send_list(ac) == 0)
+    goto done;
+
   r = en50221_capmt_build(s, bcmd,
                           service_id16(s),
                           ac->caids, ac->caids_count,
@@ -429,6 +485,7 @@ dvbcam_service_start(caclient_t *cac, service_t *t)
   th_descrambler_t *td;
   elementary_stream_t *st;
   th_descrambler_runtime_t *dr;
+  mpegts_service_t *ms;
   caid_t *c = NULL;
   char buf[128];
   int i, j;
@@ -642,6 +699,12 @@ update_pid:
   mpegts_pid_done(&ecm_to_open);
   mpegts_pid_done(&ecm_pids);
 #endif
+
+  /* program the CAM from the persisted PMT right away - the live
+     section from the carousel is reconciled later as an update */
+  ms = (mpegts_service_t *)t;
+  if (ms->s_dvb_pmt_cache)
+    dvbcam_pmt_data(ms, ms->s_dvb_pmt_cache, ms->s_dvb_pmt_cache_len);
   return;
 
 end:
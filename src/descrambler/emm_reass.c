@@ -54,6 +54,67 @@ emm_cache_lookup(emm_reass_t *ra, uint32_t crc)
   return 0;
 }
 
+/**
+ * Rebuild the provider id hash and drop the negative section cache
+ * when the provider set or UA was updated (the card clients replace
+ * the providers array directly, so detect it from a snapshot)
+ */
+static void
+emm_reass_refresh(emm_reass_t *ra)
+{
+  emm_provider_t *ep;
+  uint32_t h;
+  int i, size;
+
+  if (ra->emm_snap_providers == ra->providers &&
+      ra->emm_snap_count == ra->providers_count &&
+      memcmp(ra->emm_snap_ua, ra->ua, 8) == 0)
+    return;
+
+  free(ra->prov_hash);
+  size = 4;
+  while (size < ra->providers_count * 2)
+    size <<= 1;
+  ra->prov_hash = calloc(size, sizeof(*ra->prov_hash));
+  ra->prov_hash_size = ra->prov_hash ? size : 0;
+  if (ra->prov_hash)
+    PROVIDERS_FOREACH(ra, i, ep) {
+      h = (ep->id * 0x9e3779b1u) & (size - 1);
+      while (ra->prov_hash[h])
+        h = (h + 1) & (size - 1);
+      ra->prov_hash[h] = ep;
+    }
+  memset(ra->emm_nomatch_cache, 0, sizeof(ra->emm_nomatch_cache));
+  ra->emm_snap_providers = ra->providers;
+  ra->emm_snap_count = ra->providers_count;
+  memcpy(ra->emm_snap_ua, ra->ua, 8);
+}
+
+/**
+ *
+ */
+emm_provider_t *
+emm_find_provider(emm_reass_t *ra, uint32_t provid)
+{
+  emm_provider_t *ep;
+  uint32_t h;
+  int i;
+
+  if (ra->prov_hash) {
+    h = (provid * 0x9e3779b1u) & (ra->prov_hash_size - 1);
+    while ((ep = ra->prov_hash[h]) != NULL) {
+      if (ep->id == provid)
+        return ep;
+      h = (h + 1) & (ra->prov_hash_size - 1);
+    }
+    return NULL;
+  }
+  PROVIDERS_FOREACH(ra, i, ep)
+    if (ep->id == provid)
+      return ep;
+  return NULL;
+}
+
 /**
  * conax emm handler
  */
@@ -263,12 +324,8 @@ emm_viaccess
     id = via_provider_id(data, len);
     if (!id) return;
 
-    PROVIDERS_FOREACH(ra, i, ep)
-      if (ep->id == id) {
-        match = 1;
-        break;
-      }
-    if (!match) return;
+    ep = emm_find_provider(ra, id);
+    if (!ep) return;
 
     idx = data[0] - 0x8c;
     EP_VIACCESS(ep, idx).shared_len = 0;
@@ -596,14 +653,48 @@ emm_griffin
   }
 }
 
+typedef struct emm_filter_sent {
+  emm_send_t send;
+  void *aux;
+  int sent;
+} emm_filter_sent_t;
+
+static void
+emm_filter_send(void *aux, const uint8_t *radata, int ralen, void *mux)
+{
+  emm_filter_sent_t *fs = aux;
+  fs->sent = 1;
+  fs->send(fs->aux, radata, ralen, mux);
+}
+
 void
 emm_filter(emm_reass_t *ra, const uint8_t *data, int len, void *mux,
            emm_send_t send, void *aux)
 {
+  emm_filter_sent_t fs;
+  uint32_t crc, *slot;
+
   tvhtrace(ra->subsys, "emm filter : %s - len %d mux %p", caid2name(ra->caid), len, mux);
   tvhlog_hexdump(ra->subsys, data, len);
-  if (ra->do_emm)
+  if (!ra->do_emm)
+    return;
+  emm_reass_refresh(ra);
+  if (!ra->emm_stateless) {
     ra->do_emm(ra, data, len, mux, send, aux);
+    return;
+  }
+  /* broadcast floods repeat the same sections over and over - remember
+     those which matched nothing for this card and skip the rescan */
+  crc = tvh_crc32(data, len, 0xffffffff);
+  slot = &ra->emm_nomatch_cache[crc & EMM_NOMATCH_CACHE_MASK];
+  if (*slot == crc)
+    return;
+  fs.send = send;
+  fs.aux = aux;
+  fs.sent = 0;
+  ra->do_emm(ra, data, len, mux, emm_filter_send, &fs);
+  if (!fs.sent)
+    *slot = crc;
 }
 
 void
@@ -628,6 +719,10 @@ emm_reass_init(emm_reass_t *ra, int subsys, uint16_t caid)
   case CARD_GRIFFIN:     ra->do_emm = emm_griffin;      break;
   default: break;
   }
+  /* viaccess and cryptoworks carry state across sections (shared EMM
+     reassembly), so only the plain matchers are safe to dedup */
+  ra->emm_stateless = ra->type != CARD_VIACCESS &&
+                      ra->type != CARD_CRYPTOWORKS;
 }
 
 void
@@ -643,6 +738,7 @@ emm_reass_done(emm_reass_t *ra)
     }
   }
   free(ra->providers);
+  free(ra->prov_hash);
   if (ra->type == CARD_CRYPTOWORKS)
     free(RA_CRYPTOWORKS(ra).shared_emm);
   memset(&ra, 0, sizeof(ra));
@@ -40,6 +40,9 @@ struct emm_provider {
 #define EMM_CACHE_SIZE (1<<5)
 #define EMM_CACHE_MASK (EMM_CACHE_SIZE-1)
 
+#define EMM_NOMATCH_CACHE_SIZE (1<<8)
+#define EMM_NOMATCH_CACHE_MASK (EMM_NOMATCH_CACHE_SIZE-1)
+
 typedef void (*emm_send_t)
   (void *aux, const uint8_t *radata, int ralen, void *mux);
 
@@ -57,6 +60,16 @@ struct emm_reass {
   int emm_cache_count;
   uint32_t emm_cache[EMM_CACHE_SIZE];
 
+  /* id-keyed provider hash and negative section cache, both rebuilt
+     when the provider set / UA snapshot below goes stale */
+  emm_provider_t **prov_hash;
+  int prov_hash_size;
+  uint32_t emm_nomatch_cache[EMM_NOMATCH_CACHE_SIZE];
+  emm_provider_t *emm_snap_providers;
+  int emm_snap_count;
+  uint8_t emm_snap_ua[8];
+  uint8_t emm_stateless;
+
   union {
     struct {
       void       *shared_mux;
@@ -35,6 +35,12 @@
 #if ENABLE_DVBCSA
 static int dvbcsa_dl_scanned;
 static dvbcsa_dl_bs_key_set_type dvbcsa_dl_bs_key_set_ecm;
+
+/* Flush a partially filled batch on a PES boundary once it has been
+ * pending this long - low rate (radio) PIDs would otherwise wait many
+ * seconds for a full batch, while busy video still fills whole batches
+ * well before the deadline and keeps the bitslice throughput. */
+#define TVHCSA_FLUSH_LATENCY ms2mono(100)
 #endif
 
 static void
@@ -118,9 +124,17 @@ tvhcsa_csa_cbc_descramble
   int_fast8_t ev_od;
   int_fast16_t len;
   int_fast16_t offset;
+  int64_t now = mclk();
 
   for ( ; tsb < tsb_end; tsb += 188) {
 
+   if (csa->csa_fill && (tsb[1] & 0x40) != 0 &&    /* PES boundary */
+       now - csa->csa_cluster_mark >= TVHCSA_FLUSH_LATENCY)
+     tvhcsa_csa_cbc_flush(csa, s);
+
+   if (csa->csa_fill == 0)
+     csa->csa_cluster_mark = now;
+
    pkt = csa->csa_tsbcluster + csa->csa_fill * 188;
    memcpy(pkt, tsb, 188);
    csa->csa_fill++;
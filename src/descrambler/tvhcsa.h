@@ -47,6 +47,7 @@ typedef struct tvhcsa
   uint8_t *csa_tsbcluster;
   int      csa_fill;
   int      csa_fill_size;
+  int64_t  csa_cluster_mark; /*< mclk() when the first packet was queued */
   uint8_t  csa_ecm;
 
 #if ENABLE_DVBCSA
@@ -85,7 +85,7 @@ download_fetch_done(void *aux)
   download_t *dm = hc->hc_aux;
   if (dm->http_client) {
     dm->http_client = NULL;
-    http_client_close((http_client_t *)aux);
+    http_client_release((http_client_t *)aux);
   }
 }
 
@@ -260,7 +260,7 @@ download_fetch(void *aux)
   }
 
   if (dn->http_client) {
-    http_client_close(dn->http_client);
+    http_client_release(dn->http_client);
     dn->http_client = NULL;
   }
 
@@ -268,7 +268,7 @@ download_fetch(void *aux)
     tvherror(dn->subsys, "wrong url");
     goto stop;
   }
-  hc = http_client_connect(dn, HTTP_VERSION_1_1, u.scheme, u.host, u.port, NULL);
+  hc = http_client_connect_pooled(dn, HTTP_VERSION_1_1, u.scheme, u.host, u.port, NULL);
   if (hc == NULL) {
     tvherror(dn->subsys, "unable to open http client");
     goto stop;
@@ -313,7 +313,7 @@ void
 download_start( download_t *dn, const char *url, void *aux )
 {
   if (dn->http_client) {
-    http_client_close(dn->http_client);
+    http_client_release(dn->http_client);
     dn->http_client = NULL;
   }
   if (url) {
@@ -331,7 +331,7 @@ void
 download_done( download_t *dn )
 {
   if (dn->http_client) {
-    http_client_close(dn->http_client);
+    http_client_release(dn->http_client);
     dn->http_client = NULL;
   }
   download_pipe_close(dn);
@@ -411,6 +411,7 @@ typedef struct dvr_autorec_entry {
 
   channel_t *dae_channel;
   LIST_ENTRY(dvr_autorec_entry) dae_channel_link;
+  LIST_ENTRY(dvr_autorec_entry) dae_any_channel_link;
 
   channel_tag_t *dae_channel_tag;
   LIST_ENTRY(dvr_autorec_entry) dae_channel_tag_link;
@@ -569,6 +570,8 @@ time_t dvr_entry_get_extra_time_pre( dvr_entry_t *de );
 
 void dvr_entry_init(void);
 
+void dvr_entry_hydrate(void);
+
 void dvr_entry_done(void);
 
 void dvr_entry_destroy_by_config(dvr_config_t *cfg, int delconf);
@@ -617,6 +620,10 @@ void dvr_rec_unsubscribe(dvr_entry_t *de);
 
 void dvr_rec_migrate(dvr_entry_t *de_old, dvr_entry_t *de_new);
 
+void dvr_rec_recover(dvr_entry_t *de);
+
+void dvr_rec_recover_done(void);
+
 void dvr_event_replaced(epg_broadcast_t *e, epg_broadcast_t *new_e);
 
 void dvr_event_removed(epg_broadcast_t *e);
@@ -631,7 +638,15 @@ dvr_entry_t *dvr_entry_find_by_id(int id);
 time_t dvr_entry_find_earliest(void);
 
 static inline dvr_entry_t *dvr_entry_find_by_uuid(const char *uuid)
-  { return (dvr_entry_t*)idnode_find(uuid, &dvr_entry_class, NULL); }
+  {
+    dvr_entry_t *de = (dvr_entry_t*)idnode_find(uuid, &dvr_entry_class, NULL);
+    if (de == NULL) {
+      /* may refer to a finished entry which is not materialized yet */
+      dvr_entry_hydrate();
+      de = (dvr_entry_t*)idnode_find(uuid, &dvr_entry_class, NULL);
+    }
+    return de;
+  }
 
 dvr_entry_t *dvr_entry_find_by_event_fuzzy(epg_broadcast_t *e);
 
@@ -743,6 +758,8 @@ void dvr_autorec_update(void);
 /* Check autorec timers after a short delay. */
 void dvr_autorec_async_reschedule(void);
 
+void dvr_autorec_set_defer(int on);
+
 /* @return 1 if the event 'e' is matched by the autorec rule 'dae' */
 int dvr_autorec_cmp(dvr_autorec_entry_t *dae, epg_broadcast_t *e);
 /* Purge any autorec timers that are obsolete since they no longer match any events. */
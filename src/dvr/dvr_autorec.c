@@ -27,6 +27,13 @@
 
 struct dvr_autorec_entry_queue autorec_entries;
 
+/*
+ * Rules without a pinned channel; together with ch_autorecs this
+ * partitions the rules, so per-event checks only have to look at the
+ * event's own channel bucket plus this list
+ */
+static LIST_HEAD(, dvr_autorec_entry) autorec_any_channel_entries;
+
 static void autorec_regfree(dvr_autorec_entry_t *dae)
 {
   if (dae->dae_title) {
@@ -439,6 +446,7 @@ dvr_autorec_create(const char *uuid, htsmsg_t *conf)
   LIST_INSERT_HEAD(&dae->dae_config->dvr_autorec_entries, dae, dae_config_link);
 
   TAILQ_INSERT_TAIL(&autorec_entries, dae, dae_link);
+  LIST_INSERT_HEAD(&autorec_any_channel_entries, dae, dae_any_channel_link);
 
   idnode_load(&dae->dae_id, conf);
 
@@ -552,6 +560,8 @@ autorec_entry_destroy(dvr_autorec_entry_t *dae, int delconf)
 
   if(dae->dae_channel != NULL)
     LIST_REMOVE(dae, dae_channel_link);
+  else
+    LIST_REMOVE(dae, dae_any_channel_link);
 
   if(dae->dae_channel_tag != NULL)
     LIST_REMOVE(dae, dae_channel_tag_link);
@@ -629,6 +639,7 @@ dvr_autorec_entry_class_channel_set(void *o, const void *v)
   if (ch == NULL) {
     if (dae->dae_channel) {
       LIST_REMOVE(dae, dae_channel_link);
+      LIST_INSERT_HEAD(&autorec_any_channel_entries, dae, dae_any_channel_link);
       dae->dae_channel = NULL;
       return 1;
     }
@@ -638,6 +649,8 @@ dvr_autorec_entry_class_channel_set(void *o, const void *v)
       return 0;
     if (dae->dae_channel)
       LIST_REMOVE(dae, dae_channel_link);
+    else
+      LIST_REMOVE(dae, dae_any_channel_link);
     dae->dae_channel = ch;
     LIST_INSERT_HEAD(&ch->ch_autorecs, dae, dae_channel_link);
     return 1;
@@ -1534,9 +1547,16 @@ dvr_autorec_update(void)
   }
 }
 
+static int dvr_autorec_deferred;
+static int dvr_autorec_deferred_pending;
+
 static void
 dvr_autorec_async_reschedule_cb(void *ignored)
 {
+  if (dvr_autorec_deferred) {
+    dvr_autorec_deferred_pending = 1;
+    return;
+  }
   tvhdebug(LS_DVR, "dvr_autorec_async_reschedule_cb - begin");
   dvr_autorec_update();
   tvhdebug(LS_DVR, "dvr_autorec_async_reschedule_cb - end");
@@ -1558,22 +1578,50 @@ dvr_autorec_async_reschedule(void)
 }
 
 /**
- *
+ * Called for every EPG event update, so only look at the rules pinned
+ * to the event's channel and the rules without a channel instead of
+ * walking the whole rule set
  */
 void
 dvr_autorec_check_event(epg_broadcast_t *e)
 {
   dvr_autorec_entry_t *dae;
 
-  if (e->channel && !e->channel->ch_enabled)
+  if (dvr_autorec_deferred) {
+    /* overloaded - a full reschedule on resume covers the skipped events */
+    dvr_autorec_deferred_pending = 1;
+    return;
+  }
+  if (e->channel == NULL || !e->channel->ch_enabled)
     return;
-  TAILQ_FOREACH(dae, &autorec_entries, dae_link)
+  LIST_FOREACH(dae, &e->channel->ch_autorecs, dae_channel_link)
+    if(dvr_autorec_cmp(dae, e))
+      dvr_entry_create_by_autorec(1, e, dae);
+  LIST_FOREACH(dae, &autorec_any_channel_entries, dae_any_channel_link)
     if(dvr_autorec_cmp(dae, e))
       dvr_entry_create_by_autorec(1, e, dae);
   // Note: no longer updating event here as it will be done from EPG
   //       anyway
 }
 
+/**
+ * Load shedding - put off per-event rule evaluation; the deferred work
+ * is made up with one full reschedule when the governor releases us
+ */
+void
+dvr_autorec_set_defer(int on)
+{
+  lock_assert(&global_lock);
+
+  if (dvr_autorec_deferred == on)
+    return;
+  dvr_autorec_deferred = on;
+  if (!on && dvr_autorec_deferred_pending) {
+    dvr_autorec_deferred_pending = 0;
+    dvr_autorec_async_reschedule();
+  }
+}
+
 /**
  *
  */
@@ -1248,6 +1248,21 @@ const idclass_t dvr_config_class = {
       .opts     = PO_EXPERT | PO_DOC_NLIST,
       .group    = 2,
     },
+    {
+      .type     = PT_U32,
+      .id       = "preallocate",
+      .name     = N_("Preallocate file space in MiB (0=disabled)"),
+      .desc     = N_("Allocate file space this far ahead of the write "
+                     "position while recording, reducing fragmentation "
+                     "and allocation stalls on slow or network storage. "
+                     "Unused space is released when the recording "
+                     "finishes. Linux only; ignored when the filesystem "
+                     "does not support it."),
+      .off      = offsetof(dvr_config_t, dvr_muxcnf.m_prealloc),
+      .def.u32  = 0,
+      .opts     = PO_EXPERT,
+      .group    = 2,
+    },
     {
       .type     = PT_BOOL,
       .id       = "day-dir",
@@ -1640,6 +1655,7 @@ dvr_done(void)
   while ((cfg = LIST_FIRST(&dvrconfigs)) != NULL)
     dvr_config_destroy(cfg, 0);
   tvh_mutex_unlock(&global_lock);
+  dvr_rec_recover_done();
   dvr_autorec_done();
   dvr_timerec_done();
   dvr_disk_space_done();
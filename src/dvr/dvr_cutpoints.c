@@ -13,6 +13,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <string.h>
+#include <sys/stat.h>
 
 #include "tvheadend.h"
 #include "dvr.h"
@@ -222,6 +223,112 @@ static struct {
   },
 };
 
+/*
+ * Parsed cutpoint cache
+ *
+ * The webui re-requests cutpoints aggressively while seeking, so keep
+ * the most recently used parsed lists around, validated with the
+ * (mtime, size) of the cutpoint files. A request only touches the
+ * recording filesystem with a few stat calls unless a file changed.
+ * Negative results (no cutpoint files) are cached too.
+ */
+#define DVR_CUTPOINT_CACHE_SIZE 32
+
+typedef struct dvr_cutpoint_stat {
+  time_t  mtime;
+  int64_t size;
+} dvr_cutpoint_stat_t;
+
+typedef struct dvr_cutpoint_cache {
+  TAILQ_ENTRY(dvr_cutpoint_cache) dcc_link;
+  char *dcc_filename;              /* recording file (cache key) */
+  dvr_cutpoint_stat_t dcc_files[ARRAY_SIZE(dvr_cutpoint_parsers)];
+  dvr_cutpoint_list_t dcc_cuts;
+  int dcc_found;                   /* 0 = no cutpoint files present */
+} dvr_cutpoint_cache_t;
+
+static TAILQ_HEAD(dvr_cutpoint_cache_queue, dvr_cutpoint_cache)
+  dvr_cutpoint_cache_list = TAILQ_HEAD_INITIALIZER(dvr_cutpoint_cache_list);
+static int dvr_cutpoint_cache_count;
+static tvh_mutex_t dvr_cutpoint_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+
+static void
+dvr_cutpoint_list_copy (dvr_cutpoint_list_t *dst, dvr_cutpoint_list_t *src)
+{
+  dvr_cutpoint_t *cp, *cp2;
+
+  TAILQ_FOREACH(cp, src, dc_link) {
+    cp2 = malloc(sizeof(*cp2));
+    *cp2 = *cp;
+    TAILQ_INSERT_TAIL(dst, cp2, dc_link);
+  }
+}
+
+static void
+dvr_cutpoint_cache_flush (dvr_cutpoint_cache_t *dcc)
+{
+  dvr_cutpoint_t *cp;
+
+  while ((cp = TAILQ_FIRST(&dcc->dcc_cuts))) {
+    TAILQ_REMOVE(&dcc->dcc_cuts, cp, dc_link);
+    free(cp);
+  }
+}
+
+static void
+dvr_cutpoint_cache_store
+  ( const char *filename, const dvr_cutpoint_stat_t *fstats,
+    dvr_cutpoint_list_t *cuts )
+{
+  dvr_cutpoint_cache_t *dcc;
+
+  tvh_mutex_lock(&dvr_cutpoint_cache_mutex);
+  TAILQ_FOREACH(dcc, &dvr_cutpoint_cache_list, dcc_link)
+    if (strcmp(dcc->dcc_filename, filename) == 0)
+      break;
+  if (dcc == NULL) {
+    dcc = calloc(1, sizeof(*dcc));
+    dcc->dcc_filename = strdup(filename);
+    TAILQ_INIT(&dcc->dcc_cuts);
+    dvr_cutpoint_cache_count++;
+  } else {
+    TAILQ_REMOVE(&dvr_cutpoint_cache_list, dcc, dcc_link);
+    dvr_cutpoint_cache_flush(dcc);
+  }
+  TAILQ_INSERT_HEAD(&dvr_cutpoint_cache_list, dcc, dcc_link);
+  memcpy(dcc->dcc_files, fstats, sizeof(dcc->dcc_files));
+  dcc->dcc_found = cuts != NULL;
+  if (cuts)
+    dvr_cutpoint_list_copy(&dcc->dcc_cuts, cuts);
+  while (dvr_cutpoint_cache_count > DVR_CUTPOINT_CACHE_SIZE) {
+    dcc = TAILQ_LAST(&dvr_cutpoint_cache_list, dvr_cutpoint_cache_queue);
+    TAILQ_REMOVE(&dvr_cutpoint_cache_list, dcc, dcc_link);
+    dvr_cutpoint_cache_flush(dcc);
+    free(dcc->dcc_filename);
+    free(dcc);
+    dvr_cutpoint_cache_count--;
+  }
+  tvh_mutex_unlock(&dvr_cutpoint_cache_mutex);
+}
+
+static void
+dvr_cutpoint_cache_invalidate ( const char *filename )
+{
+  dvr_cutpoint_cache_t *dcc;
+
+  tvh_mutex_lock(&dvr_cutpoint_cache_mutex);
+  TAILQ_FOREACH(dcc, &dvr_cutpoint_cache_list, dcc_link)
+    if (strcmp(dcc->dcc_filename, filename) == 0) {
+      TAILQ_REMOVE(&dvr_cutpoint_cache_list, dcc, dcc_link);
+      dvr_cutpoint_cache_flush(dcc);
+      free(dcc->dcc_filename);
+      free(dcc);
+      dvr_cutpoint_cache_count--;
+      break;
+    }
+  tvh_mutex_unlock(&dvr_cutpoint_cache_mutex);
+}
+
 /*
  * Return cutpoint data for a recording (if present).
  */
@@ -232,6 +339,9 @@ dvr_get_cutpoint_list (dvr_entry_t *de)
   char *path, *sptr;
   const char *filename;
   dvr_cutpoint_list_t *cuts;
+  dvr_cutpoint_cache_t *dcc;
+  dvr_cutpoint_stat_t fstats[ARRAY_SIZE(dvr_cutpoint_parsers)];
+  struct stat st;
   int found_count = 0;
 
   /* Check this is a valid recording */
@@ -240,22 +350,52 @@ dvr_get_cutpoint_list (dvr_entry_t *de)
   if (filename == NULL)
     return NULL;
 
-  /* Allocate list space */
-  cuts = calloc(1, sizeof(dvr_cutpoint_list_t));
-  if (cuts == NULL)
-    return NULL;
-  TAILQ_INIT(cuts);
-
   /* Get base filename */
   // TODO: harcoded 3 for max extension plus 1 for termination
   path = alloca(strlen(filename) + 4);
   strcpy(path, filename);
   sptr = strrchr(path, '.');
-  if (!sptr) {
-    free(cuts);
+  if (!sptr)
     return NULL;
+
+  /* Stat the cutpoint files for cache validation */
+  memset(fstats, 0, sizeof(fstats));
+  for (i = 0; i < ARRAY_SIZE(dvr_cutpoint_parsers); i++) {
+    strcpy(sptr+1, dvr_cutpoint_parsers[i].ext);
+    if (stat(path, &st) == 0) {
+      fstats[i].mtime = st.st_mtime;
+      fstats[i].size  = st.st_size;
+    }
   }
 
+  /* Cache lookup */
+  tvh_mutex_lock(&dvr_cutpoint_cache_mutex);
+  TAILQ_FOREACH(dcc, &dvr_cutpoint_cache_list, dcc_link)
+    if (strcmp(dcc->dcc_filename, filename) == 0)
+      break;
+  if (dcc && memcmp(dcc->dcc_files, fstats, sizeof(fstats)) == 0) {
+    TAILQ_REMOVE(&dvr_cutpoint_cache_list, dcc, dcc_link);
+    TAILQ_INSERT_HEAD(&dvr_cutpoint_cache_list, dcc, dcc_link);
+    if (!dcc->dcc_found) {
+      tvh_mutex_unlock(&dvr_cutpoint_cache_mutex);
+      return NULL;
+    }
+    cuts = calloc(1, sizeof(dvr_cutpoint_list_t));
+    if (cuts) {
+      TAILQ_INIT(cuts);
+      dvr_cutpoint_list_copy(cuts, &dcc->dcc_cuts);
+    }
+    tvh_mutex_unlock(&dvr_cutpoint_cache_mutex);
+    return cuts;
+  }
+  tvh_mutex_unlock(&dvr_cutpoint_cache_mutex);
+
+  /* Allocate list space */
+  cuts = calloc(1, sizeof(dvr_cutpoint_list_t));
+  if (cuts == NULL)
+    return NULL;
+  TAILQ_INIT(cuts);
+
   /* Check each parser */
   for (i = 0; i < ARRAY_SIZE(dvr_cutpoint_parsers); i++) {
 
@@ -278,6 +418,8 @@ dvr_get_cutpoint_list (dvr_entry_t *de)
     }
   }//END loop through parsers
 
+  dvr_cutpoint_cache_store(filename, fstats, found_count ? cuts : NULL);
+
   /* Cleanup */
   if (found_count == 0)
   {
@@ -312,6 +454,8 @@ dvr_cutpoint_delete_files (const char *s)
   char *path, *dot;
   int i;
 
+  dvr_cutpoint_cache_invalidate(s);
+
   // TODO: harcoded 3 for max extension, plus 1 for . and one for termination
   path = alloca(strlen(s) + 5);
 
@@ -36,6 +36,17 @@
 struct dvr_entry_list dvrentries;
 static int dvr_in_init;
 
+/*
+ * Finished entries are not materialized at startup; dvr_entry_init()
+ * parks their raw configuration here (uuid -> settings) and
+ * dvr_entry_hydrate() turns them into real entries on first access.
+ * dvr_cold_rere holds the parent/child pairs which reference a parked
+ * entry and therefore cannot be resolved before hydration.
+ */
+static htsmsg_t *dvr_cold_log;
+static htsmsg_t *dvr_cold_rere;
+static mtimer_t dvr_hydrate_timer;
+
 #if ENABLE_DBUS_1
 static mtimer_t dvr_dbus_timer;
 #endif
@@ -1152,6 +1163,11 @@ dvr_entry_create(const char *uuid, htsmsg_t *conf, int clone)
       }
   }
 
+  /* Files cut short by an unclean shutdown lack the "stop" mark -
+   * probe them in the background to repair duration and size */
+  if (!clone)
+    dvr_rec_recover(de);
+
   if (!clone)
     dvr_entry_set_timer(de);
 
@@ -1760,6 +1776,9 @@ static dvr_entry_t *_dvr_duplicate_event(dvr_entry_t *de)
   if (!de->de_autorec)
     return NULL;
 
+  /* the full recording history must be visible for dedup */
+  dvr_entry_hydrate();
+
   // title not defined, can't be deduped
   if (lang_str_empty(de->de_title))
     return NULL;
@@ -2027,6 +2046,8 @@ dvr_entry_create_by_autorec(int enabled, epg_broadcast_t *e, dvr_autorec_entry_t
   uint32_t count = 0, max_count;
   htsmsg_t *conf;
 
+  dvr_entry_hydrate();
+
   /* Identical duplicate detection
      NOTE: Semantic duplicate detection is deferred to the start time of recording and then done using _dvr_duplicate_event by dvr_timer_start_recording. */
   LIST_FOREACH(de, &dvrentries, de_global_link) {
@@ -3238,6 +3259,7 @@ dvr_entry_t *
 dvr_entry_find_by_id(int id)
 {
   dvr_entry_t *de;
+  dvr_entry_hydrate();
   LIST_FOREACH(de, &dvrentries, de_global_link)
     if(idnode_get_short_uuid(&de->de_id) == id)
       break;
@@ -5536,6 +5558,56 @@ dvr_entry_file_moved(const char *src, const char *dst)
   return r;
 }
 
+/**
+ * Materialize the finished entries parked by dvr_entry_init().
+ * Cheap no-op once the cold log has been consumed.
+ */
+void
+dvr_entry_hydrate(void)
+{
+  htsmsg_t *l, *rere, *c;
+  htsmsg_field_t *f;
+  const char *parent, *child;
+  dvr_entry_t *de, *next, *head;
+
+  lock_assert(&global_lock);
+  if (dvr_in_init || dvr_cold_log == NULL)
+    return;
+  l = dvr_cold_log;
+  rere = dvr_cold_rere;
+  dvr_cold_log = dvr_cold_rere = NULL;
+  mtimer_disarm(&dvr_hydrate_timer);
+  tvhinfo(LS_DVR, "loading finished recording entries");
+  head = LIST_FIRST(&dvrentries);
+  dvr_in_init = 1;
+  HTSMSG_FOREACH(f, l) {
+    if((c = htsmsg_get_map_by_field(f)) == NULL)
+      continue;
+    (void)dvr_entry_create(htsmsg_field_name(f), c, 0);
+  }
+  dvr_in_init = 0;
+  htsmsg_destroy(l);
+  HTSMSG_FOREACH(f, rere) {
+    if((child = htsmsg_field_get_str(f)) == NULL)
+      continue;
+    parent = htsmsg_field_name(f);
+    dvr_entry_change_parent_child(dvr_entry_find_by_uuid(parent),
+                                  dvr_entry_find_by_uuid(child), NULL, 0);
+  }
+  htsmsg_destroy(rere);
+  /* new entries sit in front of the old list head */
+  for (de = LIST_FIRST(&dvrentries); de && de != head; de = next) {
+    next = LIST_NEXT(de, de_global_link);
+    dvr_entry_set_timer(de);
+  }
+}
+
+static void
+dvr_entry_hydrate_cb(void *aux)
+{
+  dvr_entry_hydrate();
+}
+
 /**
  *
  */
@@ -5546,11 +5618,14 @@ dvr_entry_init(void)
   htsmsg_field_t *f;
   const char *parent, *child;
   dvr_entry_t *de1, *de2;
+  int64_t stop;
 
   dvr_in_init = 1;
   dvr_fanart_to_prefetch = string_list_create();
   idclass_register(&dvr_entry_class);
   rere = htsmsg_create_map();
+  dvr_cold_log = htsmsg_create_map();
+  dvr_cold_rere = htsmsg_create_map();
   /* load config, but remove parent/child fields */
   if((l = hts_settings_load("dvr/log")) != NULL) {
     HTSMSG_FOREACH(f, l) {
@@ -5564,6 +5639,13 @@ dvr_entry_init(void)
         htsmsg_set_str(rere, htsmsg_field_name(f), child);
       htsmsg_delete_field(c, "parent");
       htsmsg_delete_field(c, "child");
+      /* keep startup to the active/upcoming set - finished entries
+       * wait in the cold log until somebody needs them */
+      if (!htsmsg_get_s64(c, "stop", &stop) && stop < gclk()) {
+        htsmsg_add_msg(dvr_cold_log, htsmsg_field_name(f),
+                       htsmsg_detach_submsg(f));
+        continue;
+      }
       (void)dvr_entry_create(htsmsg_field_name(f), c, 0);
     }
     htsmsg_destroy(l);
@@ -5574,11 +5656,28 @@ dvr_entry_init(void)
     if((child = htsmsg_field_get_str(f)) == NULL)
       continue;
     parent = htsmsg_field_name(f);
+    if (dvr_cold_log &&
+        (htsmsg_field_find(dvr_cold_log, parent) ||
+         htsmsg_field_find(dvr_cold_log, child))) {
+      htsmsg_set_str(dvr_cold_rere, parent, child);
+      continue;
+    }
     de1 = dvr_entry_find_by_uuid(parent);
     de2 = dvr_entry_find_by_uuid(child);
     dvr_entry_change_parent_child(de1, de2, NULL, 0);
   }
   htsmsg_destroy(rere);
+  if (dvr_cold_log == NULL) {
+    /* nothing left - a stray lookup already hydrated everything */
+  } else if (htsmsg_is_empty(dvr_cold_log)) {
+    htsmsg_destroy(dvr_cold_log);
+    htsmsg_destroy(dvr_cold_rere);
+    dvr_cold_log = dvr_cold_rere = NULL;
+  } else {
+    /* hydrate shortly after boot anyway, so disk space accounting and
+     * cleanup see the full history even without UI/API traffic */
+    mtimer_arm_rel(&dvr_hydrate_timer, dvr_entry_hydrate_cb, NULL, sec2mono(15));
+  }
   /* update the entry timers, call rerecord */
   for (de1 = LIST_FIRST(&dvrentries); de1; de1 = de2) {
     de2 = LIST_NEXT(de1, de_global_link);
@@ -5595,6 +5694,12 @@ dvr_entry_done(void)
 {
   dvr_entry_t *de;
   lock_assert(&global_lock);
+  mtimer_disarm(&dvr_hydrate_timer);
+  if (dvr_cold_log) {
+    htsmsg_destroy(dvr_cold_log);
+    htsmsg_destroy(dvr_cold_rere);
+    dvr_cold_log = dvr_cold_rere = NULL;
+  }
   while ((de = LIST_FIRST(&dvrentries)) != NULL) {
     if (de->de_sched_state == DVR_RECORDING)
       dvr_rec_unsubscribe(de);
@@ -30,24 +30,47 @@
 #define EVENT_BUF_LEN (5 * EVENT_SIZE + NAME_MAX)
 #define EVENT_MASK    IN_DELETE    | IN_DELETE_SELF | \
                       IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO
-                      
+
+/* hash table widths (must be a power of two for the fd hash) */
+#define INOT_FD_HASH_WIDTH    256
+#define INOT_PATH_HASH_WIDTH  1024
+#define INOT_DE_HASH_WIDTH    512
+
+#define INOT_FD_HASH(fd)      ((unsigned)(fd) & (INOT_FD_HASH_WIDTH - 1))
+#define INOT_PATH_HASH(path)  tvh_strhash((path), INOT_PATH_HASH_WIDTH)
+#define INOT_DE_HASH(de)      ((unsigned)(((uintptr_t)(de)) >> 4) % INOT_DE_HASH_WIDTH)
+
 static int                         _inot_fd;
 static RB_HEAD(,dvr_inotify_entry) _inot_tree;
 
 typedef struct dvr_inotify_filename
 {
   dvr_entry_t *de;
-  LIST_ENTRY(dvr_inotify_filename) link;
+  char *path;                     /* real path of the recorded file */
+  struct dvr_inotify_entry *dir;
+  LIST_ENTRY(dvr_inotify_filename) link;       /* dir->entries */
+  LIST_ENTRY(dvr_inotify_filename) path_link;  /* _inot_path_hash */
+  LIST_ENTRY(dvr_inotify_filename) de_link;    /* _inot_de_hash */
 } dvr_inotify_filename_t;
 
 typedef struct dvr_inotify_entry
 {
   RB_ENTRY(dvr_inotify_entry) link;
+  LIST_ENTRY(dvr_inotify_entry) fd_link;       /* _inot_fd_hash */
   char *path;
   int fd;
   LIST_HEAD(, dvr_inotify_filename) entries;
 } dvr_inotify_entry_t;
 
+/*
+ * Event handling is O(1): the watch descriptor from the kernel and
+ * the full path of the affected file are both resolved through hash
+ * tables instead of walking every monitored entry
+ */
+static LIST_HEAD(, dvr_inotify_entry)    _inot_fd_hash[INOT_FD_HASH_WIDTH];
+static LIST_HEAD(, dvr_inotify_filename) _inot_path_hash[INOT_PATH_HASH_WIDTH];
+static LIST_HEAD(, dvr_inotify_filename) _inot_de_hash[INOT_DE_HASH_WIDTH];
+
 static SKEL_DECLARE(dvr_inotify_entry_skel, dvr_inotify_entry_t);
 
 static void* _dvr_inotify_thread ( void *p );
@@ -87,16 +110,31 @@ void dvr_inotify_done ( void )
 }
 
 /**
- *
+ * Remove one monitored file, dropping the directory watch with the
+ * last file in it
  */
-static int dvr_inotify_exists ( dvr_inotify_entry_t *die, dvr_entry_t *de )
+static void _dvr_inotify_filename_destroy ( dvr_inotify_filename_t *dif )
 {
-  dvr_inotify_filename_t *dif;
+  dvr_inotify_entry_t *e = dif->dir;
+  int fd;
 
-  LIST_FOREACH(dif, &die->entries, link)
-    if (dif->de == de)
-      return 1;
-  return 0;
+  LIST_REMOVE(dif, link);
+  LIST_REMOVE(dif, path_link);
+  LIST_REMOVE(dif, de_link);
+  free(dif->path);
+  free(dif);
+
+  if (LIST_FIRST(&e->entries) == NULL) {
+    RB_REMOVE(&_inot_tree, e, link);
+    fd = atomic_get(&_inot_fd);
+    if (e->fd >= 0) {
+      LIST_REMOVE(e, fd_link);
+      if (fd >= 0)
+        inotify_rm_watch(fd, e->fd);
+    }
+    free(e->path);
+    free(e);
+  }
 }
 
 /**
@@ -108,6 +146,7 @@ static void dvr_inotify_add_one ( dvr_entry_t *de, htsmsg_t *m )
   dvr_inotify_entry_t *e;
   const char *filename;
   char path[PATH_MAX];
+  char *dir;
   int fd = atomic_get(&_inot_fd);
 
   filename = htsmsg_get_str(m, "filename");
@@ -122,33 +161,41 @@ static void dvr_inotify_add_one ( dvr_entry_t *de, htsmsg_t *m )
   if (!realpath(filename, path))
     return;
 
+  LIST_FOREACH(dif, &_inot_de_hash[INOT_DE_HASH(de)], de_link)
+    if (dif->de == de && strcmp(dif->path, path) == 0)
+      return;
+
+  dir = tvh_strdupa(path);
+
   SKEL_ALLOC(dvr_inotify_entry_skel);
-  dvr_inotify_entry_skel->path = dirname(path);
-  
+  dvr_inotify_entry_skel->path = dirname(dir);
+
   e = RB_INSERT_SORTED(&_inot_tree, dvr_inotify_entry_skel, link, _str_cmp);
   if (!e) {
     e       = dvr_inotify_entry_skel;
     SKEL_USED(dvr_inotify_entry_skel);
     e->path = strdup(e->path);
     e->fd   = inotify_add_watch(fd, e->path, EVENT_MASK);
+    if (e->fd >= 0)
+      LIST_INSERT_HEAD(&_inot_fd_hash[INOT_FD_HASH(e->fd)], e, fd_link);
   }
 
-  if (!dvr_inotify_exists(e, de)) {
+  dif = malloc(sizeof(*dif));
+  dif->de   = de;
+  dif->path = strdup(path);
+  dif->dir  = e;
 
-    dif = malloc(sizeof(*dif));
-    dif->de = de;
-
-    LIST_INSERT_HEAD(&e->entries, dif, link);
-
-    if (e->fd < 0) {
-      tvherror(LS_DVR, "failed to add inotify watch to %s (err=%s)",
-               e->path, strerror(errno));
-      dvr_inotify_del(de);
-    } else {
-      tvhdebug(LS_DVR, "adding inotify watch to %s (fd=%d)",
-               e->path, e->fd);
-    }
+  LIST_INSERT_HEAD(&e->entries, dif, link);
+  LIST_INSERT_HEAD(&_inot_path_hash[INOT_PATH_HASH(path)], dif, path_link);
+  LIST_INSERT_HEAD(&_inot_de_hash[INOT_DE_HASH(de)], dif, de_link);
 
+  if (e->fd < 0) {
+    tvherror(LS_DVR, "failed to add inotify watch to %s (err=%s)",
+             e->path, strerror(errno));
+    dvr_inotify_del(de);
+  } else {
+    tvhdebug(LS_DVR, "adding inotify watch to %s (fd=%d)",
+             e->path, e->fd);
   }
 }
 
@@ -170,29 +217,14 @@ void dvr_inotify_add ( dvr_entry_t *de )
  */
 void dvr_inotify_del ( dvr_entry_t *de )
 {
-  dvr_inotify_filename_t *f = NULL, *f_next;
-  dvr_inotify_entry_t *e, *e_next;
-  int fd;
+  dvr_inotify_filename_t *f, *f_next;
 
   lock_assert(&global_lock);
 
-  for (e = RB_FIRST(&_inot_tree); e; e = e_next) {
-    e_next = RB_NEXT(e, link);
-    for (f = LIST_FIRST(&e->entries); f; f = f_next) {
-      f_next = LIST_NEXT(f, link);
-      if (f->de == de) {
-        LIST_REMOVE(f, link);
-        free(f);
-        if (LIST_FIRST(&e->entries) == NULL) {
-          RB_REMOVE(&_inot_tree, e, link);
-          fd = atomic_get(&_inot_fd);
-          if (e->fd >= 0 && fd >= 0)
-            inotify_rm_watch(fd, e->fd);
-          free(e->path);
-          free(e);
-        }
-      }
-    }
+  for (f = LIST_FIRST(&_inot_de_hash[INOT_DE_HASH(de)]); f; f = f_next) {
+    f_next = LIST_NEXT(f, de_link);
+    if (f->de == de)
+      _dvr_inotify_filename_destroy(f);
   }
 }
 
@@ -218,13 +250,27 @@ static dvr_inotify_entry_t *
 _dvr_inotify_find
   ( int fd )
 {
-  dvr_inotify_entry_t *e = NULL;
-  RB_FOREACH(e, &_inot_tree, link)
+  dvr_inotify_entry_t *e;
+  LIST_FOREACH(e, &_inot_fd_hash[INOT_FD_HASH(fd)], fd_link)
     if (e->fd == fd)
       break;
   return e;
 }
 
+/*
+ * Find monitored file by its full (real) path
+ */
+static dvr_inotify_filename_t *
+_dvr_inotify_find_file
+  ( const char *path )
+{
+  dvr_inotify_filename_t *dif;
+  LIST_FOREACH(dif, &_inot_path_hash[INOT_PATH_HASH(path)], path_link)
+    if (strcmp(dif->path, path) == 0)
+      break;
+  return dif;
+}
+
 /*
  * File moved
  */
@@ -233,7 +279,7 @@ _dvr_inotify_moved
   ( int from_fd, const char *from, const char *to, int to_fd )
 {
   dvr_inotify_filename_t *dif;
-  dvr_inotify_entry_t *die;
+  dvr_inotify_entry_t *die, *old_die;
   dvr_entry_t *de;
   char path[PATH_MAX];
   const char *filename;
@@ -250,11 +296,14 @@ _dvr_inotify_moved
   snprintf(path, sizeof(path), "%s/%s", die->path, from);
   tvhdebug(LS_DVR, "inotify: moved from_fd: %d path: \"%s\" to: \"%s\" to_fd: %d", from_fd, path, to?:"<none>", to_fd);
 
-  de = NULL;
-  LIST_FOREACH(dif, &die->entries, link) {
-    de = dif->de;
-    if (de->de_files == NULL)
-      continue;
+  if (!(dif = _dvr_inotify_find_file(path)))
+    return;
+  de = dif->de;
+
+  /* Locate the matching file record of this entry; the stored
+   * filename may still point through a symlinked directory, so
+   * compare the resolved path too */
+  if (de->de_files != NULL)
     HTSMSG_FOREACH(f, de->de_files)
       if ((m = htsmsg_field_get_map(f)) != NULL) {
         filename = htsmsg_get_str(m, "filename");
@@ -265,16 +314,9 @@ _dvr_inotify_moved
         if (!strcmp(path, filename))
           break;
 
-        /* Otherwise get the real path (after symlinks)
-         * and compare that.
-         *
-         * This is made far more complicated since the
-         * file has already disappeared so we can't realpath
-         * on it, so we need to realpath on the directory
-         * it _was_ in, append the filename part and then
-         * compare against the realpath of the path we
-         * were given by inotify.
-         */
+        /* The file itself has already disappeared so we can't
+         * realpath on it; resolve the directory it _was_ in and
+         * append the filename part */
         dir = tvh_strdupa(filename);
         dir = dirname(dir);
         if (realpath(dir, realdir)) {
@@ -284,12 +326,6 @@ _dvr_inotify_moved
             break;
         }
       }
-    if (f)
-      break;
-  }
-
-  if (!dif)
-    return;
 
   if (f && m) {
     /* "to" will be NULL on a delete */
@@ -309,13 +345,36 @@ _dvr_inotify_moved
       tvhdebug(LS_DVR, "inotify: moved from name: \"%s\" to: \"%s\" for \"%s\"", path, new_path, idnode_uuid_as_str(&de->de_id, ubuf));
       htsmsg_set_str(m, "filename", new_path);
       idnode_changed(&de->de_id);
+      /* re-home the index record under its new name/directory */
+      LIST_REMOVE(dif, path_link);
+      free(dif->path);
+      dif->path = strdup(new_path);
+      LIST_INSERT_HEAD(&_inot_path_hash[INOT_PATH_HASH(dif->path)], dif, path_link);
+      if (dif->dir != die) {
+        old_die = dif->dir;
+        LIST_REMOVE(dif, link);
+        dif->dir = die;
+        LIST_INSERT_HEAD(&die->entries, dif, link);
+        if (LIST_FIRST(&old_die->entries) == NULL) {
+          RB_REMOVE(&_inot_tree, old_die, link);
+          if (old_die->fd >= 0) {
+            LIST_REMOVE(old_die, fd_link);
+            if (atomic_get(&_inot_fd) >= 0)
+              inotify_rm_watch(atomic_get(&_inot_fd), old_die->fd);
+          }
+          free(old_die->path);
+          free(old_die);
+        }
+      }
     } else {
       htsmsg_field_destroy(de->de_files, f);
       if (htsmsg_is_empty(de->de_files))
         dvr_inotify_del(de);
+      else
+        _dvr_inotify_filename_destroy(dif);
     }
   }
-  
+
   dvr_vfs_refresh_entry(de);
   htsp_dvr_entry_update(de);
   idnode_notify_changed(&de->de_id);
@@ -424,11 +483,11 @@ void* _dvr_inotify_thread ( void *p )
       /* Removed */
       } else if (ev->mask & IN_DELETE) {
         _dvr_inotify_delete(ev->wd, ev->name);
-    
+
       /* Moved self */
       } else if (ev->mask & IN_MOVE_SELF) {
         _dvr_inotify_moved_all(ev->wd, NULL);
-    
+
       /* Removed self */
       } else if (ev->mask & IN_DELETE_SELF) {
         _dvr_inotify_delete_all(ev->wd);
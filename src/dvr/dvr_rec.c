@@ -19,6 +19,7 @@
 
 #include <sys/stat.h>
 #include <ctype.h>
+#include <fcntl.h>
 
 #include "tvheadend.h"
 #include "streaming.h"
@@ -1725,9 +1726,14 @@ dvr_thread(void *aux)
   time_t now, real_start, start_time = 0, running_start = 0, running_stop = 0;
   char *postproc;
   char ubuf[UUID_HEX_SIZE];
+  tprofile_t tprofile;
+  char tpname[64];
 
   if (!dvr_thread_global_lock(de, &run))
     return NULL;
+  snprintf(tpname, sizeof(tpname), "dvr %s",
+           idnode_uuid_as_str(&de->de_id, ubuf));
+  tprofile_init(&tprofile, tpname);
   comm_skip = de->de_config->dvr_skip_commercials;
   postproc  = de->de_config->dvr_postproc ? strdup(de->de_config->dvr_postproc) : NULL;
   running_disabled = dvr_entry_get_epg_running(de) <= 0;
@@ -1787,6 +1793,8 @@ dvr_thread(void *aux)
 
     tvh_mutex_unlock(&sq->sq_mutex);
 
+    tprofile_start(&tprofile, "message");
+
     switch(sm->sm_type) {
 
     case SMT_PACKET:
@@ -2009,11 +2017,16 @@ fin:
     }//END of switch statement
 
     streaming_msg_free(sm);
+
+    tprofile_finish(&tprofile);
+
     tvh_mutex_lock(&sq->sq_mutex);
   }//END of while loop
 
   tvh_mutex_unlock(&sq->sq_mutex);
 
+  tprofile_done(&tprofile);
+
   streaming_queue_clear(&backlog);
 
   if (ss)
@@ -2095,3 +2108,236 @@ dvr_thread_epilog(dvr_entry_t *de, const char *dvr_postproc)
 
   idnode_changed(&de->de_id);
 }
+
+/**
+ * Post-crash recovery of interrupted recordings.
+ *
+ * A file map in de_files gets its "stop" timestamp only when the file
+ * is closed cleanly, so after an unclean shutdown the interrupted file
+ * keeps the scheduled stop time and a stale size.  Rather than reading
+ * such files back in full, probe them with two bounded reads - the
+ * first PCR near the head and the last PCR near the tail give the real
+ * duration, fstat() gives the real size.  The probes are drained by a
+ * small worker pool so a large archive is repaired in parallel while
+ * the entries are loaded.
+ */
+
+#define DVR_RECOVER_THREADS 4
+#define DVR_RECOVER_PROBE   (2*1024*1024)
+
+typedef struct dvr_recover_job {
+  TAILQ_ENTRY(dvr_recover_job) drj_link;
+  char    *drj_uuid;
+  char    *drj_filename;
+  int64_t  drj_start;
+} dvr_recover_job_t;
+
+static TAILQ_HEAD(, dvr_recover_job) dvr_recover_jobs =
+  TAILQ_HEAD_INITIALIZER(dvr_recover_jobs);
+static tvh_mutex_t dvr_recover_lock = TVH_THREAD_MUTEX_INITIALIZER;
+static tvh_cond_t  dvr_recover_cond;
+static pthread_t   dvr_recover_tid[DVR_RECOVER_THREADS];
+static int         dvr_recover_threads;
+static int         dvr_recover_shutdown;
+
+/**
+ * Find a PCR (27 MHz) in a buffer of transport packets,
+ * the first one or the last one
+ */
+static int64_t
+dvr_recover_pcr_scan(const uint8_t *buf, size_t len, int last)
+{
+  const uint8_t *tsb;
+  int64_t pcr = -1, v;
+  size_t i;
+
+  /* the tail read is unlikely to start on a packet boundary */
+  for (i = 0; i + 2*188 <= len; i++)
+    if (buf[i] == 0x47 && buf[i+188] == 0x47)
+      break;
+  for ( ; i + 188 <= len; i += 188) {
+    tsb = buf + i;
+    if (tsb[0] != 0x47 || (tsb[3] & 0x20) == 0 ||
+        tsb[4] < 7 || (tsb[5] & 0x10) == 0)
+      continue;
+    v = (int64_t)tsb[6] << 25 | tsb[7] << 17 | tsb[8] << 9 |
+        tsb[9] << 1 | tsb[10] >> 7;
+    pcr = v * 300 + (((tsb[10] & 1) << 8) | tsb[11]);
+    if (!last)
+      break;
+  }
+  return pcr;
+}
+
+/**
+ * Stat the file and estimate its duration from the PCR span,
+ * reading at most DVR_RECOVER_PROBE bytes from each end
+ */
+static int
+dvr_recover_probe(const char *filename, int64_t *duration,
+                  int64_t *size, time_t *mtime)
+{
+  struct stat st;
+  uint8_t *buf;
+  int64_t first, last;
+  ssize_t r;
+  int fd;
+
+  fd = tvh_open(filename, O_RDONLY, 0);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st)) {
+    close(fd);
+    return -1;
+  }
+  *size = st.st_size;
+  *mtime = st.st_mtime;
+  *duration = -1;
+  buf = malloc(DVR_RECOVER_PROBE);
+  if (buf) {
+    r = read(fd, buf, DVR_RECOVER_PROBE);
+    first = r > 0 ? dvr_recover_pcr_scan(buf, r, 0) : -1;
+    if (first >= 0) {
+      r = pread(fd, buf, DVR_RECOVER_PROBE,
+                st.st_size > DVR_RECOVER_PROBE ?
+                  st.st_size - DVR_RECOVER_PROBE : 0);
+      last = r > 0 ? dvr_recover_pcr_scan(buf, r, 1) : -1;
+      if (last >= 0) {
+        if (last < first)
+          last += ((int64_t)1 << 33) * 300; /* 33-bit PCR base wrap */
+        *duration = (last - first) / 27000000;
+      }
+    }
+    free(buf);
+  }
+  close(fd);
+  return 0;
+}
+
+/**
+ *
+ */
+static void *
+dvr_recover_thread(void *aux)
+{
+  dvr_recover_job_t *drj;
+  dvr_entry_t *de;
+  htsmsg_field_t *f;
+  htsmsg_t *e = NULL;
+  const char *s;
+  int64_t duration, size;
+  time_t mtime, stop;
+
+  tvh_mutex_lock(&dvr_recover_lock);
+  while (!dvr_recover_shutdown) {
+    drj = TAILQ_FIRST(&dvr_recover_jobs);
+    if (drj == NULL) {
+      tvh_cond_wait(&dvr_recover_cond, &dvr_recover_lock);
+      continue;
+    }
+    TAILQ_REMOVE(&dvr_recover_jobs, drj, drj_link);
+    tvh_mutex_unlock(&dvr_recover_lock);
+
+    if (!dvr_recover_probe(drj->drj_filename, &duration, &size, &mtime)) {
+      /* no PCR span (non-TS container) - trust the filesystem */
+      stop = duration >= 0 ? drj->drj_start + duration : mtime;
+      if (stop < drj->drj_start)
+        stop = drj->drj_start;
+      tvh_mutex_lock(&global_lock);
+      de = dvr_entry_find_by_uuid(drj->drj_uuid);
+      if (de) {
+        HTSMSG_FOREACH(f, de->de_files)
+          if ((e = htsmsg_field_get_map(f)) != NULL &&
+              (s = htsmsg_get_str(e, "filename")) != NULL &&
+              strcmp(s, drj->drj_filename) == 0)
+            break;
+        if (f && htsmsg_get_s64_or_default(e, "stop", 0) == 0) {
+          htsmsg_set_s64(e, "stop", stop);
+          htsmsg_set_s64(e, "size", size);
+          tvhinfo(LS_DVR, "\"%s\": recovered interrupted file \"%s\" "
+                          "(%"PRId64" bytes, stop %"PRId64")",
+                  lang_str_get(de->de_title, NULL), drj->drj_filename,
+                  size, (int64_t)stop);
+          idnode_changed(&de->de_id);
+        }
+      }
+      tvh_mutex_unlock(&global_lock);
+    }
+
+    free(drj->drj_uuid);
+    free(drj->drj_filename);
+    free(drj);
+    tvh_mutex_lock(&dvr_recover_lock);
+  }
+  tvh_mutex_unlock(&dvr_recover_lock);
+  return NULL;
+}
+
+/**
+ * Queue a duration/size probe for every file of the entry which
+ * was not closed cleanly (no "stop" mark in the file map)
+ */
+void
+dvr_rec_recover(dvr_entry_t *de)
+{
+  dvr_recover_job_t *drj;
+  htsmsg_field_t *f;
+  htsmsg_t *e;
+  const char *filename;
+  int64_t start;
+  char ubuf[UUID_HEX_SIZE];
+
+  lock_assert(&global_lock);
+
+  if (de->de_files == NULL)
+    return;
+  HTSMSG_FOREACH(f, de->de_files) {
+    if ((e = htsmsg_field_get_map(f)) == NULL)
+      continue;
+    if ((filename = htsmsg_get_str(e, "filename")) == NULL)
+      continue;
+    if (htsmsg_get_s64(e, "start", &start))
+      continue;
+    if (htsmsg_get_s64_or_default(e, "stop", 0))
+      continue;
+    drj = calloc(1, sizeof(*drj));
+    drj->drj_uuid = strdup(idnode_uuid_as_str(&de->de_id, ubuf));
+    drj->drj_filename = strdup(filename);
+    drj->drj_start = start;
+    tvh_mutex_lock(&dvr_recover_lock);
+    if (dvr_recover_threads == 0)
+      tvh_cond_init(&dvr_recover_cond, 1);
+    TAILQ_INSERT_TAIL(&dvr_recover_jobs, drj, drj_link);
+    if (dvr_recover_threads < DVR_RECOVER_THREADS)
+      tvh_thread_create(&dvr_recover_tid[dvr_recover_threads++], NULL,
+                        dvr_recover_thread, NULL, "dvr-recover");
+    tvh_cond_signal(&dvr_recover_cond, 0);
+    tvh_mutex_unlock(&dvr_recover_lock);
+  }
+}
+
+/**
+ *
+ */
+void
+dvr_rec_recover_done(void)
+{
+  dvr_recover_job_t *drj;
+  int i;
+
+  tvh_mutex_lock(&dvr_recover_lock);
+  dvr_recover_shutdown = 1;
+  if (dvr_recover_threads > 0)
+    tvh_cond_signal(&dvr_recover_cond, 1);
+  tvh_mutex_unlock(&dvr_recover_lock);
+  for (i = 0; i < dvr_recover_threads; i++)
+    pthread_join(dvr_recover_tid[i], NULL);
+  dvr_recover_threads = 0;
+  dvr_recover_shutdown = 0;
+  while ((drj = TAILQ_FIRST(&dvr_recover_jobs)) != NULL) {
+    TAILQ_REMOVE(&dvr_recover_jobs, drj, drj_link);
+    free(drj->drj_uuid);
+    free(drj->drj_filename);
+    free(drj);
+  }
+}
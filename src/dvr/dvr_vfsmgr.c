@@ -40,6 +40,23 @@ static tvh_mutex_t dvr_disk_space_mutex;
 static mtimer_t dvr_disk_space_timer;
 static tasklet_t dvr_disk_space_tasklet;
 
+/*
+ * Cached statvfs snapshots per storage path. statvfs may block for
+ * seconds on network filesystems, so it is only called from the
+ * tasklet (and once to seed a new path); the checks running under
+ * global_lock read the last snapshot instead.
+ */
+typedef struct dvr_vfs_stats {
+  LIST_ENTRY(dvr_vfs_stats) link;
+  char *path;
+  tvh_fsid_t fsid;
+  struct statvfs vfs;
+  int64_t updated;    /* mclk() of last refresh, 0 = never */
+  int64_t last_used;  /* mclk() of last reader, for pruning */
+} dvr_vfs_stats_t;
+
+static LIST_HEAD(, dvr_vfs_stats) dvr_vfs_stats_list;
+
 /*
  *
  */
@@ -78,6 +95,138 @@ dvr_vfs_find1(dvr_vfs_t *old, htsmsg_t *m)
   return NULL;
 }
 
+/*
+ * Get the disk space snapshot for a storage path; only the very first
+ * lookup of a path does a synchronous statvfs to seed the cache
+ */
+static int
+dvr_vfs_cached_stats(const char *path, struct statvfs *vfs, tvh_fsid_t *fsid)
+{
+  dvr_vfs_stats_t *st;
+  struct statvfs nvfs;
+  tvh_fsid_t nfsid;
+
+  if (path == NULL || path[0] == '\0')
+    return -1;
+  tvh_mutex_lock(&dvr_disk_space_mutex);
+  LIST_FOREACH(st, &dvr_vfs_stats_list, link)
+    if (strcmp(st->path, path) == 0)
+      break;
+  if (st && st->updated) {
+    st->last_used = mclk();
+    if (vfs)
+      *vfs = st->vfs;
+    *fsid = st->fsid;
+    tvh_mutex_unlock(&dvr_disk_space_mutex);
+    return 0;
+  }
+  tvh_mutex_unlock(&dvr_disk_space_mutex);
+  if (tvh_vfs_fsid_build(path, &nvfs, &nfsid))
+    return -1;
+  tvh_mutex_lock(&dvr_disk_space_mutex);
+  LIST_FOREACH(st, &dvr_vfs_stats_list, link)
+    if (strcmp(st->path, path) == 0)
+      break;
+  if (st == NULL) {
+    st = calloc(1, sizeof(*st));
+    st->path = strdup(path);
+    LIST_INSERT_HEAD(&dvr_vfs_stats_list, st, link);
+  }
+  st->fsid = nfsid;
+  st->vfs = nvfs;
+  st->updated = st->last_used = mclk();
+  if (vfs)
+    *vfs = nvfs;
+  *fsid = nfsid;
+  tvh_mutex_unlock(&dvr_disk_space_mutex);
+  return 0;
+}
+
+/*
+ * Apply a known free space change (bytes freed if positive) to the
+ * snapshot, so decisions between two refreshes see the delta
+ */
+static void
+dvr_vfs_stats_adjust(tvh_fsid_t *fsid, int64_t delta)
+{
+  dvr_vfs_stats_t *st;
+  int64_t blocks;
+
+  tvh_mutex_lock(&dvr_disk_space_mutex);
+  LIST_FOREACH(st, &dvr_vfs_stats_list, link)
+    if (st->updated && tvh_vfs_fsid_match(&st->fsid, fsid)) {
+      blocks = st->vfs.f_frsize ? delta / (int64_t)st->vfs.f_frsize : 0;
+      if (blocks < 0 && -blocks > (int64_t)st->vfs.f_bavail)
+        st->vfs.f_bavail = 0;
+      else
+        st->vfs.f_bavail += blocks;
+    }
+  tvh_mutex_unlock(&dvr_disk_space_mutex);
+}
+
+/*
+ * Refresh all cached snapshots; called from the tasklet so the
+ * statvfs calls never run with global_lock held
+ */
+static void
+dvr_vfs_stats_refresh(void)
+{
+  dvr_vfs_stats_t *st, *next;
+  struct statvfs vfs;
+  tvh_fsid_t fsid;
+
+  tvh_mutex_lock(&dvr_disk_space_mutex);
+  for (st = LIST_FIRST(&dvr_vfs_stats_list); st; st = next) {
+    next = LIST_NEXT(st, link);
+    /* forget paths nobody asked about lately (e.g. changed storage) */
+    if (st->last_used + sec2mono(600) < mclk()) {
+      LIST_REMOVE(st, link);
+      free(st->path);
+      free(st);
+      continue;
+    }
+    tvh_mutex_unlock(&dvr_disk_space_mutex);
+    if (tvh_vfs_fsid_build(st->path, &vfs, &fsid) == 0) {
+      tvh_mutex_lock(&dvr_disk_space_mutex);
+      st->fsid = fsid;
+      st->vfs = vfs;
+      st->updated = mclk();
+    } else {
+      tvh_mutex_lock(&dvr_disk_space_mutex);
+    }
+  }
+  tvh_mutex_unlock(&dvr_disk_space_mutex);
+}
+
+/*
+ * Fetch the filesystem id stored with the recorded files, avoiding
+ * a statvfs on the file's path
+ */
+static int
+dvr_vfs_entry_fsid(dvr_entry_t *de, tvh_fsid_t *fsid)
+{
+  htsmsg_field_t *f;
+  htsmsg_t *m;
+  int64_t v;
+  const char *s;
+
+  if (de->de_files == NULL)
+    return -1;
+  HTSMSG_FOREACH(f, de->de_files)
+    if ((m = htsmsg_field_get_map(f)) != NULL) {
+      if (!htsmsg_get_s64(m, "fsid", &v)) {
+        fsid->fsid = v;
+        fsid->id[0] = '\0';
+        return 0;
+      } else if ((s = htsmsg_get_str(m, "fsid0")) != NULL) {
+        fsid->fsid = 0;
+        strlcpy(fsid->id, s, sizeof(fsid->id));
+        return 0;
+      }
+    }
+  return -1;
+}
+
 /*
  *
  */
@@ -168,6 +317,7 @@ dvr_vfs_update_filename(const char *filename, htsmsg_t *fdata)
     if (stat(filename, &st) >= 0 && st.st_size >= 0) {
       htsmsg_set_s64(fdata, "size", st.st_size);
       vfs->used_size += st.st_size;
+      dvr_vfs_stats_adjust(&vfs->fsid, size - st.st_size);
       return st.st_size;
     }
   }
@@ -199,7 +349,7 @@ dvr_disk_space_cleanup(dvr_config_t *cfg, int include_active)
   if (!cfg || !cfg->dvr_enabled)
     return -1;
 
-  if (tvh_vfs_fsid_build(cfg->dvr_storage, &diskdata, &fsid))
+  if (dvr_vfs_cached_stats(cfg->dvr_storage, &diskdata, &fsid))
     return -1;
 
   dvfs = dvr_vfs_find(NULL, &fsid);
@@ -247,7 +397,7 @@ dvr_disk_space_cleanup(dvr_config_t *cfg, int include_active)
       if (dvr_get_filename(de) == NULL || dvr_get_filesize(de, DVR_FILESIZE_TOTAL) <= 0)
         continue;
 
-      if (tvh_vfs_fsid_build(dvr_get_filename(de), NULL, &fsid2))
+      if (dvr_vfs_entry_fsid(de, &fsid2))
         continue;
 
       /* Checking for the same config is useless as it's storage path might be changed meanwhile */
@@ -273,6 +423,7 @@ dvr_disk_space_cleanup(dvr_config_t *cfg, int include_active)
 
       dvr_disk_space_config_lastdelete = mclk();
       dvr_entry_cancel_remove(oldest, 0); /* Remove stored files and mark as "removed" */
+      dvr_vfs_stats_adjust(&fsid, fileSize);
     } else {
       /* Stop active recordings if cleanup is not possible */
       if (loops == 0 && include_active) {
@@ -330,7 +481,7 @@ dvr_disk_space_check()
       continue;
     if (idx < dvr_disk_space_config_idx)
       continue;
-    if (tvh_vfs_fsid_build(cfg->dvr_storage, &diskdata, &fsid))
+    if (dvr_vfs_cached_stats(cfg->dvr_storage, &diskdata, &fsid))
       continue;
 
     dvfs = dvr_vfs_find(NULL, &fsid);
@@ -390,7 +541,7 @@ dvr_get_disk_space_update(const char *path, int locked)
   dvr_vfs_t *dvfs;
   tvh_fsid_t fsid;
 
-  if (tvh_vfs_fsid_build(path, &diskdata, &fsid))
+  if (dvr_vfs_cached_stats(path, &diskdata, &fsid))
     return;
 
   if (!locked)
@@ -415,6 +566,9 @@ dvr_get_disk_space_tcb(void *opaque, int dearmed)
   if (!dearmed) {
     htsmsg_t *m = htsmsg_create_map();
 
+    /* take fresh statvfs snapshots outside global_lock */
+    dvr_vfs_stats_refresh();
+
     /* update disk space from default dvr config */
     dvr_get_disk_space_update((char *)opaque, 0);
     htsmsg_add_s64(m, "freediskspace", dvr_bfree);
@@ -460,7 +614,7 @@ dvr_vfs_rec_start_check(dvr_config_t *cfg)
   lock_assert(&global_lock);
   if (!cfg || !cfg->dvr_enabled)
     return 0;
-  if (tvh_vfs_fsid_build(cfg->dvr_storage, &diskdata, &fsid))
+  if (dvr_vfs_cached_stats(cfg->dvr_storage, &diskdata, &fsid))
     return 0;
 
   availBytes    = diskdata.f_frsize * (int64_t)diskdata.f_bavail;
@@ -491,6 +645,7 @@ void
 dvr_disk_space_boot(void)
 {
   LIST_INIT(&dvrvfs_list);
+  LIST_INIT(&dvr_vfs_stats_list);
 }
 
 /**
@@ -512,6 +667,7 @@ void
 dvr_disk_space_done(void)
 {
   dvr_vfs_t *vfs;
+  dvr_vfs_stats_t *st;
 
   tasklet_disarm(&dvr_disk_space_tasklet);
   tvh_mutex_lock(&global_lock);
@@ -521,6 +677,13 @@ dvr_disk_space_done(void)
     free(vfs);
   }
   tvh_mutex_unlock(&global_lock);
+  tvh_mutex_lock(&dvr_disk_space_mutex);
+  while ((st = LIST_FIRST(&dvr_vfs_stats_list)) != NULL) {
+    LIST_REMOVE(st, link);
+    free(st->path);
+    free(st);
+  }
+  tvh_mutex_unlock(&dvr_disk_space_mutex);
 }
 
 /**
@@ -54,6 +54,10 @@ epg_object_list_t epg_object_updated;
 
 int epg_in_load;
 
+/* Bumped on any object update/removal; lets readers detect stale
+ * cached query results cheaply */
+uint64_t epg_version;
+
 /* Global counter */
 static uint32_t _epg_object_idx    = 0;
 
@@ -95,6 +99,112 @@ static int _ebc_xmltv_cmp ( const void *a, const void *b )
   return strcmp(((epg_broadcast_t*)a)->xmltv_eid, ((epg_broadcast_t*)b)->xmltv_eid);
 }
 
+/* **************************************************************************
+ * Change feed
+ *
+ * A bounded ring of recently changed broadcasts tagged with monotonic
+ * sequence numbers.  External mirrors pull deltas through the API
+ * instead of re-querying guide windows; the "epgFeed" comet message
+ * posted after each update batch tells them when to pull.  A consumer
+ * resuming from a sequence that already fell off the ring is told to
+ * resync (full re-query) instead of silently missing changes.
+ * *************************************************************************/
+
+#define EPG_CHANGEFEED_MAX 4096
+
+typedef struct epg_changefeed_entry {
+  TAILQ_ENTRY(epg_changefeed_entry) ecf_link;
+  uint64_t ecf_seq;
+  uint32_t ecf_id;
+  uint8_t  ecf_delete;
+  char     ecf_channel[UUID_HEX_SIZE];
+} epg_changefeed_entry_t;
+
+static TAILQ_HEAD(,epg_changefeed_entry) epg_changefeed =
+  TAILQ_HEAD_INITIALIZER(epg_changefeed);
+static uint64_t epg_changefeed_seq;
+static int epg_changefeed_count;
+static int epg_changefeed_pending;
+
+uint64_t epg_changefeed_current ( void )
+{
+  return epg_changefeed_seq;
+}
+
+static void
+epg_changefeed_push ( epg_broadcast_t *ebc, int delete )
+{
+  epg_changefeed_entry_t *ecf;
+
+  lock_assert(&global_lock);
+  ecf = malloc(sizeof(*ecf));
+  ecf->ecf_seq = ++epg_changefeed_seq;
+  ecf->ecf_id = ebc->id;
+  ecf->ecf_delete = delete;
+  ecf->ecf_channel[0] = '\0';
+  if (ebc->channel)
+    idnode_uuid_as_str(&ebc->channel->ch_id, ecf->ecf_channel);
+  TAILQ_INSERT_TAIL(&epg_changefeed, ecf, ecf_link);
+  if (++epg_changefeed_count > EPG_CHANGEFEED_MAX) {
+    ecf = TAILQ_FIRST(&epg_changefeed);
+    TAILQ_REMOVE(&epg_changefeed, ecf, ecf_link);
+    free(ecf);
+    epg_changefeed_count--;
+  }
+  epg_changefeed_pending = 1;
+}
+
+/* readers hold the global lock or the EPG read domain */
+htsmsg_t *
+epg_changefeed_get ( uint64_t since, uint32_t limit )
+{
+  epg_changefeed_entry_t *ecf;
+  htsmsg_t *m = htsmsg_create_map(), *l, *e;
+  uint32_t count = 0;
+
+  htsmsg_add_s64(m, "seq", epg_changefeed_seq);
+  if (since > epg_changefeed_seq)
+    goto resync;
+  if (since < epg_changefeed_seq) {
+    ecf = TAILQ_FIRST(&epg_changefeed);
+    if (ecf == NULL || since + 1 < ecf->ecf_seq)
+      goto resync;
+  }
+  l = htsmsg_create_list();
+  TAILQ_FOREACH(ecf, &epg_changefeed, ecf_link) {
+    if (ecf->ecf_seq <= since) continue;
+    if (limit && count >= limit) {
+      htsmsg_add_bool(m, "more", 1);
+      break;
+    }
+    e = htsmsg_create_map();
+    htsmsg_add_s64(e, "seq", ecf->ecf_seq);
+    htsmsg_add_u32(e, "eventId", ecf->ecf_id);
+    htsmsg_add_str(e, "op", ecf->ecf_delete ? "delete" : "update");
+    if (ecf->ecf_channel[0])
+      htsmsg_add_str(e, "channelUuid", ecf->ecf_channel);
+    htsmsg_add_msg(l, NULL, e);
+    count++;
+  }
+  htsmsg_add_msg(m, "entries", l);
+  return m;
+
+resync:
+  htsmsg_add_bool(m, "resync", 1);
+  return m;
+}
+
+void epg_changefeed_done ( void )
+{
+  epg_changefeed_entry_t *ecf;
+
+  while ((ecf = TAILQ_FIRST(&epg_changefeed)) != NULL) {
+    TAILQ_REMOVE(&epg_changefeed, ecf, ecf_link);
+    free(ecf);
+  }
+  epg_changefeed_count = 0;
+}
+
 void epg_updated ( void )
 {
   epg_object_t *eo;
@@ -118,6 +228,16 @@ void epg_updated ( void )
     LIST_REMOVE(eo, up_link);
     eo->_updated = 0;
     eo->_created = 1;
+    if (eo->type == EPG_BROADCAST)
+      epg_changefeed_push((epg_broadcast_t *)eo, 0);
+  }
+
+  /* Kick the change-feed consumers, once per batch */
+  if (epg_changefeed_pending) {
+    htsmsg_t *m = htsmsg_create_map();
+    htsmsg_add_s64(m, "seq", epg_changefeed_seq);
+    notify_by_msg("epgFeed", m, 0, 0);
+    epg_changefeed_pending = 0;
   }
 }
 
@@ -131,6 +251,7 @@ static void _epg_object_destroy
   assert(eo->refcount == 0);
   tvhtrace(LS_EPG, "eo [%p, %u, %d] destroy",
            eo, eo->id, eo->type);
+  epg_version++;
   if (eo->_updated) LIST_REMOVE(eo, up_link);
   RB_REMOVE(epg_id_tree(eo), eo, id_link);
 }
@@ -163,6 +284,7 @@ static void _epg_object_set_updated0 ( void *o )
   epg_object_t *eo = o;
   tvhtrace(LS_EPG, "eo [%p, %u, %d] updated",
            eo, eo->id, eo->type);
+  epg_version++;
   eo->_updated = 1;
   eo->updated  = gclk();
   LIST_INSERT_HEAD(&epg_object_updated, eo, up_link);
@@ -308,8 +430,10 @@ static int FNNAME \
   return 0; \
 }
 
-EPG_OBJECT_SET_FN(_epg_object_set_lang_str, lang_str_t,
-                  lang_str_destroy, lang_str_compare, lang_str_copy)
+/* title/subtitle/summary/description are shared through the interned
+ * string pool - duplicates across broadcasts are stored only once */
+EPG_OBJECT_SET_FN(_epg_object_set_lang_str_interned, lang_str_t,
+                  lang_str_release, lang_str_compare, lang_str_intern)
 EPG_OBJECT_SET_FN(_epg_object_set_string_list, string_list_t,
                   string_list_destroy, string_list_cmp, string_list_copy)
 EPG_OBJECT_SET_FN(_epg_object_set_htsmsg, htsmsg_t,
@@ -867,6 +991,83 @@ void epg_set_broadcast_remove
  * Broadcast
  * *************************************************************************/
 
+/* A 14-day guide holds hundreds of thousands of broadcast objects which
+ * are created and destroyed continuously as the schedule rolls.  Carve
+ * them out of fixed-size slabs instead of individual calloc()s - this
+ * removes the per-object allocator overhead, keeps objects which are
+ * iterated together (grids, autorec matching) densely packed, and lets
+ * a fully drained slab be returned to the system in one piece. */
+
+#define EPG_BROADCAST_SLAB 128
+
+typedef struct epg_broadcast_slab epg_broadcast_slab_t;
+
+typedef struct epg_broadcast_slot {
+  epg_broadcast_slab_t *slab;
+  union {
+    epg_broadcast_t            ebc;
+    struct epg_broadcast_slot *next;   /* free list, valid while unused */
+  } u;
+} epg_broadcast_slot_t;
+
+struct epg_broadcast_slab {
+  LIST_ENTRY(epg_broadcast_slab) link;
+  epg_broadcast_slot_t *free;          /* free slots in this slab */
+  int                   used;
+  epg_broadcast_slot_t  slots[EPG_BROADCAST_SLAB];
+};
+
+static LIST_HEAD(, epg_broadcast_slab) epg_broadcast_slabs_partial;
+static LIST_HEAD(, epg_broadcast_slab) epg_broadcast_slabs_full;
+
+static epg_broadcast_t *_epg_broadcast_alloc ( void )
+{
+  epg_broadcast_slab_t *s;
+  epg_broadcast_slot_t *slot;
+  int i;
+
+  lock_assert(&global_lock);
+  s = LIST_FIRST(&epg_broadcast_slabs_partial);
+  if (s == NULL) {
+    s = calloc(1, sizeof(*s));
+    for (i = EPG_BROADCAST_SLAB - 1; i >= 0; i--) {
+      s->slots[i].slab   = s;
+      s->slots[i].u.next = s->free;
+      s->free = &s->slots[i];
+    }
+    LIST_INSERT_HEAD(&epg_broadcast_slabs_partial, s, link);
+  }
+  slot = s->free;
+  s->free = slot->u.next;
+  s->used++;
+  if (s->free == NULL) {
+    LIST_REMOVE(s, link);
+    LIST_INSERT_HEAD(&epg_broadcast_slabs_full, s, link);
+  }
+  memset(&slot->u.ebc, 0, sizeof(slot->u.ebc));
+  return &slot->u.ebc;
+}
+
+static void _epg_broadcast_free ( epg_broadcast_t *ebc )
+{
+  epg_broadcast_slot_t *slot =
+    (epg_broadcast_slot_t *)((char *)ebc - offsetof(epg_broadcast_slot_t, u));
+  epg_broadcast_slab_t *s = slot->slab;
+
+  lock_assert(&global_lock);
+  if (s->free == NULL) {
+    LIST_REMOVE(s, link);
+    LIST_INSERT_HEAD(&epg_broadcast_slabs_partial, s, link);
+  }
+  slot->u.next = s->free;
+  s->free = slot;
+  if (--s->used == 0) {
+    /* the guide rolled past every event in this slab - hand it back */
+    LIST_REMOVE(s, link);
+    free(s);
+  }
+}
+
 static void _epg_broadcast_destroy ( void *eo )
 {
   epg_broadcast_t *ebc = eo;
@@ -877,11 +1078,13 @@ static void _epg_broadcast_destroy ( void *eo )
     htsp_event_delete(ebc);
     snprintf(id, sizeof(id), "%u", ebc->id);
     notify_delayed(id, "epg", "delete");
+    if (tvheadend_is_running())
+      epg_changefeed_push(ebc, 1);
   }
-  if (ebc->title)       lang_str_destroy(ebc->title);
-  if (ebc->subtitle)    lang_str_destroy(ebc->subtitle);
-  if (ebc->summary)     lang_str_destroy(ebc->summary);
-  if (ebc->description) lang_str_destroy(ebc->description);
+  if (ebc->title)       lang_str_release(ebc->title);
+  if (ebc->subtitle)    lang_str_release(ebc->subtitle);
+  if (ebc->summary)     lang_str_release(ebc->summary);
+  if (ebc->description) lang_str_release(ebc->description);
   while ((eg = LIST_FIRST(&ebc->genre))) {
     LIST_REMOVE(eg, link);
     free(eg);
@@ -897,7 +1100,7 @@ static void _epg_broadcast_destroy ( void *eo )
   epg_set_broadcast_remove(&epg_episodelinks, ebc->episodelink, ebc);
   _epg_object_destroy(eo, NULL);
   assert(LIST_EMPTY(&ebc->dvr_entries));
-  free(ebc);
+  _epg_broadcast_free(ebc);
 }
 
 static void _epg_broadcast_update_running ( epg_broadcast_t *broadcast )
@@ -959,7 +1162,7 @@ static epg_broadcast_t **_epg_broadcast_skel ( void )
 {
   static epg_broadcast_t *skel = NULL;
   if (!skel) {
-    skel = calloc(1, sizeof(epg_broadcast_t));
+    skel = _epg_broadcast_alloc();
     skel->type = EPG_BROADCAST;
     skel->ops  = &_epg_broadcast_ops;
   }
@@ -1315,32 +1518,32 @@ int epg_broadcast_set_title
   ( epg_broadcast_t *b, const lang_str_t *title, epg_changes_t *changed )
 {
   if (!b) return 0;
-  return _epg_object_set_lang_str(b, &b->title, title,
-                                  changed, EPG_CHANGED_TITLE);
+  return _epg_object_set_lang_str_interned(b, &b->title, title,
+                                           changed, EPG_CHANGED_TITLE);
 }
 
 int epg_broadcast_set_subtitle
   ( epg_broadcast_t *b, const lang_str_t *subtitle, epg_changes_t *changed )
 {
   if (!b) return 0;
-  return _epg_object_set_lang_str(b, &b->subtitle,
-                                  subtitle, changed, EPG_CHANGED_SUBTITLE);
+  return _epg_object_set_lang_str_interned(b, &b->subtitle, subtitle,
+                                           changed, EPG_CHANGED_SUBTITLE);
 }
 
 int epg_broadcast_set_summary
   ( epg_broadcast_t *b, const lang_str_t *str, epg_changes_t *changed )
 {
   if (!b) return 0;
-  return _epg_object_set_lang_str(b, &b->summary, str,
-                                  changed, EPG_CHANGED_SUMMARY);
+  return _epg_object_set_lang_str_interned(b, &b->summary, str,
+                                           changed, EPG_CHANGED_SUMMARY);
 }
 
 int epg_broadcast_set_description
   ( epg_broadcast_t *b, const lang_str_t *str, epg_changes_t *changed )
 {
   if (!b) return 0;
-  return _epg_object_set_lang_str(b, &b->description, str,
-                                  changed, EPG_CHANGED_DESCRIPTION);
+  return _epg_object_set_lang_str_interned(b, &b->description, str,
+                                           changed, EPG_CHANGED_DESCRIPTION);
 }
 
 int epg_broadcast_set_credits
@@ -2455,6 +2658,12 @@ static void
 _eq_add_channel ( epg_query_t *eq, channel_t *ch )
 {
   epg_broadcast_t *ebc;
+  if (eq->now) {
+    /* the current broadcast is maintained incrementally per channel,
+     * so "what's on now" does not need to walk the schedule tree */
+    _eq_add(eq, ch->ch_epg_now);
+    return;
+  }
   RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link)
     _eq_add(eq, ebc);
 }
@@ -2810,7 +3019,8 @@ void epg_skel_done(void)
   epg_broadcast_t **broad;
 
   broad = _epg_broadcast_skel();
-  free(*broad); *broad = NULL;
+  if (*broad) _epg_broadcast_free(*broad);
+  *broad = NULL;
   assert(RB_FIRST(&epg_serieslinks) == NULL);
   assert(RB_FIRST(&epg_episodelinks) == NULL);
 }
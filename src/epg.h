@@ -538,6 +538,7 @@ typedef struct epg_query {
   int               fulltext;
   int               mergetext;
   int               new_only;
+  int               now;
   char             *channel;
   char             *channel_tag;
   uint32_t          genre_count;
@@ -581,10 +582,20 @@ void epg_query_free(epg_query_t *eq);
  * ***********************************************************************/
 
 void epg_init    (void);
+void epg_init_async (void);
+void epg_init_join  (void);
 void epg_done    (void);
 void epg_skel_done (void);
 void epg_save    (void);
 void epg_save_callback (void *p);
 void epg_updated (void);
 
+/* Change feed - resumable deltas for external guide mirrors */
+uint64_t  epg_changefeed_current ( void );
+htsmsg_t *epg_changefeed_get ( uint64_t since, uint32_t limit );
+void      epg_changefeed_done ( void );
+
+/* Bumped on any EPG object update/removal */
+extern uint64_t epg_version;
+
 #endif /* EPG_H */
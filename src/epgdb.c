@@ -37,6 +37,13 @@
 
 #define EPG_DB_VERSION 3
 #define EPG_DB_ALLOC_STEP (1024*1024)
+#define EPG_DB_DELTA_MAX 24
+
+/* Base snapshot serialization time and journal generations since;
+ * periodic saves append only broadcasts changed after the snapshot
+ * and a full snapshot compacts the journal away */
+static time_t epgdb_snapshot_time;
+static int    epgdb_delta_count;
 
 extern epg_object_tree_t epg_episodes;
 
@@ -115,64 +122,37 @@ static void epg_mmap_sigbus (int sig, siginfo_t *siginfo, void *ptr)
 }
 
 /*
- * Load data
+ * Map and parse one database (or journal) file
  */
-void epg_init ( void )
+static void _epgdb_load_fd ( int fd, int ver, epggrab_stats_t *stats )
 {
-  int fd = -1, r;
+  int r;
   struct stat st;
   size_t remain;
   uint8_t *mem, *rp, *zlib_mem = NULL;
-  epggrab_stats_t stats;
-  int ver = EPG_DB_VERSION;
-  struct sigaction act, oldact;
   char *sect = NULL;
 
-  memoryinfo_register(&epg_memoryinfo_broadcasts);
-
-  /* Find the right file (and version) */
-  while (fd < 0 && ver > 0) {
-    fd = hts_settings_open_file(0, "epgdb.v%d", ver);
-    if (fd > 0) break;
-    ver--;
-  }
-  if ( fd < 0 )
-    fd = hts_settings_open_file(0, "epgdb");
-  if ( fd < 0 ) {
-    tvhdebug(LS_EPGDB, "database does not exist");
-    return;
-  }
-
-  memset (&act, 0, sizeof(act));
-  act.sa_sigaction = epg_mmap_sigbus;
-  act.sa_flags = SA_SIGINFO;
-  if (sigaction(SIGBUS, &act, &oldact)) {
-    tvherror(LS_EPGDB, "failed to install SIGBUS handler");
-    close(fd);
-    return;
-  }
-  
   /* Map file to memory */
   if ( fstat(fd, &st) != 0 ) {
     tvherror(LS_EPGDB, "failed to detect database size");
-    goto end;
+    return;
   }
   if ( !st.st_size ) {
     tvhdebug(LS_EPGDB, "database is empty");
-    goto end;
+    return;
   }
   remain   = st.st_size;
   rp = mem = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
   if ( mem == MAP_FAILED ) {
     tvherror(LS_EPGDB, "failed to mmap database");
-    goto end;
+    return;
   }
 
   if (sigsetjmp(epg_mmap_env, 1)) {
     tvherror(LS_EPGDB, "failed to read from mapped file");
     if (mem)
       munmap(mem, st.st_size);
-    goto end;
+    return;
   }
 
 #if ENABLE_ZLIB
@@ -189,7 +169,6 @@ void epg_init ( void )
   tvhinfo(LS_EPGDB, "parsing %zd bytes", remain);
 
   /* Process */
-  memset(&stats, 0, sizeof(stats));
   while ( remain > 4 ) {
 
     /* Get message length */
@@ -213,7 +192,7 @@ void epg_init ( void )
     /* Process */
     switch (ver) {
       case 3:
-        _epgdb_v3_process(&sect, m, &stats);
+        _epgdb_v3_process(&sect, m, stats);
         break;
       default:
         break;
@@ -224,6 +203,54 @@ void epg_init ( void )
   }
 
   free(sect);
+  munmap(mem, st.st_size);
+  free(zlib_mem);
+}
+
+/*
+ * Load data
+ */
+void epg_init ( void )
+{
+  int fd = -1, jfd;
+  epggrab_stats_t stats;
+  int ver = EPG_DB_VERSION;
+  struct sigaction act, oldact;
+
+  memoryinfo_register(&epg_memoryinfo_broadcasts);
+  lang_str_intern_init();
+
+  /* Find the right file (and version) */
+  while (fd < 0 && ver > 0) {
+    fd = hts_settings_open_file(0, "epgdb.v%d", ver);
+    if (fd > 0) break;
+    ver--;
+  }
+  if ( fd < 0 )
+    fd = hts_settings_open_file(0, "epgdb");
+  if ( fd < 0 ) {
+    tvhdebug(LS_EPGDB, "database does not exist");
+    return;
+  }
+
+  memset (&act, 0, sizeof(act));
+  act.sa_sigaction = epg_mmap_sigbus;
+  act.sa_flags = SA_SIGINFO;
+  if (sigaction(SIGBUS, &act, &oldact)) {
+    tvherror(LS_EPGDB, "failed to install SIGBUS handler");
+    close(fd);
+    return;
+  }
+
+  memset(&stats, 0, sizeof(stats));
+  _epgdb_load_fd(fd, ver, &stats);
+
+  /* Replay the journal appended since the last full snapshot */
+  if (ver == EPG_DB_VERSION &&
+      (jfd = hts_settings_open_file(0, "epgdb.v%d.journal", ver)) >= 0) {
+    _epgdb_load_fd(jfd, ver, &stats);
+    close(jfd);
+  }
 
   if (!stats.config.total) {
     htsmsg_t *m = htsmsg_create_map();
@@ -239,14 +266,45 @@ void epg_init ( void )
   tvhinfo(LS_EPGDB, "  config     %d", stats.config.total);
   tvhinfo(LS_EPGDB, "  broadcasts %d", stats.broadcasts.total);
 
-  /* Close file */
-  munmap(mem, st.st_size);
-  free(zlib_mem);
-end:
   sigaction(SIGBUS, &oldact, NULL);
   close(fd);
 }
 
+/*
+ * Background load - epg_init() can take seconds on a large database, so
+ * defer it to a thread which queues behind the startup global_lock hold.
+ * The listeners are already reachable by the time the load begins.
+ */
+static pthread_t epg_init_tid;
+static int epg_init_async_running;
+
+static void *epg_init_thread ( void *aux )
+{
+  tvh_mutex_lock(&global_lock);
+  if (tvheadend_is_running()) {
+    epg_in_load = 1;
+    epg_init();
+    epg_updated();
+    epg_in_load = 0;
+  }
+  tvh_mutex_unlock(&global_lock);
+  return NULL;
+}
+
+void epg_init_async ( void )
+{
+  tvh_thread_create(&epg_init_tid, NULL, epg_init_thread, NULL, "epgload");
+  epg_init_async_running = 1;
+}
+
+void epg_init_join ( void )
+{
+  if (epg_init_async_running) {
+    pthread_join(epg_init_tid, NULL);
+    epg_init_async_running = 0;
+  }
+}
+
 void epg_done ( void )
 {
   channel_t *ch;
@@ -255,6 +313,7 @@ void epg_done ( void )
   CHANNEL_FOREACH(ch)
     epg_channel_unlink(ch);
   epg_skel_done();
+  epg_changefeed_done();
   memoryinfo_unregister(&epg_memoryinfo_broadcasts);
   tvh_mutex_unlock(&global_lock);
 }
@@ -337,16 +396,112 @@ static void epg_save_tsk_callback ( void *p, int dearmed )
     tvhinfo(LS_EPGDB, "stored (size %zd)", orig);
     if (rename(tmppath, path))
       tvherror(LS_EPGDB, "unable to rename file %s to %s", tmppath, path);
+    /* the snapshot compacts away the journal */
+    if (!hts_settings_buildpath(tmppath, sizeof(tmppath),
+                                "epgdb.v%d.journal", EPG_DB_VERSION) &&
+        remove(tmppath) && errno != ENOENT)
+      tvherror(LS_EPGDB, "unable to remove file %s", tmppath);
+  }
+
+done:
+  sbuf_free(sb);
+  free(sb);
+}
+
+static void epg_save_delta_tsk_callback ( void *p, int dearmed )
+{
+  char path[PATH_MAX];
+  sbuf_t *sb = p;
+  int fd, r;
+
+  tvhinfo(LS_EPGDB, "delta save start");
+  if (hts_settings_buildpath(path, sizeof(path),
+                             "epgdb.v%d.journal", EPG_DB_VERSION)) {
+    tvhinfo(LS_EPGDB, "No config dir, not saving EPG");
+    goto done;
+  }
+  if (hts_settings_makedirs(path)) {
+    tvherror(LS_EPGDB, "Failed to create directories for %s", path);
+    goto done;
   }
 
+  fd = tvh_open(path, O_CREAT | O_APPEND | O_WRONLY, S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    tvherror(LS_EPGDB, "unable to open epgdb journal file");
+    goto done;
+  }
+
+  r = tvh_write(fd, sb->sb_data, sb->sb_ptr);
+  close(fd);
+  if (r)
+    tvherror(LS_EPGDB, "journal write error (size %d)", sb->sb_ptr);
+  else
+    tvhinfo(LS_EPGDB, "journal appended (size %d)", sb->sb_ptr);
+
 done:
   sbuf_free(sb);
   free(sb);
 }
 
+/*
+ * Append only the broadcasts changed since the last full snapshot
+ */
+static void epg_save_delta ( void )
+{
+  sbuf_t *sb = malloc(sizeof(*sb));
+  epg_broadcast_t *ebc;
+  channel_t *ch;
+  epggrab_stats_t stats;
+  time_t since = epgdb_snapshot_time;
+  extern gtimer_t epggrab_save_timer;
+
+  if (!sb)
+    return;
+
+  tvhinfo(LS_EPGDB, "delta snapshot start");
+
+  sbuf_init_fixed(sb, EPG_DB_ALLOC_STEP);
+
+  if (epggrab_conf.epgdb_periodicsave)
+    gtimer_arm_rel(&epggrab_save_timer, epg_save_callback, NULL,
+                   epggrab_conf.epgdb_periodicsave * 3600);
+
+  memset(&stats, 0, sizeof(stats));
+  if ( _epg_write_sect(sb, "config") ) goto error;
+  if (_epg_write(sb, epg_config_serialize())) goto error;
+  if ( _epg_write_sect(sb, "broadcasts") ) goto error;
+  CHANNEL_FOREACH(ch) {
+    if (ch->ch_epg_parent) continue;
+    RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link) {
+      if (ebc->updated < since) continue;
+      if (_epg_write(sb, epg_broadcast_serialize(ebc))) goto error;
+      stats.broadcasts.total++;
+    }
+  }
+  epgdb_delta_count++;
+
+  tasklet_arm_alloc(epg_save_delta_tsk_callback, sb);
+
+  /* Stats */
+  tvhinfo(LS_EPGDB, "queued to append (size %d)", sb->sb_ptr);
+  tvhinfo(LS_EPGDB, "  broadcasts %d", stats.broadcasts.total);
+
+  return;
+
+error:
+  tvherror(LS_EPGDB, "failed to store epg delta to disk");
+  sbuf_free(sb);
+  free(sb);
+}
+
 void epg_save_callback ( void *p )
 {
-  epg_save();
+  /* periodic saves only append changes; compact with a full
+   * snapshot once the journal has grown for too long */
+  if (epgdb_snapshot_time && epgdb_delta_count < EPG_DB_DELTA_MAX)
+    epg_save_delta();
+  else
+    epg_save();
 }
 
 void epg_save ( void )
@@ -364,6 +519,10 @@ void epg_save ( void )
 
   sbuf_init_fixed(sb, EPG_DB_ALLOC_STEP);
 
+  /* anything changed from now on goes into the next delta */
+  epgdb_snapshot_time = gclk();
+  epgdb_delta_count = 0;
+
   if (epggrab_conf.epgdb_periodicsave)
     gtimer_arm_rel(&epggrab_save_timer, epg_save_callback, NULL,
                    epggrab_conf.epgdb_periodicsave * 3600);
@@ -391,6 +550,7 @@ void epg_save ( void )
 error:
   tvherror(LS_EPGDB, "failed to store epg to disk");
   hts_settings_remove("epgdb.v%d", EPG_DB_VERSION);
+  epgdb_snapshot_time = 0;
   sbuf_free(sb);
   free(sb);
 }
@@ -69,10 +69,25 @@ static void _epggrab_module_grab ( epggrab_module_int_t *mod )
 {
   int64_t tm1, tm2;
   htsmsg_t *data;
+  char *cdata;
 
   if (!mod->enabled)
     return;
 
+  /* Stream the raw data straight into the parser */
+  if (mod->parse_stream) {
+    tm1 = getfastmonoclock();
+    cdata = mod->grab(mod);
+    tm2 = getfastmonoclock() + (MONOCLOCK_RESOLUTION / 2);
+    if (cdata) {
+      tvhinfo(mod->subsys, "%s: grab took %"PRId64" seconds", mod->id, mono2sec(tm2 - tm1));
+      epggrab_module_parse_stream(mod, cdata);
+    } else {
+      tvhwarn(mod->subsys, "%s: grab returned no data", mod->id);
+    }
+    return;
+  }
+
   /* Grab */
   tm1 = getfastmonoclock();
   data = mod->trans(mod, mod->grab(mod));
@@ -211,6 +211,11 @@ struct epggrab_module_int
   char*     (*grab)   ( void *mod );
   htsmsg_t* (*trans)  ( void *mod, char *data );
   int       (*parse)  ( void *mod, htsmsg_t *data, epggrab_stats_t *stat );
+
+  /* Optional streaming parser, consumes the raw grabber output directly
+   * (takes ownership) instead of going through trans/parse and building
+   * a DOM of the whole document */
+  int       (*parse_stream) ( void *mod, char *data, epggrab_stats_t *stat );
 };
 
 /*
@@ -378,6 +383,7 @@ int epggrab_activate_module            ( epggrab_module_t *mod, int activate );
 void epggrab_ota_set_cron              ( void );
 void epggrab_ota_set_genre_translation ( void );
 void epggrab_ota_trigger               ( int secs );
+void epggrab_ota_pause                 ( int on );
 void epggrab_rerun_internal            ( void );
 
 /*
@@ -369,6 +369,13 @@ epggrab_module_t *epggrab_module_create
   return skel;
 }
 
+/*
+ * Stats / save handling shared by the DOM and streaming parsers
+ */
+static void epggrab_module_parse_done
+  ( epggrab_module_int_t *mod, epggrab_stats_t *stats,
+    int64_t tm1, int64_t tm2, int save );
+
 /*
  * Run the parse
  */
@@ -386,6 +393,34 @@ void epggrab_module_parse( void *m, htsmsg_t *data )
   tm2 = getfastmonoclock();
   htsmsg_destroy(data);
 
+  epggrab_module_parse_done(mod, &stats, tm1, tm2, save);
+}
+
+/*
+ * Run the streaming parse (raw grabber output, ownership passed)
+ */
+void epggrab_module_parse_stream( void *m, char *data )
+{
+  int64_t tm1, tm2;
+  int save = 0;
+  epggrab_stats_t stats;
+  epggrab_module_int_t *mod = m;
+
+  /* Parse */
+  memset(&stats, 0, sizeof(stats));
+  tm1 = getfastmonoclock();
+  save |= mod->parse_stream(mod, data, &stats);
+  tm2 = getfastmonoclock();
+
+  epggrab_module_parse_done(mod, &stats, tm1, tm2, save);
+}
+
+static void epggrab_module_parse_done
+  ( epggrab_module_int_t *mod, epggrab_stats_t *statsp,
+    int64_t tm1, int64_t tm2, int save )
+{
+  epggrab_stats_t stats = *statsp;
+
   /* Debug stats */
   tvhinfo(mod->subsys, "%s: parse took %"PRId64" seconds", mod->id, mono2sec(tm2 - tm1));
   tvhinfo(mod->subsys, "%s:  channels   tot=%5d new=%5d mod=%5d",
@@ -577,6 +612,15 @@ static void _epggrab_socket_handler ( epggrab_module_ext_t *mod, int s )
   /* Grab/Translate */
   time(&tm1);
   outlen = file_readall(s, &outbuf);
+
+  /* Stream the raw data straight into the parser */
+  if (outlen && mod->parse_stream) {
+    time(&tm2);
+    tvhinfo(mod->subsys, "%s: grab took %"PRItime_t" seconds", mod->id, tm2 - tm1);
+    epggrab_module_parse_stream(mod, outbuf);
+    return;
+  }
+
   if (outlen) data = mod->trans(mod, outbuf);
   time(&tm2);
 
@@ -76,6 +76,18 @@ typedef struct eit_private
 #define EIT_HACK_EXTRAMUXLOOKUP     (1<<1)
 #define EIT_HACK_SVCNETLOOKUP       (1<<2)
 
+/* Direct-mapped section dedup cache (hangs off map->om_opaque, so it is
+ * per mux and only touched by that mux's input thread); a repeated
+ * carousel section with unchanged payload is dropped before any event
+ * parsing or queueing */
+#define EIT_SECT_CACHE_SIZE 1024 /* entries, power of two */
+
+typedef struct eit_sect_cache_entry
+{
+  uint64_t key;                        ///< tableid/section/onid/extraid
+  uint32_t crc;                        ///< payload CRC32
+} eit_sect_cache_entry_t;
+
 /* Queued data structure */
 typedef struct eit_data
 {
@@ -1292,6 +1304,25 @@ svc_ok:
   len -= 11;
   ptr += 11;
   if (len >= 12) {
+    eit_sect_cache_entry_t *sce;
+    uint64_t skey;
+    uint32_t crc;
+
+    /* Skip parsing when the carousel repeats an unchanged section */
+    if (map->om_opaque == NULL)
+      map->om_opaque = calloc(EIT_SECT_CACHE_SIZE,
+                              sizeof(eit_sect_cache_entry_t));
+    skey = ((uint64_t)tableid << 56) | ((uint64_t)sect << 48) |
+           ((uint64_t)onid << 32) | extraid;
+    crc = tvh_crc32(ptr, len, 0xffffffff);
+    sce = (eit_sect_cache_entry_t *)map->om_opaque +
+          ((uint32_t)(skey ^ (skey >> 17) ^ (skey >> 41)) &
+           (EIT_SECT_CACHE_SIZE - 1));
+    if (sce->key == skey && sce->crc == crc)
+      goto done;
+    sce->key = skey;
+    sce->crc = crc;
+
     cridauth = svc->s_dvb_cridauth;
     if (!cridauth)
       cridauth = svc->s_dvb_mux->mm_crid_authority;
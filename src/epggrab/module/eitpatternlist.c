@@ -54,6 +54,107 @@ static char *get_languages_string(htsmsg_field_t *field)
   return NULL;
 }
 
+static void prefilter_flush ( char *best, size_t *bestlen,
+                              const char *run, size_t runlen )
+{
+  if (runlen > *bestlen) {
+    memcpy(best, run, runlen);
+    *bestlen = runlen;
+  }
+}
+
+/* Extract a literal substring which must occur in any text the pattern
+ * can match, so the (much more expensive) regex engine is only entered
+ * when a plain substring search succeeds first.  The walk is
+ * conservative: alternation gives up completely, quantifiers drop the
+ * optional character, and only top-level literals are collected.
+ * Returns NULL when no useful mandatory literal can be deduced. */
+static char *eit_pattern_prefilter ( const char *text, int flags )
+{
+  char best[MAX_TEXT_LEN], run[MAX_TEXT_LEN], c, *r;
+  size_t bestlen = 0, runlen = 0;
+  int depth = 0;
+  const char *s;
+
+  if (flags & TVHREGEX_CASELESS)
+    return NULL;
+  for (s = text; *s; s++) {
+    c = *s;
+    switch (c) {
+    case '|':
+      /* an alternate branch may match without any collected literal */
+      return NULL;
+    case '\\':
+      if (*++s == '\0')
+        return NULL;
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case '[':
+      s++;
+      if (*s == '^') s++;
+      if (*s == ']') s++;
+      while (*s && *s != ']') {
+        if (*s == '\\' && s[1]) s++;
+        s++;
+      }
+      if (*s == '\0')
+        return NULL;
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case '(':
+      depth++;
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case ')':
+      if (depth > 0) depth--;
+      runlen = 0;
+      break;
+    case '*':
+    case '?':
+      /* the preceding character is optional */
+      if (runlen > 0) runlen--;
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case '{':
+      if (runlen > 0) runlen--;
+      while (*s && *s != '}') s++;
+      if (*s == '\0')
+        return NULL;
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case '+':
+      /* mandatory at least once, but repeats break the run after it */
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    case '^':
+    case '$':
+    case '.':
+    case '}':
+      prefilter_flush(best, &bestlen, run, runlen);
+      runlen = 0;
+      break;
+    default:
+      if (depth == 0 && runlen < sizeof(run))
+        run[runlen++] = c;
+      break;
+    }
+  }
+  prefilter_flush(best, &bestlen, run, runlen);
+  /* too short to reject anything worthwhile */
+  if (bestlen < 3)
+    return NULL;
+  r = malloc(bestlen + 1);
+  memcpy(r, best, bestlen);
+  r[bestlen] = '\0';
+  return r;
+}
+
 void eit_pattern_compile_list ( eit_pattern_list_t *list, htsmsg_t *l, int flags )
 {
   eit_pattern_t *pattern;
@@ -86,7 +187,9 @@ void eit_pattern_compile_list ( eit_pattern_list_t *list, htsmsg_t *l, int flags
       free(pattern->text);
       free(pattern);
     } else {
-      tvhtrace(LS_EPGGRAB, "compiled pattern \"%s\", filter %d", pattern->text, pattern->filter);
+      pattern->prefilter = eit_pattern_prefilter(pattern->text, flags);
+      tvhtrace(LS_EPGGRAB, "compiled pattern \"%s\", filter %d, prefilter \"%s\"",
+               pattern->text, pattern->filter, pattern->prefilter ?: "");
       TAILQ_INSERT_TAIL(list, pattern, p_links);
     }
   }
@@ -136,6 +239,9 @@ void *eit_pattern_apply_list(char *buf, size_t size_buf, const char *text, const
         continue;
       }
     }
+    /* cheap reject before entering the regex engine */
+    if (p->prefilter && strstr(text, p->prefilter) == NULL)
+      continue;
     if (!regex_match(&p->compiled, text) &&
         !regex_match_substring(&p->compiled, 1, buf, size_buf)) {
       for (matchno = 2; ; ++matchno) {
@@ -166,6 +272,7 @@ void eit_pattern_free_list ( eit_pattern_list_t *l )
     TAILQ_REMOVE(l, p, p_links);
     free(p->langs);
     free(p->text);
+    free(p->prefilter);
     regex_free(&p->compiled);
     free(p);
   }
@@ -28,6 +28,7 @@ typedef struct eit_pattern
   tvh_regex_t                 compiled;
   int                         filter;
   char                        *langs;
+  char                        *prefilter; /* mandatory literal, may be NULL */
   TAILQ_ENTRY(eit_pattern)    p_links;
 } eit_pattern_t;
 
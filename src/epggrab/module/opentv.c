@@ -149,6 +149,21 @@ typedef struct opentv_entry {
   opentv_event_t          event;
 } opentv_entry_t;
 
+/*
+ * Seen-section cache, direct-mapped by a hash of (tableid, section,
+ * channel, mjd) with the payload CRC as value. The carousel re-versions
+ * sections many times inside the scan window, which defeats the version
+ * check in dvb_table_begin(); sections whose payload is unchanged are
+ * dropped here without being queued and huffman-decoded again. The cache
+ * lives on the scan status and is only touched by the mux input thread.
+ */
+#define OPENTV_SECT_CACHE_SIZE 1024
+
+typedef struct opentv_sect_cache_entry {
+  uint64_t key;
+  uint32_t crc;
+} opentv_sect_cache_entry_t;
+
 /* Scan status */
 struct opentv_status
 {
@@ -159,6 +174,7 @@ struct opentv_status
   int64_t                 os_titles_start;
   int64_t                 os_summaries_start;
   RB_HEAD(, opentv_entry) os_entries;
+  opentv_sect_cache_entry_t *os_sect_cache;
 };
 
 static void opentv_remove_entry(opentv_status_t *sta, opentv_entry_t *entry);
@@ -175,6 +191,7 @@ opentv_status_destroy ( mpegts_table_t *mt )
     while ((entry = RB_FIRST(&st->os_entries)) != NULL)
       opentv_remove_entry(st, entry);
     st->os_mod->sta = NULL;
+    free(st->os_sect_cache);
     free(st);
   }
 }
@@ -657,8 +674,11 @@ opentv_table_callback
   ( mpegts_table_t *mt, const uint8_t *buf, int len, int tableid )
 {
   int r = 1;
-  int sect, last, ver;
+  int sect, last, ver, mjd0;
+  uint64_t skey;
+  uint32_t crc;
   opentv_data_t od;
+  opentv_sect_cache_entry_t *sce;
   mpegts_psi_table_state_t *st;
   opentv_status_t *sta;
   opentv_module_t *mod;
@@ -676,8 +696,8 @@ opentv_table_callback
 
   /* Extra ID */
   od.cid = ((int)buf[0] << 8) | buf[1];
-  od.mjd = ((int)buf[5] << 8) | buf[6];
-  od.mjd = (od.mjd - 40587) * 86400;
+  mjd0   = ((int)buf[5] << 8) | buf[6];
+  od.mjd = (mjd0 - 40587) * 86400;
 
   /* Statistics */
   ths = mpegts_mux_find_subscription_by_name(mt->mt_mux, "epggrab");
@@ -693,10 +713,26 @@ opentv_table_callback
                       &st, &sect, &last, &ver, 0);
   if (r != 1) goto done;
 
+  /* Drop re-versioned sections whose payload did not change */
+  if (sta->os_sect_cache == NULL)
+    sta->os_sect_cache = calloc(OPENTV_SECT_CACHE_SIZE,
+                                sizeof(opentv_sect_cache_entry_t));
+  skey = ((uint64_t)tableid << 40) | ((uint64_t)sect << 32) |
+         ((uint64_t)od.cid << 16) | mjd0;
+  crc  = tvh_crc32(buf, len, 0xffffffff);
+  sce  = sta->os_sect_cache +
+         ((uint32_t)(skey ^ (skey >> 13) ^ (skey >> 29)) &
+          (OPENTV_SECT_CACHE_SIZE - 1));
+  if (sce->key == skey && sce->crc == crc)
+    goto end;
+  sce->key = skey;
+  sce->crc = crc;
+
   /* Process */
   epggrab_queue_data((epggrab_module_t *)mod, &od, sizeof(od), buf, len);
 
   /* End */
+end:
   r = dvb_table_end((mpegts_psi_table_t *)mt, st, sect);
 
   /* Complete */
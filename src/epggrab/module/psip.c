@@ -45,6 +45,18 @@ typedef struct psip_table {
   uint16_t                pt_type; /* EIT/ETT table type */
 } psip_table_t;
 
+/* ETT sections cannot use the generic version cache (the version is
+ * reset after each section - see _psip_ett_callback), so remember the
+ * payload CRC of the last applied text per source/event and skip the
+ * multiple-string decode when the carousel repeats unchanged data */
+typedef struct psip_ett_crc {
+  RB_ENTRY(psip_ett_crc)  pec_link;
+  uint32_t                pec_key; /* sourceid << 14 | eventid */
+  uint32_t                pec_crc;
+} psip_ett_crc_t;
+
+#define PSIP_ETT_CRC_LIMIT 8192
+
 typedef struct psip_status {
   epggrab_module_ota_t    *ps_mod;
   epggrab_ota_map_t       *ps_map;
@@ -52,8 +64,64 @@ typedef struct psip_status {
   epggrab_ota_mux_t       *ps_ota;
   mpegts_mux_t            *ps_mm;
   TAILQ_HEAD(, psip_table) ps_tables;
+  RB_HEAD(, psip_ett_crc)  ps_ett_crcs;
+  int                      ps_ett_crc_count;
 } psip_status_t;
 
+static int
+psip_ett_crc_cmp ( void *a, void *b )
+{
+  return (int64_t)((psip_ett_crc_t *)a)->pec_key -
+         (int64_t)((psip_ett_crc_t *)b)->pec_key;
+}
+
+static void
+psip_ett_crc_flush ( psip_status_t *ps )
+{
+  psip_ett_crc_t *pec;
+
+  while ((pec = RB_FIRST(&ps->ps_ett_crcs)) != NULL) {
+    RB_REMOVE(&ps->ps_ett_crcs, pec, pec_link);
+    free(pec);
+  }
+  ps->ps_ett_crc_count = 0;
+}
+
+/* Return 1 when the applied text for this source/event is unchanged */
+static int
+psip_ett_crc_check ( psip_status_t *ps, uint32_t sourceid, uint32_t eventid,
+                     uint32_t crc )
+{
+  psip_ett_crc_t *pec, skel;
+
+  skel.pec_key = sourceid << 14 | eventid;
+  pec = RB_FIND(&ps->ps_ett_crcs, &skel, pec_link, psip_ett_crc_cmp);
+  return pec && pec->pec_crc == crc;
+}
+
+/* Remember the applied text - only call once the description really
+ * reached a broadcast, so a not-yet-known event is retried later */
+static void
+psip_ett_crc_store ( psip_status_t *ps, uint32_t sourceid, uint32_t eventid,
+                     uint32_t crc )
+{
+  psip_ett_crc_t *pec, skel;
+
+  skel.pec_key = sourceid << 14 | eventid;
+  pec = RB_FIND(&ps->ps_ett_crcs, &skel, pec_link, psip_ett_crc_cmp);
+  if (pec) {
+    pec->pec_crc = crc;
+    return;
+  }
+  if (ps->ps_ett_crc_count >= PSIP_ETT_CRC_LIMIT)
+    psip_ett_crc_flush(ps);
+  pec = malloc(sizeof(*pec));
+  pec->pec_key = skel.pec_key;
+  pec->pec_crc = crc;
+  RB_INSERT_SORTED(&ps->ps_ett_crcs, pec, pec_link, psip_ett_crc_cmp);
+  ps->ps_ett_crc_count++;
+}
+
 static void
 psip_status_destroy ( mpegts_table_t *mt )
 {
@@ -68,6 +136,7 @@ psip_status_destroy ( mpegts_table_t *mt )
       TAILQ_REMOVE(&st->ps_tables, pt, pt_link);
       free(pt);
     }
+    psip_ett_crc_flush(st);
     free(st);
   } else {
     TAILQ_FOREACH(pt, &st->ps_tables, pt_link)
@@ -184,8 +253,8 @@ psip_reschedule_tables(psip_status_t *ps)
  * ***********************************************************************/
 
 static int
-_psip_eit_callback_channel
-  (psip_status_t *ps, channel_t *ch, const uint8_t *ptr, int len, int count)
+_psip_eit_callback_svc
+  (psip_status_t *ps, mpegts_service_t *svc, const uint8_t *ptr, int len, int count)
 {
   uint16_t eventid;
   uint32_t starttime, length;
@@ -197,6 +266,8 @@ _psip_eit_callback_channel
   lang_str_t *title;
   epg_changes_t changes2;
   epggrab_module_t *mod = (epggrab_module_t *)ps->ps_mod;
+  idnode_list_mapping_t *ilm;
+  channel_t *ch;
   int etmlocation;
 
   for (i = 0; len >= 12 && i < count; len -= size, ptr += size, i++) {
@@ -216,31 +287,36 @@ _psip_eit_callback_channel
 
     if (size > len) break;
 
-    if (epg_channel_ignore_broadcast(ch, start)) continue;
-
+    /* decode the multiple-string structure once per event,
+     * not once per mapped channel */
     title = atsc_get_string(ptr+10, titlelen);
     if (title == NULL) continue;
 
-    tvhtrace(LS_PSIP, "  %03d: [%s] eventid 0x%04x at %"PRItime_t", duration %d, etmlocation %x, title: '%s' (%d bytes)",
-             i, ch ? channel_get_name(ch, channel_blank_name) : "(null)",
-             eventid, start, length, etmlocation,
-             lang_str_get(title, NULL), titlelen);
+    LIST_FOREACH(ilm, &svc->s_channels, ilm_in1_link) {
+      ch = (channel_t *)ilm->ilm_in2;
+      if (!ch->ch_enabled || ch->ch_epg_parent) continue;
+      if (epg_channel_ignore_broadcast(ch, start)) continue;
 
-    save2 = changes2 = 0;
+      tvhtrace(LS_PSIP, "  %03d: [%s] eventid 0x%04x at %"PRItime_t", duration %d, etmlocation %x, title: '%s' (%d bytes)",
+               i, channel_get_name(ch, channel_blank_name),
+               eventid, start, length, etmlocation,
+               lang_str_get(title, NULL), titlelen);
 
-    ebc = epg_broadcast_find_by_time(ch, mod, start, stop, 1, &save2, &changes2);
-    tvhtrace(LS_PSIP, "  eid=%5d, start=%"PRItime_t", stop=%"PRItime_t", ebc=%p",
-             eventid, start, stop, ebc);
-    if (!ebc) goto next;
+      save2 = changes2 = 0;
 
-    save2 |= epg_broadcast_set_dvb_eid(ebc, eventid, &changes2);
-    if(etmlocation == 0)
-      save2 |= epg_broadcast_set_description(ebc, NULL, NULL);
+      ebc = epg_broadcast_find_by_time(ch, mod, start, stop, 1, &save2, &changes2);
+      tvhtrace(LS_PSIP, "  eid=%5d, start=%"PRItime_t", stop=%"PRItime_t", ebc=%p",
+               eventid, start, stop, ebc);
+      if (!ebc) continue;
 
-    save |= epg_broadcast_set_title(ebc, title, &changes2);
-    save |= save2;
+      save2 |= epg_broadcast_set_dvb_eid(ebc, eventid, &changes2);
+      if(etmlocation == 0)
+        save2 |= epg_broadcast_set_description(ebc, NULL, NULL);
+
+      save |= epg_broadcast_set_title(ebc, title, &changes2);
+      save |= save2;
+    }
 
-next:
     lang_str_destroy(title);
   }
   return save;
@@ -260,10 +336,8 @@ _psip_eit_callback
   psip_status_t        *ps  = mt->mt_opaque;
   epggrab_ota_map_t    *map = ps->ps_map;
   epggrab_module_t     *mod = (epggrab_module_t *)map->om_module;
-  channel_t            *ch;
   mpegts_service_t     *svc;
   mpegts_psi_table_state_t *st;
-  idnode_list_mapping_t *ilm;
   th_subscription_t    *ths;
 
   /* Validate */
@@ -315,12 +389,8 @@ _psip_eit_callback
   if (ps->ps_ota)
     epggrab_ota_service_add(map, ps->ps_ota, &svc->s_id.in_uuid, 1);
 
-  /* For each associated channels */
-  LIST_FOREACH(ilm, &svc->s_channels, ilm_in1_link) {
-    ch = (channel_t *)ilm->ilm_in2;
-    if (!ch->ch_enabled || ch->ch_epg_parent) continue;
-    save |= _psip_eit_callback_channel(ps, ch, ptr, len, count);
-  }
+  /* For each event, applied to all associated channels */
+  save = _psip_eit_callback_svc(ps, svc, ptr, len, count);
 
   if (save)
     epg_updated();
@@ -395,6 +465,11 @@ _psip_ett_callback
   if (!isevent) {
     tvhtrace(LS_PSIP, "0x%04x: channel ETT tableid 0x%04X [%s], ver %d", mt->mt_pid, tsid, svc->s_dvb_svcname, ver);
   } else {
+    /* the version cache is reset below to track the carousel, so use
+     * the payload CRC to skip the decode of unchanged text */
+    uint32_t crc = tvh_crc32(ptr + 10, len - 10, 0xffffffff);
+    if (psip_ett_crc_check(ps, sourceid, eventid, crc))
+      goto done;
     found = 1;
     description = atsc_get_string(ptr+10, len-10);
     LIST_FOREACH(ilm, &svc->s_channels, ilm_in1_link) {
@@ -414,6 +489,8 @@ _psip_ett_callback
     if (found == 0) {
       tvhtrace(LS_PSIP, "0x%04x: ETT tableid 0x%04X [%s], eventid 0x%04X (%d), ver %d - no matching broadcast found [%.80s]",
                mt->mt_pid, tsid, svc->s_dvb_svcname, eventid, eventid, ver, lang_str_get(description, NULL));
+    } else {
+      psip_ett_crc_store(ps, sourceid, eventid, crc);
     }
     lang_str_destroy(description);
   }
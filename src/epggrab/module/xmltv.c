@@ -1256,15 +1256,34 @@ static int _xmltv_parse_channel
  *  ...multiple programmes
  *</tv>
  */
-static int _xmltv_parse_tv
-  (epggrab_module_t *mod, htsmsg_t *body, epggrab_stats_t *stats)
+/*
+ * Commit batching: hold global_lock across a bounded run of tags
+ * instead of cycling it per programme (which is mostly lock traffic)
+ * or holding it for the whole import (which stalls the UI and
+ * streaming for seconds on a 7-day feed)
+ */
+#define XMLTV_COMMIT_BATCH 32
+
+static int xmltv_commit_held;
+static int xmltv_commit_save;
+
+static void _xmltv_commit_flush(void)
 {
-  int gsave = 0, save;
-  htsmsg_t *tags;
-  htsmsg_field_t *f;
+  if (xmltv_commit_held == 0)
+    return;
+  if (xmltv_commit_save) {
+    epg_updated();
+    xmltv_commit_save = 0;
+  }
+  xmltv_commit_held = 0;
+  tvh_mutex_unlock(&global_lock);
+}
 
-  if((tags = htsmsg_get_map(body, "tags")) == NULL)
-    return 0;
+static void _xmltv_parse_tv_begin
+  (epggrab_module_t *mod)
+{
+  xmltv_commit_held = 0;
+  xmltv_commit_save = 0;
 
   //Pre-process the XPaths
   //Only done once per XMLTV session.
@@ -1345,21 +1364,38 @@ static int _xmltv_parse_tv
   tvh_mutex_lock(&global_lock);
   epggrab_channel_begin_scan(mod);
   tvh_mutex_unlock(&global_lock);
+}
 
-  HTSMSG_FOREACH(f, tags) {
-    save = 0;
-    if(!strcmp(htsmsg_field_name(f), "channel")) {
-      tvh_mutex_lock(&global_lock);
-      save = _xmltv_parse_channel(mod, htsmsg_get_map_by_field(f), stats);
-      tvh_mutex_unlock(&global_lock);
-    } else if(!strcmp(htsmsg_field_name(f), "programme")) {
-      tvh_mutex_lock(&global_lock);
-      save = _xmltv_parse_programme(mod, htsmsg_get_map_by_field(f), stats);
-      if (save) epg_updated();
-      tvh_mutex_unlock(&global_lock);
-    }
-    gsave |= save;
-  }
+static int _xmltv_parse_tv_tag
+  (epggrab_module_t *mod, const char *name, htsmsg_t *body,
+   epggrab_stats_t *stats)
+{
+  int save = 0;
+  int is_channel = !strcmp(name, "channel");
+
+  if (!is_channel && strcmp(name, "programme"))
+    return 0;
+
+  if (xmltv_commit_held == 0)
+    tvh_mutex_lock(&global_lock);
+  xmltv_commit_held++;
+
+  if (is_channel)
+    save = _xmltv_parse_channel(mod, body, stats);
+  else
+    save = _xmltv_parse_programme(mod, body, stats);
+  xmltv_commit_save |= save;
+
+  if (xmltv_commit_held >= XMLTV_COMMIT_BATCH)
+    _xmltv_commit_flush();
+
+  return save;
+}
+
+static void _xmltv_parse_tv_end
+  (epggrab_module_t *mod)
+{
+  _xmltv_commit_flush();
 
   tvh_mutex_lock(&global_lock);
   epggrab_channel_end_scan(mod);
@@ -1382,6 +1418,25 @@ static int _xmltv_parse_tv
   {
     htsmsg_destroy(xmltv_xpath_category_code);
   }
+}
+
+static int _xmltv_parse_tv
+  (epggrab_module_t *mod, htsmsg_t *body, epggrab_stats_t *stats)
+{
+  int gsave = 0;
+  htsmsg_t *tags;
+  htsmsg_field_t *f;
+
+  if((tags = htsmsg_get_map(body, "tags")) == NULL)
+    return 0;
+
+  _xmltv_parse_tv_begin(mod);
+
+  HTSMSG_FOREACH(f, tags)
+    gsave |= _xmltv_parse_tv_tag(mod, htsmsg_field_name(f),
+                                 htsmsg_get_map_by_field(f), stats);
+
+  _xmltv_parse_tv_end(mod);
   return gsave;
 }
 
@@ -1399,6 +1454,39 @@ static int _xmltv_parse
   return _xmltv_parse_tv(mod, tv, stats);
 }
 
+/**
+ * Streaming entry point - the <tv> children are deserialized and handed
+ * over one at a time, so only a single <programme> DOM is alive at once
+ */
+typedef struct _xmltv_stream_aux {
+  epggrab_module_t *mod;
+  epggrab_stats_t  *stats;
+  int               gsave;
+} _xmltv_stream_aux_t;
+
+static void _xmltv_parse_stream_cb
+  ( void *opaque, const char *name, htsmsg_t *tag )
+{
+  _xmltv_stream_aux_t *aux = opaque;
+
+  aux->gsave |= _xmltv_parse_tv_tag(aux->mod, name, tag, aux->stats);
+}
+
+static int _xmltv_parse_stream
+  ( void *mod, char *data, epggrab_stats_t *stats )
+{
+  char errbuf[100];
+  _xmltv_stream_aux_t aux = { mod, stats, 0 };
+
+  _xmltv_parse_tv_begin(mod);
+  if (htsmsg_xml_deserialize_stream(data, "tv", _xmltv_parse_stream_cb,
+                                    &aux, errbuf, sizeof(errbuf)) < 0)
+    tvherror(LS_XMLTV, "%s: htsmsg_xml_deserialize error %s",
+             ((epggrab_module_t *)mod)->id, errbuf);
+  _xmltv_parse_tv_end(mod);
+  return aux.gsave;
+}
+
 /* ************************************************************************
  * Module Setup
  * ***********************************************************************/
@@ -1716,7 +1804,8 @@ static void _xmltv_load_grabbers ( void )
         epggrab_module_int_create(NULL, &epggrab_mod_int_xmltv_class,
                                   &outbuf[p], LS_XMLTV, "xmltv",
                                   name, 3, &outbuf[p],
-                                  NULL, _xmltv_parse, NULL);
+                                  NULL, _xmltv_parse, NULL)
+          ->parse_stream = _xmltv_parse_stream;
         p = n = i + 1;
       } else if ( outbuf[i] == '\\') {
         memmove(outbuf, outbuf + 1, strlen(outbuf));
@@ -1767,7 +1856,8 @@ static void _xmltv_load_grabbers ( void )
             } else {
               epggrab_module_int_create(NULL, &epggrab_mod_int_xmltv_class,
                                         bin, LS_XMLTV, "xmltv", name, 3, bin,
-                                        NULL, _xmltv_parse, NULL);
+                                        NULL, _xmltv_parse, NULL)
+                ->parse_stream = _xmltv_parse_stream;
             }
             free(outbuf);
           } else {
@@ -1788,7 +1878,8 @@ void xmltv_init ( void )
   /* External module */
   epggrab_module_ext_create(NULL, &epggrab_mod_ext_xmltv_class,
                             "xmltv", LS_XMLTV, "xmltv", "XMLTV", 3, "xmltv",
-                            _xmltv_parse, NULL);
+                            _xmltv_parse, NULL)
+    ->parse_stream = _xmltv_parse_stream;
 
   /* Standard modules */
   _xmltv_load_grabbers();
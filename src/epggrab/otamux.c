@@ -53,6 +53,7 @@ gtimer_t                     epggrab_ota_start_timer;
 
 int                          epggrab_ota_running;
 int                          epggrab_ota_pending_flag;
+static int                   epggrab_ota_paused;
 
 tvh_mutex_t                  epggrab_ota_mutex;
 
@@ -591,6 +592,9 @@ epggrab_ota_kick_cb ( void *p )
 
   lock_assert(&global_lock);
 
+  if (epggrab_ota_paused)
+    return;
+
   if (!om)
     return;
 
@@ -953,6 +957,31 @@ epggrab_ota_init ( void )
   }
 }
 
+/*
+ * Load shedding - park the grabber, stealing the active muxes back to
+ * the pending queue so they are retried once the box has headroom again
+ */
+void
+epggrab_ota_pause ( int on )
+{
+  epggrab_ota_mux_t *om;
+
+  lock_assert(&global_lock);
+
+  if (epggrab_ota_paused == on)
+    return;
+  epggrab_ota_paused = on;
+  if (on) {
+    tvhinfo(LS_EPGGRAB, "ota - paused (overload)");
+    while ((om = TAILQ_FIRST(&epggrab_ota_active)) != NULL)
+      epggrab_ota_done(om, EPGGRAB_OTA_DONE_STOLEN);
+    mtimer_disarm(&epggrab_ota_kick_timer);
+  } else {
+    tvhinfo(LS_EPGGRAB, "ota - resumed");
+    epggrab_ota_kick(1);
+  }
+}
+
 void
 epggrab_ota_trigger ( int secs )
 {
@@ -997,6 +1026,7 @@ epggrab_ota_free ( epggrab_ota_head_t *head, epggrab_ota_mux_t *ota  )
     LIST_REMOVE(map, om_link);
     while ((svcl = RB_FIRST(&map->om_svcs)) != NULL)
       epggrab_ota_service_del(map, ota, svcl, 0);
+    free(map->om_opaque);
     free(map);
   }
   free(ota->om_force_modname);
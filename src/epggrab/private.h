@@ -39,6 +39,7 @@ void      epggrab_module_ch_mod  ( void *m, struct channel *ch );
 void      epggrab_module_ch_save ( void *m, epggrab_channel_t *ec );
 
 void      epggrab_module_parse ( void *m, htsmsg_t *data );
+void      epggrab_module_parse_stream ( void *m, char *data );
 
 void      epggrab_module_channels_load ( const char *modid );
 
@@ -5749,11 +5749,56 @@ unsigned fsat_index_2[] = {
 		3160  /* 128 */
 };
 
+/*
+ * 8-bit indexed lookup tables generated from the code tables above;
+ * codes of up to 8 bits resolve with a single index, longer (rare)
+ * codes fall back to scanning only the tail of the context's code list
+ */
+struct fsatlut {
+	unsigned char bits; /* 0 = longer than 8 bits, scan from long_start */
+	char next;
+};
+
+static struct fsatlut fsat_lut_1[128][256];
+static struct fsatlut fsat_lut_2[128][256];
+static unsigned fsat_long_1[128];
+static unsigned fsat_long_2[128];
+static int fsat_lut_built;
+static tvh_mutex_t fsat_lut_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+
+static void freesat_huffman_build_lut
+  (struct fsattab *fsat_table, unsigned int *fsat_index,
+   struct fsatlut lut[128][256], unsigned *long_start)
+{
+	unsigned int ctx, j, lo, hi;
+	short bits;
+
+	for (ctx = 0; ctx < 128; ctx++) {
+		long_start[ctx] = fsat_index[ctx + 1];
+		for (j = fsat_index[ctx]; j < fsat_index[ctx + 1]; j++) {
+			bits = fsat_table[j].bits;
+			if (bits > 8) {
+				if (long_start[ctx] > j)
+					long_start[ctx] = j;
+				continue;
+			}
+			lo = fsat_table[j].value >> 24;
+			hi = lo + (1 << (8 - bits));
+			for (; lo < hi; lo++) {
+				lut[ctx][lo].bits = bits;
+				lut[ctx][lo].next = fsat_table[j].next;
+			}
+		}
+	}
+}
+
 size_t freesat_huffman_decode
   (char *dst, size_t* dstlen, const uint8_t *src, size_t srclen)
 {
 	struct fsattab *fsat_table;
 	unsigned int *fsat_index;
+	struct fsatlut (*fsat_lut)[256], *le;
+	unsigned *fsat_long;
   size_t p;
 	unsigned int value;
 	unsigned int byte;
@@ -5765,20 +5810,34 @@ size_t freesat_huffman_decode
 	unsigned int indx;
 	unsigned int j;
 	unsigned int mask;
-	unsigned int maskbit;
-	unsigned short kk;
-	unsigned int b;
+	unsigned int need, take;
 
   if (src[0] != 0x1f) return -1;
 
+	if (!fsat_lut_built) {
+		tvh_mutex_lock(&fsat_lut_mutex);
+		if (!fsat_lut_built) {
+			freesat_huffman_build_lut(fsat_table_1, fsat_index_1,
+			                          fsat_lut_1, fsat_long_1);
+			freesat_huffman_build_lut(fsat_table_2, fsat_index_2,
+			                          fsat_lut_2, fsat_long_2);
+			fsat_lut_built = 1;
+		}
+		tvh_mutex_unlock(&fsat_lut_mutex);
+	}
+
 	p = 0;
 	if (src[1] == 1 || src[1] == 2) {
 		if (src[1] == 1) {
 			fsat_table = fsat_table_1;
 			fsat_index = fsat_index_1;
+			fsat_lut = fsat_lut_1;
+			fsat_long = fsat_long_1;
 		} else {
 			fsat_table = fsat_table_2;
 			fsat_index = fsat_index_2;
+			fsat_lut = fsat_lut_2;
+			fsat_long = fsat_long_2;
 		}
 		value = 0;
 		byte = 2;
@@ -5808,19 +5867,23 @@ size_t freesat_huffman_decode
 				indx = (unsigned int) lastch;
 				//if (src[1] == 2)
 				//    indx |= 0x80;
-				for (j = fsat_index[indx]; j < fsat_index[indx + 1]; j++) {
-					mask = 0;
-					maskbit = 0x80000000;
-					for (kk = 0; kk < fsat_table[j].bits; kk++) {
-						mask |= maskbit;
-						maskbit >>= 1;
-					}
-					if ((value & mask) == fsat_table[j].value) {
-						nextCh = fsat_table[j].next;
-						bitShift = fsat_table[j].bits;
-						found = 1;
-						lastch = nextCh;
-						break;
+				le = &fsat_lut[indx][value >> 24];
+				if (le->bits) {
+					nextCh = le->next;
+					bitShift = le->bits;
+					found = 1;
+					lastch = nextCh;
+				} else {
+					// Longer than 8 bits - scan the tail of the code list.
+					for (j = fsat_long[indx]; j < fsat_index[indx + 1]; j++) {
+						mask = 0xffffffff << (32 - fsat_table[j].bits);
+						if ((value & mask) == fsat_table[j].value) {
+							nextCh = fsat_table[j].next;
+							bitShift = fsat_table[j].bits;
+							found = 1;
+							lastch = nextCh;
+							break;
+						}
 					}
 				}
 			}
@@ -5829,16 +5892,22 @@ size_t freesat_huffman_decode
 					if (p >= *dstlen) return 0;
 					dst[p++] = nextCh;
 				}
-				// Shift up by the number of bits.
-				for (b = 0; b < bitShift; b++) {
-					value = (value << 1) & 0xfffffffe;
+				// Shift up by the number of bits, refilling a byte at a time.
+				value <<= bitShift;
+				need = bitShift;
+				while (need) {
+					take = 8 - bit;
+					if (take > need)
+						take = need;
 					if (byte < srclen)
-						value |= (src[byte] >> (7 - bit)) & 1;
-					if (bit == 7) {
+						value |= ((src[byte] >> (8 - bit - take)) &
+						          ((1 << take) - 1)) << (need - take);
+					bit += take;
+					if (bit == 8) {
 						bit = 0;
 						byte++;
-					} else
-						bit++;
+					}
+					need -= take;
 				}
 			} else {
         return -1;
@@ -26,6 +26,9 @@
 
 struct esfilter_entry_queue esfilters[ESF_CLASS_LAST + 1];
 
+esfilter_rule_t *esfilter_rules[ESF_CLASS_LAST + 1];
+int esfilter_rules_count[ESF_CLASS_LAST + 1];
+
 /*
  * Class masks
  */
@@ -104,6 +107,46 @@ esfilter_txt2action(const char *s)
 }
 #endif
 
+/*
+ * Compiled filter program
+ */
+
+static void
+esfilter_program_rebuild(void)
+{
+  esfilter_rule_t *er;
+  esfilter_t *esf;
+  int i, n;
+
+  for (i = ESF_CLASS_VIDEO; i <= ESF_CLASS_LAST; i++) {
+    n = 0;
+    TAILQ_FOREACH(esf, &esfilters[i], esf_link)
+      if (esf->esf_enabled)
+        n++;
+    free(esfilter_rules[i]);
+    esfilter_rules[i] = er = n ? calloc(n, sizeof(*er)) : NULL;
+    esfilter_rules_count[i] = n;
+    if (n == 0)
+      continue;
+    TAILQ_FOREACH(esf, &esfilters[i], esf_link) {
+      if (!esf->esf_enabled)
+        continue;
+      er->er_esf = esf;
+      er->er_type = esf->esf_type;
+      memcpy(&er->er_lang, esf->esf_language, sizeof(er->er_lang));
+      er->er_caid = esf->esf_caid;
+      er->er_caprovider = esf->esf_caprovider;
+      er->er_pid = esf->esf_pid;
+      er->er_sindex = esf->esf_sindex;
+      er->er_action = esf->esf_action;
+      er->er_log = esf->esf_log;
+      if (esf->esf_service[0] && !uuid_set(&er->er_svc, esf->esf_service))
+        er->er_svc_set = 1;
+      er++;
+    }
+  }
+}
+
 /*
  * Create / delete
  */
@@ -184,6 +227,7 @@ esfilter_create
     esfilter_reindex(esf->esf_class);
   if (save)
     idnode_changed(&esf->esf_id);
+  esfilter_program_rebuild();
   return esf;
 }
 
@@ -198,6 +242,7 @@ esfilter_delete(esfilter_t *esf, int delconf)
   idnode_unlink(&esf->esf_id);
   free(esf->esf_comment);
   free(esf);
+  esfilter_program_rebuild();
 }
 
 /*
@@ -212,6 +257,7 @@ esfilter_class_save(idnode_t *self, char *filename, size_t fsize)
   idnode_save(self, c);
   if (filename)
     snprintf(filename, fsize, "esfilter/%s", idnode_uuid_as_str(self, ubuf));
+  esfilter_program_rebuild();
   return c;
 }
 
@@ -1214,6 +1260,8 @@ esfilter_init(void)
 
   for (i = 0; i <= ESF_CLASS_LAST; i++)
     esfilter_reindex(i);
+
+  esfilter_program_rebuild();
 }
 
 void
@@ -1226,6 +1274,9 @@ esfilter_done(void)
   for (i = 0; i <= ESF_CLASS_LAST; i++) {
     while ((esf = TAILQ_FIRST(&esfilters[i])) != NULL)
       esfilter_delete(esf, 0);
+    free(esfilter_rules[i]);
+    esfilter_rules[i] = NULL;
+    esfilter_rules_count[i] = 0;
   }
   tvh_mutex_unlock(&global_lock);
 }
@@ -101,6 +101,29 @@ typedef struct esfilter {
   char *esf_comment;
 } esfilter_t;
 
+/*
+ * Compiled filter program - the enabled rules of each class lowered
+ * into a flat table with integer keys, rebuilt on config change, so
+ * the per-stream evaluation in elementary_set_filter_build() avoids
+ * the string comparisons and disabled-rule walks of the raw list.
+ */
+typedef struct esfilter_rule {
+  esfilter_t *er_esf;       /* source rule - for logging only */
+  uint32_t er_type;         /* stream type mask, 0 = any */
+  uint32_t er_lang;         /* packed language code, 0 = any */
+  uint32_t er_caprovider;
+  tvh_uuid_t er_svc;        /* service filter, valid when er_svc_set */
+  uint16_t er_caid;
+  uint8_t er_svc_set;
+  uint8_t er_action;
+  uint8_t er_log;
+  int er_pid;
+  int er_sindex;
+} esfilter_rule_t;
+
+extern esfilter_rule_t *esfilter_rules[];
+extern int esfilter_rules_count[];
+
 esfilter_t *esfilter_create
   (esfilter_class_t esf_class, const char *uuid, htsmsg_t *conf, int save);
 
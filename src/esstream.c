@@ -228,22 +228,21 @@ elementary_set_filter_build(elementary_set_t *set)
 {
   service_t *t;
   elementary_stream_t *st, *st2, **sta;
+  const esfilter_rule_t *er, *er_end;
   esfilter_t *esf;
   caid_t *ca, *ca2;
   int i, n, p, o, exclusive, sindex;
-  uint32_t mask;
-  char service_ubuf[UUID_HEX_SIZE];
+  uint32_t mask, lang;
 
   t = set->set_service;
   if (t == NULL)
     return;
-  idnode_uuid_as_str(&t->s_id, service_ubuf);
 
   /* rebuild the filtered and ordered components */
   TAILQ_INIT(&set->set_filter);
 
   for (i = ESF_CLASS_VIDEO; i <= ESF_CLASS_LAST; i++)
-    if (!TAILQ_EMPTY(&esfilters[i]))
+    if (esfilter_rules_count[i] > 0)
       goto filter;
 
   TAILQ_FOREACH(st, &set->set_all, es_link) {
@@ -270,7 +269,7 @@ filter:
   for (i = ESF_CLASS_VIDEO, p = 0; i <= ESF_CLASS_LAST; i++) {
     o = p;
     mask = esfilterclsmask[i];
-    if (TAILQ_EMPTY(&esfilters[i])) {
+    if (esfilter_rules_count[i] == 0) {
       TAILQ_FOREACH(st, &set->set_all, es_link) {
         if ((mask & SCT_MASK(st->es_type)) != 0) {
           elementary_set_filter_build_add(set, st, sta, &p);
@@ -281,33 +280,35 @@ filter:
       continue;
     }
     exclusive = 0;
-    TAILQ_FOREACH(esf, &esfilters[i], esf_link) {
-      if (!esf->esf_enabled)
+    er_end = esfilter_rules[i] + esfilter_rules_count[i];
+    for (er = esfilter_rules[i]; er < er_end; er++) {
+      esf = er->er_esf;
+      if (er->er_svc_set && uuid_cmp(&er->er_svc, &t->s_id.in_uuid))
         continue;
       sindex = 0;
       TAILQ_FOREACH(st, &set->set_all, es_link) {
         if ((mask & SCT_MASK(st->es_type)) == 0)
           continue;
-        if (esf->esf_type && (esf->esf_type & SCT_MASK(st->es_type)) == 0)
+        if (er->er_type && (er->er_type & SCT_MASK(st->es_type)) == 0)
           continue;
-        if (esf->esf_language[0] &&
-            strncmp(esf->esf_language, st->es_lang, 4))
-          continue;
-        if (esf->esf_service[0]) {
-          if (strcmp(esf->esf_service, service_ubuf))
+        if (er->er_lang) {
+          memcpy(&lang, st->es_lang, sizeof(lang));
+          if (er->er_lang != lang)
             continue;
-          if (esf->esf_pid && esf->esf_pid != st->es_pid)
+        }
+        if (er->er_svc_set) {
+          if (er->er_pid && er->er_pid != st->es_pid)
             continue;
         }
         if (i == ESF_CLASS_CA) {
-          if (esf->esf_pid && esf->esf_pid != st->es_pid)
+          if (er->er_pid && er->er_pid != st->es_pid)
             continue;
           ca = NULL;
-          if ((esf->esf_caid != (uint16_t)-1 || esf->esf_caprovider != -1)) {
+          if ((er->er_caid != (uint16_t)-1 || er->er_caprovider != -1)) {
             LIST_FOREACH(ca, &st->es_caids, link) {
-              if (esf->esf_caid != (uint16_t)-1 && ca->caid != esf->esf_caid)
+              if (er->er_caid != (uint16_t)-1 && ca->caid != er->er_caid)
                 continue;
-              if (esf->esf_caprovider != (uint32_t)-1 && ca->providerid != esf->esf_caprovider)
+              if (er->er_caprovider != (uint32_t)-1 && ca->providerid != er->er_caprovider)
                 continue;
               break;
             }
@@ -315,14 +316,14 @@ filter:
               continue;
           }
           sindex++;
-          if (esf->esf_sindex && esf->esf_sindex != sindex)
+          if (er->er_sindex && er->er_sindex != sindex)
             continue;
-          if (esf->esf_log)
+          if (er->er_log)
             tvhinfo(LS_SERVICE, "esfilter: \"%s\" %s %03d %03d %05d %04x %06x %s",
               t->s_nicename, esfilter_class2txt(i), st->es_index,
               esf->esf_index, st->es_pid, esf->esf_caid, esf->esf_caprovider,
               esfilter_action2txt(esf->esf_action));
-          switch (esf->esf_action) {
+          switch (er->er_action) {
           case ESFA_NONE:
             break;
           case ESFA_IGNORE:
@@ -368,14 +369,14 @@ ca_ignore:
           }
         } else {
           sindex++;
-          if (esf->esf_sindex && esf->esf_sindex != sindex)
+          if (er->er_sindex && er->er_sindex != sindex)
             continue;
-          if (esf->esf_log)
+          if (er->er_log)
             tvhinfo(LS_SERVICE, "esfilter: \"%s\" %s %03d %03d %05d %s %s %s",
               t->s_nicename, esfilter_class2txt(i), st->es_index, esf->esf_index,
               st->es_pid, streaming_component_type2txt(st->es_type),
               lang_code_get(st->es_lang), esfilter_action2txt(esf->esf_action));
-          switch (esf->esf_action) {
+          switch (er->er_action) {
           case ESFA_NONE:
             break;
           case ESFA_IGNORE:
@@ -390,7 +391,7 @@ ignore:
                 continue;
               if ((mask & SCT_MASK(st2->es_type)) == 0)
                 continue;
-              if (esf->esf_language[0] != '\0' && strcmp(st2->es_lang, st->es_lang))
+              if (er->er_lang && strcmp(st2->es_lang, st->es_lang))
                 continue;
               break;
             }
@@ -410,7 +411,7 @@ ignore:
             break;
           }
         }
-        if (esf->esf_action == ESFA_EXCLUSIVE) {
+        if (er->er_action == ESFA_EXCLUSIVE) {
           /* forget previous work */
           while (p > o) {
             p--;
@@ -48,6 +48,18 @@ struct filebundle_dir
   };
 };
 
+/* Cached inflated copy of a compressed bundle entry */
+#if (ENABLE_ZLIB && ENABLE_BUNDLE)
+typedef struct fb_inflated
+{
+  TAILQ_ENTRY(fb_inflated) link;
+  const filebundle_entry_t *entry;
+  uint8_t *data;
+  size_t   size;
+  int      refcount;
+} fb_inflated_t;
+#endif
+
 /* File bundle file handle */
 struct filebundle_file
 {
@@ -56,6 +68,9 @@ struct filebundle_file
   int     gzip;
   uint8_t *buf;
   size_t  pos;
+#if (ENABLE_ZLIB && ENABLE_BUNDLE)
+  fb_inflated_t *cached;
+#endif
   union {
     struct {
       FILE  *cur;
@@ -66,6 +81,83 @@ struct filebundle_file
   };
 };
 
+/* **************************************************************************
+ * Decompressed entry cache
+ * *************************************************************************/
+
+/* The bundle itself lives in the binary image and is served straight from
+   those (shared, read-only) pages; the only per-request allocation left is
+   inflating entries that were compressed at bundle generation time.  Keep
+   the most recently used inflated copies around so repeated requests for
+   the same asset hit the cache instead of zlib */
+
+#if (ENABLE_ZLIB && ENABLE_BUNDLE)
+
+#define FB_INFLATED_CACHE_MAX (2*1024*1024)
+
+static TAILQ_HEAD(fb_inflated_queue, fb_inflated) fb_inflated_cache =
+  TAILQ_HEAD_INITIALIZER(fb_inflated_cache);
+static tvh_mutex_t fb_inflated_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static size_t fb_inflated_total;
+
+static fb_inflated_t *fb_inflated_get ( const filebundle_entry_t *fb )
+{
+  fb_inflated_t *fi, *next;
+  uint8_t *data;
+
+  tvh_mutex_lock(&fb_inflated_mutex);
+  TAILQ_FOREACH(fi, &fb_inflated_cache, link)
+    if (fi->entry == fb) break;
+  if (fi) {
+    /* Move to front */
+    TAILQ_REMOVE(&fb_inflated_cache, fi, link);
+    TAILQ_INSERT_HEAD(&fb_inflated_cache, fi, link);
+    fi->refcount++;
+    tvh_mutex_unlock(&fb_inflated_mutex);
+    return fi;
+  }
+  tvh_mutex_unlock(&fb_inflated_mutex);
+
+  /* Inflate outside the lock */
+  data = tvh_gzip_inflate(fb->f.data, fb->f.size, fb->f.orig);
+  if (!data)
+    return NULL;
+
+  fi = calloc(1, sizeof(*fi));
+  fi->entry    = fb;
+  fi->data     = data;
+  fi->size     = fb->f.orig;
+  fi->refcount = 1;
+
+  tvh_mutex_lock(&fb_inflated_mutex);
+  TAILQ_INSERT_HEAD(&fb_inflated_cache, fi, link);
+  fb_inflated_total += fi->size;
+
+  /* Trim cold unreferenced entries */
+  for (next = TAILQ_LAST(&fb_inflated_cache, fb_inflated_queue);
+       next && fb_inflated_total > FB_INFLATED_CACHE_MAX; ) {
+    fb_inflated_t *prev = TAILQ_PREV(next, fb_inflated_queue, link);
+    if (next != fi && next->refcount == 0) {
+      TAILQ_REMOVE(&fb_inflated_cache, next, link);
+      fb_inflated_total -= next->size;
+      free(next->data);
+      free(next);
+    }
+    next = prev;
+  }
+  tvh_mutex_unlock(&fb_inflated_mutex);
+  return fi;
+}
+
+static void fb_inflated_release ( fb_inflated_t *fi )
+{
+  tvh_mutex_lock(&fb_inflated_mutex);
+  fi->refcount--;
+  tvh_mutex_unlock(&fb_inflated_mutex);
+}
+
+#endif /* ENABLE_ZLIB && ENABLE_BUNDLE */
+
 /* **************************************************************************
  * Miscellanous
  * *************************************************************************/
@@ -302,13 +394,15 @@ fb_file *fb_open2
       ret->gzip         = fb->f.orig != -1;
       ret->b.root       = fb;
 
-      /* Inflate the file */
+      /* Inflate the file (served from the shared cache) */
       if (fb->f.orig != -1 && decompress) {
 #if (ENABLE_ZLIB && ENABLE_BUNDLE)
-        ret->gzip = 0;
-        ret->size = fb->f.orig;
-        ret->buf  = tvh_gzip_inflate(fb->f.data, fb->f.size, fb->f.orig);
-        if (!ret->buf) {
+        ret->cached = fb_inflated_get(fb);
+        if (ret->cached) {
+          ret->gzip = 0;
+          ret->size = ret->cached->size;
+          ret->buf  = ret->cached->data;
+        } else {
           free(ret);
           ret = NULL;
         }
@@ -402,6 +496,11 @@ void fb_close ( fb_file *fp )
   if (fp->type == FB_DIRECT && fp->d.cur) {
     fclose(fp->d.cur);
   }
+#if (ENABLE_ZLIB && ENABLE_BUNDLE)
+  if (fp->cached)
+    fb_inflated_release(fp->cached);
+  else
+#endif
   if (fp->buf)
     free(fp->buf);
   free(fp);
@@ -419,6 +518,15 @@ int fb_gzipped ( fb_file *fp )
   return fp->gzip;
 }
 
+/* Underlying file descriptor (plain disk files only, for zero-copy
+   transfers), -1 when the content lives in a memory buffer */
+int fb_fileno ( fb_file *fp )
+{
+  if (fp->type == FB_DIRECT && !fp->buf && fp->d.cur)
+    return fileno(fp->d.cur);
+  return -1;
+}
+
 /* Check for EOF */
 int fb_eof ( fb_file *fp )
 {
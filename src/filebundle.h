@@ -98,6 +98,7 @@ fb_file *fb_open    ( const char *path, int decompress, int compress );
 void     fb_close   ( fb_file *fp );
 size_t   fb_size    ( fb_file *fp );
 int      fb_gzipped ( fb_file *fp );
+int      fb_fileno  ( fb_file *fp );
 int      fb_eof     ( fb_file *fp );
 ssize_t  fb_read    ( fb_file *fp, void *buf, size_t count );
 char    *fb_gets    ( fb_file *fp, void *buf, size_t count );
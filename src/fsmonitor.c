@@ -32,6 +32,28 @@
 RB_HEAD(,fsmonitor_path) fsmonitor_paths;
 int                      fsmonitor_fd;
 
+/* Watch descriptor hash - events carry only the wd, so the dispatch
+ * lookup must not scale with the number of watched paths */
+#define FSMONITOR_HASH_SIZE 256
+
+static LIST_HEAD(,fsmonitor_path) fsmonitor_hash[FSMONITOR_HASH_SIZE];
+
+static inline uint32_t
+fsmonitor_hash_wd ( int wd )
+{
+  return (uint32_t)wd & (FSMONITOR_HASH_SIZE - 1);
+}
+
+static fsmonitor_path_t *
+fsmonitor_find_wd ( int wd )
+{
+  fsmonitor_path_t *fmp;
+  LIST_FOREACH(fmp, &fsmonitor_hash[fsmonitor_hash_wd(wd)], fmp_hash_link)
+    if (fmp->fmp_fd == wd)
+      return fmp;
+  return NULL;
+}
+
 /* RB tree sorting of paths */
 static int
 fmp_cmp ( fsmonitor_path_t *a, fsmonitor_path_t *b )
@@ -76,11 +98,7 @@ fsmonitor_thread ( void* p )
                ev->wd, ev->len ? ev->name : NULL, ev->mask);
 
       /* Find */
-      // TODO: make this more efficient (especially if number of
-      //       watched paths gets big)
-      RB_FOREACH(fmp, &fsmonitor_paths, fmp_link)
-        if (fmp->fmp_fd == ev->wd)
-          break;
+      fmp = fsmonitor_find_wd(ev->wd);
       if (!fmp) continue;
 
       /* Full path */
@@ -165,6 +183,8 @@ fsmonitor_add ( const char *path, fsmonitor_t *fsm )
 
     /* Setup */
     fmp->fmp_path = strdup(path);
+    LIST_INSERT_HEAD(&fsmonitor_hash[fsmonitor_hash_wd(fmp->fmp_fd)],
+                     fmp, fmp_hash_link);
     tvhdebug(LS_FSMONITOR, "watch %s", fmp->fmp_path);
   } else {
     free(skel);
@@ -220,6 +240,7 @@ fsmonitor_del ( const char *path, fsmonitor_t *fsm )
     if (LIST_EMPTY(&fmp->fmp_monitors)) {
       tvhdebug(LS_FSMONITOR, "unwatch %s", fmp->fmp_path);
       RB_REMOVE(&fsmonitor_paths, fmp, fmp_link);
+      LIST_REMOVE(fmp, fmp_hash_link);
       fd = atomic_get(&fsmonitor_fd);
       if (fd >= 0)
         inotify_rm_watch(fd, fmp->fmp_fd);
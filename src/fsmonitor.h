@@ -29,6 +29,7 @@ struct fsmonitor_path
   char                        *fmp_path;
   int                          fmp_fd;
   RB_ENTRY(fsmonitor_path)     fmp_link;
+  LIST_ENTRY(fsmonitor_path)   fmp_hash_link; ///< watch descriptor hash bucket
   LIST_HEAD(,fsmonitor_link)   fmp_monitors;
 };
 
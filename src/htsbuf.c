@@ -25,6 +25,80 @@
 
 #include "tvheadend.h"
 #include "htsbuf.h"
+#include "packet.h"
+
+/*
+ * Per-thread recycling pool for standard sized chunks.  Buffer chains
+ * are assembled and torn down constantly (every HTTP response goes
+ * through here), so the common chunk plus its payload are kept on the
+ * freeing thread's list instead of hitting the allocator each time.
+ * Oversized chunks, preallocated buffers and pktbuf-backed chunks stay
+ * on plain malloc/free.
+ */
+#define HTSBUF_DATA_SIZE       1000
+#define HTSBUF_POOL_MAX_CHUNKS 32
+
+typedef struct htsbuf_pool {
+  htsbuf_data_t *hp_head;
+  int hp_chunks;
+} htsbuf_pool_t;
+
+static __thread htsbuf_pool_t *htsbuf_pool_tls;
+static pthread_key_t htsbuf_pool_key;
+static pthread_once_t htsbuf_pool_once = PTHREAD_ONCE_INIT;
+
+static void
+htsbuf_pool_thread_destroy(void *aux)
+{
+  htsbuf_pool_t *hp = aux;
+  htsbuf_data_t *hd;
+
+  while ((hd = hp->hp_head) != NULL) {
+    hp->hp_head = hd->hd_link.tqe_next;
+    free(hd->hd_data);
+    free(hd);
+  }
+  free(hp);
+}
+
+static void
+htsbuf_pool_key_create(void)
+{
+  pthread_key_create(&htsbuf_pool_key, htsbuf_pool_thread_destroy);
+}
+
+static htsbuf_data_t *
+htsbuf_data_alloc(size_t size)
+{
+  htsbuf_pool_t *hp;
+  htsbuf_data_t *hd = NULL;
+
+  if (size <= HTSBUF_DATA_SIZE) {
+    /* Allocate the standard size to support lots of small writes */
+    size = HTSBUF_DATA_SIZE;
+    hp = htsbuf_pool_tls;
+    if (hp == NULL) {
+      pthread_once(&htsbuf_pool_once, htsbuf_pool_key_create);
+      if ((hp = calloc(1, sizeof(*hp))) != NULL) {
+        htsbuf_pool_tls = hp;
+        pthread_setspecific(htsbuf_pool_key, hp);
+      }
+    }
+    if (hp && (hd = hp->hp_head) != NULL) {
+      hp->hp_head = hd->hd_link.tqe_next;
+      hp->hp_chunks--;
+    }
+  }
+  if (hd == NULL) {
+    hd = malloc(sizeof(htsbuf_data_t));
+    hd->hd_data = malloc(size);
+  }
+  hd->hd_data_size = size;
+  hd->hd_data_len = 0;
+  hd->hd_data_off = 0;
+  hd->hd_pktbuf = NULL;
+  return hd;
+}
 
 /**
  *
@@ -67,8 +141,23 @@ htsbuf_queue_free(htsbuf_queue_t *hq)
 void
 htsbuf_data_free(htsbuf_queue_t *hq, htsbuf_data_t *hd)
 {
+  htsbuf_pool_t *hp;
+
   hq->hq_size -= hd->hd_data_size - hd->hd_data_off;
   TAILQ_REMOVE(&hq->hq_q, hd, hd_link);
+  if (hd->hd_pktbuf) {
+    pktbuf_ref_dec(hd->hd_pktbuf);
+    free(hd);
+    return;
+  }
+  if (hd->hd_data_size == HTSBUF_DATA_SIZE && hd->hd_data != NULL &&
+      (hp = htsbuf_pool_tls) != NULL &&
+      hp->hp_chunks < HTSBUF_POOL_MAX_CHUNKS) {
+    hd->hd_link.tqe_next = hp->hp_head;
+    hp->hp_head = hd;
+    hp->hp_chunks++;
+    return;
+  }
   free(hd->hd_data);
   free(hd);
 }
@@ -108,16 +197,10 @@ htsbuf_append(htsbuf_queue_t *hq, const void *buf, size_t len)
   }
   if(len == 0)
     return;
-  
-  hd = malloc(sizeof(htsbuf_data_t));
-  TAILQ_INSERT_TAIL(&hq->hq_q, hd, hd_link);
-  
-  c = MAX(len, 1000); /* Allocate 1000 bytes to support lots of small writes */
 
-  hd->hd_data = malloc(c);
-  hd->hd_data_size = c;
+  hd = htsbuf_data_alloc(len);
+  TAILQ_INSERT_TAIL(&hq->hq_q, hd, hd_link);
   hd->hd_data_len = len;
-  hd->hd_data_off = 0;
   memcpy(hd->hd_data, buf, len);
 }
 
@@ -139,6 +222,30 @@ htsbuf_append_prealloc(htsbuf_queue_t *hq, const void *buf, size_t len)
   hd->hd_data_size = len;
   hd->hd_data_len = len;
   hd->hd_data_off = 0;
+  hd->hd_pktbuf = NULL;
+}
+
+/**
+ * Chain a refcounted packet buffer without copying its payload.
+ */
+void
+htsbuf_append_pktbuf(htsbuf_queue_t *hq, struct pktbuf *pb)
+{
+  htsbuf_data_t *hd;
+  size_t len = pktbuf_len(pb);
+
+  if(len == 0)
+    return;
+
+  hd = malloc(sizeof(htsbuf_data_t));
+  TAILQ_INSERT_TAIL(&hq->hq_q, hd, hd_link);
+
+  hd->hd_pktbuf = pktbuf_ref_inc(pb);
+  hd->hd_data = pktbuf_ptr(pb);
+  hd->hd_data_size = len;
+  hd->hd_data_len = len;
+  hd->hd_data_off = 0;
+  hq->hq_size += len;
 }
 
 /**
@@ -27,12 +27,15 @@
 
 TAILQ_HEAD(htsbuf_data_queue, htsbuf_data);
 
+struct pktbuf;
+
 typedef struct htsbuf_data {
   TAILQ_ENTRY(htsbuf_data) hd_link;
   uint8_t *hd_data;
   unsigned int hd_data_size; /* Size of allocation hb_data */
   unsigned int hd_data_len;  /* Number of valid bytes from hd_data */
   unsigned int hd_data_off;  /* Offset in data, used for partial writes */
+  struct pktbuf *hd_pktbuf;  /* Refcounted backing store, if any */
 } htsbuf_data_t;
 
 typedef struct htsbuf_queue {
@@ -58,6 +61,8 @@ void htsbuf_append(htsbuf_queue_t *hq, const void *buf, size_t len);
 
 void htsbuf_append_prealloc(htsbuf_queue_t *hq, const void *buf, size_t len);
 
+void htsbuf_append_pktbuf(htsbuf_queue_t *hq, struct pktbuf *pb);
+
 static inline void htsbuf_append_str(htsbuf_queue_t *hq, const char *str)
   { htsbuf_append(hq, str, strlen(str)); }
 
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <pthread.h>
 #include "build.h"
 #include "htsmsg.h"
 #include "misc/dbl.h"
@@ -37,6 +38,88 @@ memoryinfo_t htsmsg_field_memoryinfo = { .my_name = "htsmsg field" };
 static void htsmsg_clear(htsmsg_t *msg);
 static htsmsg_t *htsmsg_field_get_msg ( htsmsg_field_t *f, int islist );
 
+/*
+ * Per-thread recycling pool for small field blocks.  Fields are created
+ * and destroyed at a very high rate (every serialized message is built
+ * from them) and the common ones - numeric values and short strings,
+ * name and value stored inline - fit in one small block.  Freed blocks
+ * are kept on the calling thread's list, so the hot path never takes a
+ * lock or enters the allocator.  Oversized fields and fields created by
+ * the binary deserializers stay on plain malloc/free (no HMF_POOLED).
+ */
+#define HTSMSG_POOL_BLOCK_SIZE 64
+#define HTSMSG_POOL_MAX_BLOCKS 128
+
+typedef struct htsmsg_pool_block {
+  struct htsmsg_pool_block *hpb_next;
+} htsmsg_pool_block_t;
+
+typedef struct htsmsg_pool {
+  htsmsg_pool_block_t *hp_head;
+  int hp_blocks;
+} htsmsg_pool_t;
+
+static __thread htsmsg_pool_t *htsmsg_pool_tls;
+static pthread_key_t htsmsg_pool_key;
+static pthread_once_t htsmsg_pool_once = PTHREAD_ONCE_INIT;
+
+static void
+htsmsg_pool_thread_destroy(void *aux)
+{
+  htsmsg_pool_t *hp = aux;
+  htsmsg_pool_block_t *hpb;
+
+  while ((hpb = hp->hp_head) != NULL) {
+    hp->hp_head = hpb->hpb_next;
+    free(hpb);
+  }
+  free(hp);
+}
+
+static void
+htsmsg_pool_key_create(void)
+{
+  pthread_key_create(&htsmsg_pool_key, htsmsg_pool_thread_destroy);
+}
+
+static void *
+htsmsg_pool_alloc(void)
+{
+  htsmsg_pool_t *hp = htsmsg_pool_tls;
+  htsmsg_pool_block_t *hpb;
+
+  if (hp == NULL) {
+    pthread_once(&htsmsg_pool_once, htsmsg_pool_key_create);
+    hp = calloc(1, sizeof(*hp));
+    if (hp == NULL)
+      return malloc(HTSMSG_POOL_BLOCK_SIZE);
+    htsmsg_pool_tls = hp;
+    pthread_setspecific(htsmsg_pool_key, hp);
+  }
+  hpb = hp->hp_head;
+  if (hpb) {
+    hp->hp_head = hpb->hpb_next;
+    hp->hp_blocks--;
+    return hpb;
+  }
+  return malloc(HTSMSG_POOL_BLOCK_SIZE);
+}
+
+static void
+htsmsg_pool_free(void *ptr)
+{
+  htsmsg_pool_t *hp = htsmsg_pool_tls;
+  htsmsg_pool_block_t *hpb = ptr;
+
+  if (hp == NULL || hp->hp_blocks >= HTSMSG_POOL_MAX_BLOCKS) {
+    free(ptr);
+    return;
+  }
+  hpb->hpb_next = hp->hp_head;
+  hp->hp_head = hpb;
+  hp->hp_blocks++;
+}
+
 /**
  *
  */
@@ -92,7 +175,10 @@ htsmsg_field_destroy(htsmsg_t *msg, htsmsg_field_t *f)
   memoryinfo_free(&htsmsg_field_memoryinfo,
                   sizeof(htsmsg_field_t) + f->hmf_edata_size);
 #endif
-  free(f);
+  if (f->hmf_flags & HMF_POOLED)
+    htsmsg_pool_free(f);
+  else
+    free(f);
 }
 
 /*
@@ -114,9 +200,9 @@ htsmsg_clear(htsmsg_t *msg)
 htsmsg_field_t *
 htsmsg_field_add(htsmsg_t *msg, const char *name, int type, int flags, size_t esize)
 {
-  size_t nsize;
+  size_t nsize, fsize;
   htsmsg_field_t *f;
-  
+
   if (msg->hm_islist) {
     assert(name == NULL || *name == '\0');
     name = NULL;
@@ -132,7 +218,13 @@ htsmsg_field_add(htsmsg_t *msg, const char *name, int type, int flags, size_t es
   } else {
     nsize = 0;
   }
-  f = malloc(sizeof(htsmsg_field_t) + nsize + esize);
+  fsize = sizeof(htsmsg_field_t) + nsize + esize;
+  if (fsize <= HTSMSG_POOL_BLOCK_SIZE) {
+    f = htsmsg_pool_alloc();
+    flags |= HMF_POOLED;
+  } else {
+    f = malloc(fsize);
+  }
   if (f == NULL)
     return NULL;
   TAILQ_INSERT_TAIL(&msg->hm_fields, f, hmf_link);
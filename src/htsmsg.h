@@ -64,6 +64,7 @@ typedef struct htsmsg_field {
 #define HMF_ALLOCED        0x1
 #define HMF_INALLOCED      0x2
 #define HMF_NONAME         0x4
+#define HMF_POOLED         0x8
 
   union {
     int64_t  s64;
@@ -29,15 +29,22 @@
 /*
  *
  */
+/*
+ * Deserializer.  As in htsmsg_binary2.c, when the message owns the
+ * receive buffer (top_end != NULL) strings stay as pointers into it and
+ * are NUL terminated in place over the already decoded next header;
+ * *pending carries the terminator position across submessage bounds.
+ */
 static int
-htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
+htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len,
+                   const uint8_t *top_end, uint8_t **pending)
 {
   uint_fast32_t type, namelen, datalen;
   size_t tlen, nlen;
   htsmsg_field_t *f;
   htsmsg_t *sub;
   uint64_t u64;
-  int i, bin = 0;
+  int i, zc, bin = 0;
 
   while(len > 5) {
 
@@ -47,17 +54,30 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
               (((uint_fast32_t)buf[3]) << 16) |
               (((uint_fast32_t)buf[4]) << 8 ) |
               (((uint_fast32_t)buf[5])      );
-    
+
+    /* terminate the previous zero-copy string - the header decoded
+       above occupied its terminator position */
+    if(*pending) {
+      **pending = 0;
+      *pending = NULL;
+    }
+
     buf += 6;
     len -= 6;
-    
+
     if(len < namelen + datalen)
       return -1;
 
+    /* a string ending at the very end of the receive buffer has no room
+       for the in-place terminator and is copied instead */
+    zc = type == HMF_STR && top_end != NULL &&
+         buf + namelen + datalen != top_end;
+
     nlen = namelen ? htsmsg_malloc_align(type, namelen + 1) : 0;
     tlen = sizeof(htsmsg_field_t) + nlen;
     if (type == HMF_STR) {
-      tlen += datalen + 1;
+      if (!zc)
+        tlen += datalen + 1;
     } else if (type == HMF_LIST || type == HMF_MAP) {
       tlen += sizeof(htsmsg_t);
     } else if (type == HMF_UUID) {
@@ -87,10 +107,16 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
 
     switch(type) {
     case HMF_STR:
-      f->hmf_str = f->_hmf_name + nlen;
-      memcpy((char *)f->hmf_str, buf, datalen);
-      ((char *)f->hmf_str)[datalen] = 0;
-      f->hmf_flags |= HMF_INALLOCED;
+      if (zc) {
+        f->hmf_str = (const char *)buf;
+        *pending = (uint8_t *)buf + datalen;
+        bin = 1;
+      } else {
+        f->hmf_str = f->_hmf_name + nlen;
+        memcpy((char *)f->hmf_str, buf, datalen);
+        ((char *)f->hmf_str)[datalen] = 0;
+        f->hmf_flags |= HMF_INALLOCED;
+      }
       break;
 
     case HMF_UUID:
@@ -118,7 +144,7 @@ htsmsg_binary_des0(htsmsg_t *msg, const uint8_t *buf, size_t len)
       sub->hm_data = NULL;
       sub->hm_data_size = 0;
       sub->hm_islist = type == HMF_LIST;
-      i = htsmsg_binary_des0(sub, buf, datalen);
+      i = htsmsg_binary_des0(sub, buf, datalen, top_end, pending);
       if (i < 0) {
 #if ENABLE_SLOW_MEMORYINFO
         memoryinfo_free(&htsmsg_field_memoryinfo, tlen);
@@ -156,15 +182,21 @@ htsmsg_t *
 htsmsg_binary_deserialize0(const void *data, size_t len, const void *buf)
 {
   htsmsg_t *msg;
+  uint8_t *pending = NULL;
   int r;
 
   msg = htsmsg_create_map();
-  r = htsmsg_binary_des0(msg, data, len);
+  r = htsmsg_binary_des0(msg, data, len,
+                         buf ? (const uint8_t *)data + len : NULL, &pending);
   if (r < 0) {
     free((void *)buf);
     htsmsg_destroy(msg);
     return NULL;
   }
+  /* a zero-copy string as the very last field has its terminator still
+     pending - no following header was decoded to take the write */
+  if (pending)
+    *pending = 0;
   if (r > 0) {
     msg->hm_data = buf;
     msg->hm_data_size = len;
@@ -261,7 +293,7 @@ htsmsg_binary_count(htsmsg_t *msg)
  *
  */
 static void
-htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr)
+htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr, const void *skip)
 {
   htsmsg_field_t *f;
   uint64_t u64;
@@ -321,7 +353,7 @@ htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr)
     switch(f->hmf_type) {
     case HMF_MAP:
     case HMF_LIST:
-      htsmsg_binary_write(f->hmf_msg, ptr);
+      htsmsg_binary_write(f->hmf_msg, ptr, NULL);
       break;
 
     case HMF_STR:
@@ -329,6 +361,10 @@ htsmsg_binary_write(htsmsg_t *msg, uint8_t *ptr)
       break;
 
     case HMF_BIN:
+      if(f->hmf_bin == skip)
+	/* split serialization: the payload bytes stay in their own
+	   buffer, only the field header was emitted */
+	continue;
       memcpy(ptr, f->hmf_bin, l);
       break;
 
@@ -368,7 +404,7 @@ htsmsg_binary_serialize0(htsmsg_t *msg, void **datap, size_t *lenp, int maxlen)
 
   data = malloc(len);
 
-  htsmsg_binary_write(msg, data);
+  htsmsg_binary_write(msg, data, NULL);
   *datap = data;
   *lenp  = len;
   return 0;
@@ -394,8 +430,46 @@ htsmsg_binary_serialize(htsmsg_t *msg, void **datap, size_t *lenp, int maxlen)
   data[2] = len >> 8;
   data[3] = len;
 
-  htsmsg_binary_write(msg, data + 4);
+  htsmsg_binary_write(msg, data + 4, NULL);
   *datap = data;
   *lenp  = len + 4;
   return 0;
 }
+
+/*
+ * Serialize without copying the payload: 'payload' must be the data of
+ * the last field of 'msg' (added with htsmsg_add_bin_ptr()).  The
+ * returned buffer holds the length prefix, all other fields and the
+ * payload field header; the payload bytes themselves are meant to be
+ * sent straight from their original (refcounted) buffer.
+ */
+int
+htsmsg_binary_serialize_split(htsmsg_t *msg, void **hdrp, size_t *hdrlenp,
+			      const void *payload, size_t payloadlen,
+			      int maxlen)
+{
+  htsmsg_field_t *f;
+  size_t len;
+  uint8_t *data;
+
+  f = TAILQ_LAST(&msg->hm_fields, htsmsg_field_queue);
+  if(f == NULL || f->hmf_type != HMF_BIN ||
+     f->hmf_bin != payload || f->hmf_binsize != payloadlen)
+    return -1;
+
+  len = htsmsg_binary_count(msg);
+  if(len + 4 > maxlen)
+    return -1;
+
+  data = malloc(len + 4 - payloadlen);
+
+  data[0] = len >> 24;
+  data[1] = len >> 16;
+  data[2] = len >> 8;
+  data[3] = len;
+
+  htsmsg_binary_write(msg, data + 4, payload);
+  *hdrp    = data;
+  *hdrlenp = len + 4 - payloadlen;
+  return 0;
+}
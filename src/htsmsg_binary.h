@@ -36,4 +36,8 @@ int htsmsg_binary_serialize0(htsmsg_t *msg, void **datap, size_t *lenp,
 int htsmsg_binary_serialize(htsmsg_t *msg, void **datap, size_t *lenp,
 			    int maxlen);
 
+int htsmsg_binary_serialize_split(htsmsg_t *msg, void **hdrp, size_t *hdrlenp,
+				  const void *payload, size_t payloadlen,
+				  int maxlen);
+
 #endif /* HTSMSG_BINARY_H_ */
@@ -88,10 +88,17 @@ static inline uint32_t htsmsg_binary2_length_count(uint32_t len)
 }
 
 /*
- *
+ * Deserializer.  When the message takes ownership of the receive buffer
+ * (top_end != NULL), strings are kept as pointers into that buffer
+ * instead of being copied - mutators materialize them on demand via the
+ * usual HMF_ALLOCED path.  The wire format carries no NUL terminators,
+ * so each zero-copy string is terminated in place by overwriting the
+ * following field's header byte once that header has been decoded;
+ * *pending carries the terminator position across submessage bounds.
  */
 static int
-htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len)
+htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len,
+                    const uint8_t *top_end, uint8_t **pending)
 {
   uint_fast32_t type, namelen, datalen;
   const uint8_t *p;
@@ -99,7 +106,7 @@ htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len)
   htsmsg_field_t *f;
   htsmsg_t *sub;
   uint64_t u64;
-  int i, bin = 0;
+  int i, zc, bin = 0;
 
   while(len > 2) {
 
@@ -107,16 +114,30 @@ htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len)
     namelen  = buf[1];
     p        = buf + 2;
     datalen  = htsmsg_binary2_get_length(&p, buf + len);
+
+    /* terminate the previous zero-copy string - the header decoded
+       above occupied its terminator position */
+    if(*pending) {
+      **pending = 0;
+      *pending = NULL;
+    }
+
     len     -= p - buf;
     buf      = p;
 
     if(len < namelen + datalen)
       return -1;
 
+    /* a string ending at the very end of the receive buffer has no room
+       for the in-place terminator and is copied instead */
+    zc = type == HMF_STR && top_end != NULL &&
+         buf + namelen + datalen != top_end;
+
     nlen = namelen ? htsmsg_malloc_align(type, namelen + 1) : 0;
     tlen = sizeof(htsmsg_field_t) + nlen;
     if (type == HMF_STR) {
-      tlen += datalen + 1;
+      if (!zc)
+        tlen += datalen + 1;
     } else if (type == HMF_LIST || type == HMF_MAP) {
       tlen += sizeof(htsmsg_t);
     } else if (type == HMF_UUID) {
@@ -146,10 +167,16 @@ htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len)
 
     switch(type) {
     case HMF_STR:
-      f->hmf_str = f->_hmf_name + nlen;
-      memcpy((char *)f->hmf_str, buf, datalen);
-      ((char *)f->hmf_str)[datalen] = 0;
-      f->hmf_flags |= HMF_INALLOCED;
+      if (zc) {
+        f->hmf_str = (const char *)buf;
+        *pending = (uint8_t *)buf + datalen;
+        bin = 1;
+      } else {
+        f->hmf_str = f->_hmf_name + nlen;
+        memcpy((char *)f->hmf_str, buf, datalen);
+        ((char *)f->hmf_str)[datalen] = 0;
+        f->hmf_flags |= HMF_INALLOCED;
+      }
       break;
 
     case HMF_UUID:
@@ -177,7 +204,7 @@ htsmsg_binary2_des0(htsmsg_t *msg, const uint8_t *buf, uint32_t len)
       sub->hm_data = NULL;
       sub->hm_data_size = 0;
       sub->hm_islist = type == HMF_LIST;
-      i = htsmsg_binary2_des0(sub, buf, datalen);
+      i = htsmsg_binary2_des0(sub, buf, datalen, top_end, pending);
       if (i < 0) {
 #if ENABLE_SLOW_MEMORYINFO
         memoryinfo_free(&htsmsg_field_memoryinfo, tlen);
@@ -215,6 +242,7 @@ htsmsg_t *
 htsmsg_binary2_deserialize0(const void *data, size_t len, const void *buf)
 {
   htsmsg_t *msg;
+  uint8_t *pending = NULL;
   int r;
 
   if (len != (len & 0xffffffff)) {
@@ -222,12 +250,17 @@ htsmsg_binary2_deserialize0(const void *data, size_t len, const void *buf)
     return NULL;
   }
   msg = htsmsg_create_map();
-  r = htsmsg_binary2_des0(msg, data, len);
+  r = htsmsg_binary2_des0(msg, data, len,
+                          buf ? (const uint8_t *)data + len : NULL, &pending);
   if (r < 0) {
     free((void *)buf);
     htsmsg_destroy(msg);
     return NULL;
   }
+  /* a zero-copy string as the very last field has its terminator still
+     pending - no following header was decoded to take the write */
+  if (pending)
+    *pending = 0;
   if (r > 0) {
     msg->hm_data = buf;
     msg->hm_data_size = len;
@@ -30,65 +30,182 @@
 #include "misc/dbl.h"
 
 
+/*
+ * The serializer writes into a single growable buffer instead of going
+ * through htsbuf one small append at a time - large api grid responses
+ * spend most of their time here.  The finished buffer is handed over to
+ * the caller's queue without a copy.
+ */
+typedef struct jsonbuf {
+  char  *jb_data;
+  size_t jb_len;
+  size_t jb_size;
+} jsonbuf_t;
+
+static void
+jsonbuf_grow(jsonbuf_t *jb, size_t len)
+{
+  size_t size = jb->jb_size ?: 4096;
+
+  while (jb->jb_len + len > size)
+    size *= 2;
+  jb->jb_data = realloc(jb->jb_data, size);
+  jb->jb_size = size;
+}
+
+static inline void
+jsonbuf_reserve(jsonbuf_t *jb, size_t len)
+{
+  if (jb->jb_len + len > jb->jb_size)
+    jsonbuf_grow(jb, len);
+}
+
+static inline void
+jsonbuf_append(jsonbuf_t *jb, const char *buf, size_t len)
+{
+  jsonbuf_reserve(jb, len);
+  memcpy(jb->jb_data + jb->jb_len, buf, len);
+  jb->jb_len += len;
+}
+
+static inline void
+jsonbuf_append_char(jsonbuf_t *jb, char c)
+{
+  jsonbuf_reserve(jb, 1);
+  jb->jb_data[jb->jb_len++] = c;
+}
+
+/* Per-byte high bit set where the byte of x is zero */
+static inline uint64_t
+jsonbuf_swar_zero(uint64_t x)
+{
+  return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+}
+
+/*
+ * Escape a string - runs of plain bytes are scanned and copied eight
+ * bytes at a time; the byte-wise path is only entered for words that
+ * contain a quote, a backslash or a control character.
+ */
+static void
+jsonbuf_append_jsonstr(jsonbuf_t *jb, const char *str)
+{
+  const char *s = str, *e = str + strlen(str);
+  uint64_t v, m;
+  size_t n;
+  char *d, c;
+
+  /* worst case every byte doubles, plus the two quotes */
+  jsonbuf_reserve(jb, (e - s) * 2 + 2);
+  d = jb->jb_data + jb->jb_len;
+  *d++ = '"';
+  while (s != e) {
+    if ((size_t)(e - s) >= sizeof(v)) {
+      memcpy(&v, s, sizeof(v));
+      m = (((v - 0x2020202020202020ULL) & ~v) |            /* < 0x20 */
+           jsonbuf_swar_zero(v ^ 0x2222222222222222ULL) |  /* '"'    */
+           jsonbuf_swar_zero(v ^ 0x5c5c5c5c5c5c5c5cULL))   /* '\\'   */
+          & 0x8080808080808080ULL;
+      if (m == 0) {
+        memcpy(d, &v, sizeof(v));
+        d += sizeof(v);
+        s += sizeof(v);
+        continue;
+      }
+      n = sizeof(v);
+    } else {
+      n = e - s;
+    }
+    while (n--) {
+      c = *s++;
+      switch (c) {
+      case '"':  *d++ = '\\'; *d++ = '"';  break;
+      case '\\': *d++ = '\\'; *d++ = '\\'; break;
+      case '\n': *d++ = '\\'; *d++ = 'n';  break;
+      case '\r': *d++ = '\\'; *d++ = 'r';  break;
+      case '\t': *d++ = '\\'; *d++ = 't';  break;
+      default:   *d++ = c;                 break;
+      }
+    }
+  }
+  *d++ = '"';
+  jb->jb_len = d - jb->jb_data;
+}
+
+static void
+jsonbuf_append_s64(jsonbuf_t *jb, int64_t s64)
+{
+  char buf[24], *p = buf + sizeof(buf);
+  uint64_t u = s64 < 0 ? -(uint64_t)s64 : s64;
+
+  do {
+    *--p = '0' + (u % 10);
+    u /= 10;
+  } while (u);
+  if (s64 < 0)
+    *--p = '-';
+  jsonbuf_append(jb, p, buf + sizeof(buf) - p);
+}
+
 /**
  *
  */
 static void
-htsmsg_json_write(htsmsg_t *msg, htsbuf_queue_t *hq, int isarray,
+htsmsg_json_write(htsmsg_t *msg, jsonbuf_t *jb, int isarray,
 		  int indent, int pretty)
 {
   htsmsg_field_t *f;
   char buf[100];
   static const char *indentor = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
-  const char *s;
 
-  htsbuf_append(hq, isarray ? "[" : "{", 1);
+  jsonbuf_append_char(jb, isarray ? '[' : '{');
 
   TAILQ_FOREACH(f, &msg->hm_fields, hmf_link) {
 
-    if(pretty) 
-      htsbuf_append(hq, indentor, indent < 16 ? indent : 16);
+    if(pretty)
+      jsonbuf_append(jb, indentor, indent < 16 ? indent : 16);
 
     if(!isarray) {
-      htsbuf_append_and_escape_jsonstr(hq, htsmsg_field_name(f));
-      htsbuf_append(hq, ": ", pretty ? 2 : 1);
+      jsonbuf_append_jsonstr(jb, htsmsg_field_name(f));
+      jsonbuf_append(jb, ": ", pretty ? 2 : 1);
     }
 
     switch(f->hmf_type) {
     case HMF_MAP:
-      htsmsg_json_write(f->hmf_msg, hq, 0, indent + 1, pretty);
+      htsmsg_json_write(f->hmf_msg, jb, 0, indent + 1, pretty);
       break;
 
     case HMF_LIST:
-      htsmsg_json_write(f->hmf_msg, hq, 1, indent + 1, pretty);
+      htsmsg_json_write(f->hmf_msg, jb, 1, indent + 1, pretty);
       break;
 
     case HMF_STR:
-      htsbuf_append_and_escape_jsonstr(hq, f->hmf_str);
+      jsonbuf_append_jsonstr(jb, f->hmf_str);
       break;
 
     case HMF_UUID:
       uuid_get_hex((tvh_uuid_t *)f->hmf_uuid, buf);
-      htsbuf_append_and_escape_jsonstr(hq, buf);
+      jsonbuf_append_jsonstr(jb, buf);
       break;
 
     case HMF_BIN:
-      htsbuf_append_and_escape_jsonstr(hq, "binary");
+      jsonbuf_append_jsonstr(jb, "binary");
       break;
 
     case HMF_BOOL:
-      s = f->hmf_bool ? "true" : "false";
-      htsbuf_append_str(hq, s);
+      if (f->hmf_bool)
+        jsonbuf_append(jb, "true", 4);
+      else
+        jsonbuf_append(jb, "false", 5);
       break;
 
     case HMF_S64:
-      snprintf(buf, sizeof(buf), "%" PRId64, f->hmf_s64);
-      htsbuf_append_str(hq, buf);
+      jsonbuf_append_s64(jb, f->hmf_s64);
       break;
 
     case HMF_DBL:
       my_double2str(buf, sizeof(buf), f->hmf_dbl);
-      htsbuf_append_str(hq, buf);
+      jsonbuf_append(jb, buf, strlen(buf));
       break;
 
     default:
@@ -96,12 +213,23 @@ htsmsg_json_write(htsmsg_t *msg, htsbuf_queue_t *hq, int isarray,
     }
 
     if(TAILQ_NEXT(f, hmf_link))
-      htsbuf_append(hq, ",", 1);
+      jsonbuf_append_char(jb, ',');
   }
-  
-  if(pretty) 
-    htsbuf_append(hq, indentor, indent-1 < 16 ? indent-1 : 16);
-  htsbuf_append(hq, isarray ? "]" : "}", 1);
+
+  if(pretty)
+    jsonbuf_append(jb, indentor, indent-1 < 16 ? indent-1 : 16);
+  jsonbuf_append_char(jb, isarray ? ']' : '}');
+}
+
+/**
+ *
+ */
+static void
+htsmsg_json_write_msg(htsmsg_t *msg, jsonbuf_t *jb, int pretty)
+{
+  htsmsg_json_write(msg, jb, msg->hm_islist, 2, pretty);
+  if(pretty)
+    jsonbuf_append_char(jb, '\n');
 }
 
 /**
@@ -110,9 +238,11 @@ htsmsg_json_write(htsmsg_t *msg, htsbuf_queue_t *hq, int isarray,
 void
 htsmsg_json_serialize(htsmsg_t *msg, htsbuf_queue_t *hq, int pretty)
 {
-  htsmsg_json_write(msg, hq, msg->hm_islist, 2, pretty);
-  if(pretty) 
-    htsbuf_append(hq, "\n", 1);
+  jsonbuf_t jb = { 0 };
+
+  htsmsg_json_write_msg(msg, &jb, pretty);
+  /* the queue takes ownership of the buffer */
+  htsbuf_append_prealloc(hq, jb.jb_data, jb.jb_len);
 }
 
 
@@ -122,13 +252,11 @@ htsmsg_json_serialize(htsmsg_t *msg, htsbuf_queue_t *hq, int pretty)
 char *
 htsmsg_json_serialize_to_str(htsmsg_t *msg, int pretty)
 {
-  htsbuf_queue_t hq;
-  char *str;
-  htsbuf_queue_init(&hq, 0);
-  htsmsg_json_serialize(msg, &hq, pretty);
-  str = htsbuf_to_string(&hq);
-  htsbuf_queue_flush(&hq);
-  return str;
+  jsonbuf_t jb = { 0 };
+
+  htsmsg_json_write_msg(msg, &jb, pretty);
+  jsonbuf_append_char(&jb, 0);
+  return jb.jb_data;
 }
 
 
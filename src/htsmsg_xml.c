@@ -858,6 +858,179 @@ htsmsg_xml_deserialize(char *src, char *errbuf, size_t errbufsize)
   return NULL;
 }
 
+/**
+ * Streaming (SAX-style) variant: instead of building a DOM for the whole
+ * document, deserialize each direct child element of the named root element
+ * into its own htsmsg and hand it to the callback, destroying it again
+ * before the next child is parsed. Memory use is thus bounded by the
+ * largest single child element, not the document size. The strings in the
+ * per-child messages point into 'src', which stays valid for the duration
+ * of the parse and is freed (always) before returning.
+ *
+ * Returns 0 on success, -1 on parse errors (with errbuf filled in).
+ */
+int
+htsmsg_xml_deserialize_stream(char *src, const char *root,
+                              void (*cb)(void *opaque, const char *name,
+                                         htsmsg_t *msg),
+                              void *opaque,
+                              char *errbuf, size_t errbufsize)
+{
+  xmlparser_t xp;
+  htsmsg_t *attrs, *container;
+  htsmsg_field_t *f;
+  struct xmlns_list nslist;
+  xmlns_t *ns;
+  char *src0 = src, *tagname;
+  int taglen, empty = 0;
+
+  memset(&xp, 0, sizeof(xp));
+  xp.xp_encoding = XML_ENCODING_UTF8;
+  LIST_INIT(&xp.xp_namespaces);
+  LIST_INIT(&nslist);
+
+  /* check for UTF-8 BOM */
+  if(src[0] == 0xef && src[1] == 0xbb && src[2] == 0xbf)
+    memmove(src, src + 3, strlen(src) - 2);
+
+  if((src = htsmsg_parse_prolog(&xp, src)) == NULL)
+    goto err;
+
+  /* Locate the root element open tag */
+  while(1) {
+    while(*src != 0 && *src != '<')
+      src++;
+    if(*src == 0) {
+      xmlerr(&xp, "Root element <%s> not found", root);
+      goto err;
+    }
+    src++;
+    if(*src == '?') {
+      src++;
+      if((src = htsmsg_xml_parse_pi(&xp, NULL, src)) == NULL)
+	goto err;
+      continue;
+    }
+    if(src[0] == '!' && src[1] == '-' && src[2] == '-') {
+      if((src = xml_parse_comment(&xp, src + 3)) == NULL)
+	goto err;
+      continue;
+    }
+    if(*src == '!') {
+      xmlerr(&xp, "Unknown syntatic element: <!%.10s", src + 1);
+      goto err;
+    }
+    break;
+  }
+
+  tagname = src;
+  while(*src != 0 && !is_xmlws(*src) && *src != '>' && *src != '/')
+    src++;
+  taglen = src - tagname;
+  if(taglen < 1 || taglen > 65535) {
+    xmlerr(&xp, "Invalid tag name");
+    goto err;
+  }
+  if(taglen != (int)strlen(root) || strncmp(tagname, root, taglen)) {
+    xmlerr(&xp, "Root element is not <%s>", root);
+    goto err;
+  }
+
+  /* Root attributes are only scanned for namespace declarations */
+  attrs = htsmsg_create_map();
+  while(1) {
+    while(is_xmlws(*src))
+      src++;
+    if(*src == 0) {
+      htsmsg_destroy(attrs);
+      xmlerr(&xp, "Unexpected end of file in tag");
+      goto err;
+    }
+    if(src[0] == '/' && src[1] == '>') {
+      empty = 1;
+      src += 2;
+      break;
+    }
+    if(*src == '>') {
+      src++;
+      break;
+    }
+    if((src = htsmsg_xml_parse_attrib(&xp, attrs, src, &nslist)) == NULL) {
+      htsmsg_destroy(attrs);
+      goto err;
+    }
+  }
+  htsmsg_destroy(attrs);
+
+  /* Deliver each direct child element to the callback */
+  while(!empty && *src != 0) {
+    if(*src != '<') {
+      src++;       /* character data between children is skipped */
+      continue;
+    }
+    src++;
+    if(*src == '?') {
+      src++;
+      if((src = htsmsg_xml_parse_pi(&xp, NULL, src)) == NULL)
+	goto err;
+      continue;
+    }
+    if(src[0] == '!') {
+      src++;
+      if(src[0] == '-' && src[1] == '-') {
+	if((src = xml_parse_comment(&xp, src + 2)) == NULL)
+	  goto err;
+	continue;
+      }
+      if(!strncmp(src, "[CDATA[", 7)) {
+	src += 7;
+	while(*src != 0 && !(src[0] == ']' && src[1] == ']' && src[2] == '>'))
+	  src++;
+	if(*src != 0)
+	  src += 3;
+	continue;
+      }
+      xmlerr(&xp, "Unknown syntatic element: <!%.10s", src);
+      goto err;
+    }
+    if(*src == '/') {
+      /* Root end-tag */
+      while(*src != 0 && *src != '>')
+	src++;
+      if(*src != 0)
+	src++;
+      break;
+    }
+
+    container = htsmsg_create_map();
+    if((src = htsmsg_xml_parse_tag(&xp, container, src)) == NULL) {
+      htsmsg_destroy(container);
+      goto err;
+    }
+    if((f = TAILQ_FIRST(&container->hm_fields)) != NULL)
+      cb(opaque, htsmsg_field_name(f), htsmsg_get_map_by_field(f));
+    htsmsg_destroy(container);
+  }
+
+  while((ns = LIST_FIRST(&nslist)) != NULL)
+    xmlns_destroy(ns);
+  free(src0);
+  return 0;
+
+ err:
+  while((ns = LIST_FIRST(&nslist)) != NULL)
+    xmlns_destroy(ns);
+  free(src0);
+  snprintf(errbuf, errbufsize, "%s", xp.xp_errmsg);
+
+  /* Remove any odd chars inside of errmsg */
+  for ( ; *errbuf; errbuf++)
+    if (*errbuf < ' ')
+      *errbuf = ' ';
+
+  return -1;
+}
+
 /*
  * Get cdata string field
  */
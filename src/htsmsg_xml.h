@@ -23,6 +23,11 @@
 #include "htsbuf.h"
 
 htsmsg_t *htsmsg_xml_deserialize(char *src, char *errbuf, size_t errbufsize);
+int htsmsg_xml_deserialize_stream(char *src, const char *root,
+                                  void (*cb)(void *opaque, const char *name,
+                                             htsmsg_t *msg),
+                                  void *opaque,
+                                  char *errbuf, size_t errbufsize);
 const char *htsmsg_xml_get_cdata_str (htsmsg_t *tags, const char *tag);
 int htsmsg_xml_get_cdata_u32 (htsmsg_t *tags, const char *tag, uint32_t *u32);
 const char *htsmsg_xml_get_attr_str(htsmsg_t *tag, const char *attr);
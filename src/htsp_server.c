@@ -18,6 +18,8 @@
 
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
 
 #include "tvheadend.h"
 #include "atomic.h"
@@ -59,6 +61,12 @@ static void *htsp_server, *htsp_server_2;
 
 #define HTSP_ASYNC_EPG_INTERVAL 30
 
+/* max events pushed per chunk of the async epg dump */
+#define HTSP_EPG_DUMP_CHUNK 128
+
+/* max queued messages serialized into one writev() batch */
+#define HTSP_WRITE_MAXIOV 32
+
 #define HTSP_PRIV_MASK (ACCESS_HTSP_STREAMING)
 
 extern char *dvr_storage;
@@ -134,6 +142,15 @@ typedef struct htsp_connection {
   int64_t  htsp_epg_lastupdate;  // last update time for async epg events
   mtimer_t htsp_epg_timer;       // timer for async epg updates
 
+  /* chunked epg dump: the full walk is split into bounded chunks driven
+     from the mainloop so global_lock is released in between */
+  mtimer_t htsp_epg_dump_timer;
+  int64_t  htsp_epg_dump_mintime;
+  int64_t  htsp_epg_dump_evstart;     // resume cursor: last sent event start
+  uint32_t htsp_epg_dump_chid;        // resume cursor: current channel id
+  uint8_t  htsp_epg_dump_active;
+  uint8_t  htsp_epg_dump_synccomplete; // send initialSyncCompleted when done
+
   /**
    * Async mode
    */
@@ -165,8 +182,50 @@ typedef struct htsp_connection {
 
   uint8_t htsp_challenge[32];
 
+  char htsp_resume_token[33]; /* handed out with enableAsyncMetadata */
+
 } htsp_connection_t;
 
+/**
+ * Resumable async sessions
+ *
+ * When an async client disconnects, remember which metadata generation
+ * it was synced to for a short while. A reconnecting client presenting
+ * its resume token skips the full channel/tag/DVR dump when nothing
+ * changed while it was away; otherwise it falls back to the full sync.
+ */
+#define HTSP_RESUME_TIMEOUT 600 /* seconds */
+
+/* object classes versioned separately for the differential sync */
+enum {
+  HTSP_GEN_CHANNEL,
+  HTSP_GEN_TAG,
+  HTSP_GEN_DVR,
+  HTSP_GEN_AUTOREC,
+  HTSP_GEN_TIMEREC,
+  HTSP_GEN_COUNT
+};
+
+typedef struct htsp_resume {
+  LIST_ENTRY(htsp_resume) hr_link;
+  char hr_token[33];
+  char *hr_username;
+  uint64_t hr_generation[HTSP_GEN_COUNT]; /* sync state at disconnect */
+  int hr_access_gen;            /* access config generation */
+  mtimer_t hr_timer;
+} htsp_resume_t;
+
+static LIST_HEAD(, htsp_resume) htsp_resume_sessions;
+
+/* per-class generation vector, bumped on every async metadata change */
+static uint64_t htsp_class_generation[HTSP_GEN_COUNT];
+
+static inline void
+htsp_gen_bump(int cls)
+{
+  htsp_class_generation[cls]++;
+}
+
 
 /**
  *
@@ -1639,6 +1698,78 @@ htsp_method_getSysTime(htsp_connection_t *htsp, htsmsg_t *in)
   return out;
 }
 
+/**
+ * Resumable async session helpers
+ */
+static void
+htsp_resume_destroy(htsp_resume_t *hr)
+{
+  mtimer_disarm(&hr->hr_timer);
+  LIST_REMOVE(hr, hr_link);
+  free(hr->hr_username);
+  free(hr);
+}
+
+static void
+htsp_resume_timeout_cb(void *aux)
+{
+  htsp_resume_destroy((htsp_resume_t *)aux);
+}
+
+static const char *
+htsp_resume_token_issue(htsp_connection_t *htsp)
+{
+  uint8_t rnd[16];
+
+  if (htsp->htsp_resume_token[0] == '\0') {
+    uuid_random(rnd, sizeof(rnd));
+    bin2hex(htsp->htsp_resume_token, sizeof(htsp->htsp_resume_token),
+            rnd, sizeof(rnd));
+  }
+  return htsp->htsp_resume_token;
+}
+
+static void
+htsp_resume_save(htsp_connection_t *htsp)
+{
+  htsp_resume_t *hr;
+
+  lock_assert(&global_lock);
+
+  if (htsp->htsp_resume_token[0] == '\0' ||
+      (htsp->htsp_async_mode & HTSP_ASYNC_ON) == 0)
+    return;
+  hr = calloc(1, sizeof(*hr));
+  strcpy(hr->hr_token, htsp->htsp_resume_token);
+  hr->hr_username = strdup(htsp->htsp_username ?: "");
+  memcpy(hr->hr_generation, htsp_class_generation, sizeof(hr->hr_generation));
+  hr->hr_access_gen = access_generation();
+  LIST_INSERT_HEAD(&htsp_resume_sessions, hr, hr_link);
+  mtimer_arm_rel(&hr->hr_timer, htsp_resume_timeout_cb, hr,
+                 sec2mono(HTSP_RESUME_TIMEOUT));
+}
+
+static int
+htsp_resume_try(htsp_connection_t *htsp, const char *token, uint64_t *gens)
+{
+  htsp_resume_t *hr;
+  int ok;
+
+  lock_assert(&global_lock);
+
+  LIST_FOREACH(hr, &htsp_resume_sessions, hr_link)
+    if (strcmp(hr->hr_token, token) == 0)
+      break;
+  if (hr == NULL)
+    return 0;
+  ok = strcmp(hr->hr_username, htsp->htsp_username ?: "") == 0 &&
+       hr->hr_access_gen == access_generation();
+  if (ok)
+    memcpy(gens, hr->hr_generation, sizeof(uint64_t) * HTSP_GEN_COUNT);
+  htsp_resume_destroy(hr); /* tokens are one-shot */
+  return ok;
+}
+
 /**
  * Switch the HTSP connection into async mode
  */
@@ -1654,7 +1785,9 @@ htsp_method_async(htsp_connection_t *htsp, htsmsg_t *in)
   uint32_t epg = 0;
   int64_t lastUpdate = -1;
   int64_t epgMaxTime = 0;
-  const char *lang;
+  const char *lang, *token;
+  uint64_t gens[HTSP_GEN_COUNT];
+  int resume = 0;
 
   /* Get optional flags, allow updating them if already in async mode */
   if (htsmsg_get_u32(in, "epg", &epg))
@@ -1685,8 +1818,11 @@ htsp_method_async(htsp_connection_t *htsp, htsmsg_t *in)
     }
   }
 
-  /* First, just OK the async request */
-  htsp_reply(htsp, in, htsmsg_create_map());
+  /* First, just OK the async request; the token lets the client resume
+     a short-lived reconnect without the full dump */
+  m = htsmsg_create_map();
+  htsmsg_add_str(m, "resumeToken", htsp_resume_token_issue(htsp));
+  htsp_reply(htsp, in, m);
 
   /* Set epg */
   if(epg)
@@ -1703,44 +1839,98 @@ htsp_method_async(htsp_connection_t *htsp, htsmsg_t *in)
 
   htsp->htsp_async_mode |= HTSP_ASYNC_ON;
 
-  /* Send all enabled and external tags */
-  TAILQ_FOREACH(ct, &channel_tags, ct_link)
-    if(channel_tag_access(ct, htsp->htsp_granted_access, 0))
-      htsp_send_message(htsp, htsp_build_tag(htsp, ct, "tagAdd", 0), NULL);
+  /* Differential sync: the resume token pins the per-class generation
+     vector the client was last synced to, so only classes that changed
+     while it was away are dumped again */
+  if ((token = htsmsg_get_str(in, "resumeToken")) != NULL &&
+      htsp_resume_try(htsp, token, gens)) {
+    resume = 1;
+    tvhinfo(LS_HTSP, "%s: session resumed, differential sync",
+            htsp->htsp_logname);
+  }
 
-  /* Send all channels */
-  CHANNEL_FOREACH(ch)
-    if (htsp_user_access_channel(htsp,ch))
-      htsp_send_message(htsp, htsp_build_channel(ch, "channelAdd", htsp), NULL);
+#define HTSP_STALE(cls) \
+  (!resume || gens[cls] != htsp_class_generation[cls])
 
-  /* Send all enabled and external tags (now with channel mappings) */
-  TAILQ_FOREACH(ct, &channel_tags, ct_link)
-    if(channel_tag_access(ct, htsp->htsp_granted_access, 0))
-      htsp_send_message(htsp, htsp_build_tag(htsp, ct, "tagUpdate", 1), NULL);
+  /* Tag membership references channel ids, so tags are re-sent when
+     either class moved on */
+  if (HTSP_STALE(HTSP_GEN_TAG) || HTSP_STALE(HTSP_GEN_CHANNEL)) {
 
-  /* Send all autorecs */
-  TAILQ_FOREACH(dae, &autorec_entries, dae_link)
-    if (!dvr_autorec_entry_verify(dae, htsp->htsp_granted_access, 1))
-      htsp_send_message(htsp, htsp_build_autorecentry(htsp, dae, "autorecEntryAdd"), NULL);
+    /* Send all enabled and external tags */
+    TAILQ_FOREACH(ct, &channel_tags, ct_link)
+      if(channel_tag_access(ct, htsp->htsp_granted_access, 0))
+        htsp_send_message(htsp, htsp_build_tag(htsp, ct, "tagAdd", 0), NULL);
+  }
 
-  /* Send all timerecs */
-  TAILQ_FOREACH(dte, &timerec_entries, dte_link)
-    if (!dvr_timerec_entry_verify(dte, htsp->htsp_granted_access, 1))
-      htsp_send_message(htsp, htsp_build_timerecentry(htsp, dte, "timerecEntryAdd"), NULL);
+  if (HTSP_STALE(HTSP_GEN_CHANNEL)) {
 
-  /* Send all DVR entries */
-  LIST_FOREACH(de, &dvrentries, de_global_link)
-    if (!dvr_entry_verify(de, htsp->htsp_granted_access, 1))
-      htsp_send_message(htsp, htsp_build_dvrentry(htsp, de, "dvrEntryAdd", htsp->htsp_language, 0), NULL);
+    /* Send all channels */
+    CHANNEL_FOREACH(ch)
+      if (htsp_user_access_channel(htsp,ch))
+        htsp_send_message(htsp, htsp_build_channel(ch, "channelAdd", htsp), NULL);
 
-  /* Send EPG updates */
-  if (epg)
-    htsp_epg_send_waiting(htsp, -1);
+  } else {
 
-  /* Notify that initial sync has been completed */
-  m = htsmsg_create_map();
-  htsmsg_add_str(m, "method", "initialSyncCompleted");
-  htsp_send_message(htsp, m, NULL);
+    /* Unchanged lineup - just refresh the cheap now/next references */
+    CHANNEL_FOREACH(ch)
+      if (htsp_user_access_channel(htsp, ch)) {
+        m = htsmsg_create_map();
+        htsmsg_add_str(m, "method", "channelUpdate");
+        htsmsg_add_u32(m, "channelId", channel_get_id(ch));
+        htsmsg_add_u32(m, "eventId",
+                       ch->ch_epg_now ? ch->ch_epg_now->id : 0);
+        htsmsg_add_u32(m, "nextEventId",
+                       ch->ch_epg_next ? ch->ch_epg_next->id : 0);
+        htsp_send_message(htsp, m, NULL);
+      }
+  }
+
+  if (HTSP_STALE(HTSP_GEN_TAG) || HTSP_STALE(HTSP_GEN_CHANNEL)) {
+
+    /* Send all enabled and external tags (now with channel mappings) */
+    TAILQ_FOREACH(ct, &channel_tags, ct_link)
+      if(channel_tag_access(ct, htsp->htsp_granted_access, 0))
+        htsp_send_message(htsp, htsp_build_tag(htsp, ct, "tagUpdate", 1), NULL);
+  }
+
+  if (HTSP_STALE(HTSP_GEN_AUTOREC)) {
+
+    /* Send all autorecs */
+    TAILQ_FOREACH(dae, &autorec_entries, dae_link)
+      if (!dvr_autorec_entry_verify(dae, htsp->htsp_granted_access, 1))
+        htsp_send_message(htsp, htsp_build_autorecentry(htsp, dae, "autorecEntryAdd"), NULL);
+  }
+
+  if (HTSP_STALE(HTSP_GEN_TIMEREC)) {
+
+    /* Send all timerecs */
+    TAILQ_FOREACH(dte, &timerec_entries, dte_link)
+      if (!dvr_timerec_entry_verify(dte, htsp->htsp_granted_access, 1))
+        htsp_send_message(htsp, htsp_build_timerecentry(htsp, dte, "timerecEntryAdd"), NULL);
+  }
+
+  if (HTSP_STALE(HTSP_GEN_DVR)) {
+
+    /* Send all DVR entries */
+    dvr_entry_hydrate();
+    LIST_FOREACH(de, &dvrentries, de_global_link)
+      if (!dvr_entry_verify(de, htsp->htsp_granted_access, 1))
+        htsp_send_message(htsp, htsp_build_dvrentry(htsp, de, "dvrEntryAdd", htsp->htsp_language, 0), NULL);
+  }
+
+#undef HTSP_STALE
+
+  /* Send EPG updates; initialSyncCompleted follows once the chunked
+     dump has finished */
+  if (epg) {
+    htsp->htsp_epg_dump_synccomplete = 1;
+    htsp_epg_send_waiting(htsp, resume ? lastUpdate : -1);
+  } else {
+    /* Notify that initial sync has been completed */
+    m = htsmsg_create_map();
+    htsmsg_add_str(m, "method", "initialSyncCompleted");
+    htsp_send_message(htsp, m, NULL);
+  }
 
   /* Insert in list so it will get all updates */
   LIST_INSERT_HEAD(&htsp_async_connections, htsp, htsp_async_link);
@@ -2677,6 +2867,11 @@ htsp_method_subscribe(htsp_connection_t *htsp, htsmsg_t *in)
 						 HTSP_DEFAULT_QUEUE_DEPTH);
   htsp_init_queue(&hs->hs_q, 0);
 
+  /* keep the kernel-buffered backlog in the same order of magnitude as
+     the queue depth, so slow clients surface in the drop heuristics
+     instead of hiding behind the socket buffer */
+  tcp_socket_notsent_lowat(htsp->htsp_fd, hs->hs_queue_depth / 2);
+
   hs->hs_sid = sid;
   streaming_target_init(&hs->hs_input, &htsp_streaming_input_ops, hs, 0);
 
@@ -3490,49 +3685,114 @@ htsp_write_scheduler(void *aux)
 {
   htsp_connection_t *htsp = aux;
   htsp_msg_q_t *hmq;
-  htsp_msg_t *hm;
-  void *dptr;
+  htsp_msg_t *hm, *batch[HTSP_WRITE_MAXIOV];
+  /* a split-serialized muxpkt uses two iovec entries (header + payload) */
+  struct iovec iov[HTSP_WRITE_MAXIOV * 2], wiov[HTSP_WRITE_MAXIOV * 2];
+  void *dptr, *bufs[HTSP_WRITE_MAXIOV];
   size_t dlen;
-  int r;
+  int cnt, n, nbufs, i, r;
+  tprofile_t tprofile;
+  char tpname[64];
+#ifdef TCP_CORK
+  int cork;
+#endif
+
+  snprintf(tpname, sizeof(tpname), "htsp-write %s", htsp->htsp_logname ?: "?");
+  tprofile_init(&tprofile, tpname);
 
   tvh_mutex_lock(&htsp->htsp_out_mutex);
 
   while(htsp->htsp_writer_run) {
 
-    if((hmq = TAILQ_FIRST(&htsp->htsp_active_output_queues)) == NULL) {
+    if(TAILQ_FIRST(&htsp->htsp_active_output_queues) == NULL) {
       /* Nothing to be done, go to sleep */
       tvh_cond_wait(&htsp->htsp_out_cond, &htsp->htsp_out_mutex);
       continue;
     }
 
-    hm = TAILQ_FIRST(&hmq->hmq_q);
-    TAILQ_REMOVE(&hmq->hmq_q, hm, hm_link);
-    hmq->hmq_length--;
-    hmq->hmq_payload -= hm->hm_payloadsize;
+    /* Drain what is already queued (up to the batch limit) so the whole
+       batch goes out with a single writev(); nothing waits for more
+       messages, so no latency is added */
+    cnt = 0;
+    while(cnt < HTSP_WRITE_MAXIOV &&
+          (hmq = TAILQ_FIRST(&htsp->htsp_active_output_queues)) != NULL) {
 
-    TAILQ_REMOVE(&htsp->htsp_active_output_queues, hmq, hmq_link);
-    if(hmq->hmq_length) {
-      /* Still messages to be sent, put back in active queues */
-      if(hmq->hmq_strict_prio) {
-        TAILQ_INSERT_HEAD(&htsp->htsp_active_output_queues, hmq, hmq_link);
-      } else {
-        TAILQ_INSERT_TAIL(&htsp->htsp_active_output_queues, hmq, hmq_link);
+      hm = TAILQ_FIRST(&hmq->hmq_q);
+      TAILQ_REMOVE(&hmq->hmq_q, hm, hm_link);
+      hmq->hmq_length--;
+      hmq->hmq_payload -= hm->hm_payloadsize;
+
+      TAILQ_REMOVE(&htsp->htsp_active_output_queues, hmq, hmq_link);
+      if(hmq->hmq_length) {
+        /* Still messages to be sent, put back in active queues */
+        if(hmq->hmq_strict_prio) {
+          TAILQ_INSERT_HEAD(&htsp->htsp_active_output_queues, hmq, hmq_link);
+        } else {
+          TAILQ_INSERT_TAIL(&htsp->htsp_active_output_queues, hmq, hmq_link);
+        }
       }
+
+      batch[cnt++] = hm;
     }
 
     tvh_mutex_unlock(&htsp->htsp_out_mutex);
 
-    if (htsmsg_binary_serialize(hm->hm_msg, &dptr, &dlen, INT32_MAX) != 0) {
-      tvhwarn(LS_HTSP, "%s: failed to serialize data", htsp->htsp_logname);
-      htsp_msg_destroy(hm);
-      tvh_mutex_lock(&htsp->htsp_out_mutex);
-      continue;
+    tprofile_start(&tprofile, "write");
+
+    n = nbufs = 0;
+    for (i = 0; i < cnt; i++) {
+      hm = batch[i];
+      if (hm->hm_pb &&
+          htsmsg_binary_serialize_split(hm->hm_msg, &dptr, &dlen,
+                                        pktbuf_ptr(hm->hm_pb),
+                                        pktbuf_len(hm->hm_pb),
+                                        INT32_MAX) == 0) {
+        /* muxpkt fast path: the payload goes out straight from the
+           refcounted packet buffer, only the headers are copied */
+        bufs[nbufs++] = dptr;
+        iov[n].iov_base = dptr;
+        iov[n].iov_len = dlen;
+        n++;
+        iov[n].iov_base = pktbuf_ptr(hm->hm_pb);
+        iov[n].iov_len = pktbuf_len(hm->hm_pb);
+        n++;
+        continue;
+      }
+      if (htsmsg_binary_serialize(hm->hm_msg, &dptr, &dlen, INT32_MAX) != 0) {
+        tvhwarn(LS_HTSP, "%s: failed to serialize data", htsp->htsp_logname);
+        continue;
+      }
+      bufs[nbufs++] = dptr;
+      iov[n].iov_base = dptr;
+      iov[n].iov_len = dlen;
+      n++;
     }
 
-    htsp_msg_destroy(hm);
+#ifdef TCP_CORK
+    cork = n > 1;
+    if (cork) {
+      i = 1;
+      setsockopt(htsp->htsp_fd, IPPROTO_TCP, TCP_CORK, &i, sizeof(i));
+    }
+#endif
+    /* tvh_writev() modifies the iovec array on partial writes, keep the
+       original pointers for the frees below */
+    memcpy(wiov, iov, n * sizeof(*iov));
+    r = n > 0 ? tvh_writev(htsp->htsp_fd, wiov, n) : 0;
+#ifdef TCP_CORK
+    if (cork) {
+      i = 0;
+      setsockopt(htsp->htsp_fd, IPPROTO_TCP, TCP_CORK, &i, sizeof(i));
+    }
+#endif
+    /* the messages keep their payload pktbufs referenced until here */
+    for (i = 0; i < cnt; i++)
+      htsp_msg_destroy(batch[i]);
+    for (i = 0; i < nbufs; i++)
+      free(bufs[i]);
+
+    tprofile_finish(&tprofile);
 
-    r = tvh_write(htsp->htsp_fd, dptr, dlen);
-    free(dptr);
     tvh_mutex_lock(&htsp->htsp_out_mutex);
 
     if (r) {
@@ -3545,6 +3805,7 @@ htsp_write_scheduler(void *aux)
 
   shutdown(htsp->htsp_fd, SHUT_RDWR);
   tvh_mutex_unlock(&htsp->htsp_out_mutex);
+  tprofile_done(&tprofile);
   return NULL;
 }
 
@@ -3604,11 +3865,15 @@ htsp_serve(int fd, void **opaque, struct sockaddr_storage *source,
 
   tvh_mutex_lock(&global_lock);
 
+  /* allow the client to resume without a full dump for a while */
+  htsp_resume_save(&htsp);
+
   /* no async notifications from now */
   if(htsp.htsp_async_mode)
     LIST_REMOVE(&htsp, htsp_async_link);
 
   mtimer_disarm(&htsp.htsp_epg_timer);
+  mtimer_disarm(&htsp.htsp_epg_dump_timer);
 
   /* deregister this client */
   LIST_REMOVE(&htsp, htsp_link);
@@ -3706,7 +3971,11 @@ htsp_register(void)
 void
 htsp_done(void)
 {
+  htsp_resume_t *hr;
+
   tvh_mutex_lock(&global_lock);
+  while ((hr = LIST_FIRST(&htsp_resume_sessions)) != NULL)
+    htsp_resume_destroy(hr);
   if (htsp_server_2)
     tcp_server_delete(htsp_server_2);
   if (htsp_server)
@@ -3760,6 +4029,10 @@ static void
 _htsp_channel_update(channel_t *ch, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  /* now/next refreshes (msg != NULL) are replayed on session resume,
+     so only real channel changes invalidate the cached generation */
+  if (msg == NULL)
+    htsp_gen_bump(HTSP_GEN_CHANNEL);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON)
       if (htsp_user_access_channel(htsp,ch)) {
@@ -3821,6 +4094,7 @@ htsp_channel_delete(channel_t *ch)
   htsmsg_t *m = htsmsg_create_map();
   htsmsg_add_u32(m, "channelId", channel_get_id(ch));
   htsmsg_add_str(m, "method", "channelDelete");
+  htsp_gen_bump(HTSP_GEN_CHANNEL);
   htsp_async_send(m, HTSP_ASYNC_ON, ch);
 }
 
@@ -3841,6 +4115,7 @@ htsp_tag_update_msg(htsp_connection_t *htsp, void *tag)
 void
 htsp_tag_add(channel_tag_t *ct)
 {
+  htsp_gen_bump(HTSP_GEN_TAG);
   htsp_async_send_cb(htsp_tag_update_msg, HTSP_ASYNC_ON, ct);
 }
 
@@ -3850,9 +4125,10 @@ htsp_tag_add(channel_tag_t *ct)
 void
 htsp_tag_update(channel_tag_t *ct)
 {
-  if (ct->ct_enabled && !ct->ct_internal)
+  if (ct->ct_enabled && !ct->ct_internal) {
+    htsp_gen_bump(HTSP_GEN_TAG);
     htsp_async_send_cb(htsp_tag_update_msg, HTSP_ASYNC_ON, ct);
-  else // in case the tag was ever sent to the client
+  } else // in case the tag was ever sent to the client
     htsp_tag_delete(ct);
 }
 
@@ -3866,6 +4142,7 @@ htsp_tag_delete(channel_tag_t *ct)
   htsmsg_t *m = htsmsg_create_map();
   htsmsg_add_u32(m, "tagId", htsp_channel_tag_get_identifier(ct));
   htsmsg_add_str(m, "method", "tagDelete");
+  htsp_gen_bump(HTSP_GEN_TAG);
   htsp_async_send(m, HTSP_ASYNC_ON, ct);
 }
 
@@ -3876,6 +4153,7 @@ static void
 _htsp_dvr_entry_update(dvr_entry_t *de, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_gen_bump(HTSP_GEN_DVR);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON)
       if (!dvr_entry_verify(de, htsp->htsp_granted_access, 1)) {
@@ -3931,6 +4209,7 @@ htsp_dvr_entry_delete(dvr_entry_t *de)
   htsmsg_t *m = htsmsg_create_map();
   htsmsg_add_u32(m, "id", idnode_get_short_uuid(&de->de_id));
   htsmsg_add_str(m, "method", "dvrEntryDelete");
+  htsp_gen_bump(HTSP_GEN_DVR);
   htsp_async_send(m, HTSP_ASYNC_ON, de);
 }
 
@@ -3941,6 +4220,7 @@ static void
 _htsp_autorec_entry_update(dvr_autorec_entry_t *dae, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_gen_bump(HTSP_GEN_AUTOREC);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON) {
       if (!dvr_autorec_entry_verify(dae, htsp->htsp_granted_access, 1)) {
@@ -3985,6 +4265,7 @@ htsp_autorec_entry_delete(dvr_autorec_entry_t *dae)
   htsmsg_t *m = htsmsg_create_map();
   htsmsg_add_str(m, "id", idnode_uuid_as_str(&dae->dae_id, ubuf));
   htsmsg_add_str(m, "method", "autorecEntryDelete");
+  htsp_gen_bump(HTSP_GEN_AUTOREC);
   htsp_async_send(m, HTSP_ASYNC_ON, dae);
 }
 
@@ -3995,6 +4276,7 @@ static void
 _htsp_timerec_entry_update(dvr_timerec_entry_t *dte, const char *method, htsmsg_t *msg)
 {
   htsp_connection_t *htsp;
+  htsp_gen_bump(HTSP_GEN_TIMEREC);
   LIST_FOREACH(htsp, &htsp_async_connections, htsp_async_link) {
     if (htsp->htsp_async_mode & HTSP_ASYNC_ON) {
       if (!dvr_timerec_entry_verify(dte, htsp->htsp_granted_access, 1)) {
@@ -4039,6 +4321,7 @@ htsp_timerec_entry_delete(dvr_timerec_entry_t *dte)
   htsmsg_t *m = htsmsg_create_map();
   htsmsg_add_str(m, "id", idnode_uuid_as_str(&dte->dte_id, ubuf));
   htsmsg_add_str(m, "method", "timerecEntryDelete");
+  htsp_gen_bump(HTSP_GEN_TIMEREC);
   htsp_async_send(m, HTSP_ASYNC_ON, dte);
 }
 
@@ -4054,35 +4337,81 @@ htsp_epg_window_cb(void *aux)
 }
 
 /**
- * Send all waiting EPG events
+ * Push one bounded chunk of the EPG dump; resumes from the channel/event
+ * cursor on the next mainloop pass so global_lock is not held for the
+ * whole walk
  */
 static void
-htsp_epg_send_waiting(htsp_connection_t *htsp, int64_t mintime)
+htsp_epg_dump_cb(void *aux)
 {
+  htsp_connection_t *htsp = aux;
   epg_broadcast_t *ebc;
   channel_t *ch;
-  int64_t maxtime;
-
-  maxtime = gclk() + htsp->htsp_epg_window;
-  htsp->htsp_epg_lastupdate = maxtime;
+  htsmsg_t *m;
+  int64_t maxtime = htsp->htsp_epg_lastupdate;
+  int cnt = 0;
 
-  /* Push new events */
   CHANNEL_FOREACH(ch) {
+    /* skip channels the dump already passed (tree is ordered by id) */
+    if (htsp->htsp_epg_dump_chid &&
+        (int)(channel_get_id(ch) - htsp->htsp_epg_dump_chid) < 0) continue;
+    if (channel_get_id(ch) != htsp->htsp_epg_dump_chid)
+      htsp->htsp_epg_dump_evstart = 0;
+    htsp->htsp_epg_dump_chid = channel_get_id(ch);
     if (!htsp_user_access_channel(htsp, ch)) continue;
     RB_FOREACH(ebc, &ch->ch_epg_schedule, sched_link) {
-      if (ebc->start <= mintime) continue;
+      if (ebc->start <= htsp->htsp_epg_dump_mintime) continue;
+      if (ebc->start <= htsp->htsp_epg_dump_evstart) continue;
       if (htsp->htsp_epg_window && ebc->start > maxtime) break;
       htsmsg_t *e = htsp_build_event(ebc, "eventAdd", htsp->htsp_language, 0, htsp);
       if (e) htsp_send_message(htsp, e, NULL);
+      htsp->htsp_epg_dump_evstart = ebc->start;
+      if (++cnt >= HTSP_EPG_DUMP_CHUNK) {
+        mtimer_arm_rel(&htsp->htsp_epg_dump_timer, htsp_epg_dump_cb, htsp, 0);
+        return;
+      }
     }
   }
 
+  /* Dump complete */
+  htsp->htsp_epg_dump_active = 0;
+  htsp->htsp_epg_dump_chid = 0;
+  htsp->htsp_epg_dump_evstart = 0;
+
+  /* Notify that initial sync has been completed */
+  if (htsp->htsp_epg_dump_synccomplete) {
+    htsp->htsp_epg_dump_synccomplete = 0;
+    m = htsmsg_create_map();
+    htsmsg_add_str(m, "method", "initialSyncCompleted");
+    htsp_send_message(htsp, m, NULL);
+  }
+
   /* Keep the epg window up to date */
   if (htsp->htsp_epg_window)
     mtimer_arm_rel(&htsp->htsp_epg_timer, htsp_epg_window_cb,
                    htsp, sec2mono(HTSP_ASYNC_EPG_INTERVAL));
 }
 
+/**
+ * Send all waiting EPG events
+ */
+static void
+htsp_epg_send_waiting(htsp_connection_t *htsp, int64_t mintime)
+{
+  int64_t maxtime;
+
+  maxtime = gclk() + htsp->htsp_epg_window;
+  htsp->htsp_epg_lastupdate = maxtime;
+
+  /* (Re)start the chunked dump and push the first chunk right away */
+  mtimer_disarm(&htsp->htsp_epg_dump_timer);
+  htsp->htsp_epg_dump_mintime = mintime;
+  htsp->htsp_epg_dump_chid = 0;
+  htsp->htsp_epg_dump_evstart = 0;
+  htsp->htsp_epg_dump_active = 1;
+  htsp_epg_dump_cb(htsp);
+}
+
 /**
  * Called when a event entry is updated/added
  */
@@ -4154,8 +4483,15 @@ htsp_stream_deliver(htsp_subscription_t *hs, th_pkt_t *pkt)
   int64_t ts;
   int qlen = hs->hs_q.hmq_payload;
   int video = SCT_ISVIDEO(pkt->pkt_type);
+  int64_t sendq;
   size_t payloadlen;
 
+  /* count the unsent bytes sitting in the kernel too, so the queue
+     size protection reacts to the real backlog of the connection */
+  sendq = tcp_socket_sendq(htsp->htsp_fd);
+  if (sendq > 0)
+    qlen += sendq;
+
   if (pkt->pkt_err)
     hs->hs_data_errors += pkt->pkt_err;
   if(pkt->pkt_payload == NULL) {
@@ -4211,6 +4547,9 @@ htsp_stream_deliver(htsp_subscription_t *hs, th_pkt_t *pkt)
   htsp_send_subscription(htsp, m, pkt->pkt_payload, hs, payloadlen);
   atomic_add(&hs->hs_s_bytes_out, payloadlen);
 
+  if (hs->hs_s && pkt->pkt_ctime)
+    subscription_latency_sample(hs->hs_s, getfastmonoclock() - pkt->pkt_ctime);
+
   if(mono2sec(hs->hs_last_report) != mono2sec(mclk())) {
 
     /* Send a queue and signal status report every second */
@@ -224,6 +224,13 @@ typedef struct http_nonce {
   RB_ENTRY(http_nonce) link;
   mtimer_t expire;
   char nonce[64];
+  /* session established by a successful digest round on this nonce */
+  char *session_user;
+  char *session_ha1;
+  int session_algo;
+  int session_gen;
+  struct sockaddr_storage session_peer;
+  struct access *session_access;
 } http_nonce_t;
 
 static RB_HEAD(, http_nonce) http_nonces;
@@ -234,12 +241,21 @@ http_nonce_cmp(const void *a, const void *b)
   return strcmp(((http_nonce_t *)a)->nonce, ((http_nonce_t *)b)->nonce);
 }
 
+static void
+http_nonce_free(http_nonce_t *n)
+{
+  free(n->session_user);
+  free(n->session_ha1);
+  access_destroy(n->session_access);
+  free(n);
+}
+
 static void
 http_nonce_timeout(void *aux)
 {
   struct http_nonce *n = aux;
   RB_REMOVE(&http_nonces, n, link);
-  free(n);
+  http_nonce_free(n);
 }
 
 static char *
@@ -1005,6 +1021,7 @@ http_access_verify_auth(http_connection_t *hc)
 struct http_verify_structure {
   char *password;
   char *d_ha1;
+  char *d_ha1_full; /* H(user:realm:passwd), kept for the nonce session */
   char *d_all;
   char *d_response;
   int algo;
@@ -1021,13 +1038,19 @@ http_verify_callback(void *aux, const char *passwd)
    int res;
 
    if (v->d_ha1) {
+     char *h1;
      snprintf(ha1, sizeof(ha1), "%s:%s", v->d_ha1, passwd);
-     m = http_get_digest_hash(v->algo, ha1);
-     snprintf(all, sizeof(all), "%s:%s", m, v->d_all);
-     free(m);
+     h1 = http_get_digest_hash(v->algo, ha1);
+     snprintf(all, sizeof(all), "%s:%s", h1, v->d_all);
      m = http_get_digest_hash(v->algo, all);
      res = strcmp(m, v->d_response) == 0;
      free(m);
+     if (res) {
+       free(v->d_ha1_full);
+       v->d_ha1_full = h1;
+     } else {
+       free(h1);
+     }
      return res;
    }
    if (v->password == NULL) return 0;
@@ -1125,10 +1148,107 @@ static void
 http_verify_free(struct http_verify_structure *v)
 {
   free(v->d_ha1);
+  free(v->d_ha1_full);
   free(v->d_all);
   free(v->d_response);
 }
 
+/**
+ * A successful digest round leaves the account's HA1 and access ticket
+ * on the nonce. While the client keeps reusing that nonce, further
+ * requests are validated with a single hash round instead of the full
+ * credential walk in access_get(). The session is bound to the peer
+ * address it was established from - the cached ticket reflects that
+ * address and nonces are readable by any credential holder.
+ */
+static int
+http_nonce_session_load(http_connection_t *hc, struct http_verify_structure *v,
+                        int gen)
+{
+  struct http_nonce *n, tmp;
+  char all[1024];
+  char *m;
+  int res;
+
+  if (hc->hc_nonce == NULL || v->d_all == NULL || v->d_response == NULL)
+    return 0;
+  strlcpy(tmp.nonce, hc->hc_nonce, sizeof(tmp.nonce));
+  tvh_mutex_lock(&global_lock);
+  n = RB_FIND(&http_nonces, &tmp, link, http_nonce_cmp);
+  if (n == NULL || n->session_ha1 == NULL || n->session_algo != v->algo ||
+      n->session_gen != gen ||
+      strcmp(n->session_user, hc->hc_username ?: "") ||
+      !ip_check_equal(&n->session_peer, hc->hc_peer)) {
+    tvh_mutex_unlock(&global_lock);
+    return 0;
+  }
+  snprintf(all, sizeof(all), "%s:%s", n->session_ha1, v->d_all);
+  m = http_get_digest_hash(v->algo, all);
+  res = m != NULL && strcmp(m, v->d_response) == 0;
+  free(m);
+  if (res) {
+    hc->hc_access = access_copy(n->session_access);
+    mtimer_arm_rel(&n->expire, http_nonce_timeout, n, sec2mono(2*60));
+  }
+  tvh_mutex_unlock(&global_lock);
+  return res;
+}
+
+static void
+http_nonce_session_save(http_connection_t *hc, struct http_verify_structure *v,
+                        int gen)
+{
+  struct http_nonce *n, tmp;
+
+  if (hc->hc_nonce == NULL || v->d_ha1_full == NULL)
+    return;
+  strlcpy(tmp.nonce, hc->hc_nonce, sizeof(tmp.nonce));
+  tvh_mutex_lock(&global_lock);
+  n = RB_FIND(&http_nonces, &tmp, link, http_nonce_cmp);
+  if (n) {
+    tvh_str_set(&n->session_user, hc->hc_username ?: "");
+    free(n->session_ha1);
+    n->session_ha1 = v->d_ha1_full;
+    v->d_ha1_full = NULL;
+    n->session_algo = v->algo;
+    n->session_gen = gen;
+    n->session_peer = *hc->hc_peer;
+    access_destroy(n->session_access);
+    n->session_access = access_copy(hc->hc_access);
+  }
+  tvh_mutex_unlock(&global_lock);
+}
+
+/**
+ * Authorization results are memoized on the connection and reused while
+ * the presented credentials and the access configuration generation
+ * stay the same. Digest authorization changes with every request
+ * (nonce), so only address-only and plain credentials are cached.
+ */
+static int
+http_access_cache_load(http_connection_t *hc)
+{
+  if (hc->hc_access_cache == NULL || hc->hc_authhdr ||
+      hc->hc_access_cache_gen != access_generation() ||
+      strcmp(hc->hc_access_cache_user, hc->hc_username ?: "") ||
+      strcmp(hc->hc_access_cache_pass, hc->hc_password ?: ""))
+    return 0;
+  hc->hc_access = access_copy(hc->hc_access_cache);
+  return 1;
+}
+
+static void
+http_access_cache_save(http_connection_t *hc, int gen)
+{
+  if (hc->hc_auth_type != HC_AUTH_PLAIN && hc->hc_auth_type != HC_AUTH_ADDR)
+    return;
+  access_destroy(hc->hc_access_cache);
+  hc->hc_access_cache = access_copy(hc->hc_access);
+  hc->hc_access_cache_gen = gen;
+  tvh_str_set(&hc->hc_access_cache_user, hc->hc_username ?: "");
+  tvh_str_set(&hc->hc_access_cache_pass, hc->hc_password ?: "");
+}
+
 /**
  * Return non-zero if no access
  */
@@ -1136,7 +1256,7 @@ int
 http_access_verify(http_connection_t *hc, int mask)
 {
   struct http_verify_structure v;
-  int r;
+  int r, gen;
 
   /* quick path */
   if (hc->hc_access)
@@ -1152,13 +1272,33 @@ http_access_verify(http_connection_t *hc, int mask)
     return 0;
 
   access_destroy(hc->hc_access);
+
+  /* memoized result for identical credentials */
+  if (http_access_cache_load(hc)) {
+    r = access_verify2(hc->hc_access, mask);
+    if (r == 0)
+      hc->hc_auth_type = !strempty(hc->hc_username) ?
+                         HC_AUTH_PLAIN : HC_AUTH_ADDR;
+    return r;
+  }
+
   if (http_verify_prepare(hc, &v)) {
     hc->hc_access = NULL;
     return -1;
   }
+  gen = access_generation();
+
+  /* a validated session on this nonce skips the credential walk */
+  if (hc->hc_authhdr && http_nonce_session_load(hc, &v, gen)) {
+    http_verify_free(&v);
+    r = access_verify2(hc->hc_access, mask);
+    if (r == 0)
+      hc->hc_auth_type = HC_AUTH_DIGEST;
+    return r;
+  }
+
   hc->hc_access = access_get(hc->hc_peer, hc->hc_username,
                              http_verify_callback, &v);
-  http_verify_free(&v);
   if (hc->hc_access) {
     r = access_verify2(hc->hc_access, mask);
     if (r == 0) {
@@ -1166,9 +1306,14 @@ http_access_verify(http_connection_t *hc, int mask)
         hc->hc_auth_type = hc->hc_authhdr ? HC_AUTH_DIGEST : HC_AUTH_PLAIN;
       else
         hc->hc_auth_type = HC_AUTH_ADDR;
+      if (hc->hc_auth_type == HC_AUTH_DIGEST)
+        http_nonce_session_save(hc, &v, gen);
+      http_access_cache_save(hc, gen);
     }
+    http_verify_free(&v);
     return r;
   }
+  http_verify_free(&v);
 
   return -1;
 }
@@ -2047,6 +2192,11 @@ error:
   free(hc->hc_nonce);
   hc->hc_nonce = NULL;
 
+  access_destroy(hc->hc_access_cache);
+  hc->hc_access_cache = NULL;
+  free(hc->hc_access_cache_user);
+  free(hc->hc_access_cache_pass);
+
   free(hc->hc_proxy_ip);
   free(hc->hc_local_ip);
 }
@@ -2139,7 +2289,7 @@ http_server_done(void)
   while ((n = RB_FIRST(&http_nonces)) != NULL) {
     mtimer_disarm(&n->expire);
     RB_REMOVE(&http_nonces, n, link);
-    free(n);
+    http_nonce_free(n);
   }
   tvh_mutex_unlock(&global_lock);
 }
@@ -184,6 +184,16 @@ typedef struct http_connection {
     HC_AUTH_PERM
   } hc_auth_type;
 
+  /* Memoized authorization result (plain credentials only) */
+  access_t *hc_access_cache;
+  int       hc_access_cache_gen;
+  char     *hc_access_cache_user;
+  char     *hc_access_cache_pass;
+
+  /* Range request pattern tracking for http_serve_file() */
+  uint64_t hc_file_ino;
+  off_t    hc_file_next;
+
   /* RTSP */
   uint64_t hc_cseq;
   char *hc_session;
@@ -353,6 +363,8 @@ typedef struct http_client_wcmd {
 struct http_client {
 
   TAILQ_ENTRY(http_client) hc_link;
+  TAILQ_ENTRY(http_client) hc_pool_link; /* idle keep-alive pool */
+  int64_t      hc_pool_time;             /* when the client was parked */
 
   tvh_mutex_t  hc_mutex;
 
@@ -463,6 +475,13 @@ http_client_connect ( void *aux, http_ver_t ver, const char *scheme,
 void http_client_register ( http_client_t *hc );
 void http_client_close ( http_client_t *hc );
 
+/* Keep-alive pool variants: release parks a clean idle connection for
+ * reuse by a later connect to the same (scheme, host, port) */
+http_client_t*
+http_client_connect_pooled ( void *aux, http_ver_t ver, const char *scheme,
+                             const char *host, int port, const char *bindaddr );
+void http_client_release ( http_client_t *hc );
+
 int http_client_send( http_client_t *hc, http_cmd_t cmd,
                       const char *path, const char *query,
                       http_arg_list_t *header, void *body, size_t body_size );
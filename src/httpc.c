@@ -90,6 +90,13 @@ static tvh_mutex_t          http_lock;
 static tvh_cond_t               http_cond;
 static th_pipe_t                http_pipe;
 
+/* Idle keep-alive connections available for reuse (see
+ * http_client_connect_pooled / http_client_release) */
+#define HTTP_CLIENT_POOL_LIMIT   16  /* idle connections kept overall */
+#define HTTP_CLIENT_POOL_TIMEOUT 15  /* seconds before an idle entry dies */
+static TAILQ_HEAD(,http_client) http_pool;
+static int                      http_pool_count;
+
 /*
  *
  */
@@ -568,34 +575,44 @@ http_client_send_partial( http_client_t *hc )
   int res = HTTP_CON_IDLE;
 
   wcmd = TAILQ_FIRST(&hc->hc_wqueue);
-  while (wcmd != NULL) {
+  if (wcmd != NULL) {
+    /* responses come back in order - match the oldest unanswered command */
     hc->hc_cmd   = wcmd->wcmd;
     hc->hc_rcseq = wcmd->wcseq;
-    if (hc->hc_einprogress && http_client_einprogress(hc)) {
-      errno = EINPROGRESS;
-      r = -1;
-      goto skip;
-    }
-    if (hc->hc_ssl)
-      r = http_client_ssl_send(hc, wcmd->wbuf + wcmd->wpos,
-                               wcmd->wsize - wcmd->wpos);
-    else
-      r = send(hc->hc_fd, wcmd->wbuf + wcmd->wpos,
-               wcmd->wsize - wcmd->wpos, MSG_DONTWAIT);
+  }
+  while (wcmd != NULL) {
+    if (wcmd->wpos < wcmd->wsize) {
+      if (hc->hc_einprogress && http_client_einprogress(hc)) {
+        errno = EINPROGRESS;
+        r = -1;
+        goto skip;
+      }
+      if (hc->hc_ssl)
+        r = http_client_ssl_send(hc, wcmd->wbuf + wcmd->wpos,
+                                 wcmd->wsize - wcmd->wpos);
+      else
+        r = send(hc->hc_fd, wcmd->wbuf + wcmd->wpos,
+                 wcmd->wsize - wcmd->wpos, MSG_DONTWAIT);
 skip:
-    if (r < 0) {
-      if (ERRNO_AGAIN(errno) || errno == EINPROGRESS) {
-        http_client_direction(hc, 1);
-        return HTTP_CON_SENDING;
+      if (r < 0) {
+        if (ERRNO_AGAIN(errno) || errno == EINPROGRESS) {
+          http_client_direction(hc, 1);
+          return HTTP_CON_SENDING;
+        }
+        return http_client_flush(hc, -errno);
       }
-      return http_client_flush(hc, -errno);
+      wcmd->wpos += r;
+      if (wcmd->wpos < wcmd->wsize)
+        break;
     }
-    wcmd->wpos += r;
-    if (wcmd->wpos >= wcmd->wsize) {
-      res = HTTP_CON_SENT;
+    res = HTTP_CON_SENT;
+    /* RTSP matches responses by CSeq, so further queued commands can be
+     * pipelined on the wire without waiting for the pending answer */
+    if (hc->hc_version != RTSP_VERSION_1_0) {
       wcmd = NULL;
+      break;
     }
-    break;
+    wcmd = TAILQ_NEXT(wcmd, link);
   }
   if (wcmd == NULL) {
     http_client_direction(hc, 0);
@@ -696,7 +713,7 @@ error:
 
   hc->hc_ping_time = mclk();
 
-  if (empty)
+  if (empty || hc->hc_version == RTSP_VERSION_1_0)
     return http_client_send_partial(hc);
   return HTTP_CON_SENDING;
 }
@@ -961,7 +978,7 @@ static int
 http_client_run0( http_client_t *hc )
 {
   char *buf, *saveptr, *argv[3], *d, *p;
-  int ver, res, delimsize;
+  int ver, res, delimsize, direct, locked, partial;
   ssize_t r;
   size_t len;
 
@@ -1003,13 +1020,28 @@ http_client_run0( http_client_t *hc )
   }
 
 retry:
+  direct = 0;
   if (hc->hc_pause) {
     http_client_poll_dir(hc, 0, 0);
     return HTTP_CON_RECEIVING;
   }
-  if (hc->hc_ssl)
+  if (hc->hc_ssl) {
     r = http_client_ssl_recv(hc, buf, hc->hc_io_size);
-  else
+  } else if (!hc->hc_in_data) {
+    /* header / interleaved mode - read straight into the reassembly
+     * buffer, skipping the intermediate copy */
+    if (hc->hc_rpos > hc->hc_io_size + 20*1024) {
+      tvhtrace(LS_HTTPC, "%04X: overflow, buf %zd pos %zd io %zd",
+               shortid(hc), hc->hc_rsize, hc->hc_rpos, hc->hc_io_size);
+      return http_client_flush(hc, -EMSGSIZE);
+    }
+    if (hc->hc_rsize < hc->hc_rpos + hc->hc_io_size) {
+      hc->hc_rsize = hc->hc_rpos + hc->hc_io_size + 4*1024;
+      hc->hc_rbuf = realloc(hc->hc_rbuf, hc->hc_rsize + 1);
+    }
+    r = recv(hc->hc_fd, hc->hc_rbuf + hc->hc_rpos, hc->hc_io_size, MSG_DONTWAIT);
+    direct = 1;
+  } else
     r = recv(hc->hc_fd, buf, hc->hc_io_size, MSG_DONTWAIT);
   if (r == 0) {
     tvhtrace(LS_HTTPC, "%04X: end of stream", shortid(hc));
@@ -1046,6 +1078,11 @@ retry:
     goto retry;
   }
 
+  if (direct) {
+    hc->hc_rpos += r;
+    goto next_header;
+  }
+
   if (hc->hc_rsize < r + hc->hc_rpos) {
     if (hc->hc_rpos + r > hc->hc_io_size + 20*1024) {
       tvhtrace(LS_HTTPC, "%04X: overflow, buf %zd pos %zd read %zd io %zd",
@@ -1157,8 +1194,13 @@ header:
   goto retry;
 
 rtsp_data:
-  /* RTSP embedded data */
+  /* RTSP embedded data - hand all complete frames to the consumer in
+   * one run, dropping the client lock once per batch instead of twice
+   * per 1356-byte frame */
   r = 0;
+  res = 0;
+  partial = 0;
+  locked = 1;
   hc->hc_in_data = 0;
   hc->hc_in_rtp_data = 0;
   while (hc->hc_rpos > r + 3) {
@@ -1167,35 +1209,44 @@ rtsp_data:
     hc->hc_csize = 4 + ((hc->hc_rbuf[r+2] << 8) | hc->hc_rbuf[r+3]);
     hc->hc_chunked = 0;
     if (r + hc->hc_csize > hc->hc_rpos) {
-      http_client_rbuf_cut(hc, r);
-      hc->hc_in_rtp_data = 1;
-      if (r == 0)
-        goto retry;
-      return HTTP_CON_RECEIVING;
+      partial = 1;
+      break;
     }
     if (hc->hc_rtp_data_received) {
-      http_client_get(hc);
-      tvh_mutex_unlock(&hc->hc_mutex);
+      if (locked) {
+        http_client_get(hc);
+        tvh_mutex_unlock(&hc->hc_mutex);
+        locked = 0;
+      }
       res = hc->hc_rtp_data_received(hc, hc->hc_rbuf + r, hc->hc_csize);
-      tvh_mutex_lock(&hc->hc_mutex);
-      http_client_put(hc);
       if (res < 0)
-        return res;
+        break;
     }
     r += hc->hc_csize;
     hc->hc_code = 0;
-    res = 0;
-    if (hc->hc_rtp_data_complete) {
-      http_client_get(hc);
-      tvh_mutex_unlock(&hc->hc_mutex);
-      res = hc->hc_rtp_data_complete(hc);
-      tvh_mutex_lock(&hc->hc_mutex);
-      http_client_put(hc);
-    }
-    hc->hc_in_rtp_data = 0;
+  }
+  if (!locked) {
+    tvh_mutex_lock(&hc->hc_mutex);
+    http_client_put(hc);
+  }
+  if (res < 0)
+    return res;
+  if (hc->hc_rtp_data_complete && r > 0) {
+    http_client_get(hc);
+    tvh_mutex_unlock(&hc->hc_mutex);
+    res = hc->hc_rtp_data_complete(hc);
+    tvh_mutex_lock(&hc->hc_mutex);
+    http_client_put(hc);
     if (res < 0)
       return http_client_flush(hc, res);
   }
+  if (partial) {
+    http_client_rbuf_cut(hc, r);
+    hc->hc_in_rtp_data = 1;
+    if (r == 0)
+      goto retry;
+    return HTTP_CON_RECEIVING;
+  }
   if (r > 0) {
     http_client_rbuf_cut(hc, r);
     goto next_header;
@@ -1620,6 +1671,140 @@ http_client_connect
   return hc;
 }
 
+/*
+ * Connect, reusing a pooled keep-alive connection when one matches
+ *
+ * Reuse is strictly serial (a connection is only pooled once the previous
+ * response has been fully consumed), so no pipelining hazards exist. The
+ * server may drop an idle connection at any time; a readable socket (EOF
+ * or stray bytes) marks the entry as dead and a fresh connect is done.
+ */
+http_client_t *
+http_client_connect_pooled
+  ( void *aux, http_ver_t ver, const char *scheme,
+    const char *host, int port, const char *bindaddr )
+{
+  http_client_t *hc, *next;
+  ssize_t r;
+  char b;
+
+  if (scheme == NULL || host == NULL)
+    goto fresh;
+
+again:
+  tvh_mutex_lock(&http_lock);
+  for (hc = TAILQ_FIRST(&http_pool); hc; hc = next) {
+    next = TAILQ_NEXT(hc, hc_pool_link);
+    if (hc->hc_pool_time + sec2mono(HTTP_CLIENT_POOL_TIMEOUT) < mclk()) {
+      TAILQ_REMOVE(&http_pool, hc, hc_pool_link);
+      http_pool_count--;
+      tvh_mutex_unlock(&http_lock);
+      http_client_close(hc);
+      goto again;
+    }
+    if (strcasecmp(hc->hc_scheme, scheme) || strcasecmp(hc->hc_host, host))
+      continue;
+    if (hc->hc_port != http_port(hc, scheme, port))
+      continue;
+    if ((bindaddr == NULL) != (hc->hc_bindaddr == NULL) ||
+        (bindaddr && strcmp(bindaddr, hc->hc_bindaddr)))
+      continue;
+    TAILQ_REMOVE(&http_pool, hc, hc_pool_link);
+    http_pool_count--;
+    tvh_mutex_unlock(&http_lock);
+    r = recv(hc->hc_fd, &b, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (r >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+      tvhtrace(LS_HTTPC, "%04X: pooled connection to %s:%i is dead",
+               shortid(hc), hc->hc_host, hc->hc_port);
+      http_client_close(hc);
+      goto again;
+    }
+    tvh_mutex_lock(&hc->hc_mutex);
+    hc->hc_aux      = aux;
+    hc->hc_version  = ver;
+    hc->hc_redirv   = ver;
+    hc->hc_redirects = 0;
+    tvh_mutex_unlock(&hc->hc_mutex);
+    tvhtrace(LS_HTTPC, "%04X: Reusing connection to %s:%i",
+             shortid(hc), hc->hc_host, hc->hc_port);
+    return hc;
+  }
+  tvh_mutex_unlock(&http_lock);
+
+fresh:
+  return http_client_connect(aux, ver, scheme, host, port, bindaddr);
+}
+
+/*
+ * Return a connection obtained via http_client_connect_pooled; it is
+ * parked for reuse when idle and clean, closed otherwise
+ */
+void
+http_client_release ( http_client_t *hc )
+{
+  http_client_t *old;
+
+  if (hc == NULL)
+    return;
+
+  /* Deregister from the client thread (same dance as http_client_close) */
+  if (hc->hc_efd == http_poll) {
+    tvh_mutex_lock(&http_lock);
+    hc->hc_shutdown_wait = 1;
+    while (hc->hc_running)
+      tvh_cond_wait(&http_cond, &http_lock);
+    if (hc->hc_efd) {
+      tvhpoll_rem1(hc->hc_efd, hc->hc_fd);
+      TAILQ_REMOVE(&http_clients, hc, hc_link);
+      hc->hc_efd = NULL;
+    }
+    tvh_mutex_unlock(&http_lock);
+    hc->hc_shutdown_wait = 0;
+  }
+
+  tvh_mutex_lock(&hc->hc_mutex);
+  if (hc->hc_fd < 0 || hc->hc_shutdown || !hc->hc_keepalive ||
+      http_client_busy(hc) || hc->hc_in_data || hc->hc_rpos != 0 ||
+      hc->hc_wcmd != NULL || !TAILQ_EMPTY(&hc->hc_wqueue) ||
+      hc->hc_rtsp_session != NULL) {
+    tvh_mutex_unlock(&hc->hc_mutex);
+    http_client_close(hc);
+    return;
+  }
+  if (hc->hc_efd) {
+    /* private poll handle of a synchronous caller; about to be destroyed */
+    tvhpoll_rem1(hc->hc_efd, hc->hc_fd);
+    hc->hc_efd = NULL;
+  }
+  http_client_clear_state(hc);
+  hc->hc_aux               = NULL;
+  hc->hc_hdr_received      = NULL;
+  hc->hc_data_received     = NULL;
+  hc->hc_data_complete     = NULL;
+  hc->hc_rtp_data_received = NULL;
+  hc->hc_rtp_data_complete = NULL;
+  hc->hc_conn_closed       = NULL;
+  hc->hc_hdr_create        = http_client_basic_args;
+  hc->hc_pevents           = 0;
+  hc->hc_pool_time         = mclk();
+  tvh_mutex_unlock(&hc->hc_mutex);
+  tvhtrace(LS_HTTPC, "%04X: Parked connection to %s:%i",
+           shortid(hc), hc->hc_host, hc->hc_port);
+
+  tvh_mutex_lock(&http_lock);
+  TAILQ_INSERT_TAIL(&http_pool, hc, hc_pool_link);
+  http_pool_count++;
+  while (http_pool_count > HTTP_CLIENT_POOL_LIMIT) {
+    old = TAILQ_FIRST(&http_pool);
+    TAILQ_REMOVE(&http_pool, old, hc_pool_link);
+    http_pool_count--;
+    tvh_mutex_unlock(&http_lock);
+    http_client_close(old);
+    tvh_mutex_lock(&http_lock);
+  }
+  tvh_mutex_unlock(&http_lock);
+}
+
 /*
  * Register to the another thread
  */
@@ -1709,6 +1894,7 @@ http_client_init ( void )
   tvh_mutex_init(&http_lock, NULL);
   tvh_cond_init(&http_cond, 1);
   TAILQ_INIT(&http_clients);
+  TAILQ_INIT(&http_pool);
 
   /* Setup pipe */
   tvh_pipe(O_NONBLOCK, &http_pipe);
@@ -1730,6 +1916,17 @@ http_client_done ( void )
 {
   http_client_t *hc;
 
+  /* Drop the pooled keep-alive connections */
+  tvh_mutex_lock(&http_lock);
+  while ((hc = TAILQ_FIRST(&http_pool)) != NULL) {
+    TAILQ_REMOVE(&http_pool, hc, hc_pool_link);
+    http_pool_count--;
+    tvh_mutex_unlock(&http_lock);
+    http_client_close(hc);
+    tvh_mutex_lock(&http_lock);
+  }
+  tvh_mutex_unlock(&http_lock);
+
   atomic_set(&http_running, 0);
   tvh_write(http_pipe.wr, "", 1);
   pthread_join(http_client_tid, NULL);
@@ -43,6 +43,19 @@ typedef struct idclass_link
 
 tvh_mutex_t                     idnode_mutex;
 static idnodes_rb_t             idnodes;
+
+/* hash index over the uuid tree: pure lookups resolve in one bucket
+   walk instead of an RB descent over every registered node */
+#define IDNODE_HASH_SIZE 1024 /* power of two */
+static LIST_HEAD(,idnode)       idnodes_hash[IDNODE_HASH_SIZE];
+
+static inline uint32_t
+idnode_hash(const tvh_uuid_t *u)
+{
+  uint32_t h;
+  memcpy(&h, u->bin, sizeof(h)); /* uuids are random, any bytes do */
+  return h & (IDNODE_HASH_SIZE - 1);
+}
 static RB_HEAD(,idclass_link)   idclasses;
 static RB_HEAD(,idclass_link)   idrootclasses;
 static TAILQ_HEAD(,idnode_save) idnodes_save;
@@ -142,6 +155,9 @@ idnode_insert(idnode_t *in, const char *uuid, const idclass_t *class, int flags)
             uuid, (flags & IDNODE_SHORT_UUID) ? " (short)" : "");
     abort();
   }
+  bin2hex(in->in_uuid_hex, sizeof(in->in_uuid_hex),
+          in->in_uuid.bin, sizeof(in->in_uuid.bin));
+  LIST_INSERT_HEAD(&idnodes_hash[idnode_hash(&in->in_uuid)], in, in_hash_link);
   tvhtrace(LS_IDNODE, "insert node %s", idnode_uuid_as_str(in, ubuf));
 
   /* Register the class */
@@ -172,6 +188,7 @@ idnode_unlink(idnode_t *in)
   lock_assert(&global_lock);
   idnode_lock();
   RB_REMOVE(&idnodes, in, in_link);
+  LIST_REMOVE(in, in_hash_link);
   RB_REMOVE(in->in_domain, in, in_domain_link);
   idnode_unlock();
   tvhtrace(LS_IDNODE, "unlink node %s", idnode_uuid_as_str(in, ubuf));
@@ -236,6 +253,10 @@ idnode_get_short_uuid (const idnode_t *in)
 const char *
 idnode_uuid_as_str(const idnode_t *in, char *uuid)
 {
+  /* the hex form is cached on insert; convert only for nodes which
+     never went through idnode_insert */
+  if (in->in_uuid_hex[0])
+    return strcpy(uuid, in->in_uuid_hex);
   return bin2hex(uuid, UUID_HEX_SIZE, in->in_uuid.bin, sizeof(in->in_uuid.bin));
 }
 
@@ -632,10 +653,13 @@ idnode_find_ ( idnode_t *skel, const idclass_t *idc, const idnodes_rb_t *domain
 
   if (domain == NULL)
     domain = idnode_domain(idc);
-  if (domain == NULL)
-    r = RB_FIND(&idnodes, skel, in_link, in_cmp);
-  else
-    r = RB_FIND(domain, skel, in_domain_link, in_cmp);
+  /* uuids are globally unique, so the hash bucket resolves the node
+     for any domain */
+  LIST_FOREACH(r, &idnodes_hash[idnode_hash(&skel->in_uuid)], in_hash_link)
+    if (uuid_cmp(&r->in_uuid, &skel->in_uuid) == 0)
+      break;
+  if(r != NULL && domain != NULL && r->in_domain != domain)
+    return NULL;
   if(r != NULL && idc != NULL) {
     const idclass_t *c = r->in_class;
     for(;c != NULL; c = c->ic_super) {
@@ -1500,6 +1524,110 @@ idclass_find_children(const char *clazz)
   return ret;
 }
 
+/* **************************************************************************
+ * Class metadata cache
+ * *************************************************************************/
+
+/*
+ * Serializing a class walks every property, translating captions and
+ * building the enum lists; grids request the same blob over and over.
+ * Keep the built message per class and language and hand out copies
+ * until the generation counter moves (any idnode notification, since
+ * enum lists usually enumerate idnodes).
+ */
+#define IDCLASS_META_CACHE_LIMIT 50
+
+typedef struct idclass_meta {
+  TAILQ_ENTRY(idclass_meta) im_link;
+  const idclass_t *im_idc;
+  char *im_lang;
+  uint32_t im_gen;
+  htsmsg_t *im_msg;
+} idclass_meta_t;
+
+static tvh_mutex_t idclass_meta_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(idclass_meta_queue, idclass_meta) idclass_meta_cache =
+  TAILQ_HEAD_INITIALIZER(idclass_meta_cache);
+static int idclass_meta_count;
+static uint32_t idclass_meta_gen;
+
+static void
+idclass_meta_destroy(idclass_meta_t *im)
+{
+  TAILQ_REMOVE(&idclass_meta_cache, im, im_link);
+  idclass_meta_count--;
+  htsmsg_destroy(im->im_msg);
+  free(im->im_lang);
+  free(im);
+}
+
+static void
+idclass_meta_invalidate(void)
+{
+  tvh_mutex_lock(&idclass_meta_mutex);
+  idclass_meta_gen++;
+  tvh_mutex_unlock(&idclass_meta_mutex);
+}
+
+static htsmsg_t *
+idclass_meta_get(const idclass_t *idc, const char *lang)
+{
+  idclass_meta_t *im;
+  htsmsg_t *m = NULL;
+
+  tvh_mutex_lock(&idclass_meta_mutex);
+  TAILQ_FOREACH(im, &idclass_meta_cache, im_link)
+    if (im->im_idc == idc && !strcmp(im->im_lang, lang ?: ""))
+      break;
+  if (im) {
+    if (im->im_gen == idclass_meta_gen) {
+      if (im != TAILQ_FIRST(&idclass_meta_cache)) {
+        TAILQ_REMOVE(&idclass_meta_cache, im, im_link);
+        TAILQ_INSERT_HEAD(&idclass_meta_cache, im, im_link);
+      }
+      m = htsmsg_copy(im->im_msg);
+    } else {
+      idclass_meta_destroy(im);
+    }
+  }
+  tvh_mutex_unlock(&idclass_meta_mutex);
+  return m;
+}
+
+static void
+idclass_meta_put(const idclass_t *idc, const char *lang, htsmsg_t *msg)
+{
+  idclass_meta_t *im;
+
+  tvh_mutex_lock(&idclass_meta_mutex);
+  TAILQ_FOREACH(im, &idclass_meta_cache, im_link)
+    if (im->im_idc == idc && !strcmp(im->im_lang, lang ?: ""))
+      break;
+  if (im == NULL) {
+    im = calloc(1, sizeof(*im));
+    im->im_idc = idc;
+    im->im_lang = strdup(lang ?: "");
+    im->im_gen = idclass_meta_gen;
+    im->im_msg = htsmsg_copy(msg);
+    TAILQ_INSERT_HEAD(&idclass_meta_cache, im, im_link);
+    if (++idclass_meta_count > IDCLASS_META_CACHE_LIMIT)
+      idclass_meta_destroy(TAILQ_LAST(&idclass_meta_cache,
+                                      idclass_meta_queue));
+  }
+  tvh_mutex_unlock(&idclass_meta_mutex);
+}
+
+static void
+idclass_meta_flush(void)
+{
+  idclass_meta_t *im;
+
+  tvh_mutex_lock(&idclass_meta_mutex);
+  while ((im = TAILQ_FIRST(&idclass_meta_cache)) != NULL)
+    idclass_meta_destroy(im);
+  tvh_mutex_unlock(&idclass_meta_mutex);
+}
+
 /*
  * Just get the class definition
  */
@@ -1507,7 +1635,13 @@ htsmsg_t *
 idclass_serialize0(const idclass_t *idc, htsmsg_t *list, int optmask, const char *lang)
 {
   const char *s;
-  htsmsg_t *p, *m = htsmsg_create_map();
+  htsmsg_t *p, *m;
+  int cacheable = list == NULL && optmask == 0;
+
+  if (cacheable && (m = idclass_meta_get(idc, lang)) != NULL)
+    return m;
+
+  m = htsmsg_create_map();
 
   /* Caption and name */
   if ((s = idclass_get_caption(idc, lang)))
@@ -1524,7 +1658,10 @@ idclass_serialize0(const idclass_t *idc, htsmsg_t *list, int optmask, const char
   /* Props */
   if ((p = idnode_params(idc, NULL, list, optmask, lang)))
     htsmsg_add_msg(m, "props", p);
-  
+
+  if (cacheable)
+    idclass_meta_put(idc, lang, m);
+
   return m;
 }
 
@@ -1893,6 +2030,16 @@ idnode_list_set2
  * Notification
  * *************************************************************************/
 
+/* monotonic counter covering every node change, insert and removal -
+   consumers use it to validate caches derived from the node tree */
+static int idnode_changes_serial;
+
+uint32_t
+idnode_change_serial ( void )
+{
+  return (uint32_t)atomic_get(&idnode_changes_serial);
+}
+
 /**
  * Notify about a change
  */
@@ -1903,6 +2050,12 @@ idnode_notify ( idnode_t *in, const char *action )
   char ubuf[UUID_HEX_SIZE];
   const char *uuid = idnode_uuid_as_str(in, ubuf);
 
+  atomic_add(&idnode_changes_serial, 1);
+
+  /* enum lists embedded in the cached class metadata may refer to
+     this node, drop the cached copies */
+  idclass_meta_invalidate();
+
   if (!tvheadend_is_running())
     return;
 
@@ -1942,15 +2095,71 @@ idnode_notify_title_changed_lang (void *in, const char *lang)
  * Save thread
  * *************************************************************************/
 
+/*
+ * Serialized-but-unwritten node, carried from inside the global lock
+ * to the disk write outside it
+ */
+typedef struct idnode_save_flush {
+  TAILQ_ENTRY(idnode_save_flush) isf_link;
+  htsmsg_t *isf_msg;
+  char isf_filename[PATH_MAX];
+} idnode_save_flush_t;
+
+/* bound the time spent serializing under the global lock */
+#define IDNODE_SAVE_BATCH 128
+
+/*
+ * Serialize up to IDNODE_SAVE_BATCH queued nodes into the flush list
+ * under one global lock hold, then write them out with the lock
+ * dropped.  Mass edits (map all services, bulk grid updates) thus cost
+ * a handful of lock cycles and disk passes instead of one per object.
+ */
+static void
+save_thread_flush ( int delay )
+{
+  TAILQ_HEAD(,idnode_save_flush) flush;
+  idnode_save_flush_t *isf;
+  idnode_save_t *ise;
+  htsmsg_t *m;
+  char filename[PATH_MAX];
+  int count = 0;
+
+  TAILQ_INIT(&flush);
+  while (count < IDNODE_SAVE_BATCH &&
+         (ise = TAILQ_FIRST(&idnodes_save)) != NULL) {
+    if (delay && ise->ise_reqtime + IDNODE_SAVE_DELAY > mclk())
+      break;
+    m = idnode_savefn(ise->ise_node, filename, sizeof(filename));
+    ise->ise_node->in_save = NULL;
+    TAILQ_REMOVE(&idnodes_save, ise, ise_link);
+    free(ise);
+    if (m) {
+      isf = malloc(sizeof(*isf));
+      isf->isf_msg = m;
+      strlcpy(isf->isf_filename, filename, sizeof(isf->isf_filename));
+      TAILQ_INSERT_TAIL(&flush, isf, isf_link);
+      count++;
+    }
+  }
+  if (TAILQ_EMPTY(&flush))
+    return;
+  tvh_mutex_unlock(&global_lock);
+  while ((isf = TAILQ_FIRST(&flush)) != NULL) {
+    TAILQ_REMOVE(&flush, isf, isf_link);
+    hts_settings_save(isf->isf_msg, "%s", isf->isf_filename);
+    htsmsg_destroy(isf->isf_msg);
+    free(isf);
+  }
+  tvh_mutex_lock(&global_lock);
+}
+
 static void *
 save_thread ( void *aux )
 {
   idnode_save_t *ise;
   idnode_t *in;
-  htsmsg_t *m;
   uint32_t u32;
   tvh_uuid_t *uuid;
-  char filename[PATH_MAX];
   tvh_uuid_set_t set, tset;
   int lnotify;
 
@@ -1976,18 +2185,7 @@ save_thread ( void *aux )
       tvh_cond_wait(&save_cond, &global_lock);
       continue;
     }
-    if (ise) {
-      m = idnode_savefn(ise->ise_node, filename, sizeof(filename));
-      ise->ise_node->in_save = NULL;
-      TAILQ_REMOVE(&idnodes_save, ise, ise_link);
-      tvh_mutex_unlock(&global_lock);
-      free(ise);
-      if (m) {
-        hts_settings_save(m, "%s", filename);
-        htsmsg_destroy(m);
-      }
-      tvh_mutex_lock(&global_lock);
-    }
+    save_thread_flush(1);
 lnotifygo:
     tvh_mutex_lock(&idnode_lnotify_mutex);
     if (!uuid_set_empty(&idnode_lnotify_set)) {
@@ -2019,18 +2217,9 @@ lnotifygo:
 
   mtimer_disarm(&save_timer);
 
-  while ((ise = TAILQ_FIRST(&idnodes_save)) != NULL) {
-    m = idnode_savefn(ise->ise_node, filename, sizeof(filename));
-    ise->ise_node->in_save = NULL;
-    TAILQ_REMOVE(&idnodes_save, ise, ise_link);
-    tvh_mutex_unlock(&global_lock);
-    free(ise);
-    if (m) {
-      hts_settings_save(m, "%s", filename);
-      htsmsg_destroy(m);
-    }
-    tvh_mutex_lock(&global_lock);
-  }
+  /* consistency barrier - everything still dirty hits the disk before exit */
+  while (!TAILQ_EMPTY(&idnodes_save))
+    save_thread_flush(0);
 
   tvh_mutex_unlock(&global_lock);
   return NULL;
@@ -2095,6 +2284,8 @@ idnode_done(void)
 
   mtimer_disarm(&save_timer);
 
+  idclass_meta_flush();
+
   while ((il = RB_FIRST(&idclasses)) != NULL) {
     RB_REMOVE(&idclasses, il, link);
     free(il);
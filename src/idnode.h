@@ -97,7 +97,9 @@ typedef RB_HEAD(, idnode) idnodes_rb_t;
  */
 struct idnode {
   tvh_uuid_t        in_uuid;                ///< Unique ID
+  char              in_uuid_hex[UUID_HEX_SIZE]; ///< Cached hex form of the ID
   RB_ENTRY(idnode)  in_link;                ///< Global hash
+  LIST_ENTRY(idnode) in_hash_link;          ///< UUID hash bucket
   RB_ENTRY(idnode)  in_domain_link;         ///< Root class link (domain)
   idnodes_rb_t     *in_domain;              ///< Domain nodes
   const idclass_t  *in_class;               ///< Class definition
@@ -231,6 +233,8 @@ void         *idnode_find0   (tvh_uuid_t *uuid, const idclass_t *idc, const idno
 idnode_set_t *idnode_find_all(const idclass_t *idc, const idnodes_rb_t *nodes);
 
 
+uint32_t idnode_change_serial (void);
+
 void idnode_notify (idnode_t *in, const char *action);
 void idnode_notify_changed (void *in);
 void idnode_notify_title_changed (void *in);
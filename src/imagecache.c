@@ -128,6 +128,15 @@ const idclass_t imagecache_class = {
                    "that has failed to be fetched."),
       .off    = offsetof(struct imagecache_config, fail_period),
     },
+    {
+      .type   = PT_U32,
+      .id     = "fetchers",
+      .name   = N_("Fetch threads"),
+      .desc   = N_("Number of parallel image fetch threads (1-8). "
+                   "More threads populate a large cache faster. "
+                   "Takes effect after a restart."),
+      .off    = offsetof(struct imagecache_config, fetchers),
+    },
     {}
   }
 };
@@ -175,6 +184,34 @@ id_cmp ( imagecache_image_t *a, imagecache_image_t *b )
   return (a->id - b->id);
 }
 
+/*
+ * Data files are sharded into 256 subdirectories to keep a large cache
+ * out of one giant directory; older caches stored everything flat, so
+ * fall back to the flat path when a sharded file does not exist yet.
+ */
+static int
+imagecache_data_path ( int id, char *path, size_t len )
+{
+  char flat[PATH_MAX];
+
+  if (hts_settings_buildpath(path, len, "imagecache/data/%02x/%d",
+                             id & 0xff, id))
+    return -1;
+  if (access(path, R_OK) == 0)
+    return 0;
+  if (!hts_settings_buildpath(flat, sizeof(flat), "imagecache/data/%d", id) &&
+      access(flat, R_OK) == 0)
+    strlcpy(path, flat, len);
+  return 0;
+}
+
+static void
+imagecache_data_remove ( int id )
+{
+  hts_settings_remove("imagecache/data/%02x/%d", id & 0xff, id);
+  hts_settings_remove("imagecache/data/%d", id);
+}
+
 static htsmsg_t *
 imagecache_image_htsmsg ( imagecache_image_t *img )
 {
@@ -278,7 +315,9 @@ imagecache_new_contents ( imagecache_image_t *img,
     hts_settings_remove("imagecache/meta/%d", img->id);
     RB_REMOVE(&imagecache_by_id, img, id_link);
     imagecache_new_id(img);
-    r = hts_settings_buildpath(path, PATH_MAX, "imagecache/data/%d", img->id);
+    r = imagecache_data_path(img->id, path, PATH_MAX);
+    if (!r)
+      r = hts_settings_makedirs(path);
   }
   if (!r) {
     if (rename(tpath, path))
@@ -307,8 +346,7 @@ imagecache_image_fetch ( imagecache_image_t *img )
     return res;
 
   /* Open file  */
-  if (hts_settings_buildpath(path, sizeof(path), "imagecache/data/%d",
-                             img->id))
+  if (imagecache_data_path(img->id, path, sizeof(path)))
     goto error;
   if (hts_settings_makedirs(path))
     goto error;
@@ -325,8 +363,8 @@ imagecache_image_fetch ( imagecache_image_t *img )
     goto error_lock;
   }
 
-  hc = http_client_connect(NULL, HTTP_VERSION_1_1, url.scheme,
-                           url.host, url.port, NULL);
+  hc = http_client_connect_pooled(NULL, HTTP_VERSION_1_1, url.scheme,
+                                  url.host, url.port, NULL);
   if (hc == NULL)
     goto error_lock;
 
@@ -359,7 +397,7 @@ imagecache_image_fetch ( imagecache_image_t *img )
 
   /* Process */
 error_lock:
-  if (NULL != hc) http_client_close(hc);
+  if (NULL != hc) http_client_release(hc);
   tvh_mutex_lock(&imagecache_lock);
 error:
   urlreset(&url);
@@ -466,7 +504,10 @@ retry:
 /*
  * Initialise
  */
-pthread_t imagecache_tid;
+#define IMAGECACHE_THREADS_MAX 8
+
+static pthread_t imagecache_tid[IMAGECACHE_THREADS_MAX];
+static int imagecache_threads;
 
 void
 imagecache_init ( void )
@@ -484,6 +525,7 @@ imagecache_init ( void )
   imagecache_conf.ok_period      = 24 * 7; // weekly
   imagecache_conf.fail_period    = 24;     // daily
   imagecache_conf.ignore_sslcert = 0;
+  imagecache_conf.fetchers       = 4;
 
   idclass_register(&imagecache_class);
 
@@ -513,7 +555,7 @@ imagecache_init ( void )
       i = RB_INSERT_SORTED(&imagecache_by_url, img, url_link, url_cmp);
       if (i) {
         hts_settings_remove("imagecache/meta/%d", id);
-        hts_settings_remove("imagecache/data/%d", id);
+        imagecache_data_remove(id);
         free((void*)img->url);
         free(img);
         continue;
@@ -533,7 +575,10 @@ imagecache_init ( void )
   }
 
   /* Start threads */
-  tvh_thread_create(&imagecache_tid, NULL, imagecache_thread, NULL, "imagecache");
+  imagecache_threads = MINMAX(imagecache_conf.fetchers, 1, IMAGECACHE_THREADS_MAX);
+  for (id = 0; id < imagecache_threads; id++)
+    tvh_thread_create(&imagecache_tid[id], NULL, imagecache_thread, NULL,
+                      "imagecache");
 }
 
 
@@ -545,7 +590,7 @@ imagecache_destroy ( imagecache_image_t *img, int delconf )
 {
   if (delconf) {
     hts_settings_remove("imagecache/meta/%d", img->id);
-    hts_settings_remove("imagecache/data/%d", img->id);
+    imagecache_data_remove(img->id);
   }
   RB_REMOVE(&imagecache_by_url, img, url_link);
   RB_REMOVE(&imagecache_by_id, img, id_link);
@@ -559,11 +604,13 @@ void
 imagecache_done ( void )
 {
   imagecache_image_t *img;
+  int i;
 
   tvh_mutex_lock(&imagecache_lock);
   tvh_cond_signal(&imagecache_cond, 1);
   tvh_mutex_unlock(&imagecache_lock);
-  pthread_join(imagecache_tid, NULL);
+  for (i = 0; i < imagecache_threads; i++)
+    pthread_join(imagecache_tid[i], NULL);
   tvh_mutex_lock(&imagecache_lock);
   while ((img = RB_FIRST(&imagecache_by_id)) != NULL) {
     if (img->state == SAVE) {
@@ -595,14 +642,49 @@ imagecache_class_save ( idnode_t *self, char *filename, size_t fsize )
 /*
  * Clean
  */
-void
-imagecache_clean( void )
+static void
+imagecache_clean_dir( const char *path, const char *shard )
 {
-  imagecache_image_t *img, *next, skel;
+  imagecache_image_t *img, skel;
   fb_dirent **namelist;
-  char path[PATH_MAX], *name;
+  char *name;
   int i, n;
 
+  if((n = fb_scandir(path, &namelist)) < 0)
+    return;
+  for (i = 0; i < n; i++) {
+    name = namelist[i]->name;
+    if (name[0] == '.')
+      continue;
+    if (namelist[i]->type == FB_DIR) {
+      /* shard subdirectory - descend one level */
+      char sub[PATH_MAX];
+      if (!shard) {
+        snprintf(sub, sizeof(sub), "%s/%s", path, name);
+        imagecache_clean_dir(sub, name);
+      }
+      continue;
+    }
+    skel.id = atoi(name);
+    img = RB_FIND(&imagecache_by_id, &skel, id_link, id_cmp);
+    if (img)
+      continue;
+    tvhinfo(LS_IMAGECACHE, "clean: removing unassociated file '%s/%s'", path, name);
+    hts_settings_remove("imagecache/meta/%s", name);
+    if (shard)
+      hts_settings_remove("imagecache/data/%s/%s", shard, name);
+    else
+      hts_settings_remove("imagecache/data/%s", name);
+  }
+  free(namelist);
+}
+
+void
+imagecache_clean( void )
+{
+  imagecache_image_t *img, *next;
+  char path[PATH_MAX];
+
   tvh_mutex_lock(&imagecache_lock);
 
   /* remove all cached data, except the one actually fetched */
@@ -619,21 +701,7 @@ imagecache_clean( void )
     tvherror(LS_IMAGECACHE, "clean - buildpath");
     goto done;
   }
-  if((n = fb_scandir(path, &namelist)) < 0)
-    goto done;
-  for (i = 0; i < n; i++) {
-    name = namelist[i]->name;
-    if (name[0] == '.')
-      continue;
-    skel.id = atoi(name);
-    img = RB_FIND(&imagecache_by_id, &skel, id_link, id_cmp);
-    if (img)
-      continue;
-    tvhinfo(LS_IMAGECACHE, "clean: removing unassociated file '%s/%s'", path, name);
-    hts_settings_remove("imagecache/meta/%s", name);
-    hts_settings_remove("imagecache/data/%s", name);
-  }
-  free(namelist);
+  imagecache_clean_dir(path, NULL);
 
 done:
   tvh_mutex_unlock(&imagecache_lock);
@@ -777,7 +845,7 @@ imagecache_filename ( int id, char *name, size_t len )
       if (e)
         goto out_error;
     }
-    if (hts_settings_buildpath(name, len, "imagecache/data/%d", i->id))
+    if (imagecache_data_path(i->id, name, len))
       goto out_error;
   }
 
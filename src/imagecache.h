@@ -29,6 +29,7 @@ struct imagecache_config {
   uint32_t  expire;
   uint32_t  ok_period;
   uint32_t  fail_period;
+  uint32_t  fetchers;
 };
 
 extern struct imagecache_config imagecache_conf;
@@ -38,6 +38,12 @@
 #define MPEGTS_TABLES_PID       0x2001
 #define MPEGTS_PID_NONE         0xFFFF
 
+/* flat per-mux PID dispatch table (incl. the two pseudo PIDs above) */
+#define MPEGTS_PID_TAB_SIZE     (MPEGTS_TABLES_PID+1)
+
+/* open-PID bitmap covering the real 13-bit PID space (1KB per mux) */
+#define MPEGTS_PID_MAP_WORDS    (8192/32)
+
 /* Types */
 typedef struct mpegts_apid          mpegts_apid_t;
 typedef struct mpegts_apids         mpegts_apids_t;
@@ -60,8 +66,6 @@ typedef LIST_HEAD (,mpegts_input)               mpegts_input_list_t;
 typedef TAILQ_HEAD(mpegts_mux_queue,mpegts_mux) mpegts_mux_queue_t;
 typedef LIST_HEAD (,mpegts_mux)                 mpegts_mux_list_t;
 typedef LIST_HEAD (,mpegts_network_link)        mpegts_network_link_list_t;
-typedef TAILQ_HEAD(mpegts_table_feed_queue, mpegts_table_feed)
-                                                mpegts_table_feed_queue_t;
 
 /* Classes */
 extern const idclass_t mpegts_network_class;
@@ -129,6 +133,7 @@ struct mpegts_packet
   TAILQ_ENTRY(mpegts_packet)  mp_link;
   size_t                      mp_len;
   mpegts_mux_t               *mp_mux;
+  int64_t                     mp_arrival; ///< receive time for latency accounting
   uint8_t                     mp_cc_restart;
   uint8_t                     mp_data[0];
 };
@@ -286,7 +291,6 @@ struct mpegts_table
  */
 
 struct mpegts_table_feed {
-  TAILQ_ENTRY(mpegts_table_feed) mtf_link;
   uint8_t mtf_cc_restart;
   int mtf_len;
   mpegts_mux_t *mtf_mux;
@@ -295,6 +299,11 @@ struct mpegts_table_feed {
 
 #define MPEGTS_MTF_ALLOC_CHUNK (21*188)
 
+/* Single-producer (input thread) / single-consumer (table thread)
+ * lock-free ring for the table feed handoff */
+#define MPEGTS_MTF_RING_SIZE 1024
+#define MPEGTS_MTF_RING_MASK (MPEGTS_MTF_RING_SIZE-1)
+
 /* **************************************************************************
  * Logical network
  * *************************************************************************/
@@ -507,6 +516,10 @@ struct mpegts_mux
 
   uint64_t                    mm_input_pos;
   RB_HEAD(, mpegts_pid)       mm_pids;
+  mpegts_pid_t              **mm_pid_tab; ///< flat dispatch table, lazily
+                                          ///< allocated for active muxes
+  uint32_t                    mm_open_pid_map[MPEGTS_PID_MAP_WORDS];
+                                          ///< one bit per open real PID
   LIST_HEAD(, mpegts_pid_sub) mm_all_subs;
   int                         mm_last_pid;
   mpegts_pid_t               *mm_last_mp;
@@ -650,6 +663,7 @@ struct mpegts_service
    */
   sbuf_t s_tsbuf;
   int64_t s_tsbuf_last;
+  int64_t s_tsbuf_arrival; ///< input arrival time of the oldest buffered byte
 
   /**
    * PCR drift compensation. This should really be per-packet.
@@ -664,6 +678,13 @@ struct mpegts_service
   mpegts_table_t *s_pmt_mon; ///< Table entry for monitoring PMT
   mpegts_table_t *s_cat_mon; ///< Table entry for monitoring CAT
 
+  /**
+   * Last seen raw PMT section, persisted with the service config so
+   * the CAM can be programmed before the live carousel delivers it
+   */
+  uint8_t *s_dvb_pmt_cache;
+  int      s_dvb_pmt_cache_len;
+
 };
 
 /* **************************************************************************
@@ -714,6 +735,8 @@ struct mpegts_input
   int mi_priority;
   int mi_streaming_priority;
 
+  char *mi_thread_affinity; /* CPU list for the input pipeline threads */
+
   int mi_ota_epg;
 
   int mi_initscan;
@@ -752,6 +775,7 @@ struct mpegts_input
   tvhlog_limit_t                  mi_input_queue_loglimit;
   qprofile_t                      mi_qprofile;
   int                             mi_remove_scrambled_bits;
+  int64_t                         mi_arrival; ///< arrival time of the packet being processed (input thread only)
 
   /* Data processing/output */
   // Note: this lock (mi_output_lock) protects all the remaining
@@ -762,9 +786,16 @@ struct mpegts_input
   LIST_HEAD(,mpegts_mux_instance) mi_mux_active;
 
   /* Table processing */
+  // Note: the mtf handoff is a lock-free SPSC ring; mi_table_lock only
+  //       guards the condvar sleep and ring scans by other threads
   pthread_t                       mi_table_tid;
+  tvh_mutex_t                     mi_table_lock;
   tvh_cond_t                      mi_table_cond;
-  mpegts_table_feed_queue_t       mi_table_queue;
+  int                             mi_table_sleeping;
+  mpegts_table_feed_t            *mi_table_ring[MPEGTS_MTF_RING_SIZE];
+  int                             mi_table_ring_head; ///< consumer index
+  int                             mi_table_ring_tail; ///< producer index
+  mpegts_table_feed_t            *mi_table_mtf;       ///< producer pending feed
   uint64_t                        mi_table_queue_size;
   tvhlog_limit_t                  mi_table_queue_loglimit;
 
@@ -1016,6 +1047,19 @@ mpegts_pid_t *mpegts_mux_find_pid_(mpegts_mux_t *mm, int pid, int create);
 static inline mpegts_pid_t *
 mpegts_mux_find_pid(mpegts_mux_t *mm, int pid, int create)
 {
+  /* hot per-packet path - probe the 1KB open-PID bitmap first so the
+   * common "not open" answer never touches the sparse pointer table,
+   * then resolve hits with a single indexed load instead of an RB walk */
+  if (!create) {
+    if ((unsigned)pid < 8192 &&
+        !(mm->mm_open_pid_map[pid >> 5] & (1U << (pid & 31))))
+      return NULL;
+    if (mm->mm_pid_tab) {
+      if ((unsigned)pid >= MPEGTS_PID_TAB_SIZE)
+        return NULL;
+      return mm->mm_pid_tab[pid];
+    }
+  }
   if (mm->mm_last_pid != pid)
     return mpegts_mux_find_pid_(mm, pid, create);
   else
@@ -1032,6 +1076,9 @@ void mpegts_input_recv_packets
   (mpegts_mux_instance_t *mmi, sbuf_t *sb,
    int flags, mpegts_pcr_t *pcr);
 
+void mpegts_input_apply_affinity
+  (mpegts_input_t *mi, pthread_t tid);
+
 void mpegts_input_postdemux
   ( mpegts_input_t *mi, mpegts_mux_t *mm, uint8_t *data, int len );
 
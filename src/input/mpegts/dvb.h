@@ -314,12 +314,25 @@ typedef struct mpegts_psi_table_state
   int      working;
   uint32_t sections[8];
   RB_ENTRY(mpegts_psi_table_state) link;
+  struct mpegts_psi_table_state *free_link; ///< slab freelist
 } mpegts_psi_table_state_t;
 
+/* slab-allocated block of table states - avoids per-state malloc/free
+ * churn while EIT carousels restart their tables */
+#define MPEGTS_PSI_STATE_SLAB 32
+
+typedef struct mpegts_psi_table_slab
+{
+  struct mpegts_psi_table_slab *next;
+  mpegts_psi_table_state_t states[MPEGTS_PSI_STATE_SLAB];
+} mpegts_psi_table_slab_t;
+
 typedef struct mpegts_psi_table
 {
   LIST_ENTRY(mpegts_table) mt_link;
   RB_HEAD(,mpegts_psi_table_state) mt_state;
+  mpegts_psi_table_slab_t *mt_state_slabs;
+  mpegts_psi_table_state_t *mt_state_free;
 
   int     mt_subsys;
   char   *mt_name;
@@ -2151,6 +2151,17 @@ dvberr:
 /*
  * DVB fastscan table processing
  */
+
+/* Direct-mapped section dedup cache (hangs off the bouquet); a repeated
+ * carousel section with unchanged payload skips both full service walks */
+#define FS_SECT_CACHE_SIZE 256 /* entries, power of two */
+
+typedef struct fs_sect_cache_entry
+{
+  uint64_t key;                        ///< nbid/section
+  uint32_t crc;                        ///< payload CRC32
+} fs_sect_cache_entry_t;
+
 int
 dvb_fs_sdt_callback
   (mpegts_table_t *mt, const uint8_t *ptr, int len, int tableid)
@@ -2188,11 +2199,31 @@ dvb_fs_sdt_callback
   ptr += 5;
   len -= 5;
 
+  /* Skip both service walks when a new carousel revision repeats an
+   * unchanged section - a version bump alone forces a fresh pass
+   * through dvb_table_begin() above */
+  if (bq) {
+    fs_sect_cache_entry_t *sce;
+    uint64_t skey = ((uint64_t)nbid << 8) | sect;
+    uint32_t crc = tvh_crc32(ptr, len, 0xffffffff);
+
+    if (bq->bq_fastscan_crc == NULL)
+      bq->bq_fastscan_crc = calloc(FS_SECT_CACHE_SIZE,
+                                   sizeof(fs_sect_cache_entry_t));
+    sce = (fs_sect_cache_entry_t *)bq->bq_fastscan_crc +
+          ((uint32_t)(skey ^ (skey >> 8)) & (FS_SECT_CACHE_SIZE - 1));
+    if (sce->key == skey && sce->crc == crc)
+      goto done;
+    sce->key = skey;
+    sce->crc = crc;
+  }
+
   dvb_fs_sdt_mux(mt, mm, st, ptr, len, 1, NULL);
   dvb_fs_sdt_mux(mt, mm, st, ptr, len, 0,
                  bq && bq->bq_fastscan_nit ? bq->bq_fastscan_bi : NULL);
 
   /* End */
+done:
   return dvb_table_end((mpegts_psi_table_t *)mt, st, sect);
 }
 #endif
@@ -237,6 +237,37 @@ mpegts_table_state_restart
   st->version = ver;
 }
 
+/* slab-backed state allocation - states recycle through a per-table
+ * freelist instead of hitting the heap on every carousel restart */
+static mpegts_psi_table_state_t *
+mpegts_table_state_alloc ( mpegts_psi_table_t *mt )
+{
+  mpegts_psi_table_state_t *st;
+  mpegts_psi_table_slab_t *slab;
+  int i;
+
+  if (mt->mt_state_free == NULL) {
+    slab = calloc(1, sizeof(*slab));
+    slab->next = mt->mt_state_slabs;
+    mt->mt_state_slabs = slab;
+    for (i = MPEGTS_PSI_STATE_SLAB - 1; i >= 0; i--) {
+      slab->states[i].free_link = mt->mt_state_free;
+      mt->mt_state_free = &slab->states[i];
+    }
+  }
+  st = mt->mt_state_free;
+  mt->mt_state_free = st->free_link;
+  memset(st, 0, sizeof(*st));
+  return st;
+}
+
+static void
+mpegts_table_state_release ( mpegts_psi_table_t *mt, mpegts_psi_table_state_t *st )
+{
+  st->free_link = mt->mt_state_free;
+  mt->mt_state_free = st;
+}
+
 static mpegts_psi_table_state_t *
 mpegts_table_state_find
   ( mpegts_psi_table_t *mt, int tableid, uint64_t extraid, int last )
@@ -249,7 +280,7 @@ mpegts_table_state_find
   st = RB_FIND(&mt->mt_state, &st_cmp, link, sect_cmp);
   if (st)
     return st;
-  st = calloc(1, sizeof(*st));
+  st = mpegts_table_state_alloc(mt);
   st->tableid = tableid;
   st->extraid = extraid;
   st2 = RB_INSERT_SORTED(&mt->mt_state, st, link, sect_cmp);
@@ -414,7 +445,7 @@ dvb_table_reset(mpegts_psi_table_t *mt)
   mt->mt_last_complete = 0;
   while ((st = RB_FIRST(&mt->mt_state)) != NULL) {
     RB_REMOVE(&mt->mt_state, st, link);
-    free(st);
+    mpegts_table_state_release(mt, st);
   }
 }
 
@@ -422,11 +453,15 @@ void
 dvb_table_release(mpegts_psi_table_t *mt)
 {
   mpegts_psi_table_state_t *st;
+  mpegts_psi_table_slab_t *slab;
 
-  while ((st = RB_FIRST(&mt->mt_state))) {
+  while ((st = RB_FIRST(&mt->mt_state)))
     RB_REMOVE(&mt->mt_state, st, link);
-    free(st);
+  while ((slab = mt->mt_state_slabs) != NULL) {
+    mt->mt_state_slabs = slab->next;
+    free(slab);
   }
+  mt->mt_state_free = NULL;
 }
 
 /*
@@ -718,6 +718,22 @@ dvb_pmt_callback
 
   }
 
+  /* Refresh the persistent PMT cache - replayed at service start so
+   * the CAM programming does not wait for the live carousel */
+  if (len <= 1024 &&
+      (s->s_dvb_pmt_cache == NULL || s->s_dvb_pmt_cache_len != len ||
+       memcmp(s->s_dvb_pmt_cache, ptr, len))) {
+    free(s->s_dvb_pmt_cache);
+    s->s_dvb_pmt_cache = malloc(len);
+    if (s->s_dvb_pmt_cache) {
+      memcpy(s->s_dvb_pmt_cache, ptr, len);
+      s->s_dvb_pmt_cache_len = len;
+    } else {
+      s->s_dvb_pmt_cache_len = 0;
+    }
+    service_request_save((service_t *)s);
+  }
+
 #if ENABLE_LINUXDVB_CA
   dvbcam_pmt_data(s, ptr, len);
 #endif
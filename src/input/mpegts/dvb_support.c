@@ -256,27 +256,15 @@ static inline size_t dvb_convert(int conv,
  * Not all character sets are supported, but it should cover most of them
  */
 
-int
-dvb_get_string
-  (char *dst, size_t dstlen, const uint8_t *src, size_t srclen, 
-   const char *dvb_charset, dvb_string_conv_t *conv)
+static int
+dvb_get_string0
+  (char *dst, size_t dstlen, const uint8_t *src, size_t srclen,
+   const char *dvb_charset)
 {
   int ic = -1;
   size_t len, outlen;
   int i, auto_pl_charset = 0;
 
-  if(srclen < 1) {
-    *dst = 0;
-    return 0;
-  }
-
-  /* Check custom conversion */
-  while (conv && conv->func) {
-    if (conv->type == src[0])
-      return conv->func(dst, &dstlen, src, srclen);
-    conv++;
-  }
-
   // check for automatic polish charset detection
   if (dvb_charset && strcmp("AUTO_POLISH", dvb_charset) == 0) {
     auto_pl_charset = 1;
@@ -383,9 +371,164 @@ dvb_get_string
   return 0;
 }
 
+/*
+ * Conversion result cache - the EIT carousels repeat identical strings
+ * endlessly, so remember the UTF-8 output of recent conversions.  Kept
+ * per thread (like the intlconv descriptors) - every SI input thread
+ * chews on its own carousel, so there is no lock to contend on.
+ */
+
+#define DVB_STRCACHE_ENTRIES  512
+#define DVB_STRCACHE_KEYLEN   256   /* longer strings are left uncached */
+
+typedef struct dvb_strcache_entry {
+  RB_ENTRY(dvb_strcache_entry)    link;
+  TAILQ_ENTRY(dvb_strcache_entry) lru_link;
+  uint32_t       hash;
+  uint16_t       srclen;
+  const uint8_t *src;
+  const char    *charset;
+  const char    *utf8;
+} dvb_strcache_entry_t;
+
+typedef struct dvb_strcache {
+  RB_HEAD(,dvb_strcache_entry)    entries;
+  TAILQ_HEAD(dvb_strcache_entry_queue, dvb_strcache_entry) lru;
+  int            count;
+} dvb_strcache_t;
+
+static __thread dvb_strcache_t *dvb_strcache_tls;
+static pthread_key_t  dvb_strcache_key;
+static pthread_once_t dvb_strcache_once = PTHREAD_ONCE_INIT;
+
+static int
+dvb_strcache_cmp( const void *_a, const void *_b )
+{
+  const dvb_strcache_entry_t *a = _a, *b = _b;
+  int r;
+
+  if (a->hash != b->hash)
+    return a->hash < b->hash ? -1 : 1;
+  if (a->srclen != b->srclen)
+    return (int)a->srclen - (int)b->srclen;
+  if ((r = memcmp(a->src, b->src, a->srclen)) != 0)
+    return r;
+  return strcmp(a->charset, b->charset);
+}
+
+static void
+dvb_strcache_thread_destroy( void *aux )
+{
+  dvb_strcache_t *c = aux;
+  dvb_strcache_entry_t *e;
+
+  while ((e = TAILQ_FIRST(&c->lru)) != NULL) {
+    TAILQ_REMOVE(&c->lru, e, lru_link);
+    free(e);
+  }
+  free(c);
+}
+
+static void
+dvb_strcache_key_create( void )
+{
+  pthread_key_create(&dvb_strcache_key, dvb_strcache_thread_destroy);
+}
+
+static dvb_strcache_t *
+dvb_strcache_get( void )
+{
+  dvb_strcache_t *c = dvb_strcache_tls;
+
+  if (c == NULL) {
+    pthread_once(&dvb_strcache_once, dvb_strcache_key_create);
+    if ((c = calloc(1, sizeof(*c))) != NULL) {
+      TAILQ_INIT(&c->lru);
+      dvb_strcache_tls = c;
+      pthread_setspecific(dvb_strcache_key, c);
+    }
+  }
+  return c;
+}
+
+int
+dvb_get_string
+  (char *dst, size_t dstlen, const uint8_t *src, size_t srclen,
+   const char *dvb_charset, dvb_string_conv_t *conv)
+{
+  dvb_strcache_t *sc;
+  dvb_strcache_entry_t *e, skel;
+  size_t len, csl;
+  uint8_t *p;
+  int r;
+
+  if(srclen < 1) {
+    *dst = 0;
+    return 0;
+  }
+
+  /* Check custom conversion */
+  while (conv && conv->func) {
+    if (conv->type == src[0])
+      return conv->func(dst, &dstlen, src, srclen);
+    conv++;
+  }
+
+  if (srclen > DVB_STRCACHE_KEYLEN || (sc = dvb_strcache_get()) == NULL)
+    return dvb_get_string0(dst, dstlen, src, srclen, dvb_charset);
+
+  skel.hash    = tvh_crc32(src, srclen, 0xffffffff);
+  skel.srclen  = srclen;
+  skel.src     = src;
+  skel.charset = dvb_charset ?: "";
+  e = RB_FIND(&sc->entries, &skel, link, dvb_strcache_cmp);
+  if (e) {
+    if (e != TAILQ_FIRST(&sc->lru)) {
+      TAILQ_REMOVE(&sc->lru, e, lru_link);
+      TAILQ_INSERT_HEAD(&sc->lru, e, lru_link);
+    }
+    len = strlen(e->utf8);
+    if (len >= dstlen)
+      return -1;
+    memcpy(dst, e->utf8, len + 1);
+    return 0;
+  }
+
+  r = dvb_get_string0(dst, dstlen, src, srclen, dvb_charset);
+  if (r)
+    return r;
+
+  /* Remember the result - one block for the entry, key and value */
+  if (sc->count >= DVB_STRCACHE_ENTRIES) {
+    e = TAILQ_LAST(&sc->lru, dvb_strcache_entry_queue);
+    TAILQ_REMOVE(&sc->lru, e, lru_link);
+    RB_REMOVE(&sc->entries, e, link);
+    free(e);
+    sc->count--;
+  }
+  len = strlen(dst);
+  csl = strlen(skel.charset);
+  e = malloc(sizeof(*e) + srclen + csl + 1 + len + 1);
+  if (e) {
+    p = (uint8_t *)(e + 1);
+    memcpy(p, src, srclen);
+    e->src = p; p += srclen;
+    memcpy(p, skel.charset, csl + 1);
+    e->charset = (const char *)p; p += csl + 1;
+    memcpy(p, dst, len + 1);
+    e->utf8 = (const char *)p;
+    e->hash = skel.hash;
+    e->srclen = srclen;
+    RB_INSERT_SORTED(&sc->entries, e, link, dvb_strcache_cmp);
+    TAILQ_INSERT_HEAD(&sc->lru, e, lru_link);
+    sc->count++;
+  }
+  return 0;
+}
+
 
 int
-dvb_get_string_with_len(char *dst, size_t dstlen, 
+dvb_get_string_with_len(char *dst, size_t dstlen,
 			const uint8_t *buf, size_t buflen, const char *dvb_charset,
       dvb_string_conv_t *conv)
 {
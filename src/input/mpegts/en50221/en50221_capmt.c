@@ -134,6 +134,9 @@ int en50221_capmt_build
   switch (bcmd) {
   case EN50221_CAPMT_BUILD_ONLY:   d[0] = 3; break;
   case EN50221_CAPMT_BUILD_ADD:    d[0] = 4; break;
+  case EN50221_CAPMT_BUILD_FIRST:  d[0] = 1; break;
+  case EN50221_CAPMT_BUILD_MORE:   d[0] = 0; break;
+  case EN50221_CAPMT_BUILD_LAST:   d[0] = 2; break;
   case EN50221_CAPMT_BUILD_DELETE:
     cmd_id = EN50221_CAPMT_CMD_NOTSEL;
     /* fallthru */
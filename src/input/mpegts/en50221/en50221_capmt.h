@@ -27,6 +27,9 @@ struct mpegts_service;
 #define EN50221_CAPMT_BUILD_ONLY         1
 #define EN50221_CAPMT_BUILD_ADD          2
 #define EN50221_CAPMT_BUILD_UPDATE       4
+#define EN50221_CAPMT_BUILD_FIRST        8
+#define EN50221_CAPMT_BUILD_MORE         16
+#define EN50221_CAPMT_BUILD_LAST         32
 
 int en50221_capmt_build
   (struct mpegts_service *s,
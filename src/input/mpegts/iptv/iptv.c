@@ -55,6 +55,99 @@ static inline int iptv_tpool_safe_count(void)
   return MINMAX(config.iptv_tpool_count, 1, 128);
 }
 
+/* **************************************************************************
+ * IPTV receive buffer pool
+ *
+ * Mux starts and stops (and the RET double-buffering) used to hammer
+ * malloc/free with ~370KB buffers.  Recycle the backing stores through a
+ * small size-classed pool instead, so steady-state operation and channel
+ * zapping on large setups perform no allocations at all.  The per-class
+ * depth is the high watermark; when the last stream stops the pool is
+ * trimmed down to the low watermark.
+ * *************************************************************************/
+
+typedef struct iptv_buffer_free {
+  struct iptv_buffer_free *next;
+} iptv_buffer_free_t;
+
+static tvh_mutex_t iptv_buffer_pool_lock;
+static iptv_buffer_free_t *iptv_buffer_pool[IPTV_BUF_POOL_CLASSES];
+static int iptv_buffer_pool_count[IPTV_BUF_POOL_CLASSES];
+
+static inline int
+iptv_buffer_pool_class ( int size )
+{
+  int c;
+  for (c = 0; c < IPTV_BUF_POOL_CLASSES; c++)
+    if (size <= IPTV_BUF_SIZE << c)
+      return c;
+  return -1;
+}
+
+void
+iptv_buffer_alloc ( sbuf_t *sb, int len )
+{
+  iptv_buffer_free_t *f = NULL;
+  int c = iptv_buffer_pool_class(len);
+
+  if (c >= 0) {
+    tvh_mutex_lock(&iptv_buffer_pool_lock);
+    if ((f = iptv_buffer_pool[c]) != NULL) {
+      iptv_buffer_pool[c] = f->next;
+      iptv_buffer_pool_count[c]--;
+    }
+    tvh_mutex_unlock(&iptv_buffer_pool_lock);
+  }
+  if (f) {
+    sbuf_free(sb);
+    sb->sb_data = (uint8_t *)f;
+    sb->sb_size = IPTV_BUF_SIZE << c;
+    sb->sb_ptr = sb->sb_err = 0;
+  } else {
+    sbuf_reset_and_alloc(sb, c >= 0 ? IPTV_BUF_SIZE << c : len);
+  }
+}
+
+void
+iptv_buffer_release ( sbuf_t *sb )
+{
+  iptv_buffer_free_t *f;
+  int c;
+
+  /* only buffers still at a class size are worth keeping - anything
+   * grown to an odd size by a bitrate spike is simply trimmed away */
+  c = sb->sb_data ? iptv_buffer_pool_class(sb->sb_size) : -1;
+  if (c >= 0 && sb->sb_size == IPTV_BUF_SIZE << c) {
+    tvh_mutex_lock(&iptv_buffer_pool_lock);
+    if (iptv_buffer_pool_count[c] < IPTV_BUF_POOL_HIGH) {
+      f = (iptv_buffer_free_t *)sb->sb_data;
+      f->next = iptv_buffer_pool[c];
+      iptv_buffer_pool[c] = f;
+      iptv_buffer_pool_count[c]++;
+      sbuf_steal_data(sb);
+    }
+    tvh_mutex_unlock(&iptv_buffer_pool_lock);
+  }
+  sbuf_free(sb);
+}
+
+static void
+iptv_buffer_pool_trim ( void )
+{
+  iptv_buffer_free_t *f;
+  int c;
+
+  tvh_mutex_lock(&iptv_buffer_pool_lock);
+  for (c = 0; c < IPTV_BUF_POOL_CLASSES; c++)
+    while (iptv_buffer_pool_count[c] > IPTV_BUF_POOL_LOW) {
+      f = iptv_buffer_pool[c];
+      iptv_buffer_pool[c] = f->next;
+      iptv_buffer_pool_count[c]--;
+      free(f);
+    }
+  tvh_mutex_unlock(&iptv_buffer_pool_lock);
+}
+
 /* **************************************************************************
  * IPTV handlers
  * *************************************************************************/
@@ -470,7 +563,7 @@ iptv_input_stop_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
   iptv_input_close_fds((iptv_input_t *)mi, im);
 
   /* Free memory */
-  sbuf_free(&im->mm_iptv_buffer);
+  iptv_buffer_release(&im->mm_iptv_buffer);
 
   /* Clear bw limit */
   ((iptv_network_t *)im->mm_network)->in_bw_limited = 0;
@@ -715,7 +808,7 @@ iptv_input_mux_started ( iptv_input_t *mi, iptv_mux_t *im, int reset )
 {
   /* Allocate input buffer */
   if (reset)
-    sbuf_reset_and_alloc(&im->mm_iptv_buffer, IPTV_BUF_SIZE);
+    iptv_buffer_alloc(&im->mm_iptv_buffer, IPTV_BUF_SIZE);
 
   im->im_pcr = PTS_UNSET;
   im->im_pcr_pid = MPEGTS_PID_NONE;
@@ -1281,12 +1374,14 @@ static void
 iptv_input_thread_manage_cb(void *aux)
 {
   iptv_input_thread_manage(iptv_tpool_safe_count(), 0);
+  iptv_buffer_pool_trim();
 }
 
 void iptv_init ( void )
 {
   TAILQ_INIT(&iptv_tpool);
   tvh_mutex_init(&iptv_lock, NULL);
+  tvh_mutex_init(&iptv_buffer_pool_lock, NULL);
 
   /* Register handlers */
   iptv_http_init();
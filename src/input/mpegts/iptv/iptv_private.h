@@ -31,6 +31,12 @@
 #define IPTV_PKTS        32
 #define IPTV_PKT_PAYLOAD 1472
 
+/* receive buffer pool - size classes IPTV_BUF_SIZE << 0..n-1,
+ * high/low watermarks per class */
+#define IPTV_BUF_POOL_CLASSES 4
+#define IPTV_BUF_POOL_HIGH    16
+#define IPTV_BUF_POOL_LOW     2
+
 typedef struct iptv_input   iptv_input_t;
 typedef struct iptv_network iptv_network_t;
 typedef struct iptv_mux     iptv_mux_t;
@@ -67,6 +73,9 @@ int  iptv_input_recv_packets ( iptv_mux_t *im, ssize_t len );
 void iptv_input_recv_flush ( iptv_mux_t *im );
 void iptv_input_pause_handler ( iptv_input_t *mi, iptv_mux_t *im, int pause );
 
+void iptv_buffer_alloc ( sbuf_t *sb, int len );
+void iptv_buffer_release ( sbuf_t *sb );
+
 struct iptv_network
 {
   mpegts_network_t;
@@ -51,13 +51,21 @@ iptv_udp_start
   im->mm_iptv_fd         = conn->fd;
   im->mm_iptv_connection = conn;
 
+  /* Let the kernel coalesce same-flow datagrams where supported */
+  if (udp_multirecv_gro_enable(&im->im_um, conn->fd) == 0)
+    tvhdebug(LS_IPTV, "%s - UDP GRO enabled", im->mm_nicename);
+
+  /* Wire arrival stamps for the latency accounting */
+  if (udp_multirecv_timestamp_enable(&im->im_um, conn->fd) == 0)
+    tvhdebug(LS_IPTV, "%s - receive timestamping enabled", im->mm_nicename);
+
   /* Setup the RTCP Retransmission connection when configured */
   rtcp_init(&im->im_rtcp_info);
   if(im->mm_iptv_ret_url && rtcp_connect(&im->im_rtcp_info, im->mm_iptv_ret_url,
           NULL, 0, im->mm_iptv_interface, im->mm_nicename) == 0) {
       im->im_use_retransmission = 1;
       udp_multirecv_init(&im->im_rtcp_info.um, IPTV_PKTS, IPTV_PKT_PAYLOAD);
-      sbuf_reset_and_alloc(&im->im_temp_buffer, IPTV_BUF_SIZE);
+      iptv_buffer_alloc(&im->im_temp_buffer, IPTV_BUF_SIZE);
   }
 
   im->mm_iptv_rtp_seq = -1;
@@ -74,7 +82,7 @@ iptv_udp_stop
   tvh_mutex_unlock(&iptv_lock);
   udp_multirecv_free(&im->im_um);
   udp_multirecv_free(&im->im_rtcp_info.um);
-  sbuf_free(&im->im_temp_buffer);
+  iptv_buffer_release(&im->im_temp_buffer);
   tvh_mutex_lock(&iptv_lock);
 }
 
@@ -98,6 +106,9 @@ iptv_udp_read ( iptv_input_t *mi, iptv_mux_t *im )
       continue;
     }
     sbuf_append(&im->mm_iptv_buffer, iovec->iov_base, iovec->iov_len);
+    if (im->im_um.um_stamps && im->im_um.um_stamps[i] &&
+        im->mm_iptv_buffer.sb_arrival == 0)
+      im->mm_iptv_buffer.sb_arrival = im->im_um.um_stamps[i];
     res += iovec->iov_len;
   }
 
@@ -140,6 +151,15 @@ iptv_rtp_read(iptv_mux_t *im, void (*pkt_cb)(iptv_mux_t *im, uint8_t *pkt, int l
   if (n < 0)
     return -1;
 
+  /* the oldest stamped datagram approximates the batch arrival */
+  if (!is_ret_buffer && im->im_um.um_stamps &&
+      im->mm_iptv_buffer.sb_arrival == 0)
+    for (i = 0; i < n; i++)
+      if (im->im_um.um_stamps[i]) {
+        im->mm_iptv_buffer.sb_arrival = im->im_um.um_stamps[i];
+        break;
+      }
+
   seq = im->mm_iptv_rtp_seq;
 
   for (i = 0; i < n; i++, iovec++) {
@@ -227,7 +247,7 @@ iptv_rtp_read(iptv_mux_t *im, void (*pkt_cb)(iptv_mux_t *im, uint8_t *pkt, int l
         im->im_rtcp_info.ce_cnt = 0;
         im->im_is_ce_detected = 0;
         sbuf_append_from_sbuf(&im->mm_iptv_buffer, &im->im_temp_buffer);
-        sbuf_reset_and_alloc(&im->im_temp_buffer, IPTV_BUF_SIZE);
+        iptv_buffer_alloc(&im->im_temp_buffer, IPTV_BUF_SIZE);
       }
     } else {
       /* Move data */
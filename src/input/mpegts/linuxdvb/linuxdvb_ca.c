@@ -85,9 +85,14 @@ typedef enum {
   CA_WRITE_CMD_PCMCIA_RATE,
 } ca_write_cmd_t;
 
+/* CAPMT list transaction membership (first/more/last batching) */
+#define LCW_F_CONT  0x01 /* continuation - a previous member was already sent */
+#define LCW_F_MORE  0x02 /* more members follow in the same transaction */
+
 struct linuxdvb_ca_write {
   TAILQ_ENTRY(linuxdvb_ca_write) lcw_link;
   int      cmd;
+  int      flags;
   int      len;
   uint8_t  data[0];
 };
@@ -251,14 +256,14 @@ linuxdvb_ca_process_cmd
     interval = lca->lca_capmt_query_interval;
     /* Fall thru */
   case CA_WRITE_CMD_CAPMT:
-    if (lca->lca_capmt_blocked >= mclk())
+    if ((lcw->flags & LCW_F_CONT) == 0 && lca->lca_capmt_blocked >= mclk())
       return 1;
     if (lcw->len > 0) {
       r = en50221_send_capmt(slot, lcw->data, lcw->len);
       if (r < 0)
         tvherror(LS_EN50221, "%s: unable to write capmt (%d)",
                  lca->lca_name, r);
-      else if (interval > 0)
+      else if (interval > 0 && (lcw->flags & LCW_F_MORE) == 0)
         lca->lca_capmt_blocked = mclk() + ms2mono(interval);
     }
     break;
@@ -487,18 +492,30 @@ static void linuxdvb_ca_thread_join_cb(void *aux)
   linuxdvb_ca_thread_join();
 }
 
-static int linuxdvb_ca_write_cmd
-  (linuxdvb_ca_t *lca, int cmd, const uint8_t *data, size_t datalen)
+static linuxdvb_ca_write_t *linuxdvb_ca_write_alloc
+  (int cmd, int flags, const uint8_t *data, size_t datalen)
 {
   linuxdvb_ca_write_t *lcw;
-  int trigger;
 
   lcw = calloc(1, sizeof(*lcw) + datalen);
   if (!lcw)
-    return -ENOMEM;
+    return NULL;
   lcw->len = datalen;
   lcw->cmd = cmd;
+  lcw->flags = flags;
   memcpy(lcw->data, data, datalen);
+  return lcw;
+}
+
+static int linuxdvb_ca_write_cmd
+  (linuxdvb_ca_t *lca, int cmd, const uint8_t *data, size_t datalen)
+{
+  linuxdvb_ca_write_t *lcw;
+  int trigger;
+
+  lcw = linuxdvb_ca_write_alloc(cmd, 0, data, datalen);
+  if (!lcw)
+    return -ENOMEM;
 
   tvh_mutex_lock(&linuxdvb_capmt_mutex);
   trigger = TAILQ_EMPTY(&lca->lca_write_queue);
@@ -1153,3 +1170,75 @@ linuxdvb_ca_enqueue_capmt
 
   tvh_write(linuxdvb_ca_pipe.wr, "m", 1);
 }
+
+void
+linuxdvb_ca_enqueue_capmt_list
+  ( linuxdvb_ca_t *lca, uint8_t **capmts, size_t *capmtlens,
+    int count, int descramble )
+{
+  linuxdvb_ca_write_t *lcw, *lcw2, **list;
+  uint8_t *capmt2;
+  size_t capmtlen2;
+  int i, flags, n = 0;
+
+  if (!lca || !capmts || count <= 0)
+    return;
+
+  list = alloca(sizeof(*list) * count * 2);
+
+  /* optional query pass - ask for the whole list before descrambling */
+  if (descramble && lca->lca_capmt_query) {
+    for (i = 0; i < count; i++) {
+      if (en50221_capmt_build_query(capmts[i], capmtlens[i],
+                                    &capmt2, &capmtlen2))
+        break;
+      flags  = i > 0 ? LCW_F_CONT : 0;
+      flags |= i < count - 1 ? LCW_F_MORE : 0;
+      lcw = linuxdvb_ca_write_alloc(CA_WRITE_CMD_CAPMT_QUERY, flags,
+                                    capmt2, capmtlen2);
+      free(capmt2);
+      if (lcw == NULL)
+        break;
+      list[n++] = lcw;
+    }
+    if (i < count) {
+      /* incomplete transaction - throw the query pass away */
+      while (n > 0)
+        free(list[--n]);
+    }
+  }
+
+  for (i = 0; i < count; i++) {
+    flags  = i > 0 ? LCW_F_CONT : 0;
+    flags |= i < count - 1 ? LCW_F_MORE : 0;
+    lcw = linuxdvb_ca_write_alloc(CA_WRITE_CMD_CAPMT, flags,
+                                  capmts[i], capmtlens[i]);
+    if (lcw == NULL) {
+      while (n > 0)
+        free(list[--n]);
+      return;
+    }
+    list[n++] = lcw;
+  }
+
+  tvh_mutex_lock(&linuxdvb_capmt_mutex);
+  /* the complete list supersedes all CAPMTs not yet sent to the CAM */
+  for (lcw = TAILQ_FIRST(&lca->lca_write_queue); lcw != NULL; lcw = lcw2) {
+    lcw2 = TAILQ_NEXT(lcw, lcw_link);
+    if (lcw->cmd == CA_WRITE_CMD_CAPMT ||
+        lcw->cmd == CA_WRITE_CMD_CAPMT_QUERY) {
+      TAILQ_REMOVE(&lca->lca_write_queue, lcw, lcw_link);
+      free(lcw);
+    }
+  }
+  for (i = 0; i < n; i++)
+    TAILQ_INSERT_TAIL(&lca->lca_write_queue, list[i], lcw_link);
+  tvh_mutex_unlock(&linuxdvb_capmt_mutex);
+
+  tvhtrace(LS_EN50221, "%s: CAPMT list enqueued (%d objects)",
+           lca->lca_name, count);
+  for (i = 0; i < count; i++)
+    en50221_capmt_dump(LS_EN50221, lca->lca_name, capmts[i], capmtlens[i]);
+
+  tvh_write(linuxdvb_ca_pipe.wr, "m", 1);
+}
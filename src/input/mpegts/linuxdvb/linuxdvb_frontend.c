@@ -35,7 +35,17 @@
 #include <poll.h>
 #include <linux/dvb/dmx.h>
 #include <linux/dvb/frontend.h>
-#include <dvbdab/dvbdab_c.h> 
+#include <dvbdab/dvbdab_c.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && \
+    defined(__NR_io_uring_register)
+#include <linux/io_uring.h>
+#define LINUXDVB_URING 1
+#endif
+#endif
 
 #define NOSIGNAL(x) (((x) & FE_HAS_SIGNAL) == 0)
 
@@ -45,6 +55,12 @@ static void *
 linuxdvb_frontend_input_thread ( void *aux );
 static void
 linuxdvb_t2mi_done ( linuxdvb_frontend_t *lfe );
+static int
+linuxdvb_t2mi_shared_carrier ( mpegts_mux_t *cur, mpegts_mux_t *mm );
+static void
+linuxdvb_t2mi_fan_attach ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi );
+static int
+linuxdvb_t2mi_fan_detach ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi );
 static void
 linuxdvb_dab_done ( linuxdvb_frontend_t *lfe );
 #if ENABLE_LINUXDVB_NEUMO
@@ -691,6 +707,7 @@ linuxdvb_frontend_stop_mux
 {
   char buf1[256];
   linuxdvb_frontend_t *lfe = (linuxdvb_frontend_t*)mi, *lfe2;
+  linuxdvb_t2mi_fan_t *ltf;
 
   if (lfe->lfe_master)
     assert(lfe->lfe_type == DVB_TYPE_S);
@@ -698,6 +715,14 @@ linuxdvb_frontend_stop_mux
   mi->mi_display_name(mi, buf1, sizeof(buf1));
   tvhdebug(LS_LINUXDVB, "%s - stopping %s", buf1, mmi->mmi_mux->mm_nicename);
 
+  /* Sub-mux riding another tune: just remove it from the fan-out */
+  if (linuxdvb_t2mi_fan_detach(lfe, mmi))
+    return;
+
+  /* The tune owner is going away - stop sub-muxes riding it first */
+  while ((ltf = LIST_FIRST(&lfe->lfe_t2mi_fans)) != NULL)
+    ltf->ltf_mmi->mmi_mux->mm_stop(ltf->ltf_mmi->mmi_mux, 1, SM_CODE_ABORTED);
+
   /* Cleanup T2MI if active */
   linuxdvb_t2mi_done(lfe);
 
@@ -764,6 +789,12 @@ linuxdvb_frontend_warm_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
   mpegts_mux_instance_t *lmmi = NULL;
   int r;
 
+  /* The new mux can share the currently tuned carrier - keep it */
+  lmmi = LIST_FIRST(&mi->mi_mux_active);
+  if (lmmi && lfe->lfe_t2mi_ctx &&
+      linuxdvb_t2mi_shared_carrier(lmmi->mmi_mux, mmi->mmi_mux))
+    return 0;
+
   r = mpegts_input_warm_mux(mi, mmi);
   if (r)
     return r;
@@ -788,6 +819,77 @@ linuxdvb_frontend_warm_mux ( mpegts_input_t *mi, mpegts_mux_instance_t *mmi )
  * T2MI decapsulation support
  * *************************************************************************/
 
+/*
+ * PLP selection of a T2MI mux; stream id outside the PLP range means
+ * no filter (all PLPs, the previous behaviour)
+ */
+static int
+linuxdvb_t2mi_mux_plp ( dvb_mux_t *dm )
+{
+  int32_t sid = dm->lm_tuning.dmc_fe_stream_id;
+  return (sid >= 0 && sid < T2MI_PLP_ALL) ? sid : T2MI_PLP_ALL;
+}
+
+/*
+ * Check whether a second T2MI mux can ride the tune of the current one:
+ * same physical carrier and same encapsulation PID, so the running
+ * decapsulation sees its PLP already
+ */
+static int
+linuxdvb_t2mi_shared_carrier ( mpegts_mux_t *cur, mpegts_mux_t *mm )
+{
+  dvb_mux_t *a = (dvb_mux_t *)cur, *b = (dvb_mux_t *)mm;
+
+  if (cur == mm)
+    return 0;
+  if (cur->mm_type != MM_TYPE_T2MI || mm->mm_type != MM_TYPE_T2MI)
+    return 0;
+  if (a->lm_tuning.dmc_fe_pid != b->lm_tuning.dmc_fe_pid)
+    return 0;
+  return dvb_mux_conf_same_carrier(&a->lm_tuning, &b->lm_tuning);
+}
+
+/*
+ * Attach a sub-mux instance to the shared decapsulation fan-out
+ */
+static void
+linuxdvb_t2mi_fan_attach ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi )
+{
+  linuxdvb_t2mi_fan_t *ltf = calloc(1, sizeof(*ltf));
+
+  ltf->ltf_mmi = mmi;
+  ltf->ltf_plp = linuxdvb_t2mi_mux_plp((dvb_mux_t *)mmi->mmi_mux);
+  sbuf_init(&ltf->ltf_buffer);
+  tvh_mutex_lock(&lfe->lfe_dvr_lock);
+  LIST_INSERT_HEAD(&lfe->lfe_t2mi_fans, ltf, ltf_link);
+  tvh_mutex_unlock(&lfe->lfe_dvr_lock);
+  tvhinfo(LS_LINUXDVB, "T2MI fan-out: %s shares the tuned carrier (PLP %d)",
+          mmi->mmi_mux->mm_nicename, ltf->ltf_plp);
+}
+
+/*
+ * Detach a sub-mux instance; returns 0 when the instance was not
+ * part of the fan-out (i.e. it owns the tune)
+ */
+static int
+linuxdvb_t2mi_fan_detach ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi )
+{
+  linuxdvb_t2mi_fan_t *ltf;
+
+  tvh_mutex_lock(&lfe->lfe_dvr_lock);
+  LIST_FOREACH(ltf, &lfe->lfe_t2mi_fans, ltf_link)
+    if (ltf->ltf_mmi == mmi)
+      break;
+  if (ltf)
+    LIST_REMOVE(ltf, ltf_link);
+  tvh_mutex_unlock(&lfe->lfe_dvr_lock);
+  if (ltf == NULL)
+    return 0;
+  sbuf_free(&ltf->ltf_buffer);
+  free(ltf);
+  return 1;
+}
+
 /*
  * T2MI output callback - called by decapsulator for each inner TS packet
  */
@@ -795,10 +897,32 @@ static void
 linuxdvb_t2mi_output_cb ( void *opaque, const uint8_t *pkt, uint8_t plp_id )
 {
   linuxdvb_frontend_t *lfe = opaque;
-  (void)plp_id;
+  linuxdvb_t2mi_fan_t *ltf;
+
+  /* Route to the owning mux and any attached sub-muxes by PLP */
+  if (lfe->lfe_t2mi_plp == T2MI_PLP_ALL || plp_id == lfe->lfe_t2mi_plp)
+    sbuf_append(&lfe->lfe_t2mi_buffer, pkt, 188);
+  LIST_FOREACH(ltf, &lfe->lfe_t2mi_fans, ltf_link)
+    if (ltf->ltf_plp == T2MI_PLP_ALL || plp_id == ltf->ltf_plp)
+      sbuf_append(&ltf->ltf_buffer, pkt, 188);
+}
 
-  /* Append to output buffer */
-  sbuf_append(&lfe->lfe_t2mi_buffer, pkt, 188);
+/*
+ * T2MI batch output callback - called once per baseband frame with the
+ * whole run of inner TS packets
+ */
+static void
+linuxdvb_t2mi_output_run_cb
+  ( void *opaque, const uint8_t *data, size_t len, uint8_t plp_id )
+{
+  linuxdvb_frontend_t *lfe = opaque;
+  linuxdvb_t2mi_fan_t *ltf;
+
+  if (lfe->lfe_t2mi_plp == T2MI_PLP_ALL || plp_id == lfe->lfe_t2mi_plp)
+    sbuf_append(&lfe->lfe_t2mi_buffer, data, len);
+  LIST_FOREACH(ltf, &lfe->lfe_t2mi_fans, ltf_link)
+    if (ltf->ltf_plp == T2MI_PLP_ALL || plp_id == ltf->ltf_plp)
+      sbuf_append(&ltf->ltf_buffer, data, len);
 }
 
 /*
@@ -814,16 +938,19 @@ linuxdvb_t2mi_init ( linuxdvb_frontend_t *lfe, dvb_mux_t *dm )
     return -1;
   }
 
-  /* Create decapsulation context */
+  /* Create decapsulation context; the decapsulator extracts all PLPs
+   * once, the output callbacks fan them out per mux */
   lfe->lfe_t2mi_ctx = t2mi_decap_create(t2mi_pid, T2MI_PLP_ALL,
                                          linuxdvb_t2mi_output_cb, lfe);
   if (!lfe->lfe_t2mi_ctx) {
     tvherror(LS_LINUXDVB, "Failed to create T2MI decapsulation context");
     return -1;
   }
+  t2mi_decap_set_run_cb(lfe->lfe_t2mi_ctx, linuxdvb_t2mi_output_run_cb);
 
   /* Initialize output buffer */
   sbuf_init(&lfe->lfe_t2mi_buffer);
+  lfe->lfe_t2mi_plp = linuxdvb_t2mi_mux_plp(dm);
   lfe->lfe_stream_pid = t2mi_pid;
 
   tvhinfo(LS_LINUXDVB, "T2MI decapsulation initialized for PID 0x%04X", t2mi_pid);
@@ -841,6 +968,7 @@ linuxdvb_t2mi_done ( linuxdvb_frontend_t *lfe )
     lfe->lfe_t2mi_ctx = NULL;
   }
   sbuf_free(&lfe->lfe_t2mi_buffer);
+  lfe->lfe_t2mi_plp = 0;
   lfe->lfe_stream_pid = 0;
 }
 
@@ -853,9 +981,14 @@ linuxdvb_t2mi_process ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi,
                         sbuf_t *sb )
 {
   uint8_t *data = sb->sb_data;
+  linuxdvb_t2mi_fan_t *ltf;
   size_t len = sb->sb_ptr;
   size_t i;
 
+  /* The fan list is walked by the decapsulator callbacks and mutated
+   * from the mux start/stop path */
+  tvh_mutex_lock(&lfe->lfe_dvr_lock);
+
   /* Process each TS packet */
   for (i = 0; i + 188 <= len; i += 188) {
     uint8_t *pkt = &data[i];
@@ -868,6 +1001,13 @@ linuxdvb_t2mi_process ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi,
     t2mi_decap_feed(lfe->lfe_t2mi_ctx, pkt);
   }
 
+  /* Deliver to the attached sub-muxes */
+  LIST_FOREACH(ltf, &lfe->lfe_t2mi_fans, ltf_link)
+    if (ltf->ltf_buffer.sb_ptr > 0)
+      mpegts_input_recv_packets(ltf->ltf_mmi, &ltf->ltf_buffer, 0, NULL);
+
+  tvh_mutex_unlock(&lfe->lfe_dvr_lock);
+
   /* Clear input buffer */
   sbuf_cut(sb, len);
 
@@ -1262,8 +1402,19 @@ linuxdvb_frontend_start_mux
 {
   linuxdvb_frontend_t *lfe = (linuxdvb_frontend_t*)mi, *lfe2;
   mpegts_mux_t *mm = mmi->mmi_mux;
+  mpegts_mux_instance_t *cur;
   int res, f;
 
+  /* Shared-carrier attach: the carrier is already tuned with a running
+   * decapsulator, so the sub-mux only joins the PLP fan-out */
+  if (lfe->lfe_t2mi_ctx) {
+    cur = LIST_FIRST(&mi->mi_mux_active);
+    if (cur && linuxdvb_t2mi_shared_carrier(cur->mmi_mux, mm)) {
+      linuxdvb_t2mi_fan_attach(lfe, mmi);
+      return 0;
+    }
+  }
+
   assert(lfe->lfe_in_setup == 0);
 
   /* Check for T2MI mux */
@@ -1676,11 +1827,131 @@ linuxdvb_frontend_blindscan_update_mux(linuxdvb_frontend_t *lfe, dvb_mux_t *lm)
 }
 #endif /* ENABLE_LINUXDVB_NEUMO */
 
+/*
+ * Asynchronous frontend statistics - all wanted stats are batched into
+ * one FE_GET_PROPERTY array (or the old FE_READ_* set) executed on the
+ * low-priority tasklet thread, so drivers which block inside the status
+ * ioctls can never stall the timer callbacks holding the global lock.
+ * The job owns a dup()ed frontend fd and carries no pointer back to the
+ * frontend, so it does not depend on the frontend lifetime at all.
+ */
+
+typedef struct linuxdvb_status_job {
+  tasklet_t  sj_tasklet;
+  int        sj_fd;
+  int        sj_done;      ///< protected by linuxdvb_status_lock
+  int        sj_orphan;    ///< frontend gone, free after completion
+#if DVB_VER_ATLEAST(5,10)
+  int        sj_try_prop;
+  int        sj_gotprop;
+  struct dtv_property sj_props[6];
+#endif
+  int        sj_try[5];    ///< old API - ioctls to attempt
+  int        sj_ok[5];     ///< old API - ioctls which succeeded
+  uint16_t   sj_signal;
+  uint32_t   sj_ber;
+  uint16_t   sj_snr;
+  uint32_t   sj_unc;
+} linuxdvb_status_job_t;
+
+static tvh_mutex_t linuxdvb_status_lock = TVH_THREAD_MUTEX_INITIALIZER;
+
+static void
+linuxdvb_frontend_status_tasklet ( void *aux, int disarmed )
+{
+  linuxdvb_status_job_t *sj = aux;
+  int orphan;
+#if DVB_VER_ATLEAST(5,10)
+  struct dtv_properties dtv_prop;
+  int i;
+#endif
+
+  if (!disarmed) {
+#if DVB_VER_ATLEAST(5,10)
+    if (sj->sj_try_prop) {
+      dtv_prop.num = 6;
+      dtv_prop.props = sj->sj_props;
+      if (!ioctl(sj->sj_fd, FE_GET_PROPERTY, &dtv_prop))
+        for (i = 0; i < dtv_prop.num; i++)
+          if (sj->sj_props[i].u.st.len > 0) {
+            sj->sj_gotprop = 1;
+            break;
+          }
+    }
+    if (!sj->sj_gotprop)
+#endif
+    {
+      if (sj->sj_try[1] && !ioctl(sj->sj_fd, FE_READ_SIGNAL_STRENGTH, &sj->sj_signal))
+        sj->sj_ok[1] = 1;
+      if (sj->sj_try[2] && !ioctl(sj->sj_fd, FE_READ_BER, &sj->sj_ber))
+        sj->sj_ok[2] = 1;
+      if (sj->sj_try[3] && !ioctl(sj->sj_fd, FE_READ_SNR, &sj->sj_snr))
+        sj->sj_ok[3] = 1;
+      if (sj->sj_try[4] && !ioctl(sj->sj_fd, FE_READ_UNCORRECTED_BLOCKS, &sj->sj_unc))
+        sj->sj_ok[4] = 1;
+    }
+  }
+
+  close(sj->sj_fd);
+  tvh_mutex_lock(&linuxdvb_status_lock);
+  sj->sj_done = 1;
+  orphan = sj->sj_orphan;
+  tvh_mutex_unlock(&linuxdvb_status_lock);
+  if (orphan)
+    free(sj);
+}
+
+static void
+linuxdvb_frontend_status_start ( linuxdvb_frontend_t *lfe )
+{
+  linuxdvb_status_job_t *sj;
+  int fd;
+
+  if (lfe->lfe_fe_fd <= 0)
+    return;
+  fd = dup(lfe->lfe_fe_fd);
+  if (fd < 0)
+    return;
+  sj = calloc(1, sizeof(*sj));
+  sj->sj_fd = fd;
+#if DVB_VER_ATLEAST(5,10)
+  sj->sj_props[0].cmd = DTV_STAT_SIGNAL_STRENGTH;
+  sj->sj_props[1].cmd = DTV_STAT_PRE_ERROR_BIT_COUNT;
+  sj->sj_props[2].cmd = DTV_STAT_PRE_TOTAL_BIT_COUNT;
+  sj->sj_props[3].cmd = DTV_STAT_CNR;
+  sj->sj_props[4].cmd = DTV_STAT_ERROR_BLOCK_COUNT;
+  sj->sj_props[5].cmd = DTV_STAT_TOTAL_BLOCK_COUNT;
+  sj->sj_try_prop = ioctl_check(lfe, 0) && !lfe->lfe_old_status;
+#endif
+  sj->sj_try[1] = ioctl_check(lfe, 1);
+  sj->sj_try[2] = ioctl_check(lfe, 2);
+  sj->sj_try[3] = ioctl_check(lfe, 3);
+  sj->sj_try[4] = ioctl_check(lfe, 4);
+  lfe->lfe_status_job = sj;
+  tasklet_arm(&sj->sj_tasklet, linuxdvb_frontend_status_tasklet, sj);
+}
+
+static void
+linuxdvb_frontend_status_stop ( linuxdvb_frontend_t *lfe )
+{
+  linuxdvb_status_job_t *sj = lfe->lfe_status_job;
+
+  if (sj == NULL)
+    return;
+  tvh_mutex_lock(&linuxdvb_status_lock);
+  if (sj->sj_done) {
+    tvh_mutex_unlock(&linuxdvb_status_lock);
+    free(sj);
+  } else {
+    sj->sj_orphan = 1;
+    tvh_mutex_unlock(&linuxdvb_status_lock);
+  }
+  lfe->lfe_status_job = NULL;
+}
+
 static void
 linuxdvb_frontend_monitor ( void *aux )
 {
-  uint16_t u16;
-  uint32_t u32;
   char buf[256];
   linuxdvb_frontend_t *lfe = aux;
   mpegts_mux_instance_t *mmi = LIST_FIRST(&lfe->mi_mux_active);
@@ -1692,9 +1963,8 @@ linuxdvb_frontend_monitor ( void *aux )
   service_t *s;
   int logit = 0, retune, e;
   uint32_t period = MINMAX(lfe->lfe_status_period, 250, 8000);
+  linuxdvb_status_job_t *sj;
 #if DVB_VER_ATLEAST(5,10)
-  struct dtv_property fe_properties[6];
-  struct dtv_properties dtv_prop;
   int gotprop;
 #endif
 
@@ -1815,6 +2085,8 @@ linuxdvb_frontend_monitor ( void *aux )
         tvh_mutex_lock(&lfe->lfe_dvr_lock);
         tvh_thread_create(&lfe->lfe_dvr_thread, NULL,
                           linuxdvb_frontend_input_thread, lfe, "lnxdvb-front");
+        mpegts_input_apply_affinity((mpegts_input_t *)lfe,
+                                    lfe->lfe_dvr_thread);
         do {
           e = tvh_cond_wait(&lfe->lfe_dvr_cond, &lfe->lfe_dvr_lock);
           if (e == ETIMEDOUT)
@@ -1844,41 +2116,29 @@ linuxdvb_frontend_monitor ( void *aux )
   }
 
 
-  tvh_mutex_lock(&mmi->tii_stats_mutex);
-
-  /* Statistics - New API */
-#if DVB_VER_ATLEAST(5,10)
-  memset(&fe_properties, 0, sizeof(fe_properties));
-
-  /* Signal strength */
-  fe_properties[0].cmd = DTV_STAT_SIGNAL_STRENGTH;
-
-  /* BER */
-  fe_properties[1].cmd = DTV_STAT_PRE_ERROR_BIT_COUNT;
-  fe_properties[2].cmd = DTV_STAT_PRE_TOTAL_BIT_COUNT;
-
-  /* SNR */
-  fe_properties[3].cmd = DTV_STAT_CNR;
+  /* Statistics - collected asynchronously on the tasklet thread;
+   * publish the finished snapshot (if any) and start the next poll */
+  sj = lfe->lfe_status_job;
+  if (sj) {
+    tvh_mutex_lock(&linuxdvb_status_lock);
+    e = sj->sj_done;
+    tvh_mutex_unlock(&linuxdvb_status_lock);
+    if (!e) return; /* slow driver - try again next period */
+    lfe->lfe_status_job = NULL;
+  }
+  linuxdvb_frontend_status_start(lfe);
+  if (sj == NULL) return;
 
-  /* PER / UNC */
-  fe_properties[4].cmd = DTV_STAT_ERROR_BLOCK_COUNT;
-  fe_properties[5].cmd = DTV_STAT_TOTAL_BLOCK_COUNT;
-  dtv_prop.num = 6;
-  dtv_prop.props = fe_properties;
+  tvh_mutex_lock(&mmi->tii_stats_mutex);
 
   logit = tvhlog_limit(&lfe->lfe_status_log, 3600);
 
-  gotprop = 0;
-  if(ioctl_check(lfe, 0) && !lfe->lfe_old_status &&
-     !ioctl(lfe->lfe_fe_fd, FE_GET_PROPERTY, &dtv_prop)) {
-    for (e = 0; e < dtv_prop.num; e++)
-      if (fe_properties[e].u.st.len > 0) {
-        gotprop = 1;
-        break;
-      }
-  }
+  /* Statistics - New API */
+#if DVB_VER_ATLEAST(5,10)
+  gotprop = sj->sj_gotprop;
 
   if(gotprop) {
+    struct dtv_property *fe_properties = sj->sj_props;
     /* Signal strength */
     if(ioctl_check(lfe, 1) && fe_properties[0].u.st.len > 0) {
       if(fe_properties[0].u.st.stat[0].scale == FE_SCALE_RELATIVE) {
@@ -1975,9 +2235,9 @@ linuxdvb_frontend_monitor ( void *aux )
 #endif
   {
     ioctl_bad(lfe, 0);
-    if (ioctl_check(lfe, 1) && !ioctl(lfe->lfe_fe_fd, FE_READ_SIGNAL_STRENGTH, &u16)) {
+    if (sj->sj_ok[1]) {
       mmi->tii_stats.signal_scale = SIGNAL_STATUS_SCALE_RELATIVE;
-      mmi->tii_stats.signal = sig_multiply(u16, lfe->lfe_sig_multiplier);
+      mmi->tii_stats.signal = sig_multiply(sj->sj_signal, lfe->lfe_sig_multiplier);
     }
     else {
       ioctl_bad(lfe, 1);
@@ -1985,16 +2245,16 @@ linuxdvb_frontend_monitor ( void *aux )
       if (logit)
         tvhwarn(LS_LINUXDVB, "Unable to provide signal strength value.");
     }
-    if (ioctl_check(lfe, 2) && !ioctl(lfe->lfe_fe_fd, FE_READ_BER, &u32))
-      mmi->tii_stats.ber = u32;
+    if (sj->sj_ok[2])
+      mmi->tii_stats.ber = sj->sj_ber;
     else {
       ioctl_bad(lfe, 2);
       if (logit)
         tvhwarn(LS_LINUXDVB, "Unable to provide BER value.");
     }
-    if (ioctl_check(lfe, 3) && !ioctl(lfe->lfe_fe_fd, FE_READ_SNR, &u16)) {
+    if (sj->sj_ok[3]) {
       mmi->tii_stats.snr_scale = SIGNAL_STATUS_SCALE_RELATIVE;
-      mmi->tii_stats.snr = sig_multiply(u16, lfe->lfe_snr_multiplier);
+      mmi->tii_stats.snr = sig_multiply(sj->sj_snr, lfe->lfe_snr_multiplier);
     }
     else {
       ioctl_bad(lfe, 3);
@@ -2002,8 +2262,8 @@ linuxdvb_frontend_monitor ( void *aux )
       if (logit)
         tvhwarn(LS_LINUXDVB, "Unable to provide SNR value.");
     }
-    if (ioctl_check(lfe, 4) && !ioctl(lfe->lfe_fe_fd, FE_READ_UNCORRECTED_BLOCKS, &u32))
-      atomic_set(&mmi->tii_stats.unc, u32);
+    if (sj->sj_ok[4])
+      atomic_set(&mmi->tii_stats.unc, sj->sj_unc);
     else {
       ioctl_bad(lfe, 4);
       if (logit)
@@ -2011,6 +2271,8 @@ linuxdvb_frontend_monitor ( void *aux )
     }
   }
 
+  free(sj);
+
   /* Send message */
   sigstat.status_text  = signal2str(status);
   sigstat.snr          = mmi->tii_stats.snr;
@@ -2041,7 +2303,7 @@ typedef struct linuxdvb_pid {
   int pid;
 } linuxdvb_pid_t;
 
-static void
+static int
 linuxdvb_frontend_open_pid0
   ( linuxdvb_frontend_t *lfe, const char *name,
     linuxdvb_pid_t *pids, int pids_size, int pid )
@@ -2053,7 +2315,8 @@ linuxdvb_frontend_open_pid0
   if (pids_size == 0) {
     tvherror(LS_LINUXDVB, "%s - maximum PID count reached, pid %d ignored",
              name, pid);
-    return;
+    errno = EMFILE;
+    return -1;
   }
 
   /* Open DMX */
@@ -2061,7 +2324,7 @@ linuxdvb_frontend_open_pid0
   if(fd == -1) {
     tvherror(LS_LINUXDVB, "%s - failed to open dmx for pid %d [e=%s]",
              name, pid, strerror(errno));
-    return;
+    return -1;
   }
 
   /* Install filter */
@@ -2077,12 +2340,25 @@ linuxdvb_frontend_open_pid0
     tvherror(LS_LINUXDVB, "%s - failed to config dmx for pid %d [e=%s]",
              name, pid, strerror(errno));
     close(fd);
-    return;
+    return -1;
   }
 
   /* Store */
   pids->fd = fd;
   pids->pid = pid;
+  return 0;
+}
+
+/*
+ * Demux filter exhaustion - budget drivers expose only a handful of
+ * hardware filters and report the shortage with one of these codes
+ * when the next filter is opened or started.
+ */
+static int
+linuxdvb_pid_exhausted ( int err )
+{
+  return err == EMFILE || err == ENFILE || err == ENOSPC ||
+         err == ENOMEM || err == EBUSY;
 }
 
 static void
@@ -2116,12 +2392,16 @@ linuxdvb_update_pids ( linuxdvb_frontend_t *lfe, const char *name,
                        int pids_size )
 {
   mpegts_apids_t wpid, padd, pdel;
-  int i, max = MAX(14, lfe->lfe_pids_max), overlimit;
+  int i, j, cnt, max = MAX(14, lfe->lfe_pids_max), overlimit;
   int all = lfe->lfe_pids.all;
   char buf[512];
 
   tvh_mutex_lock(&lfe->lfe_dvr_lock);
 
+  /* cap by the learned hardware filter count */
+  if (lfe->lfe_pids_limit > 0 && max > lfe->lfe_pids_limit)
+    max = lfe->lfe_pids_limit;
+
   if (!all) {
     overlimit = mpegts_pid_weighted(&wpid, &lfe->lfe_pids, max, MPS_WEIGHT_ALLLIMIT);
     if (tvhtrace_enabled()) {
@@ -2138,17 +2418,42 @@ linuxdvb_update_pids ( linuxdvb_frontend_t *lfe, const char *name,
       for (i = 0; i < pdel.count; i++)
         linuxdvb_frontend_close_pid0(lfe, name, pids, pids_size, pdel.pids[i].pid);
       for (i = 0; i < padd.count; i++)
-       linuxdvb_frontend_open_pid0(lfe, name, pids, pids_size, padd.pids[i].pid);
+        if (linuxdvb_frontend_open_pid0(lfe, name, pids, pids_size,
+                                        padd.pids[i].pid) &&
+            linuxdvb_pid_exhausted(errno)) {
+          /* the driver ran out of hardware filters - remember the real
+             limit for the next weighted selection and fall back to the
+             full mux now, otherwise the remaining PIDs would silently
+             never reach the output */
+          for (j = cnt = 0; j < pids_size; j++)
+            if (pids[j].fd >= 0) cnt++;
+          if (lfe->lfe_pids_limit <= 0 || cnt < lfe->lfe_pids_limit)
+            lfe->lfe_pids_limit = MAX(cnt, 1);
+          tvhwarn(LS_LINUXDVB, "%s - hardware demux limit reached at %d filters%s",
+                  name, cnt,
+                  lfe->lfe_pids_use_all ? ", falling back to full mux" : "");
+          if (lfe->lfe_pids_use_all)
+            all = 1;
+          break;
+        }
       mpegts_pid_done(&padd);
       mpegts_pid_done(&pdel);
-      mpegts_pid_copy(tuned, &wpid);
+      if (!all)
+        mpegts_pid_copy(tuned, &wpid);
       mpegts_pid_done(&wpid);
     }
   }
 
-  if (all && !linuxdvb_pid_exists(pids, pids_size, MPEGTS_FULLMUX_PID))
-    linuxdvb_frontend_open_pid0(lfe, name, pids, pids_size, MPEGTS_FULLMUX_PID);
-  else if (!all && linuxdvb_pid_exists(pids, pids_size, MPEGTS_FULLMUX_PID))
+  if (all) {
+    /* the wildcard filter covers everything - drop the per-PID filters
+       first so a freed slot is available for the wildcard itself */
+    for (i = 0; i < pids_size; i++)
+      if (pids[i].fd >= 0 && pids[i].pid != MPEGTS_FULLMUX_PID)
+        linuxdvb_frontend_close_pid0(lfe, name, pids, pids_size, pids[i].pid);
+    mpegts_pid_done(tuned);
+    if (!linuxdvb_pid_exists(pids, pids_size, MPEGTS_FULLMUX_PID))
+      linuxdvb_frontend_open_pid0(lfe, name, pids, pids_size, MPEGTS_FULLMUX_PID);
+  } else if (linuxdvb_pid_exists(pids, pids_size, MPEGTS_FULLMUX_PID))
     linuxdvb_frontend_close_pid0(lfe, name, pids, pids_size, MPEGTS_FULLMUX_PID);
 
   tuned->all = lfe->lfe_pids.all;
@@ -2156,6 +2461,299 @@ linuxdvb_update_pids ( linuxdvb_frontend_t *lfe, const char *name,
   tvh_mutex_unlock(&lfe->lfe_dvr_lock);
 }
 
+static void
+linuxdvb_frontend_process_buffer
+  ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi,
+    sbuf_t *sb, ssize_t n, size_t skip, size_t *counter )
+{
+  /* Skip the initial bytes */
+  if (*counter < skip) {
+    *counter += n;
+    if (*counter < skip) {
+      sbuf_cut(sb, n);
+    } else {
+      sbuf_cut(sb, skip - (*counter - n));
+    }
+  }
+
+  /* Process - T2MI/DAB decapsulation or normal */
+  if (lfe->lfe_t2mi_ctx) {
+    linuxdvb_t2mi_process(lfe, mmi, sb);
+  } else if (lfe->lfe_dab_ctx) {
+    linuxdvb_dab_process(lfe, mmi, sb);
+  } else {
+    mpegts_input_recv_packets(mmi, sb, 0, NULL);
+  }
+}
+
+#if LINUXDVB_URING
+
+/*
+ * Minimal io_uring support over the raw syscalls - we only need three
+ * operations (fixed read, poll, timeout) so a liburing dependency is
+ * not worth it.
+ */
+
+#define LINUXDVB_URING_ENTRIES 8
+
+#define LINUXDVB_URING_DVR     1
+#define LINUXDVB_URING_PIPE    2
+#define LINUXDVB_URING_TIMEOUT 3
+
+typedef struct linuxdvb_uring {
+  int                  ur_fd;
+  uint8_t             *ur_sq_ptr;
+  size_t               ur_sq_len;
+  uint8_t             *ur_cq_ptr;
+  size_t               ur_cq_len;
+  struct io_uring_sqe *ur_sqes;
+  size_t               ur_sqes_len;
+  unsigned            *ur_sq_head;
+  unsigned            *ur_sq_tail;
+  unsigned            *ur_sq_mask;
+  unsigned            *ur_sq_array;
+  unsigned            *ur_cq_head;
+  unsigned            *ur_cq_tail;
+  unsigned            *ur_cq_mask;
+  struct io_uring_cqe *ur_cqes;
+} linuxdvb_uring_t;
+
+static void
+linuxdvb_uring_done ( linuxdvb_uring_t *ur )
+{
+  if (ur->ur_sqes)
+    munmap(ur->ur_sqes, ur->ur_sqes_len);
+  if (ur->ur_cq_ptr && ur->ur_cq_ptr != ur->ur_sq_ptr)
+    munmap(ur->ur_cq_ptr, ur->ur_cq_len);
+  if (ur->ur_sq_ptr)
+    munmap(ur->ur_sq_ptr, ur->ur_sq_len);
+  if (ur->ur_fd >= 0)
+    close(ur->ur_fd);
+}
+
+static int
+linuxdvb_uring_init ( linuxdvb_uring_t *ur, sbuf_t *sb )
+{
+  struct io_uring_params p;
+  struct iovec iov;
+  void *m;
+
+  memset(ur, 0, sizeof(*ur));
+  ur->ur_fd = -1;
+  memset(&p, 0, sizeof(p));
+  ur->ur_fd = syscall(__NR_io_uring_setup, LINUXDVB_URING_ENTRIES, &p);
+  if (ur->ur_fd < 0)
+    return -1;
+
+  ur->ur_sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ur->ur_cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+    ur->ur_sq_len = ur->ur_cq_len = MAX(ur->ur_sq_len, ur->ur_cq_len);
+  m = mmap(NULL, ur->ur_sq_len, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ur->ur_fd, IORING_OFF_SQ_RING);
+  if (m == MAP_FAILED)
+    goto fail;
+  ur->ur_sq_ptr = m;
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    ur->ur_cq_ptr = ur->ur_sq_ptr;
+  } else {
+    m = mmap(NULL, ur->ur_cq_len, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ur->ur_fd, IORING_OFF_CQ_RING);
+    if (m == MAP_FAILED)
+      goto fail;
+    ur->ur_cq_ptr = m;
+  }
+  ur->ur_sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+  m = mmap(NULL, ur->ur_sqes_len, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, ur->ur_fd, IORING_OFF_SQES);
+  if (m == MAP_FAILED)
+    goto fail;
+  ur->ur_sqes = m;
+
+  ur->ur_sq_head  = (unsigned *)(ur->ur_sq_ptr + p.sq_off.head);
+  ur->ur_sq_tail  = (unsigned *)(ur->ur_sq_ptr + p.sq_off.tail);
+  ur->ur_sq_mask  = (unsigned *)(ur->ur_sq_ptr + p.sq_off.ring_mask);
+  ur->ur_sq_array = (unsigned *)(ur->ur_sq_ptr + p.sq_off.array);
+  ur->ur_cq_head  = (unsigned *)(ur->ur_cq_ptr + p.cq_off.head);
+  ur->ur_cq_tail  = (unsigned *)(ur->ur_cq_ptr + p.cq_off.tail);
+  ur->ur_cq_mask  = (unsigned *)(ur->ur_cq_ptr + p.cq_off.ring_mask);
+  ur->ur_cqes     = (struct io_uring_cqe *)(ur->ur_cq_ptr + p.cq_off.cqes);
+
+  /* Register the input buffer, the pages stay pinned for the lifetime
+   * of the ring instead of being pinned/unpinned on every read */
+  iov.iov_base = sb->sb_data;
+  iov.iov_len  = sb->sb_size;
+  if (syscall(__NR_io_uring_register, ur->ur_fd,
+              IORING_REGISTER_BUFFERS, &iov, 1))
+    goto fail;
+  return 0;
+
+fail:
+  linuxdvb_uring_done(ur);
+  return -1;
+}
+
+static struct io_uring_sqe *
+linuxdvb_uring_get_sqe ( linuxdvb_uring_t *ur )
+{
+  unsigned tail = *ur->ur_sq_tail, idx = tail & *ur->ur_sq_mask;
+  struct io_uring_sqe *sqe = &ur->ur_sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  ur->ur_sq_array[idx] = idx;
+  return sqe;
+}
+
+static inline void
+linuxdvb_uring_push ( linuxdvb_uring_t *ur )
+{
+  __atomic_store_n(ur->ur_sq_tail, *ur->ur_sq_tail + 1, __ATOMIC_RELEASE);
+}
+
+static inline struct io_uring_cqe *
+linuxdvb_uring_peek_cqe ( linuxdvb_uring_t *ur )
+{
+  unsigned head = *ur->ur_cq_head;
+  if (head == __atomic_load_n(ur->ur_cq_tail, __ATOMIC_ACQUIRE))
+    return NULL;
+  return &ur->ur_cqes[head & *ur->ur_cq_mask];
+}
+
+static inline void
+linuxdvb_uring_seen_cqe ( linuxdvb_uring_t *ur )
+{
+  __atomic_store_n(ur->ur_cq_head, *ur->ur_cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * io_uring variant of the DVR read loop - the read lands directly in the
+ * registered input buffer and one io_uring_enter() replaces the
+ * poll()+read() syscall pair per wakeup.  Returns -1 when io_uring is
+ * not usable so the caller can fall back to the classic loop.
+ */
+static int
+linuxdvb_uring_input
+  ( linuxdvb_frontend_t *lfe, mpegts_mux_instance_t *mmi,
+    const char *name, int dvr, sbuf_t *sb, mpegts_apids_t *tuned,
+    linuxdvb_pid_t *pids, int pids_size, size_t skip )
+{
+  linuxdvb_uring_t ur;
+  struct io_uring_sqe *sqe;
+  struct io_uring_cqe *cqe;
+  struct __kernel_timespec ts = { .tv_sec = 0, .tv_nsec = 150 * 1000000LL };
+  size_t counter = 0;
+  char b;
+  int nodata = 4, running = 1, res;
+  int read_armed = 0, poll_armed = 0, timeout_armed = 0;
+  unsigned to_submit;
+
+  if (linuxdvb_uring_init(&ur, sb) < 0)
+    return -1;
+  tvhtrace(LS_LINUXDVB, "%s - io_uring input engine started", name);
+
+  while (running && tvheadend_is_running()) {
+
+    /* (Re)arm the requests completed in the previous pass */
+    to_submit = 0;
+    if (!read_armed) {
+      sqe = linuxdvb_uring_get_sqe(&ur);
+      sqe->opcode    = IORING_OP_READ_FIXED;
+      sqe->fd        = dvr;
+      sqe->addr      = (uint64_t)(uintptr_t)(sb->sb_data + sb->sb_ptr);
+      sqe->len       = sb->sb_size - sb->sb_ptr;
+      sqe->user_data = LINUXDVB_URING_DVR;
+      linuxdvb_uring_push(&ur);
+      read_armed = 1;
+      to_submit++;
+    }
+    if (!poll_armed) {
+      sqe = linuxdvb_uring_get_sqe(&ur);
+      sqe->opcode      = IORING_OP_POLL_ADD;
+      sqe->fd          = lfe->lfe_dvr_pipe.rd;
+      sqe->poll_events = POLLIN;
+      sqe->user_data   = LINUXDVB_URING_PIPE;
+      linuxdvb_uring_push(&ur);
+      poll_armed = 1;
+      to_submit++;
+    }
+    if (!timeout_armed) {
+      sqe = linuxdvb_uring_get_sqe(&ur);
+      sqe->opcode    = IORING_OP_TIMEOUT;
+      sqe->fd        = -1;
+      sqe->addr      = (uint64_t)(uintptr_t)&ts;
+      sqe->len       = 1;
+      sqe->off       = 1; /* auto-disarm on the first completion */
+      sqe->user_data = LINUXDVB_URING_TIMEOUT;
+      linuxdvb_uring_push(&ur);
+      timeout_armed = 1;
+      to_submit++;
+    }
+
+    if (syscall(__NR_io_uring_enter, ur.ur_fd, to_submit, 1,
+                IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+      if (ERRNO_AGAIN(errno) || errno == EINTR)
+        continue;
+      tvherror(LS_LINUXDVB, "%s - io_uring_enter error %d (%s)",
+               name, errno, strerror(errno));
+      break;
+    }
+
+    while (running && (cqe = linuxdvb_uring_peek_cqe(&ur)) != NULL) {
+      res = cqe->res;
+      switch ((int)cqe->user_data) {
+
+      case LINUXDVB_URING_DVR:
+        read_armed = 0;
+        if (res < 0) {
+          if (ERRNO_AGAIN(-res))
+            break;
+          if (-res == EOVERFLOW) {
+            tvhwarn(LS_LINUXDVB, "%s - read() EOVERFLOW", name);
+            break;
+          }
+          tvherror(LS_LINUXDVB, "%s - read() error %d (%s)",
+                   name, -res, strerror(-res));
+          running = 0;
+          break;
+        }
+        nodata = 50;
+        lfe->lfe_nodata = 0;
+        sb->sb_ptr += res;
+        linuxdvb_frontend_process_buffer(lfe, mmi, sb, res, skip, &counter);
+        break;
+
+      case LINUXDVB_URING_PIPE:
+        poll_armed = 0;
+        if (read(lfe->lfe_dvr_pipe.rd, &b, 1) > 0) {
+          if (b == 'c')
+            linuxdvb_update_pids(lfe, name, tuned, pids, pids_size);
+          else
+            running = 0;
+        }
+        break;
+
+      case LINUXDVB_URING_TIMEOUT:
+        timeout_armed = 0;
+        if (res == -ETIME) {
+          if (nodata == 0) {
+            tvhwarn(LS_LINUXDVB, "%s - poll TIMEOUT", name);
+            nodata = 50;
+            lfe->lfe_nodata = 1;
+          } else {
+            nodata--;
+          }
+        }
+        break;
+      }
+      linuxdvb_uring_seen_cqe(&ur);
+    }
+  }
+
+  linuxdvb_uring_done(&ur);
+  return 0;
+}
+
+#endif /* LINUXDVB_URING */
+
 static void *
 linuxdvb_frontend_input_thread ( void *aux )
 {
@@ -2210,6 +2808,13 @@ linuxdvb_frontend_input_thread ( void *aux )
   /* Subscribe PIDs */
   linuxdvb_update_pids(lfe, name, &tuned, pids, ARRAY_SIZE(pids));
 
+#if LINUXDVB_URING
+  /* Prefer io_uring, fall back to poll()+read() on older kernels */
+  if (linuxdvb_uring_input(lfe, mmi, name, dvr, &sb, &tuned,
+                           pids, ARRAY_SIZE(pids), skip) == 0)
+    goto done;
+#endif
+
   /* Read */
   while (tvheadend_is_running()) {
     nfds = tvhpoll_wait(efd, ev, 1, 150);
@@ -2250,26 +2855,12 @@ linuxdvb_frontend_input_thread ( void *aux )
       break;
     }
 
-    /* Skip the initial bytes */
-    if (counter < skip) {
-      counter += n;
-      if (counter < skip) {
-        sbuf_cut(&sb, n);
-      } else {
-        sbuf_cut(&sb, skip - (counter - n));
-      }
-    }
-
-    /* Process - T2MI/DAB decapsulation or normal */
-    if (lfe->lfe_t2mi_ctx) {
-      linuxdvb_t2mi_process(lfe, mmi, &sb);
-    } else if (lfe->lfe_dab_ctx) {
-      linuxdvb_dab_process(lfe, mmi, &sb);
-    } else {
-      mpegts_input_recv_packets(mmi, &sb, 0, NULL);
-    }
+    linuxdvb_frontend_process_buffer(lfe, mmi, &sb, n, skip, &counter);
   }
 
+#if LINUXDVB_URING
+done:
+#endif
   sbuf_free(&sb);
   tvhpoll_destroy(efd);
   for (i = 0; i < ARRAY_SIZE(pids); i++)
@@ -3173,6 +3764,7 @@ linuxdvb_frontend_destroy ( linuxdvb_frontend_t *lfe )
 
   /* Stop monitor */
   mtimer_disarm(&lfe->lfe_monitor_timer);
+  linuxdvb_frontend_status_stop(lfe);
 
   /* Close FDs */
   if (lfe->lfe_fe_fd > 0)
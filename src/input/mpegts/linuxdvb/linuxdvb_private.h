@@ -57,6 +57,8 @@ typedef struct linuxdvb_network     linuxdvb_network_t;
 typedef struct linuxdvb_en50494     linuxdvb_en50494_t;
 typedef struct linuxdvb_unicable_group linuxdvb_unicable_group_t;
 
+typedef struct linuxdvb_t2mi_fan    linuxdvb_t2mi_fan_t;
+
 typedef LIST_HEAD(,linuxdvb_hardware) linuxdvb_hardware_list_t;
 typedef TAILQ_HEAD(linuxdvb_satconf_ele_list,linuxdvb_satconf_ele) linuxdvb_satconf_ele_list_t;
 #if ENABLE_LINUXDVB_CA
@@ -91,6 +93,18 @@ struct linuxdvb_adapter
   int (*la_is_enabled) ( linuxdvb_adapter_t *la );
 };
 
+/*
+ * One T2MI sub-mux attached to an already tuned carrier; the owning
+ * frontend routes decapsulated inner TS to it by PLP id
+ */
+struct linuxdvb_t2mi_fan
+{
+  LIST_ENTRY(linuxdvb_t2mi_fan)  ltf_link;
+  mpegts_mux_instance_t         *ltf_mmi;
+  int                            ltf_plp;    /* T2MI_PLP_ALL = any */
+  sbuf_t                         ltf_buffer; /* Inner TS for this PLP */
+};
+
 struct linuxdvb_frontend
 {
   mpegts_input_t;
@@ -123,6 +137,7 @@ struct linuxdvb_frontend
   mpegts_apids_t            lfe_pids;
   int                       lfe_pids_max;
   int                       lfe_pids_use_all;
+  int                       lfe_pids_limit;    /* learned driver filter limit, 0 = unknown */
  
   /*
    * Tuning
@@ -139,6 +154,7 @@ struct linuxdvb_frontend
   int64_t                   lfe_monitor;
   mtimer_t                  lfe_monitor_timer;
   tvhlog_limit_t            lfe_status_log;
+  struct linuxdvb_status_job *lfe_status_job;
 
   /*
    * Configuration
@@ -192,6 +208,15 @@ struct linuxdvb_frontend
    */
   t2mi_ctx_t               *lfe_t2mi_ctx;    /* Decapsulation context */
   sbuf_t                    lfe_t2mi_buffer; /* Output buffer for inner TS */
+  int                       lfe_t2mi_plp;    /* PLP of the owning mux */
+
+  /*
+   * Shared-carrier fan-out: additional T2MI sub-muxes riding the tune
+   * owned by the first active instance.  The single decapsulation run
+   * routes inner TS per PLP, so N substreams cost one demux pass.
+   * Guarded by lfe_dvr_lock (written under global_lock too).
+   */
+  LIST_HEAD(,linuxdvb_t2mi_fan) lfe_t2mi_fans;
 
   /*
    * DAB streaming (for DAB-MPE/ETI type muxes)
@@ -534,6 +559,10 @@ linuxdvb_ca_t * linuxdvb_ca_create
 void linuxdvb_ca_enqueue_capmt
   (linuxdvb_ca_t *lca, const uint8_t *capmt, size_t capmtlen, int descramble);
 
+void linuxdvb_ca_enqueue_capmt_list
+  (linuxdvb_ca_t *lca, uint8_t **capmts, size_t *capmtlens,
+   int count, int descramble);
+
 void linuxdvb_ca_init(void);
 void linuxdvb_ca_done(void);
 
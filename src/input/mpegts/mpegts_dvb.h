@@ -118,6 +118,9 @@ extern const idclass_t dvb_mux_isdb_s_class;
 extern const idclass_t dvb_mux_dtmb_class;
 extern const idclass_t dvb_mux_dab_class;
 
+int dvb_mux_conf_same_carrier
+  ( const dvb_mux_conf_t *a, const dvb_mux_conf_t *b );
+
 dvb_mux_t *dvb_mux_create0
   (dvb_network_t *ln, uint32_t onid, uint32_t tsid,
    const dvb_mux_conf_t *dmc, const char *uuid, htsmsg_t *conf);
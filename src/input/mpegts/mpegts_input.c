@@ -23,6 +23,13 @@
 #include "notify.h"
 #include "dbus.h"
 #include "memoryinfo.h"
+#include "tvh_endian.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 memoryinfo_t mpegts_input_queue_memoryinfo = { .my_name = "MPEG-TS input queue" };
 memoryinfo_t mpegts_input_table_memoryinfo = { .my_name = "MPEG-TS table queue" };
@@ -274,6 +281,19 @@ const idclass_t mpegts_input_class =
       .off      = offsetof(mpegts_input_t, mi_name),
       .notify   = idnode_notify_title_changed_lang,
     },
+    {
+      .type     = PT_STR,
+      .id       = "affinity",
+      .name     = N_("CPU affinity"),
+      .desc     = N_("Pin the input processing threads of this tuner to "
+                     "the given CPU list (e.g. \"0-7,16\"). On NUMA "
+                     "machines use the CPUs of one node to keep the "
+                     "whole pipeline and its buffers node-local. Leave "
+                     "empty to let the scheduler decide. Applied when "
+                     "the input threads are (re)started."),
+      .off      = offsetof(mpegts_input_t, mi_thread_affinity),
+      .opts     = PO_EXPERT,
+    },
     {
       .type     = PT_BOOL,
       .id       = "ota_epg",
@@ -613,6 +633,10 @@ mpegts_input_close_pid
       mm->mm_last_pid = -1;
       mm->mm_last_mp = NULL;
     }
+    if (mm->mm_pid_tab)
+      mm->mm_pid_tab[mp->mp_pid] = NULL;
+    if (mp->mp_pid < 8192)
+      mm->mm_open_pid_map[mp->mp_pid >> 5] &= ~(1U << (mp->mp_pid & 31));
     RB_REMOVE(&mm->mm_pids, mp, mp_link);
     free(mp);
     return 1;
@@ -865,6 +889,8 @@ mpegts_input_open_service
     /* Open only filtered components here */
     TAILQ_FOREACH(st, &s->s_components.set_filter, es_filter_link)
       if ((s->s_scrambled_pass || st->es_type != SCT_CA) &&
+          (!s->s_audio_only || SCT_ISAUDIO(st->es_type) ||
+           st->es_type == SCT_CA) &&
           st->es_pid != s->s_components.set_pmt_pid &&
           st->es_pid != s->s_components.set_pcr_pid &&
           st->es_pid < 8192) {
@@ -1080,15 +1106,25 @@ static void mpegts_input_analyze_table_queue ( mpegts_input_t *mi )
   uint32_t sizes[8192];
   uint16_t counters[8192];
   uint16_t pid;
+  int head, tail;
 
   memset(&sizes, 0, sizeof(sizes));
   memset(&counters, 0, sizeof(counters));
-  TAILQ_FOREACH(mtf, &mi->mi_table_queue, mtf_link) {
+  /* take the ring scan lock so the consumer cannot pop (and free)
+   * entries under our feet */
+  tvh_mutex_lock(&mi->mi_table_lock);
+  head = atomic_get(&mi->mi_table_ring_head);
+  tail = atomic_get(&mi->mi_table_ring_tail);
+  for ( ; head != tail; head++) {
+    mtf = mi->mi_table_ring[head & MPEGTS_MTF_RING_MASK];
+    if (mtf->mtf_len == 0)
+      continue;
     const uint8_t *tsb = mtf->mtf_tsb;
     pid = ((tsb[1] & 0x1f) << 8) | tsb[2];
     sizes[pid] += mtf->mtf_len;
     counters[pid]++;
   }
+  tvh_mutex_unlock(&mi->mi_table_lock);
   for (pid = 0; pid < 8192; pid++)
     if (counters[pid])
       tvhtrace(LS_MPEGTS, "table queue pid=%04X (%d) cnt %u len %u", pid, pid, counters[pid], sizes[pid]);
@@ -1146,6 +1182,60 @@ get_pcr ( const uint8_t *tsb, int64_t *rpcr )
   return 1;
 }
 
+/* Candidate sync position must repeat at 188-byte strides (as far as
+ * the buffer allows) before the full ts_sync_count check is re-run */
+static inline int
+ts_sync_stride_ok ( const uint8_t *tsb, int len, int i )
+{
+  if (i + 1*188 < len && tsb[i + 1*188] != 0x47) return 0;
+  if (i + 2*188 < len && tsb[i + 2*188] != 0x47) return 0;
+  return 1;
+}
+
+/* Scan for the next plausible TS sync byte.  The candidate search runs
+ * 16 bytes per iteration with SSE2/NEON where available, so recovery
+ * from a corrupted stream no longer crawls a byte at a time.  Returns
+ * the offset of the first stride-validated 0x47, or len if none. */
+static int
+ts_resync_offset ( const uint8_t *tsb, int len )
+{
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i sync = _mm_set1_epi8(0x47);
+  while (i + 16 <= len) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(tsb + i));
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, sync));
+    while (mask) {
+      int j = i + __builtin_ctz(mask);
+      if (ts_sync_stride_ok(tsb, len, j))
+        return j;
+      mask &= mask - 1;
+    }
+    i += 16;
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t sync = vdupq_n_u8(0x47);
+  while (i + 16 <= len) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(tsb + i), sync);
+    uint64_t mask =
+      vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    while (mask) {
+      int b = __builtin_ctzll(mask) & ~3;
+      int j = i + (b >> 2);
+      if (ts_sync_stride_ok(tsb, len, j))
+        return j;
+      mask &= ~((uint64_t)0xf << b);
+    }
+    i += 16;
+  }
+#endif
+  for ( ; i < len; i++)
+    if (tsb[i] == 0x47 && ts_sync_stride_ok(tsb, len, i))
+      return i;
+  return len;
+}
+
 static inline int
 ts_sync_count ( const uint8_t *tsb, int len )
 {
@@ -1228,10 +1318,11 @@ retry:
   /* Check for sync */
   while ( (len >= MIN_TS_SYN) &&
           ((len2 = ts_sync_count(tsb, len)) < MIN_TS_SYN) ) {
-    atomic_add(&mmi->tii_stats.unc, 1);
-    --len;
-    ++tsb;
-    ++off;
+    int skip = 1 + ts_resync_offset(tsb + 1, len - 1);
+    atomic_add(&mmi->tii_stats.unc, skip);
+    len -= skip;
+    tsb += skip;
+    off += skip;
   }
 
   // Note: we check for sync here so that the buffer can always be
@@ -1270,6 +1361,7 @@ retry:
     mp = malloc(sizeof(mpegts_packet_t) + len2);
     mp->mp_mux        = mmi->mmi_mux;
     mp->mp_len        = len2;
+    mp->mp_arrival    = sb->sb_arrival ?: getfastmonoclock();
     mp->mp_cc_restart = (flags & MPEGTS_DATA_CC_RESTART) ? 1 : 0;
 
     memcpy(mp->mp_data, tsb, len2);
@@ -1298,6 +1390,7 @@ end:
       goto retry;
   } else
     sb->sb_ptr = 0;    // clear
+  sb->sb_arrival = 0;  // wire stamp consumed
 }
 
 static void
@@ -1371,12 +1464,32 @@ mpegts_input_table_feed_create ( mpegts_input_t *mi, mpegts_mux_t *mm, uint8_t *
   mtf->mtf_len = llen;
   memcpy(mtf->mtf_tsb, tsb, llen);
   mtf->mtf_mux = mm;
-  mi->mi_table_queue_size += llen;
-  memoryinfo_alloc(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + llen);
-  TAILQ_INSERT_TAIL(&mi->mi_table_queue, mtf, mtf_link);
   return mtf;
 }
 
+/* Hand a filled feed over to the table thread - producer side of the
+ * SPSC ring, called from the input thread only */
+static void
+mpegts_input_table_feed_publish ( mpegts_input_t *mi, mpegts_table_feed_t *mtf )
+{
+  int head = atomic_get(&mi->mi_table_ring_head);
+  int tail = mi->mi_table_ring_tail;
+
+  if (tail - head >= MPEGTS_MTF_RING_SIZE) {
+    if (tvhlog_limit(&mi->mi_table_queue_loglimit, 10))
+      tvhwarn(LS_MPEGTS, "table feed ring full for %s, discarding section data", mi->mi_name);
+    free(mtf);
+    return;
+  }
+  mi->mi_table_ring[tail & MPEGTS_MTF_RING_MASK] = mtf;
+  atomic_add_u64(&mi->mi_table_queue_size, mtf->mtf_len);
+  memoryinfo_alloc(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + mtf->mtf_len);
+  /* the slot store above must be visible before the index - atomic_set
+   * alone (__sync_lock_test_and_set) is only an acquire barrier */
+  __sync_synchronize();
+  atomic_set(&mi->mi_table_ring_tail, tail + 1);
+}
+
 static void
 mpegts_input_table_waiting ( mpegts_input_t *mi, mpegts_mux_t *mm )
 {
@@ -1416,6 +1529,48 @@ mpegts_input_table_waiting ( mpegts_input_t *mi, mpegts_mux_t *mm )
   tvh_mutex_unlock(&mm->mm_tables_lock);
 }
 
+/* Gather the masked 32-bit header word (sync, error, PID, scrambling,
+ * CC-check bits) of every packet in a batch into a flat array. The
+ * dispatch loop then finds equal-header runs by scanning linear memory
+ * instead of chasing words 188 bytes apart, and the gather+mask step
+ * handles four packets per iteration with SSE2/NEON. */
+#define MPEGTS_HDR_BATCH 384
+
+static void
+mpegts_hdr_gather ( const uint8_t *tsb, int pkts, uint32_t mask,
+                    uint32_t *words )
+{
+  int i = 0;
+#if defined(__SSE2__)
+  const __m128i m = _mm_set1_epi32(mask);
+  for ( ; i + 4 <= pkts; i += 4, tsb += 4*188) {
+    __m128i v = _mm_set_epi32(*(const uint32_t *)(tsb + 3*188),
+                              *(const uint32_t *)(tsb + 2*188),
+                              *(const uint32_t *)(tsb + 1*188),
+                              *(const uint32_t *)(tsb + 0*188));
+    _mm_storeu_si128((__m128i *)(words + i), _mm_and_si128(v, m));
+  }
+#elif defined(__ARM_NEON)
+  const uint32x4_t m = vdupq_n_u32(mask);
+  for ( ; i + 4 <= pkts; i += 4, tsb += 4*188) {
+    uint32x4_t v = vdupq_n_u32(*(const uint32_t *)(tsb + 0*188));
+    v = vsetq_lane_u32(*(const uint32_t *)(tsb + 1*188), v, 1);
+    v = vsetq_lane_u32(*(const uint32_t *)(tsb + 2*188), v, 2);
+    v = vsetq_lane_u32(*(const uint32_t *)(tsb + 3*188), v, 3);
+    vst1q_u32(words + i, vandq_u32(v, m));
+  }
+#else
+  for ( ; i + 4 <= pkts; i += 4, tsb += 4*188) {
+    words[i+0] = *(const uint32_t *)(tsb + 0*188) & mask;
+    words[i+1] = *(const uint32_t *)(tsb + 1*188) & mask;
+    words[i+2] = *(const uint32_t *)(tsb + 2*188) & mask;
+    words[i+3] = *(const uint32_t *)(tsb + 3*188) & mask;
+  }
+#endif
+  for ( ; i < pkts; i++, tsb += 188)
+    words[i] = *(const uint32_t *)tsb & mask;
+}
+
 static int
 mpegts_input_process
   ( mpegts_input_t *mi, mpegts_packet_t *mpkt )
@@ -1434,12 +1589,36 @@ mpegts_input_process
   mpegts_mux_instance_t *mmi;
   mpegts_table_feed_t *mtf;
   uint64_t tspos;
+  /* batch-local error counters - flushed once per input batch so the
+   * per-packet path avoids contended read-modify-write cycles */
+  int cnt_te = 0, cnt_cc = 0;
+  /* batched service delivery span (single-subscriber stream PIDs) */
+  mpegts_service_t *sp_svc = NULL;
+  const uint8_t *sp_tsb = NULL;
+  uint64_t sp_pos = 0;
+  int sp_len = 0, sp_f = 0;
+  /* precomputed masked header words (see mpegts_hdr_gather) */
+  uint32_t hdr_words[MPEGTS_HDR_BATCH];
+  uint32_t hdr_mask = 0xFF9FFFD0;
+  int hdr_idx = 0, hdr_cnt = 0, hdr_run;
+
+#if BYTE_ORDER == LITTLE_ENDIAN
+  hdr_mask = bswap_32(hdr_mask);
+#endif
+
+#define TS_SPAN_FLUSH() do { \
+  if (sp_svc) { \
+    ts_recv_packet1_multi(sp_svc, sp_pos, sp_tsb, sp_len, sp_f); \
+    sp_svc = NULL; \
+  } } while (0)
 
   if (mm == NULL || (mmi = mm->mm_active) == NULL)
     return 0;
 
   assert(mm == mmi->mmi_mux);
 
+  mi->mi_arrival = mpkt->mp_arrival;
+
   if (mpkt->mp_cc_restart) {
     LIST_FOREACH(s, &mm->mm_transports, s_active_link)
       TAILQ_FOREACH(st, &s->s_components.set_all, es_link)
@@ -1451,6 +1630,8 @@ mpegts_input_process
       } else {
         mtf = mpegts_input_table_feed_create(mi, mm, NULL, 0);
         mtf->mtf_cc_restart = 1;
+        mpegts_input_table_feed_publish(mi, mtf);
+        table_wakeup = 1;
       }
     }
   }
@@ -1469,14 +1650,24 @@ mpegts_input_process
      *  3 - 0xC0 - scrambled
      *  3 - 0x10 - CC check
      */
-    llen = mpegts_word_count(tsb, len, 0xFF9FFFD0);
+    if (hdr_idx >= hdr_cnt) {
+      hdr_cnt = len / 188;
+      if (hdr_cnt > MPEGTS_HDR_BATCH)
+        hdr_cnt = MPEGTS_HDR_BATCH;
+      mpegts_hdr_gather(tsb, hdr_cnt, hdr_mask, hdr_words);
+      hdr_idx = 0;
+    }
+    for (hdr_run = hdr_idx + 1; hdr_run < hdr_cnt; hdr_run++)
+      if (hdr_words[hdr_run] != hdr_words[hdr_idx])
+        break;
+    llen = (hdr_run - hdr_idx) * 188;
 
     pid = (tsb[1] << 8) | tsb[2];
 
     /* Transport error */
     if (pid & 0x8000) {
       if ((pid & 0x1FFF) != 0x1FFF)
-        atomic_add(&mmi->tii_stats.te, 1);
+        cnt_te++;
     }
 
     pid &= 0x1FFF;
@@ -1502,7 +1693,7 @@ mpegts_input_process
           cc = tsb2[3] & 0x0f;
           if (cc2 != 0xff && cc2 != cc) {
             tvhtrace(LS_MPEGTS, "%s: pid %04X cc err %2d != %2d", mm->mm_nicename, pid, cc, cc2);
-            atomic_add(&mmi->tii_stats.cc, 1);
+            cnt_cc++;
           }
           cc2 = (cc + 1) & 0xF;
         }
@@ -1524,16 +1715,39 @@ mpegts_input_process
 
       /* Stream service data */
       if (type & MPS_SERVICE) {
-        LIST_FOREACH(mps, &mp->mp_svc_subs, mps_svcraw_link) {
+        mps = LIST_FIRST(&mp->mp_svc_subs);
+        if (mps != NULL && LIST_NEXT(mps, mps_svcraw_link) == NULL &&
+            (type & (MPS_TABLE|MPS_FTABLE|MPS_RAW|MPS_STREAM)) == 0) {
+          /* single subscriber, plain stream PID - extend the span and
+           * let ts_recv_packet1_multi amortize the per-run costs */
           s = mps->mps_owner;
-          f = (type & (MPS_TABLE|MPS_FTABLE)) ||
-              (pid == s->s_components.set_pmt_pid) ||
+          f = (pid == s->s_components.set_pmt_pid) ||
               (pid == s->s_components.set_pcr_pid);
-          ts_recv_packet1((mpegts_service_t*)s, tspos, pid, tsb, llen, f);
+          if (sp_svc == (mpegts_service_t *)s && sp_f == f &&
+              sp_tsb + sp_len == tsb) {
+            sp_len += llen;
+          } else {
+            TS_SPAN_FLUSH();
+            sp_svc = (mpegts_service_t *)s;
+            sp_tsb = tsb;
+            sp_len = llen;
+            sp_pos = tspos;
+            sp_f   = f;
+          }
+        } else {
+          TS_SPAN_FLUSH();
+          LIST_FOREACH(mps, &mp->mp_svc_subs, mps_svcraw_link) {
+            s = mps->mps_owner;
+            f = (type & (MPS_TABLE|MPS_FTABLE)) ||
+                (pid == s->s_components.set_pmt_pid) ||
+                (pid == s->s_components.set_pcr_pid);
+            ts_recv_packet1((mpegts_service_t*)s, tspos, pid, tsb, llen, f);
+          }
         }
       } else
       /* Stream table data */
       if (type & MPS_STREAM) {
+        TS_SPAN_FLUSH();
         LIST_FOREACH(s, &mm->mm_transports, s_active_link) {
           if (s->s_type != STYPE_STD) continue;
           f = (type & (MPS_TABLE|MPS_FTABLE)) ||
@@ -1549,30 +1763,29 @@ mpegts_input_process
           if (type & MPS_FTABLE)
             mpegts_input_table_dispatch(mm, mm->mm_nicename, tsb, llen, 1);
           if (type & MPS_TABLE) {
-            if (mi->mi_table_queue_size >= 2*1024*1024) {
+            if (atomic_get_u64(&mi->mi_table_queue_size) >= 2*1024*1024) {
               if (tvhlog_limit(&mi->mi_input_queue_loglimit, 10)) {
                 tvhwarn(LS_MPEGTS, "too much queued table input data (over 2MB) for %s, discarding new", mi->mi_name);
                 if (tvhtrace_enabled())
                   mpegts_input_analyze_table_queue(mi);
               }
             } else {
-              mtf = TAILQ_LAST(&mi->mi_table_queue, mpegts_table_feed_queue);
-              if (mtf && mtf->mtf_mux == mm && mtf->mtf_len + llen <= MPEGTS_MTF_ALLOC_CHUNK) {
-                pid2 = (mtf->mtf_tsb[1] << 8) | mtf->mtf_tsb[2];
-                if (pid == pid2) {
-                  memcpy(mtf->mtf_tsb + mtf->mtf_len, tsb, llen);
-                  memoryinfo_free(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + mtf->mtf_len);
-                  mtf->mtf_len += llen;
-                  mi->mi_table_queue_size += llen;
-                  memoryinfo_alloc(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + mtf->mtf_len);
-                } else {
-                  mtf = NULL;
+              /* coalesce same-PID runs into the pending (unpublished) feed */
+              mtf = mi->mi_table_mtf;
+              if (mtf) {
+                pid2 = ((mtf->mtf_tsb[1] & 0x1f) << 8) | mtf->mtf_tsb[2];
+                if (mtf->mtf_len == 0 || pid != pid2 ||
+                    mtf->mtf_len + llen > MPEGTS_MTF_ALLOC_CHUNK) {
+                  mpegts_input_table_feed_publish(mi, mtf);
+                  mtf = mi->mi_table_mtf = NULL;
                 }
+              }
+              if (mtf == NULL) {
+                mi->mi_table_mtf = mpegts_input_table_feed_create(mi, mm, tsb, llen);
               } else {
-                mtf = NULL;
+                memcpy(mtf->mtf_tsb + mtf->mtf_len, tsb, llen);
+                mtf->mtf_len += llen;
               }
-              if (mtf == NULL)
-                mpegts_input_table_feed_create(mi, mm, tsb, llen);
               table_wakeup = 1;
             }
           }
@@ -1593,8 +1806,13 @@ done:
     tsb += llen;
     len -= llen;
     tspos += llen;
+    hdr_idx += llen / 188;
   }
 
+  /* Deliver any batched service span */
+  TS_SPAN_FLUSH();
+#undef TS_SPAN_FLUSH
+
   /* Raw stream */
   if (tsb != mpkt->mp_data &&
       LIST_FIRST(&mmi->mmi_streaming_pad.sp_targets) != NULL) {
@@ -1608,9 +1826,24 @@ done:
     pktbuf_ref_dec(pb);
   }
 
-  /* Wake table */
-  if (table_wakeup)
+  /* Publish the pending feed and wake the table thread - waking once per
+   * input packet batch (not per section packet) keeps the wakeup cost off
+   * the hot forwarding path */
+  if (mi->mi_table_mtf) {
+    mpegts_input_table_feed_publish(mi, mi->mi_table_mtf);
+    mi->mi_table_mtf = NULL;
+  }
+  if (table_wakeup && atomic_get(&mi->mi_table_sleeping)) {
+    tvh_mutex_lock(&mi->mi_table_lock);
     tvh_cond_signal(&mi->mi_table_cond, 0);
+    tvh_mutex_unlock(&mi->mi_table_lock);
+  }
+
+  /* Error accounting */
+  if (cnt_te)
+    atomic_add(&mmi->tii_stats.te, cnt_te);
+  if (cnt_cc)
+    atomic_add(&mmi->tii_stats.cc, cnt_cc);
 
   /* Bandwidth monitoring */
   llen = tsb - mpkt->mp_data;
@@ -1795,19 +2028,31 @@ mpegts_input_table_thread ( void *aux )
   mpegts_table_feed_t *mtf;
   mpegts_input_t *mi = aux;
   mpegts_mux_t *mm = NULL;
+  int head, tail;
 
-  tvh_mutex_lock(&mi->mi_output_lock);
   while (atomic_get(&mi->mi_running)) {
 
     /* Wait for data */
-    if (!(mtf = TAILQ_FIRST(&mi->mi_table_queue))) {
-      tvh_cond_wait(&mi->mi_table_cond, &mi->mi_output_lock);
+    head = atomic_get(&mi->mi_table_ring_head);
+    if (head == atomic_get(&mi->mi_table_ring_tail)) {
+      tvh_mutex_lock(&mi->mi_table_lock);
+      atomic_set(&mi->mi_table_sleeping, 1);
+      if (head == atomic_get(&mi->mi_table_ring_tail) &&
+          atomic_get(&mi->mi_running))
+        tvh_cond_wait(&mi->mi_table_cond, &mi->mi_table_lock);
+      atomic_set(&mi->mi_table_sleeping, 0);
+      tvh_mutex_unlock(&mi->mi_table_lock);
       continue;
     }
-    mi->mi_table_queue_size -= mtf->mtf_len;
+
+    /* Pop - the scan lock keeps flush/analyze walkers away from
+     * entries we are about to own */
+    tvh_mutex_lock(&mi->mi_table_lock);
+    mtf = mi->mi_table_ring[head & MPEGTS_MTF_RING_MASK];
+    atomic_set(&mi->mi_table_ring_head, head + 1);
+    tvh_mutex_unlock(&mi->mi_table_lock);
+    atomic_dec_u64(&mi->mi_table_queue_size, mtf->mtf_len);
     memoryinfo_free(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + mtf->mtf_len);
-    TAILQ_REMOVE(&mi->mi_table_queue, mtf, mtf_link);
-    tvh_mutex_unlock(&mi->mi_output_lock);
 
     /* Process */
     tvh_mutex_lock(&global_lock);
@@ -1823,17 +2068,20 @@ mpegts_input_table_thread ( void *aux )
 
     /* Cleanup */
     free(mtf);
-    tvh_mutex_lock(&mi->mi_output_lock);
   }
 
   /* Flush */
-  while ((mtf = TAILQ_FIRST(&mi->mi_table_queue)) != NULL) {
+  tvh_mutex_lock(&mi->mi_table_lock);
+  head = atomic_get(&mi->mi_table_ring_head);
+  tail = atomic_get(&mi->mi_table_ring_tail);
+  for ( ; head != tail; head++) {
+    mtf = mi->mi_table_ring[head & MPEGTS_MTF_RING_MASK];
     memoryinfo_free(&mpegts_input_table_memoryinfo, sizeof(mpegts_table_feed_t) + mtf->mtf_len);
-    TAILQ_REMOVE(&mi->mi_table_queue, mtf, mtf_link);
     free(mtf);
   }
-  mi->mi_table_queue_size = 0;
-  tvh_mutex_unlock(&mi->mi_output_lock);
+  atomic_set(&mi->mi_table_ring_head, head);
+  atomic_set_u64(&mi->mi_table_queue_size, 0);
+  tvh_mutex_unlock(&mi->mi_table_lock);
 
   return NULL;
 }
@@ -1844,6 +2092,7 @@ mpegts_input_flush_mux
 {
   mpegts_table_feed_t *mtf;
   mpegts_packet_t *mp;
+  int head, tail;
 
   lock_assert(&global_lock);
 
@@ -1861,12 +2110,18 @@ mpegts_input_flush_mux
   }
   tvh_mutex_unlock(&mi->mi_input_lock);
 
-  /* Flush table Q */
+  /* Flush table Q - take mi_output_lock to serialize against a running
+   * producer batch, then the scan lock against the consumer pop */
   tvh_mutex_lock(&mi->mi_output_lock);
-  TAILQ_FOREACH(mtf, &mi->mi_table_queue, mtf_link) {
+  tvh_mutex_lock(&mi->mi_table_lock);
+  head = atomic_get(&mi->mi_table_ring_head);
+  tail = atomic_get(&mi->mi_table_ring_tail);
+  for ( ; head != tail; head++) {
+    mtf = mi->mi_table_ring[head & MPEGTS_MTF_RING_MASK];
     if (mtf->mtf_mux == mm)
       mtf->mtf_mux = NULL;
   }
+  tvh_mutex_unlock(&mi->mi_table_lock);
   tvh_mutex_unlock(&mi->mi_output_lock);
   /* mux active must be NULL here */
   /* otherwise the picked mtf might be processed after mux deactivation */
@@ -2004,16 +2259,32 @@ mpegts_input_clear_stats ( tvh_input_t *i )
   notify_reload("input_status");
 }
 
+/*
+ * Apply the configured CPU affinity to one thread of the input
+ * pipeline; also used by the frontend reader threads
+ */
+void
+mpegts_input_apply_affinity ( mpegts_input_t *mi, pthread_t tid )
+{
+  if (tvh_str_default(mi->mi_thread_affinity, NULL) == NULL)
+    return;
+  if (tvh_thread_set_affinity(tid, mi->mi_thread_affinity))
+    tvhwarn(LS_MPEGTS, "unable to apply CPU affinity '%s' for %s",
+            mi->mi_thread_affinity, mi->mi_name ?: "input");
+}
+
 static void
 mpegts_input_thread_start ( void *aux )
 {
   mpegts_input_t *mi = aux;
   atomic_set(&mi->mi_running, 1);
-  
+
   tvh_thread_create(&mi->mi_table_tid, NULL,
                     mpegts_input_table_thread, mi, "mi-table");
   tvh_thread_create(&mi->mi_input_tid, NULL,
                     mpegts_input_thread, mi, "mi-main");
+  mpegts_input_apply_affinity(mi, mi->mi_table_tid);
+  mpegts_input_apply_affinity(mi, mi->mi_input_tid);
 }
 
 static void
@@ -2028,9 +2299,9 @@ mpegts_input_thread_stop ( mpegts_input_t *mi )
   tvh_mutex_unlock(&mi->mi_input_lock);
 
   /* Stop table thread */
-  tvh_mutex_lock(&mi->mi_output_lock);
+  tvh_mutex_lock(&mi->mi_table_lock);
   tvh_cond_signal(&mi->mi_table_cond, 0);
-  tvh_mutex_unlock(&mi->mi_output_lock);
+  tvh_mutex_unlock(&mi->mi_table_lock);
 
   /* Join threads (relinquish lock due to potential deadlock) */
   tvh_mutex_unlock(&global_lock);
@@ -2122,8 +2393,8 @@ mpegts_input_create0
   TAILQ_INIT(&mi->mi_input_queue);
 
   tvh_mutex_init(&mi->mi_output_lock, NULL);
+  tvh_mutex_init(&mi->mi_table_lock, NULL);
   tvh_cond_init(&mi->mi_table_cond, 1);
-  TAILQ_INIT(&mi->mi_table_queue);
 
   /* Defaults */
   mi->mi_ota_epg = 1;
@@ -2188,6 +2459,7 @@ mpegts_input_delete ( mpegts_input_t *mi, int delconf )
   tvh_cond_destroy(&mi->mi_table_cond);
   free(mi->mi_name);
   free(mi->mi_linked);
+  free(mi->mi_thread_affinity);
   free(mi);
 }
 
@@ -1003,6 +1003,9 @@ mpegts_mux_stop ( mpegts_mux_t *mm, int force, int reason )
     RB_REMOVE(&mm->mm_pids, mp, mp_link);
     free(mp);
   }
+  free(mm->mm_pid_tab);
+  mm->mm_pid_tab = NULL;
+  memset(mm->mm_open_pid_map, 0, sizeof(mm->mm_open_pid_map));
   tvh_mutex_unlock(&mi->mi_output_lock);
 
   /* Scanning */
@@ -1610,6 +1613,11 @@ mpegts_mux_find_pid_ ( mpegts_mux_t *mm, int pid, int create )
       mp->mp_pid = pid;
       if (!RB_INSERT_SORTED(&mm->mm_pids, mp, mp_link, mp_cmp)) {
         mp->mp_cc = -1;
+        if (mm->mm_pid_tab == NULL)
+          mm->mm_pid_tab = calloc(MPEGTS_PID_TAB_SIZE, sizeof(*mm->mm_pid_tab));
+        mm->mm_pid_tab[pid] = mp;
+        if (pid < 8192)
+          mm->mm_open_pid_map[pid >> 5] |= 1U << (pid & 31);
       } else {
         free(mp);
         mp = NULL;
@@ -1320,6 +1320,44 @@ dvb_mux_delete ( mpegts_mux_t *mm, int delconf )
   mpegts_mux_delete(mm, delconf);
 }
 
+/*
+ * Substream bookkeeping: decide whether two mux configurations ride the
+ * same physical carrier, i.e. they may differ only in the ISI/PLP
+ * selection (stream id, PLS) or the encapsulation PID, not in anything
+ * that would require a retune.  Used to share one tune between
+ * multistream sub-muxes.
+ */
+int
+dvb_mux_conf_same_carrier ( const dvb_mux_conf_t *a, const dvb_mux_conf_t *b )
+{
+  if (a->dmc_fe_type != b->dmc_fe_type)
+    return 0;
+  if (a->dmc_fe_delsys != b->dmc_fe_delsys)
+    return 0;
+  /* same tolerance as the network mux lookups */
+  if (deltaU32(a->dmc_fe_freq, b->dmc_fe_freq) > 2000)
+    return 0;
+  switch (a->dmc_fe_type) {
+  case DVB_TYPE_S:
+    if (a->u.dmc_fe_qpsk.polarisation != b->u.dmc_fe_qpsk.polarisation)
+      return 0;
+    if (deltaU32(a->u.dmc_fe_qpsk.symbol_rate, b->u.dmc_fe_qpsk.symbol_rate) > 2000)
+      return 0;
+    break;
+  case DVB_TYPE_C:
+    if (deltaU32(a->u.dmc_fe_qam.symbol_rate, b->u.dmc_fe_qam.symbol_rate) > 2000)
+      return 0;
+    break;
+  case DVB_TYPE_T:
+    if (a->u.dmc_fe_ofdm.bandwidth != b->u.dmc_fe_ofdm.bandwidth)
+      return 0;
+    break;
+  default:
+    break;
+  }
+  return 1;
+}
+
 /* **************************************************************************
  * Creation/Config
  * *************************************************************************/
@@ -19,6 +19,13 @@
 
 #include "input.h"
 
+/* Upper bound on failed tune attempts per queue pass.  A busy tuner set
+ * is no reason to give up on the whole queue - muxes further down may
+ * map to a different (idle) set of frontends - but we also don't want
+ * to walk a huge queue probing every entry when everything is in use.
+ */
+#define MPEGTS_SCAN_MAX_FAILS 10
+
 /******************************************************************************
  * Timer
  *****************************************************************************/
@@ -109,10 +116,16 @@ mpegts_network_scan_do_mux ( mpegts_mux_queue_t *q, mpegts_mux_t *mm )
   assert(state == MM_SCAN_STATE_PEND ||
          state == MM_SCAN_STATE_IPEND);
 
-  /* No free tuners - stop */
-  if (r == SM_CODE_NO_FREE_ADAPTER || r == SM_CODE_NO_ADAPTERS)
+  /* No adapters at all - stop */
+  if (r == SM_CODE_NO_ADAPTERS)
     return -1;
 
+  /* No free tuners for this mux - a later mux in the queue may still
+   * map to a different (idle) set of frontends, so keep going
+   */
+  if (r == SM_CODE_NO_FREE_ADAPTER)
+    return 1;
+
   /* No valid tuners (subtly different, might be able to tuner a later
    * mux)
    */
@@ -136,27 +149,47 @@ mpegts_network_scan_timer_cb ( void *p )
 {
   mpegts_network_t *mn = p;
   mpegts_mux_t *mm, *nxt = NULL;
+  int r, fails = 0;
 
   /* Process standard Q */
   for (mm = TAILQ_FIRST(&mn->mn_scan_pend); mm != NULL; mm = nxt) {
     nxt = TAILQ_NEXT(mm, mm_scan_link);
-    if (mpegts_network_scan_do_mux(&mn->mn_scan_pend, mm))
-      break;
+    if ((r = mpegts_network_scan_do_mux(&mn->mn_scan_pend, mm)) < 0)
+      goto done;
+    if (r > 0 && ++fails >= MPEGTS_SCAN_MAX_FAILS)
+      goto done;
   }
 
   /* Process idle Q */
   for (mm = TAILQ_FIRST(&mn->mn_scan_ipend); mm != NULL; mm = nxt) {
     nxt = TAILQ_NEXT(mm, mm_scan_link);
-    if (mpegts_network_scan_do_mux(&mn->mn_scan_ipend, mm))
-      break;
+    if ((r = mpegts_network_scan_do_mux(&mn->mn_scan_ipend, mm)) < 0)
+      goto done;
+    if (r > 0 && ++fails >= MPEGTS_SCAN_MAX_FAILS)
+      goto done;
   }
 
+done:
   /* Re-arm timer. Really this is just a safety measure as we'd normally
    * expect the timer to be forcefully triggered on finish of a mux scan
    */
   mtimer_arm_rel(&mn->mn_scan_timer, mpegts_network_scan_timer_cb, mn, sec2mono(120));
 }
 
+/* A tuner has (potentially) been freed - give every network with
+ * pending work a chance to grab it, not just the one whose mux
+ * finished.  Without this, freed tuners sit idle until the other
+ * networks' safety timers fire.
+ */
+static void
+mpegts_network_scan_kick_all ( void )
+{
+  mpegts_network_t *mn;
+  LIST_FOREACH(mn, &mpegts_network_all, mn_global_link)
+    if (TAILQ_FIRST(&mn->mn_scan_pend) || TAILQ_FIRST(&mn->mn_scan_ipend))
+      mtimer_arm_rel(&mn->mn_scan_timer, mpegts_network_scan_timer_cb, mn, 0);
+}
+
 /******************************************************************************
  * Mux transition
  *****************************************************************************/
@@ -242,6 +275,11 @@ mpegts_network_scan_mux_done0
   /* Re-enable? */
   if (weight > 0)
     mpegts_network_scan_queue_add(mm, weight, mm->mm_scan_flags, 10);
+
+  /* The tuner used by this scan is free now - dispatch across all
+   * networks so every idle frontend gets put to work
+   */
+  mpegts_network_scan_kick_all();
 }
 
 /* Failed - couldn't start */
@@ -328,12 +328,19 @@ mpegts_service_is_enabled_raw(service_t *t, int flags)
 static htsmsg_t *
 mpegts_service_config_save ( service_t *t, char *filename, size_t fsize )
 {
+  mpegts_service_t *s = (mpegts_service_t *)t;
   if (filename == NULL) {
     htsmsg_t *e = htsmsg_create_map();
     service_save(t, e);
+    if (s->s_dvb_pmt_cache) {
+      char *hex = alloca(s->s_dvb_pmt_cache_len * 2 + 1);
+      bin2hex(hex, s->s_dvb_pmt_cache_len * 2 + 1,
+              s->s_dvb_pmt_cache, s->s_dvb_pmt_cache_len);
+      htsmsg_add_str(e, "pmt_cache", hex);
+    }
     return e;
   }
-  idnode_changed(&((mpegts_service_t *)t)->s_dvb_mux->mm_id);
+  idnode_changed(&s->s_dvb_mux->mm_id);
   return NULL;
 }
 
@@ -786,6 +793,8 @@ mpegts_service_delete ( service_t *t, int delconf )
   if (t->s_type == STYPE_STD)
     LIST_REMOVE(ms, s_dvb_mux_link);
   sbuf_free(&ms->s_tsbuf);
+  free(ms->s_dvb_pmt_cache);
+  ms->s_dvb_pmt_cache = NULL;
 
   /* Remove master/slave linking */
   while (ms->s_masters.is_count > 0) {
@@ -895,8 +904,20 @@ mpegts_service_create0
   /* Create */
   sbuf_init(&s->s_tsbuf);
   if (conf) {
+    const char *hex;
+    size_t l;
     if (s->s_dvb_last_seen > gclk()) /* sanity check */
       s->s_dvb_last_seen = gclk();
+    if ((hex = htsmsg_get_str(conf, "pmt_cache")) != NULL &&
+        (l = strlen(hex) / 2) > 0 &&
+        (s->s_dvb_pmt_cache = malloc(l)) != NULL) {
+      if (hex2bin(s->s_dvb_pmt_cache, l, hex) == 0) {
+        s->s_dvb_pmt_cache_len = l;
+      } else {
+        free(s->s_dvb_pmt_cache);
+        s->s_dvb_pmt_cache = NULL;
+      }
+    }
   }
   s->s_dvb_mux        = mm;
   if ((r = dvb_servicetype_lookup(s->s_dvb_servicetype)) != -1)
@@ -39,62 +39,46 @@ typedef enum rtp_transport_mode
 
 
 /*
- *
+ * RTP reorder ring - the slot index is derived from the RTP sequence
+ * number, so insert and drain are O(1) and the slot buffers are reused
+ * across packets (no allocations in steady operation).
  */
-static int
-udp_rtp_packet_cmp( const void *_a, const void *_b )
-{
-  const struct satip_udppkt *a = _a, *b = _b;
-  int seq1 = a->up_data_seq, seq2 = b->up_data_seq;
-  if (seq1 < 0x4000 && seq2 > 0xc000) return 1;
-  if (seq2 < 0x4000 && seq1 > 0xc000) return -1;
-  return seq1 - seq2;
-}
-
-static void
-udp_rtp_packet_free( satip_frontend_t *lfe, struct satip_udppkt *up )
-{
-  free(up->up_data);
-  free(up);
-}
-
-static void
-udp_rtp_packet_remove( satip_frontend_t *lfe, struct satip_udppkt *up )
-{
-  TAILQ_REMOVE(&lfe->sf_udp_packets, up, up_link);
-  lfe->sf_udp_packets_count--;
-}
-
-static void
-udp_rtp_packet_destroy( satip_frontend_t *lfe, struct satip_udppkt *up )
-{
-  udp_rtp_packet_remove(lfe, up);
-  udp_rtp_packet_free(lfe, up);
-}
-
 static void
 udp_rtp_packet_destroy_all( satip_frontend_t *lfe )
 {
   struct satip_udppkt *up;
+  int i;
 
-  while ((up = TAILQ_FIRST(&lfe->sf_udp_packets)) != NULL)
-    udp_rtp_packet_destroy(lfe, up);
+  for (i = 0; i < SATIP_RTP_RING_SIZE; i++) {
+    up = &lfe->sf_udp_ring[i];
+    free(up->up_data);
+    up->up_data = NULL;
+    up->up_alloc = up->up_used = 0;
+  }
+  lfe->sf_udp_ring_count  = 0;
+  lfe->sf_udp_ring_jitter = 0;
+  lfe->sf_udp_ring_depth  = SATIP_RTP_RING_DEPTH_MIN;
 }
 
 static void
 udp_rtp_packet_append( satip_frontend_t *lfe, uint8_t *p, int len, uint16_t seq )
 {
-  struct satip_udppkt *up = malloc(sizeof(*up));
-  if (len > 0) {
-    up->up_data = malloc(len);
-    memcpy(up->up_data, p, len);
-  } else {
-    up->up_data = NULL;
+  struct satip_udppkt *up = &lfe->sf_udp_ring[seq & SATIP_RTP_RING_MASK];
+
+  if (up->up_used) {
+    /* slot collision - the stored packet is a full ring behind, drop it */
+    lfe->sf_udp_ring_count--;
   }
+  if (len > up->up_alloc) {
+    up->up_data  = realloc(up->up_data, len);
+    up->up_alloc = len;
+  }
+  if (len > 0)
+    memcpy(up->up_data, p, len);
   up->up_data_len = len;
   up->up_data_seq = seq;
-  TAILQ_INSERT_SORTED(&lfe->sf_udp_packets, up, up_link, udp_rtp_packet_cmp);
-  lfe->sf_udp_packets_count++;
+  up->up_used = 1;
+  lfe->sf_udp_ring_count++;
 }
 
 /*
@@ -1491,11 +1475,23 @@ satip_frontend_rtp_decode
   if (seq == -1)
     seq = nseq;
   else if (((seq + 1) & 0xffff) != nseq) {
-    if (lfe->sf_udp_packets_count > 5) {
-      up = TAILQ_FIRST(&lfe->sf_udp_packets);
-      tvhtrace(LS_SATIP, "RTP discontinuity, reset sequence to %d from %d", up->up_data_seq, (seq + 1) & 0xffff);
-      *_seq = (up->up_data_seq - 1) & 0xffff;
-      *_unc += (up->up_data_len / 188) * (uint32_t)((uint16_t)up->up_data_seq-(uint16_t)(seq+1));
+    if (lfe->sf_udp_ring_count > lfe->sf_udp_ring_depth) {
+      /* waited long enough for the missing packet(s) -
+       * resume at the oldest queued sequence number */
+      struct satip_udppkt *up2;
+      int i, d, best = -1, bestd = 0x10000;
+      for (i = 0; i < SATIP_RTP_RING_SIZE; i++) {
+        up2 = &lfe->sf_udp_ring[i];
+        if (!up2->up_used) continue;
+        d = (up2->up_data_seq - (uint16_t)(seq + 1)) & 0xffff;
+        if (d < bestd) { bestd = d; best = i; }
+      }
+      if (best >= 0) {
+        up2 = &lfe->sf_udp_ring[best];
+        tvhtrace(LS_SATIP, "RTP discontinuity, reset sequence to %d from %d", up2->up_data_seq, (seq + 1) & 0xffff);
+        *_seq = (up2->up_data_seq - 1) & 0xffff;
+        *_unc += (up2->up_data_len / 188) * (uint32_t)bestd;
+      }
     }
     tvhtrace(LS_SATIP, "RTP discontinuity (%i != %i), queueing packet", seq + 1, nseq);
     udp_rtp_packet_append(lfe, p, c, nseq);
@@ -1519,12 +1515,22 @@ wrdata:
     sbuf_append(&lfe->sf_sbuf, p + pos, len);
   }
 next:
-  up = TAILQ_FIRST(&lfe->sf_udp_packets);
-  if (up && ((*_seq + 1) & 0xffff) == up->up_data_seq) {
-    udp_rtp_packet_remove(lfe, up);
+  nseq = (*_seq + 1) & 0xffff;
+  up = &lfe->sf_udp_ring[nseq & SATIP_RTP_RING_MASK];
+  if (up->up_used && up->up_data_seq == nseq) {
+    /* the gap just closed - adapt the drain threshold to the reorder
+     * depth this link actually exhibits, with a slow decay */
+    if (lfe->sf_udp_ring_count > lfe->sf_udp_ring_jitter)
+      lfe->sf_udp_ring_jitter = lfe->sf_udp_ring_count;
+    else
+      lfe->sf_udp_ring_jitter -= lfe->sf_udp_ring_jitter >> 6;
+    lfe->sf_udp_ring_depth = MINMAX(lfe->sf_udp_ring_jitter * 2,
+                                    SATIP_RTP_RING_DEPTH_MIN,
+                                    (SATIP_RTP_RING_SIZE * 3) / 4);
+    up->up_used = 0;
+    lfe->sf_udp_ring_count--;
     tvhtrace(LS_SATIP, "RTP discontinuity, requeueing packet (%i)", up->up_data_seq);
     len = satip_frontend_rtp_decode(lfe, _seq, _unc, up->up_data, up->up_data_len);
-    udp_rtp_packet_free(lfe, up);
   }
   return len;
 }
@@ -1945,7 +1951,10 @@ new_tune:
       continue;
     }
 
-    if (changing && rtsp->hc_cmd == HTTP_CMD_NONE) {
+    /* pid updates are pipelined behind a pending OPTIONS/PLAY answer;
+     * only SETUP must complete first (no stream id before that) */
+    if (changing && (rtsp->hc_cmd == HTTP_CMD_NONE ||
+                     (session[0] != '\0' && rtsp->hc_cmd != RTSP_CMD_SETUP))) {
       ms = 500;
       changing = 0;
       if (satip_frontend_pid_changed(rtsp, lfe, buf) > 0)
@@ -1963,6 +1972,7 @@ new_tune:
     if (nfds < 1) continue;
 
     if (ev[0].ptr == rtsp) {
+rtsp_run:
       r = http_client_run(rtsp);
       if (r < 0) {
         if (rtsp->hc_code == 404 && session[0]) {
@@ -2062,7 +2072,15 @@ new_tune:
           }
           break;
         }
-        rtsp->hc_cmd = HTTP_CMD_NONE;
+        if (TAILQ_EMPTY(&rtsp->hc_wqueue)) {
+          rtsp->hc_cmd = HTTP_CMD_NONE;
+        } else {
+          /* a pipelined command is still unanswered and its response
+           * may already sit in the read buffer */
+          reply = 1;
+          if (!fatal)
+            goto rtsp_run;
+        }
       }
 
       if (!running)
@@ -2400,6 +2418,7 @@ satip_frontend_create
   tvh_pipe(O_NONBLOCK, &lfe->sf_dvr_pipe);
   tvh_thread_create(&lfe->sf_dvr_thread, NULL,
                     satip_frontend_input_thread, lfe, "satip-front");
+  mpegts_input_apply_affinity((mpegts_input_t *)lfe, lfe->sf_dvr_thread);
 
   return lfe;
 }
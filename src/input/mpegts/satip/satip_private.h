@@ -122,11 +122,17 @@ struct satip_tune_req {
   int                        sf_netposhash;
 };
 
+/* RTP reorder ring - power-of-two, indexed by RTP sequence number */
+#define SATIP_RTP_RING_SIZE      256
+#define SATIP_RTP_RING_MASK      (SATIP_RTP_RING_SIZE-1)
+#define SATIP_RTP_RING_DEPTH_MIN 5
+
 struct satip_udppkt {
-  TAILQ_ENTRY(satip_udppkt)  up_link;
-  uint8_t                   *up_data;
+  uint8_t                   *up_data;  ///< slot buffer, reused across packets
+  int                        up_alloc;
   uint16_t                   up_data_len;
   uint16_t                   up_data_seq;
+  uint8_t                    up_used;
 };
 
 struct satip_frontend
@@ -184,8 +190,10 @@ struct satip_frontend
   int                        sf_netlimit;
   int                        sf_netgroup;
   int                        sf_netposhash;
-  TAILQ_HEAD(,satip_udppkt)  sf_udp_packets;
-  int                        sf_udp_packets_count;
+  struct satip_udppkt        sf_udp_ring[SATIP_RTP_RING_SIZE];
+  int                        sf_udp_ring_count;   ///< occupied slots
+  int                        sf_udp_ring_depth;   ///< adaptive drain threshold
+  int                        sf_udp_ring_jitter;  ///< observed reorder depth
  
   /*
    * Configuration
@@ -406,11 +406,11 @@ scanfile_create_network
 static int
 scanfile_load_one
   ( scanfile_network_t **net, const char *type, const char *path,
-    const char *name, const char *line, int test )
+    const char *name, const char *line )
 {
   int r = 1;
   dvb_mux_conf_t *mux = malloc(sizeof(dvb_mux_conf_t));
-  
+
   switch (line[0]) {
     case 'A':
       r = scanfile_load_atsc(mux, line+1);
@@ -435,13 +435,8 @@ scanfile_load_one
       free(mux);
       return -1;
     }
-    if (!test) {
-      memoryinfo_alloc(&scanfile_memoryinfo, sizeof(*mux));
-      LIST_INSERT_HEAD(&(*net)->sfn_muxes, mux, dmc_link);
-    } else {
-      free(mux);
-      return -1;
-    }
+    memoryinfo_alloc(&scanfile_memoryinfo, sizeof(*mux));
+    LIST_INSERT_HEAD(&(*net)->sfn_muxes, mux, dmc_link);
   }
   return 1;
 }
@@ -480,7 +475,7 @@ static int
 scanfile_load_dvbv5
   ( scanfile_network_t **net, const char *type,
     const char *path, const char *name,
-    char *line, fb_file *fp, int test )
+    char *line, fb_file *fp )
 {
   int res = 1, r = 1, i;
   char buf[256];
@@ -729,13 +724,8 @@ scanfile_load_dvbv5
     if (*net == NULL)
       if (scanfile_create_network(net, type, path, name, mux->dmc_fe_delsys))
         return -1;
-    if (!test) {
-      memoryinfo_alloc(&scanfile_memoryinfo, sizeof(*mux));
-      LIST_INSERT_HEAD(&(*net)->sfn_muxes, mux, dmc_link);
-    } else {
-      free(mux);
-      res = -2;
-    }
+    memoryinfo_alloc(&scanfile_memoryinfo, sizeof(*mux));
+    LIST_INSERT_HEAD(&(*net)->sfn_muxes, mux, dmc_link);
   }
 
   return res;
@@ -747,19 +737,15 @@ scanfile_load_dvbv5
 static scanfile_network_t *
 scanfile_load_file
   ( scanfile_network_t *net, const char *type, const char *path,
-    fb_file *fp, const char *name, int test )
+    fb_file *fp, const char *name )
 {
   char *str, buf[256];
   int load = 0;
 
-  tvhtrace(LS_SCANFILE, "load file %s (processed bytes %"PRId64")",
-           name, scanfile_total_load);
+  tvhtrace(LS_SCANFILE, "load file %s", name);
 
   if (!fp) return NULL;
 
-  scanfile_total_load += fb_size(fp);
-  if (scanfile_total_load > SCANFILE_LIMIT) goto end;
-
   /* Process file */
   load = 1;
   while (!fb_eof(fp) && load >= 0) {
@@ -782,20 +768,83 @@ scanfile_load_file
       case 'C':
       case 'T':
       case 'S':
-        load = scanfile_load_one(&net, type, path, name, buf, test);
+        load = scanfile_load_one(&net, type, path, name, buf);
         break;
       case '[':
-        load = scanfile_load_dvbv5(&net, type, path, name, buf, fp, test);
+        load = scanfile_load_dvbv5(&net, type, path, name, buf, fp);
         break;
       default:
         break;
     }
   }
-end:
   fb_close(fp);
   return net;
 }
 
+/*
+ * Determine the delivery system of the first mux entry without
+ * parsing the mux parameters - all the index pass needs
+ */
+static int
+scanfile_probe_delsys ( fb_file *fp )
+{
+  char buf[256];
+  char *s, *t;
+  int dvbv5 = 0, delsys;
+
+  while (!fb_eof(fp)) {
+    buf[sizeof(buf)-1] = '\0';
+    if (!fb_gets(fp, buf, sizeof(buf) - 1)) break;
+    s = str_trim(buf);
+    if (*s == '#' || *s == '\0')
+      continue;
+    if (dvbv5) {
+      if ((t = strchr(s, '=')) == NULL)
+        continue;
+      *t = '\0';
+      if (strcmp(str_trim(s), "DELIVERY_SYSTEM"))
+        continue;
+      t = str_trim(t + 1);
+      if ((delsys = dvb_str2delsys(t)) == -1 && !strcmp(t, "DVBC"))
+        delsys = DVB_SYS_DVBC_ANNEX_A;
+      if (delsys != -1)
+        return delsys;
+    } else {
+      switch (*s) {
+        case '[': dvbv5 = 1;               break;
+        case 'A': return DVB_SYS_ATSC;
+        case 'T': return DVB_SYS_DVBT;
+        case 'S': return DVB_SYS_DVBS;
+        case 'C': return DVB_SYS_DVBC_ANNEX_A;
+      }
+    }
+  }
+  return -1;
+}
+
+/*
+ * Index a file - only the network metadata is recorded here, the mux
+ * list itself is parsed on first access in scanfile_find()
+ */
+static void
+scanfile_index_file
+  ( const char *type, const char *path, fb_file *fp, const char *name )
+{
+  scanfile_network_t *net = NULL;
+  int delsys;
+
+  tvhtrace(LS_SCANFILE, "index file %s (processed bytes %"PRId64")",
+           name, scanfile_total_load);
+
+  if (!fp) return;
+
+  scanfile_total_load += fb_size(fp);
+  if (scanfile_total_load <= SCANFILE_LIMIT &&
+      (delsys = scanfile_probe_delsys(fp)) != -1)
+    scanfile_create_network(&net, type, path, name, delsys);
+  fb_close(fp);
+}
+
 /*
  * Process directory
  *
@@ -803,31 +852,29 @@ end:
  */
 static void
 scanfile_load_dir
-  ( const char *path, const char *type, int lvl, int test )
+  ( const char *path, const char *type, int lvl )
 {
   char p[PATH_MAX];
   fb_dir *dir;
   fb_dirent *de;
   fb_file *fp;
-  scanfile_network_t *net;
 
   tvhtrace(LS_SCANFILE, "load dir %s", path);
 
   if (lvl >= 3) return;
   if (!(dir = fb_opendir(path))) return;
   lvl++;
-  
+
   while ((de = fb_readdir(dir))) {
     if (*de->name == '.') continue;
     if (de->type == FB_DIR) {
       snprintf(p, sizeof(p), "%s/%s", path, de->name);
-      scanfile_load_dir(p, de->name, lvl+1, test);
+      scanfile_load_dir(p, de->name, lvl+1);
     } else if (type) {
       snprintf(p, sizeof(p), "%s/%s", path, de->name);
       if (scanfile_total_load > SCANFILE_LIMIT) continue;
       fp = fb_open2(dir, de->name, 1, 0);
-      net = scanfile_load_file(NULL, type, p, fp, de->name, test);
-      scanfile_done_muxes(net);
+      scanfile_index_file(type, p, fp, de->name);
     }
   }
 
@@ -942,7 +989,7 @@ scanfile_init ( const char *muxconf_path, int lock )
     scanfile_regions_load[i].srl_alt_type = scanfile_region_types[i][1];
   }
 
-  scanfile_load_dir(path, NULL, 0, 1);
+  scanfile_load_dir(path, NULL, 0);
 
   for (i = 0; i < REGIONS; i++) {
     snprintf(buf, sizeof(buf)-1, "%s", scanfile_regions_load[i].srl_type);
@@ -1051,7 +1098,7 @@ scanfile_find ( const char *id )
   if (n) {
     fp = fb_open(n->sfn_path, 1, 0);
     tmp = strrchr(n->sfn_path, '/');
-    scanfile_load_file(n, n->sfn_type, n->sfn_path, fp, tmp ?: n->sfn_path, 0);
+    scanfile_load_file(n, n->sfn_type, n->sfn_path, fp, tmp ?: n->sfn_path);
   }
 
   return n;
@@ -48,6 +48,10 @@
 /* Reassembly buffer size */
 #define REASSEMBLY_BUFFER_SIZE  (256 * 1024)
 
+/* Batched output buffer size - large enough for all inner packets of a
+ * maximum-size T2MI packet (65536 / 187 * 188 bytes) */
+#define OUTPUT_BUFFER_SIZE      (66 * 1024)
+
 /* BBframe format types (TS/GS field) */
 #define BBFRAME_FORMAT_GFPS     0   /* Generic Fixed Packetized Stream */
 #define BBFRAME_FORMAT_GCS      1   /* Generic Continuous Stream */
@@ -61,8 +65,13 @@ struct t2mi_ctx {
     uint16_t            pid;            /* T2MI PID filter (0 = any) */
     uint8_t             plp;            /* PLP filter (T2MI_PLP_ALL = any) */
     t2mi_output_cb      callback;       /* Output callback */
+    t2mi_output_run_cb  run_callback;   /* Batch output callback */
     void               *opaque;         /* User context */
 
+    /* Batched output of inner TS packets */
+    uint8_t             out_buffer[OUTPUT_BUFFER_SIZE];
+    size_t              out_pos;        /* Bytes staged for output */
+
     /* TS packet reassembly */
     uint8_t             ts_buffer[REASSEMBLY_BUFFER_SIZE];
     size_t              ts_pos;         /* Current position in buffer */
@@ -106,6 +115,12 @@ t2mi_ctx_t *t2mi_decap_create(uint16_t pid, uint8_t plp, t2mi_output_cb cb, void
     return ctx;
 }
 
+void t2mi_decap_set_run_cb(t2mi_ctx_t *ctx, t2mi_output_run_cb cb)
+{
+    if (ctx)
+        ctx->run_callback = cb;
+}
+
 void t2mi_decap_destroy(t2mi_ctx_t *ctx)
 {
     if (ctx)
@@ -295,18 +310,42 @@ int t2mi_decap_feed(t2mi_ctx_t *ctx, const uint8_t *ts_pkt)
     return 0;
 }
 
+/*
+ * Flush the staged run of inner TS packets to the batch callback
+ */
+static void t2mi_flush_run(t2mi_ctx_t *ctx, uint8_t plp_id)
+{
+    if (ctx->out_pos == 0)
+        return;
+    ctx->run_callback(ctx->opaque, ctx->out_buffer, ctx->out_pos, plp_id);
+    ctx->out_pos = 0;
+}
+
 /*
  * Output a complete TS packet (prepend sync byte for HEM mode)
  */
 static void t2mi_output_ts(t2mi_ctx_t *ctx, const uint8_t *data, uint8_t plp_id)
 {
     uint8_t ts_pkt[T2MI_TS_PACKET_SIZE];
+    uint8_t *dst;
+
+    ctx->stats.ts_packets_out++;
+
+    /* Batch mode - stage sync byte + payload, deliver the run later */
+    if (ctx->run_callback) {
+        dst = ctx->out_buffer + ctx->out_pos;
+        dst[0] = T2MI_TS_SYNC_BYTE;
+        memcpy(dst + 1, data, TS_PACKET_SIZE_HEM);
+        ctx->out_pos += T2MI_TS_PACKET_SIZE;
+        if (ctx->out_pos + T2MI_TS_PACKET_SIZE > sizeof(ctx->out_buffer))
+            t2mi_flush_run(ctx, plp_id);
+        return;
+    }
 
     /* Prepend sync byte (HEM mode removes it from transmission) */
     ts_pkt[0] = T2MI_TS_SYNC_BYTE;
     memcpy(ts_pkt + 1, data, TS_PACKET_SIZE_HEM);
 
-    ctx->stats.ts_packets_out++;
     ctx->callback(ctx->opaque, ts_pkt, plp_id);
 }
 
@@ -466,6 +505,9 @@ static void t2mi_process_packet(t2mi_ctx_t *ctx)
         /* Transport Stream mode - use HEM extraction */
         t2mi_process_ts_bbframe(ctx, ctx->t2mi_packet + data_offset,
                                  data_len, syncd, plp_id);
+        /* Deliver the whole baseband frame as one run */
+        if (ctx->run_callback)
+            t2mi_flush_run(ctx, plp_id);
     }
     /* Other formats (GSE, GCS) not supported yet */
 }
@@ -56,6 +56,19 @@ typedef struct t2mi_ctx t2mi_ctx_t;
  */
 typedef void (*t2mi_output_cb)(void *opaque, const uint8_t *pkt, uint8_t plp_id);
 
+/* Batch callback for extracted inner TS packets
+ * Called with a run of complete 188-byte TS packets (len is a multiple
+ * of 188).  When installed, it replaces the per-packet callback and
+ * amortizes the callback cost over a whole baseband frame.
+ *
+ * @param opaque    User-provided context
+ * @param data      Pointer to the packet run
+ * @param len       Length of the run in bytes
+ * @param plp_id    PLP ID this run came from
+ */
+typedef void (*t2mi_output_run_cb)(void *opaque, const uint8_t *data,
+                                   size_t len, uint8_t plp_id);
+
 /* Statistics */
 typedef struct {
     uint64_t ts_packets_in;      /* Outer TS packets fed */
@@ -78,6 +91,15 @@ typedef struct {
  */
 t2mi_ctx_t *t2mi_decap_create(uint16_t pid, uint8_t plp, t2mi_output_cb cb, void *opaque);
 
+/**
+ * Install a batch output callback
+ *
+ * @param ctx       Context handle
+ * @param cb        Callback for runs of extracted TS packets (NULL to
+ *                  revert to the per-packet callback)
+ */
+void t2mi_decap_set_run_cb(t2mi_ctx_t *ctx, t2mi_output_run_cb cb);
+
 /**
  * Destroy T2MI context and free resources
  */
@@ -37,6 +37,7 @@ ts_recv_packet0
 {
   mpegts_service_t *m;
   int len2, off, cc, pid, error, errors = 0;
+  int cc_errors = 0, tei_errors = 0;
   const uint8_t *tsb2;
 
   service_set_streaming_status_flags((service_t*)t, TSS_MUX_PACKETS);
@@ -46,8 +47,9 @@ ts_recv_packet0
 
   for (tsb2 = tsb, len2 = len; len2 > 0; tsb2 += 188, len2 -= 188) {
 
-    error   = (tsb2[1] >> 7) & 1; /* 0x80 */
-    errors += error;
+    error       = (tsb2[1] >> 7) & 1; /* 0x80 */
+    errors     += error;
+    tei_errors += error;
 
     /* Check CC */
 
@@ -62,6 +64,7 @@ ts_recv_packet0
         if (!error)
           errors++;
         error |= 2;
+        cc_errors++;
       }
       st->es_cc = (cc + 1) & 0xf;
     }
@@ -70,6 +73,8 @@ ts_recv_packet0
       continue;
   }
 
+  service_qual_input((service_t *)t, len / 188, cc_errors, tei_errors, 0);
+
   if (!t->s_scrambled_pass && (st->es_type == SCT_CA || st->es_type == SCT_CAT))
     return;
 
@@ -100,7 +105,7 @@ ts_recv_skipped0
   (mpegts_service_t *t, elementary_stream_t *st, const uint8_t *tsb, int len)
 {
   mpegts_service_t *m;
-  int len2, off, cc, pid;
+  int len2, off, cc, pid, cc_errors = 0;
   const uint8_t *tsb2;
 
   if (!st)
@@ -118,12 +123,15 @@ ts_recv_skipped0
             tvhlog_limit(&st->es_cc_log, 10))
           tvhwarn(LS_TS, "%s Continuity counter error (total %zi)",
                          st->es_nicename, st->es_cc_log.count);
+        cc_errors++;
       }
       st->es_cc = (cc + 1) & 0xf;
     }
 
   }
 
+  service_qual_input((service_t *)t, len / 188, cc_errors, 0, 0);
+
 skip_cc:
   if(streaming_pad_probe_type(&t->s_streaming_pad, SMT_MPEGTS))
     ts_skip(t, tsb, len);
@@ -141,17 +149,36 @@ skip_cc:
 }
 
 /**
- * Process service stream packets, optionally descramble
+ * Extract a PCR from the adaptation field, if present
  */
-int
-ts_recv_packet1
-  (mpegts_service_t *t, uint64_t tspos, uint16_t pid,
-   const uint8_t *tsb, int len, int table)
+static int
+ts_get_pcr(const uint8_t *tsb, int64_t *rpcr)
+{
+  int_fast64_t pcr;
+
+  if ((tsb[3] & 0x20) == 0 || tsb[4] == 0 || (tsb[5] & 0x10) == 0)
+    return 0;
+  pcr  =  (uint64_t)tsb[6] << 25;
+  pcr |=  (uint64_t)tsb[7] << 17;
+  pcr |=  (uint64_t)tsb[8] << 9;
+  pcr |=  (uint64_t)tsb[9] << 1;
+  pcr |= ((uint64_t)tsb[10] >> 7) & 0x01;
+  *rpcr = pcr;
+  return 1;
+}
+
+/**
+ * Process one same-PID run of service stream packets, optionally
+ * descramble; s_stream_mutex must be held and the service running
+ */
+static int
+ts_recv_packet1_one
+  (mpegts_service_t *t, uint16_t pid, const uint8_t *tsb, int len, int table)
 {
   elementary_stream_t *st;
   uint_fast8_t scrambled, error = 0;
   int r;
-  
+
   /* Error */
   if (tsb[1] & 0x80)
     error = 1;
@@ -161,16 +188,6 @@ ts_recv_packet1
          tsb[0], tsb[1], tsb[2], tsb[3], tsb[4], tsb[5]);
 #endif
 
-  tvh_mutex_lock(&t->s_stream_mutex);
-
-  /* Service inactive - ignore */
-  if(t->s_status != SERVICE_RUNNING) {
-    tvh_mutex_unlock(&t->s_stream_mutex);
-    return 0;
-  }
-
-  service_set_streaming_status_flags((service_t*)t, TSS_INPUT_HARDWARE);
-
   if(error) {
     /* Transport Error Indicator */
     if (tvhlog_limit(&t->s_tei_log, 10))
@@ -178,11 +195,23 @@ ts_recv_packet1
               service_nicename((service_t*)t), t->s_tei_log.count);
   }
 
+  /* flight recorder probe - one pointer test while disarmed */
+  if (t->s_tsring)
+    service_tsring_input((service_t *)t, tsb, len);
+
   st = elementary_stream_find(&t->s_components, pid);
 
-  if((st == NULL) && (pid != t->s_components.set_pcr_pid) && !table) {
-    tvh_mutex_unlock(&t->s_stream_mutex);
+  if((st == NULL) && (pid != t->s_components.set_pcr_pid) && !table)
     return 0;
+
+  /* PCR jitter samples for the quality accounting */
+  if(pid == t->s_components.set_pcr_pid) {
+    const uint8_t *tsb2;
+    int64_t pcr;
+    int len2;
+    for (tsb2 = tsb, len2 = len; len2 > 0; tsb2 += 188, len2 -= 188)
+      if (ts_get_pcr(tsb2, &pcr))
+        service_qual_pcr((service_t *)t, pcr);
   }
 
   if(!error)
@@ -199,13 +228,12 @@ ts_recv_packet1
 
     /* scrambled stream */
     r = descrambler_descramble((service_t *)t, st, tsb, len);
-    if(r > 0) {
-      tvh_mutex_unlock(&t->s_stream_mutex);
+    if(r > 0)
       return 1;
-    }
 
     if(!error && service_is_encrypted((service_t*)t)) {
       if(r == 0) {
+        service_qual_input((service_t *)t, len / 188, 0, 0, len / 188);
         service_set_streaming_status_flags((service_t*)t, TSS_NO_DESCRAMBLER);
       } else {
         service_set_streaming_status_flags((service_t*)t, TSS_NO_ACCESS);
@@ -215,10 +243,65 @@ ts_recv_packet1
   } else {
     ts_recv_packet0(t, st, tsb, len);
   }
-  tvh_mutex_unlock(&t->s_stream_mutex);
   return 1;
 }
 
+/**
+ * Process service stream packets, optionally descramble
+ */
+int
+ts_recv_packet1
+  (mpegts_service_t *t, uint64_t tspos, uint16_t pid,
+   const uint8_t *tsb, int len, int table)
+{
+  int r;
+
+  tvh_mutex_lock(&t->s_stream_mutex);
+
+  /* Service inactive - ignore */
+  if(t->s_status != SERVICE_RUNNING) {
+    tvh_mutex_unlock(&t->s_stream_mutex);
+    return 0;
+  }
+
+  service_set_streaming_status_flags((service_t*)t, TSS_INPUT_HARDWARE);
+
+  r = ts_recv_packet1_one(t, pid, tsb, len, table);
+  tvh_mutex_unlock(&t->s_stream_mutex);
+  return r;
+}
+
+/**
+ * Batch entry point - accepts a contiguous span covering several
+ * mpegts_word_count runs (mixed PIDs) that all belong to this service.
+ * The service lock and status bookkeeping are paid once per span
+ * instead of once per run, which matters with interleaved A/V PIDs.
+ */
+int
+ts_recv_packet1_multi
+  (mpegts_service_t *t, uint64_t tspos, const uint8_t *tsb, int len, int table)
+{
+  int pid, len2, r = 0;
+
+  tvh_mutex_lock(&t->s_stream_mutex);
+
+  /* Service inactive - ignore */
+  if(t->s_status != SERVICE_RUNNING) {
+    tvh_mutex_unlock(&t->s_stream_mutex);
+    return 0;
+  }
+
+  service_set_streaming_status_flags((service_t*)t, TSS_INPUT_HARDWARE);
+
+  for ( ; len > 0; tsb += len2, len -= len2 ) {
+    len2 = mpegts_word_count(tsb, len, 0xFF9FFFD0);
+    pid  = (tsb[1] & 0x1f) << 8 | tsb[2];
+    r   |= ts_recv_packet1_one(t, pid, tsb, len2, table);
+  }
+  tvh_mutex_unlock(&t->s_stream_mutex);
+  return r;
+}
+
 
 /*
  * Process transport stream packets, simple version
@@ -298,6 +381,8 @@ ts_flush(mpegts_service_t *t, sbuf_t *sb)
 
   pb = pktbuf_alloc(sb->sb_data, sb->sb_ptr);
   pb->pb_err = sb->sb_err;
+  pb->pb_rtime = t->s_tsbuf_arrival;
+  t->s_tsbuf_arrival = 0;
 
   memset(&sm, 0, sizeof(sm));
   sm.sm_type = SMT_MPEGTS;
@@ -323,6 +408,10 @@ ts_remux(mpegts_service_t *t, const uint8_t *src, int len, int errors)
   if (sb->sb_data == NULL)
     sbuf_init_fixed(sb, TS_REMUX_BUFSIZE);
 
+  /* stamp the buffer with the input arrival time of its oldest bytes */
+  if (sb->sb_ptr == 0 && t->s_dvb_active_input)
+    t->s_tsbuf_arrival = t->s_dvb_active_input->mi_arrival;
+
   sbuf_append(sb, src, len);
   sb->sb_err += errors;
 
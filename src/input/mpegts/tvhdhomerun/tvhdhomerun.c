@@ -519,6 +519,7 @@ void tvhdhomerun_done ( void )
     tvhdhomerun_discovery_destroy(d, 1);
   }
   tvh_mutex_unlock(&global_lock);
+  tvhdhomerun_rx_engine_stop();
   hdhomerun_debug_destroy(hdhomerun_debug_obj);
 }
 
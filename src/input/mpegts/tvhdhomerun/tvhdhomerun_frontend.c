@@ -54,33 +54,20 @@ tvhdhomerun_frontend_is_enabled
   return mpegts_input_is_enabled(mi, mm, flags, weight);
 }
 
-static void *
-tvhdhomerun_frontend_input_thread ( void *aux )
+/*
+ * Open and bind the local data socket and point the device at it
+ */
+static int
+tvhdhomerun_frontend_rx_open ( tvhdhomerun_frontend_t *hfe )
 {
-  tvhdhomerun_frontend_t *hfe = aux;
-  mpegts_mux_instance_t *mmi;
-  sbuf_t sb;
-  char buf[256];
   char target[64];
   uint32_t local_ip;
-  int sockfd, nfds;
+  int sockfd;
   int sock_opt = 1;
   int r;
   int rx_size = 1024 * 1024;
   struct sockaddr_in sock_addr;
   socklen_t sockaddr_len = sizeof(sock_addr);
-  tvhpoll_event_t ev[2];
-  tvhpoll_t *efd;
-
-  tvhdebug(LS_TVHDHOMERUN, "starting input thread");
-
-  /* Get MMI */
-  tvh_mutex_lock(&hfe->hf_input_thread_mutex);
-  hfe->mi_display_name((mpegts_input_t*)hfe, buf, sizeof(buf));
-  mmi = LIST_FIRST(&hfe->mi_mux_active);
-  tvh_cond_signal(&hfe->hf_input_thread_cond, 0);
-  tvh_mutex_unlock(&hfe->hf_input_thread_mutex);
-  if (mmi == NULL) return NULL;
 
   tvhdebug(LS_TVHDHOMERUN, "opening client socket");
 
@@ -104,26 +91,26 @@ tvhdhomerun_frontend_input_thread ( void *aux )
   sockfd = tvh_socket(AF_INET, SOCK_DGRAM, 0);
   if(sockfd == -1) {
     tvherror(LS_TVHDHOMERUN, "failed to open socket (%d)", errno);
-    return NULL;
+    return -1;
   }
 
   if(fcntl(sockfd, F_SETFL, O_NONBLOCK) != 0) {
     close(sockfd);
     tvherror(LS_TVHDHOMERUN, "failed to set socket nonblocking (%d)", errno);
-    return NULL;
+    return -1;
   }
 
   /* enable broadcast */
   if(setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, (char *) &sock_opt, sizeof(sock_opt)) < 0) {
     close(sockfd);
     tvherror(LS_TVHDHOMERUN, "failed to enable broadcast on socket (%d)", errno);
-    return NULL;
+    return -1;
   }
 
   if(setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (char *) &sock_opt, sizeof(sock_opt)) < 0) {
     close(sockfd);
     tvherror(LS_TVHDHOMERUN, "failed to set address reuse on socket (%d)", errno);
-    return NULL;
+    return -1;
   }
 
   /* important: we need large rx buffers to accommodate the large amount of traffic */
@@ -138,14 +125,14 @@ tvhdhomerun_frontend_input_thread ( void *aux )
   if(bind(sockfd, (struct sockaddr *) &sock_addr, sizeof(sock_addr)) != 0) {
     tvherror(LS_TVHDHOMERUN, "failed bind socket: %d", errno);
     close(sockfd);
-    return NULL;
+    return -1;
   }
 
   memset(&sock_addr, 0, sizeof(sock_addr));
   if(getsockname(sockfd, (struct sockaddr *) &sock_addr, &sockaddr_len) != 0) {
     tvherror(LS_TVHDHOMERUN, "failed to getsockname: %d", errno);
     close(sockfd);
-    return NULL;
+    return -1;
   }
 
   /* pretend we are smart and set video_socket; doubt that this is required though */
@@ -166,60 +153,130 @@ tvhdhomerun_frontend_input_thread ( void *aux )
   if(r < 1) {
     tvherror(LS_TVHDHOMERUN, "failed to set target: %d", r);
     close(sockfd);
-    return NULL;
+    return -1;
   }
 
-  /* the poll set includes the sockfd and the pipe for IPC */
-  efd = tvhpoll_create(2);
-  tvhpoll_event(ev+0, sockfd, TVHPOLL_IN, hfe);
-  tvhpoll_event(ev+1, hfe->hf_input_thread_pipe.rd, TVHPOLL_IN,
-                &hfe->hf_input_thread_pipe);
-
-  r = tvhpoll_add(efd, ev, 2);
-  if(r < 0)
-    tvherror(LS_TVHDHOMERUN, "failed to setup poll");
-
-  sbuf_init_fixed(&sb, (20000000 / 8));
+  return sockfd;
+}
 
-  /* TODO: flush buffer? */
+/*
+ * Shared receive engine - all tuners' data sockets are serviced by one
+ * poll loop, so an idle or lightly loaded tuner does not cost its own
+ * thread and wakeups.  One would like to use libhdhomerun for the
+ * streaming details, but that library uses threads on its own and the
+ * socket is put into a ring buffer, so the UDP recv() is done here.
+ */
+static pthread_t                        tvhdhomerun_rx_tid;
+static tvhpoll_t                       *tvhdhomerun_rx_poll;
+static th_pipe_t                        tvhdhomerun_rx_pipe;
+static tvh_mutex_t                      tvhdhomerun_rx_lock = TVH_THREAD_MUTEX_INITIALIZER;
+static int                              tvhdhomerun_rx_started;
+static LIST_HEAD(,tvhdhomerun_frontend) tvhdhomerun_rx_frontends;
 
-  while(tvheadend_is_running()) {
-    nfds = tvhpoll_wait(efd, ev, 1, -1);
+static void *
+tvhdhomerun_rx_thread ( void *aux )
+{
+  tvhpoll_event_t ev[16];
+  tvhdhomerun_frontend_t *hfe;
+  int nfds, i, r;
+  char b;
 
+  while (tvheadend_is_running()) {
+    nfds = tvhpoll_wait(tvhdhomerun_rx_poll, ev, ARRAY_SIZE(ev), -1);
     if (nfds < 1) continue;
-    if (ev[0].ptr != hfe) break;
-
-    if((r = sbuf_read(&sb, sockfd)) < 0) {
-      /* whoopsy */
-      if(ERRNO_AGAIN(errno))
-        continue;
-      if(errno == EOVERFLOW) {
-        tvhwarn(LS_TVHDHOMERUN, "%s - read() EOVERFLOW", buf);
+    for (i = 0; i < nfds; i++) {
+      if (ev[i].ptr == &tvhdhomerun_rx_pipe) {
+        if (read(tvhdhomerun_rx_pipe.rd, &b, 1) > 0 && b != 'c')
+          return NULL;
         continue;
       }
-      tvherror(LS_TVHDHOMERUN, "%s - read() error %d (%s)",
-               buf, errno, strerror(errno));
-      break;
+      tvh_mutex_lock(&tvhdhomerun_rx_lock);
+      /* only trust the pointer while it is still on the list */
+      LIST_FOREACH(hfe, &tvhdhomerun_rx_frontends, hf_rx_link)
+        if (hfe == ev[i].ptr) break;
+      if (hfe) {
+        /* drain all queued datagrams, then deliver in one batch */
+        while ((r = sbuf_read(&hfe->hf_rx_sb, hfe->hf_rx_fd)) > 0)
+          if (hfe->hf_rx_sb.sb_ptr + 2048 > hfe->hf_rx_sb.sb_size)
+            break;
+        if (r < 0 && !ERRNO_AGAIN(errno)) {
+          if (errno == EOVERFLOW)
+            tvhwarn(LS_TVHDHOMERUN, "%s - read() EOVERFLOW", hfe->hf_rx_name);
+          else
+            tvherror(LS_TVHDHOMERUN, "%s - read() error %d (%s)",
+                     hfe->hf_rx_name, errno, strerror(errno));
+        }
+        if (hfe->hf_rx_sb.sb_ptr > 0)
+          mpegts_input_recv_packets(hfe->hf_rx_mmi, &hfe->hf_rx_sb, 0, NULL);
+      }
+      tvh_mutex_unlock(&tvhdhomerun_rx_lock);
     }
+  }
+  return NULL;
+}
 
-    //if(r != (7*188))
-      //continue; /* dude; this is not a valid packet */
-
-    //tvhdebug(LS_TVHDHOMERUN, "got r=%d (thats %d)", r, (r == 7*188));
+static int
+tvhdhomerun_rx_engine_start ( void )
+{
+  if (tvhdhomerun_rx_started)
+    return 0;
+  if (tvh_pipe(O_NONBLOCK, &tvhdhomerun_rx_pipe))
+    return -1;
+  tvhdhomerun_rx_poll = tvhpoll_create(16);
+  tvhpoll_add1(tvhdhomerun_rx_poll, tvhdhomerun_rx_pipe.rd, TVHPOLL_IN,
+               &tvhdhomerun_rx_pipe);
+  tvh_thread_create(&tvhdhomerun_rx_tid, NULL, tvhdhomerun_rx_thread,
+                    NULL, "hdhm-rx");
+  tvhdhomerun_rx_started = 1;
+  return 0;
+}
 
-    mpegts_input_recv_packets(mmi, &sb, 0, NULL);
-  }
+void
+tvhdhomerun_rx_engine_stop ( void )
+{
+  if (!tvhdhomerun_rx_started)
+    return;
+  tvh_write(tvhdhomerun_rx_pipe.wr, "", 1);
+  pthread_join(tvhdhomerun_rx_tid, NULL);
+  tvh_pipe_close(&tvhdhomerun_rx_pipe);
+  tvhpoll_destroy(tvhdhomerun_rx_poll);
+  tvhdhomerun_rx_poll = NULL;
+  tvhdhomerun_rx_started = 0;
+}
 
-  tvhdebug(LS_TVHDHOMERUN, "setting target to none");
-  tvh_mutex_lock(&hfe->hf_hdhomerun_device_mutex);
-  hdhomerun_device_set_tuner_target(hfe->hf_hdhomerun_tuner, "none");
-  hdhomerun_device_tuner_lockkey_release(hfe->hf_hdhomerun_tuner);
-  tvh_mutex_unlock(&hfe->hf_hdhomerun_device_mutex);
+static int
+tvhdhomerun_frontend_rx_register
+  ( tvhdhomerun_frontend_t *hfe, mpegts_mux_instance_t *mmi, int sockfd )
+{
+  tvh_mutex_lock(&tvhdhomerun_rx_lock);
+  if (tvhdhomerun_rx_engine_start()) {
+    tvh_mutex_unlock(&tvhdhomerun_rx_lock);
+    return -1;
+  }
+  hfe->hf_rx_fd  = sockfd;
+  hfe->hf_rx_mmi = mmi;
+  hfe->mi_display_name((mpegts_input_t*)hfe, hfe->hf_rx_name,
+                       sizeof(hfe->hf_rx_name));
+  sbuf_init_fixed(&hfe->hf_rx_sb, (20000000 / 8));
+  LIST_INSERT_HEAD(&tvhdhomerun_rx_frontends, hfe, hf_rx_link);
+  tvhpoll_add1(tvhdhomerun_rx_poll, sockfd, TVHPOLL_IN, hfe);
+  tvh_mutex_unlock(&tvhdhomerun_rx_lock);
+  return 0;
+}
 
-  sbuf_free(&sb);
-  tvhpoll_destroy(efd);
-  close(sockfd);
-  return NULL;
+static void
+tvhdhomerun_frontend_rx_unregister ( tvhdhomerun_frontend_t *hfe )
+{
+  tvh_mutex_lock(&tvhdhomerun_rx_lock);
+  if (hfe->hf_rx_fd >= 0) {
+    tvhpoll_rem1(tvhdhomerun_rx_poll, hfe->hf_rx_fd);
+    LIST_REMOVE(hfe, hf_rx_link);
+    close(hfe->hf_rx_fd);
+    hfe->hf_rx_fd  = -1;
+    hfe->hf_rx_mmi = NULL;
+    sbuf_free(&hfe->hf_rx_sb);
+  }
+  tvh_mutex_unlock(&tvhdhomerun_rx_lock);
 }
 
 static void
@@ -279,16 +336,11 @@ tvhdhomerun_frontend_monitor_cb( void *aux )
         sscanf(strstr(tuner_status.channel, ":"), ":%u", &lm->lm_tuning.dmc_fe_freq);
       }
 
-      /* start input thread */
-      tvh_pipe(O_NONBLOCK, &hfe->hf_input_thread_pipe);
-      tvh_mutex_lock(&hfe->hf_input_thread_mutex);
-      tvh_thread_create(&hfe->hf_input_thread, NULL, tvhdhomerun_frontend_input_thread, hfe, "hdhm-front");
-      do {
-        e = tvh_cond_wait(&hfe->hf_input_thread_cond, &hfe->hf_input_thread_mutex);
-        if (e == ETIMEDOUT)
-          break;
-      } while (ERRNO_AGAIN(e));
-      tvh_mutex_unlock(&hfe->hf_input_thread_mutex);
+      /* start streaming to the shared receive engine */
+      if ((e = tvhdhomerun_frontend_rx_open(hfe)) >= 0) {
+        if (tvhdhomerun_frontend_rx_register(hfe, mmi, e))
+          close(e);
+      }
 
       /* install table handlers */
       psi_tables_install(mmi->mmi_input, mm,
@@ -477,15 +529,10 @@ tvhdhomerun_frontend_stop_mux
   mpegts_mux_nice_name(mmi->mmi_mux, buf2, sizeof(buf2));
   tvhdebug(LS_TVHDHOMERUN, "%s - stopping %s", buf1, buf2);
 
-  /* join input thread */
-  if(hfe->hf_input_thread_pipe.wr > 0) {
-    tvh_write(hfe->hf_input_thread_pipe.wr, "", 1); // wake input thread
-    tvhtrace(LS_TVHDHOMERUN, "%s - waiting for input thread", buf1);
-    pthread_join(hfe->hf_input_thread, NULL);
-    tvh_pipe_close(&hfe->hf_input_thread_pipe);
-    tvhtrace(LS_TVHDHOMERUN, "%s - input thread stopped", buf1);
-  }
+  /* leave the shared receive engine */
+  tvhdhomerun_frontend_rx_unregister(hfe);
 
+  tvhdebug(LS_TVHDHOMERUN, "setting target to none");
   tvh_mutex_lock(&hfe->hf_hdhomerun_device_mutex);
   hdhomerun_device_set_tuner_target(hfe->hf_hdhomerun_tuner, "none");
   hdhomerun_device_tuner_lockkey_release(hfe->hf_hdhomerun_tuner);
@@ -778,7 +825,6 @@ tvhdhomerun_frontend_delete ( tvhdhomerun_frontend_t *hfe )
   /* Remove from adapter */
   TAILQ_REMOVE(&hfe->hf_device->hd_frontends, hfe, hf_link);
 
-  tvh_mutex_destroy(&hfe->hf_input_thread_mutex);
   tvh_mutex_destroy(&hfe->hf_hdhomerun_device_mutex);
 
   /* Finish */
@@ -824,8 +870,7 @@ tvhdhomerun_frontend_create(tvhdhomerun_device_t *hd, struct hdhomerun_discover_
 
   hfe->hf_hdhomerun_tuner = hdhomerun_device_create(discover_info->device_id, discover_info->ip_addr, frontend_number, hdhomerun_debug_obj);
 
-  hfe->hf_input_thread_running = 0;
-  hfe->hf_input_thread_terminating = 0;
+  hfe->hf_rx_fd = -1;
 
   hfe->hf_tunerNumber = frontend_number;
 
@@ -874,8 +919,6 @@ tvhdhomerun_frontend_create(tvhdhomerun_device_t *hd, struct hdhomerun_discover_
 
   /* mutex init */
   tvh_mutex_init(&hfe->hf_hdhomerun_device_mutex, NULL);
-  tvh_mutex_init(&hfe->hf_input_thread_mutex, NULL);
-  tvh_cond_init(&hfe->hf_input_thread_cond, 1);
 
   return hfe;
 }
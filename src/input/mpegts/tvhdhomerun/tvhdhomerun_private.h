@@ -96,13 +96,12 @@ struct tvhdhomerun_frontend
   int                            hf_ready;
   int                            hf_status;
 
-  // input thread..
-  pthread_t                      hf_input_thread;
-  tvh_mutex_t                    hf_input_thread_mutex;        /* used in condition signaling */
-  tvh_cond_t                     hf_input_thread_cond;         /* used in condition signaling */
-  th_pipe_t                      hf_input_thread_pipe;         /* IPC with input thread */
-  uint8_t                        hf_input_thread_running;      // Indicates if input_thread is running.
-  uint8_t                        hf_input_thread_terminating;  // Used for terminating the input_thread.
+  // shared receive engine membership
+  LIST_ENTRY(tvhdhomerun_frontend) hf_rx_link;
+  int                            hf_rx_fd;       /* data socket, -1 = not streaming */
+  sbuf_t                         hf_rx_sb;
+  mpegts_mux_instance_t         *hf_rx_mmi;
+  char                           hf_rx_name[128];
 
   // Global lock for the libhdhomerun library since it seems to have some threading-issues.
   tvh_mutex_t                    hf_hdhomerun_device_mutex;
@@ -132,6 +131,8 @@ tvhdhomerun_frontend_create( tvhdhomerun_device_t *hd, struct hdhomerun_discover
 
 void tvhdhomerun_frontend_delete ( tvhdhomerun_frontend_t *lfe );
 
+void tvhdhomerun_rx_engine_stop ( void );
+
 static inline void tvhdhomerun_device_changed ( tvhdhomerun_device_t *sd )
   { idnode_changed(&sd->th_id); }
 
@@ -7,18 +7,19 @@
 #include "intlconv.h"
 
 typedef struct intlconv_cache {
-  RB_ENTRY(intlconv_cache) ic_link;
+  struct intlconv_cache *ic_next;
   char    *ic_charset_id;
   iconv_t ic_handle;
+  int     ic_to_utf8;
 } intlconv_cache_t;
 
-static RB_HEAD(,intlconv_cache) intlconv_all;
-static intlconv_cache_t        *intlconv_last_ic;
-tvh_mutex_t                 intlconv_lock;
-
-static RB_HEAD(,intlconv_cache) intlconv_src_all;
-static intlconv_cache_t        *intlconv_last_src_ic;
-tvh_mutex_t                 intlconv_lock_src;
+/*
+ * The conversion descriptors are cached per thread - an iconv_t is
+ * not thread safe and each thread uses only a handful of charsets,
+ * so the EPG grabbers no longer serialize on a global lock
+ */
+static __thread intlconv_cache_t *intlconv_tls;
+static pthread_key_t              intlconv_tls_key;
 
 static inline size_t
 tvh_iconv(iconv_t cd, char **inbuf, size_t *inbytesleft,
@@ -27,6 +28,97 @@ tvh_iconv(iconv_t cd, char **inbuf, size_t *inbytesleft,
   return iconv(cd, inbuf, inbytesleft, outbuf, outbytesleft);
 }
 
+static void
+intlconv_tls_destroy( void *aux )
+{
+  intlconv_cache_t *ic = aux, *next;
+
+  for ( ; ic; ic = next) {
+    next = ic->ic_next;
+    iconv_close(ic->ic_handle);
+    free(ic->ic_charset_id);
+    free(ic);
+  }
+}
+
+static iconv_t
+intlconv_handle( const char *charset_id, int to_utf8 )
+{
+  intlconv_cache_t *ic, **prev;
+  iconv_t c;
+
+  for (prev = &intlconv_tls; (ic = *prev) != NULL; prev = &ic->ic_next)
+    if (ic->ic_to_utf8 == to_utf8 &&
+        strcmp(ic->ic_charset_id, charset_id) == 0) {
+      if (ic != intlconv_tls) {
+        *prev = ic->ic_next;
+        ic->ic_next = intlconv_tls;
+        intlconv_tls = ic;
+        pthread_setspecific(intlconv_tls_key, ic);
+      }
+      return ic->ic_handle;
+    }
+  c = to_utf8 ? iconv_open("UTF-8", charset_id) :
+                iconv_open(charset_id, "UTF-8");
+  if (c == (iconv_t)-1)
+    return c;
+  ic = malloc(sizeof(*ic));
+  if (ic == NULL) {
+    iconv_close(c);
+    return (iconv_t)-1;
+  }
+  ic->ic_charset_id = strdup(charset_id);
+  if (ic->ic_charset_id == NULL) {
+    free(ic);
+    iconv_close(c);
+    return (iconv_t)-1;
+  }
+  ic->ic_handle  = c;
+  ic->ic_to_utf8 = to_utf8;
+  ic->ic_next    = intlconv_tls;
+  intlconv_tls   = ic;
+  pthread_setspecific(intlconv_tls_key, ic);
+  return c;
+}
+
+/*
+ * Pure 7-bit input needs no conversion at all when the other charset
+ * is an ASCII superset (all DVB/EPG charsets in practice); scan eight
+ * bytes at a time for a high bit
+ */
+static int
+intlconv_is_ascii( const char *s, size_t len )
+{
+  uint64_t v;
+
+  for ( ; len >= sizeof(v); len -= sizeof(v), s += sizeof(v)) {
+    memcpy(&v, s, sizeof(v));
+    if (v & UINT64_C(0x8080808080808080))
+      return 0;
+  }
+  for ( ; len > 0; len--, s++)
+    if (*(const uint8_t *)s & 0x80)
+      return 0;
+  return 1;
+}
+
+static int
+intlconv_ascii_superset( const char *charset_id )
+{
+  return strncasecmp(charset_id, "ISO-8859-", 9) == 0 ||
+         strncasecmp(charset_id, "ISO8859-", 8) == 0 ||
+         strncasecmp(charset_id, "ISO_8859-", 9) == 0 ||
+         strncasecmp(charset_id, "ISO6937", 7) == 0 ||
+         strncasecmp(charset_id, "ISO_6937", 8) == 0 ||
+         strncasecmp(charset_id, "ASCII", 5) == 0 ||
+         strncasecmp(charset_id, "US-ASCII", 8) == 0 ||
+         strncasecmp(charset_id, "UTF-8", 5) == 0 ||
+         strncasecmp(charset_id, "UTF8", 4) == 0 ||
+         strncasecmp(charset_id, "WINDOWS-12", 10) == 0 ||
+         strncasecmp(charset_id, "CP12", 4) == 0 ||
+         strncasecmp(charset_id, "KOI8", 4) == 0;
+}
+
 static void
 intlconv_test( void )
 {
@@ -47,32 +139,19 @@ intlconv_test( void )
 void
 intlconv_init( void )
 {
-  tvh_mutex_init(&intlconv_lock, NULL);
-  tvh_mutex_init(&intlconv_lock_src, NULL);
+  pthread_key_create(&intlconv_tls_key, intlconv_tls_destroy);
   intlconv_test();
 }
 
 void
 intlconv_done( void )
 {
-  intlconv_cache_t *ic;
-
-  tvh_mutex_lock(&intlconv_lock);
-  intlconv_last_ic = NULL;
-  while ((ic = RB_FIRST(&intlconv_all)) != NULL) {
-    iconv_close(ic->ic_handle);
-    free(ic->ic_charset_id);
-    RB_REMOVE(&intlconv_all, ic, ic_link);
-    free(ic);
-  }
-  intlconv_last_src_ic = NULL;
-  while ((ic = RB_FIRST(&intlconv_src_all)) != NULL) {
-    iconv_close(ic->ic_handle);
-    free(ic->ic_charset_id);
-    RB_REMOVE(&intlconv_src_all, ic, ic_link);
-    free(ic);
-  }
-  tvh_mutex_unlock(&intlconv_lock);
+  /* the workers free their own caches on thread exit,
+   * only the caller's cache is reachable here */
+  intlconv_tls_destroy(intlconv_tls);
+  intlconv_tls = NULL;
+  pthread_setspecific(intlconv_tls_key, NULL);
+  pthread_key_delete(intlconv_tls_key);
 }
 
 const char *
@@ -85,12 +164,6 @@ intlconv_filesystem_charset( void )
   return "ASCII";
 }
 
-static int
-intlconv_cmp ( intlconv_cache_t *a, intlconv_cache_t *b )
-{
-  return strcmp(a->ic_charset_id, b->ic_charset_id);
-}
-
 char *
 intlconv_charset_id( const char *charset,
                      int transil,
@@ -121,53 +194,30 @@ intlconv_utf8( char *dst, size_t dst_size,
                const char *dst_charset_id,
                const char *src_utf8 )
 {
-  intlconv_cache_t templ, *ic;
   char **inbuf, **outbuf;
   size_t inbuf_left, outbuf_left;
   ssize_t res;
+  iconv_t c;
 
   if (dst_charset_id == NULL) {
     strlcpy(dst, src_utf8, dst_size);
     return strlen(dst);
   }
-  templ.ic_charset_id = (char *)dst_charset_id;
-  tvh_mutex_lock(&intlconv_lock);
-  if (intlconv_last_ic &&
-      strcmp(intlconv_last_ic->ic_charset_id, dst_charset_id) == 0) {
-    ic = intlconv_last_ic;
-    goto found;
+  inbuf_left = strlen(src_utf8);
+  if (intlconv_ascii_superset(dst_charset_id) &&
+      intlconv_is_ascii(src_utf8, inbuf_left)) {
+    if (inbuf_left > dst_size)
+      return -E2BIG;
+    memcpy(dst, src_utf8, inbuf_left);
+    return inbuf_left;
   }
-  ic = RB_FIND(&intlconv_all, &templ, ic_link, intlconv_cmp);
-  if (!ic) {
-    iconv_t c = iconv_open(dst_charset_id, "UTF-8");
-    if ((iconv_t)-1 == c) {
-      tvh_mutex_unlock(&intlconv_lock);
-      return -EIO;
-    }
-    ic = malloc(sizeof(*ic));
-    if (ic == NULL) {
-      tvh_mutex_unlock(&intlconv_lock);
-      iconv_close(c);
-      return -ENOMEM;
-    }
-    ic->ic_charset_id = strdup(dst_charset_id);
-    if (ic->ic_charset_id == NULL) {
-      tvh_mutex_unlock(&intlconv_lock);
-      free(ic);
-      iconv_close(c);
-      return -ENOMEM;
-    }
-    ic->ic_handle = c;
-    RB_INSERT_SORTED(&intlconv_all, ic, ic_link, intlconv_cmp);
-  }
-  intlconv_last_ic = ic;
-found:
-  tvh_mutex_unlock(&intlconv_lock);
+  c = intlconv_handle(dst_charset_id, 0);
+  if ((iconv_t)-1 == c)
+    return -EIO;
   inbuf       = (char **)&src_utf8;
-  inbuf_left  = strlen(src_utf8);
   outbuf      = &dst;
   outbuf_left = dst_size;
-  res = tvh_iconv(ic->ic_handle, inbuf, &inbuf_left, outbuf, &outbuf_left);
+  res = tvh_iconv(c, inbuf, &inbuf_left, outbuf, &outbuf_left);
   if (res == -1)
     res = -errno;
   if (res >= 0)
@@ -209,53 +259,30 @@ intlconv_to_utf8( char *dst, size_t dst_size,
                   const char *src_charset_id,
                   const char *src, size_t src_size )
 {
-  intlconv_cache_t templ, *ic;
   char **inbuf, **outbuf;
   size_t inbuf_left, outbuf_left;
   ssize_t res;
+  iconv_t c;
 
   if (src_charset_id == NULL) {
     strlcpy(dst, src, dst_size);
     return strlen(dst);
   }
-  templ.ic_charset_id = (char *)src_charset_id;
-  tvh_mutex_lock(&intlconv_lock_src);
-  if (intlconv_last_src_ic &&
-      strcmp(intlconv_last_src_ic->ic_charset_id, src_charset_id) == 0) {
-    ic = intlconv_last_src_ic;
-    goto found;
-  }
-  ic = RB_FIND(&intlconv_src_all, &templ, ic_link, intlconv_cmp);
-  if (!ic) {
-    iconv_t c = iconv_open("UTF-8", src_charset_id);
-    if ((iconv_t)-1 == c) {
-      tvh_mutex_unlock(&intlconv_lock_src);
-      return -EIO;
-    }
-    ic = malloc(sizeof(*ic));
-    if (ic == NULL) {
-      tvh_mutex_unlock(&intlconv_lock_src);
-      iconv_close(c);
-      return -ENOMEM;
-    }
-    ic->ic_charset_id = strdup(src_charset_id);
-    if (ic->ic_charset_id == NULL) {
-      tvh_mutex_unlock(&intlconv_lock_src);
-      free(ic);
-      iconv_close(c);
-      return -ENOMEM;
-    }
-    ic->ic_handle = c;
-    RB_INSERT_SORTED(&intlconv_src_all, ic, ic_link, intlconv_cmp);
+  if (intlconv_ascii_superset(src_charset_id) &&
+      intlconv_is_ascii(src, src_size)) {
+    if (src_size > dst_size)
+      return -E2BIG;
+    memcpy(dst, src, src_size);
+    return src_size;
   }
-  intlconv_last_src_ic = ic;
-found:
-  tvh_mutex_unlock(&intlconv_lock_src);
+  c = intlconv_handle(src_charset_id, 1);
+  if ((iconv_t)-1 == c)
+    return -EIO;
   inbuf       = (char **)&src;
   inbuf_left  = src_size;
   outbuf      = &dst;
   outbuf_left = dst_size;
-  res = tvh_iconv(ic->ic_handle, inbuf, &inbuf_left, outbuf, &outbuf_left);
+  res = tvh_iconv(c, inbuf, &inbuf_left, outbuf, &outbuf_left);
   if (res == -1)
     res = -errno;
   if (res >= 0)
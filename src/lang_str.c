@@ -16,6 +16,7 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include "lang_codes.h"
 #include "lang_str.h"
 #include "tvheadend.h"
+#include "memoryinfo.h"
 
 #define LANG_STR_ADD    0
 #define LANG_STR_UPDATE 1
@@ -364,3 +366,97 @@ size_t lang_str_size(const lang_str_t *ls)
   }
   return size;
 }
+
+/* ************************************************************************
+ * Interned strings
+ *
+ * Refcounted pool of immutable lang_str instances; identical contents
+ * (duplicate series titles etc.) are stored once and shared. Strings
+ * obtained from lang_str_intern() must not be modified and are freed
+ * with lang_str_release().
+ * ***********************************************************************/
+
+typedef struct lang_str_intern_ele
+{
+  RB_ENTRY(lang_str_intern_ele) link;
+  uint32_t    hash;
+  uint32_t    refcount;
+  lang_str_t *ls;
+} lang_str_intern_ele_t;
+
+static RB_HEAD(, lang_str_intern_ele) lang_str_intern_pool;
+static tvh_mutex_t lang_str_intern_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static memoryinfo_t lang_str_intern_memoryinfo = {
+  .my_name = "Interned EPG strings"
+};
+
+/* Languages are deliberately excluded from the hash: lang_str_compare()
+ * falls back to the first string when a language is missing, so objects
+ * it considers equal may differ in language codes but not in strings */
+static uint32_t _lang_str_intern_hash ( const lang_str_t *ls )
+{
+  lang_str_ele_t *e;
+  uint32_t crc = 0xffffffff;
+  RB_FOREACH(e, ls, link)
+    crc = tvh_crc32((const uint8_t *)e->str, strlen(e->str) + 1, crc);
+  return crc;
+}
+
+static int _lang_str_intern_cmp ( void *a, void *b )
+{
+  lang_str_intern_ele_t *A = a, *B = b;
+  if (A->hash != B->hash)
+    return A->hash < B->hash ? -1 : 1;
+  return lang_str_compare(A->ls, B->ls);
+}
+
+/* Get a shared reference for the given contents */
+lang_str_t *lang_str_intern ( const lang_str_t *ls )
+{
+  lang_str_intern_ele_t *e, skel;
+
+  if (ls == NULL) return NULL;
+  skel.hash = _lang_str_intern_hash(ls);
+  skel.ls   = (lang_str_t *)ls;
+  tvh_mutex_lock(&lang_str_intern_mutex);
+  e = RB_FIND(&lang_str_intern_pool, &skel, link, _lang_str_intern_cmp);
+  if (e) {
+    e->refcount++;
+  } else {
+    e = malloc(sizeof(*e));
+    e->hash     = skel.hash;
+    e->refcount = 1;
+    e->ls       = lang_str_copy(ls);
+    RB_INSERT_SORTED(&lang_str_intern_pool, e, link, _lang_str_intern_cmp);
+    memoryinfo_alloc(&lang_str_intern_memoryinfo,
+                     sizeof(*e) + lang_str_size(e->ls));
+  }
+  tvh_mutex_unlock(&lang_str_intern_mutex);
+  return e->ls;
+}
+
+/* Release a reference obtained from lang_str_intern() */
+void lang_str_release ( lang_str_t *ls )
+{
+  lang_str_intern_ele_t *e, skel;
+
+  if (ls == NULL) return;
+  skel.hash = _lang_str_intern_hash(ls);
+  skel.ls   = ls;
+  tvh_mutex_lock(&lang_str_intern_mutex);
+  e = RB_FIND(&lang_str_intern_pool, &skel, link, _lang_str_intern_cmp);
+  assert(e && e->ls == ls);
+  if (--e->refcount == 0) {
+    RB_REMOVE(&lang_str_intern_pool, e, link);
+    memoryinfo_free(&lang_str_intern_memoryinfo,
+                    sizeof(*e) + lang_str_size(e->ls));
+    lang_str_destroy(e->ls);
+    free(e);
+  }
+  tvh_mutex_unlock(&lang_str_intern_mutex);
+}
+
+void lang_str_intern_init ( void )
+{
+  memoryinfo_register(&lang_str_intern_memoryinfo);
+}
@@ -87,4 +87,9 @@ static inline int lang_str_empty(lang_str_t* str)
 /* Size in bytes */
 size_t          lang_str_size ( const lang_str_t *ls );
 
+/* Interned (refcounted, shared) strings */
+lang_str_t     *lang_str_intern  ( const lang_str_t *ls );
+void            lang_str_release ( lang_str_t *ls );
+void            lang_str_intern_init ( void );
+
 #endif /* __TVH_LANG_STR_H__ */
@@ -78,6 +78,7 @@
 #include "memoryinfo.h"
 #include "watchdog.h"
 #include "tprofile.h"
+#include "tsbench.h"
 #if CONFIG_LINUXDVB_CA
 #include "input/mpegts/en50221/en50221.h"
 #endif
@@ -188,22 +189,73 @@ tvh_mutex_t atomic_lock;
 /*
  * Locals
  */
-static LIST_HEAD(, mtimer) mtimers;
+static struct tvh_wheel mtimer_wheel;
 static tvh_cond_t mtimer_cond;
 static mtimer_t *mtimer_running;
 static int64_t mtimer_periodic;
 static pthread_t mtimer_tid;
 static pthread_t mtimer_tick_tid;
 static tprofile_t mtimer_profile;
-static LIST_HEAD(, gtimer) gtimers;
+static struct tvh_wheel gtimer_wheel;
 static gtimer_t *gtimer_running;
 static tvh_cond_t gtimer_cond;
 static tprofile_t gtimer_profile;
+#define TASKLET_THREADS 4
 static TAILQ_HEAD(, tasklet) tasklets;
 static tvh_cond_t tasklet_cond;
-static pthread_t tasklet_tid;
+static pthread_t tasklet_tid[TASKLET_THREADS];
 static memoryinfo_t tasklet_memoryinfo = { .my_name = "Tasklet" };
 
+/**
+ * Startup phase timing - filled once by the serial init sequence in
+ * main() and read-only afterwards, so API readers need no locking
+ */
+#define INIT_PHASE_MAX 64
+static struct {
+  const char *name;
+  int64_t offset;   /* microseconds since the init sequence started */
+  int64_t duration;
+} init_phase[INIT_PHASE_MAX];
+static int init_phase_count;
+static int64_t init_phase_start, init_phase_total;
+
+static void
+init_phase_record(const char *name, int64_t start, int64_t end)
+{
+  if (init_phase_count >= INIT_PHASE_MAX)
+    return;
+  init_phase[init_phase_count].name = name;
+  init_phase[init_phase_count].offset = start - init_phase_start;
+  init_phase[init_phase_count].duration = end - start;
+  init_phase_count++;
+}
+
+#define tvhfinit(fcn, ...) do { \
+  int64_t _tstart = getmonoclock(); \
+  tvhtrace(LS_MAIN, "%s() enter", #fcn); \
+  fcn(__VA_ARGS__); \
+  tvhtrace(LS_MAIN, "%s() leave", #fcn); \
+  init_phase_record(#fcn, _tstart, getmonoclock()); \
+} while (0)
+
+htsmsg_t *
+tvh_startup_phases_msg(void)
+{
+  htsmsg_t *m = htsmsg_create_map(), *l = htsmsg_create_list(), *e;
+  int i;
+
+  htsmsg_add_s64(m, "total_us", init_phase_total);
+  for (i = 0; i < init_phase_count; i++) {
+    e = htsmsg_create_map();
+    htsmsg_add_str(e, "name",        init_phase[i].name);
+    htsmsg_add_s64(e, "offset_us",   init_phase[i].offset);
+    htsmsg_add_s64(e, "duration_us", init_phase[i].duration);
+    htsmsg_add_msg(l, NULL, e);
+  }
+  htsmsg_add_msg(m, "phases", l);
+  return m;
+}
+
 static void
 handle_sigpipe(int x)
 {
@@ -253,12 +305,167 @@ get_user_groups (const struct passwd *pw, gid_t* glist, size_t gmax)
  *
  */
 
-#define safecmp(a, b) ((a) > (b) ? 1 : ((a) < (b) ? -1 : 0))
+/**
+ * Hierarchical timing wheel shared by the monotonic and wall-clock
+ * timers.  Arm hashes the expiry tick into one of the level slots and
+ * disarm unlinks in place, so both are O(1) regardless of how many
+ * timers are pending; due slots are swept onto the expired list as the
+ * dispatcher advances.  Ticks are ~1ms for mtimers and 1s for gtimers,
+ * giving the five 64-slot levels a horizon of roughly 12 days and
+ * 34 years respectively; anything beyond parks on the overflow list
+ * and is re-hashed on the next sweep.
+ */
+
+#define TWHEEL_BITS   6
+#define TWHEEL_SLOTS  (1 << TWHEEL_BITS)
+#define TWHEEL_MASK   (TWHEEL_SLOTS - 1)
+#define TWHEEL_LEVELS 5
+
+#define MTIMER_TICK_SHIFT 10 /* 1.024ms per tick */
+
+struct tvh_wheel {
+  uint64_t cur;       /* last swept tick */
+  uint64_t next_wake; /* tick the dispatcher sleeps until, 0 = unknown */
+  struct tvh_wheel_list slots[TWHEEL_LEVELS][TWHEEL_SLOTS];
+  struct tvh_wheel_list expired;
+  struct tvh_wheel_list overflow;
+};
+
+static void
+tvh_wheel_init(struct tvh_wheel *w, uint64_t now)
+{
+  int lvl, i;
+
+  w->cur = now;
+  w->next_wake = 0;
+  for (lvl = 0; lvl < TWHEEL_LEVELS; lvl++)
+    for (i = 0; i < TWHEEL_SLOTS; i++)
+      TAILQ_INIT(&w->slots[lvl][i]);
+  TAILQ_INIT(&w->expired);
+  TAILQ_INIT(&w->overflow);
+}
+
+static void
+tvh_wheel_remove(tvh_wheel_node_t *n)
+{
+  TAILQ_REMOVE(n->twn_head, n, twn_link);
+  n->twn_head = NULL;
+}
+
+static void
+tvh_wheel_link(struct tvh_wheel_list *head, tvh_wheel_node_t *n)
+{
+  TAILQ_INSERT_TAIL(head, n, twn_link);
+  n->twn_head = head;
+}
+
+static void
+tvh_wheel_insert(struct tvh_wheel *w, tvh_wheel_node_t *n)
+{
+  uint64_t ticks = n->twn_ticks;
+  int lvl, shift;
+
+  if (ticks <= w->cur)
+    ticks = w->cur + 1;
+  for (lvl = 0; lvl < TWHEEL_LEVELS; lvl++) {
+    shift = lvl * TWHEEL_BITS;
+    if ((ticks >> shift) - (w->cur >> shift) < TWHEEL_SLOTS) {
+      tvh_wheel_link(&w->slots[lvl][(ticks >> shift) & TWHEEL_MASK], n);
+      return;
+    }
+  }
+  tvh_wheel_link(&w->overflow, n);
+}
+
+/* Sweep due slots onto the expired list, cascading the higher levels
+   down on their window boundaries */
+static void
+tvh_wheel_advance(struct tvh_wheel *w, uint64_t now)
+{
+  tvh_wheel_node_t *n, *next;
+  int lvl, shift;
+
+  /* A large clock jump (settime/NTP on the wall-clock wheel) is
+     cheaper to handle by re-hashing every pending timer than by
+     sweeping millions of empty ticks */
+  if (now > w->cur && now - w->cur > (1ULL << (2 * TWHEEL_BITS))) {
+    struct tvh_wheel_list pending;
+    int i;
+
+    TAILQ_INIT(&pending);
+    for (lvl = 0; lvl < TWHEEL_LEVELS; lvl++)
+      for (i = 0; i < TWHEEL_SLOTS; i++)
+        while ((n = TAILQ_FIRST(&w->slots[lvl][i])) != NULL) {
+          tvh_wheel_remove(n);
+          tvh_wheel_link(&pending, n);
+        }
+    while ((n = TAILQ_FIRST(&w->overflow)) != NULL) {
+      tvh_wheel_remove(n);
+      tvh_wheel_link(&pending, n);
+    }
+    w->cur = now;
+    while ((n = TAILQ_FIRST(&pending)) != NULL) {
+      tvh_wheel_remove(n);
+      if (n->twn_ticks <= now)
+        tvh_wheel_link(&w->expired, n);
+      else
+        tvh_wheel_insert(w, n);
+    }
+    return;
+  }
+
+  while (w->cur < now) {
+    w->cur++;
+    for (lvl = 1; lvl < TWHEEL_LEVELS; lvl++) {
+      shift = lvl * TWHEEL_BITS;
+      if (w->cur & ((1ULL << shift) - 1))
+        break;
+      while ((n = TAILQ_FIRST(&w->slots[lvl][(w->cur >> shift) & TWHEEL_MASK])) != NULL) {
+        tvh_wheel_remove(n);
+        tvh_wheel_insert(w, n);
+      }
+    }
+    while ((n = TAILQ_FIRST(&w->slots[0][w->cur & TWHEEL_MASK])) != NULL) {
+      tvh_wheel_remove(n);
+      tvh_wheel_link(&w->expired, n);
+    }
+  }
+
+  /* Re-hash parked far-future timers that drifted inside the horizon */
+  shift = (TWHEEL_LEVELS - 1) * TWHEEL_BITS;
+  for (n = TAILQ_FIRST(&w->overflow); n != NULL; n = next) {
+    next = TAILQ_NEXT(n, twn_link);
+    if ((n->twn_ticks >> shift) - (w->cur >> shift) < TWHEEL_SLOTS) {
+      tvh_wheel_remove(n);
+      tvh_wheel_insert(w, n);
+    }
+  }
+}
 
+/* Next wakeup tick: exact for level 0, window start for higher levels
+   (the dispatcher re-checks after the cascade, so waking at a window
+   boundary refines the estimate for free) */
 static int
-mtimercmp(mtimer_t *a, mtimer_t *b)
+tvh_wheel_next(struct tvh_wheel *w, uint64_t *ticks)
 {
-  return safecmp(a->mti_expire, b->mti_expire);
+  int lvl, shift, i;
+  uint64_t s;
+
+  for (lvl = 0; lvl < TWHEEL_LEVELS; lvl++) {
+    shift = lvl * TWHEEL_BITS;
+    for (i = 1; i < TWHEEL_SLOTS; i++) {
+      s = (w->cur >> shift) + i;
+      if (!TAILQ_EMPTY(&w->slots[lvl][s & TWHEEL_MASK])) {
+        *ticks = s << shift;
+        return 1;
+      }
+    }
+  }
+  if (!TAILQ_EMPTY(&w->overflow)) {
+    *ticks = w->cur + (1ULL << ((TWHEEL_LEVELS - 1) * TWHEEL_BITS));
+    return 1;
+  }
+  return 0;
 }
 
 #if ENABLE_TRACE
@@ -287,7 +494,7 @@ GTIMER_FCN(mtimer_arm_abs)
 
   if (mti->mti_callback != NULL) {
     mtimer_magic_check(mti);
-    LIST_REMOVE(mti, mti_link);
+    tvh_wheel_remove(&mti->mti_node);
   }
 
 #if ENABLE_TRACE
@@ -300,9 +507,13 @@ GTIMER_FCN(mtimer_arm_abs)
   mti->mti_id       = id;
 #endif
 
-  LIST_INSERT_SORTED(&mtimers, mti, mti_link, mtimercmp);
+  /* round up so a timer never fires before its expiry */
+  mti->mti_node.twn_ticks =
+    ((uint64_t)when + (1 << MTIMER_TICK_SHIFT) - 1) >> MTIMER_TICK_SHIFT;
+  tvh_wheel_insert(&mtimer_wheel, &mti->mti_node);
 
-  if (LIST_FIRST(&mtimers) == mti)
+  if (mtimer_wheel.next_wake == 0 ||
+      mti->mti_node.twn_ticks < mtimer_wheel.next_wake)
     tvh_cond_signal(&mtimer_cond, 0); // force timer re-check
 
   tvh_mutex_unlock(&mtimer_lock);
@@ -334,7 +545,7 @@ mtimer_disarm(mtimer_t *mti)
     mtimer_running = NULL;
   if (mti->mti_callback) {
     mtimer_magic_check(mti);
-    LIST_REMOVE(mti, mti_link);
+    tvh_wheel_remove(&mti->mti_node);
     mti->mti_callback = NULL;
   }
   tvh_mutex_unlock(&mtimer_lock);
@@ -343,12 +554,6 @@ mtimer_disarm(mtimer_t *mti)
 /**
  *
  */
-static int
-gtimercmp(gtimer_t *a, gtimer_t *b)
-{
-  return safecmp(a->gti_expire, b->gti_expire);
-}
-
 #if ENABLE_TRACE
 static void gtimer_magic_check(gtimer_t *gti)
 {
@@ -375,7 +580,7 @@ GTIMER_FCN(gtimer_arm_absn)
 
   if (gti->gti_callback != NULL) {
     gtimer_magic_check(gti);
-    LIST_REMOVE(gti, gti_link);
+    tvh_wheel_remove(&gti->gti_node);
   }
 
 #if ENABLE_TRACE
@@ -388,9 +593,11 @@ GTIMER_FCN(gtimer_arm_absn)
   gti->gti_id       = id;
 #endif
 
-  LIST_INSERT_SORTED(&gtimers, gti, gti_link, gtimercmp);
+  gti->gti_node.twn_ticks = (uint64_t)when;
+  tvh_wheel_insert(&gtimer_wheel, &gti->gti_node);
 
-  if (LIST_FIRST(&gtimers) == gti)
+  if (gtimer_wheel.next_wake == 0 ||
+      gti->gti_node.twn_ticks < gtimer_wheel.next_wake)
     tvh_cond_signal(&gtimer_cond, 0); // force timer re-check
 
   tvh_mutex_unlock(&gtimer_lock);
@@ -422,7 +629,7 @@ gtimer_disarm(gtimer_t *gti)
     gtimer_running = NULL;
   if (gti->gti_callback) {
     gtimer_magic_check(gti);
-    LIST_REMOVE(gti, gti_link);
+    tvh_wheel_remove(&gti->gti_node);
     gti->gti_callback = NULL;
   }
   tvh_mutex_unlock(&gtimer_lock);
@@ -459,8 +666,8 @@ tasklet_arm(tasklet_t *tsk, tsk_callback_t *callback, void *opaque)
 
   TAILQ_INSERT_TAIL(&tasklets, tsk, tsk_link);
 
-  if (TAILQ_FIRST(&tasklets) == tsk)
-    tvh_cond_signal(&tasklet_cond, 0);
+  /* one wakeup per queued tasklet - any idle pool thread may pick it up */
+  tvh_cond_signal(&tasklet_cond, 0);
 
   tvh_mutex_unlock(&tasklet_lock);
 }
@@ -680,14 +887,22 @@ mtimer_thread(void *aux)
     next = now + sec2mono(3600);
 
     while (1) {
+      uint64_t nticks;
+      tvh_wheel_node_t *node;
+
       tvh_mutex_lock(&mtimer_lock);
-      mti = LIST_FIRST(&mtimers);
-      if (mti == NULL || mti->mti_expire > now) {
-        if (mti)
-          next = mti->mti_expire;
+      mtimer_wheel.next_wake = 0;
+      tvh_wheel_advance(&mtimer_wheel, (uint64_t)now >> MTIMER_TICK_SHIFT);
+      node = TAILQ_FIRST(&mtimer_wheel.expired);
+      if (node == NULL) {
+        if (tvh_wheel_next(&mtimer_wheel, &nticks)) {
+          next = nticks << MTIMER_TICK_SHIFT;
+          mtimer_wheel.next_wake = nticks;
+        }
         tvh_mutex_unlock(&mtimer_lock);
         break;
       }
+      mti = (mtimer_t *)node;
 
 #if ENABLE_GTIMER_CHECK
       id = mti->mti_id;
@@ -695,7 +910,7 @@ mtimer_thread(void *aux)
       id = NULL;
 #endif
       cb = mti->mti_callback;
-      LIST_REMOVE(mti, mti_link);
+      tvh_wheel_remove(node);
       mti->mti_callback = NULL;
 
       mtimer_running = mti;
@@ -742,14 +957,22 @@ mainloop(void)
     ts.tv_nsec = 0;
 
     while (1) {
+      uint64_t nticks;
+      tvh_wheel_node_t *node;
+
       tvh_mutex_lock(&gtimer_lock);
-      gti = LIST_FIRST(&gtimers);
-      if (gti == NULL || gti->gti_expire > now) {
-        if (gti)
-          ts.tv_sec = gti->gti_expire;
+      gtimer_wheel.next_wake = 0;
+      tvh_wheel_advance(&gtimer_wheel, (uint64_t)now);
+      node = TAILQ_FIRST(&gtimer_wheel.expired);
+      if (node == NULL) {
+        if (tvh_wheel_next(&gtimer_wheel, &nticks)) {
+          ts.tv_sec = nticks;
+          gtimer_wheel.next_wake = nticks;
+        }
         tvh_mutex_unlock(&gtimer_lock);
         break;
       }
+      gti = (gtimer_t *)node;
 
 #if ENABLE_GTIMER_CHECK
       id = gti->gti_id;
@@ -757,7 +980,7 @@ mainloop(void)
       id = NULL;
 #endif
       cb = gti->gti_callback;
-      LIST_REMOVE(gti, gti_link);
+      tvh_wheel_remove(node);
       gti->gti_callback = NULL;
       gtimer_running = gti;
       tvh_mutex_unlock(&gtimer_lock);
@@ -785,7 +1008,7 @@ mainloop(void)
 int
 main(int argc, char **argv)
 {
-  int i;
+  int i, j;
   sigset_t set;
 #if ENABLE_MPEGTS
   uint32_t adapter_mask = 0;
@@ -819,6 +1042,8 @@ main(int argc, char **argv)
   tvh_cond_init(&mtimer_cond, 1);
   tvh_cond_init(&gtimer_cond, 0);
   tvh_cond_init(&tasklet_cond, 1);
+  tvh_wheel_init(&mtimer_wheel, (uint64_t)getmonoclock() >> MTIMER_TICK_SHIFT);
+  tvh_wheel_init(&gtimer_wheel, (uint64_t)time(NULL));
   TAILQ_INIT(&tasklets);
 
   /* Defaults */
@@ -858,6 +1083,7 @@ main(int argc, char **argv)
               opt_nobat        = 0,
               opt_subsystems   = 0,
               opt_tprofile     = 0,
+              opt_tsbench      = 0,
               opt_thread_debug = 0;
   const char *opt_config       = NULL,
              *opt_user         = NULL,
@@ -872,6 +1098,7 @@ main(int argc, char **argv)
              *opt_bindaddr     = NULL,
              *opt_subscribe    = NULL,
              *opt_user_agent   = NULL,
+             *opt_tsbench_file = NULL,
              *opt_satip_bindaddr = NULL;
   static char *__opt_satip_xml[10];
   str_list_t  opt_satip_xml    = { .max = 10, .num = 0, .str = __opt_satip_xml };
@@ -972,6 +1199,8 @@ main(int argc, char **argv)
 #endif
 
     { 0, "tprofile", N_("Gather timing statistics for the code"), OPT_BOOL, &opt_tprofile },
+    { 0, "tsbench", N_("Run the synthetic TS parser benchmark and exit"), OPT_INT, &opt_tsbench },
+    { 0, "tsbenchfile", N_("Run the parser/muxer benchmark over a TS capture and exit"), OPT_STR, &opt_tsbench_file },
 #if ENABLE_TRACE
     { 0, "thrdebug", N_("Thread debugging"), OPT_INT, &opt_thread_debug },
 #endif
@@ -1111,12 +1340,22 @@ main(int argc, char **argv)
     log_debug  = opt_log_debug;
 
   tvh_thread_init(opt_thread_debug);
+  tvh_mutex_prof_register(&global_lock, "global");
+  tvh_mutex_gate_arm(&global_lock);
 
   tvhlog_init(log_level, log_options, opt_logpath);
   tvhlog_set_debug(log_debug);
   tvhlog_set_trace(log_trace);
   tvhinfo(LS_MAIN, "Log started");
 
+  if (opt_tsbench || opt_tsbench_file) {
+    if (opt_tsbench)
+      tsbench_run(opt_tsbench);
+    if (opt_tsbench_file)
+      tsbench_file_run(opt_tsbench_file);
+    return 0;
+  }
+
   tvh_signal(SIGPIPE, handle_sigpipe); // will be redundant later
   tvh_signal(SIGILL, handle_sigill);   // see handler..
 
@@ -1259,10 +1498,11 @@ main(int argc, char **argv)
   RAND_seed(&randseed, sizeof(randseed));
 
   /* Initialise configuration */
-  tvhftrace(LS_MAIN, notify_init);
-  tvhftrace(LS_MAIN, spawn_init);
-  tvhftrace(LS_MAIN, idnode_init);
-  tvhftrace(LS_MAIN, config_init, opt_nobackup == 0);
+  init_phase_start = getmonoclock();
+  tvhfinit(notify_init);
+  tvhfinit(spawn_init);
+  tvhfinit(idnode_init);
+  tvhfinit(config_init, opt_nobackup == 0);
 
   /* Memoryinfo */
   idclass_register(&memoryinfo_class);
@@ -1274,6 +1514,8 @@ main(int argc, char **argv)
   memoryinfo_register(&pkt_memoryinfo);
   memoryinfo_register(&pktbuf_memoryinfo);
   memoryinfo_register(&pktref_memoryinfo);
+  memoryinfo_register(&sbuf_memoryinfo);
+  pktbuf_init();
 
   /**
    * Initialize subsystems
@@ -1283,76 +1525,89 @@ main(int argc, char **argv)
 
   tvh_thread_create(&mtimer_tick_tid, NULL, mtimer_tick_thread, NULL, "mtick");
   tvh_thread_create(&mtimer_tid, NULL, mtimer_thread, NULL, "mtimer");
-  tvh_thread_create(&tasklet_tid, NULL, tasklet_thread, NULL, "tasklet");
+  for (i = 0; i < TASKLET_THREADS; i++) {
+    snprintf(buf, sizeof(buf), "tasklet%d", i + 1);
+    tvh_thread_create(&tasklet_tid[i], NULL, tasklet_thread, NULL, buf);
+  }
 
 #if CONFIG_LINUXDVB_CA
   en50221_register_apps();
 #endif
 
-  tvhftrace(LS_MAIN, streaming_init);
-  tvhftrace(LS_MAIN, tvh_hardware_init);
-  tvhftrace(LS_MAIN, dbus_server_init, opt_dbus, opt_dbus_session);
-  tvhftrace(LS_MAIN, intlconv_init);
-  tvhftrace(LS_MAIN, api_init);
-  tvhftrace(LS_MAIN, fsmonitor_init);
-  tvhftrace(LS_MAIN, libav_init);
-  tvhftrace(LS_MAIN, tvhtime_init);
+  tvhfinit(streaming_init);
+  tvhfinit(tvh_hardware_init);
+  tvhfinit(dbus_server_init, opt_dbus, opt_dbus_session);
+  tvhfinit(intlconv_init);
+  tvhfinit(api_init);
+  tvhfinit(fsmonitor_init);
+  tvhfinit(libav_init);
+  tvhfinit(tvhtime_init);
 #if ENABLE_VAAPI
-  tvhftrace(LS_MAIN, codec_init, vainfo_probe_enabled);
+  tvhfinit(codec_init, vainfo_probe_enabled);
 #else
-  tvhftrace(LS_MAIN, codec_init);
+  tvhfinit(codec_init);
 #endif
-  tvhftrace(LS_MAIN, profile_init);
-  tvhftrace(LS_MAIN, imagecache_init);
-  tvhftrace(LS_MAIN, http_client_init);
-  tvhftrace(LS_MAIN, esfilter_init);
-  tvhftrace(LS_MAIN, bouquet_init);
-  tvhftrace(LS_MAIN, ratinglabel_init);
-  tvhftrace(LS_MAIN, service_init);
-  tvhftrace(LS_MAIN, descrambler_init);
-  tvhftrace(LS_MAIN, dvb_init);
+  tvhfinit(profile_init);
+  tvhfinit(imagecache_init);
+  tvhfinit(http_client_init);
+  tvhfinit(esfilter_init);
+  tvhfinit(bouquet_init);
+  tvhfinit(ratinglabel_init);
+  tvhfinit(service_init);
+  tvhfinit(descrambler_init);
+  tvhfinit(dvb_init);
 #if ENABLE_MPEGTS
 #if ENABLE_TSFILE || ENABLE_TSDEBUG
-  tvhftrace(LS_MAIN, mpegts_init, adapter_mask, opt_nosatipcli, &opt_satip_xml,
+  tvhfinit(mpegts_init, adapter_mask, opt_nosatipcli, &opt_satip_xml,
             &opt_tsfile, opt_tsfile_tuner);
 #else
-  tvhftrace(LS_MAIN, mpegts_init, adapter_mask, opt_nosatipcli, &opt_satip_xml,
+  tvhfinit(mpegts_init, adapter_mask, opt_nosatipcli, &opt_satip_xml,
             NULL, 0);
 #endif
 #endif
-  tvhftrace(LS_MAIN, channel_init);
-  tvhftrace(LS_MAIN, bouquet_service_resolve);
-  tvhftrace(LS_MAIN, subscription_init);
-  tvhftrace(LS_MAIN, dvr_config_init);
-  tvhftrace(LS_MAIN, access_init, opt_firstrun, opt_noacl);
+  tvhfinit(channel_init);
+  tvhfinit(bouquet_service_resolve);
+  tvhfinit(subscription_init);
+  tvhfinit(dvr_config_init);
+  tvhfinit(access_init, opt_firstrun, opt_noacl);
 #if ENABLE_TIMESHIFT
-  tvhftrace(LS_MAIN, timeshift_init);
+  tvhfinit(timeshift_init);
 #endif
-  tvhftrace(LS_MAIN, tcp_server_init);
-  tvhftrace(LS_MAIN, webui_init, opt_xspf);
+  tvhfinit(tcp_server_init);
+  tvhfinit(webui_init, opt_xspf);
 #if ENABLE_UPNP
-  tvhftrace(LS_MAIN, upnp_server_init, opt_bindaddr);
+  tvhfinit(upnp_server_init, opt_bindaddr);
 #endif
-  tvhftrace(LS_MAIN, service_mapper_init);
-  tvhftrace(LS_MAIN, epggrab_init);
-  tvhftrace(LS_MAIN, epg_init);
-  tvhftrace(LS_MAIN, dvr_init);
-  tvhftrace(LS_MAIN, dbus_server_start);
-  tvhftrace(LS_MAIN, http_server_register);
-  tvhftrace(LS_MAIN, satip_server_register);
-  tvhftrace(LS_MAIN, htsp_register);
+  tvhfinit(service_mapper_init);
+  tvhfinit(epggrab_init);
+  tvhfinit(epg_init_async);
+  tvhfinit(dvr_init);
+  tvhfinit(dbus_server_start);
+  tvhfinit(http_server_register);
+  tvhfinit(satip_server_register);
+  tvhfinit(htsp_register);
 
   if(opt_subscribe != NULL)
     subscription_dummy_join(opt_subscribe, 1);
 
-  tvhftrace(LS_MAIN, avahi_init);
-  tvhftrace(LS_MAIN, bonjour_init);
+  tvhfinit(avahi_init);
+  tvhfinit(bonjour_init);
 
-  tvhftrace(LS_MAIN, epg_updated); // cleanup now all prev ref's should have been created
+  tvhfinit(epg_updated); // cleanup now all prev ref's should have been created
   epg_in_load = 0;
 
   tvh_mutex_unlock(&global_lock);
 
+  init_phase_total = getmonoclock() - init_phase_start;
+  for (i = 0, j = 0; i < init_phase_count; i++)
+    if (init_phase[i].duration > init_phase[j].duration)
+      j = i;
+  tvhinfo(LS_MAIN, "startup: %d init phases in %"PRId64"ms, "
+          "slowest %s (%"PRId64"ms)",
+          init_phase_count, init_phase_total / 1000,
+          init_phase_count ? init_phase[j].name : "none",
+          init_phase_count ? init_phase[j].duration / 1000 : (int64_t)0);
+
   tvhftrace(LS_MAIN, watchdog_init);
 
   /**
@@ -1401,6 +1656,8 @@ main(int argc, char **argv)
   tvhftrace(LS_MAIN, http_client_done);
   tvhftrace(LS_MAIN, tcp_server_done);
 
+  epg_init_join();
+
   // Note: the locking is obviously a bit redundant, but without
   //       we need to disable the gtimer_arm call in epg_save()
   tvh_mutex_lock(&global_lock);
@@ -1432,8 +1689,9 @@ main(int argc, char **argv)
   tvhftrace(LS_MAIN, api_done);
 
   tvhtrace(LS_MAIN, "tasklet enter");
-  tvh_cond_signal(&tasklet_cond, 0);
-  pthread_join(tasklet_tid, NULL);
+  tvh_cond_signal(&tasklet_cond, 1);
+  for (i = 0; i < TASKLET_THREADS; i++)
+    pthread_join(tasklet_tid[i], NULL);
   tvhtrace(LS_MAIN, "tasklet thread end");
   tasklet_flush();
   tvhtrace(LS_MAIN, "tasklet leave");
@@ -16,8 +16,10 @@
  *  along with this program.  If not, see <htmlui://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
 
 #include "tvheadend.h"
 #include "service.h"
@@ -379,7 +381,8 @@ static struct strtab cache_types[] = {
   { "System",             MC_CACHE_SYSTEM },
   { "Do not keep",        MC_CACHE_DONTKEEP },
   { "Sync",               MC_CACHE_SYNC },
-  { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP }
+  { "Sync + Do not keep", MC_CACHE_SYNCDONTKEEP },
+  { "Direct (bypass cache)", MC_CACHE_DIRECT }
 };
 
 const char*
@@ -397,12 +400,36 @@ muxer_cache_txt2type(const char *str)
   return r;
 }
 
+/**
+ * File preallocation - keep a chunk of space allocated ahead of the
+ * write position so slow or fragmenting filesystems do not stall the
+ * writer with block allocations in the middle of a recording
+ */
+static void
+muxer_cache_prealloc(muxer_t *m, int fd, off_t pos)
+{
+#if defined(PLATFORM_LINUX)
+  off_t chunk = (off_t)m->m_config.m_prealloc << 20;
+
+  if (pos + (chunk >> 2) <= m->m_prealloc_pos)
+    return;
+  if (fallocate(fd, FALLOC_FL_KEEP_SIZE, m->m_prealloc_pos, chunk))
+    /* not supported by the kernel or the filesystem */
+    m->m_config.m_prealloc = 0;
+  else
+    m->m_prealloc_pos += chunk;
+#endif
+}
+
 /**
  * cache scheme
  */
 void
 muxer_cache_update(muxer_t *m, int fd, off_t pos, size_t size)
 {
+  if (m->m_config.m_prealloc > 0)
+    muxer_cache_prealloc(m, fd, pos);
+
   switch (m->m_config.m_cache) {
   case MC_CACHE_UNKNOWN:
   case MC_CACHE_SYSTEM:
@@ -413,6 +440,10 @@ muxer_cache_update(muxer_t *m, int fd, off_t pos, size_t size)
   case MC_CACHE_SYNCDONTKEEP:
     fdatasync(fd);
     /* fall through */
+  case MC_CACHE_DIRECT:
+    /* O_DIRECT output (pass muxer) leaves no cached pages; muxers
+     * without direct support fall back to dropping them here */
+    /* fall through */
   case MC_CACHE_DONTKEEP:
 #if defined(PLATFORM_DARWIN)
     fcntl(fd, F_NOCACHE, 1);
@@ -425,6 +456,19 @@ muxer_cache_update(muxer_t *m, int fd, off_t pos, size_t size)
   }
 }
 
+/**
+ * Release any file space still preallocated beyond the final size;
+ * called by the muxers just before they close a file
+ */
+void
+muxer_cache_final(muxer_t *m, int fd, off_t size)
+{
+  if (m->m_prealloc_pos > size)
+    if (ftruncate(fd, size))
+      tvherror(LS_MUXER, "Unable to truncate preallocated space -- %s",
+               strerror(errno));
+}
+
 /**
  * Get a list of supported cache schemes
  */
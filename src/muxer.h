@@ -51,7 +51,8 @@ typedef enum {
   MC_CACHE_DONTKEEP     = 2,
   MC_CACHE_SYNC         = 3,
   MC_CACHE_SYNCDONTKEEP = 4,
-  MC_CACHE_LAST         = MC_CACHE_SYNCDONTKEEP
+  MC_CACHE_DIRECT       = 5,
+  MC_CACHE_LAST         = MC_CACHE_DIRECT
 } muxer_cache_type_t;
 
 /* Muxer configuration used when creating a muxer. */
@@ -65,7 +66,8 @@ typedef struct muxer_config {
    */
   int                  m_file_permissions;
   int                  m_directory_permissions; 
-  int                  m_output_chunk; /* > 0 if muxer output needs writing in chunks */   
+  int                  m_output_chunk; /* > 0 if muxer output needs writing in chunks */
+  int                  m_prealloc;     /* > 0 preallocates file space ahead of writes (MiB) */
 
   /*
    * type specific section
@@ -82,6 +84,8 @@ typedef struct muxer_config {
       char            *m_mime;
       int              m_killsig;
       int              m_killtimeout;
+      int              m_flush_bytes; /* > 0 batches stream output up to this size */
+      int              m_flush_time;  /* ms, upper bound on batching latency */
     } pass;
 #if ENABLE_LIBAV
     struct {
@@ -132,6 +136,7 @@ typedef struct muxer {
   int                    m_eos;        /* End of stream */
   int                    m_errors;     /* Number of errors */
   int                    m_caps;       /* Capabilities */
+  off_t                  m_prealloc_pos; /* File preallocation watermark */
   muxer_config_t         m_config;     /* general configuration */
   muxer_hints_t         *m_hints;      /* other hints */
 } muxer_t;
@@ -195,6 +200,7 @@ const char* muxer_suffix      (muxer_t *m, const struct streaming_start *ss);
 const char *       muxer_cache_type2txt(muxer_cache_type_t t);
 muxer_cache_type_t muxer_cache_txt2type(const char *str);
 void               muxer_cache_update(muxer_t *m, int fd, off_t off, size_t size);
+void               muxer_cache_final(muxer_t *m, int fd, off_t size);
 int                muxer_cache_list(htsmsg_t *array);
 
 #endif
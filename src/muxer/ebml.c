@@ -26,85 +26,104 @@
 #include "ebml.h"
 
 void
-ebml_append_id(htsbuf_queue_t *q, uint32_t id)
+ebml_wr_init(ebml_writer_t *ew)
+{
+  memset(ew, 0, sizeof(*ew));
+}
+
+void
+ebml_wr_free(ebml_writer_t *ew)
+{
+  sbuf_free(&ew->ew_buf);
+  ew->ew_depth = 0;
+}
+
+void
+ebml_wr_append(ebml_writer_t *ew, const void *data, size_t len)
+{
+  sbuf_append(&ew->ew_buf, data, len);
+}
+
+void
+ebml_wr_id(ebml_writer_t *ew, uint32_t id)
 {
   uint8_t u8[4] = {id >> 24, id >> 16, id >> 8, id};
 
   if(u8[0])
-    return htsbuf_append(q, u8, 4);
+    return sbuf_append(&ew->ew_buf, u8, 4);
   if(u8[1])
-    return htsbuf_append(q, u8+1, 3);
+    return sbuf_append(&ew->ew_buf, u8+1, 3);
   if(u8[2])
-    return htsbuf_append(q, u8+2, 2);
-  return htsbuf_append(q, u8+3, 1);
+    return sbuf_append(&ew->ew_buf, u8+2, 2);
+  return sbuf_append(&ew->ew_buf, u8+3, 1);
 }
 
 void
-ebml_append_size(htsbuf_queue_t *q, uint32_t size)
+ebml_wr_size(ebml_writer_t *ew, uint32_t size)
 {
   uint8_t u8[5] = { 0x08, size >> 24, size >> 16, size >> 8, size };
 
   if(size < 0x7f) {
     u8[4] |= 0x80;
-    return htsbuf_append(q, u8+4, 1);
+    return sbuf_append(&ew->ew_buf, u8+4, 1);
   }
 
   if(size < 0x3fff) {
     u8[3] |= 0x40;
-    return htsbuf_append(q, u8+3, 2);
+    return sbuf_append(&ew->ew_buf, u8+3, 2);
   }
   if(size < 0x1fffff) {
     u8[2] |= 0x20;
-    return htsbuf_append(q, u8+2, 3);
+    return sbuf_append(&ew->ew_buf, u8+2, 3);
   }
   if(size < 0x0fffffff) {
     u8[1] |= 0x10;
-    return htsbuf_append(q, u8+1, 4);
+    return sbuf_append(&ew->ew_buf, u8+1, 4);
   }
-  return htsbuf_append(q, u8, 5);
+  return sbuf_append(&ew->ew_buf, u8, 5);
 }
 
 
 void
-ebml_append_xiph_size(htsbuf_queue_t *q, int size)
+ebml_wr_xiph_size(ebml_writer_t *ew, int size)
 {
   int i;
-  uint8_t u8[4] = {0xff, size % 0xff};
+  uint8_t u8[2] = {0xff, size % 0xff};
 
   for(i=0; i<size/0xff; i++)
-    htsbuf_append(q, u8, 1);
+    sbuf_append(&ew->ew_buf, u8, 1);
 
-  return htsbuf_append(q, u8+1, 1);
+  return sbuf_append(&ew->ew_buf, u8+1, 1);
 }
 
 
 void
-ebml_append_bin(htsbuf_queue_t *q, unsigned id, const void *data, size_t len)
+ebml_wr_bin(ebml_writer_t *ew, unsigned id, const void *data, size_t len)
 {
-  ebml_append_id(q, id);
-  ebml_append_size(q, len);
-  return htsbuf_append(q, data, len);
+  ebml_wr_id(ew, id);
+  ebml_wr_size(ew, len);
+  return sbuf_append(&ew->ew_buf, data, len);
 }
 
 void
-ebml_append_string(htsbuf_queue_t *q, unsigned id, const char *str)
+ebml_wr_string(ebml_writer_t *ew, unsigned id, const char *str)
 {
-  return ebml_append_bin(q, id, str, strlen(str));
+  return ebml_wr_bin(ew, id, str, strlen(str));
 }
 
 void
-ebml_append_uint(htsbuf_queue_t *q, unsigned id, int64_t ui)
+ebml_wr_uint(ebml_writer_t *ew, unsigned id, int64_t ui)
 {
   uint8_t u8[8] = {ui >> 56, ui >> 48, ui >> 40, ui >> 32,
 		   ui >> 24, ui >> 16, ui >>  8, ui };
   int i = 0;
   while( i < 7 && !u8[i] )
     ++i;
-  return ebml_append_bin(q, id, u8 + i, 8 - i);
+  return ebml_wr_bin(ew, id, u8 + i, 8 - i);
 }
 
 void
-ebml_append_float(htsbuf_queue_t *q, unsigned id, float f)
+ebml_wr_float(ebml_writer_t *ew, unsigned id, float f)
 {
     union
     {
@@ -119,28 +138,45 @@ ebml_append_float(htsbuf_queue_t *q, unsigned id, float f)
     c_f[2] = u.u >> 8;
     c_f[3] = u.u;
 
-    return ebml_append_bin(q, id, c_f, 4);
+    return ebml_wr_bin(ew, id, c_f, 4);
 }
 
+/**
+ * Open a master element.  A four-byte size field is reserved and
+ * filled in by ebml_wr_master_end(), so the contents can be written
+ * straight into the buffer without knowing their length up front.
+ */
 void
-ebml_append_master(htsbuf_queue_t *q, uint32_t id, htsbuf_queue_t *p)
+ebml_wr_master(ebml_writer_t *ew, uint32_t id)
 {
-  ebml_append_id(q, id);
-  ebml_append_size(q, p->hq_size);
-  htsbuf_appendq(q, p);
-  free(p);
+  static const uint8_t placeholder[4] = { 0x10, 0x00, 0x00, 0x00 };
+
+  assert(ew->ew_depth < EBML_MAX_DEPTH);
+  ebml_wr_id(ew, id);
+  ew->ew_stack[ew->ew_depth++] = ew->ew_buf.sb_ptr;
+  sbuf_append(&ew->ew_buf, placeholder, 4);
 }
 
 void
-ebml_append_void(htsbuf_queue_t *q)
+ebml_wr_master_end(ebml_writer_t *ew)
 {
-  char n[1] = {0};
-  ebml_append_bin(q, 0xec, n, 1);
+  uint8_t *p;
+  int off;
+  uint32_t size;
+
+  assert(ew->ew_depth > 0);
+  off = ew->ew_stack[--ew->ew_depth];
+  size = ew->ew_buf.sb_ptr - off - 4;
+  assert(size < 0x0fffffff);
+  p = ew->ew_buf.sb_data + off;
+  p[0] = 0x10 | (size >> 24);
+  p[1] = size >> 16;
+  p[2] = size >> 8;
+  p[3] = size;
 }
 
-
 void
-ebml_append_pad(htsbuf_queue_t *q, size_t pad)
+ebml_wr_pad(ebml_writer_t *ew, size_t pad)
 {
   assert(pad > 2);
   pad -= 2;
@@ -149,20 +185,20 @@ ebml_append_pad(htsbuf_queue_t *q, size_t pad)
 
   void *data = alloca(pad);
   memset(data, 0, pad);
-  ebml_append_bin(q, 0xec, data, pad);
+  ebml_wr_bin(ew, 0xec, data, pad);
 }
 
 
 void
-ebml_append_idid(htsbuf_queue_t *q, uint32_t id0, uint32_t id)
+ebml_wr_idid(ebml_writer_t *ew, uint32_t id0, uint32_t id)
 {
   uint8_t u8[4] = {id >> 24, id >> 16, id >> 8, id};
 
   if(u8[0])
-    return ebml_append_bin(q, id0, u8, 4);
+    return ebml_wr_bin(ew, id0, u8, 4);
   if(u8[1])
-    return ebml_append_bin(q, id0, u8+1, 3);
+    return ebml_wr_bin(ew, id0, u8+1, 3);
   if(u8[2])
-    return ebml_append_bin(q, id0, u8+2, 2);
-  return ebml_append_bin(q, id0, u8+3, 1);
+    return ebml_wr_bin(ew, id0, u8+2, 2);
+  return ebml_wr_bin(ew, id0, u8+3, 1);
 }
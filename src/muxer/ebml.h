@@ -1,29 +1,47 @@
 #ifndef EBML_H__
 #define EBML_H__
 
-#include "htsbuf.h"
+#include "sbuf.h"
 
-void ebml_append_id(htsbuf_queue_t *q, uint32_t id);
+/**
+ * Linear EBML writer.  Elements are serialized into one contiguous
+ * buffer; master elements reserve a fixed-width (non-minimal, but
+ * spec-valid) size field that is backpatched when the master is closed.
+ */
+#define EBML_MAX_DEPTH 8
 
-void ebml_append_size(htsbuf_queue_t *q, uint32_t size);
+typedef struct ebml_writer {
+  sbuf_t ew_buf;
+  int    ew_stack[EBML_MAX_DEPTH]; /* offsets of reserved size fields */
+  int    ew_depth;
+} ebml_writer_t;
 
-void ebml_append_xiph_size(htsbuf_queue_t *q, int size);
+void ebml_wr_init(ebml_writer_t *ew);
 
-void ebml_append_bin(htsbuf_queue_t *q, unsigned id,
-		    const void *data, size_t len);
+void ebml_wr_free(ebml_writer_t *ew);
 
-void ebml_append_string(htsbuf_queue_t *q, unsigned id, const char *str);
+void ebml_wr_append(ebml_writer_t *ew, const void *data, size_t len);
 
-void ebml_append_uint(htsbuf_queue_t *q, unsigned id, int64_t ui);
+void ebml_wr_id(ebml_writer_t *ew, uint32_t id);
 
-void ebml_append_float(htsbuf_queue_t *q, unsigned id, float f);
+void ebml_wr_size(ebml_writer_t *ew, uint32_t size);
 
-void ebml_append_master(htsbuf_queue_t *q, uint32_t id, htsbuf_queue_t *p);
+void ebml_wr_xiph_size(ebml_writer_t *ew, int size);
 
-void ebml_append_void(htsbuf_queue_t *q);
+void ebml_wr_bin(ebml_writer_t *ew, unsigned id, const void *data, size_t len);
 
-void ebml_append_pad(htsbuf_queue_t *q, size_t pad);
+void ebml_wr_string(ebml_writer_t *ew, unsigned id, const char *str);
 
-void ebml_append_idid(htsbuf_queue_t *q, uint32_t id0, uint32_t id);
+void ebml_wr_uint(ebml_writer_t *ew, unsigned id, int64_t ui);
+
+void ebml_wr_float(ebml_writer_t *ew, unsigned id, float f);
+
+void ebml_wr_master(ebml_writer_t *ew, uint32_t id);
+
+void ebml_wr_master_end(ebml_writer_t *ew);
+
+void ebml_wr_pad(ebml_writer_t *ew, size_t pad);
+
+void ebml_wr_idid(ebml_writer_t *ew, uint32_t id0, uint32_t id);
 
 #endif // EBML_H__
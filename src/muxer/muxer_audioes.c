@@ -262,6 +262,8 @@ audioes_muxer_close(muxer_t *m)
 {
   audioes_muxer_t *am = (audioes_muxer_t*)m;
 
+  if (am->am_seekable)
+    muxer_cache_final(m, am->am_fd, am->am_off);
   if ((am->am_seekable) && (close(am->am_fd))) {
     am->am_error = errno;
     tvherror(LS_AUDIOES, "%s: Unable to close file -- %s",
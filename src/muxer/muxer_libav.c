@@ -51,6 +51,44 @@ typedef struct lav_muxer {
 
 static const AVRational mpeg_tc = {1, 90000};
 
+/* the BSF registry is immutable for the process lifetime; resolve the
+   filters once instead of walking the registry on every muxer init */
+static tvh_mutex_t lav_muxer_bsf_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static int lav_muxer_bsf_resolved;
+static const AVBitStreamFilter *lav_muxer_bsf_h264;
+static const AVBitStreamFilter *lav_muxer_bsf_hevc;
+static const AVBitStreamFilter *lav_muxer_bsf_vp9;
+
+
+/**
+ * Hand the cached bitstream filter definitions to a muxer instance
+ */
+static void
+lav_muxer_resolve_bsf(lav_muxer_t *lm)
+{
+  tvh_mutex_lock(&lav_muxer_bsf_mutex);
+  if (!lav_muxer_bsf_resolved) {
+    lav_muxer_bsf_h264 = av_bsf_get_by_name("h264_mp4toannexb");
+    if (lav_muxer_bsf_h264 == NULL) {
+      tvhwarn(LS_LIBAV,  "Failed to get BSF: h264_mp4toannexb");
+    }
+    lav_muxer_bsf_hevc = av_bsf_get_by_name("hevc_mp4toannexb");
+    if (lav_muxer_bsf_hevc == NULL) {
+      tvhwarn(LS_LIBAV,  "Failed to get BSF: hevc_mp4toannexb");
+    }
+    lav_muxer_bsf_vp9 = av_bsf_get_by_name("vp9_superframe");
+    if (lav_muxer_bsf_vp9 == NULL) {
+      tvhwarn(LS_LIBAV,  "Failed to get BSF: vp9_superframe ");
+    }
+    lav_muxer_bsf_resolved = 1;
+  }
+  tvh_mutex_unlock(&lav_muxer_bsf_mutex);
+
+  lm->bsf_h264_filter = lav_muxer_bsf_h264;
+  lm->bsf_hevc_filter = lav_muxer_bsf_hevc;
+  lm->bsf_vp9_filter  = lav_muxer_bsf_vp9;
+}
+
 
 /**
  * Callback function for libavformat
@@ -82,6 +120,17 @@ lav_muxer_write(void *opaque, uint8_t *buf, int buf_size)
 }
 
 
+/**
+ * AVBufferRef free callback - drops the pktbuf reference held by the
+ * AVPacket, so libav can keep the payload alive without copying it
+ */
+static void
+lav_muxer_pktbuf_free(void *opaque, uint8_t *data)
+{
+  pktbuf_ref_dec((pktbuf_t *)opaque);
+}
+
+
 /**
  * Add a stream to the muxer
  */
@@ -409,18 +458,7 @@ lav_muxer_init(muxer_t* m, struct streaming_start *ss, const char *name)
   } else
     av_dict_set(&oc->metadata, "service_provider", app, 0);
 
-  lm->bsf_h264_filter = av_bsf_get_by_name("h264_mp4toannexb");
-  if (lm->bsf_h264_filter == NULL) {
-    tvhwarn(LS_LIBAV,  "Failed to get BSF: h264_mp4toannexb");
-  }
-  lm->bsf_hevc_filter = av_bsf_get_by_name("hevc_mp4toannexb");
-  if (lm->bsf_hevc_filter == NULL) {
-    tvhwarn(LS_LIBAV,  "Failed to get BSF: hevc_mp4toannexb");
-  }
-  lm->bsf_vp9_filter = av_bsf_get_by_name("vp9_superframe");
-  if (lm->bsf_vp9_filter == NULL) {
-    tvhwarn(LS_LIBAV,  "Failed to get BSF: vp9_superframe ");
-  }
+  lav_muxer_resolve_bsf(lm);
 
   oc->max_delay = 0.7 * AV_TIME_BASE;
 
@@ -649,6 +687,15 @@ lav_muxer_write_pkt(muxer_t *m, streaming_message_type_t smt, void *data)
       packet.size = pktbuf_len(pkt->pkt_payload);
     }
 
+    /* hand the refcounted pktbuf to libav; without packet.buf the
+       muxer would memcpy the whole payload to make it refcounted */
+    packet.buf = av_buffer_create(packet.data, packet.size,
+                                  lav_muxer_pktbuf_free,
+                                  pktbuf_ref_inc(pkt->pkt_payload),
+                                  AV_BUFFER_FLAG_READ_ONLY);
+    if (packet.buf == NULL)
+      /* fall back to the copying path inside libav */
+      pktbuf_ref_dec(pkt->pkt_payload);
 
     packet.stream_index = st->index;
  
@@ -45,9 +45,6 @@
 
 #include "epggrab.h"  //Needed to see if global processing of parental rating labels is enabled.
 
-extern int dvr_iov_max;
-
-TAILQ_HEAD(mk_cue_queue, mk_cue);
 TAILQ_HEAD(mk_chapter_queue, mk_chapter);
 
 #define MATROSKA_TIMESCALE 1000000 // in nS
@@ -76,16 +73,6 @@ typedef struct mk_track {
   uint8_t commercial;
 } mk_track_t;
 
-/**
- *
- */
-typedef struct mk_cue {
-  TAILQ_ENTRY(mk_cue) link;
-  int64_t ts;
-  int tracknum;
-  off_t cluster_pos;
-} mk_cue_t;
-
 /**
  *
  */
@@ -109,7 +96,8 @@ typedef struct mk_muxer {
 
   int64_t totduration;
 
-  htsbuf_queue_t *cluster;
+  sbuf_t cluster;       /* reusable cluster build buffer */
+  int cluster_open;
   int64_t cluster_tc;
   off_t cluster_pos;
   int64_t cluster_last_close;
@@ -127,7 +115,7 @@ typedef struct mk_muxer {
 
   int addcue;
 
-  struct mk_cue_queue cues;
+  ebml_writer_t cuew;   /* cue points, serialized as they are added */
   struct mk_chapter_queue chapters;
 
   uint8_t uuid[16];
@@ -156,19 +144,18 @@ static int mk_pktref_cmp(const void *_a, const void *_b)
 /*
  *
  */
-static htsbuf_queue_t *
-mk_build_ebmlheader(mk_muxer_t *mk)
+static void
+mk_build_ebmlheader(mk_muxer_t *mk, ebml_writer_t *ew)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-
-  ebml_append_uint(q, 0x4286, 1);
-  ebml_append_uint(q, 0x42f7, 1);
-  ebml_append_uint(q, 0x42f2, 4);
-  ebml_append_uint(q, 0x42f3, 8);
-  ebml_append_string(q, 0x4282, mk->webm ? "webm" : "matroska");
-  ebml_append_uint(q, 0x4287, 2);
-  ebml_append_uint(q, 0x4285, 2);
-  return q;
+  ebml_wr_master(ew, 0x1a45dfa3);
+  ebml_wr_uint(ew, 0x4286, 1);
+  ebml_wr_uint(ew, 0x42f7, 1);
+  ebml_wr_uint(ew, 0x42f2, 4);
+  ebml_wr_uint(ew, 0x42f3, 8);
+  ebml_wr_string(ew, 0x4282, mk->webm ? "webm" : "matroska");
+  ebml_wr_uint(ew, 0x4287, 2);
+  ebml_wr_uint(ew, 0x4285, 2);
+  ebml_wr_master_end(ew);
 }
 
 
@@ -221,42 +208,43 @@ mk_split_xiph_headers(uint8_t *extradata, int extradata_size,
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_segment_info(mk_muxer_t *mk)
+static void
+mk_build_segment_info(mk_muxer_t *mk, ebml_writer_t *ew)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
   char app[128];
 
   snprintf(app, sizeof(app), "Tvheadend %s", tvheadend_version);
 
+  ebml_wr_master(ew, 0x1549a966);
+
   if(!mk->webm)
-    ebml_append_bin(q, 0x73a4, mk->uuid, sizeof(mk->uuid));   //0x73a4 = SegmentUUID
+    ebml_wr_bin(ew, 0x73a4, mk->uuid, sizeof(mk->uuid));   //0x73a4 = SegmentUUID
 
   if(!mk->webm)
-    ebml_append_string(q, 0x7ba9, mk->title);                 //0x7ba9 = Title
+    ebml_wr_string(ew, 0x7ba9, mk->title);                 //0x7ba9 = Title
 
-  ebml_append_string(q, 0x4d80, "Tvheadend Matroska muxer");  //0x4d80 = MuxingApp
-  ebml_append_string(q, 0x5741, app);                         //0x5741 = WritingApp
-  ebml_append_uint(q, 0x2ad7b1, MATROSKA_TIMESCALE);          //0x2ad7b1 = TimestampScale
+  ebml_wr_string(ew, 0x4d80, "Tvheadend Matroska muxer");  //0x4d80 = MuxingApp
+  ebml_wr_string(ew, 0x5741, app);                         //0x5741 = WritingApp
+  ebml_wr_uint(ew, 0x2ad7b1, MATROSKA_TIMESCALE);          //0x2ad7b1 = TimestampScale
 
   if(mk->totduration)
-    ebml_append_float(q, 0x4489, (float)mk->totduration);     //0x4489 = Duration
+    ebml_wr_float(ew, 0x4489, (float)mk->totduration);     //0x4489 = Duration
   else
-    ebml_append_pad(q, 7); // Must be equal to floatingpoint duration
-  return q;
+    ebml_wr_pad(ew, 7); // Must be equal to floatingpoint duration
+
+  ebml_wr_master_end(ew);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_tracks(mk_muxer_t *mk, streaming_start_t *ss)
+static void
+mk_build_tracks(mk_muxer_t *mk, streaming_start_t *ss, ebml_writer_t *ew)
 {
   streaming_start_component_t *ssc;
   const char *codec_id;
   int i, tracktype;
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0), *t;
   int tracknum = 0;
   uint8_t buf4[4];
   uint32_t bit_depth = 0;
@@ -265,6 +253,7 @@ mk_build_tracks(mk_muxer_t *mk, streaming_start_t *ss)
   mk->tracks = calloc(1, sizeof(mk_track_t) * ss->ss_num_components);
   mk->ntracks = ss->ss_num_components;
   mk->cluster_maxsize = 4000000;
+  ebml_wr_master(ew, 0x1654ae6b);
   for(i = 0; i < ss->ss_num_components; i++) {
     ssc = &ss->ss_components[i];
     tr = &mk->tracks[i];
@@ -394,16 +383,16 @@ disable:
     tr->tracktype = tracktype;
     mk->has_video |= (tracktype == 1);
 
-    t = htsbuf_queue_alloc(0);
+    ebml_wr_master(ew, 0xae);
 
-    ebml_append_uint(t, 0xd7, tr->tracknum);
-    ebml_append_uint(t, 0x73c5, tr->tracknum);
-    ebml_append_uint(t, 0x83, tracktype);
-    ebml_append_uint(t, 0x9c, 0); // Lacing
-    ebml_append_string(t, 0x86, codec_id);
+    ebml_wr_uint(ew, 0xd7, tr->tracknum);
+    ebml_wr_uint(ew, 0x73c5, tr->tracknum);
+    ebml_wr_uint(ew, 0x83, tracktype);
+    ebml_wr_uint(ew, 0x9c, 0); // Lacing
+    ebml_wr_string(ew, 0x86, codec_id);
 
     if(ssc->es_lang[0])
-      ebml_append_string(t, 0x22b59c, ssc->es_lang);
+      ebml_wr_string(ew, 0x22b59c, ssc->es_lang);
 
     switch(ssc->es_type) {
     case SCT_HEVC:
@@ -425,7 +414,7 @@ disable:
           sbuf_append(&hdr, pktbuf_ptr(ssc->ssc_gh),
                             pktbuf_len(ssc->ssc_gh));
         }
-        ebml_append_bin(t, 0x63a2, hdr.sb_data, hdr.sb_ptr);
+        ebml_wr_bin(ew, 0x63a2, hdr.sb_data, hdr.sb_ptr);
         sbuf_free(&hdr);
       }
       break;
@@ -433,7 +422,6 @@ disable:
     case SCT_THEORA:
     case SCT_VORBIS:
       if(ssc->ssc_gh) {
-        htsbuf_queue_t *cp;
         uint8_t *header_start[3];
         int header_len[3];
         int j;
@@ -444,13 +432,13 @@ disable:
           tvherror(LS_MKV, "failed to split xiph headers");
           break;
         }
-        cp = htsbuf_queue_alloc(0);
-        ebml_append_xiph_size(cp, 2);
+        ebml_wr_master(ew, 0x63a2);
+        ebml_wr_xiph_size(ew, 2);
         for (j = 0; j < 2; j++)
-          ebml_append_xiph_size(cp, header_len[j]);
+          ebml_wr_xiph_size(ew, header_len[j]);
         for (j = 0; j < 3; j++)
-          htsbuf_append(cp, header_start[j], header_len[j]);
-        ebml_append_master(t, 0x63a2, cp);
+          ebml_wr_append(ew, header_start[j], header_len[j]);
+        ebml_wr_master_end(ew);
       }
       break;
 
@@ -459,94 +447,126 @@ disable:
       buf4[1] = ssc->es_composition_id;
       buf4[2] = ssc->es_ancillary_id >> 8;
       buf4[3] = ssc->es_ancillary_id;
-      ebml_append_bin(t, 0x63a2, buf4, 4);
+      ebml_wr_bin(ew, 0x63a2, buf4, 4);
       break;
     }
 
     if(SCT_ISVIDEO(ssc->es_type)) {
-      htsbuf_queue_t *vi = htsbuf_queue_alloc(0);
-
       if(ssc->es_frame_duration) {
         int d = ts_rescale(ssc->es_frame_duration, 1000000000);
-        ebml_append_uint(t, 0x23e383, d);
+        ebml_wr_uint(ew, 0x23e383, d);
       }
-      ebml_append_uint(vi, 0xb0, ssc->es_width);
-      ebml_append_uint(vi, 0xba, ssc->es_height);
+
+      ebml_wr_master(ew, 0xe0);
+      ebml_wr_uint(ew, 0xb0, ssc->es_width);
+      ebml_wr_uint(ew, 0xba, ssc->es_height);
 
       if (ssc->es_aspect_num && ssc->es_aspect_den) {
         if (mk->webm) {
-          ebml_append_uint(vi, 0x54b0, (ssc->es_height * ssc->es_aspect_num) / ssc->es_aspect_den);
-          ebml_append_uint(vi, 0x54ba, ssc->es_height);
-          ebml_append_uint(vi, 0x54b2, 0); // DisplayUnit: pixels because DAR is not supported by webm
+          ebml_wr_uint(ew, 0x54b0, (ssc->es_height * ssc->es_aspect_num) / ssc->es_aspect_den);
+          ebml_wr_uint(ew, 0x54ba, ssc->es_height);
+          ebml_wr_uint(ew, 0x54b2, 0); // DisplayUnit: pixels because DAR is not supported by webm
         } else {
-          ebml_append_uint(vi, 0x54b0, ssc->es_aspect_num);
-          ebml_append_uint(vi, 0x54ba, ssc->es_aspect_den);
-          ebml_append_uint(vi, 0x54b2, 3); // DisplayUnit: DAR
+          ebml_wr_uint(ew, 0x54b0, ssc->es_aspect_num);
+          ebml_wr_uint(ew, 0x54ba, ssc->es_aspect_den);
+          ebml_wr_uint(ew, 0x54b2, 3); // DisplayUnit: DAR
         }
       }
-
-      ebml_append_master(t, 0xe0, vi);
+      ebml_wr_master_end(ew);
     }
 
     if(SCT_ISAUDIO(ssc->es_type)) {
-      htsbuf_queue_t *au = htsbuf_queue_alloc(0);
-
-      ebml_append_float(au, 0xb5, sri_to_rate(ssc->es_sri));
+      ebml_wr_master(ew, 0xe1);
+      ebml_wr_float(ew, 0xb5, sri_to_rate(ssc->es_sri));
       if (ssc->es_ext_sri)
-        ebml_append_float(au, 0x78b5, sri_to_rate(ssc->es_ext_sri - 1));
-      ebml_append_uint(au, 0x9f, ssc->es_channels);
+        ebml_wr_float(ew, 0x78b5, sri_to_rate(ssc->es_ext_sri - 1));
+      ebml_wr_uint(ew, 0x9f, ssc->es_channels);
       if (bit_depth)
-        ebml_append_uint(au, 0x6264, bit_depth);
-
-      ebml_append_master(t, 0xe1, au);
+        ebml_wr_uint(ew, 0x6264, bit_depth);
+      ebml_wr_master_end(ew);
     }
 
-
-    ebml_append_master(q, 0xae, t);
+    ebml_wr_master_end(ew);
   }
-  return q;
+  ebml_wr_master_end(ew);
 }
 
 
 /**
- *
+ * Encode an EBML size; dst must hold at least 5 bytes
  */
 static int
-mk_write_to_fd(mk_muxer_t *mk, htsbuf_queue_t *hq)
+mk_ebml_size(uint8_t *dst, uint32_t size)
 {
-  htsbuf_data_t *hd;
-  int i = 0;
-  off_t oldpos = mk->fdpos;
+  if(size < 0x7f) {
+    dst[0] = 0x80 | size;
+    return 1;
+  }
+  if(size < 0x3fff) {
+    dst[0] = 0x40 | (size >> 8);
+    dst[1] = size;
+    return 2;
+  }
+  if(size < 0x1fffff) {
+    dst[0] = 0x20 | (size >> 16);
+    dst[1] = size >> 8;
+    dst[2] = size;
+    return 3;
+  }
+  if(size < 0x0fffffff) {
+    dst[0] = 0x10 | (size >> 24);
+    dst[1] = size >> 16;
+    dst[2] = size >> 8;
+    dst[3] = size;
+    return 4;
+  }
+  dst[0] = 0x08;
+  dst[1] = size >> 24;
+  dst[2] = size >> 16;
+  dst[3] = size >> 8;
+  dst[4] = size;
+  return 5;
+}
 
-  TAILQ_FOREACH(hd, &hq->hq_q, hd_link)
-    i++;
 
-  struct iovec *iov = alloca(sizeof(struct iovec) * i);
+/**
+ *
+ */
+static void
+mk_write_iov(mk_muxer_t *mk, struct iovec *iov, int cnt)
+{
+  struct iovec *p = iov;
+  off_t oldpos = mk->fdpos;
+  ssize_t r;
 
-  i = 0;
-  TAILQ_FOREACH(hd, &hq->hq_q, hd_link) {
-    iov[i  ].iov_base = hd->hd_data     + hd->hd_data_off;
-    iov[i++].iov_len  = hd->hd_data_len - hd->hd_data_off;
-  }
+  if(mk->error)
+    return;
 
-  do {
-    ssize_t r;
-    int iovcnt = i < dvr_iov_max ? i : dvr_iov_max;
-    if((r = writev(mk->fd, iov, iovcnt)) == -1) {
+  while (cnt > 0) {
+    r = writev(mk->fd, p, cnt);
+    if (r == -1) {
       if (ERRNO_AGAIN(errno))
         continue;
       mk->error = errno;
-      return -1;
+      if (!MC_IS_EOS_ERROR(mk->error))
+        tvherror(LS_MKV, "%s: Write failed -- %s", mk->filename,
+                 strerror(errno));
+      return;
     }
     mk->fdpos += r;
-    i -= iovcnt;
-    iov += iovcnt;
-  } while(i);
+    while (cnt > 0 && (size_t)r >= p->iov_len) {
+      r -= p->iov_len;
+      p++;
+      cnt--;
+    }
+    if (cnt > 0) {
+      p->iov_base += r;
+      p->iov_len -= r;
+    }
+  }
 
   if (mk->seekable)
     muxer_cache_update((muxer_t *)mk, mk->fd, oldpos, 0);
-
-  return 0;
 }
 
 
@@ -554,38 +574,47 @@ mk_write_to_fd(mk_muxer_t *mk, htsbuf_queue_t *hq)
  *
  */
 static void
-mk_write_queue(mk_muxer_t *mk, htsbuf_queue_t *q)
+mk_write_buf(mk_muxer_t *mk, sbuf_t *sb)
 {
-  if(!mk->error && mk_write_to_fd(mk, q) && !MC_IS_EOS_ERROR(mk->error))
-    tvherror(LS_MKV, "%s: Write failed -- %s", mk->filename, strerror(errno));
+  struct iovec iov[1];
 
-  htsbuf_queue_flush(q);
+  iov[0].iov_base = sb->sb_data;
+  iov[0].iov_len  = sb->sb_ptr;
+  mk_write_iov(mk, iov, 1);
 }
 
 
 /**
- *
+ * Write a serialized element body wrapped in a top-level (four byte)
+ * element id and a minimal-length size, without copying the body
  */
 static void
-mk_write_master(mk_muxer_t *mk, uint32_t id, htsbuf_queue_t *p)
+mk_write_flat(mk_muxer_t *mk, uint32_t id, sbuf_t *sb)
 {
-  htsbuf_queue_t q;
-  htsbuf_queue_init(&q, 0);
-  ebml_append_master(&q, id, p);
-  mk_write_queue(mk, &q);
+  uint8_t hdr[9];
+  struct iovec iov[2];
+
+  hdr[0] = id >> 24;
+  hdr[1] = id >> 16;
+  hdr[2] = id >> 8;
+  hdr[3] = id;
+  iov[0].iov_base = hdr;
+  iov[0].iov_len  = 4 + mk_ebml_size(hdr + 4, sb->sb_ptr);
+  iov[1].iov_base = sb->sb_data;
+  iov[1].iov_len  = sb->sb_ptr;
+  mk_write_iov(mk, iov, 2);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_segment_header(int64_t size)
+static void
+mk_append_segment_header(ebml_writer_t *ew, int64_t size)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
   uint8_t u8[8];
 
-  ebml_append_id(q, 0x18538067);
+  ebml_wr_id(ew, 0x18538067);
 
   u8[0] = 1;
   if(size == 0) {
@@ -599,9 +628,7 @@ mk_build_segment_header(int64_t size)
     u8[6] = size >> 8;
     u8[7] = size;
   }
-  htsbuf_append(q, &u8, 8);
-
-  return q;
+  ebml_wr_append(ew, u8, 8);
 }
 
 
@@ -611,61 +638,47 @@ mk_build_segment_header(int64_t size)
 static void
 mk_write_segment_header(mk_muxer_t *mk, int64_t size)
 {
-  htsbuf_queue_t *q;
-  q = mk_build_segment_header(size);
-  mk_write_queue(mk, q);
-  htsbuf_queue_free(q);
+  ebml_writer_t ew;
+
+  ebml_wr_init(&ew);
+  mk_append_segment_header(&ew, size);
+  mk_write_buf(mk, &ew.ew_buf);
+  ebml_wr_free(&ew);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_one_chapter(mk_chapter_t *ch)
+static void
+mk_build_one_chapter(ebml_writer_t *ew, mk_chapter_t *ch)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-
-  ebml_append_uint(q, 0x73C4, ch->uuid);
-  ebml_append_uint(q, 0x91, ch->ts * MATROSKA_TIMESCALE);
-  ebml_append_uint(q, 0x98, 0); //ChapterFlagHidden
-  ebml_append_uint(q, 0x4598, 1); //ChapterFlagEnabled
-
-  return q;
+  ebml_wr_master(ew, 0xB6);
+  ebml_wr_uint(ew, 0x73C4, ch->uuid);
+  ebml_wr_uint(ew, 0x91, ch->ts * MATROSKA_TIMESCALE);
+  ebml_wr_uint(ew, 0x98, 0); //ChapterFlagHidden
+  ebml_wr_uint(ew, 0x4598, 1); //ChapterFlagEnabled
+  ebml_wr_master_end(ew);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_edition_entry(mk_muxer_t *mk)
+static void
+mk_build_edition_entry(mk_muxer_t *mk, ebml_writer_t *ew)
 {
   mk_chapter_t *ch;
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
 
-  ebml_append_uint(q, 0x45bd, 0); //EditionFlagHidden
-  ebml_append_uint(q, 0x45db, 1); //EditionFlagDefault
+  ebml_wr_master(ew, 0x45b9);
+  ebml_wr_uint(ew, 0x45bd, 0); //EditionFlagHidden
+  ebml_wr_uint(ew, 0x45db, 1); //EditionFlagDefault
 
   TAILQ_FOREACH(ch, &mk->chapters, link) {
-    ebml_append_master(q, 0xB6, mk_build_one_chapter(ch));
+    mk_build_one_chapter(ew, ch);
   }
 
-  return q;
-}
-
-
-/**
- *
- */
-static htsbuf_queue_t *
-mk_build_chapters(mk_muxer_t *mk)
-{
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-
-  ebml_append_master(q, 0x45b9, mk_build_edition_entry(mk));
-
-  return q;
+  ebml_wr_master_end(ew);
 }
 
 /**
@@ -674,51 +687,57 @@ mk_build_chapters(mk_muxer_t *mk)
 static void
 mk_write_chapters(mk_muxer_t *mk)
 {
+  ebml_writer_t ew;
+
   if(TAILQ_FIRST(&mk->chapters) == NULL)
     return;
 
   mk->chapters_pos = mk->fdpos;
-  mk_write_master(mk, 0x1043a770, mk_build_chapters(mk));   //0x1043a770 = Chapters
+
+  ebml_wr_init(&ew);
+  mk_build_edition_entry(mk, &ew);
+  mk_write_flat(mk, 0x1043a770, &ew.ew_buf);   //0x1043a770 = Chapters
+  ebml_wr_free(&ew);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-build_tag_string(const char *name, const char *value, const char *lang,
+static void
+build_tag_string(ebml_writer_t *ew,
+		 const char *name, const char *value, const char *lang,
 		 int targettype, const char *targettypename)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-  htsbuf_queue_t *st = htsbuf_queue_alloc(0);
-
-  htsbuf_queue_t *t = htsbuf_queue_alloc(0);
-  ebml_append_uint(t, 0x68ca, targettype ?: 50);      //0x68ca = TargetTypeValue
+  ebml_wr_master(ew, 0x7373);                       //0x7373 = Tag
 
+  ebml_wr_master(ew, 0x63c0);                       //0x63c0 = Targets
+  ebml_wr_uint(ew, 0x68ca, targettype ?: 50);       //0x68ca = TargetTypeValue
   if(targettypename)
-    ebml_append_string(t, 0x63ca, targettypename);    //0x63ca = TargetType
-  ebml_append_master(q, 0x63c0, t);                   //0x63c0 = Targets
+    ebml_wr_string(ew, 0x63ca, targettypename);     //0x63ca = TargetType
+  ebml_wr_master_end(ew);
 
-  ebml_append_string(st, 0x45a3, name);               //0x45a3 = TagName
-  ebml_append_string(st, 0x4487, value);              //0x4487 = TagString
-  ebml_append_uint(st, 0x4484, 1);                    //0x4484 = TagDefault
-  ebml_append_string(st, 0x447a, lang ?: "und");      //0x447a = TagLanguage
+  ebml_wr_master(ew, 0x67c8);                       //0x67c8 = SimpleTag
+  ebml_wr_string(ew, 0x45a3, name);                 //0x45a3 = TagName
+  ebml_wr_string(ew, 0x4487, value);                //0x4487 = TagString
+  ebml_wr_uint(ew, 0x4484, 1);                      //0x4484 = TagDefault
+  ebml_wr_string(ew, 0x447a, lang ?: "und");        //0x447a = TagLanguage
+  ebml_wr_master_end(ew);
 
-  ebml_append_master(q, 0x67c8, st);                  //0x67c8 = SimpleTag
-  return q;
+  ebml_wr_master_end(ew);
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-build_tag_int(const char *name, int value,
+static void
+build_tag_int(ebml_writer_t *ew, const char *name, int value,
 	      int targettype, const char *targettypename)
 {
   char str[64];
   snprintf(str, sizeof(str), "%d", value);
-  return build_tag_string(name, str, NULL, targettype, targettypename);
+  build_tag_string(ew, name, str, NULL, targettype, targettypename);
 }
 
 
@@ -726,24 +745,14 @@ build_tag_int(const char *name, int value,
  *
  */
 static void
-addtag(htsbuf_queue_t *q, htsbuf_queue_t *t)
-{
-  ebml_append_master(q, 0x7373, t);
-}
-
-
-/**
- *
- */
-static htsbuf_queue_t *
-_mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
+_mk_build_metadata(ebml_writer_t *ew,
+                   const dvr_entry_t *de, const epg_broadcast_t *ebc,
                    const char *comment)
 {
 
   //Note: May 2025 DMC - If the recording is manual or from a timer
   //then only the 'comment' will be available, 'de' and 'ebc' will be null.
 
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
   char datestr[64], ctype[100], temp_rating[128];
   const epg_genre_t *eg = NULL;
   epg_genre_t eg0;
@@ -770,9 +779,9 @@ _mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
 	   tm.tm_min,
 	   tm.tm_sec);
 
-  addtag(q, build_tag_string("DATE_BROADCASTED", datestr, NULL, 0, NULL));
+  build_tag_string(ew, "DATE_BROADCASTED", datestr, NULL, 0, NULL);
 
-  addtag(q, build_tag_string("ORIGINAL_MEDIA_TYPE", "TV", NULL, 0, NULL));
+  build_tag_string(ew, "ORIGINAL_MEDIA_TYPE", "TV", NULL, 0, NULL);
 
   if(de && de->de_content_type) {
     memset(&eg0, 0, sizeof(eg0));
@@ -782,7 +791,7 @@ _mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
     eg = LIST_FIRST(&ebc->genre);
   }
   if(eg && epg_genre_get_str(eg, 1, 0, ctype, 100, NULL))
-    addtag(q, build_tag_string("CONTENT_TYPE", ctype, NULL, 0, NULL));
+    build_tag_string(ew, "CONTENT_TYPE", ctype, NULL, 0, NULL);
 
   //Only add the 'LAW_RATING' tag if 1) rating label processing is enabled globally
   //AND 2) this EPG entry has a rating label worth adding.
@@ -807,13 +816,13 @@ _mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
         snprintf(temp_rating, sizeof(temp_rating), "%s (%s)", ebc->rating_label->rl_display_label, ebc->rating_label->rl_authority);
       }
 
-      addtag(q, build_tag_string("LAW_RATING", temp_rating, NULL, 0, NULL));
+      build_tag_string(ew, "LAW_RATING", temp_rating, NULL, 0, NULL);
     }
   }//END we got a rating label from the EPG
 
   if(ch)
-    addtag(q, build_tag_string("TVCHANNEL",
-                               channel_get_name(ch, channel_blank_name), NULL, 0, NULL));
+    build_tag_string(ew, "TVCHANNEL",
+                     channel_get_name(ch, channel_blank_name), NULL, 0, NULL);
 
   if (ebc && ebc->summary)
     ls = ebc->summary;
@@ -833,48 +842,48 @@ _mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
   if (ls) {
     lang_str_ele_t *e;
     RB_FOREACH(e, ls, link)
-      addtag(q, build_tag_string("SUMMARY", e->str, e->lang, 0, NULL));
+      build_tag_string(ew, "SUMMARY", e->str, e->lang, 0, NULL);
   }
 
   if (ls2 && ls != ls2) {
     lang_str_ele_t *e;
     RB_FOREACH(e, ls2, link)
-      addtag(q, build_tag_string("DESCRIPTION", e->str, e->lang, 0, NULL));
+      build_tag_string(ew, "DESCRIPTION", e->str, e->lang, 0, NULL);
   }
-  
+
   if (ls3) {
     lang_str_ele_t *e;
     RB_FOREACH(e, ls3, link)
-      addtag(q, build_tag_string("SUBTITLE", e->str, e->lang, 0, NULL));
+      build_tag_string(ew, "SUBTITLE", e->str, e->lang, 0, NULL);
   }
-  
+
   epg_broadcast_get_epnum(ebc, &num);
   if(num.e_num)
-    addtag(q, build_tag_int("PART_NUMBER", num.e_num,
-                              0, NULL));
+    build_tag_int(ew, "PART_NUMBER", num.e_num,
+                  0, NULL);
   if(num.s_num)
-    addtag(q, build_tag_int("PART_NUMBER", num.s_num,
-                              60, "SEASON"));
+    build_tag_int(ew, "PART_NUMBER", num.s_num,
+                  60, "SEASON");
   if(num.p_num)
-    addtag(q, build_tag_int("PART_NUMBER", num.p_num,
-                              40, "PART"));
+    build_tag_int(ew, "PART_NUMBER", num.p_num,
+                  40, "PART");
   if (num.text)
-    addtag(q, build_tag_string("SYNOPSIS",
-                               num.text, NULL, 0, NULL));
+    build_tag_string(ew, "SYNOPSIS",
+                     num.text, NULL, 0, NULL);
 
   if (comment) {
     lang = "eng";
     if ((langs = lang_code_split(NULL)) != NULL) {
       lang = tvh_strdupa(langs->codes[0]->code2b);
     }
-    addtag(q, build_tag_string("COMMENT", comment, lang, 0, NULL));
+    build_tag_string(ew, "COMMENT", comment, lang, 0, NULL);
   }
   else if (de && de->de_comment) {  //Add the DVR recording comment if one exists and an explicit comment is omitted
     //If the DVR entry has a Title, 'borrow' the language code(s) for the comment
     if (de->de_title) {
       lang_str_ele_t *e;
       RB_FOREACH(e, de->de_title, link)
-        addtag(q, build_tag_string("COMMENT", de->de_comment, e->lang, 0, NULL));
+        build_tag_string(ew, "COMMENT", de->de_comment, e->lang, 0, NULL);
     }
     else //Otherwise, just use 'eng' as the default.
     {
@@ -883,25 +892,23 @@ _mk_build_metadata(const dvr_entry_t *de, const epg_broadcast_t *ebc,
         lang = tvh_strdupa(langs->codes[0]->code2b);
       }
 
-      addtag(q, build_tag_string("COMMENT", de->de_comment, lang, 0, NULL));      
+      build_tag_string(ew, "COMMENT", de->de_comment, lang, 0, NULL);
     }
   }//END extra comment
-
-  return q;
 }
 
 
 /**
  *
  */
-static htsbuf_queue_t *
-mk_build_one_metaseek(mk_muxer_t *mk, uint32_t id, off_t pos)
+static void
+mk_build_one_metaseek(mk_muxer_t *mk, ebml_writer_t *ew,
+                      uint32_t id, off_t pos)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-
-  ebml_append_idid(q, 0x53ab, id);
-  ebml_append_uint(q, 0x53ac, pos - mk->segment_pos);
-  return q;
+  ebml_wr_master(ew, 0x4dbb);
+  ebml_wr_idid(ew, 0x53ab, id);
+  ebml_wr_uint(ew, 0x53ac, pos - mk->segment_pos);
+  ebml_wr_master_end(ew);
 }
 
 
@@ -909,32 +916,20 @@ mk_build_one_metaseek(mk_muxer_t *mk, uint32_t id, off_t pos)
  *
  */
 static void
-mk_append_master(mk_muxer_t *mk, htsbuf_queue_t *q,
-                 off_t id1, off_t id2, off_t val)
-{
-  ebml_append_master(q, id1, mk_build_one_metaseek(mk, id2, val));
-
-}
-
-/**
- *
- */
-static htsbuf_queue_t *
-mk_build_metaseek(mk_muxer_t *mk)
+mk_build_metaseek(mk_muxer_t *mk, ebml_writer_t *ew)
 {
-  htsbuf_queue_t *q = htsbuf_queue_alloc(0);
-
+  ebml_wr_master(ew, 0x114d9b74);
   if(mk->segmentinfo_pos)
-    mk_append_master(mk, q, 0x4dbb, 0x1549a966, mk->segmentinfo_pos);
+    mk_build_one_metaseek(mk, ew, 0x1549a966, mk->segmentinfo_pos);
   if(mk->trackinfo_pos)
-    mk_append_master(mk, q, 0x4dbb, 0x1654ae6b, mk->trackinfo_pos);
+    mk_build_one_metaseek(mk, ew, 0x1654ae6b, mk->trackinfo_pos);
   if(mk->metadata_pos)
-    mk_append_master(mk, q, 0x4dbb, 0x1254c367, mk->metadata_pos);
+    mk_build_one_metaseek(mk, ew, 0x1254c367, mk->metadata_pos);
   if(mk->cue_pos)
-    mk_append_master(mk, q, 0x4dbb, 0x1c53bb6b, mk->cue_pos);
+    mk_build_one_metaseek(mk, ew, 0x1c53bb6b, mk->cue_pos);
   if(mk->chapters_pos)
-    mk_append_master(mk, q, 0x4dbb, 0x1043a770, mk->chapters_pos);
-  return q;
+    mk_build_one_metaseek(mk, ew, 0x1043a770, mk->chapters_pos);
+  ebml_wr_master_end(ew);
 }
 
 
@@ -944,55 +939,52 @@ mk_build_metaseek(mk_muxer_t *mk)
 static void
 mk_write_metaseek(mk_muxer_t *mk, int first)
 {
-  htsbuf_queue_t q;
+  ebml_writer_t ew;
 
-  htsbuf_queue_init(&q, 0);
+  ebml_wr_init(&ew);
 
-  ebml_append_master(&q, 0x114d9b74, mk_build_metaseek(mk));
+  mk_build_metaseek(mk, &ew);
 
-  assert(q.hq_size < 498);
+  assert(ew.ew_buf.sb_ptr < 498);
 
-  ebml_append_pad(&q, 500 - q.hq_size);
+  ebml_wr_pad(&ew, 500 - ew.ew_buf.sb_ptr);
 
   if(first) {
-    mk_write_to_fd(mk, &q);
+    mk_write_buf(mk, &ew.ew_buf);
   } else if(mk->seekable) {
     off_t prev = mk->fdpos;
     mk->fdpos = mk->segment_pos;
     if(lseek(mk->fd, mk->segment_pos, SEEK_SET) == (off_t) -1)
       mk->error = errno;
 
-    mk_write_queue(mk, &q);
+    mk_write_buf(mk, &ew.ew_buf);
     mk->fdpos = prev;
     if(lseek(mk->fd, mk->fdpos, SEEK_SET) == (off_t) -1)
       mk->error = errno;
   }
-  htsbuf_queue_flush(&q);
+  ebml_wr_free(&ew);
 }
 
 
 /**
- *
+ * Serialize the start of the segment; positions are recorded straight
+ * from the buffer offset since this is the first write to the file
  */
-static htsbuf_queue_t *
+static void
 mk_build_segment(mk_muxer_t *mk,
-		 streaming_start_t *ss)
+		 streaming_start_t *ss, ebml_writer_t *ew)
 {
-  htsbuf_queue_t *p = htsbuf_queue_alloc(0);
-
   assert(mk->segment_pos != 0);
 
   // Meta seek
   if(mk->seekable)
-    ebml_append_pad(p, 500);
-
-  mk->segmentinfo_pos = mk->segment_pos + p->hq_size;
-  ebml_append_master(p, 0x1549a966, mk_build_segment_info(mk));
+    ebml_wr_pad(ew, 500);
 
-  mk->trackinfo_pos = mk->segment_pos + p->hq_size;
-  ebml_append_master(p, 0x1654ae6b, mk_build_tracks(mk, ss));
+  mk->segmentinfo_pos = ew->ew_buf.sb_ptr;
+  mk_build_segment_info(mk, ew);
 
-  return p;
+  mk->trackinfo_pos = ew->ew_buf.sb_ptr;
+  mk_build_tracks(mk, ss, ew);
 }
 
 
@@ -1002,11 +994,17 @@ mk_build_segment(mk_muxer_t *mk,
 static void
 addcue(mk_muxer_t *mk, int64_t pts, int tracknum)
 {
-  mk_cue_t *mc = malloc(sizeof(mk_cue_t));
-  mc->ts = pts;
-  mc->tracknum = tracknum;
-  mc->cluster_pos = mk->cluster_pos;
-  TAILQ_INSERT_TAIL(&mk->cues, mc, link);
+  ebml_writer_t *ew = &mk->cuew;
+
+  /* all fields are known here, so serialize the cue point right away
+     instead of keeping a struct per cue for the whole recording */
+  ebml_wr_master(ew, 0xbb);
+  ebml_wr_uint(ew, 0xb3, pts);
+  ebml_wr_master(ew, 0xb7);
+  ebml_wr_uint(ew, 0xf7, tracknum);
+  ebml_wr_uint(ew, 0xf1, mk->cluster_pos - mk->segment_pos);
+  ebml_wr_master_end(ew);
+  ebml_wr_master_end(ew);
 }
 
 
@@ -1055,14 +1053,43 @@ mk_add_chapter(mk_muxer_t *mk, int64_t ts)
 }
 
 /**
- *
+ * EBML appends into the flat cluster build buffer
+ */
+static void
+mk_cluster_append_size(sbuf_t *sb, uint32_t size)
+{
+  uint8_t u8[5];
+
+  sbuf_append(sb, u8, mk_ebml_size(u8, size));
+}
+
+static void
+mk_cluster_append_uint(sbuf_t *sb, uint8_t id, int64_t ui)
+{
+  uint8_t u8[8] = {ui >> 56, ui >> 48, ui >> 40, ui >> 32,
+                   ui >> 24, ui >> 16, ui >>  8, ui };
+  int i = 0;
+
+  while( i < 7 && !u8[i] )
+    ++i;
+  sbuf_put_byte(sb, id);
+  mk_cluster_append_size(sb, 8 - i);
+  sbuf_append(sb, u8 + i, 8 - i);
+}
+
+
+/**
+ * Write the finished cluster with a single writev(); the build buffer
+ * is kept allocated for the next cluster
  */
 static void
 mk_close_cluster(mk_muxer_t *mk)
 {
-  if(mk->cluster != NULL)
-    mk_write_master(mk, 0x1f43b675, mk->cluster);
-  mk->cluster = NULL;
+  if(mk->cluster_open) {
+    mk_write_flat(mk, 0x1f43b675, &mk->cluster);
+    sbuf_reset(&mk->cluster, mk->cluster_maxsize + 65536);
+    mk->cluster_open = 0;
+  }
   mk->cluster_last_close = mclk();
 }
 
@@ -1111,31 +1138,36 @@ mk_write_frame_i(mk_muxer_t *mk, mk_track_t *t, th_pkt_t *pkt)
     return;
   }
 
-  if(mk->cluster) {
+  if(mk->cluster_open) {
 
     if(keyframe &&
-       (mk->cluster->hq_size > mk->cluster_maxsize ||
+       (mk->cluster.sb_ptr > mk->cluster_maxsize ||
         mk->cluster_last_close + sec2mono(1) < mclk()))
       mk_close_cluster(mk);
 
     else if(!mk->has_video &&
-            (mk->cluster->hq_size > mk->cluster_maxsize/40 ||
+            (mk->cluster.sb_ptr > mk->cluster_maxsize/40 ||
              mk->cluster_last_close + sec2mono(1) < mclk()))
       mk_close_cluster(mk);
 
-    else if(mk->cluster->hq_size > mk->cluster_maxsize)
+    else if(mk->cluster.sb_ptr > mk->cluster_maxsize)
       mk_close_cluster(mk);
 
   }
 
-  if(mk->cluster == NULL) {
+  if(!mk->cluster_open) {
     mk->cluster_tc = pts;
-    mk->cluster = htsbuf_queue_alloc(0);
+    if(mk->cluster.sb_data == NULL)
+      /* time-based closes keep clusters well below the size limit,
+         so start below it and let the buffer settle at the size the
+         stream really needs */
+      sbuf_init_fixed(&mk->cluster, mk->cluster_maxsize / 4 + 65536);
+    mk->cluster_open = 1;
 
     mk->cluster_pos = mk->fdpos;
     mk->addcue = 1;
 
-    ebml_append_uint(mk->cluster, 0xe7, mk->cluster_tc);
+    mk_cluster_append_uint(&mk->cluster, 0xe7, mk->cluster_tc);
     delta = 0;
   }
 
@@ -1153,16 +1185,16 @@ mk_write_frame_i(mk_muxer_t *mk, mk_track_t *t, th_pkt_t *pkt)
     data += 7;
   }
 
-  ebml_append_id(mk->cluster, 0xa3 ); // SimpleBlock
-  ebml_append_size(mk->cluster, len + 4);
-  ebml_append_size(mk->cluster, t->tracknum);
+  sbuf_put_byte(&mk->cluster, 0xa3); // SimpleBlock
+  mk_cluster_append_size(&mk->cluster, len + 4);
+  mk_cluster_append_size(&mk->cluster, t->tracknum);
 
   c_delta_flags[0] = delta >> 8;
   c_delta_flags[1] = delta;
   if (audio && pkt->a.pkt_keyframe) keyframe = 1;
   c_delta_flags[2] = (keyframe << 7) | skippable;
-  htsbuf_append(mk->cluster, c_delta_flags, 3);
-  htsbuf_append(mk->cluster, data, len);
+  sbuf_append(&mk->cluster, c_delta_flags, 3);
+  sbuf_append(&mk->cluster, data, len);
 }
 
 
@@ -1172,32 +1204,12 @@ mk_write_frame_i(mk_muxer_t *mk, mk_track_t *t, th_pkt_t *pkt)
 static void
 mk_write_cues(mk_muxer_t *mk)
 {
-  mk_cue_t *mc;
-  htsbuf_queue_t *q, *c, *p;
-
-  if(TAILQ_FIRST(&mk->cues) == NULL)
+  if(mk->cuew.ew_buf.sb_ptr == 0)
     return;
 
-  q = htsbuf_queue_alloc(0);
-
-  while((mc = TAILQ_FIRST(&mk->cues)) != NULL) {
-    TAILQ_REMOVE(&mk->cues, mc, link);
-
-    c = htsbuf_queue_alloc(0);
-
-    ebml_append_uint(c, 0xb3, mc->ts);
-
-    p = htsbuf_queue_alloc(0);
-    ebml_append_uint(p, 0xf7, mc->tracknum);
-    ebml_append_uint(p, 0xf1, mc->cluster_pos - mk->segment_pos);
-
-    ebml_append_master(c, 0xb7, p);
-    ebml_append_master(q, 0xbb, c);
-    free(mc);
-  }
-
   mk->cue_pos = mk->fdpos;
-  mk_write_master(mk, 0x1c53bb6b, q);
+  mk_write_flat(mk, 0x1c53bb6b, &mk->cuew.ew_buf);
+  ebml_wr_free(&mk->cuew);
 }
 
 
@@ -1319,9 +1331,13 @@ mk_mux_close(mk_muxer_t *mk)
 
   if(mk->seekable) {
     // Rewrite segment info to update duration
-    if(lseek(mk->fd, mk->segmentinfo_pos, SEEK_SET) == mk->segmentinfo_pos)
-      mk_write_master(mk, 0x1549a966, mk_build_segment_info(mk));
-    else {
+    if(lseek(mk->fd, mk->segmentinfo_pos, SEEK_SET) == mk->segmentinfo_pos) {
+      ebml_writer_t ew;
+      ebml_wr_init(&ew);
+      mk_build_segment_info(mk, &ew);
+      mk_write_buf(mk, &ew.ew_buf);
+      ebml_wr_free(&ew);
+    } else {
       mk->error = errno;
       tvherror(LS_MKV, "%s: Unable to write duration, seek failed -- %s",
 	       mk->filename, strerror(errno));
@@ -1336,6 +1352,8 @@ mk_mux_close(mk_muxer_t *mk)
 	       mk->filename, strerror(errno));
     }
 
+    muxer_cache_final((muxer_t *)mk, mk->fd, totsize);
+
     if(close(mk->fd)) {
       mk->error = errno;
       tvherror(LS_MKV, "%s: Unable to close the file descriptor, close failed -- %s",
@@ -1385,7 +1403,7 @@ static int
 mkv_muxer_init(muxer_t *m, streaming_start_t *ss, const char *name)
 {
   mk_muxer_t *mk = (mk_muxer_t *)m;
-  htsbuf_queue_t q, *a;
+  ebml_writer_t ew;
 
   uuid_random(mk->uuid, sizeof(mk->uuid));
 
@@ -1394,26 +1412,21 @@ mkv_muxer_init(muxer_t *m, streaming_start_t *ss, const char *name)
   else
     mk->title = strdup(mk->filename);
 
-  TAILQ_INIT(&mk->cues);
   TAILQ_INIT(&mk->chapters);
 
-  htsbuf_queue_init(&q, 0);
+  ebml_wr_init(&ew);
 
-  ebml_append_master(&q, 0x1a45dfa3, mk_build_ebmlheader(mk));
+  mk_build_ebmlheader(mk, &ew);
 
-  mk->segment_header_pos = q.hq_size;
-  a = mk_build_segment_header(0);
-  htsbuf_appendq(&q, a);
-  htsbuf_queue_free(a);
+  mk->segment_header_pos = ew.ew_buf.sb_ptr;
+  mk_append_segment_header(&ew, 0);
 
-  mk->segment_pos = q.hq_size;
-  a = mk_build_segment(mk, ss);
-  htsbuf_appendq(&q, a);
-  htsbuf_queue_free(a);
+  mk->segment_pos = ew.ew_buf.sb_ptr;
+  mk_build_segment(mk, ss, &ew);
 
-  mk_write_queue(mk, &q);
+  mk_write_buf(mk, &ew.ew_buf);
 
-  htsbuf_queue_flush(&q);
+  ebml_wr_free(&ew);
 
   return mk->error;
 }
@@ -1536,14 +1549,15 @@ mkv_muxer_write_meta(muxer_t *m, struct epg_broadcast *eb,
                      const char *comment)
 {
   mk_muxer_t *mk = (mk_muxer_t*)m;
-  htsbuf_queue_t q;
+  ebml_writer_t ew;
 
   if(!mk->metadata_pos)
     mk->metadata_pos = mk->fdpos;
 
-  htsbuf_queue_init(&q, 0);
-  ebml_append_master(&q, 0x1254c367, _mk_build_metadata(NULL, eb, comment));
-  mk_write_queue(mk, &q);
+  ebml_wr_init(&ew);
+  _mk_build_metadata(&ew, NULL, eb, comment);
+  mk_write_flat(mk, 0x1254c367, &ew.ew_buf);
+  ebml_wr_free(&ew);
 
   if (mk->error) {
     mk->m_errors++;
@@ -1589,6 +1603,9 @@ mkv_muxer_destroy(muxer_t *m)
     free(ch);
   }
 
+  ebml_wr_free(&mk->cuew);
+  sbuf_free(&mk->cluster);
+
   free(mk->filename);
   free(mk->tracks);
   free(mk->title);
@@ -21,6 +21,7 @@
 #include <fcntl.h>
 #include <assert.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
 #include "tvheadend.h"
 #include "streaming.h"
@@ -30,6 +31,12 @@
 #include "muxer_pass.h"
 #include "spawn.h"
 
+#define PASS_MUXER_MAXIOV 64
+
+/* O_DIRECT staging block (MC_CACHE_DIRECT) */
+#define PASS_MUXER_DIRECT_BLOCK (1024*1024)
+#define PASS_MUXER_DIRECT_ALIGN 4096
+
 typedef struct pass_muxer {
   muxer_t;
 
@@ -41,6 +48,21 @@ typedef struct pass_muxer {
   int   pm_error;
   int   pm_spawn_pid;
 
+  /* O_DIRECT output - data is staged into an aligned block and only
+   * full blocks are submitted, keeping every write inside the
+   * direct I/O alignment contract */
+  int      pm_direct;
+  uint8_t *pm_dbuf;
+  size_t   pm_dbuf_used;
+
+  /* Batched (writev) output for non-seekable streams */
+  int      pm_batch;
+  int      pm_iov_cnt;
+  size_t   pm_iov_bytes;
+  int64_t  pm_iov_mono;   /* arrival time of the oldest queued block */
+  struct iovec pm_iov[PASS_MUXER_MAXIOV];
+  pktbuf_t *pm_iov_pb[PASS_MUXER_MAXIOV];
+
   /* Filename is also used for logging */
   char *pm_filename;
 
@@ -72,6 +94,9 @@ typedef struct pass_muxer {
 static void
 pass_muxer_write(muxer_t *m, const void *data, size_t size);
 
+static void
+pass_muxer_queue(pass_muxer_t *pm, pktbuf_t *pb, void *data, size_t size);
+
 /*
  * Rewrite a PAT packet to only include the service included in the transport stream.
  */
@@ -102,10 +127,8 @@ pass_muxer_pat_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
 
   ol = dvb_table_append_crc32(out, 12, sizeof(out));
 
-  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0) {
-    pass_muxer_write((muxer_t *)pm, ob, l);
-    free(ob);
-  }
+  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0)
+    pass_muxer_queue(pm, NULL, ob, l);
 }
 
 /*
@@ -178,10 +201,8 @@ pass_muxer_pmt_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
 
   ol = dvb_table_append_crc32(out, ol, sizeof(out));
 
-  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0) {
-    pass_muxer_write((muxer_t *)pm, ob, l);
-    free(ob);
-  }
+  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0)
+    pass_muxer_queue(pm, NULL, ob, l);
 }
 
 /*
@@ -239,10 +260,8 @@ pass_muxer_sdt_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
 
   ol = dvb_table_append_crc32(out, ol, sizeof(out));
 
-  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0) {
-    pass_muxer_write((muxer_t *)pm, ob, l);
-    free(ob);
-  }
+  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0)
+    pass_muxer_queue(pm, NULL, ob, l);
 }
 
 /*
@@ -326,10 +345,8 @@ pass_muxer_nit_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
 
   ol = dvb_table_append_crc32(out, ol, sizeof(out));
 
-  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0) {
-    pass_muxer_write((muxer_t *)pm, ob, l);
-    free(ob);
-  }
+  if (ol > 0 && (l = dvb_table_remux(mt, out, ol, &ob)) > 0)
+    pass_muxer_queue(pm, NULL, ob, l);
 }
 
 /*
@@ -369,10 +386,8 @@ pass_muxer_eit_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
   }
 
   len = dvb_table_append_crc32(sbuf, len, len + 4);
-  if (len > 0 && (olen = dvb_table_remux(mt, sbuf, len, &out)) > 0) {
-    pass_muxer_write((muxer_t *)pm, out, olen);
-    free(out);
-  }
+  if (len > 0 && (olen = dvb_table_remux(mt, sbuf, len, &out)) > 0)
+    pass_muxer_queue(pm, NULL, out, olen);
 
   free(sbuf);
 }
@@ -536,6 +551,8 @@ pass_muxer_open_stream(muxer_t *m, int fd)
   pm->pm_ofd      = fd;
   pm->pm_seekable = 0;
   pm->pm_filename = strdup("Live stream");
+  pm->pm_batch    = pm->m_config.m_output_chunk <= 0 &&
+                    pm->m_config.u.pass.m_flush_bytes > 0;
 
   return pass_muxer_open2(pm);
 }
@@ -550,9 +567,27 @@ pass_muxer_open_file(muxer_t *m, const char *filename)
   int fd;
   pass_muxer_t *pm = (pass_muxer_t*)m;
 
+  int flags = O_WRONLY | O_CREAT | O_TRUNC;
+  int r;
+
   tvhtrace(LS_PASS, "Creating file \"%s\" with file permissions \"%o\"", filename, pm->m_config.m_file_permissions);
- 
-  fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, pm->m_config.m_file_permissions);
+
+#ifdef O_DIRECT
+  if (pm->m_config.m_cache == MC_CACHE_DIRECT)
+    flags |= O_DIRECT;
+#endif
+
+  fd = open(filename, flags, pm->m_config.m_file_permissions);
+
+#ifdef O_DIRECT
+  if (fd < 0 && (flags & O_DIRECT) != 0) {
+    /* not supported by this filesystem */
+    tvhwarn(LS_PASS, "%s: direct I/O not supported, using cached writes",
+            filename);
+    flags &= ~O_DIRECT;
+    fd = open(filename, flags, pm->m_config.m_file_permissions);
+  }
+#endif
 
   if(fd < 0) {
     pm->pm_error = errno;
@@ -572,10 +607,63 @@ pass_muxer_open_file(muxer_t *m, const char *filename)
   pm->pm_ofd      = fd;
   pm->pm_filename = strdup(filename);
 
-  return pass_muxer_open2(pm);
+#ifdef O_DIRECT
+  if ((flags & O_DIRECT) != 0 &&
+      posix_memalign((void **)&pm->pm_dbuf, PASS_MUXER_DIRECT_ALIGN,
+                     PASS_MUXER_DIRECT_BLOCK) == 0)
+    pm->pm_direct = 1;
+#endif
+
+  r = pass_muxer_open2(pm);
+
+#ifdef O_DIRECT
+  if (pm->pm_direct && pm->pm_fd != pm->pm_ofd) {
+    /* a pipe command writes the file itself - alignment not guaranteed */
+    fcntl(pm->pm_ofd, F_SETFL, fcntl(pm->pm_ofd, F_GETFL) & ~O_DIRECT);
+    free(pm->pm_dbuf);
+    pm->pm_dbuf = NULL;
+    pm->pm_direct = 0;
+  }
+#endif
+
+  return r;
 }
 
 
+/**
+ * Stage data into the aligned block and submit only full blocks
+ */
+static void
+pass_muxer_write_direct(pass_muxer_t *pm, const void *data, size_t size)
+{
+  const uint8_t *src = data;
+  size_t n;
+
+  while (size > 0) {
+    n = MIN(size, PASS_MUXER_DIRECT_BLOCK - pm->pm_dbuf_used);
+    memcpy(pm->pm_dbuf + pm->pm_dbuf_used, src, n);
+    pm->pm_dbuf_used += n;
+    src += n;
+    size -= n;
+    if (pm->pm_dbuf_used < PASS_MUXER_DIRECT_BLOCK)
+      break;
+    pm->pm_dbuf_used = 0;
+    if (tvh_write(pm->pm_fd, pm->pm_dbuf, PASS_MUXER_DIRECT_BLOCK)) {
+      pm->pm_error = errno;
+      if (!MC_IS_EOS_ERROR(errno))
+        tvherror(LS_PASS, "%s: Write failed -- %s", pm->pm_filename,
+                 strerror(errno));
+      else
+        /* this is an end-of-streaming notification */
+        pm->m_eos = 1;
+      pm->m_errors++;
+      return;
+    }
+    muxer_cache_update((muxer_t *)pm, pm->pm_fd, pm->pm_off, 0);
+    pm->pm_off += PASS_MUXER_DIRECT_BLOCK;
+  }
+}
+
 /**
  * Write data to the file descriptor
  */
@@ -588,8 +676,13 @@ pass_muxer_write(muxer_t *m, const void *data, size_t size)
   if(pm->pm_error) {
     pm->m_errors++;
     return;
-  } 
-  
+  }
+
+  if (pm->pm_direct) {
+    pass_muxer_write_direct(pm, data, size);
+    return;
+  }
+
   if (pm->m_config.m_output_chunk > 0) {
     ret = tvh_write_in_chunks(pm->pm_fd, data, size, pm->m_config.m_output_chunk);
   } else {
@@ -617,6 +710,103 @@ pass_muxer_write(muxer_t *m, const void *data, size_t size)
 }
 
 
+/**
+ * Flush the batched output queue with a single writev()
+ */
+static void
+pass_muxer_write_flush(pass_muxer_t *pm)
+{
+  struct iovec iov[PASS_MUXER_MAXIOV], *p = iov;
+  int i, cnt = pm->pm_iov_cnt;
+  int64_t limit = mclk() + sec2mono(25);
+  ssize_t c;
+
+  if (cnt == 0)
+    return;
+
+  if (pm->pm_error) {
+    pm->m_errors++;
+  } else {
+    memcpy(iov, pm->pm_iov, cnt * sizeof(*iov));
+    while (cnt > 0) {
+      c = writev(pm->pm_fd, p, cnt);
+      if (c < 0) {
+        if (ERRNO_AGAIN(errno)) {
+          if (mclk() > limit)
+            break;
+          tvh_safe_usleep(100);
+          continue;
+        }
+        break;
+      }
+      pm->pm_off += c;
+      while (cnt > 0 && (size_t)c >= p->iov_len) {
+        c -= p->iov_len;
+        p++;
+        cnt--;
+      }
+      if (cnt > 0) {
+        p->iov_base += c;
+        p->iov_len -= c;
+      }
+    }
+    if (cnt > 0) {
+      pm->pm_error = errno;
+      if (!MC_IS_EOS_ERROR(errno))
+        tvherror(LS_PASS, "%s: Write failed -- %s", pm->pm_filename,
+                 strerror(errno));
+      else
+        /* this is an end-of-streaming notification */
+        pm->m_eos = 1;
+      pm->m_errors++;
+    }
+  }
+
+  for (i = 0; i < pm->pm_iov_cnt; i++) {
+    if (pm->pm_iov_pb[i])
+      pktbuf_ref_dec(pm->pm_iov_pb[i]);
+    else
+      free(pm->pm_iov[i].iov_base);
+  }
+  pm->pm_iov_cnt = 0;
+  pm->pm_iov_bytes = 0;
+}
+
+
+/**
+ * Queue a block for the batched writev() path; data either points into
+ * pb (a reference is taken to keep it alive) or is a malloc()ed block
+ * the queue adopts.  The queue is flushed once it collects enough
+ * bytes or entries, or once the oldest block has waited long enough.
+ */
+static void
+pass_muxer_queue(pass_muxer_t *pm, pktbuf_t *pb, void *data, size_t size)
+{
+  const muxer_config_t *mc = &pm->m_config;
+
+  if (!pm->pm_batch) {
+    pass_muxer_write((muxer_t *)pm, data, size);
+    if (pb == NULL)
+      free(data);
+    return;
+  }
+
+  if (pm->pm_iov_cnt == 0)
+    pm->pm_iov_mono = getfastmonoclock();
+  pm->pm_iov[pm->pm_iov_cnt].iov_base = data;
+  pm->pm_iov[pm->pm_iov_cnt].iov_len = size;
+  pm->pm_iov_pb[pm->pm_iov_cnt] = pb ? pktbuf_ref_inc(pb) : NULL;
+  pm->pm_iov_cnt++;
+  pm->pm_iov_bytes += size;
+
+  if (pm->pm_iov_cnt >= PASS_MUXER_MAXIOV ||
+      pm->pm_iov_bytes >= (size_t)mc->u.pass.m_flush_bytes ||
+      (mc->u.pass.m_flush_time > 0 &&
+       getfastmonoclock() - pm->pm_iov_mono >= ms2mono(mc->u.pass.m_flush_time)))
+    pass_muxer_write_flush(pm);
+}
+
+
 /**
  * Write TS packets to the file descriptor
  */
@@ -647,7 +837,7 @@ pass_muxer_write_ts(muxer_t *m, pktbuf_t *pb)
 
         /* Flush */
         if (len)
-          pass_muxer_write(m, pkt, len);
+          pass_muxer_queue(pm, pb, pkt, len);
 
         /* Store new start point (after these packets) */
         pkt = tsb + l;
@@ -689,7 +879,7 @@ pass_muxer_write_ts(muxer_t *m, pktbuf_t *pb)
   }
 
   if (len)
-    pass_muxer_write(m, pkt, len);
+    pass_muxer_queue(pm, pb, pkt, len);
 }
 
 
@@ -737,9 +927,27 @@ pass_muxer_close(muxer_t *m)
 {
   pass_muxer_t *pm = (pass_muxer_t*)m;
 
+  pass_muxer_write_flush(pm);
   if(pm->pm_spawn_pid > 0)
     spawn_kill(pm->pm_spawn_pid, tvh_kill_to_sig(pm->m_config.u.pass.m_killsig),
                pm->m_config.u.pass.m_killtimeout);
+#ifdef O_DIRECT
+  if(pm->pm_direct && pm->pm_dbuf_used > 0 && !pm->pm_error) {
+    /* drop O_DIRECT for the final partial block */
+    fcntl(pm->pm_ofd, F_SETFL, fcntl(pm->pm_ofd, F_GETFL) & ~O_DIRECT);
+    if (tvh_write(pm->pm_ofd, pm->pm_dbuf, pm->pm_dbuf_used)) {
+      pm->pm_error = errno;
+      tvherror(LS_PASS, "%s: Write failed -- %s", pm->pm_filename,
+               strerror(errno));
+      pm->m_errors++;
+    } else {
+      pm->pm_off += pm->pm_dbuf_used;
+    }
+    pm->pm_dbuf_used = 0;
+  }
+#endif
+  if(pm->pm_seekable)
+    muxer_cache_final(m, pm->pm_ofd, pm->pm_off);
   if(pm->pm_seekable && close(pm->pm_ofd)) {
     pm->pm_error = errno;
     tvherror(LS_PASS, "%s: Unable to close file, close failed -- %s",
@@ -759,6 +967,17 @@ static void
 pass_muxer_destroy(muxer_t *m)
 {
   pass_muxer_t *pm = (pass_muxer_t*)m;
+  int i;
+
+  /* close() flushed the queue; just drop anything left if it never ran */
+  for (i = 0; i < pm->pm_iov_cnt; i++) {
+    if (pm->pm_iov_pb[i])
+      pktbuf_ref_dec(pm->pm_iov_pb[i]);
+    else
+      free(pm->pm_iov[i].iov_base);
+  }
+
+  free(pm->pm_dbuf);
 
   if(pm->pm_filename)
     free(pm->pm_filename);
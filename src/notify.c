@@ -49,11 +49,18 @@ notify_reload(const char *class)
   notify_by_msg(class, m, 0, 0);
 }
 
+/* Mass operations (EPG grab commit, service mapper) can queue thousands
+   of ids for one event class within a single batching window; past this
+   bound the batch collapses into one reload message and the clients
+   resync, which also keeps the duplicate scan below bounded cost */
+#define NOTIFY_DELAYED_MAX 128
+
 void
 notify_delayed(const char *id, const char *event, const char *action)
 {
   htsmsg_t *m = NULL, *e = NULL;
   htsmsg_field_t *f;
+  int count;
 
   if (!tvheadend_is_running())
     return;
@@ -67,14 +74,25 @@ notify_delayed(const char *id, const char *event, const char *action)
   if (m == NULL) {
     m = htsmsg_add_msg(notify_queue, event, htsmsg_create_map());
   } else {
+    if (htsmsg_get_u32_or_default(m, "reload", 0))
+      goto skip; /* batch already collapsed, the reload covers this id */
     e = htsmsg_get_list(m, action);
   }
   if (e == NULL)
     e = htsmsg_add_msg(m, action, htsmsg_create_list());
-  HTSMSG_FOREACH(f, e)
+  count = 0;
+  HTSMSG_FOREACH(f, e) {
     if (strcmp(htsmsg_field_get_str(f) ?: "", id) == 0)
       goto skip;
-  htsmsg_add_str(e, NULL, id);
+    count++;
+  }
+  if (count >= NOTIFY_DELAYED_MAX) {
+    htsmsg_delete_field(notify_queue, event);
+    m = htsmsg_add_msg(notify_queue, event, htsmsg_create_map());
+    htsmsg_add_u32(m, "reload", 1);
+  } else {
+    htsmsg_add_str(e, NULL, id);
+  }
   tvh_cond_signal(&notify_cond, 0);
 skip:
   tvh_mutex_unlock(&notify_mutex);
@@ -70,6 +70,7 @@ pkt_alloc(streaming_component_type_t type, const uint8_t *data, size_t datalen,
   pkt = calloc(1, sizeof(th_pkt_t));
   if (pkt) {
     pkt->pkt_type = type;
+    pkt->pkt_ctime = getfastmonoclock();
     pkt->pkt_payload = payload;
     pkt->pkt_dts = dts;
     pkt->pkt_pts = pts;
@@ -326,28 +327,268 @@ pktref_create(th_pkt_t *pkt)
 }
 
 /*
+ * Packet buffer pool
  *
+ * Payload buffers are rounded up to a small set of size classes and
+ * recycled through a per-thread cache backed by a shared pool, so the
+ * parser hot path does not hit the allocator for every ES packet.
+ * The cached buffers are ordinary malloc blocks, so they may still be
+ * passed to realloc/free when a caller outgrows the class size.
  */
 
-void
-pktbuf_destroy(pktbuf_t *pb)
+#define PKTBUF_POOL_CLASSES   5
+#define PKTBUF_POOL_HDRS      128
+
+static const size_t pktbuf_pool_sizes[PKTBUF_POOL_CLASSES] =
+  { 512, 2048, 8192, 32768, 131072 };
+/* per-thread cache limits (buffers) */
+static const int pktbuf_pool_limits[PKTBUF_POOL_CLASSES] =
+  { 64, 32, 16, 8, 4 };
+/* shared pool limits (buffers) - refills the caches of the allocating
+   threads, the freeing threads are usually different ones */
+static const int pktbuf_pool_glimits[PKTBUF_POOL_CLASSES] =
+  { 256, 128, 64, 32, 16 };
+
+typedef struct pktbuf_pool_entry {
+  struct pktbuf_pool_entry *next;
+} pktbuf_pool_entry_t;
+
+typedef struct pktbuf_pool {
+  pktbuf_pool_entry_t *pp_bufs[PKTBUF_POOL_CLASSES];
+  int                  pp_counts[PKTBUF_POOL_CLASSES];
+  pktbuf_t            *pp_hdrs;
+  int                  pp_hdrs_count;
+} pktbuf_pool_t;
+
+static pthread_key_t pktbuf_pool_key;
+static __thread pktbuf_pool_t *pktbuf_pool;
+
+static tvh_mutex_t pktbuf_pool_global_lock = TVH_THREAD_MUTEX_INITIALIZER;
+static pktbuf_pool_entry_t *pktbuf_pool_global[PKTBUF_POOL_CLASSES];
+static int pktbuf_pool_global_counts[PKTBUF_POOL_CLASSES];
+
+static int64_t pktbuf_pool_hit;
+static int64_t pktbuf_pool_miss;
+static int64_t pktbuf_pool_cached_size;
+static int64_t pktbuf_pool_cached_count;
+
+static int
+pktbuf_pool_class(size_t size)
 {
-  if (pb) {
-    memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
-    free(pb->pb_data);
+  int i;
+  for (i = 0; i < PKTBUF_POOL_CLASSES; i++)
+    if (size <= pktbuf_pool_sizes[i])
+      return i;
+  return -1;
+}
+
+static int
+pktbuf_pool_class_exact(size_t alloc)
+{
+  int i;
+  for (i = 0; i < PKTBUF_POOL_CLASSES; i++)
+    if (alloc == pktbuf_pool_sizes[i])
+      return i;
+  return -1;
+}
+
+static void
+pktbuf_pool_thread_destroy(void *aux)
+{
+  pktbuf_pool_t *pp = aux;
+  pktbuf_pool_entry_t *pe;
+  pktbuf_t *pb;
+  int i;
+
+  for (i = 0; i < PKTBUF_POOL_CLASSES; i++)
+    while ((pe = pp->pp_bufs[i]) != NULL) {
+      pp->pp_bufs[i] = pe->next;
+      atomic_dec_s64(&pktbuf_pool_cached_size, pktbuf_pool_sizes[i]);
+      atomic_dec_s64(&pktbuf_pool_cached_count, 1);
+      free(pe);
+    }
+  while ((pb = pp->pp_hdrs) != NULL) {
+    pp->pp_hdrs = (pktbuf_t *)pb->pb_data;
+    free(pb);
+  }
+  free(pp);
+}
+
+static pktbuf_pool_t *
+pktbuf_pool_get(void)
+{
+  pktbuf_pool_t *pp = pktbuf_pool;
+  if (pp == NULL) {
+    pp = calloc(1, sizeof(*pp));
+    if (pp == NULL || pthread_setspecific(pktbuf_pool_key, pp)) {
+      free(pp);
+      return NULL;
+    }
+    pktbuf_pool = pp;
+  }
+  return pp;
+}
+
+static uint8_t *
+pktbuf_pool_get_buffer(int cls)
+{
+  pktbuf_pool_t *pp = pktbuf_pool_get();
+  pktbuf_pool_entry_t *pe = NULL;
+
+  if (pp && (pe = pp->pp_bufs[cls]) != NULL) {
+    pp->pp_bufs[cls] = pe->next;
+    pp->pp_counts[cls]--;
+  } else if (pktbuf_pool_global_counts[cls] > 0) { /* unlocked peek */
+    tvh_mutex_lock(&pktbuf_pool_global_lock);
+    if ((pe = pktbuf_pool_global[cls]) != NULL) {
+      pktbuf_pool_global[cls] = pe->next;
+      pktbuf_pool_global_counts[cls]--;
+    }
+    tvh_mutex_unlock(&pktbuf_pool_global_lock);
+  }
+  if (pe == NULL) {
+    atomic_add_s64(&pktbuf_pool_miss, 1);
+    return malloc(pktbuf_pool_sizes[cls]);
+  }
+  atomic_add_s64(&pktbuf_pool_hit, 1);
+  atomic_dec_s64(&pktbuf_pool_cached_size, pktbuf_pool_sizes[cls]);
+  atomic_dec_s64(&pktbuf_pool_cached_count, 1);
+  return (uint8_t *)pe;
+}
+
+static void
+pktbuf_pool_put_buffer(uint8_t *buffer, int cls)
+{
+  pktbuf_pool_t *pp = pktbuf_pool_get();
+  pktbuf_pool_entry_t *pe = (pktbuf_pool_entry_t *)buffer;
+
+  if (pp && pp->pp_counts[cls] < pktbuf_pool_limits[cls]) {
+    pe->next = pp->pp_bufs[cls];
+    pp->pp_bufs[cls] = pe;
+    pp->pp_counts[cls]++;
+  } else {
+    tvh_mutex_lock(&pktbuf_pool_global_lock);
+    if (pktbuf_pool_global_counts[cls] < pktbuf_pool_glimits[cls]) {
+      pe->next = pktbuf_pool_global[cls];
+      pktbuf_pool_global[cls] = pe;
+      pktbuf_pool_global_counts[cls]++;
+    } else {
+      pe = NULL;
+    }
+    tvh_mutex_unlock(&pktbuf_pool_global_lock);
+    if (pe == NULL) {
+      free(buffer);
+      return;
+    }
+  }
+  atomic_add_s64(&pktbuf_pool_cached_size, pktbuf_pool_sizes[cls]);
+  atomic_add_s64(&pktbuf_pool_cached_count, 1);
+}
+
+static pktbuf_t *
+pktbuf_pool_get_hdr(void)
+{
+  pktbuf_pool_t *pp = pktbuf_pool_get();
+  pktbuf_t *pb;
+
+  if (pp && (pb = pp->pp_hdrs) != NULL) {
+    pp->pp_hdrs = (pktbuf_t *)pb->pb_data;
+    pp->pp_hdrs_count--;
+    return pb;
+  }
+  return malloc(sizeof(pktbuf_t));
+}
+
+static void
+pktbuf_pool_put_hdr(pktbuf_t *pb)
+{
+  pktbuf_pool_t *pp = pktbuf_pool_get();
+
+  if (pp && pp->pp_hdrs_count < PKTBUF_POOL_HDRS) {
+    pb->pb_data = (uint8_t *)pp->pp_hdrs;
+    pp->pp_hdrs = pb;
+    pp->pp_hdrs_count++;
+  } else {
     free(pb);
   }
 }
 
+static void
+pktbuf_free0(pktbuf_t *pb)
+{
+  int cls;
+
+  memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
+  if (pb->pb_data) {
+    cls = pktbuf_pool_class_exact(pb->pb_alloc);
+    if (cls >= 0)
+      pktbuf_pool_put_buffer(pb->pb_data, cls);
+    else
+      free(pb->pb_data);
+  }
+  pktbuf_pool_put_hdr(pb);
+}
+
+static void
+pktbuf_pool_memoryinfo_update(memoryinfo_t *my)
+{
+  memoryinfo_update(my, atomic_get_s64(&pktbuf_pool_cached_size),
+                        atomic_get_s64(&pktbuf_pool_cached_count));
+}
+
+static void
+pktbuf_pool_hit_memoryinfo_update(memoryinfo_t *my)
+{
+  memoryinfo_update(my, 0, atomic_get_s64(&pktbuf_pool_hit));
+}
+
+static void
+pktbuf_pool_miss_memoryinfo_update(memoryinfo_t *my)
+{
+  memoryinfo_update(my, 0, atomic_get_s64(&pktbuf_pool_miss));
+}
+
+static memoryinfo_t pktbuf_pool_memoryinfo = {
+  .my_name = "Packet buffer pool (cached)",
+  .my_update = pktbuf_pool_memoryinfo_update
+};
+
+static memoryinfo_t pktbuf_pool_hit_memoryinfo = {
+  .my_name = "Packet buffer pool (hits)",
+  .my_update = pktbuf_pool_hit_memoryinfo_update
+};
+
+static memoryinfo_t pktbuf_pool_miss_memoryinfo = {
+  .my_name = "Packet buffer pool (misses)",
+  .my_update = pktbuf_pool_miss_memoryinfo_update
+};
+
+void
+pktbuf_init(void)
+{
+  pthread_key_create(&pktbuf_pool_key, pktbuf_pool_thread_destroy);
+  memoryinfo_register(&pktbuf_pool_memoryinfo);
+  memoryinfo_register(&pktbuf_pool_hit_memoryinfo);
+  memoryinfo_register(&pktbuf_pool_miss_memoryinfo);
+}
+
+/*
+ *
+ */
+
+void
+pktbuf_destroy(pktbuf_t *pb)
+{
+  if (pb)
+    pktbuf_free0(pb);
+}
+
 void
 pktbuf_ref_dec(pktbuf_t *pb)
 {
   if (pb) {
-    if((atomic_add(&pb->pb_refcount, -1)) == 1) {
-      memoryinfo_free(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
-      free(pb->pb_data);
-      free(pb);
-    }
+    if((atomic_add(&pb->pb_refcount, -1)) == 1)
+      pktbuf_free0(pb);
   }
 }
 
@@ -365,16 +606,26 @@ pktbuf_t *
 pktbuf_alloc(const uint8_t *data, size_t size)
 {
   pktbuf_t *pb;
-  uint8_t *buffer;
-
-  buffer = size > 0 ? malloc(size) : NULL;
-  if (buffer) {\
+  uint8_t *buffer = NULL;
+  size_t alloc = 0;
+  int cls;
+
+  if (size > 0) {
+    cls = pktbuf_pool_class(size);
+    if (cls >= 0) {
+      alloc = pktbuf_pool_sizes[cls];
+      buffer = pktbuf_pool_get_buffer(cls);
+    } else {
+      alloc = size;
+      atomic_add_s64(&pktbuf_pool_miss, 1);
+      buffer = malloc(size);
+    }
+    if (buffer == NULL)
+      return NULL;
     if (data != NULL)
       memcpy(buffer, data, size);
-  } else if (size > 0) {
-    return NULL;
   }
-  pb = malloc(sizeof(pktbuf_t));
+  pb = pktbuf_pool_get_hdr();
   if (pb == NULL) {
     free(buffer);
     return NULL;
@@ -382,7 +633,9 @@ pktbuf_alloc(const uint8_t *data, size_t size)
   pb->pb_refcount = 1;
   pb->pb_data = buffer;
   pb->pb_size = size;
+  pb->pb_alloc = alloc;
   pb->pb_err = 0;
+  pb->pb_rtime = 0;
   memoryinfo_alloc(&pktbuf_memoryinfo, sizeof(*pb) + size);
   return pb;
 }
@@ -390,11 +643,14 @@ pktbuf_alloc(const uint8_t *data, size_t size)
 pktbuf_t *
 pktbuf_make(void *data, size_t size)
 {
-  pktbuf_t *pb = malloc(sizeof(pktbuf_t));
+  pktbuf_t *pb = pktbuf_pool_get_hdr();
   if (pb) {
     pb->pb_refcount = 1;
     pb->pb_size = size;
     pb->pb_data = data;
+    pb->pb_alloc = size;
+    pb->pb_err = 0;
+    pb->pb_rtime = 0;
     memoryinfo_alloc(&pktbuf_memoryinfo, sizeof(*pb) + pb->pb_size);
   }
   return pb;
@@ -406,11 +662,18 @@ pktbuf_append(pktbuf_t *pb, const void *data, size_t size)
   void *ndata;
   if (pb == NULL)
     return pktbuf_alloc(data, size);
+  if (pb->pb_size + size <= pb->pb_alloc) {
+    memcpy(pb->pb_data + pb->pb_size, data, size);
+    pb->pb_size += size;
+    memoryinfo_append(&pktbuf_memoryinfo, size);
+    return pb;
+  }
   ndata = realloc(pb->pb_data, pb->pb_size + size);
   if (ndata) {
     pb->pb_data = ndata;
     memcpy(ndata + pb->pb_size, data, size);
     pb->pb_size += size;
+    pb->pb_alloc = pb->pb_size;
     memoryinfo_append(&pktbuf_memoryinfo, size);
   }
   return pb;
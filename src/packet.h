@@ -31,6 +31,8 @@ typedef struct pktbuf {
   int pb_err;
   uint8_t *pb_data;
   size_t pb_size;
+  size_t pb_alloc;
+  int64_t pb_rtime;  /* input arrival time, 0 = unknown */
 } pktbuf_t;
 
 /**
@@ -77,6 +79,8 @@ typedef struct th_pkt {
     } a;
   };
 
+  int64_t pkt_ctime;  /* creation time in the parser, 0 = unknown */
+
   pktbuf_t *pkt_meta;
   pktbuf_t *pkt_payload;
 
@@ -151,6 +155,8 @@ void pkt_trace_
  *
  */
 
+void pktbuf_init(void);
+
 void pktbuf_ref_dec(pktbuf_t *pb);
 
 void pktbuf_destroy(pktbuf_t *pb);
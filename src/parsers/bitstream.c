@@ -17,8 +17,14 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include "bitstream.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 
 int
@@ -42,69 +48,97 @@ init_wbits(bitstream_t *bs, uint8_t *data, uint32_t bits)
   return 0;
 }
 
+/* Assemble the pre-validated bit range [off, off+num) into the low
+ * bits of the result with a single wide load; num must be 1..32.
+ * The load is clamped to the buffer end near the tail, where the
+ * bounds check already guarantees the wanted bits exist. */
+static inline uint32_t
+extract_bits(const bitstream_t *bs, uint32_t off, uint32_t num)
+{
+  const uint8_t *p = bs->rdata + (off >> 3);
+  const uint8_t *end = bs->rdata + ((bs->len + 7) >> 3);
+  uint32_t shift = off & 7, i;
+  uint64_t x;
+
+  if (p + 8 <= end) {
+    x = ((uint64_t)RB32(p) << 32) | RB32(p + 4);
+  } else {
+    x = 0;
+    for (i = 0; p + i < end; i++)
+      x |= (uint64_t)p[i] << (56 - 8 * i);
+  }
+  return (x >> (64 - shift - num)) & (uint32_t)(0xffffffffULL >> (32 - num));
+}
+
 uint32_t
 read_bits(bitstream_t *bs, uint32_t num)
 {
-  uint32_t r = 0;
+  uint32_t r;
 
-  while(num > 0) {
-    if(bs->offset >= bs->len)
-      return 0;
-
-    num--;
-
-    if(bs->rdata[bs->offset / 8] & (1 << (7 - (bs->offset & 7))))
-      r |= 1 << num;
-
-    bs->offset++;
+  if (num == 0)
+    return 0;
+  if (bs->offset + num > bs->len) {
+    bs->offset = bs->len;
+    return 0;
   }
+  r = extract_bits(bs, bs->offset, num);
+  bs->offset += num;
   return r;
 }
 
 uint64_t
 read_bits64(bitstream_t *bs, uint32_t num)
 {
-  uint64_t r = 0;
-
-  while(num > 0) {
-    if(bs->offset >= bs->len)
-      return 0;
-
-    num--;
-
-    if(bs->rdata[bs->offset / 8] & (1 << (7 - (bs->offset & 7))))
-      r |= (int64_t)1 << num;
+  uint64_t r;
 
-    bs->offset++;
+  if (num == 0)
+    return 0;
+  if (bs->offset + num > bs->len) {
+    bs->offset = bs->len;
+    return 0;
+  }
+  if (num <= 32) {
+    r = extract_bits(bs, bs->offset, num);
+  } else {
+    r = (uint64_t)extract_bits(bs, bs->offset, num - 32) << 32;
+    r |= extract_bits(bs, bs->offset + (num - 32), 32);
   }
+  bs->offset += num;
   return r;
 }
 
 uint32_t
 show_bits(bitstream_t *bs, uint32_t num)
 {
-  uint32_t r = 0, offset = bs->offset;
-
-  while(num > 0) {
-    if(offset >= bs->len)
-      return 0;
-
-    num--;
-
-    if(bs->rdata[offset / 8] & (1 << (7 - (offset & 7))))
-      r |= 1 << num;
-
-    offset++;
-  }
-  return r;
+  if (num == 0 || bs->offset + num > bs->len)
+    return 0;
+  return extract_bits(bs, bs->offset, num);
 }
 
 uint32_t
 read_golomb_ue(bitstream_t *bs)
 {
-  uint32_t b;
+  uint32_t b, w, n, k;
   int lzb = -1;
 
+  if (bs->offset >= bs->len)
+    return 0;
+
+  /* peek the zero run and the stop bit in one go */
+  n = bs->len - bs->offset;
+  if (n > 32)
+    n = 32;
+  w = extract_bits(bs, bs->offset, n) << (32 - n);
+  if (w) {
+    k = __builtin_clz(w);
+    bs->offset += k + 1;
+    if (k == 0)
+      return 0;
+    return (1 << k) - 1 + read_bits(bs, k);
+  }
+
+  /* truncated or overlong zero run - keep the historic bit-loop
+     semantics for this corrupt-stream corner */
   for(b = 0; !b && !bs_eof(bs) && lzb < 32; lzb++)
     b = read_bits1(bs);
 
@@ -126,6 +160,65 @@ read_golomb_se(bitstream_t *bs)
 }
 
 
+/* Return the position of the first zero byte in [p, end), or end if
+ * there is none.  Runs 16 bytes per iteration with SSE2/NEON where
+ * available, with the classic 64-bit zero-mask trick as fallback;
+ * video payload bytes are almost always non-zero, so the scanners
+ * built on top of this skip whole blocks at a time. */
+const uint8_t *
+find_zero_byte(const uint8_t *p, const uint8_t *end)
+{
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  while (p + 16 <= end) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero));
+    if (mask)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t zero = vdupq_n_u8(0);
+  while (p + 16 <= end) {
+    uint8x16_t eq = vceqq_u8(vld1q_u8(p), zero);
+    uint64_t mask =
+      vget_lane_u64(vreinterpret_u64_u8(
+        vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    if (mask)
+      return p + (__builtin_ctzll(mask) >> 2);
+    p += 16;
+  }
+#else
+  uint64_t x;
+  while (p + 8 <= end) {
+    memcpy(&x, p, 8);
+    if ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL)
+      break;
+    p += 8;
+  }
+#endif
+  while (p < end && *p)
+    p++;
+  return p;
+}
+
+/* Find the first 00 00 01 start code in [p, end), or end if none.
+ * As with the byte-scanner this replaces, the last possible position
+ * (end - 3) is intentionally not examined; a code there belongs to
+ * the following unit. */
+const uint8_t *
+find_startcode(const uint8_t *p, const uint8_t *end)
+{
+  const uint8_t *z;
+
+  if (end - p < 4)
+    return end;
+  for (z = p; (z = find_zero_byte(z, end - 3)) < end - 3; z++)
+    if (z[1] == 0 && z[2] == 1)
+      return z;
+  return end;
+}
+
 void
 put_bits(bitstream_t *bs, uint32_t val, uint32_t num)
 {
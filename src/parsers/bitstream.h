@@ -43,7 +43,14 @@ uint64_t read_bits64(bitstream_t *gb, uint32_t num);
 uint32_t show_bits(bitstream_t *gb, uint32_t num);
 
 static inline unsigned int read_bits1(bitstream_t *gb)
-  { return read_bits(gb, 1); }
+  {
+    unsigned int r;
+    if (gb->offset >= gb->len)
+      return 0;
+    r = (gb->rdata[gb->offset >> 3] >> (7 - (gb->offset & 7))) & 1;
+    gb->offset++;
+    return r;
+  }
 
 unsigned int read_golomb_ue(bitstream_t *gb);
 
@@ -54,6 +61,10 @@ static inline uint32_t remaining_bits(bitstream_t *gb)
 
 void put_bits(bitstream_t *bs, uint32_t val, uint32_t num);
 
+/* vectorized scanners (SSE2/NEON with a 64-bit zero-mask fallback) */
+const uint8_t *find_zero_byte(const uint8_t *p, const uint8_t *end);
+const uint8_t *find_startcode(const uint8_t *p, const uint8_t *end);
+
 static inline int bs_eof(const bitstream_t *bs)
   { return bs->offset >= bs->len; }
 
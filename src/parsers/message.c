@@ -268,6 +268,7 @@ static void parser_clean_es(parser_es_t *pes)
   free(pes->es_global_data);
   pes->es_global_data = NULL;
   pes->es_global_data_len = 0;
+  pes->es_global_data_inbuf = 0;
 
   tvhlog_limit_reset(&pes->es_pes_log);
   tvhlog_limit_reset(&pes->es_pcr_log);
@@ -297,6 +298,25 @@ static void parser_input_start(parser_t *prs, streaming_message_t *sm)
   elementary_set_t *set = &prs->prs_components;
   elementary_stream_t *es;
 
+  /* Audio-only subscriptions keep just the audio components, so the
+     downstream chain neither frames nor waits for video/subtitles */
+  if (prs->prs_audio_only) {
+    streaming_start_t *ss2 = streaming_start_copy(ss);
+    streaming_start_component_t *ssc;
+    int i, j = 0;
+    for (i = 0; i < ss2->ss_num_components; i++) {
+      ssc = &ss2->ss_components[i];
+      if (SCT_ISAUDIO(ssc->es_type)) {
+        ss2->ss_components[j++] = *ssc;
+      } else if (ssc->ssc_gh) {
+        pktbuf_ref_dec(ssc->ssc_gh);
+      }
+    }
+    ss2->ss_num_components = j;
+    streaming_start_unref(ss);
+    sm->sm_data = ss = ss2;
+  }
+
   TAILQ_FOREACH(es, &set->set_all, es_link)
     parser_clean_es((parser_es_t *)es);
   elementary_set_clean(set, prs->prs_service, 1);
@@ -379,6 +399,7 @@ parser_create(streaming_target_t *output, th_subscription_t *ts)
   prs->prs_output = output;
   prs->prs_subscription = ts;
   prs->prs_service = t;
+  prs->prs_audio_only = (ts->ths_flags & SUBSCRIPTION_AUDIOONLY) != 0;
   TAILQ_INIT(&prs->prs_rstlog);
   elementary_set_init(&prs->prs_components, LS_PARSER, service_nicename(t), t);
   streaming_target_init(&prs->prs_input, &parser_input_ops, prs, 0);
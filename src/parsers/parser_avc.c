@@ -24,48 +24,10 @@
 #include "parser_h264.h"
 #include "bitstream.h"
 
-static const uint8_t *
-avc_find_startcode_internal(const uint8_t *p, const uint8_t *end)
-{
-  const uint8_t *a = p + 4 - ((intptr_t)p & 3);
-
-  for (end -= 3; p < a && p < end; p++) {
-    if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-      return p;
-  }
-
-  for (end -= 3; p < end; p += 4) {
-    uint32_t x = *(const uint32_t*)p;
-//  if ((x - 0x01000100) & (~x) & 0x80008000) // little endian
-//  if ((x - 0x00010001) & (~x) & 0x00800080) // big endian
-    if ((x - 0x01010101) & (~x) & 0x80808080) { // generic
-      if (p[1] == 0) {
-	if (p[0] == 0 && p[2] == 1)
-	  return p;
-	if (p[2] == 0 && p[3] == 1)
-	  return p+1;
-      }
-      if (p[3] == 0) {
-	if (p[2] == 0 && p[4] == 1)
-	  return p+2;
-	if (p[4] == 0 && p[5] == 1)
-	  return p+3;
-      }
-    }
-  }
-
-  for (end += 3; p < end; p++) {
-    if (p[0] == 0 && p[1] == 0 && p[2] == 1)
-      return p;
-  }
-
-  return end + 3;
-}
-
 const uint8_t *
 avc_find_startcode(const uint8_t *p, const uint8_t *end)
 {
-    const uint8_t *out= avc_find_startcode_internal(p, end);
+    const uint8_t *out= find_startcode(p, end);
     while(p<out && out<end && !out[-1]) out--;
     return out;
 }
@@ -186,17 +148,83 @@ end:
   return ret;
 }
 
+/* Rewrite the Annex-B units in [buf, buf+size) as length-prefixed
+ * units at dst.  dst may alias buf for in-place conversion provided
+ * every output offset stays at or before the matching input offset
+ * (the caller verifies this); the data then only ever moves leftwards
+ * and a length prefix never overwrites unconsumed payload. */
+static size_t avc_rewrite_nal_units(uint8_t *dst, const uint8_t *buf, int size)
+{
+  const uint8_t *p = buf;
+  const uint8_t *end = p + size;
+  const uint8_t *nal_start, *nal_end;
+  uint8_t *d = dst;
+  int l;
+
+  nal_start = avc_find_startcode(p, end);
+  for (;;) {
+    while (nal_start < end && !*(nal_start++));
+    if (nal_start == end)
+      break;
+
+    nal_end = avc_find_startcode(nal_start, end);
+
+    l = nal_end - nal_start;
+    *d++ = l >> 24;
+    *d++ = l >> 16;
+    *d++ = l >> 8;
+    *d++ = l;
+    if (d != nal_start)
+      memmove(d, nal_start, l);
+    d += l;
+    nal_start = nal_end;
+  }
+  return d - dst;
+}
+
 th_pkt_t *
 avc_convert_pkt(th_pkt_t *src)
 {
-  sbuf_t payload;
   th_pkt_t *pkt = pkt_copy_nodata(src);
+  pktbuf_t *pb = src->pkt_payload;
+  const uint8_t *p = pktbuf_ptr(pb);
+  const uint8_t *end = p + pktbuf_len(pb);
+  const uint8_t *nal_start, *nal_end;
+  size_t outlen = 0;
+  uint8_t *out;
+  int inplace;
+
+  /* Size the output and decide whether the conversion can happen
+   * inside the source buffer: the buffer must be uniquely referenced,
+   * each 4-byte length must fit in the start code (plus leading
+   * zeros) it replaces, and the total size must not change.  With
+   * the usual 4-byte start codes this rewrites the codes in place
+   * and shares the buffer instead of copying every video frame. */
+  inplace = atomic_get(&src->pkt_refcount) == 1 &&
+            atomic_get(&pb->pb_refcount) == 1;
+  nal_start = avc_find_startcode(p, end);
+  for (;;) {
+    while (nal_start < end && !*(nal_start++));
+    if (nal_start == end)
+      break;
 
-  sbuf_init(&payload);
+    nal_end = avc_find_startcode(nal_start, end);
 
-  avc_parse_nal_units(&payload, pktbuf_ptr(src->pkt_payload),
-		                pktbuf_len(src->pkt_payload));
-  
-  pkt->pkt_payload = pktbuf_make(payload.sb_data, payload.sb_ptr);
+    if (outlen + 4 > (size_t)(nal_start - p))
+      inplace = 0;
+    outlen += 4 + (nal_end - nal_start);
+    nal_start = nal_end;
+  }
+  if (outlen != pktbuf_len(pb))
+    inplace = 0;
+
+  if (inplace) {
+    avc_rewrite_nal_units(pb->pb_data, p, pktbuf_len(pb));
+    pkt->pkt_payload = pktbuf_ref_inc(pb);
+  } else {
+    out = malloc(outlen);
+    outlen = out ? avc_rewrite_nal_units(out, p, pktbuf_len(pb)) : 0;
+    pkt->pkt_payload = pktbuf_make(out, outlen);
+  }
   return pkt;
 }
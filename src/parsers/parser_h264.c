@@ -43,9 +43,8 @@
 void *
 h264_nal_deescape(bitstream_t *bs, const uint8_t *data, int size)
 {
-  uint_fast8_t c;
   uint8_t *d;
-  const uint8_t *end, *end2;
+  const uint8_t *z, *end, *end2;
 
   bs->rdata = d = malloc(size);
   bs->offset = 0;
@@ -54,17 +53,24 @@ h264_nal_deescape(bitstream_t *bs, const uint8_t *data, int size)
 
   if (size > 2) {
 
-    /* Escape 0x000003 into 0x0000 */
+    /* Escape 0x000003 into 0x0000 - emulation prevention bytes only
+       follow zero bytes, so bulk-copy up to the next zero and decide
+       there instead of crawling a byte at a time */
 
     end = end2 - 2;
     while (data < end) {
-      c = *data++;
-      if (c || *data || *(data + 1) != 3) {
-        *d++ = c;
-      } else {
+      z = find_zero_byte(data, end);
+      memcpy(d, data, z - data);
+      d += z - data;
+      data = z;
+      if (data >= end)
+        break;
+      if (data[1] == 0 && data[2] == 3) {
         *d++ = 0;
         *d++ = 0;
-        data += 2;
+        data += 3;
+      } else {
+        *d++ = *data++;
       }
     }
 
@@ -40,6 +40,7 @@
 #include "sbuf.h"
 #include "parsers.h"
 #include "parser_hevc.h"
+#include "parser_h264.h"
 #include "parser_avc.h"
 #include "bitstream.h"
 #include "service.h"
@@ -1242,6 +1243,13 @@ typedef struct hevc_private {
   hevc_sps_t sps[MAX_SPS_COUNT];
   hevc_pps_t pps[MAX_PPS_COUNT];
 
+  /* raw-byte keys of the last accepted VPS/SPS/PPS NAL units, used
+     to skip re-parsing the identical repeats in front of every IDR */
+  struct {
+    uint32_t hash;
+    uint32_t len;
+  } ps_key[3];
+
 } hevc_private_t;
 
 static const uint8_t vui_sar[][2] = {
@@ -1284,7 +1292,7 @@ static inline int check_height(uint32_t h)
   return h < 100 || h > 16384;
 }
 
-int
+static int
 hevc_decode_vps(parser_es_t *st, bitstream_t *bs)
 {
   hevc_private_t *p;
@@ -1418,7 +1426,7 @@ hevc_decode_vui(hevc_vui_t *vui, bitstream_t *bs)
   return 0;
 }
 
-int
+static int
 hevc_decode_sps(parser_es_t *st, bitstream_t *bs)
 {
   hevc_private_t *p;
@@ -1598,7 +1606,7 @@ hevc_decode_sps(parser_es_t *st, bitstream_t *bs)
   return 0;
 }
 
-int
+static int
 hevc_decode_pps(parser_es_t *st, bitstream_t *bs)
 {
   hevc_private_t *p;
@@ -1631,6 +1639,74 @@ hevc_decode_pps(parser_es_t *st, bitstream_t *bs)
   return 0;
 }
 
+/**
+ * Broadcast streams repeat identical parameter sets in front of every
+ * IDR; key the last accepted NAL of each kind by a hash of its raw
+ * (still escaped) bytes and skip both the de-escape and the re-parse
+ * on a match.  Only successful parses are cached - a failure may be
+ * caused by a missing prerequisite set (SPS before its VPS arrived)
+ * and must be retried once that set shows up.
+ */
+static uint32_t
+hevc_nal_hash(const uint8_t *data, int len)
+{
+  uint32_t h = 2166136261U;     /* FNV-1a */
+  while (len-- > 0)
+    h = (h ^ *data++) * 16777619U;
+  return h;
+}
+
+static int
+hevc_nal_ps(parser_es_t *st, const uint8_t *data, int len, int idx,
+            int (*decode)(parser_es_t *st, bitstream_t *bs))
+{
+  hevc_private_t *p;
+  bitstream_t bs;
+  uint32_t hash;
+  void *f;
+  int r;
+
+  if (len <= 0)
+    return -1;
+
+  if((p = st->es_priv) == NULL)
+    p = st->es_priv = calloc(1, sizeof(hevc_private_t));
+
+  hash = hevc_nal_hash(data, len);
+  if (p->ps_key[idx].len == len && p->ps_key[idx].hash == hash)
+    return 0;
+
+  f = h264_nal_deescape(&bs, data, len);
+  r = decode(st, &bs);
+  free(f);
+
+  if (r == 0) {
+    p->ps_key[idx].hash = hash;
+    p->ps_key[idx].len = len;
+  } else {
+    p->ps_key[idx].len = 0;
+  }
+  return r;
+}
+
+int
+hevc_nal_vps(parser_es_t *st, const uint8_t *data, int len)
+{
+  return hevc_nal_ps(st, data, len, 0, hevc_decode_vps);
+}
+
+int
+hevc_nal_sps(parser_es_t *st, const uint8_t *data, int len)
+{
+  return hevc_nal_ps(st, data, len, 1, hevc_decode_sps);
+}
+
+int
+hevc_nal_pps(parser_es_t *st, const uint8_t *data, int len)
+{
+  return hevc_nal_ps(st, data, len, 2, hevc_decode_pps);
+}
+
 int
 hevc_decode_slice_header(parser_es_t *st, bitstream_t *bs, int *pkttype)
 {
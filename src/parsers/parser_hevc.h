@@ -58,9 +58,10 @@ int isom_write_hvcc(sbuf_t *pb, const uint8_t *src, int size);
 
 th_pkt_t * hevc_convert_pkt(th_pkt_t *src);
 
-int hevc_decode_vps(parser_es_t *st, bitstream_t *bs);
-int hevc_decode_sps(parser_es_t *st, bitstream_t *bs);
-int hevc_decode_pps(parser_es_t *st, bitstream_t *bs);
+/* parameter-set entry points - raw (escaped) NAL bytes, cached */
+int hevc_nal_vps(parser_es_t *st, const uint8_t *data, int len);
+int hevc_nal_sps(parser_es_t *st, const uint8_t *data, int len);
+int hevc_nal_pps(parser_es_t *st, const uint8_t *data, int len);
 
 int hevc_decode_slice_header(parser_es_t *st, bitstream_t *bs, int *pkttype);
 
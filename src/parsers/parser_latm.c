@@ -47,6 +47,12 @@ typedef struct latm_private {
   int ext_sri;
   int channel_config;
 
+  /* raw bit-prefix of the last accepted StreamMuxConfig; the config
+     repeats unchanged on virtually every AudioMuxElement, so a match
+     skips straight to the payload */
+  uint32_t cfg_bits;
+  uint8_t cfg_raw[64];
+
 } latm_private_t;
 
 
@@ -228,8 +234,9 @@ parse_latm_audio_mux_element(parser_t *t, parser_es_t *st,
 			     const uint8_t *data, int len)
 {
   latm_private_t *latm;
-  bitstream_t bs, out;
-  int slot_len, tmp, i;
+  bitstream_t bs;
+  int slot_len, tmp, i, shift;
+  const uint8_t *src;
   uint8_t *buf;
 
   init_rbits(&bs, data, len * 8);
@@ -237,9 +244,23 @@ parse_latm_audio_mux_element(parser_t *t, parser_es_t *st,
   if((latm = st->es_priv) == NULL)
     latm = st->es_priv = calloc(1, sizeof(latm_private_t));
 
-  if(!read_bits1(&bs))
-    if (read_stream_mux_config(st, latm, &bs) < 0)
-      return NULL;
+  if(!read_bits1(&bs)) {
+    /* StreamMuxConfig - the prefix compare covers all config bits
+       (plus the leading useSameStreamMux bit), so a match can only
+       mean an identical config */
+    if (latm->cfg_bits && len * 8 >= latm->cfg_bits &&
+        !memcmp(data, latm->cfg_raw, (latm->cfg_bits + 7) / 8)) {
+      bs.offset = latm->cfg_bits;
+    } else {
+      latm->cfg_bits = 0;
+      if (read_stream_mux_config(st, latm, &bs) < 0)
+        return NULL;
+      if (bs.offset <= sizeof(latm->cfg_raw) * 8) {
+        memcpy(latm->cfg_raw, data, (bs.offset + 7) / 8);
+        latm->cfg_bits = bs.offset;
+      }
+    }
+  }
 
   if(!latm->configured)
     return NULL;
@@ -268,32 +289,36 @@ parse_latm_audio_mux_element(parser_t *t, parser_es_t *st,
   pkt->a.pkt_ext_sri  = latm->ext_sri;
   pkt->a.pkt_channels = latm->channel_config == 7 ? 8 : latm->channel_config;
 
-  /* 7 bytes of ADTS header */
-  init_wbits(&out, pktbuf_ptr(pkt->pkt_payload), 7 * 8);
-
-  put_bits(&out, 0xfff, 12); // Sync marker
-  put_bits(&out, 0, 1);      // ID 0 = MPEG 4, 1 = MPEG 2
-  put_bits(&out, 0, 2);      // Layer
-  put_bits(&out, 1, 1);      // Protection absent
-  put_bits(&out, adts_aot(latm->aot), 2);
-  put_bits(&out, latm->sri, 4);
-  put_bits(&out, 1, 1);      // Private bit
-  put_bits(&out, latm->channel_config, 3);
-  put_bits(&out, 1, 1);      // Original
-  put_bits(&out, 1, 1);      // Copy
-  
-  put_bits(&out, 1, 1);      // Copyright identification bit
-  put_bits(&out, 1, 1);      // Copyright identification start
-  put_bits(&out, slot_len + 7, 13);
-  put_bits(&out, 0x7ff, 11); // Buffer fullness
-  put_bits(&out, 0, 2);      // RDB in frame
-
-  assert(remaining_bits(&out) == 0);
-
-  /* AAC RDB */
-  buf = pktbuf_ptr(pkt->pkt_payload) + 7;
-  for(i = 0; i < slot_len; i++)
-    *buf++ = read_bits(&bs, 8);
+  /* 7 bytes of ADTS header: sync, MPEG-4, layer 0, no CRC, private
+     bit, original/copy and both copyright bits set, buffer fullness
+     0x7ff, one RDB */
+  buf = pktbuf_ptr(pkt->pkt_payload);
+  tmp = slot_len + 7;
+  buf[0] = 0xff;
+  buf[1] = 0xf1;
+  buf[2] = (adts_aot(latm->aot) << 6) | (latm->sri << 2) | 0x02 |
+           (latm->channel_config >> 2);
+  buf[3] = ((latm->channel_config & 3) << 6) | 0x3c | (tmp >> 11);
+  buf[4] = (tmp >> 3) & 0xff;
+  buf[5] = ((tmp & 7) << 5) | 0x1f;
+  buf[6] = 0xfc;
+
+  /* AAC RDB - typically off by the single useSameStreamMux bit, so
+     bulk-shift instead of a read_bits call per byte */
+  buf += 7;
+  src = data + (bs.offset >> 3);
+  shift = bs.offset & 7;
+  if (shift == 0) {
+    memcpy(buf, src, slot_len);
+  } else {
+    for (i = 0; i < slot_len - 1; i++)
+      buf[i] = (src[i] << shift) | (src[i + 1] >> (8 - shift));
+    if (slot_len > 0) {
+      buf[i] = src[i] << shift;
+      if (&src[i + 1] < data + len)
+        buf[i] |= src[i + 1] >> (8 - shift);
+    }
+  }
 
   st->es_curdts += st->es_frame_duration;
 
@@ -1,6 +1,6 @@
 /*
  *  Teletext parsing functions
- *  Copyright (C) 2007 Andreas �man
+ *  Copyright (C) 2007 Andreas �man
  *  Copyright (C) 2014 Jaroslav Kysela
  *
  *  This program is free software: you can redistribute it and/or modify
@@ -26,6 +26,11 @@
 #include "input.h"
 #include "parsers.h"
 #include "parser_teletext.h"
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define MAX_SUB_TEXT_SIZE 2000
 
@@ -40,6 +45,7 @@ typedef struct tt_mag {
   uint8_t ttm_page[23*40 + 1];
   int64_t ttm_last_sub_pts;
   uint8_t ttm_last_sub_text[MAX_SUB_TEXT_SIZE];
+  uint32_t ttm_sub_hash; /* raw cell hash of the last rendered page */
 } tt_mag_t;
 
 
@@ -62,6 +68,39 @@ static void teletext_rundown_scan(parser_t *t, tt_private_t *ttp);
 #define bitreverse(b) \
 (((b) * 0x0202020202ULL & 0x010884422010ULL) % 1023)
 
+/* Teletext lines arrive LSb-first, so every data unit needs all 42
+ * bytes bit-reversed.  Reverse 16 bytes per iteration using nibble
+ * LUT shuffles (SSSE3) or the dedicated NEON instruction, falling
+ * back to the multiply-modulo trick per byte elsewhere. */
+static void
+bitreverse_block(uint8_t *dst, const uint8_t *src, int len)
+{
+  int i = 0;
+#if defined(__SSSE3__)
+  const __m128i lo_lut = _mm_setr_epi8(0x00, 0x80 - 256, 0x40, 0xc0 - 256,
+                                       0x20, 0xa0 - 256, 0x60, 0xe0 - 256,
+                                       0x10, 0x90 - 256, 0x50, 0xd0 - 256,
+                                       0x30, 0xb0 - 256, 0x70, 0xf0 - 256);
+  const __m128i hi_lut = _mm_setr_epi8(0x00, 0x08, 0x04, 0x0c,
+                                       0x02, 0x0a, 0x06, 0x0e,
+                                       0x01, 0x09, 0x05, 0x0d,
+                                       0x03, 0x0b, 0x07, 0x0f);
+  const __m128i nib = _mm_set1_epi8(0x0f);
+  for ( ; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+    __m128i lo = _mm_shuffle_epi8(lo_lut, _mm_and_si128(v, nib));
+    __m128i hi = _mm_shuffle_epi8(hi_lut,
+                                  _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+    _mm_storeu_si128((__m128i *)(dst + i), _mm_or_si128(lo, hi));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for ( ; i + 16 <= len; i += 16)
+    vst1q_u8(dst + i, vrbitq_u8(vld1q_u8(src + i)));
+#endif
+  for ( ; i < len; i++)
+    dst[i] = bitreverse(src[i]);
+}
+
 static const uint8_t hamtable[] = {
   0x01, 0xff, 0x81, 0x01, 0xff, 0x00, 0x01, 0xff, 
   0xff, 0x02, 0x01, 0xff, 0x0a, 0xff, 0xff, 0x07, 
@@ -124,16 +163,16 @@ static const uint8_t hamtable[] = {
 #define SUBSET_CZECH_SLOVAK    1  /* Cesky / Slovencina */
 #define SUBSET_ENGLISH         2  /* English */
 #define SUBSET_ESTONIAN        3  /* Eesti */
-#define SUBSET_FRENCH          4  /* Fran�ais */
+#define SUBSET_FRENCH          4  /* Fran�ais */
 #define SUBSET_GERMAN          5  /* German / Deutch */
 #define SUBSET_ITALIAN         6  /* Italiano */
 #define SUBSET_LETT_LITH       7  /* Lettish / Lietuviskai */
 #define SUBSET_POLISH          8  /* Polski */
-#define SUBSET_PORTUG_SPANISH  9  /* Portugu�s / Espa�ol */
-#define SUBSET_RUMANIAN        10 /* Rom�na */
+#define SUBSET_PORTUG_SPANISH  9  /* Portugu�s / Espa�ol */
+#define SUBSET_RUMANIAN        10 /* Rom�na */
 #define SUBSET_SERB_CRO_SLO    11 /* Srpski / Hrvatski / Slovenscina */
 #define SUBSET_SWE_FIN_HUN     12 /* Svenska / Suomi / Magyar */
-#define SUBSET_TURKISH         13 /* T�rk�e */
+#define SUBSET_TURKISH         13 /* T�rk�e */
 #define SUBSET_LAST            SUBSET_TURKISH
 
 #define SUBSET_CHARMAP_COUNT   13
@@ -839,10 +878,20 @@ tt_subtitle_deliver(parser_t *t, parser_es_t *parent, tt_mag_t *ttm)
 {
   elementary_stream_t *es;
   parser_es_t *st;
+  uint32_t hash;
 
   if(ttm->ttm_current_pts == PTS_UNSET)
     return;
 
+  /* Static pages are idle-retransmitted every cycle; hash the raw cells
+   * (plus the active charset) and skip the whole render when nothing
+   * changed since the last delivery */
+  hash = tvh_crc32(ttm->ttm_page, 23 * 40,
+                   ttm->ttm_charset[0] ^ ((uint32_t)ttm->ttm_national << 8));
+  if(hash == ttm->ttm_sub_hash)
+    return;
+  ttm->ttm_sub_hash = hash;
+
   TAILQ_FOREACH(es, &t->prs_components.set_filter, es_filter_link) {
     st = (parser_es_t *)es;
     if (st->es_type != SCT_TEXTSUB) continue;
@@ -919,12 +968,13 @@ tt_decode_line(parser_t *t, parser_es_t *st, uint8_t *buf)
     ttm->ttm_current_pts = t->prs_current_pcr + (int64_t)st->es_service->s_pts_shift * 900;
     break;
 
-  case 1 ... 23:
-    for(i = 0; i < 40; i++) {
-      c = buf[i + 2] & 0x7f;
-      ttm->ttm_page[i + 40 * (line - 1)] = c;
-    }
+  case 1 ... 23: {
+    /* plain strided copy with parity strip - auto-vectorizes */
+    uint8_t *row = ttm->ttm_page + 40 * (line - 1);
+    for(i = 0; i < 40; i++)
+      row[i] = buf[i + 2] & 0x7f;
     break;
+  }
 
   case 28:
   case 29:
@@ -949,15 +999,13 @@ void
 teletext_input
   (parser_t *t, parser_es_t *st, const uint8_t *data, int len)
 {
-  int j;
   uint8_t buf[42];
 
   data++; len--; /* first byte: 0x10 ? */
 
   for (; len >= 46; data += 46, len -= 46) {
     if (*data == 2 || *data == 3) {
-      for(j = 0; j < 42; j++)
-	buf[j] = bitreverse(data[4 + j]);
+      bitreverse_block(buf, data + 4, 42);
       tt_decode_line(t, st, buf);
     }
  }
@@ -476,6 +476,7 @@ found:
         parser_deliver_error(t, st);
         sbuf_reset_and_alloc(&st->es_buf, 256);
         sbuf_put_be32(&st->es_buf, sc);
+        st->es_global_data_inbuf = 0;
       }
       assert(st->es_buf.sb_data != NULL);
       st->es_startcode = sc;
@@ -1199,24 +1200,46 @@ drop_trailing_zeroes(const uint8_t *buf, size_t len)
 
 
 /**
+ * Stash a global section (sequence header, SPS/PPS/VPS, ...) into
+ * es_global_data for the packet meta and decide the fate of its bytes
+ * in the reassembly buffer.  Returns the parser action for the caller.
  *
+ * Global sections precede the frame they belong to in the stream, so
+ * when the section sits at the head of the buffer right after any
+ * previously retained sections, it is kept in place; the buffer then
+ * already holds meta + payload in stream order and frame finalization
+ * can steal it as usual instead of copying the whole frame into a
+ * freshly allocated pktbuf just to prepend the meta.
  */
-static void
+static int
 parser_global_data_move(parser_es_t *st, const uint8_t *data, size_t len, int reset)
 {
+  int off = data - st->es_buf.sb_data, len2;
+
   if (reset) {
     free(st->es_global_data);
     st->es_global_data = NULL;
     st->es_global_data_len = 0;
-  } else {
-    int len2 = drop_trailing_zeroes(data, len);
-    st->es_global_data = realloc(st->es_global_data,
-                                 st->es_global_data_len + len2);
-    memcpy(st->es_global_data + st->es_global_data_len, data, len2);
-    st->es_global_data_len += len2;
+    st->es_global_data_inbuf = 0;
+    st->es_buf.sb_ptr -= len;
+    return PARSER_DROP;
+  }
+
+  len2 = drop_trailing_zeroes(data, len);
+  st->es_global_data = realloc(st->es_global_data,
+                               st->es_global_data_len + len2);
+  memcpy(st->es_global_data + st->es_global_data_len, data, len2);
+  st->es_global_data_len += len2;
+
+  if (off == st->es_global_data_inbuf &&
+      (off > 0 || st->es_global_data_len == len2)) {
+    st->es_global_data_inbuf += len;
+    return PARSER_APPEND;
   }
 
+  st->es_global_data_inbuf = 0;
   st->es_buf.sb_ptr -= len;
+  return PARSER_DROP;
 }
 
 /**
@@ -1235,7 +1258,7 @@ parse_mpeg2video(parser_t *t, parser_es_t *st, size_t len,
 {
   const uint8_t *buf = st->es_buf.sb_data + sc_offset;
   bitstream_t bs;
-  int frametype;
+  int frametype, r;
   th_pkt_t *pkt;
 
   if(next_startcode == 0x1e0)
@@ -1284,9 +1307,10 @@ parse_mpeg2video(parser_t *t, parser_es_t *st, size_t len,
     if(!st->es_buf.sb_err) {
       if(parse_mpeg2video_seq_start(t, st, &bs) != PARSER_APPEND)
         return PARSER_RESET;
-      parser_global_data_move(st, buf, len, 0);
+      r = parser_global_data_move(st, buf, len, 0);
       if (!st->es_priv)
         st->es_priv = malloc(1); /* starting mark */
+      return r;
     }
     return PARSER_DROP;
 
@@ -1297,12 +1321,12 @@ parse_mpeg2video(parser_t *t, parser_es_t *st, size_t len,
     case 0x1:
       // Sequence Extension
       if(!st->es_buf.sb_err)
-        parser_global_data_move(st, buf, len, 0);
+        return parser_global_data_move(st, buf, len, 0);
       return PARSER_DROP;
     case 0x2:
       // Sequence Display Extension
       if(!st->es_buf.sb_err)
-        parser_global_data_move(st, buf, len, 0);
+        return parser_global_data_move(st, buf, len, 0);
       return PARSER_DROP;
     }
     break;
@@ -1330,7 +1354,7 @@ parse_mpeg2video(parser_t *t, parser_es_t *st, size_t len,
         pkt->pkt_err = st->es_buf.sb_err;
         st->es_buf.sb_err = 0;
       }
-      if (metalen) {
+      if (metalen && !st->es_global_data_inbuf) {
         pkt->pkt_payload = pktbuf_alloc(NULL, metalen + st->es_buf.sb_ptr - 4);
         memcpy(pktbuf_ptr(pkt->pkt_payload), pktbuf_ptr(pkt->pkt_meta), metalen);
         memcpy(pktbuf_ptr(pkt->pkt_payload) + metalen, st->es_buf.sb_data, st->es_buf.sb_ptr - 4);
@@ -1359,7 +1383,7 @@ parse_mpeg2video(parser_t *t, parser_es_t *st, size_t len,
   case 0xb8:
     // GOP header
     if(!st->es_buf.sb_err)
-      parser_global_data_move(st, buf, len, 0);
+      return parser_global_data_move(st, buf, len, 0);
     return PARSER_DROP;
 
   case 0xb2:
@@ -1525,23 +1549,23 @@ parse_h264(parser_t *t, parser_es_t *st, size_t len,
     switch(sc & 0x1f) {
 
     case H264_NAL_SPS:
+      ret = PARSER_DROP;
       if(!st->es_buf.sb_err) {
         void *f = h264_nal_deescape(&bs, buf + 4, len - 4);
         int r = h264_decode_seq_parameter_set(st, &bs);
         free(f);
-        parser_global_data_move(st, buf, len, r);
+        ret = parser_global_data_move(st, buf, len, r);
       }
-      ret = PARSER_DROP;
       break;
 
     case H264_NAL_PPS:
+      ret = PARSER_DROP;
       if(!st->es_buf.sb_err) {
         void *f = h264_nal_deescape(&bs, buf + 4, len - 4);
         int r = h264_decode_pic_parameter_set(st, &bs);
         free(f);
-        parser_global_data_move(st, buf, len, r);
+        ret = parser_global_data_move(st, buf, len, r);
       }
-      ret = PARSER_DROP;
       break;
 
     case H264_NAL_IDR_SLICE:
@@ -1591,7 +1615,7 @@ parse_h264(parser_t *t, parser_es_t *st, size_t len,
         pkt->pkt_err = st->es_buf.sb_err;
         st->es_buf.sb_err = 0;
       }
-      if (metalen) {
+      if (metalen && !st->es_global_data_inbuf) {
         pkt->pkt_payload = pktbuf_alloc(NULL, metalen + st->es_buf.sb_ptr - 4);
         memcpy(pktbuf_ptr(pkt->pkt_payload), pktbuf_ptr(pkt->pkt_meta), metalen);
         memcpy(pktbuf_ptr(pkt->pkt_payload) + metalen, st->es_buf.sb_data, st->es_buf.sb_ptr - 4);
@@ -1699,33 +1723,24 @@ parse_hevc(parser_t *t, parser_es_t *st, size_t len,
     break;
 
   case HEVC_NAL_VPS:
-    if(!st->es_buf.sb_err) {
-      void *f = h264_nal_deescape(&bs, buf + 3, len - 3);
-      int r = hevc_decode_vps(st, &bs);
-      free(f);
-      parser_global_data_move(st, buf, len, r);
-    }
     ret = PARSER_DROP;
+    if(!st->es_buf.sb_err)
+      ret = parser_global_data_move(st, buf, len,
+                                    hevc_nal_vps(st, buf + 3, len - 3));
     break;
 
   case HEVC_NAL_SPS:
-    if(!st->es_buf.sb_err) {
-      void *f = h264_nal_deescape(&bs, buf + 3, len - 3);
-      int r = hevc_decode_sps(st, &bs);
-      free(f);
-      parser_global_data_move(st, buf, len, r);
-    }
     ret = PARSER_DROP;
+    if(!st->es_buf.sb_err)
+      ret = parser_global_data_move(st, buf, len,
+                                    hevc_nal_sps(st, buf + 3, len - 3));
     break;
 
   case HEVC_NAL_PPS:
-    if(!st->es_buf.sb_err) {
-      void *f = h264_nal_deescape(&bs, buf + 3, len - 3);
-      int r = hevc_decode_pps(st, &bs);
-      free(f);
-      parser_global_data_move(st, buf, len, r);
-    }
     ret = PARSER_DROP;
+    if(!st->es_buf.sb_err)
+      ret = parser_global_data_move(st, buf, len,
+                                    hevc_nal_pps(st, buf + 3, len - 3));
     break;
 
 #if 0
@@ -1763,7 +1778,7 @@ parse_hevc(parser_t *t, parser_es_t *st, size_t len,
         pkt->pkt_err = st->es_buf.sb_err;
         st->es_buf.sb_err = 0;
       }
-      if (metalen) {
+      if (metalen && !st->es_global_data_inbuf) {
         pkt->pkt_payload = pktbuf_alloc(NULL, metalen + st->es_buf.sb_ptr - 4);
         memcpy(pktbuf_ptr(pkt->pkt_payload), pktbuf_ptr(pkt->pkt_meta), metalen);
         memcpy(pktbuf_ptr(pkt->pkt_payload) + metalen, st->es_buf.sb_data, st->es_buf.sb_ptr - 4);
@@ -54,6 +54,8 @@ struct parser_es {
   sbuf_t    es_buf_a;         /* Audio packet reassembly */
   uint8_t  *es_global_data;
   int       es_global_data_len;
+  int       es_global_data_inbuf; /* bytes of es_global_data still kept
+                                     at the head of es_buf */
   struct th_pkt *es_curpkt;
   struct streaming_message_queue es_backlog;
   tvhlog_limit_t es_pes_log;
@@ -87,6 +89,7 @@ struct parser {
 
   /* Globals */
   uint16_t prs_pcr_pid;
+  uint8_t  prs_audio_only;  /* strip video/subtitle components */
 
   /* PCR clocks */
   int64_t  prs_current_pcr;
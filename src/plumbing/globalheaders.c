@@ -38,6 +38,108 @@ typedef struct globalheaders {
 #define MAX_SCAN_TIME   5000  // in ms
 #define MAX_NOPKT_TIME  2500  // in ms
 
+/**
+ * Completed header sets are kept in a small shared cache keyed by the
+ * service identity and component layout, so a second subscriber to the
+ * same service starts immediately instead of re-scanning the stream
+ * for parameter sets.  A new scan of the same service overwrites its
+ * entry, and a layout change simply never matches.
+ */
+
+#define GH_CACHE_MAX  32
+#define GH_CACHE_TTL  sec2mono(300)
+
+typedef struct gh_cache_entry {
+  LIST_ENTRY(gh_cache_entry) ghc_link;
+  streaming_start_t *ghc_ss;
+  int64_t ghc_time;
+} gh_cache_entry_t;
+
+static LIST_HEAD(, gh_cache_entry) gh_cache;
+static tvh_mutex_t gh_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static int gh_cache_count;
+
+static int
+gh_cache_match(const streaming_start_t *a, const streaming_start_t *b)
+{
+  const streaming_start_component_t *ca, *cb;
+  int i;
+
+  if (a->ss_service_id != b->ss_service_id ||
+      a->ss_pcr_pid != b->ss_pcr_pid ||
+      a->ss_pmt_pid != b->ss_pmt_pid ||
+      a->ss_num_components != b->ss_num_components)
+    return 0;
+  if (strcmp(a->ss_si.si_service ?: "", b->ss_si.si_service ?: "") ||
+      strcmp(a->ss_si.si_mux ?: "", b->ss_si.si_mux ?: ""))
+    return 0;
+  for (i = 0; i < a->ss_num_components; i++) {
+    ca = &a->ss_components[i];
+    cb = &b->ss_components[i];
+    if (ca->es_index != cb->es_index ||
+        ca->es_pid != cb->es_pid ||
+        ca->es_type != cb->es_type)
+      return 0;
+  }
+  return 1;
+}
+
+static void
+gh_cache_entry_destroy(gh_cache_entry_t *ghc)
+{
+  LIST_REMOVE(ghc, ghc_link);
+  streaming_start_unref(ghc->ghc_ss);
+  free(ghc);
+  gh_cache_count--;
+}
+
+static streaming_start_t *
+gh_cache_lookup(const streaming_start_t *ss)
+{
+  gh_cache_entry_t *ghc, *next;
+  streaming_start_t *ret = NULL;
+  int64_t now = mclk();
+
+  tvh_mutex_lock(&gh_cache_mutex);
+  for (ghc = LIST_FIRST(&gh_cache); ghc; ghc = next) {
+    next = LIST_NEXT(ghc, ghc_link);
+    if (ghc->ghc_time + GH_CACHE_TTL < now) {
+      gh_cache_entry_destroy(ghc);
+    } else if (ret == NULL && gh_cache_match(ghc->ghc_ss, ss)) {
+      ret = streaming_start_copy(ghc->ghc_ss);
+    }
+  }
+  tvh_mutex_unlock(&gh_cache_mutex);
+  return ret;
+}
+
+static void
+gh_cache_store(const streaming_start_t *ss)
+{
+  gh_cache_entry_t *ghc, *oldest;
+
+  tvh_mutex_lock(&gh_cache_mutex);
+  LIST_FOREACH(ghc, &gh_cache, ghc_link)
+    if (gh_cache_match(ghc->ghc_ss, ss))
+      break;
+  if (ghc) {
+    streaming_start_unref(ghc->ghc_ss);
+  } else {
+    while (gh_cache_count >= GH_CACHE_MAX) {
+      oldest = LIST_FIRST(&gh_cache);
+      LIST_FOREACH(ghc, &gh_cache, ghc_link)
+        if (ghc->ghc_time < oldest->ghc_time)
+          oldest = ghc;
+      gh_cache_entry_destroy(oldest);
+    }
+    ghc = calloc(1, sizeof(*ghc));
+    LIST_INSERT_HEAD(&gh_cache, ghc, ghc_link);
+    gh_cache_count++;
+  }
+  ghc->ghc_ss = streaming_start_copy(ss);
+  ghc->ghc_time = mclk();
+}
+
 /**
  *
  */
@@ -272,8 +374,21 @@ headers_complete(globalheaders_t *gh)
 static void
 gh_start(globalheaders_t *gh, streaming_message_t *sm)
 {
+  streaming_start_t *cached;
+
   gh->gh_ss = streaming_start_copy(sm->sm_data);
   streaming_msg_free(sm);
+
+  /* A later subscriber to a service whose headers were already scanned
+     can start straight away from the cached set */
+  cached = gh_cache_lookup(gh->gh_ss);
+  if (cached) {
+    streaming_start_unref(gh->gh_ss);
+    gh->gh_ss = cached;
+    sm = streaming_msg_create_data(SMT_START, streaming_start_copy(cached));
+    streaming_target_deliver2(gh->gh_output, sm);
+    gh->gh_passthru = 1;
+  }
 }
 
 
@@ -314,6 +429,8 @@ gh_hold(globalheaders_t *gh, streaming_message_t *sm)
     if(!headers_complete(gh))
       break;
 
+    gh_cache_store(gh->gh_ss);
+
     // Send our modified start
     sm = streaming_msg_create_data(SMT_START,
 				   streaming_start_copy(gh->gh_ss));
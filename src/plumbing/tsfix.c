@@ -73,6 +73,10 @@ typedef struct tsfix {
   struct th_pktref_queue tf_ptsq;
   struct th_pktref_queue tf_backlog;
 
+  int64_t tf_pace_depth;     /* burst tolerance in us, 0 = pacing off */
+  int64_t tf_pace_ref_dts;
+  int64_t tf_pace_ref_mono;
+
 } tsfix_t;
 
 
@@ -178,6 +182,7 @@ tsfix_start(tsfix_t *tf, streaming_start_t *ss)
   tf->tf_tsref = PTS_UNSET;
   tf->tf_hasvideo = hasvideo;
   tf->tf_wait_for_video = vwait;
+  tf->tf_pace_ref_mono = 0;
 }
 
 
@@ -205,6 +210,42 @@ tsfix_packet_drop(tfstream_t *tfs, th_pkt_t *pkt, const char *reason)
   pkt_ref_dec(pkt);
 }
 
+/**
+ * Leaky-bucket pacing: when the producer runs ahead of real time
+ * (file-backed or VBR sources delivering in bursts), hold the packet
+ * back until its normalized DTS falls within the configured depth of
+ * the monotonic clock, so downstream output arrives smoothly.  Live
+ * sources never run ahead, so for them this never sleeps.
+ */
+static void
+tsfix_pace(tsfix_t *tf, th_pkt_t *pkt)
+{
+  int64_t deadline, ahead, now;
+
+  if (tf->tf_pace_depth <= 0 || pkt->pkt_dts == PTS_UNSET)
+    return;
+  now = getmonoclock();
+  if (tf->tf_pace_ref_mono == 0) {
+    tf->tf_pace_ref_mono = now;
+    tf->tf_pace_ref_dts  = pkt->pkt_dts;
+    return;
+  }
+  deadline = tf->tf_pace_ref_mono +
+             (pkt->pkt_dts - tf->tf_pace_ref_dts) * 100 / 9;
+  ahead = deadline - now;
+  if (ahead < -sec2mono(2)) {
+    /* discontinuity or long stall - resync the reference */
+    tf->tf_pace_ref_mono = now;
+    tf->tf_pace_ref_dts  = pkt->pkt_dts;
+    return;
+  }
+  ahead -= tf->tf_pace_depth;
+  while (ahead > 0 && tvheadend_is_running()) {
+    tvh_safe_usleep(MIN(ahead, 250000));
+    ahead -= 250000;
+  }
+}
+
 /**
  *
  */
@@ -311,6 +352,8 @@ normalize_ts(tsfix_t *tf, tfstream_t *tfs, th_pkt_t *pkt, int backlog)
   }
 
 deliver:
+  tsfix_pace(tf, pkt);
+
   if (tvhtrace_enabled()) {
     char _odts[22], _opts[22];
     pkt_trace(LS_TSFIX, pkt,
@@ -664,6 +707,10 @@ tsfix_input(void *opaque, streaming_message_t *sm)
     if(tf->dts_offset != PTS_UNSET) {
       tf->dts_offset_apply = 1;
     }
+    tf->tf_pace_ref_mono = 0;
+    break;
+  case SMT_SPEED:
+    tf->tf_pace_ref_mono = 0;
     break;
   case SMT_GRACE:
   case SMT_EXIT:
@@ -673,7 +720,6 @@ tsfix_input(void *opaque, streaming_message_t *sm)
   case SMT_NOSTART:
   case SMT_NOSTART_WARN:
   case SMT_MPEGTS:
-  case SMT_SPEED:
     break;
   }
 
@@ -712,6 +758,18 @@ tsfix_create(streaming_target_t *output)
   return &tf->tf_input;
 }
 
+/**
+ *
+ */
+void
+tsfix_pacing_set(streaming_target_t *pad, int depth_ms)
+{
+  tsfix_t *tf = (tsfix_t *)pad;
+
+  tf->tf_pace_depth = depth_ms > 0 ? (int64_t)depth_ms * 1000 : 0;
+  tf->tf_pace_ref_mono = 0;
+}
+
 /**
  *
  */
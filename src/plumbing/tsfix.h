@@ -23,6 +23,8 @@
 
 streaming_target_t *tsfix_create(streaming_target_t *output);
 
+void tsfix_pacing_set(streaming_target_t *pad, int depth_ms);
+
 void tsfix_destroy(streaming_target_t *gh);
 
 
@@ -451,6 +451,20 @@ const idclass_t profile_class =
       .def.i    = PROFILE_SVF_NONE,
       .group    = 1
     },
+    {
+      .type     = PT_INT,
+      .id       = "pace",
+      .name     = N_("Smooth delivery (burst depth ms)"),
+      .desc     = N_("Pace packet delivery against the stream clock, "
+                     "allowing bursts of up to this many milliseconds "
+                     "ahead of real time. Smooths the output of "
+                     "file-backed or VBR sources; live sources are "
+                     "unaffected. 0 = off."),
+      .off      = offsetof(profile_t, pro_pace),
+      .opts     = PO_EXPERT,
+      .def.i    = 0,
+      .group    = 1,
+    },
     { }
   }
 };
@@ -643,6 +657,12 @@ profile_get_htsp_list(htsmsg_t *array, htsmsg_t *filter)
 static void
 profile_deliver(profile_chain_t *prch, streaming_message_t *sm)
 {
+  if (prch->prch_post_share == NULL) {
+    /* lazily built chain without stages yet - see profile_chain_build() */
+    if (sm)
+      streaming_msg_free(sm);
+    return;
+  }
   if (prch->prch_start_pending) {
     profile_sharer_t *prsh = prch->prch_sharer;
     streaming_message_t *sm2;
@@ -1103,11 +1123,34 @@ profile_chain_raw_open(profile_chain_t *prch, void *id, size_t qsize, int muxer)
   if (muxer) {
     memset(&c, 0, sizeof(c));
     c.m_type = MC_RAW;
+    /* raw chains have no profile to carry the batching knobs, so use
+       the same defaults as the mpegts-pass profile - full muxes are
+       the biggest HTTP fan-out and benefit the most from the
+       reference-counted writev path */
+    c.u.pass.m_flush_bytes = 65536;
+    c.u.pass.m_flush_time  = 100;
     prch->prch_muxer = muxer_create(&c, NULL);
   }
   return 0;
 }
 
+/*
+ * Raw chain variant feeding the lock-free queue - for consumers which
+ * wait on the queue pipe with poll instead of the queue condvar.
+ */
+int
+profile_chain_raw_open_poll(profile_chain_t *prch, void *id, size_t qsize)
+{
+  memset(prch, 0, sizeof(*prch));
+  prch->prch_id    = id;
+  prch->prch_flags = SUBSCRIPTION_MPEGTS;
+  if (streaming_lfqueue_init(&prch->prch_lfq, SMT_PACKET, qsize))
+    return -1;
+  prch->prch_lfq_used = 1;
+  prch->prch_st    = &prch->prch_lfq.lfq_st;
+  return 0;
+}
+
 /*
  *
  */
@@ -1177,12 +1220,18 @@ profile_chain_close(profile_chain_t *prch)
   }
 
   prch->prch_st = NULL;
+  prch->prch_lazy_dst = NULL;
 
   if (prch->prch_sq_used) {
     streaming_queue_deinit(&prch->prch_sq);
     prch->prch_sq_used = 0;
   }
 
+  if (prch->prch_lfq_used) {
+    streaming_lfqueue_deinit(&prch->prch_lfq);
+    prch->prch_lfq_used = 0;
+  }
+
   if (prch->prch_linked) {
     LIST_REMOVE(prch, prch_link);
     prch->prch_linked = 0;
@@ -1210,6 +1259,58 @@ const idclass_t profile_htsp_class =
   }
 };
 
+/*
+ * Deferred stage construction - the packet filters are built on the
+ * first streaming message, on the delivering thread and outside
+ * global_lock, so the subscription start path stays short. Safe
+ * because profile_chain_close() only runs after the subscription has
+ * been disconnected from the pad, i.e. after the last input call.
+ */
+static int
+profile_chain_build(profile_chain_t *prch)
+{
+  profile_sharer_t *prsh = prch->prch_sharer;
+  streaming_target_t *dst = prch->prch_lazy_dst;
+
+  if (!prsh->prsh_tsfix) {
+    prsh->prsh_tsfix = tsfix_create(&prsh->prsh_input);
+    if (prch->prch_pro)
+      tsfix_pacing_set(prsh->prsh_tsfix, prch->prch_pro->pro_pace);
+  }
+  prch->prch_share = prsh->prsh_tsfix;
+
+  dst = prch->prch_gh = globalheaders_create(dst);
+  prch->prch_post_share = dst;
+
+  /* switch to the regular input callback for the following messages */
+  streaming_target_init(&prch->prch_input,
+                        prsh->prsh_do_queue ?
+                          &profile_input_queue_ops : &profile_input_ops, prch,
+                        0);
+  return profile_sharer_postinit(prsh);
+}
+
+static void
+profile_input_lazy(void *opaque, streaming_message_t *sm)
+{
+  profile_chain_t *prch = opaque;
+
+  profile_chain_build(prch);
+  prch->prch_input.st_ops.st_cb(opaque, sm);
+}
+
+static htsmsg_t *
+profile_input_lazy_info(void *opaque, htsmsg_t *list)
+{
+  htsmsg_add_str(list, NULL, "profile lazy input");
+  return list;
+}
+
+static streaming_ops_t profile_input_lazy_ops = {
+  .st_cb   = profile_input_lazy,
+  .st_info = profile_input_lazy_info
+};
+
 static int
 profile_htsp_work(profile_chain_t *prch,
                   streaming_target_t *dst,
@@ -1221,28 +1322,20 @@ profile_htsp_work(profile_chain_t *prch,
   if (!prsh)
     goto fail;
 
-  if (!prsh->prsh_tsfix)
-    prsh->prsh_tsfix = tsfix_create(&prsh->prsh_input);
-  prch->prch_share = prsh->prsh_tsfix;
-
 #if ENABLE_TIMESHIFT
+  /* timeshift_create() requires global_lock - cannot be deferred */
   if (timeshift_period > 0)
     dst = prch->prch_timeshift = timeshift_create(dst, timeshift_period);
 #endif
 
-  dst = prch->prch_gh = globalheaders_create(dst);
-
-  if (profile_sharer_create(prsh, prch, dst))
+  if (profile_sharer_create(prsh, prch, NULL))
     goto fail;
 
+  prch->prch_lazy_dst = dst;
+
   prch->prch_flags = SUBSCRIPTION_PACKET;
-  streaming_target_init(&prch->prch_input,
-                        prsh->prsh_do_queue ?
-                          &profile_input_queue_ops : &profile_input_ops, prch,
-                        0);
+  streaming_target_init(&prch->prch_input, &profile_input_lazy_ops, prch, 0);
   prch->prch_st = &prch->prch_input;
-  if (profile_sharer_postinit(prsh))
-    goto fail;
   return 0;
 
 fail:
@@ -1270,6 +1363,8 @@ typedef struct profile_mpegts {
   int pro_rewrite_sdt;
   int pro_rewrite_nit;
   int pro_rewrite_eit;
+  int pro_flush_bytes;
+  int pro_flush_time;
 } profile_mpegts_t;
 
 static int
@@ -1438,6 +1533,32 @@ const idclass_t profile_mpegts_pass_class =
       .def.i    = 1,
       .group    = 2
     },
+    {
+      .type     = PT_INT,
+      .id       = "flush_bytes",
+      .name     = N_("Output flush size (bytes)"),
+      .desc     = N_("Batch the TS output of a streamed (non-seekable) "
+                     "client into one vectored write once this many "
+                     "bytes are queued. Zero disables batching and "
+                     "writes every block separately."),
+      .off      = offsetof(profile_mpegts_t, pro_flush_bytes),
+      .opts     = PO_EXPERT,
+      .def.i    = 65536,
+      .group    = 1
+    },
+    {
+      .type     = PT_INT,
+      .id       = "flush_time",
+      .name     = N_("Output flush time (ms)"),
+      .desc     = N_("Flush the queued TS output at the latest after "
+                     "this many milliseconds even when the size "
+                     "threshold was not reached. Zero means flushes "
+                     "are driven by the size threshold only."),
+      .off      = offsetof(profile_mpegts_t, pro_flush_time),
+      .opts     = PO_EXPERT,
+      .def.i    = 100,
+      .group    = 1
+    },
     { }
   }
 };
@@ -1462,6 +1583,8 @@ profile_mpegts_pass_reopen(profile_chain_t *prch,
   c.u.pass.m_rewrite_sdt = pro->pro_rewrite_sdt;
   c.u.pass.m_rewrite_nit = pro->pro_rewrite_nit;
   c.u.pass.m_rewrite_eit = pro->pro_rewrite_eit;
+  c.u.pass.m_flush_bytes = pro->pro_flush_bytes;
+  c.u.pass.m_flush_time  = pro->pro_flush_time;
 
   assert(!prch->prch_muxer);
   prch->prch_muxer = muxer_create(&c, hints);
@@ -1497,6 +1620,8 @@ profile_mpegts_pass_builder(void)
   pro->pro_rewrite_sdt = 1;
   pro->pro_rewrite_nit = 1;
   pro->pro_rewrite_eit = 1;
+  pro->pro_flush_bytes = 65536;
+  pro->pro_flush_time  = 100;
   return (profile_t *)pro;
 }
 
@@ -1893,6 +2018,8 @@ profile_matroska_open(profile_chain_t *prch,
 
   dst = prch->prch_gh    = globalheaders_create(&prch->prch_sq.sq_st);
   dst = prch->prch_tsfix = tsfix_create(dst);
+  if (prch->prch_pro)
+    tsfix_pacing_set(dst, prch->prch_pro->pro_pace);
   prch->prch_st    = dst;
 
   return profile_matroska_reopen(prch, m_cfg, hints, flags);
@@ -2001,6 +2128,9 @@ profile_audio_open(profile_chain_t *prch,
     return r;
   }
 
+  /* only the audio components are extracted and parsed */
+  prch->prch_flags |= SUBSCRIPTION_AUDIOONLY;
+
   return profile_audio_reopen(prch, m_cfg, hints, flags);
 }
 
@@ -2008,7 +2138,7 @@ static profile_t *
 profile_audio_builder(void)
 {
   profile_audio_t *pro = calloc(1, sizeof(*pro));
-  pro->pro_sflags = SUBSCRIPTION_PACKET;
+  pro->pro_sflags = SUBSCRIPTION_PACKET | SUBSCRIPTION_AUDIOONLY;
   pro->pro_reopen = profile_audio_reopen;
   pro->pro_open   = profile_audio_open;
   return (profile_t *)pro;
@@ -2709,6 +2839,8 @@ profile_transcode_work(profile_chain_t *prch,
     if (!dst)
       goto fail;
     prsh->prsh_tsfix = tsfix_create(dst);
+    if (prch->prch_pro)
+      tsfix_pacing_set(prsh->prsh_tsfix, prch->prch_pro->pro_pace);
   }
   prch->prch_share = prsh->prsh_tsfix;
   streaming_target_init(&prch->prch_input,
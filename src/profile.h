@@ -89,6 +89,8 @@ typedef struct profile_chain {
   int                       prch_start_pending;
   int                       prch_sq_used;
   struct streaming_queue    prch_sq;
+  int                       prch_lfq_used;
+  struct streaming_lfqueue  prch_lfq;
   struct streaming_target  *prch_post_share;
   struct streaming_target  *prch_st;
   struct muxer             *prch_muxer;
@@ -99,6 +101,7 @@ typedef struct profile_chain {
 #endif
   struct streaming_target   prch_input;
   struct streaming_target  *prch_share;
+  struct streaming_target  *prch_lazy_dst;
 
   int (*prch_can_share)(struct profile_chain *prch,
                         struct profile_chain *joiner);
@@ -127,6 +130,7 @@ typedef struct profile {
   int pro_ca_timeout;
   int pro_swservice;
   int pro_svfilter;
+  int pro_pace;
 
   void (*pro_free)(struct profile *pro);
   void (*pro_conf_changed)(struct profile *pro);
@@ -188,6 +192,7 @@ int profile_chain_open(profile_chain_t *prch,
                        int flags, size_t qsize);
 void profile_chain_init(profile_chain_t *prch, profile_t *pro, void *id, int queue);
 int  profile_chain_raw_open(profile_chain_t *prch, void *id, size_t qsize, int muxer);
+int  profile_chain_raw_open_poll(profile_chain_t *prch, void *id, size_t qsize);
 void profile_chain_close(profile_chain_t *prch);
 int  profile_chain_weight(profile_chain_t *prch, int custom);
 
@@ -19,7 +19,9 @@
 
 #include <signal.h>
 #include <ctype.h>
+#include <fcntl.h>
 #include "tvheadend.h"
+#include "tvhpoll.h"
 #include "config.h"
 #include "input.h"
 #include "streaming.h"
@@ -47,14 +49,74 @@ typedef struct satip_rtp_table {
   int remove_mark;
 } satip_rtp_table_t;
 
+/*
+ * All RTP sessions are serviced by a small shared pool of poll-based
+ * workers instead of one thread per session - each session's lock-free
+ * streaming queue pipe is an fd in the owning worker's poll set.
+ */
+#define SATIP_RTP_WORKERS 4
+
+/* session <-> worker attach state, protected by satip_rtp_lock */
+#define SATIP_RTP_WS_ADD    0  /* queued for the worker poll set */
+#define SATIP_RTP_WS_RUN    1  /* serviced by the worker loop */
+#define SATIP_RTP_WS_REMOVE 2  /* close requested, waiting for worker */
+#define SATIP_RTP_WS_GONE   3  /* detached, safe to destroy */
+
+typedef struct satip_rtp_worker {
+  pthread_t tid;
+  tvhpoll_t *poll;
+  th_pipe_t ctl;     /* session add/remove + shutdown wakeup */
+  int count;         /* assigned sessions */
+} satip_rtp_worker_t;
+
+/*
+ * Shared per-mux output assembly - UDP sessions tuned to the same
+ * frontend with an identical PID set form a group.  One member (the
+ * builder) filters and chunks the transport stream once; the others
+ * drop their own input copy and transmit the shared chunks by
+ * reference, so many clients of one transponder cost barely more
+ * than one.
+ */
+#define SATIP_RTP_CHUNK_PAYLOAD (RTP_PAYLOAD - 12)
+#define SATIP_RTP_GROUP_RING    128  /* retained chunks, ~168kB of TS */
+#define SATIP_RTP_GROUP_BATCH   32   /* packets per vectored send */
+
+struct satip_rtp_session;
+
+typedef struct satip_rtp_chunk {
+  TAILQ_ENTRY(satip_rtp_chunk) link;
+  uint64_t seq;
+  int len;
+  uint8_t data[SATIP_RTP_CHUNK_PAYLOAD];
+} satip_rtp_chunk_t;
+
+typedef struct satip_rtp_group {
+  LIST_ENTRY(satip_rtp_group) link;       /* satip_rtp_lock */
+  LIST_HEAD(, satip_rtp_session) members; /* satip_rtp_lock */
+  struct satip_rtp_session *builder;
+  int frontend;
+  int source;
+  mpegts_apids_t pids;
+  tvh_mutex_t lock;                       /* chunks, fill, seq, builder */
+  TAILQ_HEAD(, satip_rtp_chunk) chunks;
+  int chunk_count;
+  uint64_t seq;                           /* next chunk sequence number */
+  satip_rtp_chunk_t *fill;                /* chunk under assembly */
+} satip_rtp_group_t;
+
 typedef struct satip_rtp_session {
   TAILQ_ENTRY(satip_rtp_session) link;
-  pthread_t tid;
+  satip_rtp_worker_t *worker;
+  int worker_state;
+  satip_rtp_group_t *group;
+  LIST_ENTRY(satip_rtp_session) group_link;
+  uint64_t group_tail;                    /* next chunk seq to transmit */
+  int fatal;
   struct sockaddr_storage peer;
   struct sockaddr_storage peer2;
   int port;
   th_subscription_t *subs;
-  streaming_queue_t *sq;
+  streaming_lfqueue_t *lfq;
   int fd_rtp;
   int fd_rtcp;
   int frontend;
@@ -81,9 +143,13 @@ typedef struct satip_rtp_session {
 } satip_rtp_session_t;
 
 static tvh_mutex_t satip_rtp_lock;
+static tvh_cond_t satip_rtp_worker_cond;
+static satip_rtp_worker_t satip_rtp_worker[SATIP_RTP_WORKERS];
+static int satip_rtp_workers_run;
 static pthread_t satip_rtcp_tid;
 static int satip_rtcp_run;
 static TAILQ_HEAD(, satip_rtp_session) satip_rtp_sessions;
+static LIST_HEAD(, satip_rtp_group) satip_rtp_groups;
 
 static void
 satip_rtp_pmt_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
@@ -170,7 +236,7 @@ static int
 satip_rtp_send(satip_rtp_session_t *rtp)
 {
   struct iovec *v = rtp->um_iovec, *v2;
-  int packets, copy, len, r;
+  int packets, copy, len, r, retries = 0;
   if (v->iov_len == RTP_PAYLOAD) {
     packets = rtp->um_packet;
     v2 = v + packets;
@@ -185,8 +251,15 @@ satip_rtp_send(satip_rtp_session_t *rtp)
         if (errno == EINTR)
           continue;
         if (errno == EAGAIN || errno == EWOULDBLOCK) {
-          tvh_usleep(100);
-          continue;
+          /* bounded backoff - the shared worker must not stall other
+             sessions behind one unread socket, drop the burst instead */
+          if (++retries <= 20) {
+            tvh_usleep(100);
+            continue;
+          }
+          tvhtrace(LS_SATIPS, "rtp udp backpressure, dropping %d packets", packets);
+          r = packets;
+          break;
         }
         tvhtrace(LS_SATIPS, "rtp udp multisend failed (errno %d)", errno);
         return r;
@@ -279,6 +352,222 @@ found:
   return 0;
 }
 
+static void
+satip_rtp_group_publish(satip_rtp_group_t *g)
+{
+  satip_rtp_chunk_t *c = g->fill;
+
+  if (c == NULL || c->len == 0)
+    return;
+  c->seq = g->seq++;
+  TAILQ_INSERT_TAIL(&g->chunks, c, link);
+  g->fill = NULL;
+  if (++g->chunk_count > SATIP_RTP_GROUP_RING) {
+    c = TAILQ_FIRST(&g->chunks);
+    TAILQ_REMOVE(&g->chunks, c, link);
+    free(c);
+    g->chunk_count--;
+  }
+}
+
+static int
+satip_rtp_group_append(satip_rtp_group_t *g, uint8_t *data)
+{
+  satip_rtp_chunk_t *c = g->fill;
+
+  if (c == NULL) {
+    c = g->fill = malloc(sizeof(*c));
+    if (c == NULL)
+      return -1;
+    c->len = 0;
+  }
+  memcpy(c->data + c->len, data, 188);
+  c->len += 188;
+  if (c->len == SATIP_RTP_CHUNK_PAYLOAD)
+    satip_rtp_group_publish(g);
+  return 0;
+}
+
+/*
+ * Builder variant of satip_rtp_loop - the filtered (and PMT-rewritten)
+ * stream goes into the shared chunk ring instead of the private iovec
+ * train.  Non-builder members just drop their input copy here; they
+ * transmit the shared chunks from satip_rtp_group_flush.
+ */
+static int
+satip_rtp_group_loop(satip_rtp_session_t *rtp, uint8_t *data, int len)
+{
+  satip_rtp_group_t *g = rtp->group;
+  int i, j, pid, last_pid = -1, r = 0;
+  mpegts_apid_t *pids = rtp->pids.pids;
+  satip_rtp_table_t *tbl;
+
+  assert((len % 188) == 0);
+  tvh_mutex_lock(&g->lock);
+  if (g->builder != rtp)
+    goto done;
+  for ( ; len >= 188 ; data += 188, len -= 188) {
+    pid = ((data[1] & 0x1f) << 8) | data[2];
+    if (pid != last_pid && !rtp->pids.all) {
+      for (i = 0; i < rtp->pids.count; i++) {
+        j = pids[i].pid;
+        if (pid < j) break;
+        if (j == pid) goto found;
+      }
+      continue;
+found:
+      TAILQ_FOREACH(tbl, &rtp->pmt_tables, link)
+        if (tbl->pid == pid) {
+          dvb_table_parse(&tbl->tbl, "-", data, 188, 1, 0, satip_rtp_pmt_cb);
+          if (rtp->table_data.sb_ptr > 0) {
+            for (i = r = 0; i < rtp->table_data.sb_ptr; i += 188) {
+              r = satip_rtp_group_append(g, rtp->table_data.sb_data + i);
+              if (r)
+                break;
+            }
+            sbuf_reset(&rtp->table_data, 10*188);
+            if (r)
+              goto done;
+          }
+          break;
+        }
+      if (tbl)
+        continue;
+      last_pid = pid;
+    }
+    r = satip_rtp_group_append(g, data);
+    if (r < 0)
+      goto done;
+  }
+done:
+  tvh_mutex_unlock(&g->lock);
+  return r;
+}
+
+/*
+ * Transmit the shared chunks this session has not sent yet.  Each
+ * packet is a private 12-byte RTP header (own sequence numbers) plus
+ * the shared chunk payload by reference.  Called with g->lock held.
+ */
+static int
+satip_rtp_group_send(satip_rtp_session_t *rtp, satip_rtp_group_t *g)
+{
+  satip_rtp_chunk_t *c;
+  struct iovec iov[2*SATIP_RTP_GROUP_BATCH], hv;
+  uint8_t hdrs[12*SATIP_RTP_GROUP_BATCH];
+  int n, r;
+
+  c = TAILQ_FIRST(&g->chunks);
+  while (c != NULL) {
+    while (c && c->seq < rtp->group_tail)
+      c = TAILQ_NEXT(c, link);
+    for (n = 0; c && n < SATIP_RTP_GROUP_BATCH; c = TAILQ_NEXT(c, link), n++) {
+      hv.iov_base = hdrs + n * 12;
+      satip_rtp_header(rtp, &hv, 0);
+      iov[n*2+0].iov_base = hv.iov_base;
+      iov[n*2+0].iov_len  = 12;
+      iov[n*2+1].iov_base = c->data;
+      iov[n*2+1].iov_len  = c->len;
+      rtp->group_tail = c->seq + 1;
+    }
+    if (n == 0)
+      break;
+    r = udp_sendvec(rtp->fd_rtp, iov, 2, n);
+    if (r < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        /* backpressure - drop, the shared worker must not stall other
+           sessions behind one unread socket */
+        tvhtrace(LS_SATIPS, "rtp group backpressure, dropping %d chunks", n);
+        rtp->group_tail = g->seq;
+        return 0;
+      }
+      tvhtrace(LS_SATIPS, "rtp group sendvec failed (errno %d)", errno);
+      return -1;
+    }
+    if (r < n) {
+      rtp->group_tail = g->seq;
+      return 0;
+    }
+  }
+  return 0;
+}
+
+static int
+satip_rtp_group_flush(satip_rtp_session_t *rtp)
+{
+  satip_rtp_group_t *g = rtp->group;
+  int r;
+
+  tvh_mutex_lock(&g->lock);
+  if (g->builder == rtp)
+    satip_rtp_group_publish(g); /* push out the partially filled chunk */
+  r = satip_rtp_group_send(rtp, g);
+  tvh_mutex_unlock(&g->lock);
+  return r;
+}
+
+static void
+satip_rtp_group_join(satip_rtp_session_t *rtp)
+{
+  satip_rtp_group_t *g;
+
+  lock_assert(&satip_rtp_lock);
+  if (rtp->port == RTSP_TCP_DATA)
+    return;
+  LIST_FOREACH(g, &satip_rtp_groups, link)
+    if (g->frontend == rtp->frontend && g->source == rtp->source &&
+        g->pids.all == rtp->pids.all &&
+        mpegts_pid_cmp(&g->pids, &rtp->pids) == 0)
+      break;
+  if (g == NULL) {
+    g = calloc(1, sizeof(*g));
+    if (g == NULL)
+      return;
+    g->frontend = rtp->frontend;
+    g->source = rtp->source;
+    mpegts_pid_init(&g->pids);
+    mpegts_pid_copy(&g->pids, &rtp->pids);
+    TAILQ_INIT(&g->chunks);
+    tvh_mutex_init(&g->lock, NULL);
+    LIST_INSERT_HEAD(&satip_rtp_groups, g, link);
+  }
+  tvh_mutex_lock(&g->lock);
+  rtp->group = g;
+  rtp->group_tail = g->seq;
+  LIST_INSERT_HEAD(&g->members, rtp, group_link);
+  if (g->builder == NULL)
+    g->builder = rtp;
+  tvh_mutex_unlock(&g->lock);
+}
+
+static void
+satip_rtp_group_leave(satip_rtp_session_t *rtp)
+{
+  satip_rtp_group_t *g = rtp->group;
+  satip_rtp_chunk_t *c;
+
+  lock_assert(&satip_rtp_lock);
+  if (g == NULL)
+    return;
+  tvh_mutex_lock(&g->lock);
+  LIST_REMOVE(rtp, group_link);
+  rtp->group = NULL;
+  if (g->builder == rtp)
+    g->builder = LIST_FIRST(&g->members);
+  tvh_mutex_unlock(&g->lock);
+  if (LIST_EMPTY(&g->members)) {
+    LIST_REMOVE(g, link);
+    while ((c = TAILQ_FIRST(&g->chunks)) != NULL) {
+      TAILQ_REMOVE(&g->chunks, c, link);
+      free(c);
+    }
+    free(g->fill);
+    mpegts_pid_done(&g->pids);
+    tvh_mutex_destroy(&g->lock);
+    free(g);
+  }
+}
+
 static int
 satip_rtp_tcp_data(satip_rtp_session_t *rtp, uint8_t stream,
                    uint8_t *data, size_t data_len, int may_discard)
@@ -372,40 +661,24 @@ satip_rtp_signal_status(satip_rtp_session_t *rtp, signal_status_t *sig)
   tvh_mutex_unlock(&rtp->lock);
 }
 
-static void *
-satip_rtp_thread(void *aux)
+static void
+satip_rtp_session_run(satip_rtp_session_t *rtp)
 {
-  satip_rtp_session_t *rtp = aux;
-  streaming_queue_t *sq = rtp->sq;
+  struct streaming_message_queue q;
   streaming_message_t *sm;
   th_subscription_t *subs = rtp->subs;
   pktbuf_t *pb;
-  char peername[50];
-  int alive = 1, fatal = 0, r;
-  int tcp = rtp->port == RTSP_TCP_DATA;
+  int tcp = rtp->port == RTSP_TCP_DATA, r;
 
-  tcp_get_str_from_ip(&rtp->peer, peername, sizeof(peername));
-  tvhdebug(LS_SATIPS, "RTP streaming to %s:%d open", peername,
-           tcp ? ntohs(IP_PORT(rtp->peer)) : rtp->port);
-
-  tvh_mutex_lock(&sq->sq_mutex);
-  while (rtp->sq && !fatal) {
-    sm = TAILQ_FIRST(&sq->sq_queue);
-    if (sm == NULL) {
-      if (tcp) {
-        r = satip_rtp_flush_tcp_data(rtp);
-      } else {
-        r = satip_rtp_send(rtp);
-      }
-      if (r) {
-        fatal = 1;
-        continue;
-      }
-      tvh_cond_wait(&sq->sq_cond, &sq->sq_mutex);
+  TAILQ_INIT(&q);
+  streaming_lfqueue_drain(rtp->lfq, &q);
+
+  while ((sm = TAILQ_FIRST(&q)) != NULL) {
+    TAILQ_REMOVE(&q, sm, sm_link);
+    if (rtp->fatal) {
+      streaming_msg_free(sm);
       continue;
     }
-    streaming_queue_remove(sq, sm);
-    tvh_mutex_unlock(&sq->sq_mutex);
 
     switch (sm->sm_type) {
     case SMT_MPEGTS:
@@ -418,10 +691,12 @@ satip_rtp_thread(void *aux)
         tvh_mutex_lock(&rtp->lock);
         if (tcp)
           r = satip_rtp_tcp_loop(rtp, pktbuf_ptr(pb), r);
+        else if (rtp->group)
+          r = satip_rtp_group_loop(rtp, pktbuf_ptr(pb), r);
         else
           r = satip_rtp_loop(rtp, pktbuf_ptr(pb), r);
         tvh_mutex_unlock(&rtp->lock);
-        if (r) fatal = 1;
+        if (r) rtp->fatal = 1;
       }
       break;
     case SMT_SIGNAL_STATUS:
@@ -431,7 +706,6 @@ satip_rtp_thread(void *aux)
     case SMT_EXIT:
       if (rtp->no_data_cb)
         rtp->no_data_cb(rtp->no_data_opaque);
-      alive = 0;
       break;
 
     case SMT_START:
@@ -448,24 +722,101 @@ satip_rtp_thread(void *aux)
     }
 
     streaming_msg_free(sm);
-    tvh_mutex_lock(&sq->sq_mutex);
   }
-  tvh_mutex_unlock(&sq->sq_mutex);
 
-  tvhdebug(LS_SATIPS, "RTP streaming to %s:%d closed (%s request)%s",
-           peername,
-           tcp ? ntohs(IP_PORT(rtp->peer)) : rtp->port,
-           alive ? "remote" : "streaming",
-           fatal ? " (fatal)" : "");
+  /* the queue ran dry - push out any partially filled packet */
+  if (!rtp->fatal) {
+    if (tcp) {
+      r = satip_rtp_flush_tcp_data(rtp);
+    } else {
+      tvh_mutex_lock(&rtp->lock);
+      if (rtp->group)
+        r = satip_rtp_group_flush(rtp);
+      else
+        r = satip_rtp_send(rtp);
+      tvh_mutex_unlock(&rtp->lock);
+    }
+    if (r)
+      rtp->fatal = 1;
+  }
+}
+
+static void
+satip_rtp_worker_ctl(satip_rtp_worker_t *w)
+{
+  satip_rtp_session_t *rtp;
+  char buf[16];
+
+  while (read(w->ctl.rd, buf, sizeof(buf)) > 0);
+  tvh_mutex_lock(&satip_rtp_lock);
+  TAILQ_FOREACH(rtp, &satip_rtp_sessions, link) {
+    if (rtp->worker != w) continue;
+    if (rtp->worker_state == SATIP_RTP_WS_ADD) {
+      tvhpoll_add1(w->poll, streaming_lfqueue_fd(rtp->lfq), TVHPOLL_IN, rtp);
+      rtp->worker_state = SATIP_RTP_WS_RUN;
+    } else if (rtp->worker_state == SATIP_RTP_WS_REMOVE) {
+      tvhpoll_rem1(w->poll, streaming_lfqueue_fd(rtp->lfq));
+      rtp->worker_state = SATIP_RTP_WS_GONE;
+      w->count--;
+      tvh_cond_signal(&satip_rtp_worker_cond, 1);
+    }
+  }
+  tvh_mutex_unlock(&satip_rtp_lock);
+}
+
+static void *
+satip_rtp_worker_thread(void *aux)
+{
+  satip_rtp_worker_t *w = aux;
+  tvhpoll_event_t ev[32];
+  int n, i, ctl;
 
+  while (atomic_get(&satip_rtp_workers_run)) {
+    n = tvhpoll_wait(w->poll, ev, ARRAY_SIZE(ev), -1);
+    if (n < 0)
+      continue;
+    /* data first - the ctl ack tells satip_rtp_close the worker is
+       completely done with a session */
+    ctl = 0;
+    for (i = 0; i < n; i++) {
+      if (ev[i].ptr == w) {
+        ctl = 1;
+        continue;
+      }
+      satip_rtp_session_run(ev[i].ptr);
+    }
+    if (ctl)
+      satip_rtp_worker_ctl(w);
+  }
   return NULL;
 }
 
+static void
+satip_rtp_workers_start(void)
+{
+  satip_rtp_worker_t *w;
+  int i;
+
+  lock_assert(&satip_rtp_lock);
+  if (atomic_get(&satip_rtp_workers_run))
+    return;
+  atomic_set(&satip_rtp_workers_run, 1);
+  for (i = 0; i < SATIP_RTP_WORKERS; i++) {
+    w = &satip_rtp_worker[i];
+    w->poll = tvhpoll_create(32);
+    if (tvh_pipe(O_NONBLOCK, &w->ctl))
+      continue;
+    tvhpoll_add1(w->poll, w->ctl.rd, TVHPOLL_IN, w);
+    w->count = 0;
+    tvh_thread_create(&w->tid, NULL, satip_rtp_worker_thread, w, "satip-rtp");
+  }
+}
+
 /*
  *
  */
 void *satip_rtp_queue(th_subscription_t *subs,
-                      streaming_queue_t *sq,
+                      streaming_lfqueue_t *lfq,
                       http_connection_t *hc,
                       struct sockaddr_storage *peer, int port,
                       int fd_rtp, int fd_rtcp,
@@ -475,9 +826,11 @@ void *satip_rtp_queue(th_subscription_t *subs,
                       void *no_data_opaque)
 {
   satip_rtp_session_t *rtp = calloc(1, sizeof(*rtp));
+  satip_rtp_worker_t *w;
   size_t len;
   socklen_t socklen;
-  int dscp, payload;
+  char peername[50];
+  int dscp, payload, i;
 
   if (rtp == NULL)
     return NULL;
@@ -490,7 +843,7 @@ void *satip_rtp_queue(th_subscription_t *subs,
   rtp->fd_rtp = fd_rtp;
   rtp->fd_rtcp = fd_rtcp;
   rtp->subs = subs;
-  rtp->sq = sq;
+  rtp->lfq = lfq;
   rtp->hc = hc;
   payload = satip_server_conf.satip_rtptcpsize * 188 + 12 + 4;
   rtp->tcp_payload = MINMAX(payload, RTP_TCP_MIN_PAYLOAD, RTP_TCP_MAX_PAYLOAD);
@@ -541,9 +894,23 @@ void *satip_rtp_queue(th_subscription_t *subs,
 
   tvhtrace(LS_SATIPS, "rtp queue %p", rtp);
 
+  tcp_get_str_from_ip(&rtp->peer, peername, sizeof(peername));
+  tvhdebug(LS_SATIPS, "RTP streaming to %s:%d open", peername,
+           port == RTSP_TCP_DATA ? ntohs(IP_PORT(rtp->peer)) : rtp->port);
+
   tvh_mutex_lock(&satip_rtp_lock);
+  satip_rtp_workers_start();
+  /* attach to the least loaded worker */
+  w = &satip_rtp_worker[0];
+  for (i = 1; i < SATIP_RTP_WORKERS; i++)
+    if (satip_rtp_worker[i].count < w->count)
+      w = &satip_rtp_worker[i];
+  rtp->worker = w;
+  rtp->worker_state = SATIP_RTP_WS_ADD;
+  w->count++;
   TAILQ_INSERT_TAIL(&satip_rtp_sessions, rtp, link);
-  tvh_thread_create(&rtp->tid, NULL, satip_rtp_thread, rtp, "satip-rtp");
+  satip_rtp_group_join(rtp);
+  tvh_write(w->ctl.wr, "", 1);
   tvh_mutex_unlock(&satip_rtp_lock);
   return rtp;
 }
@@ -568,6 +935,9 @@ void satip_rtp_update_pids(void *_rtp, mpegts_apids_t *pids)
   tvh_mutex_lock(&satip_rtp_lock);
   tvh_mutex_lock(&rtp->lock);
   mpegts_pid_copy(&rtp->pids, pids);
+  /* regroup - the shared assembly is keyed on the exact PID set */
+  satip_rtp_group_leave(rtp);
+  satip_rtp_group_join(rtp);
   tvh_mutex_unlock(&rtp->lock);
   tvh_mutex_unlock(&satip_rtp_lock);
 }
@@ -613,20 +983,27 @@ void satip_rtp_close(void *_rtp)
 {
   satip_rtp_session_t *rtp = _rtp;
   satip_rtp_table_t *tbl;
-  streaming_queue_t *sq;
+  char peername[50];
 
   if (rtp == NULL)
     return;
   tvh_mutex_lock(&satip_rtp_lock);
   tvhtrace(LS_SATIPS, "rtp close %p", rtp);
+  if (rtp->worker) {
+    /* detach from the worker poll set and wait until the worker has
+       completely finished with this session */
+    rtp->worker_state = SATIP_RTP_WS_REMOVE;
+    tvh_write(rtp->worker->ctl.wr, "", 1);
+    while (rtp->worker_state != SATIP_RTP_WS_GONE)
+      tvh_cond_wait(&satip_rtp_worker_cond, &satip_rtp_lock);
+  }
+  satip_rtp_group_leave(rtp);
   TAILQ_REMOVE(&satip_rtp_sessions, rtp, link);
-  sq = rtp->sq;
-  tvh_mutex_lock(&sq->sq_mutex);
-  rtp->sq = NULL;
-  tvh_cond_signal(&sq->sq_cond, 0);
-  tvh_mutex_unlock(&sq->sq_mutex);
   tvh_mutex_unlock(&satip_rtp_lock);
-  pthread_join(rtp->tid, NULL);
+  tcp_get_str_from_ip(&rtp->peer, peername, sizeof(peername));
+  tvhdebug(LS_SATIPS, "RTP streaming to %s:%d closed%s", peername,
+           rtp->port == RTSP_TCP_DATA ? ntohs(IP_PORT(rtp->peer)) : rtp->port,
+           rtp->fatal ? " (fatal)" : "");
   if (rtp->port == RTSP_TCP_DATA) {
     http_extra_destroy(rtp->hc);
     free(rtp->tcp_data.iov_base);
@@ -935,7 +1312,7 @@ satip_rtcp_thread(void *aux)
     } while (us > 0);
     tvh_mutex_lock(&satip_rtp_lock);
     TAILQ_FOREACH(rtp, &satip_rtp_sessions, link) {
-      if (rtp->sq == NULL || rtp->disable_rtcp) continue;
+      if (rtp->worker_state != SATIP_RTP_WS_RUN || rtp->disable_rtcp) continue;
       len = satip_rtcp_build(rtp, msg);
       if (len <= 0) continue;
       if (tvhtrace_enabled()) {
@@ -982,10 +1359,14 @@ end:
 void satip_rtp_init(int boot)
 {
   TAILQ_INIT(&satip_rtp_sessions);
+  LIST_INIT(&satip_rtp_groups);
   tvh_mutex_init(&satip_rtp_lock, NULL);
+  tvh_cond_init(&satip_rtp_worker_cond, 1);
 
-  if (boot)
+  if (boot) {
     atomic_set(&satip_rtcp_run, 0);
+    atomic_set(&satip_rtp_workers_run, 0);
+  }
 
   if (!boot && !atomic_get(&satip_rtcp_run)) {
     atomic_set(&satip_rtcp_run, 1);
@@ -998,7 +1379,23 @@ void satip_rtp_init(int boot)
  */
 void satip_rtp_done(void)
 {
+  satip_rtp_worker_t *w;
+  int i;
+
   assert(TAILQ_EMPTY(&satip_rtp_sessions));
+  assert(LIST_EMPTY(&satip_rtp_groups));
+  if (atomic_get(&satip_rtp_workers_run)) {
+    atomic_set(&satip_rtp_workers_run, 0);
+    for (i = 0; i < SATIP_RTP_WORKERS; i++)
+      tvh_write(satip_rtp_worker[i].ctl.wr, "", 1);
+    for (i = 0; i < SATIP_RTP_WORKERS; i++) {
+      w = &satip_rtp_worker[i];
+      pthread_join(w->tid, NULL);
+      tvhpoll_destroy(w->poll);
+      w->poll = NULL;
+      tvh_pipe_close(&w->ctl);
+    }
+  }
   if (atomic_get(&satip_rtcp_run)) {
     atomic_set(&satip_rtcp_run, 0);
     tvh_thread_kill(satip_rtcp_tid, SIGTERM);
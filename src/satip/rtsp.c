@@ -703,7 +703,7 @@ rtsp_start
     rs->dmc_tuned = dmc;
     rs->mux = mux;
     rs->mux_created = created;
-    if (profile_chain_raw_open(&rs->prch, (mpegts_mux_t *)rs->mux, qsize, 0))
+    if (profile_chain_raw_open_poll(&rs->prch, (mpegts_mux_t *)rs->mux, qsize))
       goto endclean;
     rs->used_weight = weight;
     rs->subs = subscription_create_from_mux(&rs->prch, NULL,
@@ -738,7 +738,7 @@ pids:
       goto endclean;
     rs->no_data = 0;
     rs->rtp_handle =
-      satip_rtp_queue(rs->subs, &rs->prch.prch_sq,
+      satip_rtp_queue(rs->subs, &rs->prch.prch_lfq,
                       hc, hc->hc_peer, rs->rtp_peer_port,
                       rs->udp_rtp ? rs->udp_rtp->fd : hc->hc_fd,
                       rs->udp_rtcp ? rs->udp_rtcp->fd : -1,
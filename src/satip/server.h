@@ -77,7 +77,7 @@ extern struct satip_server_conf satip_server_conf;
 extern const idclass_t satip_server_class;
 
 void *satip_rtp_queue(th_subscription_t *subs,
-                      streaming_queue_t *sq,
+                      streaming_lfqueue_t *lfq,
                       http_connection_t *hc,
                       struct sockaddr_storage *peer, int port,
                       int fd_rtp, int fd_rtcp,
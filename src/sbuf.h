@@ -34,8 +34,11 @@ typedef struct sbuf {
   int      sb_size;
   uint16_t sb_err;
   uint8_t  sb_bswap;
+  int64_t  sb_arrival; /* wire arrival of the oldest unconsumed data
+                          (monoclock), 0 = unknown */
 } sbuf_t;
 
+extern struct memoryinfo sbuf_memoryinfo;
 
 void sbuf_init(sbuf_t *sb);
 void sbuf_init_fixed(sbuf_t *sb, int len);
@@ -45,11 +48,7 @@ void sbuf_free(sbuf_t *sb);
 void sbuf_reset(sbuf_t *sb, int max_len);
 void sbuf_reset_and_alloc(sbuf_t *sb, int len);
 
-static inline void sbuf_steal_data(sbuf_t *sb)
-{
-  sb->sb_data = NULL;
-  sb->sb_ptr = sb->sb_size = sb->sb_err = 0;
-}
+void sbuf_steal_data(sbuf_t *sb);
 
 static inline void sbuf_err(sbuf_t *sb, int errors)
 {
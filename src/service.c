@@ -208,6 +208,17 @@ const idclass_t service_class = {
       .off      = offsetof(service_t, s_prio),
       .opts     = PO_ADVANCED
     },
+    {
+      .type     = PT_BOOL,
+      .id       = "warm_standby",
+      .name     = N_("Warm standby"),
+      .desc     = N_("Keep the mux of an alternative service for the "
+                     "mapped channel tuned on a spare input while this "
+                     "service is streamed, so a failover does not have "
+                     "to wait for a tune."),
+      .off      = offsetof(service_t, s_warm_standby),
+      .opts     = PO_ADVANCED,
+    },
     {
       .type     = PT_BOOL,
       .id       = "encrypted",
@@ -272,6 +283,7 @@ service_stop(service_t *t)
 
   t->s_status = SERVICE_IDLE;
   tvhlog_limit_reset(&t->s_tei_log);
+  t->s_qual.sq_pcr_last_mono = 0;
 
   tvh_mutex_unlock(&t->s_stream_mutex);
 }
@@ -321,6 +333,7 @@ service_start(service_t *t, int instance, int weight, int flags,
   t->s_streaming_live   = 0;
   t->s_scrambled_seen   = 0;
   t->s_scrambled_pass   = !!(flags & SUBSCRIPTION_NODESCR);
+  t->s_audio_only       = !!(flags & SUBSCRIPTION_AUDIOONLY);
   t->s_start_time       = mclk();
 
   tvh_mutex_lock(&t->s_stream_mutex);
@@ -656,6 +669,8 @@ service_destroy(service_t *t, int delconf)
     t->s_hbbtv = NULL;
   }
 
+  service_tsring_disarm(t);
+
   switch (t->s_type) {
   case STYPE_RAW:
     TAILQ_REMOVE(&service_raw_all, t, s_all_link);
@@ -1035,6 +1050,242 @@ service_set_streaming_status_flags_(service_t *t, int set)
   service_send_streaming_status(t);
 }
 
+/**
+ * Return the current quality window, advancing the ring when the
+ * active bucket is older than SERVICE_QUAL_STEP; stream mutex held
+ */
+static struct service_qual_bucket *
+service_qual_bucket(service_t *t)
+{
+  service_qual_t *sq = &t->s_qual;
+  struct service_qual_bucket *qb = &sq->sq_hist[sq->sq_cur];
+  int64_t now = mclk();
+
+  if (qb->qb_start == 0) {
+    qb->qb_start = now;
+  } else if (now - qb->qb_start >= sec2mono(SERVICE_QUAL_STEP)) {
+    sq->sq_cur = (sq->sq_cur + 1) % SERVICE_QUAL_BUCKETS;
+    qb = &sq->sq_hist[sq->sq_cur];
+    memset(qb, 0, sizeof(*qb));
+    qb->qb_start = now;
+  }
+  return qb;
+}
+
+/**
+ * Fold one run of input packets into the quality accounting
+ */
+void
+service_qual_input(service_t *t, int packets, int cc_errors,
+                   int tei_errors, int sc_stalls)
+{
+  service_qual_t *sq = &t->s_qual;
+  struct service_qual_bucket *qb;
+
+  lock_assert(&t->s_stream_mutex);
+
+  qb = service_qual_bucket(t);
+  qb->qb_packets    += packets;
+  qb->qb_cc_errors  += cc_errors;
+  qb->qb_tei_errors += tei_errors;
+  qb->qb_sc_stalls  += sc_stalls;
+  sq->sq_packets    += packets;
+  sq->sq_cc_errors  += cc_errors;
+  sq->sq_tei_errors += tei_errors;
+  sq->sq_sc_stalls  += sc_stalls;
+}
+
+/**
+ * Record a PCR sample (90kHz units) and track the worst deviation of
+ * the PCR interval against the monotonic clock inside the window
+ */
+void
+service_qual_pcr(service_t *t, int64_t pcr)
+{
+  service_qual_t *sq = &t->s_qual;
+  struct service_qual_bucket *qb;
+  int64_t now = getfastmonoclock(), dpcr, dmono, jitter;
+
+  lock_assert(&t->s_stream_mutex);
+
+  if (sq->sq_pcr_last_mono) {
+    dpcr  = (pcr - sq->sq_pcr_last) & PTS_MASK;
+    dpcr  = dpcr * 100 / 9;             /* 90kHz ticks -> microseconds */
+    dmono = now - sq->sq_pcr_last_mono;
+    /* ignore samples across discontinuities and retunes */
+    if (dpcr < sec2mono(1) && dmono < sec2mono(1)) {
+      jitter = dpcr - dmono;
+      if (jitter < 0)
+        jitter = -jitter;
+      qb = service_qual_bucket(t);
+      if (jitter > qb->qb_pcr_jitter_max)
+        qb->qb_pcr_jitter_max = jitter;
+    }
+  }
+  sq->sq_pcr_last = pcr;
+  sq->sq_pcr_last_mono = now;
+}
+
+/**
+ * Serialize the quality accounting; stream mutex must be held
+ */
+htsmsg_t *
+service_qual_msg(service_t *t)
+{
+  service_qual_t *sq = &t->s_qual;
+  struct service_qual_bucket *qb;
+  htsmsg_t *m = htsmsg_create_map(), *l = htsmsg_create_list(), *e;
+  int64_t now = mclk();
+  int i, k;
+
+  lock_assert(&t->s_stream_mutex);
+
+  htsmsg_add_s64(m, "packets",    sq->sq_packets);
+  htsmsg_add_s64(m, "cc_errors",  sq->sq_cc_errors);
+  htsmsg_add_s64(m, "tei_errors", sq->sq_tei_errors);
+  htsmsg_add_s64(m, "sc_stalls",  sq->sq_sc_stalls);
+  for (i = 0; i < SERVICE_QUAL_BUCKETS; i++) {
+    k  = (sq->sq_cur + 1 + i) % SERVICE_QUAL_BUCKETS;
+    qb = &sq->sq_hist[k];
+    if (qb->qb_start == 0)
+      continue;
+    e = htsmsg_create_map();
+    htsmsg_add_s64(e, "age",               mono2sec(now - qb->qb_start));
+    htsmsg_add_u32(e, "packets",           qb->qb_packets);
+    htsmsg_add_u32(e, "cc_errors",         qb->qb_cc_errors);
+    htsmsg_add_u32(e, "tei_errors",        qb->qb_tei_errors);
+    htsmsg_add_u32(e, "sc_stalls",         qb->qb_sc_stalls);
+    htsmsg_add_u32(e, "pcr_jitter_max_us", qb->qb_pcr_jitter_max);
+    htsmsg_add_msg(l, NULL, e);
+  }
+  htsmsg_add_msg(m, "windows", l);
+  return m;
+}
+
+/**
+ * Arm the flight recorder with a fresh ring; an already armed ring
+ * is replaced (and its samples dropped)
+ */
+int
+service_tsring_arm(service_t *t, uint32_t entries)
+{
+  service_tsring_t *tr, *old;
+  service_tsring_entry_t *ring;
+
+  if (entries == 0)
+    entries = SERVICE_TSRING_DEF_ENTRIES;
+  if (entries > SERVICE_TSRING_MAX_ENTRIES)
+    entries = SERVICE_TSRING_MAX_ENTRIES;
+  ring = calloc(entries, sizeof(*ring));
+  if (ring == NULL)
+    return -1;
+  tr = calloc(1, sizeof(*tr));
+  tr->tr_ring = ring;
+  tr->tr_size = entries;
+  tvh_mutex_lock(&t->s_stream_mutex);
+  old = t->s_tsring;
+  t->s_tsring = tr;
+  tvh_mutex_unlock(&t->s_stream_mutex);
+  if (old) {
+    free(old->tr_ring);
+    free(old);
+  }
+  tvhinfo(LS_SERVICE, "%s: TS flight recorder armed (%u entries)",
+          service_nicename(t), entries);
+  return 0;
+}
+
+/**
+ *
+ */
+void
+service_tsring_disarm(service_t *t)
+{
+  service_tsring_t *tr;
+
+  tvh_mutex_lock(&t->s_stream_mutex);
+  tr = t->s_tsring;
+  t->s_tsring = NULL;
+  tvh_mutex_unlock(&t->s_stream_mutex);
+  if (tr) {
+    free(tr->tr_ring);
+    free(tr);
+    tvhinfo(LS_SERVICE, "%s: TS flight recorder disarmed",
+            service_nicename(t));
+  }
+}
+
+/**
+ * Record one run of TS headers; called from the input path with the
+ * stream mutex held and only while armed
+ */
+void
+service_tsring_input(service_t *t, const uint8_t *tsb, int len)
+{
+  service_tsring_t *tr = t->s_tsring;
+  service_tsring_entry_t *te;
+  int64_t now = mclk(), pcr;
+
+  lock_assert(&t->s_stream_mutex);
+
+  for ( ; len >= 188; tsb += 188, len -= 188) {
+    te = &tr->tr_ring[tr->tr_samples % tr->tr_size];
+    te->te_time  = now;
+    te->te_pid   = (tsb[1] & 0x1f) << 8 | tsb[2];
+    te->te_cc    = (tsb[3] & 0x10) ? 0x80 | (tsb[3] & 0xf) : 0;
+    te->te_flags = ((tsb[1] & 0x80) ? SERVICE_TSRING_TEI : 0) |
+                   ((tsb[1] & 0x40) ? SERVICE_TSRING_PUSI : 0) |
+                   ((tsb[3] & 0xc0) ? SERVICE_TSRING_SCRAMBLED : 0) |
+                   ((tsb[3] & 0x20) ? SERVICE_TSRING_AF : 0);
+    te->te_pcr   = PTS_UNSET;
+    if ((tsb[3] & 0x20) && tsb[4] >= 7 && (tsb[5] & 0x10)) {
+      pcr  =  (uint64_t)tsb[6] << 25;
+      pcr |=  (uint64_t)tsb[7] << 17;
+      pcr |=  (uint64_t)tsb[8] << 9;
+      pcr |=  (uint64_t)tsb[9] << 1;
+      pcr |= ((uint64_t)tsb[10] >> 7) & 0x01;
+      te->te_pcr = pcr;
+    }
+    tr->tr_samples++;
+  }
+}
+
+/**
+ * Serialize the recorded samples, oldest first; stream mutex must
+ * be held
+ */
+htsmsg_t *
+service_tsring_msg(service_t *t)
+{
+  service_tsring_t *tr = t->s_tsring;
+  service_tsring_entry_t *te;
+  htsmsg_t *m = htsmsg_create_map(), *l = htsmsg_create_list(), *e;
+  uint64_t i, first;
+
+  lock_assert(&t->s_stream_mutex);
+
+  htsmsg_add_s64(m, "now", mclk());
+  if (tr) {
+    htsmsg_add_u32(m, "entries", tr->tr_size);
+    htsmsg_add_s64(m, "samples", tr->tr_samples);
+    first = tr->tr_samples > tr->tr_size ? tr->tr_samples - tr->tr_size : 0;
+    for (i = first; i < tr->tr_samples; i++) {
+      te = &tr->tr_ring[i % tr->tr_size];
+      e = htsmsg_create_map();
+      htsmsg_add_s64(e, "time",  te->te_time);
+      htsmsg_add_u32(e, "pid",   te->te_pid);
+      if (te->te_cc & 0x80)
+        htsmsg_add_u32(e, "cc",  te->te_cc & 0xf);
+      htsmsg_add_u32(e, "flags", te->te_flags);
+      if (te->te_pcr != PTS_UNSET)
+        htsmsg_add_s64(e, "pcr", te->te_pcr);
+      htsmsg_add_msg(l, NULL, e);
+    }
+  }
+  htsmsg_add_msg(m, "packets", l);
+  return m;
+}
+
 /**
  *
  */
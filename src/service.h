@@ -54,6 +54,61 @@ LIST_HEAD(service_list, service);
 RB_HEAD(service_tree, service);
 TAILQ_HEAD(service_queue, service);
 
+/**
+ * Rolling per-service quality accounting.  The input path folds CC and
+ * transport errors, descrambler stalls and PCR jitter into a ring of
+ * fixed windows so short glitches stay visible after the fact.
+ * Protected by s_stream_mutex.
+ */
+#define SERVICE_QUAL_BUCKETS  15
+#define SERVICE_QUAL_STEP     60  /* seconds covered by one bucket */
+
+typedef struct service_qual {
+  struct service_qual_bucket {
+    int64_t  qb_start;            /* mclk() when opened, 0 = unused */
+    uint32_t qb_packets;
+    uint32_t qb_cc_errors;
+    uint32_t qb_tei_errors;
+    uint32_t qb_sc_stalls;        /* packets lost to a stalled descrambler */
+    uint32_t qb_pcr_jitter_max;   /* worst PCR deviation, microseconds */
+  } sq_hist[SERVICE_QUAL_BUCKETS];
+  int      sq_cur;
+  uint64_t sq_packets;
+  uint64_t sq_cc_errors;
+  uint64_t sq_tei_errors;
+  uint64_t sq_sc_stalls;
+  int64_t  sq_pcr_last;           /* last PCR sample (90kHz) */
+  int64_t  sq_pcr_last_mono;      /* 0 = no previous sample */
+} service_qual_t;
+
+/**
+ * Flight recorder: a fixed ring of per-packet TS header samples (no
+ * payloads) armed at runtime for post-hoc glitch analysis.  The input
+ * path pays one pointer test while disarmed.  Protected by
+ * s_stream_mutex.
+ */
+#define SERVICE_TSRING_DEF_ENTRIES (32*1024)
+#define SERVICE_TSRING_MAX_ENTRIES (1024*1024)
+
+#define SERVICE_TSRING_TEI       0x01  /* transport error indicator */
+#define SERVICE_TSRING_PUSI      0x02  /* payload unit start */
+#define SERVICE_TSRING_SCRAMBLED 0x04
+#define SERVICE_TSRING_AF        0x08  /* adaptation field present */
+
+typedef struct service_tsring_entry {
+  int64_t  te_time;               /* mclk() of the input run */
+  int64_t  te_pcr;                /* PCR sample (90kHz) or PTS_UNSET */
+  uint16_t te_pid;
+  uint8_t  te_cc;                 /* 0x80 bit set when a CC is present */
+  uint8_t  te_flags;              /* SERVICE_TSRING_* */
+} service_tsring_entry_t;
+
+typedef struct service_tsring {
+  service_tsring_entry_t *tr_ring;
+  uint32_t tr_size;               /* ring capacity in entries */
+  uint64_t tr_samples;            /* total, next slot = samples % size */
+} service_tsring_t;
+
 /**
  *
  */
@@ -101,7 +156,7 @@ typedef struct service_lcn {
   LIST_ENTRY(service_lcn) sl_link;
   void     *sl_bouquet;
   uint64_t  sl_lcn;
-  uint8_t   sl_seen;
+  uint32_t  sl_seen;    /* bouquet scan generation that last saw this LCN */
 } service_lcn_t;
 
 
@@ -199,6 +254,7 @@ typedef struct service {
   int s_verified;  // In PMT and valid streams
   int s_auto;
   int s_prio;
+  int s_warm_standby;
   int s_type_user;
   int s_pts_shift; // in ms (may be negative)
 
@@ -364,6 +420,7 @@ typedef struct service {
   struct th_descrambler_list s_descramblers;
   uint8_t s_scrambled_seen;
   uint8_t s_scrambled_pass;
+  uint8_t s_audio_only;     /* started with the reduced (audio) pid set */
   th_descrambler_runtime_t *s_descramble;
   void *s_descrambler; /* last active descrambler */
   struct descramble_info *s_descramble_info;
@@ -380,6 +437,10 @@ typedef struct service {
 
   tvhlog_limit_t s_tei_log;
 
+  service_qual_t s_qual;
+
+  service_tsring_t *s_tsring;     /* NULL while disarmed */
+
   /*
    * Local channel numbers per bouquet
    */
@@ -474,6 +535,21 @@ service_reset_streaming_status_flags(service_t *t, int flag)
     service_set_streaming_status_flags_(t, n & ~flag);
 }
 
+void service_qual_input(service_t *t, int packets, int cc_errors,
+                        int tei_errors, int sc_stalls);
+
+void service_qual_pcr(service_t *t, int64_t pcr);
+
+htsmsg_t *service_qual_msg(service_t *t);
+
+int service_tsring_arm(service_t *t, uint32_t entries);
+
+void service_tsring_disarm(service_t *t);
+
+void service_tsring_input(service_t *t, const uint8_t *tsb, int len);
+
+htsmsg_t *service_tsring_msg(service_t *t);
+
 streaming_start_t *service_build_streaming_start(service_t *t);
 
 void service_restart(service_t *t);
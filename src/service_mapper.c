@@ -65,7 +65,10 @@ service_mapper_start ( const service_mapper_conf_t *conf, htsmsg_t *uuids )
   if (TAILQ_EMPTY(&service_mapper_queue))
     service_mapper_reset_stats();
 
-  /* Check each service */
+  /* Check each service; batch the channel saves and keep a name match
+   * index alive for the whole pass */
+  channel_update_batch_begin();
+  service_mapper_index_begin();
   TAILQ_FOREACH(s, &service_all, s_all_link) {
     if (uuids) {
       htsmsg_field_t *f;
@@ -121,7 +124,9 @@ service_mapper_start ( const service_mapper_conf_t *conf, htsmsg_t *uuids )
       service_mapper_process(conf, s, NULL);
     }
   }
-  
+  service_mapper_index_end();
+  channel_update_batch_end();
+
   /* Notify */
   api_service_mapper_notify();
 
@@ -192,7 +197,135 @@ service_mapper_create ( idnode_t *s, idnode_t *c, void *origin )
 }
 
 /*
- * Process a service 
+ * Precomputed name -> channel match index
+ *
+ * A full-network remap calls service_mapper_process once per service and
+ * every call scanned the whole channel list (twice with fuzzy matching
+ * enabled, building a fuzzy name per channel per scan). The index groups
+ * the enabled channels by their fuzzy name so both the exact and the
+ * fuzzy lookup become a single tree search. It only exists for the
+ * duration of a mapping pass; one-off mappings (and the availability
+ * check thread, which drops the global lock between services) fall back
+ * to the linear search.
+ */
+typedef struct service_mapper_idx_chan {
+  LIST_ENTRY(service_mapper_idx_chan) link;
+  channel_t *ch;
+} service_mapper_idx_chan_t;
+
+typedef struct service_mapper_idx_node {
+  RB_ENTRY(service_mapper_idx_node) link;
+  char *fuzzy;
+  LIST_HEAD(, service_mapper_idx_chan) chans;
+} service_mapper_idx_node_t;
+
+static int service_mapper_idx_active;
+static RB_HEAD(service_mapper_idx_tree, service_mapper_idx_node) service_mapper_idx;
+
+static int
+service_mapper_idx_cmp
+  ( service_mapper_idx_node_t *a, service_mapper_idx_node_t *b )
+{
+  return strcmp(a->fuzzy, b->fuzzy);
+}
+
+static void
+service_mapper_index_add ( channel_t *ch )
+{
+  const char *name;
+  service_mapper_idx_node_t *n, *n2;
+  service_mapper_idx_chan_t *ic;
+
+  if (!service_mapper_idx_active || !ch->ch_enabled)
+    return;
+  if ((name = channel_get_name(ch, NULL)) == NULL)
+    return;
+  n = calloc(1, sizeof(*n));
+  n->fuzzy = channel_make_fuzzy_name(name);
+  n2 = RB_INSERT_SORTED(&service_mapper_idx, n, link, service_mapper_idx_cmp);
+  if (n2) {
+    free(n->fuzzy);
+    free(n);
+    n = n2;
+    LIST_FOREACH(ic, &n->chans, link)
+      if (ic->ch == ch)
+        return;
+  }
+  ic = malloc(sizeof(*ic));
+  ic->ch = ch;
+  LIST_INSERT_HEAD(&n->chans, ic, link);
+}
+
+void
+service_mapper_index_begin ( void )
+{
+  channel_t *ch;
+
+  lock_assert(&global_lock);
+
+  if (service_mapper_idx_active++)
+    return;
+  CHANNEL_FOREACH(ch)
+    service_mapper_index_add(ch);
+}
+
+void
+service_mapper_index_end ( void )
+{
+  service_mapper_idx_node_t *n;
+  service_mapper_idx_chan_t *ic;
+
+  lock_assert(&global_lock);
+  assert(service_mapper_idx_active > 0);
+
+  if (--service_mapper_idx_active)
+    return;
+  while ((n = RB_FIRST(&service_mapper_idx)) != NULL) {
+    while ((ic = LIST_FIRST(&n->chans)) != NULL) {
+      LIST_REMOVE(ic, link);
+      free(ic);
+    }
+    RB_REMOVE(&service_mapper_idx, n, link);
+    free(n->fuzzy);
+    free(n);
+  }
+}
+
+static channel_t *
+service_mapper_find_channel ( const char *name, bouquet_t *bq, int fuzzy )
+{
+  service_mapper_idx_node_t *n, skel;
+  service_mapper_idx_chan_t *ic;
+  channel_t *ch = NULL;
+  const char *s;
+
+  if (!service_mapper_idx_active)
+    return fuzzy ? channel_find_by_name_bouquet_fuzzy(name, bq) :
+                   channel_find_by_name_and_bouquet(name, bq);
+
+  skel.fuzzy = channel_make_fuzzy_name(name);
+  n = RB_FIND(&service_mapper_idx, &skel, link, service_mapper_idx_cmp);
+  if (n) {
+    LIST_FOREACH(ic, &n->chans, link) {
+      if (!ic->ch->ch_enabled) continue;
+      if (bq && ic->ch->ch_bouquet != bq) continue;
+      if (fuzzy) {
+        ch = ic->ch;
+        break;
+      }
+      s = channel_get_name(ic->ch, NULL);
+      if (s && strcmp(s, name) == 0) {
+        ch = ic->ch;
+        break;
+      }
+    }
+  }
+  free(skel.fuzzy);
+  return ch;
+}
+
+/*
+ * Process a service
  */
 channel_t *
 service_mapper_process
@@ -255,9 +388,9 @@ service_mapper_process
 
   if (conf->merge_same_name && name && *name) {
     /* Try exact match first */
-    chn = channel_find_by_name_and_bouquet(name, bq);
+    chn = service_mapper_find_channel(name, bq, 0);
     if (!chn && conf->merge_same_name_fuzzy) {
-      chn = channel_find_by_name_bouquet_fuzzy(name, bq);
+      chn = service_mapper_find_channel(name, bq, 1);
     }
   }
   /* If using bouquets then we want to only merge
@@ -333,8 +466,11 @@ service_mapper_process
       channel_tag_map(channel_tag_find_by_name(si.si_network, 1), chn, chn);
     }
 
+    /* keep the match index aware of created/renamed channels */
+    service_mapper_index_add(chn);
+
     /* save */
-    idnode_changed(&chn->ch_id);
+    channel_changed(chn);
   }
   if (!bq) {
     service_mapper_stat.ok++;
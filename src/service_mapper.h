@@ -75,6 +75,10 @@ int service_mapper_create ( idnode_t *s, idnode_t *c, void *origin );
 struct channel *service_mapper_process
   ( const service_mapper_conf_t *conf, struct service *s, struct bouquet *bq );
 
+// Keep a name -> channel match index alive across a mapping pass; may nest
+void service_mapper_index_begin ( void );
+void service_mapper_index_end ( void );
+
 // Resets the stat counters
 void service_mapper_reset_stats ( void );
 
@@ -18,6 +18,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <errno.h>
@@ -39,6 +40,449 @@
 
 static char *settingspath = NULL;
 
+/*
+ * Write-behind queue: dirty records are kept here and written out in
+ * batches by a background thread, so bulk config changes (bouquet
+ * import, mass service mapping) do not serialize thousands of small
+ * synchronous writes on the caller.  Repeated saves of the same path
+ * within a batch window collapse into one write.
+ */
+#define SETTINGS_SAVE_DELAY ms2mono(500)
+
+typedef struct settings_dirty {
+  TAILQ_ENTRY(settings_dirty) sd_link;
+  char *sd_path;
+  htsmsg_t *sd_record;
+} settings_dirty_t;
+
+static tvh_mutex_t settings_save_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static tvh_cond_t settings_save_cond;
+static TAILQ_HEAD(,settings_dirty) settings_dirty_list =
+  TAILQ_HEAD_INITIALIZER(settings_dirty_list);
+static char settings_save_inflight[PATH_MAX]; /* path being written, "" idle */
+static pthread_t settings_save_tid;
+static int settings_save_running;
+
+static void hts_settings_write(htsmsg_t *record, const char *path, int dosync);
+
+/*
+ * Consolidated binary cache: records are appended to a single dot-file
+ * as (path, source file mtime/size, htsmsg_binary2 payload) and the
+ * file is mapped in one pass at startup, so loading the configuration
+ * costs one stat() per record instead of an open/JSON-parse loop.  The
+ * JSON tree stays authoritative - it is still written on every save
+ * and a record whose validators no longer match it is re-parsed (and
+ * re-cached) from the JSON file, so external edits are always honored.
+ */
+#define SETTINGS_CACHE_FILE    ".cache.bin"
+#define SETTINGS_CACHE_MAGIC   "TVHcach1"
+#define SETTINGS_CACHE_MAXDATA (2*1024*1024)
+
+typedef struct settings_cache_rec {
+  uint32_t scr_plen;   /* path length, including the terminating NUL */
+  uint32_t scr_dlen;   /* payload length, 0 marks a removed subtree */
+  uint64_t scr_mtime;  /* validators of the JSON source file */
+  uint64_t scr_size;
+} settings_cache_rec_t; /* followed by path and htsmsg_binary2 payload */
+
+typedef struct settings_cache_entry {
+  RB_ENTRY(settings_cache_entry) sce_link;
+  const char *sce_path;
+  const uint8_t *sce_data;
+  uint32_t sce_dlen;
+  uint64_t sce_mtime;
+  uint64_t sce_size;
+  int sce_heap;        /* path/data are malloc'd, not inside the map */
+} settings_cache_entry_t;
+
+static tvh_mutex_t settings_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static RB_HEAD(,settings_cache_entry) settings_cache;
+static int settings_cache_fd = -1;
+static uint8_t *settings_cache_base;
+static size_t settings_cache_maplen;
+static size_t settings_cache_live;
+
+static int
+sce_cmp(const void *_a, const void *_b)
+{
+  const settings_cache_entry_t *a = _a, *b = _b;
+  return strcmp(a->sce_path, b->sce_path);
+}
+
+static void
+settings_cache_entry_destroy(settings_cache_entry_t *sce)
+{
+  RB_REMOVE(&settings_cache, sce, sce_link);
+  settings_cache_live -= sizeof(settings_cache_rec_t) +
+                         strlen(sce->sce_path) + 1 + sce->sce_dlen;
+  if (sce->sce_heap) {
+    free((void *)sce->sce_path);
+    free((void *)sce->sce_data);
+  }
+  free(sce);
+}
+
+/*
+ * Drop the in-memory entries for a path or a whole subtree
+ */
+static void
+settings_cache_prune(const char *path)
+{
+  settings_cache_entry_t *sce, *next;
+  size_t l = strlen(path);
+
+  for (sce = RB_FIRST(&settings_cache); sce; sce = next) {
+    next = RB_NEXT(sce, sce_link);
+    if (strncmp(sce->sce_path, path, l) == 0 &&
+        (sce->sce_path[l] == '\0' || sce->sce_path[l] == '/'))
+      settings_cache_entry_destroy(sce);
+  }
+}
+
+static void
+settings_cache_entry_set(const char *path, const uint8_t *data, uint32_t dlen,
+                         uint64_t mtime, uint64_t size, int heap)
+{
+  settings_cache_entry_t skel, *sce;
+
+  skel.sce_path = path;
+  sce = RB_FIND(&settings_cache, &skel, sce_link, sce_cmp);
+  if (sce)
+    settings_cache_entry_destroy(sce);
+  sce = malloc(sizeof(*sce));
+  if (heap) {
+    sce->sce_path = strdup(path);
+    sce->sce_data = memcpy(malloc(dlen), data, dlen);
+  } else {
+    sce->sce_path = path;
+    sce->sce_data = data;
+  }
+  sce->sce_dlen  = dlen;
+  sce->sce_mtime = mtime;
+  sce->sce_size  = size;
+  sce->sce_heap  = heap;
+  RB_INSERT_SORTED(&settings_cache, sce, sce_link, sce_cmp);
+  settings_cache_live += sizeof(settings_cache_rec_t) + strlen(path) + 1 + dlen;
+}
+
+/*
+ * One pass over the mapped file; returns the offset of the first
+ * invalid record so a tail truncated by a crash can be cut off
+ */
+static size_t
+settings_cache_scan(void)
+{
+  settings_cache_rec_t rec;
+  const char *path;
+  size_t off = strlen(SETTINGS_CACHE_MAGIC);
+
+  while (off + sizeof(rec) <= settings_cache_maplen) {
+    memcpy(&rec, settings_cache_base + off, sizeof(rec));
+    if (rec.scr_plen < 2 || rec.scr_plen > PATH_MAX ||
+        rec.scr_dlen > SETTINGS_CACHE_MAXDATA ||
+        off + sizeof(rec) + rec.scr_plen + rec.scr_dlen > settings_cache_maplen)
+      break;
+    path = (const char *)settings_cache_base + off + sizeof(rec);
+    if (path[rec.scr_plen - 1] != '\0')
+      break;
+    if (rec.scr_dlen == 0)
+      settings_cache_prune(path);
+    else
+      settings_cache_entry_set(path,
+                               (const uint8_t *)path + rec.scr_plen,
+                               rec.scr_dlen, rec.scr_mtime, rec.scr_size, 0);
+    off += sizeof(rec) + rec.scr_plen + rec.scr_dlen;
+  }
+  return off;
+}
+
+static void
+settings_cache_clear(void)
+{
+  settings_cache_entry_t *sce;
+
+  while ((sce = RB_FIRST(&settings_cache)) != NULL)
+    settings_cache_entry_destroy(sce);
+  settings_cache_live = 0;
+  if (settings_cache_base) {
+    munmap(settings_cache_base, settings_cache_maplen);
+    settings_cache_base = NULL;
+    settings_cache_maplen = 0;
+  }
+  if (settings_cache_fd >= 0) {
+    close(settings_cache_fd);
+    settings_cache_fd = -1;
+  }
+}
+
+static int
+settings_cache_append
+  (const char *path, const uint8_t *data, uint32_t dlen, const struct stat *st)
+{
+  settings_cache_rec_t rec;
+
+  rec.scr_plen  = strlen(path) + 1;
+  rec.scr_dlen  = dlen;
+  rec.scr_mtime = st ? (uint64_t)st->st_mtime : 0;
+  rec.scr_size  = st ? (uint64_t)st->st_size : 0;
+  if (tvh_write(settings_cache_fd, &rec, sizeof(rec)) ||
+      tvh_write(settings_cache_fd, path, rec.scr_plen) ||
+      (dlen && tvh_write(settings_cache_fd, data, dlen))) {
+    tvhwarn(LS_SETTINGS, "unable to append to settings cache, disabling");
+    settings_cache_clear();
+    return -1;
+  }
+  return 0;
+}
+
+/*
+ * Rewrite the file from the live entries, dropping superseded records
+ * and tombstones accumulated by the append-only writes
+ */
+static int
+settings_cache_compact(const char *path)
+{
+  char tmppath[PATH_MAX + 4];
+  settings_cache_entry_t *sce;
+  settings_cache_rec_t rec;
+  int fd, ok = 1;
+
+  snprintf(tmppath, sizeof(tmppath), "%s.tmp", path);
+  if ((fd = tvh_open(tmppath, O_CREAT | O_TRUNC | O_WRONLY,
+                     S_IRUSR | S_IWUSR)) < 0)
+    return -1;
+  ok = tvh_write(fd, SETTINGS_CACHE_MAGIC,
+                 strlen(SETTINGS_CACHE_MAGIC)) == 0;
+  RB_FOREACH(sce, &settings_cache, sce_link) {
+    if (!ok) break;
+    rec.scr_plen  = strlen(sce->sce_path) + 1;
+    rec.scr_dlen  = sce->sce_dlen;
+    rec.scr_mtime = sce->sce_mtime;
+    rec.scr_size  = sce->sce_size;
+    ok = tvh_write(fd, &rec, sizeof(rec)) == 0 &&
+         tvh_write(fd, sce->sce_path, rec.scr_plen) == 0 &&
+         tvh_write(fd, sce->sce_data, sce->sce_dlen) == 0;
+  }
+  close(fd);
+  if (!ok || rename(tmppath, path)) {
+    unlink(tmppath);
+    return -1;
+  }
+  return 0;
+}
+
+static void
+settings_cache_open(void)
+{
+  char path[PATH_MAX];
+  struct stat st;
+  size_t valid, magiclen = strlen(SETTINGS_CACHE_MAGIC);
+  int pass;
+
+  snprintf(path, sizeof(path), "%s/%s", settingspath, SETTINGS_CACHE_FILE);
+  for (pass = 0; pass < 3; pass++) {
+    settings_cache_fd = tvh_open(path, O_CREAT | O_RDWR | O_APPEND,
+                                 S_IRUSR | S_IWUSR);
+    if (settings_cache_fd < 0)
+      return;
+    if (fstat(settings_cache_fd, &st)) {
+      settings_cache_clear();
+      return;
+    }
+    if (st.st_size == 0) {
+      if (tvh_write(settings_cache_fd, SETTINGS_CACHE_MAGIC, magiclen))
+        settings_cache_clear();
+      return;
+    }
+    settings_cache_maplen = st.st_size;
+    settings_cache_base = mmap(NULL, settings_cache_maplen, PROT_READ,
+                               MAP_SHARED, settings_cache_fd, 0);
+    if (settings_cache_base == MAP_FAILED) {
+      settings_cache_base = NULL;
+      settings_cache_maplen = 0;
+      settings_cache_clear();
+      return;
+    }
+    if ((size_t)st.st_size < magiclen ||
+        memcmp(settings_cache_base, SETTINGS_CACHE_MAGIC, magiclen)) {
+      /* wrong or foreign format - start over */
+      tvhwarn(LS_SETTINGS, "invalid settings cache, recreating");
+      settings_cache_clear();
+      unlink(path);
+      continue;
+    }
+    valid = settings_cache_scan();
+    if (valid < settings_cache_maplen) {
+      /* cut off a tail truncated by a crash during append */
+      tvhwarn(LS_SETTINGS, "truncated record in settings cache, dropping tail");
+      if (ftruncate(settings_cache_fd, valid)) {
+        settings_cache_clear();
+        unlink(path);
+        continue;
+      }
+    }
+    if (pass == 0 && valid > 65536 &&
+        settings_cache_live + magiclen < valid / 2) {
+      /* mostly superseded records - rewrite and remap */
+      if (settings_cache_compact(path) == 0) {
+        settings_cache_clear();
+        continue;
+      }
+    }
+    tvhinfo(LS_SETTINGS, "settings cache with %zd bytes mapped",
+            settings_cache_maplen);
+    return;
+  }
+}
+
+/*
+ * Serve a load from the cache; the validators must match the JSON file
+ */
+static htsmsg_t *
+settings_cache_lookup(const char *path, const struct stat *st)
+{
+  settings_cache_entry_t skel, *sce;
+  htsmsg_t *m = NULL;
+
+  skel.sce_path = path;
+  tvh_mutex_lock(&settings_cache_mutex);
+  sce = RB_FIND(&settings_cache, &skel, sce_link, sce_cmp);
+  if (sce && sce->sce_mtime == (uint64_t)st->st_mtime &&
+      sce->sce_size == (uint64_t)st->st_size)
+    m = htsmsg_binary2_deserialize0(sce->sce_data, sce->sce_dlen, NULL);
+  tvh_mutex_unlock(&settings_cache_mutex);
+  return m;
+}
+
+/*
+ * Append a freshly written or freshly parsed record
+ */
+static void
+settings_cache_store(const char *fullpath, htsmsg_t *record)
+{
+  void *data = NULL;
+  size_t dlen, l;
+  struct stat st;
+
+  if (record == NULL || settingspath == NULL)
+    return;
+  l = strlen(settingspath);
+  if (strncmp(fullpath, settingspath, l) || fullpath[l] != '/')
+    return;
+  if (stat(fullpath, &st) || !S_ISREG(st.st_mode))
+    return;
+  if (htsmsg_binary2_serialize0(record, &data, &dlen, SETTINGS_CACHE_MAXDATA))
+    return;
+  tvh_mutex_lock(&settings_cache_mutex);
+  if (settings_cache_fd >= 0 &&
+      settings_cache_append(fullpath + l + 1, data, dlen, &st) == 0)
+    settings_cache_entry_set(fullpath + l + 1, data, dlen,
+                             st.st_mtime, st.st_size, 1);
+  tvh_mutex_unlock(&settings_cache_mutex);
+  free(data);
+}
+
+/*
+ * Forget a removed path or subtree (tombstone record)
+ */
+static void
+settings_cache_forget(const char *fullpath)
+{
+  size_t l;
+
+  if (settingspath == NULL)
+    return;
+  l = strlen(settingspath);
+  if (strncmp(fullpath, settingspath, l) || fullpath[l] != '/')
+    return;
+  tvh_mutex_lock(&settings_cache_mutex);
+  if (settings_cache_fd >= 0 &&
+      settings_cache_append(fullpath + l + 1, NULL, 0, NULL) == 0)
+    settings_cache_prune(fullpath + l + 1);
+  tvh_mutex_unlock(&settings_cache_mutex);
+}
+
+static void
+settings_dirty_free(settings_dirty_t *sd)
+{
+  htsmsg_destroy(sd->sd_record);
+  free(sd->sd_path);
+  free(sd);
+}
+
+/*
+ * Write out (or with dowrite == 0, forget) all dirty records living
+ * at or below the given path, so readers and removals observe the
+ * queued state
+ */
+static void
+hts_settings_flush_prefix(const char *path, int dowrite)
+{
+  TAILQ_HEAD(,settings_dirty) list;
+  settings_dirty_t *sd, *next;
+  size_t l = strlen(path);
+
+  TAILQ_INIT(&list);
+  tvh_mutex_lock(&settings_save_mutex);
+  /* an entry the save thread already popped is invisible to the scan
+     below - wait out its write, or a removal racing the tmp-file
+     rename would be undone by it */
+  while (settings_save_inflight[0] != '\0' &&
+         strncmp(settings_save_inflight, path, l) == 0 &&
+         (settings_save_inflight[l] == '\0' || settings_save_inflight[l] == '/'))
+    tvh_cond_wait(&settings_save_cond, &settings_save_mutex);
+  for (sd = TAILQ_FIRST(&settings_dirty_list); sd; sd = next) {
+    next = TAILQ_NEXT(sd, sd_link);
+    if (strncmp(sd->sd_path, path, l) == 0 &&
+        (sd->sd_path[l] == '\0' || sd->sd_path[l] == '/')) {
+      TAILQ_REMOVE(&settings_dirty_list, sd, sd_link);
+      TAILQ_INSERT_TAIL(&list, sd, sd_link);
+    }
+  }
+  tvh_mutex_unlock(&settings_save_mutex);
+  while ((sd = TAILQ_FIRST(&list)) != NULL) {
+    TAILQ_REMOVE(&list, sd, sd_link);
+    if (dowrite)
+      hts_settings_write(sd->sd_record, sd->sd_path, 0);
+    settings_dirty_free(sd);
+  }
+}
+
+static void *
+hts_settings_save_thread(void *aux)
+{
+  settings_dirty_t *sd;
+  int64_t mono;
+
+  tvh_mutex_lock(&settings_save_mutex);
+  while (atomic_get(&settings_save_running)) {
+    if (TAILQ_EMPTY(&settings_dirty_list)) {
+      tvh_cond_wait(&settings_save_cond, &settings_save_mutex);
+      continue;
+    }
+    /* let a burst accumulate, then write the whole batch; entries are
+       popped one by one so concurrent readers only miss the record
+       currently going to disk */
+    mono = mclk() + SETTINGS_SAVE_DELAY;
+    while (atomic_get(&settings_save_running) &&
+           tvh_cond_timedwait(&settings_save_cond, &settings_save_mutex,
+                              mono) != ETIMEDOUT);
+    while ((sd = TAILQ_FIRST(&settings_dirty_list)) != NULL) {
+      TAILQ_REMOVE(&settings_dirty_list, sd, sd_link);
+      strlcpy(settings_save_inflight, sd->sd_path,
+              sizeof(settings_save_inflight));
+      tvh_mutex_unlock(&settings_save_mutex);
+      hts_settings_write(sd->sd_record, sd->sd_path, 1);
+      settings_dirty_free(sd);
+      tvh_mutex_lock(&settings_save_mutex);
+      settings_save_inflight[0] = '\0';
+      tvh_cond_signal(&settings_save_cond, 1);
+    }
+  }
+  tvh_mutex_unlock(&settings_save_mutex);
+  return NULL;
+}
+
 /**
  *
  */
@@ -56,6 +500,14 @@ hts_settings_init(const char *confpath)
 {
   if (confpath)
     settingspath = realpath(confpath, NULL);
+  if (settingspath) {
+    RB_INIT(&settings_cache);
+    settings_cache_open();
+    tvh_cond_init(&settings_save_cond, 1);
+    atomic_set(&settings_save_running, 1);
+    tvh_thread_create(&settings_save_tid, NULL,
+                      hts_settings_save_thread, NULL, "settings");
+  }
 }
 
 /**
@@ -64,6 +516,19 @@ hts_settings_init(const char *confpath)
 void
 hts_settings_done(void)
 {
+  if (settingspath && atomic_get(&settings_save_running)) {
+    tvh_mutex_lock(&settings_save_mutex);
+    atomic_set(&settings_save_running, 0);
+    tvh_cond_signal(&settings_save_cond, 0);
+    tvh_mutex_unlock(&settings_save_mutex);
+    pthread_join(settings_save_tid, NULL);
+    /* write out whatever is still dirty */
+    hts_settings_flush_prefix(settingspath, 1);
+    tvh_cond_destroy(&settings_save_cond);
+  }
+  tvh_mutex_lock(&settings_cache_mutex);
+  settings_cache_clear();
+  tvh_mutex_unlock(&settings_cache_mutex);
   free(settingspath);
 }
 
@@ -132,12 +597,8 @@ void
 hts_settings_save(htsmsg_t *record, const char *pathfmt, ...)
 {
   char path[PATH_MAX];
-  char tmppath[PATH_MAX + 4];
-  int fd;
+  settings_dirty_t *sd;
   va_list ap;
-  htsbuf_queue_t hq;
-  htsbuf_data_t *hd;
-  int ok, r, pack;
 
   if(settingspath == NULL)
     return;
@@ -147,6 +608,41 @@ hts_settings_save(htsmsg_t *record, const char *pathfmt, ...)
   _hts_settings_buildpath(path, sizeof(path), pathfmt, ap, settingspath);
   va_end(ap);
 
+  /* Queue for the write-behind thread, replacing any not yet written
+     record for the same path */
+  if (atomic_get(&settings_save_running)) {
+    tvh_mutex_lock(&settings_save_mutex);
+    TAILQ_FOREACH(sd, &settings_dirty_list, sd_link)
+      if (strcmp(sd->sd_path, path) == 0)
+        break;
+    if (sd) {
+      htsmsg_destroy(sd->sd_record);
+    } else {
+      sd = malloc(sizeof(*sd));
+      sd->sd_path = strdup(path);
+      TAILQ_INSERT_TAIL(&settings_dirty_list, sd, sd_link);
+    }
+    sd->sd_record = htsmsg_copy(record);
+    tvh_cond_signal(&settings_save_cond, 0);
+    tvh_mutex_unlock(&settings_save_mutex);
+    return;
+  }
+
+  hts_settings_write(record, path, 0);
+}
+
+/**
+ *
+ */
+static void
+hts_settings_write(htsmsg_t *record, const char *path, int dosync)
+{
+  char tmppath[PATH_MAX + 4];
+  int fd;
+  htsbuf_queue_t hq;
+  htsbuf_data_t *hd;
+  int ok, r, pack;
+
   /* Create directories */
   if (hts_settings_makedirs(path)) return;
 
@@ -196,6 +692,8 @@ hts_settings_save(htsmsg_t *record, const char *pathfmt, ...)
     free(msgdata);
 #endif
   }
+  if (ok && dosync)
+    fsync(fd); /* batched writes are synced off the caller's thread */
   close(fd);
 
   /* Move */
@@ -208,7 +706,9 @@ hts_settings_save(htsmsg_t *record, const char *pathfmt, ...)
     if (r)
       tvhalert(LS_SETTINGS, "Unable to rename file \"%s\" to \"%s\" - %s",
 	       tmppath, path, strerror(errno));
-  
+    else
+      settings_cache_store(path, record);
+
   /* Delete tmp */
   } else
     unlink(tmppath);
@@ -224,6 +724,19 @@ hts_settings_load_one(const char *filename)
   char *mem;
   fb_file *fp;
   htsmsg_t *r = NULL;
+  struct stat st;
+  size_t l;
+  int cacheable = 0;
+
+  /* Try the consolidated binary cache first */
+  if (settingspath != NULL &&
+      strncmp(filename, settingspath, l = strlen(settingspath)) == 0 &&
+      filename[l] == '/' &&
+      stat(filename, &st) == 0 && S_ISREG(st.st_mode)) {
+    if ((r = settings_cache_lookup(filename + l + 1, &st)) != NULL)
+      return r;
+    cacheable = 1;
+  }
 
   /* Open */
   if (!(fp = fb_open(filename, 1, 0))) return NULL;
@@ -264,20 +777,71 @@ hts_settings_load_one(const char *filename)
   fb_close(fp);
   free(mem);
 
+  /* warm the cache for the next startup */
+  if (cacheable)
+    settings_cache_store(filename, r);
+
   return r;
 }
 
+static htsmsg_t *hts_settings_load_path(const char *fullpath, int depth,
+                                        int parallel);
+
+/*
+ * Directory entries are independent records, so a large directory is
+ * split stride-wise over a small worker pool; the results are merged
+ * in directory order afterwards.  Only the outermost call fans out -
+ * workers recurse serially, which bounds the pool size.
+ */
+#define SETTINGS_LOAD_THREADS      4
+#define SETTINGS_LOAD_PARALLEL_MIN 64
+
+typedef struct settings_load_work {
+  pthread_t slw_tid;
+  const char *slw_fullpath;
+  fb_dirent **slw_namelist;
+  htsmsg_t **slw_results;
+  int slw_n;
+  int slw_first;
+  int slw_depth;
+  int slw_spawned;
+} settings_load_work_t;
+
+static void *
+hts_settings_load_worker(void *aux)
+{
+  settings_load_work_t *w = aux;
+  char child[PATH_MAX];
+  const char *name;
+  fb_dirent *d;
+  int i;
+
+  for (i = w->slw_first; i < w->slw_n; i += SETTINGS_LOAD_THREADS) {
+    d = w->slw_namelist[i];
+    name = d->name;
+    if (name[0] == '.' || !name[0] || name[strlen(name)-1] == '~')
+      continue;
+    snprintf(child, sizeof(child), "%s/%s", w->slw_fullpath, name);
+    if (d->type == FB_DIR && w->slw_depth > 0)
+      w->slw_results[i] = hts_settings_load_path(child, w->slw_depth - 1, 0);
+    else
+      w->slw_results[i] = hts_settings_load_one(child);
+  }
+  return NULL;
+}
+
 /**
  *
  */
 static htsmsg_t *
-hts_settings_load_path(const char *fullpath, int depth)
+hts_settings_load_path(const char *fullpath, int depth, int parallel)
 {
   char child[PATH_MAX];
   const char *name;
   struct filebundle_stat st;
   fb_dirent **namelist, *d;
-  htsmsg_t *r, *c;
+  settings_load_work_t work[SETTINGS_LOAD_THREADS];
+  htsmsg_t *r, *c, **results;
   int n, i;
 
   /* Invalid */
@@ -292,22 +856,50 @@ hts_settings_load_path(const char *fullpath, int depth)
 
     /* Read files */
     r = htsmsg_create_map();
-    for(i = 0; i < n; i++) {
-      d = namelist[i];
-      name = d->name;
-      if(name[0] != '.' && name[0] && name[strlen(name)-1] != '~') {
-
-        snprintf(child, sizeof(child), "%s/%s", fullpath, d->name);
-        if(d->type == FB_DIR && depth > 0) {
-          c = hts_settings_load_path(child, depth - 1);
-        } else {
-          c = hts_settings_load_one(child);
-        }
-        if(c != NULL)
-          htsmsg_add_msg(r, d->name, c);
+    if (parallel && n >= SETTINGS_LOAD_PARALLEL_MIN) {
+      results = calloc(n, sizeof(htsmsg_t *));
+      for (i = 0; i < SETTINGS_LOAD_THREADS; i++) {
+        work[i].slw_fullpath = fullpath;
+        work[i].slw_namelist = namelist;
+        work[i].slw_results  = results;
+        work[i].slw_n        = n;
+        work[i].slw_first    = i;
+        work[i].slw_depth    = depth;
+        work[i].slw_spawned  = i > 0 &&
+          tvh_thread_create(&work[i].slw_tid, NULL,
+                            hts_settings_load_worker, &work[i],
+                            "cfg-load") == 0;
+      }
+      hts_settings_load_worker(&work[0]);
+      for (i = 1; i < SETTINGS_LOAD_THREADS; i++)
+        if (work[i].slw_spawned)
+          pthread_join(work[i].slw_tid, NULL);
+        else
+          hts_settings_load_worker(&work[i]);
+      for (i = 0; i < n; i++) {
+        if (results[i] != NULL)
+          htsmsg_add_msg(r, namelist[i]->name, results[i]);
+        free(namelist[i]);
+      }
+      free(results);
+    } else {
+      for(i = 0; i < n; i++) {
+        d = namelist[i];
+        name = d->name;
+        if(name[0] != '.' && name[0] && name[strlen(name)-1] != '~') {
 
+          snprintf(child, sizeof(child), "%s/%s", fullpath, d->name);
+          if(d->type == FB_DIR && depth > 0) {
+            c = hts_settings_load_path(child, depth - 1, 0);
+          } else {
+            c = hts_settings_load_one(child);
+          }
+          if(c != NULL)
+            htsmsg_add_msg(r, d->name, c);
+
+        }
+        free(d);
       }
-      free(d);
     }
     free(namelist);
 
@@ -331,15 +923,18 @@ hts_settings_vload(const char *pathfmt, va_list ap, int depth)
   va_copy(ap2, ap);
 
   /* Try normal path */
-  _hts_settings_buildpath(fullpath, sizeof(fullpath), 
+  _hts_settings_buildpath(fullpath, sizeof(fullpath),
                           pathfmt, ap, settingspath);
-  ret = hts_settings_load_path(fullpath, depth);
+  /* make queued writes visible to the reader */
+  if (atomic_get(&settings_save_running))
+    hts_settings_flush_prefix(fullpath, 1);
+  ret = hts_settings_load_path(fullpath, depth, 1);
 
   /* Try bundle path */
   if (!ret && *pathfmt != '/') {
     _hts_settings_buildpath(fullpath, sizeof(fullpath),
                             pathfmt, ap2, "data/conf");
-    ret = hts_settings_load_path(fullpath, depth);
+    ret = hts_settings_load_path(fullpath, depth, 1);
   }
 
   va_end(ap2);
@@ -389,6 +984,10 @@ hts_settings_remove(const char *pathfmt, ...)
   _hts_settings_buildpath(fullpath, sizeof(fullpath),
                           pathfmt, ap, settingspath);
   va_end(ap);
+  /* forget queued writes for the removed subtree */
+  if (atomic_get(&settings_save_running))
+    hts_settings_flush_prefix(fullpath, 0);
+  settings_cache_forget(fullpath);
   if (stat(fullpath, &st) == 0) {
     if (S_ISDIR(st.st_mode))
       rmtree(fullpath);
@@ -442,6 +1041,9 @@ hts_settings_exists ( const char *pathfmt, ... )
   _hts_settings_buildpath(path, sizeof(path), pathfmt, ap, settingspath);
   va_end(ap);
 
+  if (atomic_get(&settings_save_running))
+    hts_settings_flush_prefix(path, 1);
+
   return (stat(path, &st) == 0);
 }
 
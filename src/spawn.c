@@ -29,6 +29,7 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <signal.h>
+#include <sys/syscall.h>
 
 #include "tvheadend.h"
 #include "tvhpoll.h"
@@ -65,9 +66,11 @@ typedef struct spawn {
 static void spawn_reaper(void);
 
 /*
- *
+ * Drain buffer for the info/error pipes.  Kept large so that a chatty
+ * grabber or postprocessor is emptied in one read() per poll wakeup
+ * instead of dribbling through many small reads.
  */
-#define SPAWN_PIPE_READ_SIZE 4096
+#define SPAWN_PIPE_READ_SIZE 65536
 
 static void
 spawn_pipe_read( th_pipe_t *p, char **_buf, int level )
@@ -451,6 +454,55 @@ spawn_free_args(char **argv)
   free(argv);
 }
 
+/**
+ * Close all descriptors from lowfd up, preferring the close_range()
+ * syscall over the classic (and potentially very long) close() loop.
+ * Raw syscalls only - this runs in a vfork()ed child.
+ */
+static void
+spawn_close_from(int lowfd, int maxfd)
+{
+  int f;
+
+#ifdef SYS_close_range
+  if (syscall(SYS_close_range, (unsigned int)lowfd, ~0U, 0U) == 0)
+    return;
+#endif
+  for (f = lowfd; f < maxfd; f++)
+    close(f);
+}
+
+/**
+ * Start a child process with vfork() semantics.  The child borrows the
+ * parent's address space until execve(), so no page tables are copied -
+ * with a large daemon RSS a plain fork() stalls the calling thread for
+ * tens of milliseconds even with COW.  All preparation happens in the
+ * caller; the child performs async-signal-safe syscalls only, since the
+ * other threads keep running and share the heap.  On exec failure the
+ * pre-formatted errmsg is written to the (already redirected) fd 2.
+ */
+static pid_t
+spawn_exec(const char *prog, char *argv[], char *envp[],
+           int fd0, int fd1, int fd2, int maxfd,
+           const char *errmsg, size_t errlen)
+{
+  pid_t p;
+
+  p = vfork();
+  if (p != 0)
+    return p;
+
+  dup2(fd0, 0);
+  dup2(fd1, 1);
+  dup2(fd2, 2);
+
+  spawn_close_from(3, maxfd);
+
+  execve(prog, argv, envp);
+  if (write(2, errmsg, errlen) < 0) { /* stderr not redirected */ };
+  _exit(127);
+}
+
 /**
  * Execute the given program and return its standard output as file-descriptor (pipe).
  */
@@ -459,8 +511,8 @@ spawn_and_give_stdout(const char *prog, char *argv[], char *envp[],
                       int *rd, pid_t *pid, int redir_stderr)
 {
   pid_t p;
-  int fd[2], f, i;
-  char bin[256];
+  int fd[2], f, i, nullfd, maxfd, errlen;
+  char bin[256], errmsg[512];
   const char *local_argv[2] = { NULL, NULL };
   char **e, **e0, **e2, **e3, *p1, *p2;
 
@@ -507,17 +559,31 @@ spawn_and_give_stdout(const char *prog, char *argv[], char *envp[],
     *e0 = NULL;
   }
 
+  nullfd = open("/dev/null", O_RDWR);
+  if(nullfd == -1) {
+    tvherror(LS_SPAWN, "Unable to open /dev/null for redirect \"%s\" -- %s",
+             prog, strerror(errno));
+    return -1;
+  }
+
+  maxfd = sysconf(_SC_OPEN_MAX);
+  errlen = snprintf(errmsg, sizeof(errmsg), "cannot execute \"%s\"\n", prog);
+
   tvh_mutex_lock(&fork_lock);
 
   if(pipe(fd) == -1) {
     tvh_mutex_unlock(&fork_lock);
+    close(nullfd);
     return -1;
   }
 
-  p = fork();
+  p = spawn_exec(prog, argv, e, nullfd, fd[1],
+                 redir_stderr ? spawn_pipe_error.wr : nullfd,
+                 maxfd, errmsg, errlen);
 
   if(p == -1) {
     tvh_mutex_unlock(&fork_lock);
+    close(nullfd);
     close(fd[0]);
     close(fd[1]);
     tvherror(LS_SPAWN, "Unable to fork() for \"%s\" -- %s",
@@ -525,61 +591,13 @@ spawn_and_give_stdout(const char *prog, char *argv[], char *envp[],
     return -1;
   }
 
-  if(p == 0) {
-    struct dirent *selfd_ent;
-    DIR *selfd;
-
-    f = open("/dev/null", O_RDWR);
-    if(f == -1) {
-      spawn_error("pid %d cannot open /dev/null for redirect %s -- %s",
-                  getpid(), prog, strerror(errno));
-      exit(1);
-    }
-
-    close(0);
-    close(1);
-    close(2);
-
-    dup2(f, 0);
-    dup2(fd[1], 1);
-    dup2(redir_stderr ? spawn_pipe_error.wr : f, 2);
-
-    close(fd[0]);
-    close(fd[1]);
-    close(f);
-
-    spawn_info("Executing \"%s\"\n", prog);
-
-    if ((selfd = opendir("/dev/fd")) != NULL) {
-      while ((selfd_ent = readdir(selfd)) != NULL) {
-        int open_fd = atoi(selfd_ent->d_name);
-
-        if (open_fd >= 3) {
-          if (close(open_fd) == -1)
-            spawn_error("failed to close fd '%d': %s", open_fd, strerror(errno));
-        }
-      }
-      closedir(selfd);
-    } else {
-      int maxfd = sysconf(_SC_OPEN_MAX);;
-
-      spawn_error("unable to open '/dev/fd', falling back to closing all %d"
-                  "This may take a long time!", maxfd);
-
-      for (f = 3; f < maxfd; f++)
-        close(f);
-    }
-
-    execve(prog, argv, e);
-    spawn_error("pid %d cannot execute %s -- %s\n",
-                getpid(), prog, strerror(errno));
-    exit(1);
-  }
-
   tvh_mutex_unlock(&fork_lock);
 
+  spawn_info("Executing \"%s\"\n", prog);
+
   spawn_enq(prog, p);
 
+  close(nullfd);
   close(fd[1]);
 
   *rd = fd[0];
@@ -603,8 +621,8 @@ spawn_with_passthrough(const char *prog, char *argv[], char *envp[],
                        int od, int *wd, pid_t *pid, int redir_stderr)
 {
   pid_t p;
-  int fd[2], f, i, maxfd;
-  char bin[256];
+  int fd[2], f, i, nullfd, maxfd, errlen;
+  char bin[256], errmsg[512];
   const char *local_argv[2] = { NULL, NULL };
   char **e, **e0, **e2, **e3, *p1, *p2;
 
@@ -651,22 +669,42 @@ spawn_with_passthrough(const char *prog, char *argv[], char *envp[],
     *e0 = NULL;
   }
 
+  nullfd = -1;
+  if (!redir_stderr) {
+    nullfd = open("/dev/null", O_RDWR);
+    if(nullfd == -1) {
+      tvherror(LS_SPAWN, "Unable to open /dev/null for redirect \"%s\" -- %s",
+               prog, strerror(errno));
+      // do not pass the local variable outside
+      if (argv[0] == bin)
+        argv[0] = NULL;
+      return -1;
+    }
+  }
+
   maxfd = sysconf(_SC_OPEN_MAX);
+  errlen = snprintf(errmsg, sizeof(errmsg), "cannot execute \"%s\"\n", prog);
 
   tvh_mutex_lock(&fork_lock);
 
   if(pipe(fd) == -1) {
     tvh_mutex_unlock(&fork_lock);
+    if (nullfd >= 0)
+      close(nullfd);
     // do not pass the local variable outside
     if (argv[0] == bin)
       argv[0] = NULL;
     return -1;
   }
 
-  p = fork();
+  p = spawn_exec(prog, argv, e, fd[0], od,
+                 redir_stderr ? spawn_pipe_error.wr : nullfd,
+                 maxfd, errmsg, errlen);
 
   if(p == -1) {
     tvh_mutex_unlock(&fork_lock);
+    if (nullfd >= 0)
+      close(nullfd);
     close(fd[0]);
     close(fd[1]);
     tvherror(LS_SPAWN, "Unable to fork() for \"%s\" -- %s",
@@ -677,45 +715,14 @@ spawn_with_passthrough(const char *prog, char *argv[], char *envp[],
     return -1;
   }
 
-  if(p == 0) {
-    if (redir_stderr) {
-      f = spawn_pipe_error.wr;
-    } else {
-      f = open("/dev/null", O_RDWR);
-      if(f == -1) {
-        spawn_error("pid %d cannot open /dev/null for redirect %s -- %s",
-                    getpid(), prog, strerror(errno));
-        exit(1);
-      }
-    }
-
-    close(0);
-    close(1);
-    close(2);
-
-    dup2(fd[0], 0);
-    dup2(od, 1);
-    dup2(f, 2);
-
-    close(fd[0]);
-    close(fd[1]);
-    close(f);
-
-    spawn_info("Executing \"%s\"\n", prog);
-
-    for (f = 3; f < maxfd; f++)
-      close(f);
-
-    execve(prog, argv, e);
-    spawn_error("pid %d cannot execute %s -- %s\n",
-                getpid(), prog, strerror(errno));
-    exit(1);
-  }
-
   tvh_mutex_unlock(&fork_lock);
 
+  spawn_info("Executing \"%s\"\n", prog);
+
   spawn_enq(prog, p);
 
+  if (nullfd >= 0)
+    close(nullfd);
   close(fd[0]);
 
   *wd = fd[1];
@@ -741,8 +748,9 @@ spawn_with_passthrough(const char *prog, char *argv[], char *envp[],
 int
 spawnv(const char *prog, char *argv[], pid_t *pid, int redir_stdout, int redir_stderr)
 {
-  pid_t p, f, maxfd;
-  char bin[256];
+  pid_t p;
+  int nullfd, maxfd, errlen;
+  char bin[256], errmsg[512];
   const char *local_argv[2] = { NULL, NULL };
 
   if (*prog != '/' && *prog != '.') {
@@ -753,14 +761,29 @@ spawnv(const char *prog, char *argv[], pid_t *pid, int redir_stdout, int redir_s
   if(!argv) argv = (void *)local_argv;
   if (!argv[0]) argv[0] = (char*)prog;
 
+  nullfd = open("/dev/null", O_RDWR);
+  if(nullfd == -1) {
+    tvherror(LS_SPAWN, "Unable to open /dev/null for redirect \"%s\" -- %s",
+             prog, strerror(errno));
+    // do not pass the local variable outside
+    if (argv[0] == bin)
+      argv[0] = NULL;
+    return -1;
+  }
+
   maxfd = sysconf(_SC_OPEN_MAX);
+  errlen = snprintf(errmsg, sizeof(errmsg), "cannot execute \"%s\"\n", prog);
 
   tvh_mutex_lock(&fork_lock);
 
-  p = fork();
+  p = spawn_exec(prog, argv, environ, nullfd,
+                 redir_stdout ? spawn_pipe_info.wr : nullfd,
+                 redir_stderr ? spawn_pipe_error.wr : nullfd,
+                 maxfd, errmsg, errlen);
 
   if(p == -1) {
     tvh_mutex_unlock(&fork_lock);
+    close(nullfd);
     tvherror(LS_SPAWN, "Unable to fork() for \"%s\" -- %s",
 	     prog, strerror(errno));
     // do not pass the local variable outside
@@ -769,37 +792,11 @@ spawnv(const char *prog, char *argv[], pid_t *pid, int redir_stdout, int redir_s
     return -1;
   }
 
-  if(p == 0) {
-    f = open("/dev/null", O_RDWR);
-    if(f == -1) {
-      spawn_error("pid %d cannot open /dev/null for redirect %s -- %s",
-                  getpid(), prog, strerror(errno));
-      exit(1);
-    }
-
-    close(0);
-    close(1);
-    close(2);
-
-    dup2(f, 0);
-    dup2(redir_stdout ? spawn_pipe_info.wr : f, 1);
-    dup2(redir_stderr ? spawn_pipe_error.wr : f, 2);
-
-    close(f);
-
-    spawn_info("Executing \"%s\"\n", prog);
+  tvh_mutex_unlock(&fork_lock);
 
-    for (f = 3; f < maxfd; f++)
-      close(f);
+  close(nullfd);
 
-    execve(prog, argv, environ);
-    spawn_error("pid %d cannot execute %s -- %s\n",
-	        getpid(), prog, strerror(errno));
-    close(1);
-    exit(1);
-  }
-
-  tvh_mutex_unlock(&fork_lock);
+  spawn_info("Executing \"%s\"\n", prog);
 
   spawn_enq(prog, p);
 
@@ -825,6 +822,11 @@ void spawn_init(void)
 {
   tvh_pipe(O_NONBLOCK, &spawn_pipe_info);
   tvh_pipe(O_NONBLOCK, &spawn_pipe_error);
+#ifdef F_SETPIPE_SZ
+  /* match the kernel buffers to the drain buffer, best effort */
+  fcntl(spawn_pipe_info.wr, F_SETPIPE_SZ, SPAWN_PIPE_READ_SIZE);
+  fcntl(spawn_pipe_error.wr, F_SETPIPE_SZ, SPAWN_PIPE_READ_SIZE);
+#endif
   atomic_set(&spawn_pipe_running, 1);
   pthread_create(&spawn_pipe_tid, NULL, spawn_pipe_thread, NULL);
 }
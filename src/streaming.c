@@ -18,6 +18,7 @@
 
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
 
 #include "tvheadend.h"
 #include "streaming.h"
@@ -66,6 +67,46 @@ streaming_message_data_size(streaming_message_t *sm)
   return 0;
 }
 
+/**
+ * Queue size protection - when the consumer falls behind, shed the
+ * disposable video frames first (B, then P) at rising watermarks,
+ * keep audio until well past the hard limit and never drop control
+ * messages, so a slow client degrades instead of losing the stream.
+ * Returns the drop histogram slot or -1 to keep the message.
+ */
+static int
+streaming_queue_overflow(streaming_queue_t *sq, streaming_message_t *sm)
+{
+  size_t size = sq->sq_size, max = sq->sq_maxsize;
+  th_pkt_t *pkt;
+
+  if (max == 0)
+    return -1;
+
+  switch (sm->sm_type) {
+  case SMT_PACKET:
+    pkt = sm->sm_data;
+    if (pkt && SCT_ISVIDEO(pkt->pkt_type)) {
+      if (size > max / 2 && pkt->v.pkt_frametype == PKT_B_FRAME)
+        return PKT_B_FRAME;
+      if (size > max - max / 4 && pkt->v.pkt_frametype == PKT_P_FRAME)
+        return PKT_P_FRAME;
+      if (size > max)
+        return pkt->v.pkt_frametype;
+      return -1;
+    }
+    if (pkt && SCT_ISAUDIO(pkt->pkt_type))
+      return size > max + max / 4 ? 0 : -1;
+    return size > max ? 0 : -1;
+
+  case SMT_MPEGTS:
+    return size > max ? 0 : -1;
+
+  default:
+    return -1;
+  }
+}
+
 /**
  *
  */
@@ -73,15 +114,21 @@ static void
 streaming_queue_deliver(void *opauqe, streaming_message_t *sm)
 {
   streaming_queue_t *sq = opauqe;
+  int slot;
+
+  sm = streaming_msg_unshare(sm);
 
   tvh_mutex_lock(&sq->sq_mutex);
 
-  /* queue size protection */
-  if (sq->sq_maxsize && sq->sq_maxsize < sq->sq_size) {
+  slot = streaming_queue_overflow(sq, sm);
+  if (slot >= 0) {
+    sq->sq_drops[slot]++;
     streaming_msg_free(sm);
   } else {
     TAILQ_INSERT_TAIL(&sq->sq_queue, sm, sm_link);
     sq->sq_size += streaming_message_data_size(sm);
+    if (sq->sq_size > sq->sq_size_highwater)
+      sq->sq_size_highwater = sq->sq_size;
   }
 
   tvh_cond_signal(&sq->sq_cond, 0);
@@ -134,6 +181,8 @@ streaming_queue_init(streaming_queue_t *sq, int reject_filter, size_t maxsize)
 
   sq->sq_maxsize = maxsize;
   sq->sq_size = 0;
+  sq->sq_size_highwater = 0;
+  memset(sq->sq_drops, 0, sizeof(sq->sq_drops));
 }
 
 /**
@@ -162,6 +211,138 @@ streaming_queue_clear(struct streaming_message_queue *q)
   }
 }
 
+/**
+ * Lock-free MPSC queue (Vyukov intrusive queue) - producers only need
+ * an atomic exchange, the consumer owns the head. The sm_link next
+ * pointer is reused for the chaining while the message is off any TAILQ.
+ */
+static inline streaming_message_t *
+streaming_lfqueue_next(streaming_message_t *sm)
+{
+  return *(streaming_message_t *volatile *)&sm->sm_link.tqe_next;
+}
+
+static void
+streaming_lfqueue_push(streaming_lfqueue_t *lfq, streaming_message_t *sm)
+{
+  streaming_message_t *prev;
+
+  sm->sm_link.tqe_next = NULL;
+  prev = atomic_exchange_ptr((atomic_refptr_t)&lfq->lfq_tail, sm);
+  atomic_set_ptr((atomic_refptr_t)&prev->sm_link.tqe_next, sm);
+}
+
+static streaming_message_t *
+streaming_lfqueue_pop(streaming_lfqueue_t *lfq)
+{
+  streaming_message_t *head = lfq->lfq_head, *next;
+
+  next = streaming_lfqueue_next(head);
+  if (head == &lfq->lfq_stub) {
+    if (next == NULL)
+      return NULL;
+    lfq->lfq_head = head = next;
+    next = streaming_lfqueue_next(head);
+  }
+  if (next) {
+    lfq->lfq_head = next;
+    return head;
+  }
+  if (head != lfq->lfq_tail)
+    return NULL;                /* producer mid-push, retry later */
+  streaming_lfqueue_push(lfq, &lfq->lfq_stub);
+  next = streaming_lfqueue_next(head);
+  if (next) {
+    lfq->lfq_head = next;
+    return head;
+  }
+  return NULL;
+}
+
+static void
+streaming_lfqueue_deliver(void *opaque, streaming_message_t *sm)
+{
+  streaming_lfqueue_t *lfq = opaque;
+
+  sm = streaming_msg_unshare(sm);
+
+  /* queue size protection */
+  if (lfq->lfq_maxsize &&
+      (size_t)atomic_get_s64(&lfq->lfq_size) > lfq->lfq_maxsize) {
+    streaming_msg_free(sm);
+  } else {
+    atomic_add_s64(&lfq->lfq_size, streaming_message_data_size(sm));
+    streaming_lfqueue_push(lfq, sm);
+  }
+
+  if (atomic_exchange(&lfq->lfq_armed, 1) == 0)
+    tvh_write(lfq->lfq_pipe.wr, "", 1);
+}
+
+static htsmsg_t *
+streaming_lfqueue_info(void *opaque, htsmsg_t *list)
+{
+  streaming_lfqueue_t *lfq = opaque;
+  char buf[256];
+  snprintf(buf, sizeof(buf), "lock-free streaming queue %p size %zd",
+           lfq, (size_t)atomic_get_s64(&lfq->lfq_size));
+  htsmsg_add_str(list, NULL, buf);
+  return list;
+}
+
+int
+streaming_lfqueue_drain(streaming_lfqueue_t *lfq, struct streaming_message_queue *q)
+{
+  streaming_message_t *sm;
+  char buf[16];
+  int count = 0;
+
+  /* re-arm the wakeup before draining so a racing producer is not lost */
+  atomic_set(&lfq->lfq_armed, 0);
+  while (read(lfq->lfq_pipe.rd, buf, sizeof(buf)) > 0);
+  while ((sm = streaming_lfqueue_pop(lfq)) != NULL) {
+    atomic_dec_s64(&lfq->lfq_size, streaming_message_data_size(sm));
+    TAILQ_INSERT_TAIL(q, sm, sm_link);
+    count++;
+  }
+  return count;
+}
+
+int
+streaming_lfqueue_init(streaming_lfqueue_t *lfq, int reject_filter, size_t maxsize)
+{
+  static streaming_ops_t ops = {
+    .st_cb   = streaming_lfqueue_deliver,
+    .st_info = streaming_lfqueue_info
+  };
+
+  if (tvh_pipe(O_NONBLOCK, &lfq->lfq_pipe))
+    return -1;
+
+  streaming_target_init(&lfq->lfq_st, &ops, lfq, reject_filter);
+
+  memset(&lfq->lfq_stub, 0, sizeof(lfq->lfq_stub));
+  lfq->lfq_head = &lfq->lfq_stub;
+  lfq->lfq_tail = &lfq->lfq_stub;
+  lfq->lfq_armed = 0;
+
+  lfq->lfq_maxsize = maxsize;
+  lfq->lfq_size = 0;
+  return 0;
+}
+
+void
+streaming_lfqueue_deinit(streaming_lfqueue_t *lfq)
+{
+  struct streaming_message_queue q;
+
+  TAILQ_INIT(&q);
+  streaming_lfqueue_drain(lfq, &q);
+  streaming_queue_clear(&q);
+  lfq->lfq_size = 0;
+  tvh_pipe_close(&lfq->lfq_pipe);
+}
+
 /**
  *
  */
@@ -204,6 +385,7 @@ streaming_msg_create(streaming_message_type_t type)
   streaming_message_t *sm = malloc(sizeof(streaming_message_t));
   memoryinfo_alloc(&streaming_msg_memoryinfo, sizeof(*sm));
   sm->sm_type = type;
+  sm->sm_refcount = 1;
 #if ENABLE_TIMESHIFT
   sm->sm_time = 0;
   sm->sm_s = NULL;
@@ -262,6 +444,7 @@ streaming_msg_clone(streaming_message_t *src)
   memoryinfo_alloc(&streaming_msg_memoryinfo, sizeof(*dst));
 
   dst->sm_type      = src->sm_type;
+  dst->sm_refcount  = 1;
 #if ENABLE_TIMESHIFT
   dst->sm_time      = src->sm_time;
   dst->sm_s         = src->sm_s;
@@ -350,6 +533,9 @@ streaming_msg_free(streaming_message_t *sm)
   if (!sm)
     return;
 
+  if (atomic_add(&sm->sm_refcount, -1) != 1)
+    return;
+
   switch(sm->sm_type) {
   case SMT_PACKET:
     if(sm->sm_data)
@@ -391,6 +577,22 @@ streaming_msg_free(streaming_message_t *sm)
   free(sm);
 }
 
+/**
+ * Return an exclusively owned message - makes a private copy when
+ * the reference is shared with other streaming targets
+ */
+streaming_message_t *
+streaming_msg_unshare(streaming_message_t *sm)
+{
+  streaming_message_t *dst;
+
+  if (atomic_get(&sm->sm_refcount) < 2)
+    return sm;
+  dst = streaming_msg_clone(sm);
+  streaming_msg_free(sm);
+  return dst;
+}
+
 /**
  *
  */
@@ -417,7 +619,7 @@ streaming_pad_deliver(streaming_pad_t *sp, streaming_message_t *sm)
     if (st->st_reject_filter & SMT_TO_MASK(sm->sm_type))
       continue;
     if (run)
-      streaming_target_deliver(run, streaming_msg_clone(sm));
+      streaming_target_deliver(run, streaming_msg_ref(sm));
     run = st;
   }
   if (run)
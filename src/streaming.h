@@ -42,6 +42,7 @@ typedef enum signal_state signal_state_t;
 typedef struct streaming_message streaming_message_t;
 typedef struct streaming_ops streaming_ops_t;
 typedef struct streaming_queue streaming_queue_t;
+typedef struct streaming_lfqueue streaming_lfqueue_t;
 typedef struct source_info source_info_t;
 typedef struct streaming_start_component streaming_start_component_t;
 typedef struct streaming_start streaming_start_t;
@@ -320,6 +321,7 @@ const char * signal2str ( signal_state_t st );
 struct streaming_message {
   TAILQ_ENTRY(streaming_message) sm_link;
   streaming_message_type_t sm_type;
+  int sm_refcount;
   service_t *sm_s;
 #if ENABLE_TIMESHIFT
   int64_t sm_time;
@@ -360,11 +362,38 @@ struct streaming_queue {
 
   size_t      sq_maxsize;  /* Max queue size (bytes) */
   size_t      sq_size;     /* Actual queue size (bytes) - only data */
+  size_t      sq_size_highwater; /* Largest observed queue size (bytes) */
+
+  uint32_t    sq_drops[PKT_NTYPES]; /* Dropped packets by frame type
+                                       (slot 0 counts non-video drops) */
 
   struct streaming_message_queue sq_queue;
 
 };
 
+/**
+ * Lock-free MPSC variant of the streaming queue - producers link
+ * messages with an atomic exchange instead of taking a consumer-held
+ * mutex, so a service fanning out to many subscribers never blocks
+ * on a slow reader. The consumer polls the pipe and drains the queue
+ * in batches with streaming_lfqueue_drain().
+ */
+struct streaming_lfqueue {
+
+  streaming_target_t lfq_st;
+
+  streaming_message_t *volatile lfq_tail; /* producers - atomic exchange */
+  streaming_message_t *lfq_head;          /* consumer thread only */
+  streaming_message_t lfq_stub;
+
+  th_pipe_t   lfq_pipe;     /* wakeup - consumer polls the rd end */
+  volatile int lfq_armed;   /* wakeup pending, coalesces pipe writes */
+
+  size_t      lfq_maxsize;  /* Max queue size (bytes) */
+  int64_t     lfq_size;     /* Actual queue size (bytes) - only data */
+
+};
+
 streaming_component_type_t streaming_component_txt2type(const char *str);
 const char *streaming_component_type2txt(streaming_component_type_t s);
 streaming_component_type_t streaming_component_txt2type(const char *s);
@@ -435,6 +464,17 @@ void streaming_queue_deinit(streaming_queue_t *sq);
 
 void streaming_queue_remove(streaming_queue_t *sq, streaming_message_t *sm);
 
+int streaming_lfqueue_init
+  (streaming_lfqueue_t *lfq, int reject_filter, size_t maxsize);
+
+void streaming_lfqueue_deinit(streaming_lfqueue_t *lfq);
+
+int streaming_lfqueue_drain
+  (streaming_lfqueue_t *lfq, struct streaming_message_queue *q);
+
+static inline int streaming_lfqueue_fd(streaming_lfqueue_t *lfq)
+  { return lfq->lfq_pipe.rd; }
+
 void streaming_target_connect(streaming_pad_t *sp, streaming_target_t *st);
 
 void streaming_target_disconnect(streaming_pad_t *sp, streaming_target_t *st);
@@ -447,6 +487,16 @@ void streaming_msg_free(streaming_message_t *sm);
 
 streaming_message_t *streaming_msg_clone(streaming_message_t *src);
 
+streaming_message_t *streaming_msg_unshare(streaming_message_t *sm);
+
+/* the returned reference is read-only - call streaming_msg_unshare()
+ * before linking or modifying the message */
+static inline streaming_message_t *streaming_msg_ref(streaming_message_t *sm)
+{
+  atomic_add(&sm->sm_refcount, 1);
+  return sm;
+}
+
 streaming_message_t *streaming_msg_create(streaming_message_type_t type);
 
 streaming_message_t *streaming_msg_create_data(streaming_message_type_t type, 
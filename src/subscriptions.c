@@ -29,6 +29,8 @@
 #include "input.h"
 #include "intlconv.h"
 #include "dbus.h"
+#include "epggrab.h"
+#include "dvr/dvr.h"
 
 struct th_subscription_list subscriptions;
 struct th_subscription_list subscriptions_remove;
@@ -78,6 +80,13 @@ subscription_link_service(th_subscription_t *s, service_t *t)
   subsetstate(s, SUBSCRIPTION_TESTING_SERVICE);
   s->ths_service = t;
 
+  /* The service may run with the reduced audio-only pid set - reopen
+     everything before a full subscriber attaches */
+  if (t->s_audio_only && (s->ths_flags & SUBSCRIPTION_AUDIOONLY) == 0) {
+    t->s_audio_only = 0;
+    service_restart(t);
+  }
+
   if ((s->ths_flags & SUBSCRIPTION_TYPE_MASK) == SUBSCRIPTION_PACKET) {
     assert(s->ths_parser == NULL);
     s->ths_output = s->ths_parser = parser_create(s->ths_output, s);
@@ -308,6 +317,41 @@ subscription_ca_check_cb(void *aux)
   tvh_mutex_unlock(&t->s_stream_mutex);
 }
 
+/**
+ * Fast fallback while testing a service instance - when the current
+ * candidate has not produced packets within a probe window and another
+ * error-free instance is available, give up on the candidate early
+ * instead of sitting through the full grace period.  The window is
+ * half the grace period the input advertised for the instance, so
+ * slow-tuning sources (DiSEqC, rotors) are not probed before they had
+ * a realistic chance to lock.  The last remaining candidate always
+ * keeps the full timeout.
+ */
+#define SUBSCRIPTION_PROBE_MIN 5 /* seconds */
+
+static void
+subscription_probe_cb(void *aux)
+{
+  th_subscription_t *s = aux;
+  service_instance_t *si = s->ths_current_instance, *si2;
+
+  if (si == NULL || subgetstate(s) != SUBSCRIPTION_TESTING_SERVICE)
+    return;
+
+  TAILQ_FOREACH(si2, &s->ths_instances, si_link)
+    if (si2 != si && si2->si_error == 0)
+      break;
+  if (si2 == NULL)
+    return;
+
+  tvhwarn(LS_SUBSCRIPTION, "%04X: no data from \"%s\", trying next instance",
+          shortid(s), si->si_source);
+  if (SM_CODE_DATA_TIMEOUT > s->ths_testing_error)
+    s->ths_testing_error = SM_CODE_DATA_TIMEOUT;
+  subsetstate(s, SUBSCRIPTION_BAD_SERVICE);
+  subscription_delayed_reschedule(0);
+}
+
 /**
  *
  */
@@ -341,9 +385,131 @@ subscription_start_instance
                                0 : mono2sec(s->ths_postpone_end - mclk()));
   if (si && (s->ths_flags & SUBSCRIPTION_CONTACCESS) == 0)
     mtimer_arm_rel(&s->ths_ca_check_timer, subscription_ca_check_cb, s, s->ths_ca_timeout);
+  if (si)
+    mtimer_arm_rel(&s->ths_probe_timer, subscription_probe_cb, s,
+                   sec2mono(MAX(si->si_s->s_grace_delay / 2,
+                                SUBSCRIPTION_PROBE_MIN)));
   return s->ths_current_instance = si;
 }
 
+/* **************************************************************************
+ * Warm standby
+ * *************************************************************************/
+
+#if ENABLE_MPEGTS
+/*
+ * For services flagged with warm standby, keep the mux of an alternative
+ * service for the same channel tuned on a spare input while the primary
+ * is streamed.  When the primary input dies, the failover instance then
+ * starts on an already locked mux - the subscription just relinks its
+ * streaming pad instead of waiting out a tune.
+ */
+typedef struct subscription_standby {
+  LIST_ENTRY(subscription_standby) sps_link;
+  th_subscription_t *sps_sub;    /* protected subscription */
+  mpegts_mux_t      *sps_mux;    /* mux kept warm */
+} subscription_standby_t;
+
+static LIST_HEAD(,subscription_standby) subscription_standbys;
+
+#define SUBSCRIPTION_STANDBY_NAME "warm-standby"
+
+/*
+ * The mux the failover would land on: the first enabled alternative
+ * service of the channel living on a different mux
+ */
+static mpegts_mux_t *
+subscription_standby_backup_mux(th_subscription_t *s)
+{
+  service_t *t = s->ths_service, *t2;
+  idnode_list_mapping_t *ilm;
+  mpegts_mux_t *mm, *cur;
+
+  if (t == NULL || s->ths_channel == NULL)
+    return NULL;
+  if (t->s_source_type != S_MPEG_TS)
+    return NULL;
+  cur = ((mpegts_service_t *)t)->s_dvb_mux;
+  LIST_FOREACH(ilm, &s->ths_channel->ch_services, ilm_in2_link) {
+    t2 = (service_t *)ilm->ilm_in1;
+    if (t2 == t || !t2->s_enabled) continue;
+    if (t2->s_source_type != S_MPEG_TS) continue;
+    mm = ((mpegts_service_t *)t2)->s_dvb_mux;
+    if (mm == NULL || mm == cur) continue;
+    return mm;
+  }
+  return NULL;
+}
+
+static void
+subscription_standby_release(subscription_standby_t *sps)
+{
+  mpegts_mux_unsubscribe_by_name(sps->sps_mux, SUBSCRIPTION_STANDBY_NAME);
+  LIST_REMOVE(sps, sps_link);
+  mpegts_mux_release(sps->sps_mux);
+  free(sps);
+}
+
+static void
+subscription_standby_remove(th_subscription_t *s)
+{
+  subscription_standby_t *sps;
+
+  LIST_FOREACH(sps, &subscription_standbys, sps_link)
+    if (sps->sps_sub == s) {
+      subscription_standby_release(sps);
+      return;
+    }
+}
+
+static void
+subscription_standby_update(void)
+{
+  th_subscription_t *s;
+  subscription_standby_t *sps, *next;
+  mpegts_mux_t *mm;
+
+  /* Drop standbys whose subscription moved, stopped or lost the flag */
+  for (sps = LIST_FIRST(&subscription_standbys); sps; sps = next) {
+    next = LIST_NEXT(sps, sps_link);
+    s = sps->sps_sub;
+    if (subgetstate(s) == SUBSCRIPTION_GOT_SERVICE &&
+        s->ths_service && s->ths_service->s_warm_standby &&
+        subscription_standby_backup_mux(s) == sps->sps_mux)
+      continue;
+    subscription_standby_release(sps);
+  }
+
+  LIST_FOREACH(s, &subscriptions, ths_global_link) {
+    if (s->ths_flags & SUBSCRIPTION_ONESHOT) continue;
+    if (subgetstate(s) != SUBSCRIPTION_GOT_SERVICE) continue;
+    if (s->ths_service == NULL || !s->ths_service->s_warm_standby) continue;
+    LIST_FOREACH(sps, &subscription_standbys, sps_link)
+      if (sps->sps_sub == s)
+        break;
+    if (sps) continue;
+    mm = subscription_standby_backup_mux(s);
+    if (mm == NULL) continue;
+    /* lowest weight - a standby must never steal a wanted tuner */
+    if (mpegts_mux_subscribe(mm, NULL, SUBSCRIPTION_STANDBY_NAME,
+                             SUBSCRIPTION_PRIO_KEEP, SUBSCRIPTION_NONE))
+      continue;
+    sps = calloc(1, sizeof(*sps));
+    sps->sps_sub = s;
+    sps->sps_mux = mm;
+    /* hold the mux over the entry's lifetime - it may be deleted
+       while we still keep a pointer to it */
+    mpegts_mux_grab(mm);
+    LIST_INSERT_HEAD(&subscription_standbys, sps, sps_link);
+    tvhinfo(LS_SUBSCRIPTION, "%04X: warm standby tuned on %s for \"%s\"",
+            shortid(s), mm->mm_nicename, s->ths_title);
+  }
+}
+#else /* ENABLE_MPEGTS */
+static inline void subscription_standby_remove(th_subscription_t *s) { }
+static inline void subscription_standby_update(void) { }
+#endif
+
 /**
  *
  */
@@ -447,6 +613,8 @@ subscription_reschedule(void)
   while ((s = LIST_FIRST(&subscriptions_remove)))
     subscription_unsubscribe(s, 0);
 
+  subscription_standby_update();
+
   if (postpone <= 0 || postpone == INT_MAX)
     postpone = 2;
   subscription_delayed_reschedule(sec2mono(postpone));
@@ -533,6 +701,9 @@ static void
 subscription_input_direct(void *opauqe, streaming_message_t *sm)
 {
   th_subscription_t *s = opauqe;
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec ts0, ts1;
+#endif
 
   /* Log data and errors */
   if(sm->sm_type == SMT_PACKET) {
@@ -540,14 +711,27 @@ subscription_input_direct(void *opauqe, streaming_message_t *sm)
     atomic_add(&s->ths_total_err, pkt->pkt_err);
     if (pkt->pkt_payload)
       subscription_add_bytes_in(s, pktbuf_len(pkt->pkt_payload));
+    atomic_add_u64(&s->ths_total_pkts, 1);
   } else if(sm->sm_type == SMT_MPEGTS) {
     pktbuf_t *pb = sm->sm_data;
     atomic_add(&s->ths_total_err, pb->pb_err);
     subscription_add_bytes_in(s, pktbuf_len(pb));
+    atomic_add_u64(&s->ths_total_pkts, pktbuf_len(pb) / 188);
   }
 
-  /* Pass to output */
-  streaming_target_deliver(s->ths_output, sm);
+  /* Pass to output - downstream filters assume exclusive ownership.
+   * The chain runs synchronously on this thread, so the thread CPU
+   * clock around it attributes the delivery cost to the subscription. */
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts0);
+#endif
+  streaming_target_deliver(s->ths_output, streaming_msg_unshare(sm));
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts1);
+  atomic_add_u64(&s->ths_total_cpu,
+                 (uint64_t)(ts1.tv_sec - ts0.tv_sec) * 1000000000ULL +
+                 (ts1.tv_nsec - ts0.tv_nsec));
+#endif
 }
 
 static htsmsg_t *
@@ -576,13 +760,13 @@ subscription_input(void *opaque, streaming_message_t *sm)
     // We are just testing if this service is good
 
     if(sm->sm_type == SMT_GRACE) {
-      streaming_target_deliver(s->ths_output, sm);
+      streaming_target_deliver(s->ths_output, streaming_msg_unshare(sm));
       return;
     }
 
     if(sm->sm_type == SMT_START) {
       streaming_msg_free(s->ths_start_message);
-      s->ths_start_message = sm;
+      s->ths_start_message = streaming_msg_unshare(sm);
       return;
     }
 
@@ -708,6 +892,8 @@ subscription_unsubscribe(th_subscription_t *s, int flags)
   LIST_REMOVE(s, ths_global_link);
   LIST_SAFE_REMOVE(s, ths_remove_link);
 
+  subscription_standby_remove(s);
+
 #if ENABLE_MPEGTS
   if (raw && t == raw) {
     LIST_REMOVE(s, ths_mux_link);
@@ -739,6 +925,7 @@ subscription_unsubscribe(th_subscription_t *s, int flags)
 
   mtimer_disarm(&s->ths_remove_timer);
   mtimer_disarm(&s->ths_ca_check_timer);
+  mtimer_disarm(&s->ths_probe_timer);
 
   if (s->ths_parser) {
     parser_destroy(s->ths_parser);
@@ -1012,6 +1199,16 @@ subscription_create_msg(th_subscription_t *s, const char *lang)
   htsmsg_add_u32(m, "start", s->ths_start);
   htsmsg_add_u32(m, "errors", atomic_get(&s->ths_total_err));
 
+  if (s->ths_latency_count) {
+    uint64_t cnt = s->ths_latency_count;
+    htsmsg_add_s64(m, "latency_p50_us",
+                   tprofile_hist_percentile(&s->ths_latency_hist, cnt, 50));
+    htsmsg_add_s64(m, "latency_p90_us",
+                   tprofile_hist_percentile(&s->ths_latency_hist, cnt, 90));
+    htsmsg_add_s64(m, "latency_p99_us",
+                   tprofile_hist_percentile(&s->ths_latency_hist, cnt, 99));
+  }
+
   switch(subgetstate(s)) {
   default:
     state = N_("Idle");
@@ -1095,10 +1292,117 @@ subscription_create_msg(th_subscription_t *s, const char *lang)
   htsmsg_add_u32(m, "out", atomic_get(&s->ths_bytes_out_avg));
   htsmsg_add_s64(m, "total_in", atomic_get_u64(&s->ths_total_bytes_in));
   htsmsg_add_s64(m, "total_out", atomic_get_u64(&s->ths_total_bytes_out));
+  /* delivery CPU in milliseconds per second, i.e. per-mille of one core */
+  htsmsg_add_u32(m, "cpu", atomic_get(&s->ths_cpu_avg) / 1000000);
+  htsmsg_add_s64(m, "total_cpu_ms", atomic_get_u64(&s->ths_total_cpu) / 1000000);
+  htsmsg_add_s64(m, "total_pkts", atomic_get_u64(&s->ths_total_pkts));
+
+  if (s->ths_prch != NULL && s->ths_prch->prch_sq_used) {
+    streaming_queue_t *sq = &s->ths_prch->prch_sq;
+    l = htsmsg_create_map();
+    tvh_mutex_lock(&sq->sq_mutex);
+    htsmsg_add_s64(l, "bytes", sq->sq_size);
+    htsmsg_add_s64(l, "bytes_peak", sq->sq_size_highwater);
+    htsmsg_add_s64(l, "bytes_max", sq->sq_maxsize);
+    htsmsg_add_u32(l, "Idrops", sq->sq_drops[PKT_I_FRAME]);
+    htsmsg_add_u32(l, "Pdrops", sq->sq_drops[PKT_P_FRAME]);
+    htsmsg_add_u32(l, "Bdrops", sq->sq_drops[PKT_B_FRAME]);
+    htsmsg_add_u32(l, "drops", sq->sq_drops[0]);
+    tvh_mutex_unlock(&sq->sq_mutex);
+    htsmsg_add_msg(m, "queue", l);
+  }
 
   return m;
 }
 
+/**
+ * Overload governor. The input threads queue raw TS for processing; a
+ * growing backlog means the box can no longer keep up with the packet
+ * path. Shed optional work in stages - first park the OTA EPG grabber,
+ * then defer autorec evaluation, and as a last resort drop the lowest
+ * weight subscription - and step back down one stage at a time once the
+ * backlog has stayed low for a while.
+ */
+#define GOVERNOR_STAGE1_BYTES  (4*1024*1024)
+#define GOVERNOR_STAGE2_BYTES (12*1024*1024)
+#define GOVERNOR_STAGE3_BYTES (24*1024*1024)
+#define GOVERNOR_COOLDOWN_SEC 30
+
+static int governor_stage;
+static int governor_calm;
+
+static void
+subscription_governor(void)
+{
+  uint64_t depth = 0;
+  int target = 0;
+#if ENABLE_MPEGTS
+  mpegts_input_t *mi;
+
+  LIST_FOREACH(mi, &mpegts_input_all, mi_global_link) {
+    tvh_mutex_lock(&mi->mi_input_lock);
+    if (mi->mi_input_queue_size > depth)
+      depth = mi->mi_input_queue_size;
+    tvh_mutex_unlock(&mi->mi_input_lock);
+  }
+#endif
+
+  if (depth >= GOVERNOR_STAGE3_BYTES)
+    target = 3;
+  else if (depth >= GOVERNOR_STAGE2_BYTES)
+    target = 2;
+  else if (depth >= GOVERNOR_STAGE1_BYTES)
+    target = 1;
+
+  if (target > governor_stage) {
+    tvhwarn(LS_SUBSCRIPTION, "input backlog %"PRIu64" kB, "
+            "shedding load (stage %d)", depth / 1024, target);
+    if (target >= 1 && governor_stage < 1)
+      epggrab_ota_pause(1);
+    if (target >= 2 && governor_stage < 2)
+      dvr_autorec_set_defer(1);
+    governor_stage = target;
+    governor_calm = 0;
+  } else if (target < governor_stage) {
+    if (++governor_calm >= GOVERNOR_COOLDOWN_SEC) {
+      governor_calm = 0;
+      governor_stage--;
+      if (governor_stage < 2)
+        dvr_autorec_set_defer(0);
+      if (governor_stage < 1)
+        epggrab_ota_pause(0);
+      tvhinfo(LS_SUBSCRIPTION, "load recovered, easing shedding to stage %d",
+              governor_stage);
+    }
+  } else {
+    governor_calm = 0;
+  }
+
+  /* last resort - drop the lowest weight running subscription,
+   * at most one per second so the relief can be observed */
+  if (governor_stage >= 3) {
+    th_subscription_t *s, *worst = NULL;
+
+    LIST_FOREACH(s, &subscriptions, ths_global_link) {
+      if (s->ths_state != SUBSCRIPTION_GOT_SERVICE)
+        continue;
+      if (s->ths_service == NULL)
+        continue;
+      if (s->ths_flags & SUBSCRIPTION_ONESHOT)
+        continue;
+      if (worst == NULL || s->ths_weight < worst->ths_weight)
+        worst = s;
+    }
+    if (worst) {
+      tvhwarn(LS_SUBSCRIPTION, "%04X: dropping \"%s\" (weight %d) "
+              "to relieve overload", shortid(worst),
+              worst->ths_title ?: "", worst->ths_weight);
+      service_remove_subscriber(worst->ths_service, worst,
+                                SM_CODE_SUBSCRIPTION_OVERRIDDEN);
+    }
+  }
+}
+
 /**
  * Check status (bandwidth, errors, etc.)
  */
@@ -1112,6 +1416,8 @@ subscription_status_callback ( void *p )
   mtimer_arm_rel(&subscription_status_timer,
                  subscription_status_callback, NULL, sec2mono(1));
 
+  subscription_governor();
+
   LIST_FOREACH(s, &subscriptions, ths_global_link) {
     /* Store the difference between total bytes from the last round */
     uint64_t in_curr = atomic_get_u64(&s->ths_total_bytes_in);
@@ -1119,8 +1425,12 @@ subscription_status_callback ( void *p )
     uint64_t out_curr = atomic_get_u64(&s->ths_total_bytes_out);
     uint64_t out_prev = atomic_exchange_u64(&s->ths_total_bytes_out_prev, out_curr);
 
+    uint64_t cpu_curr = atomic_get_u64(&s->ths_total_cpu);
+    uint64_t cpu_prev = atomic_exchange_u64(&s->ths_total_cpu_prev, cpu_curr);
+
     atomic_set(&s->ths_bytes_in_avg, (int)(in_curr - in_prev));
     atomic_set(&s->ths_bytes_out_avg, (int)(out_curr - out_prev));
+    atomic_set(&s->ths_cpu_avg, (int)(cpu_curr - cpu_prev));
 
     htsmsg_t *m = subscription_create_msg(s, NULL);
     htsmsg_add_u32(m, "updateEntry", 1);
@@ -1177,6 +1487,17 @@ void subscription_add_bytes_out(th_subscription_t *s, size_t out)
   atomic_add_u64(&s->ths_total_bytes_out, out);
 }
 
+/**
+ * Record one input-to-output delivery lag sample (microseconds)
+ */
+void subscription_latency_sample(th_subscription_t *s, int64_t us)
+{
+  if (us < 0)
+    us = 0;
+  tprofile_hist_update(&s->ths_latency_hist, us);
+  s->ths_latency_count++;
+}
+
 /**
  * Change weight
  */
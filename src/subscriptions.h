@@ -20,6 +20,7 @@
 #define SUBSCRIPTIONS_H
 
 #include "service.h"
+#include "tprofile.h"
 
 struct profile_chain;
 
@@ -43,6 +44,7 @@ extern struct th_subscription_list subscriptions;
 #define SUBSCRIPTION_EPG        0x8000 ///< for mux subscriptions
 #define SUBSCRIPTION_HTSP      0x10000
 #define SUBSCRIPTION_SWSERVICE 0x20000
+#define SUBSCRIPTION_AUDIOONLY 0x40000 ///< audio ES extraction only
 
 /* Some internal priorities */
 #define SUBSCRIPTION_PRIO_KEEP        1 ///< Keep input rolling
@@ -84,6 +86,7 @@ typedef struct th_subscription {
 
   mtimer_t ths_remove_timer;
   mtimer_t ths_ca_check_timer;
+  mtimer_t ths_probe_timer;
 
   LIST_ENTRY(th_subscription) ths_channel_link;
   struct channel *ths_channel;          /* May be NULL if channel has been
@@ -106,6 +109,13 @@ typedef struct th_subscription {
   int ths_bytes_in_avg; /* Average bytes in per second */
   int ths_bytes_out_avg; /* Average bytes out per second */
 
+  /* accounting ledger - CPU attributed to the delivery chain (parsers,
+   * filters, muxer) and stream packets processed for this subscription */
+  uint64_t ths_total_cpu; /* ns of delivery CPU since the subscription started */
+  uint64_t ths_total_cpu_prev; /* same, minus 1 second */
+  int ths_cpu_avg; /* ns of delivery CPU per second */
+  uint64_t ths_total_pkts; /* TS packets / parsed packets processed */
+
   streaming_target_t ths_input;
 
   streaming_target_t *ths_output;
@@ -125,6 +135,14 @@ typedef struct th_subscription {
   char *ths_client;
   char *ths_dvrfile;
 
+  /**
+   * Input-to-output delivery lag, fed by the streaming targets from
+   * the arrival stamps carried in pktbuf/th_pkt; updated by the
+   * delivering thread only, read racily for status views
+   */
+  tprofile_hist_t ths_latency_hist;
+  uint64_t ths_latency_count;
+
   /**
    * This is the list of service candidates we have
    */
@@ -233,6 +251,8 @@ void subscription_add_bytes_in(th_subscription_t *s, size_t in);
 
 void subscription_add_bytes_out(th_subscription_t *s, size_t out);
 
+void subscription_latency_sample(th_subscription_t *s, int64_t us);
+
 static inline int subscriptions_active(void)
   { return LIST_FIRST(&subscriptions) != NULL; }
 
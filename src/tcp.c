@@ -16,9 +16,12 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
 #include <fcntl.h>
 #include <poll.h>
 #include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
@@ -258,16 +261,24 @@ int
 tcp_write_queue(int fd, htsbuf_queue_t *q)
 {
   htsbuf_data_t *hd;
-  int l, r = 0;
-  void *p;
+  struct iovec iov[32];
+  int n, i, r = 0;
 
   while((hd = TAILQ_FIRST(&q->hq_q)) != NULL) {
     if (!r) {
-      l = hd->hd_data_len - hd->hd_data_off;
-      p = hd->hd_data + hd->hd_data_off;
-      r = tvh_write(fd, p, l);
+      /* gather a batch of chunks into one vectored write */
+      n = 0;
+      do {
+        iov[n].iov_base = hd->hd_data + hd->hd_data_off;
+        iov[n].iov_len  = hd->hd_data_len - hd->hd_data_off;
+        hd = TAILQ_NEXT(hd, hd_link);
+      } while (++n < (int)ARRAY_SIZE(iov) && hd != NULL);
+      r = tvh_writev(fd, iov, n);
+      for (i = 0; i < n; i++)
+        htsbuf_data_free(q, TAILQ_FIRST(&q->hq_q));
+    } else {
+      htsbuf_data_free(q, hd);
     }
-    htsbuf_data_free(q, hd);
   }
   q->hq_size = 0;
   return r;
@@ -302,9 +313,10 @@ tcp_fill_htsbuf_from_fd(int fd, htsbuf_queue_t *hq)
   }
   
   hd = malloc(sizeof(htsbuf_data_t));
-  
+
   hd->hd_data_size = 1000;
   hd->hd_data = malloc(hd->hd_data_size);
+  hd->hd_pktbuf = NULL;
 
   do {
     r = read(fd, hd->hd_data, hd->hd_data_size);
@@ -454,6 +466,45 @@ tcp_socket_dead(int fd)
   return 0;
 }
 
+/**
+ * Limit the unsent data the kernel accepts before write() blocks and
+ * the socket stops polling writable, so a slow client is noticed while
+ * the backlog is still small
+ */
+int
+tcp_socket_notsent_lowat(int fd, int bytes)
+{
+#ifdef TCP_NOTSENT_LOWAT
+  return setsockopt(fd, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                    (void *)&bytes, sizeof(bytes));
+#else
+  return -1;
+#endif
+}
+
+/**
+ * Bytes queued in the kernel send buffer, not yet acked by the peer
+ * (-1 when the platform cannot tell)
+ */
+int64_t
+tcp_socket_sendq(int fd)
+{
+#if defined(TIOCOUTQ)
+  int bytes;
+  if (ioctl(fd, TIOCOUTQ, &bytes) < 0)
+    return -1;
+  return bytes;
+#elif defined(SO_NWRITE)
+  int bytes;
+  socklen_t len = sizeof(bytes);
+  if (getsockopt(fd, SOL_SOCKET, SO_NWRITE, &bytes, &len) < 0)
+    return -1;
+  return bytes;
+#else
+  return -1;
+#endif
+}
+
 /**
  *
  */
@@ -509,8 +560,24 @@ tcp_get_ip_from_str(const char *src, struct sockaddr_storage *sa)
 static tvhpoll_t *tcp_server_poll;
 static uint32_t tcp_server_launch_id;
 
+/* Number of SO_REUSEPORT listener shards per server; each shard owns its
+ * own kernel accept backlog, so a reconnect storm is spread over several
+ * queues instead of overflowing a single listen() backlog */
+#define TCP_SERVER_SHARDS 4
+
+/* Threads finishing connection setup (getsockname, bookkeeping, thread
+ * spawn) off the accept loop */
+#define TCP_SERVER_SETUP_THREADS 4
+
+typedef struct tcp_server_shard {
+  int fd;
+  struct tcp_server *server;
+} tcp_server_shard_t;
+
 typedef struct tcp_server {
   int serverfd;
+  int nshards;
+  tcp_server_shard_t shard[TCP_SERVER_SHARDS];
   struct sockaddr_storage bound;
   tcp_server_ops_t ops;
   void *opaque;
@@ -532,6 +599,7 @@ typedef struct tcp_server_launch {
   LIST_ENTRY(tcp_server_launch) link;
   LIST_ENTRY(tcp_server_launch) alink;
   LIST_ENTRY(tcp_server_launch) jlink;
+  TAILQ_ENTRY(tcp_server_launch) qlink;
 } tcp_server_launch_t;
 
 static LIST_HEAD(, tcp_server) tcp_server_delete_list = { 0 };
@@ -539,6 +607,11 @@ static LIST_HEAD(, tcp_server_launch) tcp_server_launches = { 0 };
 static LIST_HEAD(, tcp_server_launch) tcp_server_active = { 0 };
 static LIST_HEAD(, tcp_server_launch) tcp_server_join = { 0 };
 
+static tvh_mutex_t tcp_server_setup_lock = TVH_THREAD_MUTEX_INITIALIZER;
+static tvh_cond_t tcp_server_setup_cond;
+static TAILQ_HEAD(, tcp_server_launch) tcp_server_setup_queue;
+static pthread_t tcp_server_setup_tid[TCP_SERVER_SETUP_THREADS];
+
 /**
  *
  */
@@ -734,21 +807,115 @@ tcp_server_start(void *aux)
 }
 
 
+/**
+ * Finish connection setup off the accept loop: self address lookup,
+ * bookkeeping and the per-connection thread spawn all happen here, so
+ * the poll thread does nothing but accept during a reconnect storm
+ */
+static void *
+tcp_server_setup_thread(void *aux)
+{
+  tcp_server_launch_t *tsl;
+  socklen_t slen;
+
+  tvh_mutex_lock(&tcp_server_setup_lock);
+  while (atomic_get(&tcp_server_running)) {
+    tsl = TAILQ_FIRST(&tcp_server_setup_queue);
+    if (tsl == NULL) {
+      tvh_cond_wait(&tcp_server_setup_cond, &tcp_server_setup_lock);
+      continue;
+    }
+    TAILQ_REMOVE(&tcp_server_setup_queue, tsl, qlink);
+    tvh_mutex_unlock(&tcp_server_setup_lock);
+
+    slen = sizeof(struct sockaddr_storage);
+    if (getsockname(tsl->fd, (struct sockaddr *)&tsl->self, &slen)) {
+      close(tsl->fd);
+      free(tsl);
+    } else {
+      tvh_mutex_lock(&global_lock);
+      LIST_INSERT_HEAD(&tcp_server_active, tsl, alink);
+      tvh_mutex_unlock(&global_lock);
+      tvh_thread_create(&tsl->tid, NULL, tcp_server_start, tsl, "tcp-start");
+    }
+
+    tvh_mutex_lock(&tcp_server_setup_lock);
+  }
+  tvh_mutex_unlock(&tcp_server_setup_lock);
+  return NULL;
+}
+
+/**
+ * Accept all pending connections on a (non-blocking) listener shard,
+ * so one readiness event costs only one extra accept() returning EAGAIN
+ * no matter how many clients arrived at once.  The whole batch is handed
+ * to the setup workers under a single lock/wakeup
+ */
+static void
+tcp_server_accept(tcp_server_shard_t *tss)
+{
+  tcp_server_t *ts = tss->server;
+  tcp_server_launch_t *tsl;
+  TAILQ_HEAD(, tcp_server_launch) batch;
+  socklen_t slen;
+  int empty = 1;
+
+  TAILQ_INIT(&batch);
+
+  while(1) {
+    tsl = malloc(sizeof(tcp_server_launch_t));
+    tsl->ops            = ts->ops;
+    tsl->opaque         = ts->opaque;
+    tsl->status         = NULL;
+    tsl->representative = NULL;
+    slen = sizeof(struct sockaddr_storage);
+
+#ifdef SOCK_CLOEXEC
+    tsl->fd = accept4(tss->fd,
+                      (struct sockaddr *)&tsl->peer, &slen, SOCK_CLOEXEC);
+#else
+    tsl->fd = accept(tss->fd,
+                     (struct sockaddr *)&tsl->peer, &slen);
+#endif
+    if(tsl->fd == -1) {
+      free(tsl);
+      if (!ERRNO_AGAIN(errno)) {
+        perror("accept");
+        sleep(1);
+      }
+      break;
+    }
+
+    TAILQ_INSERT_TAIL(&batch, tsl, qlink);
+    empty = 0;
+  }
+
+  if (empty)
+    return;
+
+  tvh_mutex_lock(&tcp_server_setup_lock);
+  TAILQ_CONCAT(&tcp_server_setup_queue, &batch, qlink);
+  tvh_cond_signal(&tcp_server_setup_cond, 1);
+  tvh_mutex_unlock(&tcp_server_setup_lock);
+}
+
 /**
  *
  */
+#define TCP_SERVER_POLL_EVENTS 16
+
 static void *
 tcp_server_loop(void *aux)
 {
-  int r;
-  tvhpoll_event_t ev;
+  int r, i;
+  tvhpoll_event_t ev[TCP_SERVER_POLL_EVENTS];
   tcp_server_t *ts;
+  tcp_server_shard_t *tss;
   tcp_server_launch_t *tsl;
-  socklen_t slen;
   char c;
 
   while(atomic_get(&tcp_server_running)) {
-    r = tvhpoll_wait(tcp_server_poll, &ev, 1, -1);
+    r = tvhpoll_wait(tcp_server_poll, ev, TCP_SERVER_POLL_EVENTS, -1);
     if(r < 0) {
       if (ERRNO_AGAIN(errno))
         continue;
@@ -756,65 +923,39 @@ tcp_server_loop(void *aux)
       continue;
     }
 
-    if (r == 0) continue;
+    for (i = 0; i < r; i++) {
 
-    if (ev.ptr == &tcp_server_pipe) {
-      r = read(tcp_server_pipe.rd, &c, 1);
-      if (r > 0) {
+      if (ev[i].ptr == &tcp_server_pipe) {
+        if (read(tcp_server_pipe.rd, &c, 1) > 0) {
 next:
-        tvh_mutex_lock(&global_lock);
-        while ((tsl = LIST_FIRST(&tcp_server_join)) != NULL) {
-          LIST_REMOVE(tsl, jlink);
+          tvh_mutex_lock(&global_lock);
+          while ((tsl = LIST_FIRST(&tcp_server_join)) != NULL) {
+            LIST_REMOVE(tsl, jlink);
+            tvh_mutex_unlock(&global_lock);
+            pthread_join(tsl->tid, NULL);
+            free(tsl);
+            goto next;
+          }
+          while ((ts = LIST_FIRST(&tcp_server_delete_list)) != NULL) {
+            LIST_REMOVE(ts, link);
+            free(ts);
+          }
           tvh_mutex_unlock(&global_lock);
-          pthread_join(tsl->tid, NULL);
-          free(tsl);
-          goto next;
-        }
-        while ((ts = LIST_FIRST(&tcp_server_delete_list)) != NULL) {
-          LIST_REMOVE(ts, link);
-          free(ts);
         }
-        tvh_mutex_unlock(&global_lock);
+        continue;
       }
-      continue;
-    }
 
-    ts = ev.ptr;
+      tss = ev[i].ptr;
 
-    if(ev.events & TVHPOLL_HUP) {
-      close(ts->serverfd);
-      free(ts);
-      continue;
-    } 
-
-    if(ev.events & TVHPOLL_IN) {
-      tsl = malloc(sizeof(tcp_server_launch_t));
-      tsl->ops            = ts->ops;
-      tsl->opaque         = ts->opaque;
-      tsl->status         = NULL;
-      tsl->representative = NULL;
-      slen = sizeof(struct sockaddr_storage);
-
-      tsl->fd = accept(ts->serverfd, 
-                       (struct sockaddr *)&tsl->peer, &slen);
-      if(tsl->fd == -1) {
-     	perror("accept");
-     	free(tsl);
-     	sleep(1);
-     	continue;
-      }
-
-      slen = sizeof(struct sockaddr_storage);
-      if(getsockname(tsl->fd, (struct sockaddr *)&tsl->self, &slen)) {
-        close(tsl->fd);
-        free(tsl);
+      if(ev[i].events & TVHPOLL_HUP) {
+        tvhpoll_rem1(tcp_server_poll, tss->fd);
+        close(tss->fd);
+        tss->fd = -1;
         continue;
       }
 
-      tvh_mutex_lock(&global_lock);
-      LIST_INSERT_HEAD(&tcp_server_active, tsl, alink);
-      tvh_mutex_unlock(&global_lock);
-      tvh_thread_create(&tsl->tid, NULL, tcp_server_start, tsl, "tcp-start");
+      if(ev[i].events & TVHPOLL_IN)
+        tcp_server_accept(tss);
     }
   }
   tvhtrace(LS_TCP, "server thread finished");
@@ -834,7 +975,7 @@ void *tcp_server_create
   (int subsystem, const char *name, const char *bindaddr,
    int port, tcp_server_ops_t *ops, void *opaque)
 {
-  int fd, x;
+  int fd, x, nshards, shardfd[TCP_SERVER_SHARDS];
   tcp_server_t *ts;
   struct addrinfo hints, *res, *ressave, *use = NULL;
   struct sockaddr_storage bound;
@@ -870,35 +1011,55 @@ void *tcp_server_create
     res = res->ai_next;
   }
 
-  fd = tvh_socket(use->ai_family, use->ai_socktype, use->ai_protocol);
-  if(fd == -1) {
-    freeaddrinfo(ressave);
-    return NULL;
-  }
-
-  if(use->ai_family == AF_INET6)
-    setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(int));
-
-  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(int));
-
   assert(use->ai_addrlen <= sizeof(bound));
   memset(&bound, 0, sizeof(bound));
   memcpy(&bound, use->ai_addr, use->ai_addrlen);
-  
-  x = bind(fd, use->ai_addr, use->ai_addrlen);
+
+  /* Shard the listener over several SO_REUSEPORT sockets so the kernel
+   * spreads a reconnect storm over independent accept backlogs; kernels
+   * without SO_REUSEPORT fail the second bind and fall back to one */
+  nshards = 0;
+  while (nshards < TCP_SERVER_SHARDS) {
+    fd = tvh_socket(use->ai_family, use->ai_socktype, use->ai_protocol);
+    if(fd == -1)
+      break;
+
+    if(use->ai_family == AF_INET6)
+      setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(int));
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(int));
+#ifdef SO_REUSEPORT
+    setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(int));
+#endif
+
+    x = bind(fd, use->ai_addr, use->ai_addrlen);
+    if(x != 0) {
+      close(fd);
+      break;
+    }
+
+    listen(fd, 511);
+    shardfd[nshards++] = fd;
+
+#ifndef SO_REUSEPORT
+    break;
+#endif
+  }
   freeaddrinfo(ressave);
 
-  if(x != 0)
+  if(nshards == 0)
   {
     tvherror(LS_TCP, "bind: %s:%i: %s", bindaddr != NULL ? bindaddr : "*", port, strerror(errno));
-    close(fd);
     return NULL;
   }
 
-  listen(fd, 511);
-
-  ts = malloc(sizeof(tcp_server_t));
-  ts->serverfd = fd;
+  ts = calloc(1, sizeof(tcp_server_t));
+  ts->serverfd = shardfd[0];
+  ts->nshards  = nshards;
+  for (x = 0; x < nshards; x++) {
+    ts->shard[x].fd     = shardfd[x];
+    ts->shard[x].server = ts;
+  }
   ts->bound  = bound;
   ts->ops    = *ops;
   ts->opaque = opaque;
@@ -963,9 +1124,12 @@ tcp_server_create
   }
 
   if (found) {
-    /* use the systemd provided socket */
-    ts = malloc(sizeof(tcp_server_t));
+    /* use the systemd provided socket (single shard) */
+    ts = calloc(1, sizeof(tcp_server_t));
     ts->serverfd = fd;
+    ts->nshards  = 1;
+    ts->shard[0].fd     = fd;
+    ts->shard[0].server = ts;
     ts->bound  = bound;
     ts->ops    = *ops;
     ts->opaque = opaque;
@@ -987,11 +1151,18 @@ tcp_server_create
 void tcp_server_register(void *server)
 {
   tcp_server_t *ts = server;
+  int i, fd;
 
   if (ts == NULL)
     return;
 
-  tvhpoll_add1(tcp_server_poll, ts->serverfd, TVHPOLL_IN, ts);
+  /* the accept loop drains the backlog until EAGAIN; accepted
+   * sockets do not inherit the flag */
+  for (i = 0; i < ts->nshards; i++) {
+    fd = ts->shard[i].fd;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    tvhpoll_add1(tcp_server_poll, fd, TVHPOLL_IN, &ts->shard[i]);
+  }
 }
 
 /**
@@ -1002,12 +1173,18 @@ tcp_server_delete(void *server)
 {
   tcp_server_t *ts = server;
   char c = 'D';
+  int i;
 
   if (server == NULL)
     return;
 
-  tvhpoll_rem1(tcp_server_poll, ts->serverfd);
-  close(ts->serverfd);
+  for (i = 0; i < ts->nshards; i++) {
+    if (ts->shard[i].fd < 0)
+      continue;
+    tvhpoll_rem1(tcp_server_poll, ts->shard[i].fd);
+    close(ts->shard[i].fd);
+    ts->shard[i].fd = -1;
+  }
   ts->serverfd = -1;
   LIST_INSERT_HEAD(&tcp_server_delete_list, ts, link);
   tvh_write(tcp_server_pipe.wr, &c, 1);
@@ -1188,12 +1365,20 @@ tcp_server_preinit(int opt_ipv6)
 void
 tcp_server_init(void)
 {
+  int i;
+
   tvh_pipe(O_NONBLOCK, &tcp_server_pipe);
   tcp_server_poll = tvhpoll_create(10);
 
   tvhpoll_add1(tcp_server_poll, tcp_server_pipe.rd, TVHPOLL_IN, &tcp_server_pipe);
 
+  TAILQ_INIT(&tcp_server_setup_queue);
+  tvh_cond_init(&tcp_server_setup_cond, 1);
+
   atomic_set(&tcp_server_running, 1);
+  for (i = 0; i < TCP_SERVER_SETUP_THREADS; i++)
+    tvh_thread_create(&tcp_server_setup_tid[i], NULL,
+                      tcp_server_setup_thread, NULL, "tcp-setup");
   tvh_thread_create(&tcp_server_tid, NULL, tcp_server_loop, NULL, "tcp-loop");
 }
 
@@ -1201,9 +1386,10 @@ void
 tcp_server_done(void)
 {
   tcp_server_t *ts;
-  tcp_server_launch_t *tsl;  
+  tcp_server_launch_t *tsl;
   char c = 'E';
   int64_t t;
+  int i;
 
   atomic_set(&tcp_server_running, 0);
   tvh_write(tcp_server_pipe.wr, &c, 1);
@@ -1221,7 +1407,19 @@ tcp_server_done(void)
   pthread_join(tcp_server_tid, NULL);
   tvh_pipe_close(&tcp_server_pipe);
   tvhpoll_destroy(tcp_server_poll);
-  
+
+  /* wind down the setup workers and drop connections still queued */
+  tvh_mutex_lock(&tcp_server_setup_lock);
+  tvh_cond_signal(&tcp_server_setup_cond, 1);
+  tvh_mutex_unlock(&tcp_server_setup_lock);
+  for (i = 0; i < TCP_SERVER_SETUP_THREADS; i++)
+    pthread_join(tcp_server_setup_tid[i], NULL);
+  while ((tsl = TAILQ_FIRST(&tcp_server_setup_queue)) != NULL) {
+    TAILQ_REMOVE(&tcp_server_setup_queue, tsl, qlink);
+    close(tsl->fd);
+    free(tsl);
+  }
+
   tvh_mutex_lock(&global_lock);
   t = mclk();
   while (LIST_FIRST(&tcp_server_active) != NULL) {
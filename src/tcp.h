@@ -153,6 +153,10 @@ struct sockaddr_storage *tcp_get_ip_from_str(const char *str, struct sockaddr_st
 
 int tcp_socket_dead(int fd);
 
+int tcp_socket_notsent_lowat(int fd, int bytes);
+
+int64_t tcp_socket_sendq(int fd);
+
 struct access;
 
 uint32_t tcp_connection_count(struct access *aa);
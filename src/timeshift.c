@@ -289,6 +289,19 @@ const idclass_t timeshift_conf_class = {
       .off    = offsetof(timeshift_conf_t, ram_fit),
       .opts   = PO_EXPERT,
     },
+#if ENABLE_ZLIB
+    {
+      .type   = PT_BOOL,
+      .id     = "ram_compress",
+      .name   = N_("Compress idle RAM segments"),
+      .desc   = N_("Compress RAM buffer segments which are not being "
+                   "written or read. This trades some CPU time when "
+                   "seeking back for a deeper rewind buffer in the "
+                   "same amount of RAM."),
+      .off    = offsetof(timeshift_conf_t, ram_compress),
+      .opts   = PO_EXPERT,
+    },
+#endif
     {
       .type   = PT_BOOL,
       .id     = "teletext",
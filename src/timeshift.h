@@ -38,6 +38,7 @@ typedef struct timeshift_conf {
   uint64_t  total_ram_size;
   int       ram_only;
   int       ram_fit;
+  int       ram_compress;
   int       teletext;
 } timeshift_conf_t;
 
@@ -22,6 +22,7 @@
 #define TIMESHIFT_PLAY_BUF         1000000 //< us to buffer in TX
 #define TIMESHIFT_FILE_PERIOD      60      //< number of secs in each buffer file
 #define TIMESHIFT_BACKLOG_MAX      16      //< maximum elementary streams
+#define TIMESHIFT_MAP_CHUNK        (4*1024*1024) //< growth step of the mapped append window
 
 /**
  * Indexes of import data in the stream
@@ -64,12 +65,22 @@ typedef struct timeshift_file
 
   uint8_t                      *ram;      ///< RAM area
   int64_t                       ram_size; ///< RAM area size in bytes
+  uint8_t                      *zram;      ///< Deflated idle RAM segment
+  size_t                        zram_size; ///< Deflated size in bytes
+
+  uint8_t                      *wmap;      ///< Writer append mapping (file backend)
+  size_t                        wmap_size; ///< Mapped (pre-allocated) file size
+  uint8_t                      *rmap;      ///< Reader read-only mapping
+  size_t                        rmap_size; ///< Reader mapping size
 
   uint8_t                       bad;      ///< File is broken
 
   int                           refcount; ///< Reader ref count
 
   timeshift_index_iframe_list_t iframes;  ///< I-frame indexing
+  timeshift_index_iframe_t    **iframe_idx;   ///< Time-sorted array over iframes
+  int                           iframe_count; ///< Number of indexed i-frames
+  int                           iframe_alloc; ///< Allocated array slots
   timeshift_index_data_list_t   sstart;   ///< Stream start messages
 
   TAILQ_ENTRY(timeshift_file) link;     ///< List entry
@@ -223,6 +234,8 @@ void timeshift_filemgr_remove
   ( timeshift_t *ts, timeshift_file_t *tsf, int force );
 void timeshift_filemgr_flush ( timeshift_t *ts, timeshift_file_t *end );
 void timeshift_filemgr_close ( timeshift_file_t *tsf );
+void timeshift_filemgr_compress ( timeshift_file_t *tsf );
+int  timeshift_filemgr_uncompress ( timeshift_file_t *tsf );
 
 void timeshift_filemgr_dump0 ( timeshift_t *ts );
 
@@ -17,6 +17,7 @@
  */
 
 #include <fcntl.h>
+#include <sys/mman.h>
 
 #include "tvheadend.h"
 #include "streaming.h"
@@ -78,6 +79,7 @@ static void* timeshift_reaper_callback ( void *p )
       memoryinfo_free(&timeshift_memoryinfo, sizeof(*ti));
       free(ti);
     }
+    free(tsf->iframe_idx);
     while ((tid = TAILQ_FIRST(&tsf->sstart))) {
       TAILQ_REMOVE(&tsf->sstart, tid, link);
       sm = tid->data;
@@ -88,6 +90,10 @@ static void* timeshift_reaper_callback ( void *p )
     free(tsf->path);
     memoryinfo_free(&timeshift_memoryinfo_ram, tsf->ram_size);
     free(tsf->ram);
+    if (tsf->zram) {
+      memoryinfo_free(&timeshift_memoryinfo_ram, tsf->zram_size);
+      free(tsf->zram);
+    }
     memoryinfo_free(&timeshift_memoryinfo, sizeof(*tsf));
     free(tsf);
 
@@ -112,6 +118,79 @@ static void timeshift_reaper_remove ( timeshift_file_t *tsf )
   tvh_mutex_unlock(&timeshift_reaper_lock);
 }
 
+/* **************************************************************************
+ * RAM segment compression
+ * *************************************************************************/
+
+#if ENABLE_ZLIB
+
+/*
+ * Deflate a closed RAM segment with no readers to stretch the RAM buffer
+ */
+void timeshift_filemgr_compress ( timeshift_file_t *tsf )
+{
+  uint8_t *z;
+  size_t zsize;
+
+  if (!timeshift_conf.ram_compress ||
+      tsf->ram == NULL || tsf->refcount > 0 || tsf->woff == 0)
+    return;
+  z = tvh_gzip_deflate(tsf->ram, tsf->woff, &zsize);
+  if (z == NULL)
+    return;
+  if (zsize >= tsf->woff) {
+    free(z);
+    return;
+  }
+  tvh_mutex_lock(&tsf->ram_lock);
+  memoryinfo_free(&timeshift_memoryinfo_ram, tsf->ram_size);
+  free(tsf->ram);
+  tsf->ram = NULL;
+  tsf->ram_size = 0;
+  tsf->zram = z;
+  tsf->zram_size = zsize;
+  memoryinfo_alloc(&timeshift_memoryinfo_ram, zsize);
+  atomic_dec_u64(&timeshift_total_ram_size, tsf->woff - zsize);
+  tvh_mutex_unlock(&tsf->ram_lock);
+  tvhtrace(LS_TIMESHIFT, "deflate RAM segment time %"PRId64" (%"PRId64" -> %"PRId64")",
+           tsf->time, (int64_t)tsf->woff, (int64_t)zsize);
+}
+
+/*
+ * Inflate a compressed RAM segment before the reader touches it
+ */
+int timeshift_filemgr_uncompress ( timeshift_file_t *tsf )
+{
+  uint8_t *ram;
+
+  if (tsf->zram == NULL)
+    return 0;
+  tvh_mutex_lock(&tsf->ram_lock);
+  ram = tvh_gzip_inflate(tsf->zram, tsf->zram_size, tsf->woff);
+  if (ram == NULL) {
+    tvh_mutex_unlock(&tsf->ram_lock);
+    tvherror(LS_TIMESHIFT, "unable to inflate RAM segment time %"PRId64, tsf->time);
+    return -1;
+  }
+  memoryinfo_free(&timeshift_memoryinfo_ram, tsf->zram_size);
+  atomic_add_u64(&timeshift_total_ram_size, tsf->woff - tsf->zram_size);
+  free(tsf->zram);
+  tsf->zram = NULL;
+  tsf->zram_size = 0;
+  tsf->ram = ram;
+  tsf->ram_size = tsf->woff;
+  memoryinfo_alloc(&timeshift_memoryinfo_ram, tsf->ram_size);
+  tvh_mutex_unlock(&tsf->ram_lock);
+  return 0;
+}
+
+#else /* ENABLE_ZLIB */
+
+void timeshift_filemgr_compress ( timeshift_file_t *tsf ) { }
+int  timeshift_filemgr_uncompress ( timeshift_file_t *tsf ) { return 0; }
+
+#endif /* ENABLE_ZLIB */
+
 /* **************************************************************************
  * File Handling
  * *************************************************************************/
@@ -180,6 +259,17 @@ void timeshift_filemgr_close ( timeshift_file_t *tsf )
       tsf->ram = ram;
       tsf->ram_size = tsf->woff;
     }
+    timeshift_filemgr_compress(tsf);
+  }
+  if (tsf->wmap) {
+    /* flush and trim the pre-allocated tail */
+    msync(tsf->wmap, tsf->woff, MS_ASYNC);
+    munmap(tsf->wmap, tsf->wmap_size);
+    tsf->wmap = NULL;
+    tsf->wmap_size = 0;
+    if (ftruncate(tsf->wfd, tsf->woff) < 0)
+      tvherror(LS_TIMESHIFT, "failed to trim %s [e=%s]",
+               tsf->path, strerror(errno));
   }
   if (tsf->wfd >= 0)
     close(tsf->wfd);
@@ -192,6 +282,11 @@ void timeshift_filemgr_close ( timeshift_file_t *tsf )
 void timeshift_filemgr_remove
   ( timeshift_t *ts, timeshift_file_t *tsf, int force )
 {
+  if (tsf->wmap) {
+    munmap(tsf->wmap, tsf->wmap_size);
+    tsf->wmap = NULL;
+    tsf->wmap_size = 0;
+  }
   if (tsf->wfd >= 0)
     close(tsf->wfd);
   assert(tsf->rfd < 0);
@@ -211,8 +306,9 @@ void timeshift_filemgr_remove
     ts->ram_segments--;
   }
   atomic_dec_u64(&timeshift_total_size, tsf->size);
-  if (tsf->ram)
-    atomic_dec_u64(&timeshift_total_ram_size, tsf->size);
+  if (tsf->ram || tsf->zram)
+    atomic_dec_u64(&timeshift_total_ram_size,
+                   tsf->zram ? tsf->zram_size : tsf->size);
   timeshift_reaper_remove(tsf);
 }
 
@@ -337,7 +433,7 @@ timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
         } else {
           tsf_hd = TAILQ_FIRST(&ts->files);
           if (timeshift_conf.ram_fit && tsf_hd && !tsf_hd->refcount &&
-              tsf_hd->ram && ts->file_segments == 0) {
+              (tsf_hd->ram || tsf_hd->zram) && ts->file_segments == 0) {
             tvhtrace(LS_TIMESHIFT, "ts %d remove RAM segment %"PRId64" (fit)", ts->id, tsf_hd->time);
             timeshift_filemgr_remove(ts, tsf_hd, 0);
           } else {
@@ -357,11 +453,23 @@ timeshift_file_t *timeshift_filemgr_get ( timeshift_t *ts, int64_t start_time )
         /* Create File */
         snprintf(path, sizeof(path), "%s/tvh-%"PRId64, ts->path, start_time);
         tvhtrace(LS_TIMESHIFT, "ts %d create file %s", ts->id, path);
-        if ((fd = tvh_open(path, O_WRONLY | O_CREAT, 0600)) > 0) {
+        if ((fd = tvh_open(path, O_RDWR | O_CREAT, 0600)) > 0) {
           tsf_tmp = timeshift_filemgr_file_init(ts, start_time);
           tsf_tmp->wfd = fd;
           tsf_tmp->path = strdup(path);
           ts->file_segments++;
+          /* pre-allocate the mapped append window, plain write() on failure */
+          if (ftruncate(fd, TIMESHIFT_MAP_CHUNK) == 0) {
+            tsf_tmp->wmap = mmap(NULL, TIMESHIFT_MAP_CHUNK,
+                                 PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (tsf_tmp->wmap == MAP_FAILED) {
+              tsf_tmp->wmap = NULL;
+              if (ftruncate(fd, 0))
+                tvhwarn(LS_TIMESHIFT, "unable to truncate %s", path);
+            } else {
+              tsf_tmp->wmap_size = TIMESHIFT_MAP_CHUNK;
+            }
+          }
         }
       }
 
@@ -25,6 +25,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -62,6 +63,11 @@ static timeshift_seek_t *_seek_set_file
 
 static timeshift_seek_t *_read_close ( timeshift_seek_t *seek )
 {
+  if (seek->file && seek->file->rmap) {
+    munmap(seek->file->rmap, seek->file->rmap_size);
+    seek->file->rmap = NULL;
+    seek->file->rmap_size = 0;
+  }
   if (seek->file && seek->file->rfd >= 0) {
     close(seek->file->rfd);
     seek->file->rfd = -1;
@@ -73,11 +79,51 @@ static timeshift_seek_t *_read_close ( timeshift_seek_t *seek )
  * File Reading
  * *************************************************************************/
 
+/*
+ * Map (or re-map after writer growth) the segment for reading
+ */
+static int _read_map ( timeshift_file_t *tsf )
+{
+  struct stat st;
+  uint8_t *map;
+
+  if (tsf->rmap) {
+    munmap(tsf->rmap, tsf->rmap_size);
+    tsf->rmap = NULL;
+    tsf->rmap_size = 0;
+  }
+  if (fstat(tsf->rfd, &st) < 0 || st.st_size == 0)
+    return -1;
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, tsf->rfd, 0);
+  if (map == MAP_FAILED)
+    return -1;
+  tsf->rmap = map;
+  tsf->rmap_size = st.st_size;
+  return 0;
+}
+
 static ssize_t _read_buf ( timeshift_file_t *tsf, int fd, void *buf, size_t size )
 {
   ssize_t r;
   size_t ret;
 
+  if (tsf && tsf->rmap) {
+    /* woff is coherent with the writer (both run under ts->state_mutex) */
+    if (tsf->roff + size > tsf->woff) return 0;
+    if (tsf->roff + size > tsf->rmap_size) {
+      /* writer grew the file since we mapped it */
+      if (_read_map(tsf)) {
+        if (lseek(tsf->rfd, tsf->roff, SEEK_SET) != tsf->roff)
+          return -1;
+        goto file;
+      }
+    }
+    memcpy(buf, tsf->rmap + tsf->roff, size);
+    tsf->roff += size;
+    return size;
+  }
+
+file:
   if (tsf && tsf->ram) {
     if (tsf->roff == tsf->woff) return 0;
     if (tsf->roff + size > tsf->woff) return -1;
@@ -87,6 +133,9 @@ static ssize_t _read_buf ( timeshift_file_t *tsf, int fd, void *buf, size_t size
     tvh_mutex_unlock(&tsf->ram_lock);
     return size;
   } else {
+    /* do not read into the pre-allocated tail of a mapped segment */
+    if (tsf && tsf->wmap && tsf->roff + size > tsf->woff)
+      return 0;
     ret = 0;
     while (size > 0) {
       r = read(tsf ? tsf->rfd : fd, buf, size);
@@ -275,6 +324,36 @@ static int64_t _timeshift_first_time
   return ret;
 }
 
+/*
+ * Binary search the per-segment sorted index: last frame with
+ * time <= req_time (back) or first frame with time >= req_time (forward);
+ * NULL when the segment holds no such frame
+ */
+static timeshift_index_iframe_t *_timeshift_index_search
+  ( timeshift_file_t *tsf, int64_t req_time, int back )
+{
+  timeshift_index_iframe_t **idx = tsf->iframe_idx;
+  timeshift_index_iframe_t *tsi = NULL;
+  int lo = 0, hi = tsf->iframe_count - 1, mid;
+
+  while (lo <= hi) {
+    mid = (lo + hi) / 2;
+    if (back ? idx[mid]->time <= req_time : idx[mid]->time >= req_time) {
+      tsi = idx[mid];
+      if (back)
+        lo = mid + 1;
+      else
+        hi = mid - 1;
+    } else {
+      if (back)
+        hi = mid - 1;
+      else
+        lo = mid + 1;
+    }
+  }
+  return tsi;
+}
+
 static int _timeshift_skip
   ( timeshift_t *ts, int64_t req_time, int64_t cur_time,
     timeshift_seek_t *seek, timeshift_seek_t *nseek )
@@ -303,21 +382,21 @@ static int _timeshift_skip
     }
   }
 
-  /* Fine search */
+  /* Fine search (binary search within each segment) */
   if (back) {
     while (!end && tsf && tsi && (tsi->time > req_time)) {
-      tsi = TAILQ_PREV(tsi, timeshift_index_iframe_list, link);
+      tsi = _timeshift_index_search(tsf, req_time, 1);
       while (!end && tsf && !tsi) {
         if ((tsf = timeshift_filemgr_prev(tsf, &end, 1)))
-          tsi = TAILQ_LAST(&tsf->iframes, timeshift_index_iframe_list);
+          tsi = _timeshift_index_search(tsf, req_time, 1);
       }
     }
   } else {
     while (!end && tsf && tsi && (tsi->time < req_time)) {
-      tsi = TAILQ_NEXT(tsi, link);
+      tsi = _timeshift_index_search(tsf, req_time, 0);
       while (!end && tsf && !tsi) {
         if ((tsf = timeshift_filemgr_next(tsf, &end, 0)))
-          tsi = TAILQ_FIRST(&tsf->iframes);
+          tsi = _timeshift_index_search(tsf, req_time, 0);
       }
     }
   }
@@ -417,14 +496,19 @@ static int _timeshift_read
 
   if (tsf) {
 
+    /* Inflate a compressed RAM segment before use */
+    if (tsf->zram && timeshift_filemgr_uncompress(tsf) < 0)
+      return -1;
+
     /* Open file */
     if (tsf->rfd < 0 && !tsf->ram) {
       tsf->rfd = tvh_open(tsf->path, O_RDONLY, 0);
       tvhtrace(LS_TIMESHIFT, "ts %d open file %s (fd %i)", ts->id, tsf->path, tsf->rfd);
       if (tsf->rfd < 0)
         return -1;
+      _read_map(tsf);
     }
-    if (tsf->rfd >= 0)
+    if (tsf->rfd >= 0 && !tsf->rmap)
       if ((off = lseek(tsf->rfd, tsf->roff, SEEK_SET)) != tsf->roff)
         tvherror(LS_TIMESHIFT, "ts %d seek to %s failed (off %"PRId64" != %"PRId64"): %s",
                  ts->id, tsf->path, (int64_t)tsf->roff, (int64_t)off, strerror(errno));
@@ -24,6 +24,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -54,6 +55,41 @@ static ssize_t _write_fd
   return count == n ? n : -1;
 }
 
+/*
+ * Append into the writer's shared mapping, growing the backing file in
+ * TIMESHIFT_MAP_CHUNK steps; falls back to write() for the rest of the
+ * segment when the mapping cannot be grown
+ */
+static ssize_t _write_map
+  ( timeshift_file_t *tsf, const void *buf, size_t count )
+{
+  uint8_t *map;
+  size_t size;
+
+  if (tsf->woff + count > tsf->wmap_size) {
+    size = tsf->woff + count + TIMESHIFT_MAP_CHUNK - 1;
+    size -= size % TIMESHIFT_MAP_CHUNK;
+    msync(tsf->wmap, tsf->woff, MS_ASYNC);
+    munmap(tsf->wmap, tsf->wmap_size);
+    tsf->wmap = NULL;
+    if (ftruncate(tsf->wfd, size) < 0 ||
+        (map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    tsf->wfd, 0)) == MAP_FAILED) {
+      tvhwarn(LS_TIMESHIFT, "unable to grow mapped segment (err=%s)",
+              strerror(errno));
+      tsf->wmap_size = 0;
+      if (ftruncate(tsf->wfd, tsf->woff) < 0 ||
+          lseek(tsf->wfd, tsf->woff, SEEK_SET) != tsf->woff)
+        return -1;
+      return _write_fd(tsf->wfd, buf, count);
+    }
+    tsf->wmap = map;
+    tsf->wmap_size = size;
+  }
+  memcpy(tsf->wmap + tsf->woff, buf, count);
+  return count;
+}
+
 static ssize_t _write
   ( timeshift_file_t *tsf, const void *buf, size_t count )
 {
@@ -82,7 +118,10 @@ static ssize_t _write
     tvh_mutex_unlock(&tsf->ram_lock);
     return count;
   }
-  ret = _write_fd(tsf->wfd, buf, count);
+  if (tsf->wmap)
+    ret = _write_map(tsf, buf, count);
+  else
+    ret = _write_fd(tsf->wfd, buf, count);
   if (ret > 0)
     tsf->woff += ret;
   return ret;
@@ -290,6 +329,13 @@ static void add_frame_to_index ( timeshift_t *ts, timeshift_file_t *tsf, streami
       ti->pos  = tsf->size;
       ti->time = sm->sm_time;
       TAILQ_INSERT_TAIL(&tsf->iframes, ti, link);
+      /* frame times are monotonic, so appending keeps the array sorted */
+      if (tsf->iframe_count >= tsf->iframe_alloc) {
+        tsf->iframe_alloc = MAX(64, tsf->iframe_alloc * 2);
+        tsf->iframe_idx = realloc(tsf->iframe_idx,
+                                  tsf->iframe_alloc * sizeof(*tsf->iframe_idx));
+      }
+      tsf->iframe_idx[tsf->iframe_count++] = ti;
       if(ts->vididx == -1)
         ts->audio_packet_counter = 0;
     }
@@ -20,6 +20,8 @@
 #include <stdio.h>
 #include "tvhlog.h"
 #include "clock.h"
+#include "htsmsg.h"
+#include "htsmsg_json.h"
 #include "tprofile.h"
 
 int tprofile_running;
@@ -98,6 +100,37 @@ tprofile_avg_update(tprofile_avg_t *tpa, uint64_t val)
   tpa->count++;
 }
 
+/* the monotonic clock resolution is one microsecond, so the duration
+   maps onto the histogram with a plain bit scan */
+void
+tprofile_hist_update(tprofile_hist_t *hist, uint64_t us)
+{
+  int b = 0;
+  while (us > 1 && b < TPROFILE_HIST_BUCKETS - 1) {
+    us >>= 1;
+    b++;
+  }
+  hist->buckets[b]++;
+}
+
+/* upper bound (in microseconds) of the bucket holding the pct-th
+   percentile sample */
+uint64_t
+tprofile_hist_percentile(const tprofile_hist_t *hist, uint64_t total, int pct)
+{
+  uint64_t limit = (total * pct + 99) / 100, sum = 0;
+  int b;
+
+  if (total == 0)
+    return 0;
+  for (b = 0; b < TPROFILE_HIST_BUCKETS; b++) {
+    sum += hist->buckets[b];
+    if (sum >= limit)
+      return (uint64_t)2 << b;
+  }
+  return (uint64_t)2 << (TPROFILE_HIST_BUCKETS - 1);
+}
+
 void tprofile_finish1(tprofile_t *tprof)
 {
   if (tprof->start) {
@@ -108,6 +141,7 @@ void tprofile_finish1(tprofile_t *tprof)
     if (diff > tprof->tmax.t)
       tprofile_time_replace(&tprof->tmax, tprof->start_id, diff);
     tprofile_avg_update(&tprof->tavg, diff);
+    tprofile_hist_update(&tprof->thist, diff);
     free(tprof->start_id);
     tprof->start_id = NULL;
     tprof->start = 0;
@@ -265,9 +299,66 @@ void tprofile_log_stats1(void)
   qprofile_log_qstats();
 }
 
+htsmsg_t *tprofile_get_stats(void)
+{
+  htsmsg_t *m, *l, *e, *h;
+  tprofile_t *tprof;
+  qprofile_t *qprof;
+  int b;
+
+  m = htsmsg_create_map();
+
+  l = htsmsg_create_list();
+  tvh_mutex_lock(&tprofile_mutex);
+  LIST_FOREACH(tprof, &tprofile_all, link) {
+    e = htsmsg_create_map();
+    htsmsg_add_str(e, "name", tprof->name);
+    htsmsg_add_s64(e, "count", tprof->tavg.count);
+    htsmsg_add_s64(e, "avg_us", tprof->tavg.avg);
+    htsmsg_add_s64(e, "max_us", tprof->tmax.t);
+    if (tprof->tmax.id)
+      htsmsg_add_str(e, "max_id", tprof->tmax.id);
+    htsmsg_add_s64(e, "p50_us",
+                   tprofile_hist_percentile(&tprof->thist, tprof->tavg.count, 50));
+    htsmsg_add_s64(e, "p90_us",
+                   tprofile_hist_percentile(&tprof->thist, tprof->tavg.count, 90));
+    htsmsg_add_s64(e, "p99_us",
+                   tprofile_hist_percentile(&tprof->thist, tprof->tavg.count, 99));
+    h = htsmsg_create_list();
+    for (b = 0; b < TPROFILE_HIST_BUCKETS; b++)
+      htsmsg_add_u32(h, NULL, tprof->thist.buckets[b]);
+    htsmsg_add_msg(e, "hist", h);
+    htsmsg_add_msg(l, NULL, e);
+  }
+  tvh_mutex_unlock(&tprofile_mutex);
+  htsmsg_add_msg(m, "timers", l);
+
+  l = htsmsg_create_list();
+  tvh_mutex_lock(&qprofile_mutex);
+  LIST_FOREACH(qprof, &qprofile_all, link) {
+    e = htsmsg_create_map();
+    htsmsg_add_str(e, "name", qprof->name);
+    htsmsg_add_s64(e, "count", qprof->qavg.count);
+    htsmsg_add_s64(e, "avg", qprof->qavg.avg);
+    htsmsg_add_s64(e, "max", qprof->qmax.pos);
+    if (qprof->qmax.id)
+      htsmsg_add_str(e, "max_id", qprof->qmax.id);
+    htsmsg_add_s64(e, "drop_bytes", qprof->qdrop);
+    htsmsg_add_s64(e, "drop_count", qprof->qdropcnt);
+    htsmsg_add_msg(l, NULL, e);
+  }
+  tvh_mutex_unlock(&qprofile_mutex);
+  htsmsg_add_msg(m, "queues", l);
+
+  return m;
+}
+
 char *tprofile_get_json_stats(void)
 {
-  return NULL;
+  htsmsg_t *m = tprofile_get_stats();
+  char *s = htsmsg_json_serialize_to_str(m, 0);
+  htsmsg_destroy(m);
+  return s;
 }
 
 void tprofile_module_init(int enable)
@@ -35,6 +35,23 @@ struct tprofile_avg {
   uint64_t avg;
 };
 
+/*
+ * Log2 latency histogram - bucket N counts durations in
+ * [2^N, 2^(N+1)) microseconds (bucket 0 catches everything below
+ * 2us); 24 buckets cover up to ~8 seconds, enough for any hot path.
+ * Percentiles are derived from the bucket counts, so a probe costs
+ * one increment on top of the existing average/maximum bookkeeping.
+ */
+#define TPROFILE_HIST_BUCKETS 24
+
+typedef struct tprofile_hist {
+  uint32_t buckets[TPROFILE_HIST_BUCKETS];
+} tprofile_hist_t;
+
+void tprofile_hist_update(tprofile_hist_t *hist, uint64_t us);
+uint64_t tprofile_hist_percentile(const tprofile_hist_t *hist,
+                                  uint64_t total, int pct);
+
 struct tprofile_time {
   uint64_t t;
   char *id;
@@ -45,6 +62,7 @@ struct tprofile {
   char *name;
   tprofile_time_t tmax;
   tprofile_avg_t tavg;
+  tprofile_hist_t thist;
   uint64_t start;
   char *start_id;
   uint8_t changed;
@@ -109,6 +127,9 @@ void tprofile_log_stats1(void);
 static inline void tprofile_log_stats(void)
   { if (tprofile_running) tprofile_log_stats1(); }
 
+struct htsmsg;
+struct htsmsg *tprofile_get_stats(void);
+
 char *tprofile_get_json_stats(void);
 
 void tprofile_module_init(int enable);
@@ -24,6 +24,154 @@
 #include <libavcodec/avcodec.h>
 
 
+/* recycling arena ========================================================== */
+
+/* payload buffers are bucketed by power-of-two capacity:
+   1 KB (shift 10) .. 2 MB, everything bigger stays unpooled */
+#define ARENA_BUCKET_SHIFT 10
+#define ARENA_BUCKETS      12
+#define ARENA_BUCKET_DEPTH 16
+#define ARENA_FRAME_DEPTH  32
+
+#define ARENA_BUCKET_NONE  (-1)
+
+static struct {
+    tvh_mutex_t mutex;
+    int running;
+    // in-place freelists: the first bytes of an idle buffer hold the link
+    void *buffers[ARENA_BUCKETS];
+    int buffer_depth[ARENA_BUCKETS];
+    AVFrame *frames[ARENA_FRAME_DEPTH];
+    int frame_depth;
+} memarena;
+
+
+static int
+arena_bucket_for(size_t capacity)
+{
+    int bucket;
+
+    for (bucket = 0; bucket < ARENA_BUCKETS; bucket++) {
+        if (capacity <= ((size_t)1 << (ARENA_BUCKET_SHIFT + bucket))) {
+            return bucket;
+        }
+    }
+    return ARENA_BUCKET_NONE;
+}
+
+
+static void
+arena_buffer_free(void *opaque, uint8_t *data)
+{
+    int bucket = (intptr_t)opaque;
+
+    if (bucket != ARENA_BUCKET_NONE) {
+        tvh_mutex_lock(&memarena.mutex);
+        if (memarena.running &&
+            memarena.buffer_depth[bucket] < ARENA_BUCKET_DEPTH) {
+            *(void **)data = memarena.buffers[bucket];
+            memarena.buffers[bucket] = data;
+            memarena.buffer_depth[bucket]++;
+            data = NULL;
+        }
+        tvh_mutex_unlock(&memarena.mutex);
+    }
+    if (data) {
+        av_free(data);
+    }
+}
+
+
+void
+memutils_init(void)
+{
+    tvh_mutex_init(&memarena.mutex, NULL);
+    memarena.running = 1;
+}
+
+
+void
+memutils_done(void)
+{
+    void *data = NULL;
+    int i;
+
+    tvh_mutex_lock(&memarena.mutex);
+    memarena.running = 0;
+    for (i = 0; i < ARENA_BUCKETS; i++) {
+        while ((data = memarena.buffers[i])) {
+            memarena.buffers[i] = *(void **)data;
+            av_free(data);
+        }
+        memarena.buffer_depth[i] = 0;
+    }
+    for (i = 0; i < memarena.frame_depth; i++) {
+        av_frame_free(&memarena.frames[i]);
+    }
+    memarena.frame_depth = 0;
+    tvh_mutex_unlock(&memarena.mutex);
+    tvh_mutex_destroy(&memarena.mutex);
+}
+
+
+AVBufferRef *
+avbuffer_get(size_t size)
+{
+    AVBufferRef *buf = NULL;
+    uint8_t *data = NULL;
+    size_t capacity = size + AV_INPUT_BUFFER_PADDING_SIZE;
+    int bucket = arena_bucket_for(capacity);
+
+    if (bucket != ARENA_BUCKET_NONE) {
+        capacity = (size_t)1 << (ARENA_BUCKET_SHIFT + bucket);
+        tvh_mutex_lock(&memarena.mutex);
+        if (memarena.running && (data = memarena.buffers[bucket])) {
+            memarena.buffers[bucket] = *(void **)data;
+            memarena.buffer_depth[bucket]--;
+        }
+        tvh_mutex_unlock(&memarena.mutex);
+    }
+    if (!data && !(data = av_malloc(capacity))) {
+        return NULL;
+    }
+    if (!(buf = av_buffer_create(data, size, arena_buffer_free,
+                                 (void *)(intptr_t)bucket, 0))) {
+        arena_buffer_free((void *)(intptr_t)bucket, data);
+    }
+    return buf;
+}
+
+
+AVFrame *
+avframe_get(void)
+{
+    AVFrame *frame = NULL;
+
+    tvh_mutex_lock(&memarena.mutex);
+    if (memarena.running && memarena.frame_depth > 0) {
+        frame = memarena.frames[--memarena.frame_depth];
+    }
+    tvh_mutex_unlock(&memarena.mutex);
+    return frame ? frame : av_frame_alloc();
+}
+
+
+void
+avframe_put(AVFrame **frame)
+{
+    if (frame && *frame) {
+        av_frame_unref(*frame);
+        tvh_mutex_lock(&memarena.mutex);
+        if (memarena.running && memarena.frame_depth < ARENA_FRAME_DEPTH) {
+            memarena.frames[memarena.frame_depth++] = *frame;
+            *frame = NULL;
+        }
+        tvh_mutex_unlock(&memarena.mutex);
+        av_frame_free(frame); // no-op when the shell was pooled
+    }
+}
+
+
 static char *
 str_add(const char *sep, const char *str)
 {
@@ -105,11 +253,11 @@ str_snprintf(char *str, size_t size, const char *format, ...)
 
 /* _IMPORTANT!_: need to check for pb->pb_size and pb->pb_data
    _BEFORE_ calling pktbuf_copy_data */
-uint8_t *
+AVBufferRef *
 pktbuf_copy_data(pktbuf_t *pb)
 {
-    uint8_t *data = av_malloc(pb->pb_size + AV_INPUT_BUFFER_PADDING_SIZE);
-    if (data)
-        memcpy(data, pb->pb_data, pb->pb_size);
-    return data;
+    AVBufferRef *buf = avbuffer_get(pb->pb_size);
+    if (buf)
+        memcpy(buf->data, pb->pb_data, pb->pb_size);
+    return buf;
 }
@@ -25,6 +25,9 @@
 #include "tvheadend.h"
 #include "streaming.h"
 
+#include <libavutil/buffer.h>
+#include <libavutil/frame.h>
+
 
 #define TVH_INPUT_BUFFER_MAX_SIZE (INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE)
 
@@ -58,9 +61,30 @@ str_join(const char *separator, ...);
 int
 str_snprintf(char *str, size_t size, const char *format, ...);
 
+/* recycling arena: freelists for AVFrame shells and size-bucketed
+   payload buffers, shared by all transcode sessions; steady-state
+   transcoding recycles instead of hitting the allocator per frame */
+
+void
+memutils_init(void);
+
+void
+memutils_done(void);
+
+/* buffer with at least size + AV_INPUT_BUFFER_PADDING_SIZE bytes,
+   returned to the arena when the last reference is dropped */
+AVBufferRef *
+avbuffer_get(size_t size);
+
+AVFrame *
+avframe_get(void);
+
+void
+avframe_put(AVFrame **frame);
+
 /* _IMPORTANT!_: need to check for pb->pb_size and pb->pb_data
    _BEFORE_ calling pktbuf_copy_data */
-uint8_t *
+AVBufferRef *
 pktbuf_copy_data(pktbuf_t *pb);
 
 #endif // TVH_TRANSCODING_MEMUTILS_H__
@@ -75,10 +75,250 @@ tvh_context_types_register()
 }
 
 
+/* filter graph cache ======================================================= */
+
+/* a configured graph parked by a closing session is handed as-is to the
+   next session built with the identical signature, skipping filter
+   creation and avfilter_graph_config at channel change; hardware graphs
+   are excluded since they hold refs to a session's device context */
+
+#define GRAPH_CACHE_DEPTH 8
+
+typedef struct tvh_graph_cache_entry {
+    TAILQ_ENTRY(tvh_graph_cache_entry) link;
+    char *key;
+    AVFilterGraph *graph;
+    AVFilterContext *source;
+    AVFilterContext *sink;
+} TVHGraphCacheEntry;
+
+TAILQ_HEAD(TVHGraphCache, tvh_graph_cache_entry);
+
+static tvh_mutex_t tvh_graph_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static struct TVHGraphCache tvh_graph_cache =
+    TAILQ_HEAD_INITIALIZER(tvh_graph_cache);
+static int tvh_graph_cache_depth;
+
+
+static void
+tvh_graph_cache_entry_free(TVHGraphCacheEntry *entry)
+{
+    free(entry->key);
+    avfilter_graph_free(&entry->graph); // frees filter contexts
+    free(entry);
+}
+
+
+static AVFilterGraph *
+tvh_graph_cache_get(const char *key,
+                    AVFilterContext **source, AVFilterContext **sink)
+{
+    TVHGraphCacheEntry *entry = NULL;
+    AVFilterGraph *graph = NULL;
+
+    tvh_mutex_lock(&tvh_graph_cache_mutex);
+    TAILQ_FOREACH(entry, &tvh_graph_cache, link) {
+        if (!strcmp(entry->key, key)) {
+            TAILQ_REMOVE(&tvh_graph_cache, entry, link);
+            tvh_graph_cache_depth--;
+            break;
+        }
+    }
+    tvh_mutex_unlock(&tvh_graph_cache_mutex);
+    if (entry) {
+        graph   = entry->graph;
+        *source = entry->source;
+        *sink   = entry->sink;
+        free(entry->key);
+        free(entry);
+    }
+    return graph;
+}
+
+
+static int
+tvh_graph_cache_put(char *key, AVFilterGraph *graph,
+                    AVFilterContext *source, AVFilterContext *sink)
+{
+    TVHGraphCacheEntry *entry = NULL, *oldest = NULL;
+    AVFrame *frame = NULL;
+
+    if (!(entry = calloc(1, sizeof(TVHGraphCacheEntry)))) {
+        return -1;
+    }
+    /* discard frames still buffered in the graph, they belong to the
+       closing session */
+    if ((frame = avframe_get())) {
+        while (av_buffersink_get_frame_flags(sink, frame, 0) >= 0) {
+            av_frame_unref(frame);
+        }
+        avframe_put(&frame);
+    }
+    entry->key    = key;
+    entry->graph  = graph;
+    entry->source = source;
+    entry->sink   = sink;
+    tvh_mutex_lock(&tvh_graph_cache_mutex);
+    TAILQ_INSERT_HEAD(&tvh_graph_cache, entry, link);
+    if (++tvh_graph_cache_depth > GRAPH_CACHE_DEPTH) {
+        oldest = TAILQ_LAST(&tvh_graph_cache, TVHGraphCache);
+        TAILQ_REMOVE(&tvh_graph_cache, oldest, link);
+        tvh_graph_cache_depth--;
+    }
+    tvh_mutex_unlock(&tvh_graph_cache_mutex);
+    if (oldest) {
+        tvh_graph_cache_entry_free(oldest);
+    }
+    return 0;
+}
+
+
+static void
+tvh_graph_cache_flush(void)
+{
+    TVHGraphCacheEntry *entry = NULL;
+
+    tvh_mutex_lock(&tvh_graph_cache_mutex);
+    while ((entry = TAILQ_FIRST(&tvh_graph_cache))) {
+        TAILQ_REMOVE(&tvh_graph_cache, entry, link);
+        tvh_graph_cache_entry_free(entry);
+    }
+    tvh_graph_cache_depth = 0;
+    tvh_mutex_unlock(&tvh_graph_cache_mutex);
+}
+
+
+/* warm decoder cache ======================================================= */
+
+/* an opened software decoder parked by a closing session is reused by the
+   next session with the same codec and extradata, skipping avcodec_open2
+   and the first-keyframe probing at channel change; hardware decoders are
+   excluded since they hold refs to a session's device context */
+
+#define DECODER_CACHE_DEPTH 8
+
+typedef struct tvh_decoder_cache_entry {
+    TAILQ_ENTRY(tvh_decoder_cache_entry) link;
+    char *key;
+    AVCodecContext *avctx;
+} TVHDecoderCacheEntry;
+
+TAILQ_HEAD(TVHDecoderCache, tvh_decoder_cache_entry);
+
+static tvh_mutex_t tvh_decoder_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static struct TVHDecoderCache tvh_decoder_cache =
+    TAILQ_HEAD_INITIALIZER(tvh_decoder_cache);
+static int tvh_decoder_cache_depth;
+
+
+static void
+tvh_decoder_cache_entry_free(TVHDecoderCacheEntry *entry)
+{
+    free(entry->key);
+    avcodec_free_context(&entry->avctx); // frees extradata
+    free(entry);
+}
+
+
+/* codec name and extradata identify the initialized decoder machinery */
+static char *
+_context_decoder_key(const AVCodecContext *avctx)
+{
+    char key[1024];
+    int n, i;
+    size_t off;
+
+    n = snprintf(key, sizeof(key), "%s|", avctx->codec->name);
+    if (n < 0 || n >= sizeof(key)) {
+        return NULL;
+    }
+    off = n;
+    for (i = 0; i < avctx->extradata_size; i++) {
+        n = snprintf(key + off, sizeof(key) - off, "%02x",
+                     avctx->extradata[i]);
+        if (n < 0 || n >= sizeof(key) - off) {
+            return NULL;
+        }
+        off += n;
+    }
+    return strdup(key);
+}
+
+
+static AVCodecContext *
+tvh_decoder_cache_get(const char *key)
+{
+    TVHDecoderCacheEntry *entry = NULL;
+    AVCodecContext *avctx = NULL;
+
+    tvh_mutex_lock(&tvh_decoder_cache_mutex);
+    TAILQ_FOREACH(entry, &tvh_decoder_cache, link) {
+        if (!strcmp(entry->key, key)) {
+            TAILQ_REMOVE(&tvh_decoder_cache, entry, link);
+            tvh_decoder_cache_depth--;
+            break;
+        }
+    }
+    tvh_mutex_unlock(&tvh_decoder_cache_mutex);
+    if (entry) {
+        avctx = entry->avctx;
+        free(entry->key);
+        free(entry);
+    }
+    return avctx;
+}
+
+
+static int
+tvh_decoder_cache_put(char *key, AVCodecContext *avctx)
+{
+    TVHDecoderCacheEntry *entry = NULL, *oldest = NULL;
+
+    if (!(entry = calloc(1, sizeof(TVHDecoderCacheEntry)))) {
+        return -1;
+    }
+    /* drop frames still queued inside the decoder, they belong to the
+       closing session; this also resets the draining state left by the
+       close-time flush */
+    avcodec_flush_buffers(avctx);
+    entry->key   = key;
+    entry->avctx = avctx;
+    tvh_mutex_lock(&tvh_decoder_cache_mutex);
+    TAILQ_INSERT_HEAD(&tvh_decoder_cache, entry, link);
+    if (++tvh_decoder_cache_depth > DECODER_CACHE_DEPTH) {
+        oldest = TAILQ_LAST(&tvh_decoder_cache, TVHDecoderCache);
+        TAILQ_REMOVE(&tvh_decoder_cache, oldest, link);
+        tvh_decoder_cache_depth--;
+    }
+    tvh_mutex_unlock(&tvh_decoder_cache_mutex);
+    if (oldest) {
+        tvh_decoder_cache_entry_free(oldest);
+    }
+    return 0;
+}
+
+
+static void
+tvh_decoder_cache_flush(void)
+{
+    TVHDecoderCacheEntry *entry = NULL;
+
+    tvh_mutex_lock(&tvh_decoder_cache_mutex);
+    while ((entry = TAILQ_FIRST(&tvh_decoder_cache))) {
+        TAILQ_REMOVE(&tvh_decoder_cache, entry, link);
+        tvh_decoder_cache_entry_free(entry);
+    }
+    tvh_decoder_cache_depth = 0;
+    tvh_mutex_unlock(&tvh_decoder_cache_mutex);
+}
+
+
 void
 tvh_context_types_forget()
 {
     tvhinfo(LS_TRANSCODE, "forgetting context types");
+    tvh_graph_cache_flush();
+    tvh_decoder_cache_flush();
     while (!SLIST_EMPTY(&tvh_context_types)) {
         SLIST_REMOVE_HEAD(&tvh_context_types, link);
     }
@@ -163,6 +403,65 @@ _context_filters_apply_sink_options(TVHContext *self, va_list ap)
 }
 
 
+/* full build signature of a graph: endpoints, filter chain and the raw
+   sink option values; mirrors the vararg layout consumed by
+   _context_filters_apply_sink_options */
+static char *
+_context_filters_graph_key(const char *source_name, const char *source_args,
+                           const char *filters, const char *sink_name,
+                           va_list ap)
+{
+    char key[1024];
+    const char *opt_name = NULL;
+    const uint8_t *opt_val = NULL;
+    int opt_size = 0, n, i;
+    size_t off = 0;
+
+    n = snprintf(key, sizeof(key), "%s|%s|%s|%s",
+                 source_name, source_args, filters, sink_name);
+    if (n < 0 || n >= sizeof(key)) {
+        return NULL;
+    }
+    off = n;
+    while ((opt_name = va_arg(ap, const char *))) {
+#if LIBAVCODEC_VERSION_MAJOR > 59
+        av_opt_set_type opt_type = (av_opt_set_type)va_arg(ap, int);
+        opt_size = va_arg(ap, int);
+        if (opt_type == AV_OPT_SET_STRING) {
+            const char *opt_str = va_arg(ap, const char *);
+            n = snprintf(key + off, sizeof(key) - off, "|%s=%s",
+                         opt_name, opt_str ? opt_str : "");
+            if (n < 0 || n >= sizeof(key) - off) {
+                return NULL;
+            }
+            off += n;
+            continue;
+        }
+        if (opt_type != AV_OPT_SET_BIN) {
+            return NULL;
+        }
+        opt_val = va_arg(ap, const uint8_t *);
+#else
+        opt_val = va_arg(ap, const uint8_t *);
+        opt_size = va_arg(ap, int);
+#endif
+        n = snprintf(key + off, sizeof(key) - off, "|%s=", opt_name);
+        if (n < 0 || n >= sizeof(key) - off) {
+            return NULL;
+        }
+        off += n;
+        for (i = 0; i < opt_size; i++) {
+            n = snprintf(key + off, sizeof(key) - off, "%02x", opt_val[i]);
+            if (n < 0 || n >= sizeof(key) - off) {
+                return NULL;
+            }
+            off += n;
+        }
+    }
+    return strdup(key);
+}
+
+
 static int
 _context_open(TVHContext *self, TVHOpenPhase phase, AVDictionary **opts)
 {
@@ -248,8 +547,8 @@ tvh_context_setup(TVHContext *self, const AVCodec *iavcodec, const AVCodec *oavc
     }
     if (!(self->iavctx = tvh_context_alloc_avctx(self, iavcodec)) ||
         !(self->oavctx = tvh_context_alloc_avctx(self, oavcodec)) ||
-        !(self->iavframe = av_frame_alloc()) ||
-        !(self->oavframe = av_frame_alloc())) {
+        !(self->iavframe = avframe_get()) ||
+        !(self->oavframe = avframe_get())) {
         tvh_stream_log(self->stream, LOG_ERR,
                        "failed to allocate AVCodecContext/AVFrame");
         return -1;
@@ -260,6 +559,33 @@ tvh_context_setup(TVHContext *self, const AVCodec *iavcodec, const AVCodec *oavc
 
 // open
 
+/* swap the freshly configured decoder for a warm one from the cache; at
+   this point the fresh context only carries codec, extradata and
+   time_base, all of which the cached context was parked with */
+static int
+_context_decoder_reuse(TVHContext *self)
+{
+    AVCodecContext *avctx = self->iavctx, *warm = NULL;
+    char *key = NULL;
+
+    /* hardware decoders hold refs to this session's device context and
+       cannot be shared */
+    if (avctx->hw_device_ctx || avctx->hw_frames_ctx ||
+        avctx->get_format != avcodec_default_get_format ||
+        !(key = _context_decoder_key(avctx))) {
+        return 0;
+    }
+    if ((warm = tvh_decoder_cache_get(key))) {
+        warm->opaque = self;
+        avcodec_free_context(&self->iavctx); // frees extradata
+        self->iavctx = warm;
+        tvh_context_log(self, LOG_DEBUG, "reusing warm decoder");
+    }
+    self->iavctx_key = key; // makes the decoder cacheable on close
+    return warm != NULL;
+}
+
+
 static int
 tvh_context_open(TVHContext *self, TVHOpenPhase phase)
 {
@@ -296,9 +622,13 @@ tvh_context_open(TVHContext *self, TVHOpenPhase phase)
         ret = tvh_context_get_int_opt(&opts, "tvh_require_meta",
                                       &self->require_meta);
         if (!ret && !(ret = _context_open(self, phase, &opts)) && // pre open
-            !(ret = (helper && helper->open) ? helper->open(self, &opts) : 0) && // pre open
-            !(ret = avcodec_open2(avctx, NULL, &opts))) { // open
-            ret = _context_open(self, phase + 1, &opts); // post open
+            !(ret = (helper && helper->open) ? helper->open(self, &opts) : 0)) { // pre open
+            if (phase == OPEN_DECODER && _context_decoder_reuse(self)) {
+                ret = _context_open(self, phase + 1, &opts); // post open
+            }
+            else if (!(ret = avcodec_open2(avctx, NULL, &opts))) { // open
+                ret = _context_open(self, phase + 1, &opts); // post open
+            }
         }
         _context_print_opts(self, opts);
     }
@@ -552,11 +882,30 @@ tvh_context_open_filters(TVHContext *self,
     const AVFilter *iavflt = NULL, *oavflt = NULL;
     AVFilterInOut *iavfltio = NULL, *oavfltio = NULL;
     AVBufferSrcParameters *par = NULL;
+    char *key = NULL;
+    va_list ap;
     int i, ret = -1;
 
     tvh_context_log(self, LOG_DEBUG, "filters: source args: '%s'", source_args);
     tvh_context_log(self, LOG_DEBUG, "filters: filters: '%s'", filters);
 
+    // hardware graphs hold refs to this session's device context and
+    // cannot be shared
+    if (!self->iavctx->hw_frames_ctx && !self->iavctx->hw_device_ctx &&
+        !self->hw_device_octx) {
+        va_start(ap, sink_name);
+        key = _context_filters_graph_key(source_name, source_args,
+                                         filters, sink_name, ap);
+        va_end(ap);
+    }
+    if (key &&
+        (self->avfltgraph = tvh_graph_cache_get(key, &self->iavfltctx,
+                                                &self->oavfltctx))) {
+        tvh_context_log(self, LOG_DEBUG, "filters: reusing cached graph");
+        self->avfltgraph_key = key;
+        return 0;
+    }
+
     if (!(self->avfltgraph = avfilter_graph_alloc()) ||
         !(iavfltio = avfilter_inout_alloc()) ||
         !(oavfltio = avfilter_inout_alloc()) ||
@@ -607,7 +956,6 @@ tvh_context_open_filters(TVHContext *self,
     }
 
     // sink options
-    va_list ap;
     va_start(ap, sink_name);
     ret = _context_filters_apply_sink_options(self, ap);
     va_end(ap);
@@ -641,12 +989,19 @@ tvh_context_open_filters(TVHContext *self,
     }
 
     // additional filtergraph params
-    if (!strcmp("buffer", source_name) && self->hw_device_octx) {
-        for (i = 0; i < self->avfltgraph->nb_filters; i++) {
-            if (!(self->avfltgraph->filters[i]->hw_device_ctx =
-                      av_buffer_ref(self->hw_device_octx))) {
-                ret = -1;
-                goto finish;
+    if (!strcmp("buffer", source_name)) {
+        // sw->hw uses the encoder's own device; hw->hw shares the decoder's
+        // device so the hw filters (and any auto-inserted converters) run on
+        // the same GPU without a system memory round trip
+        AVBufferRef *hw_device = self->hw_device_octx ?:
+                                 self->iavctx->hw_device_ctx;
+        if (hw_device) {
+            for (i = 0; i < self->avfltgraph->nb_filters; i++) {
+                if (!(self->avfltgraph->filters[i]->hw_device_ctx =
+                          av_buffer_ref(hw_device))) {
+                    ret = -1;
+                    goto finish;
+                }
             }
         }
     }
@@ -680,6 +1035,11 @@ finish:
     if (oavfltio) {
         avfilter_inout_free(&oavfltio);
     }
+    if (ret >= 0) {
+        self->avfltgraph_key = key; // makes the graph cacheable on close
+    } else {
+        str_clear(key);
+    }
     return (ret > 0) ? 0 : ret;
 }
 
@@ -695,7 +1055,7 @@ int
 tvh_context_handle(TVHContext *self, th_pkt_t *pkt)
 {
     int ret = 0;
-    uint8_t *data = NULL;
+    AVBufferRef *buf = NULL;
     size_t size = 0;
     AVPacket avpkt;
 
@@ -704,7 +1064,7 @@ tvh_context_handle(TVHContext *self, th_pkt_t *pkt)
             tvh_context_log(self, LOG_ERR, "packet payload too big");
             ret = AVERROR(EOVERFLOW);
         }
-        else if (!(data = pktbuf_copy_data(pkt->pkt_payload))) {
+        else if (!(buf = pktbuf_copy_data(pkt->pkt_payload))) {
             tvh_context_log(self, LOG_ERR, "failed to copy packet payload");
             ret = AVERROR(ENOMEM);
         }
@@ -713,23 +1073,19 @@ tvh_context_handle(TVHContext *self, th_pkt_t *pkt)
             avpkt.pts = AV_NOPTS_VALUE;
             avpkt.dts = AV_NOPTS_VALUE;
             avpkt.pos = -1;
-            if ((ret = av_packet_from_data(&avpkt, data, size))) { // takes ownership of data
-                tvh_context_log(self, LOG_ERR,
-                                "failed to allocate AVPacket buffer");
-                av_freep(data);
-            }
-            else {
-                if (!self->input_gh && pkt->pkt_meta) {
-                    pktbuf_ref_inc(pkt->pkt_meta);
-                    self->input_gh = pkt->pkt_meta;
-                }
-                avpkt.pts = pkt->pkt_pts;
-                avpkt.dts = pkt->pkt_dts;
-                avpkt.duration = pkt->pkt_duration;
-                TVHPKT_SET(self->src_pkt, pkt);
-                ret = tvh_context_decode(self, &avpkt);
-                av_packet_unref(&avpkt); // will free data
+            avpkt.buf = buf;
+            avpkt.data = buf->data;
+            avpkt.size = size;
+            if (!self->input_gh && pkt->pkt_meta) {
+                pktbuf_ref_inc(pkt->pkt_meta);
+                self->input_gh = pkt->pkt_meta;
             }
+            avpkt.pts = pkt->pkt_pts;
+            avpkt.dts = pkt->pkt_dts;
+            avpkt.duration = pkt->pkt_duration;
+            TVHPKT_SET(self->src_pkt, pkt);
+            ret = tvh_context_decode(self, &avpkt);
+            av_packet_unref(&avpkt); // returns the buffer to the arena
         }
     }
     return ret;
@@ -766,11 +1122,18 @@ tvh_context_destroy(TVHContext *self)
     if (self) {
         TVHPKT_CLEAR(self->src_pkt);
         if (self->avfltgraph) {
-            avfilter_graph_free(&self->avfltgraph); // frees filter contexts
+            if (self->avfltgraph_key &&
+                !tvh_graph_cache_put(self->avfltgraph_key, self->avfltgraph,
+                                     self->iavfltctx, self->oavfltctx)) {
+                self->avfltgraph_key = NULL; // owned by the cache now
+            } else {
+                avfilter_graph_free(&self->avfltgraph); // frees filter contexts
+            }
             self->oavfltctx = NULL;
             self->iavfltctx = NULL;
             self->avfltgraph = NULL;
         }
+        str_clear(self->avfltgraph_key);
         if (self->helper) {
             self->helper = NULL;
         }
@@ -779,11 +1142,11 @@ tvh_context_destroy(TVHContext *self)
             self->input_gh = NULL;
         }
         if (self->oavframe) {
-            av_frame_free(&self->oavframe);
+            avframe_put(&self->oavframe);
             self->oavframe = NULL;
         }
         if (self->iavframe) {
-            av_frame_free(&self->iavframe);
+            avframe_put(&self->iavframe);
             self->iavframe = NULL;
         }
         if (self->oavctx) {
@@ -791,9 +1154,17 @@ tvh_context_destroy(TVHContext *self)
             self->oavctx = NULL;
         }
         if (self->iavctx) {
-            avcodec_free_context(&self->iavctx);
-            self->iavctx = NULL;
+            self->iavctx->opaque = NULL;
+            if (self->iavctx_key && avcodec_is_open(self->iavctx) &&
+                !tvh_decoder_cache_put(self->iavctx_key, self->iavctx)) {
+                self->iavctx_key = NULL; // owned by the cache now
+                self->iavctx = NULL;     // ditto
+            } else {
+                avcodec_free_context(&self->iavctx);
+                self->iavctx = NULL;
+            }
         }
+        str_clear(self->iavctx_key);
         self->type = NULL;
         self->profile = NULL;
         self->stream = NULL;
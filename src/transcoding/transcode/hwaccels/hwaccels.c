@@ -24,6 +24,7 @@
 #include "vaapi.h"
 #endif
 
+#include <libavutil/hwcontext.h>
 #include <libavutil/pixdesc.h>
 
 
@@ -216,14 +217,48 @@ hwaccels_get_sharpness_filter(AVCodecContext *avctx, int value, char *filter, si
 int
 hwaccels_initialize_encoder_from_decoder(const AVCodecContext *iavctx, AVCodecContext *oavctx)
 {
+    AVBufferRef *hw_frames_ref = NULL;
+    AVHWFramesContext *iframes = NULL, *oframes = NULL;
+    int ret;
+
     switch (iavctx->pix_fmt) {
         case AV_PIX_FMT_VAAPI:
-            /* we need to ref hw_frames_ctx of decoder to initialize encoder's codec.
-            Only after we get a decoded frame, can we obtain its hw_frames_ctx */
-            oavctx->hw_frames_ctx = av_buffer_ref(iavctx->hw_frames_ctx);
-            if (!oavctx->hw_frames_ctx) {
+            /* we need a hw_frames_ctx to initialize encoder's codec.
+            Only after we get a decoded frame, can we obtain the decoder's one */
+            if (!iavctx->hw_frames_ctx) {
+                return AVERROR(EINVAL);
+            }
+            if (iavctx->width == oavctx->width &&
+                iavctx->height == oavctx->height) {
+                /* same geometry: share the decoder's surface pool directly,
+                frames stay on the GPU end-to-end */
+                oavctx->hw_frames_ctx = av_buffer_ref(iavctx->hw_frames_ctx);
+                if (!oavctx->hw_frames_ctx) {
+                    return AVERROR(ENOMEM);
+                }
+                return 0;
+            }
+            /* geometry differs (hw scaler/deinterlacer runs between the two):
+            allocate a pool with the encoder geometry on the decoder's device
+            so the filtered frames still never leave the GPU */
+            iframes = (AVHWFramesContext *)iavctx->hw_frames_ctx->data;
+            if (!(hw_frames_ref = av_hwframe_ctx_alloc(iframes->device_ref))) {
                 return AVERROR(ENOMEM);
             }
+            oframes = (AVHWFramesContext *)hw_frames_ref->data;
+            oframes->format    = AV_PIX_FMT_VAAPI;
+            oframes->sw_format = iframes->sw_format;
+            oframes->width     = oavctx->width;
+            oframes->height    = oavctx->height;
+            oframes->initial_pool_size = 20;
+            if ((ret = av_hwframe_ctx_init(hw_frames_ref)) < 0) {
+                tvherror(LS_TRANSCODE,
+                         "hwaccels: failed to initialize encoder frame pool: %s",
+                         av_err2str(ret));
+                av_buffer_unref(&hw_frames_ref);
+                return ret;
+            }
+            oavctx->hw_frames_ctx = hw_frames_ref;
             return 0;
         case AV_PIX_FMT_YUV420P:
             break;
@@ -74,6 +74,9 @@ struct tvh_transcoder {
     struct TVHStreams streams;
     uint32_t id;
     tvh_st_t *output;
+    // stream workers deliver concurrently, the downstream target expects
+    // a single delivering thread
+    tvh_mutex_t output_mutex;
     TVHCodecProfile *profiles[AVMEDIA_TYPE_NB];
     char *src_codecs[AVMEDIA_TYPE_NB];
 };
@@ -92,6 +95,18 @@ tvh_transcoder_destroy(TVHTranscoder *self);
 
 /* TVHStream ================================================================ */
 
+// bound for the per-stream worker queue; when the encoder can't keep up,
+// additional input packets are dropped instead of backing up the
+// delivering thread
+#define TVH_STREAM_QUEUE_LIMIT 128
+
+typedef struct tvh_stream_queue_item {
+    TAILQ_ENTRY(tvh_stream_queue_item) link;
+    th_pkt_t *pkt;
+} TVHStreamQueueItem;
+
+TAILQ_HEAD(TVHStreamQueue, tvh_stream_queue_item);
+
 struct tvh_stream {
     TVHTranscoder *transcoder;
     int id;
@@ -99,6 +114,17 @@ struct tvh_stream {
     tvh_sct_t type;
     TVHContext *context;
     int is_copy;
+    // worker pipeline: the delivering thread only enqueues, decode/filter/
+    // encode run on a per-stream thread so the streams of one session
+    // overlap on multi-core boxes
+    pthread_t worker;
+    int worker_started;
+    tvh_mutex_t queue_mutex;
+    tvh_cond_t queue_cond;
+    struct TVHStreamQueue queue;
+    int queue_size;
+    int queue_run;
+    tvhlog_limit_t queue_loglimit;
     SLIST_ENTRY(tvh_stream) link;
 };
 
@@ -108,6 +134,9 @@ tvh_stream_stop(TVHStream *self, int flush);
 int
 tvh_stream_handle(TVHStream *self, th_pkt_t *pkt);
 
+void
+tvh_stream_dispatch(TVHStream *self, th_pkt_t *pkt);
+
 int
 tvh_stream_deliver(TVHStream *self, th_pkt_t *pkt);
 
@@ -161,6 +190,8 @@ struct tvh_context {
     AVFilterGraph *avfltgraph;
     AVFilterContext *iavfltctx;
     AVFilterContext *oavfltctx;
+    char *avfltgraph_key; // build signature, set when the graph is shareable
+    char *iavctx_key; // decoder signature, set when the decoder is shareable
     th_pkt_t *src_pkt;
     int require_meta;
     int64_t pts;
@@ -49,6 +49,7 @@ transcoder_destroy(streaming_target_t *st)
 void
 transcode_init()
 {
+    memutils_init();
     tvh_context_types_register();
     tvh_context_helpers_register();
 #if ENABLE_HWACCELS
@@ -64,4 +65,5 @@ transcode_done()
 #endif
     tvh_context_helpers_forget();
     tvh_context_types_forget();
+    memutils_done();
 }
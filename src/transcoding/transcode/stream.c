@@ -150,11 +150,83 @@ tvh_stream_setup(TVHStream *self, TVHCodecProfile *profile, tvh_ssc_t *ssc)
 }
 
 
+static void
+tvh_stream_process(TVHStream *self, th_pkt_t *pkt)
+{
+    char averr_buf[256];
+    int err;
+
+    if ((err = tvh_stream_handle(self, pkt))) {
+        tvh_stream_stop(self, 0);
+        if (av_strerror(err, averr_buf, sizeof(averr_buf)) < 0) {
+            snprintf(averr_buf, sizeof(averr_buf), "unknown error");
+        }
+        tvh_context_log(self->context, LOG_WARNING,
+                        "failed to transcode packet at pts: %"PRId64" error %d: %s",
+                        pkt->pkt_pts, err, averr_buf);
+        if (tvhtrace_enabled()) {
+            pkt_trace(LS_TRANSCODE, pkt, "packet details");
+        }
+    }
+}
+
+
+static void *
+tvh_stream_worker(void *aux)
+{
+    TVHStream *self = aux;
+    TVHStreamQueueItem *item = NULL;
+
+    tvh_mutex_lock(&self->queue_mutex);
+    while (self->queue_run) {
+        if (!(item = TAILQ_FIRST(&self->queue))) {
+            tvh_cond_wait(&self->queue_cond, &self->queue_mutex);
+            continue;
+        }
+        TAILQ_REMOVE(&self->queue, item, link);
+        self->queue_size--;
+        tvh_mutex_unlock(&self->queue_mutex);
+        tvh_stream_process(self, item->pkt);
+        pkt_ref_dec(item->pkt);
+        free(item);
+        tvh_mutex_lock(&self->queue_mutex);
+    }
+    while ((item = TAILQ_FIRST(&self->queue)) != NULL) {
+        TAILQ_REMOVE(&self->queue, item, link);
+        self->queue_size--;
+        pkt_ref_dec(item->pkt);
+        free(item);
+    }
+    tvh_mutex_unlock(&self->queue_mutex);
+    return NULL;
+}
+
+
+static void
+tvh_stream_worker_stop(TVHStream *self)
+{
+    if (!self->worker_started) {
+        return;
+    }
+    tvh_mutex_lock(&self->queue_mutex);
+    self->queue_run = 0;
+    tvh_cond_signal(&self->queue_cond, 0);
+    tvh_mutex_unlock(&self->queue_mutex);
+    if (pthread_equal(pthread_self(), self->worker)) {
+        // error path inside the worker itself, joined on the next stop
+        return;
+    }
+    pthread_join(self->worker, NULL);
+    self->worker_started = 0;
+}
+
+
 /* exposed */
 
 void
 tvh_stream_stop(TVHStream *self, int flush)
 {
+    tvh_stream_worker_stop(self);
     if (self->index >= 0) {
         if (self->context) {
             tvh_context_close(self->context, flush);
@@ -164,6 +236,42 @@ tvh_stream_stop(TVHStream *self, int flush)
 }
 
 
+void
+tvh_stream_dispatch(TVHStream *self, th_pkt_t *pkt)
+{
+    TVHStreamQueueItem *item = NULL;
+
+    if (!self->worker_started) {
+        tvh_stream_process(self, pkt);
+        return;
+    }
+    tvh_mutex_lock(&self->queue_mutex);
+    if (!self->queue_run) {
+        tvh_mutex_unlock(&self->queue_mutex);
+        return;
+    }
+    if (self->queue_size >= TVH_STREAM_QUEUE_LIMIT) {
+        tvh_mutex_unlock(&self->queue_mutex);
+        if (tvhlog_limit(&self->queue_loglimit, 10)) {
+            tvh_stream_log(self, LOG_WARNING,
+                           "worker queue full (%d packets), dropping packet",
+                           TVH_STREAM_QUEUE_LIMIT);
+        }
+        return;
+    }
+    if (!(item = malloc(sizeof(*item)))) {
+        tvh_mutex_unlock(&self->queue_mutex);
+        return;
+    }
+    pkt_ref_inc(pkt);
+    item->pkt = pkt;
+    TAILQ_INSERT_TAIL(&self->queue, item, link);
+    self->queue_size++;
+    tvh_cond_signal(&self->queue_cond, 0);
+    tvh_mutex_unlock(&self->queue_mutex);
+}
+
+
 int
 tvh_stream_handle(TVHStream *self, th_pkt_t *pkt)
 {
@@ -197,6 +305,9 @@ tvh_stream_create(TVHTranscoder *transcoder, TVHCodecProfile *profile,
     self->transcoder = transcoder;
     self->id = self->index = ssc->es_index;
     self->type = ssc->es_type;
+    tvh_mutex_init(&self->queue_mutex, NULL);
+    tvh_cond_init(&self->queue_cond, 1);
+    TAILQ_INIT(&self->queue);
     if ((is_copy = tvh_stream_is_copy(profile, ssc, src_codecs)) > 0) {
         self->is_copy = 1;
         if (ssc->ssc_gh) {
@@ -207,6 +318,18 @@ tvh_stream_create(TVHTranscoder *transcoder, TVHCodecProfile *profile,
         tvh_stream_destroy(self);
         return NULL;
     }
+    if (self->context) {
+        self->queue_run = 1;
+        if (tvh_thread_create(&self->worker, NULL, tvh_stream_worker, self,
+                              "transcode")) {
+            tvh_stream_log(self, LOG_WARNING,
+                           "failed to create worker, using the delivering thread");
+            self->queue_run = 0;
+        }
+        else {
+            self->worker_started = 1;
+        }
+    }
     return self;
 }
 
@@ -216,6 +339,8 @@ tvh_stream_destroy(TVHStream *self)
 {
     if (self) {
         tvh_stream_stop(self, 0);
+        tvh_cond_destroy(&self->queue_cond);
+        tvh_mutex_destroy(&self->queue_mutex);
         if (self->context) {
             tvh_context_destroy(self->context);
             self->context = NULL;
@@ -88,24 +88,10 @@ static void
 tvh_transcoder_handle(TVHTranscoder *self, th_pkt_t *pkt)
 {
     TVHStream *stream = NULL;
-    int err = 0;
-    char averr_buf[256];
 
     SLIST_FOREACH(stream, &self->streams, link) {
         if (pkt->pkt_componentindex == stream->index) {
-            err = tvh_stream_handle(stream, pkt);
-            if (err) {
-                tvh_stream_stop(stream, 0);
-                if (av_strerror(err, averr_buf, sizeof(averr_buf)) < 0) {
-                    snprintf(averr_buf, sizeof(averr_buf), "unknown error");
-                }
-                tvh_context_log(stream->context, LOG_WARNING,
-                               "failed to transcode packet at pts: %"PRId64" error %d: %s",
-                                pkt->pkt_pts, err, averr_buf);
-                if (tvhtrace_enabled()) {
-                    pkt_trace(LS_TRANSCODE, pkt, "packet details");
-                }
-            }
+            tvh_stream_dispatch(stream, pkt);
             break;
         }
     }
@@ -291,14 +277,18 @@ tvh_transcoder_stream(void *opaque, tvh_sm_t *msg)
                 streaming_start_unref(msg->sm_data);
                 msg->sm_data = ss;
             }
+            tvh_mutex_lock(&self->output_mutex);
             streaming_target_deliver2(self->output, msg);
+            tvh_mutex_unlock(&self->output_mutex);
             break;
         case SMT_STOP:
             // this will trigger tvh_context_close_meth()
             tvh_transcoder_stop(self, 1);
             /* !!! FALLTHROUGH !!! */
         default:
+            tvh_mutex_lock(&self->output_mutex);
             streaming_target_deliver2(self->output, msg);
+            tvh_mutex_unlock(&self->output_mutex);
             break;
     }
 }
@@ -349,7 +339,9 @@ tvh_transcoder_deliver(TVHTranscoder *self, th_pkt_t *pkt)
         return -1;
     }
     pkt_ref_dec(pkt);
+    tvh_mutex_lock(&self->output_mutex);
     streaming_target_deliver2(self->output, msg);
+    tvh_mutex_unlock(&self->output_mutex);
     return 0;
 }
 
@@ -373,6 +365,7 @@ tvh_transcoder_create(tvh_st_t *output,
         return NULL;
     }
     SLIST_INIT(&self->streams);
+    tvh_mutex_init(&self->output_mutex, NULL);
     self->id = ++id;
     if (!self->id) {
         self->id = ++id;
@@ -403,6 +396,7 @@ tvh_transcoder_destroy(TVHTranscoder *self)
         }
         for (i = 0; i < AVMEDIA_TYPE_NB; i++)
           free(self->src_codecs[i]);
+        tvh_mutex_destroy(&self->output_mutex);
         free(self);
         self = NULL;
     }
@@ -0,0 +1,408 @@
+/*
+ *  tvheadend, synthetic TS load generator and parser benchmark
+ *  Copyright (C) 2026 Tvheadend Foundation CIC
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tvheadend.h"
+#include "input/mpegts/dvb.h"
+#include "muxer.h"
+#include "memoryinfo.h"
+#include "tsbench.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+/*
+ * The generated stream mimics a small multi-service mux: a PAT and
+ * per-service PMTs repeated at a realistic interval, the rest PES
+ * filler spread over the elementary PIDs, with the scrambling control
+ * bits set on half of the services so both the clear and the scrambled
+ * classification branches get exercised.
+ */
+#define TSBENCH_SERVICES   4
+#define TSBENCH_ES_PIDS    3     /* per service */
+#define TSBENCH_PSI_EVERY  100   /* PSI packet every N packets */
+
+#define TSBENCH_PMT_PID(i) (0x100 + (i))
+#define TSBENCH_ES_PID(i, j) (0x200 + (i) * 0x10 + (j))
+
+/*
+ * Wrap one PSI section into a single TS packet (all our sections fit)
+ */
+static void
+tsbench_psi_packet(uint8_t *tsb, uint16_t pid, uint8_t cc,
+                   const uint8_t *sec, int seclen)
+{
+  memset(tsb, 0xff, 188);
+  tsb[0] = 0x47;
+  tsb[1] = 0x40 | (pid >> 8);        /* payload unit start */
+  tsb[2] = pid & 0xff;
+  tsb[3] = 0x10 | (cc & 0xf);        /* payload only */
+  tsb[4] = 0;                        /* pointer field */
+  memcpy(tsb + 5, sec, seclen);
+}
+
+static int
+tsbench_build_pat(uint8_t *sec, int maxlen)
+{
+  int off = 8, i;
+
+  sec[0] = DVB_PAT_BASE;
+  /* section_length is patched below */
+  sec[1] = 0xb0;
+  sec[3] = 0x00; sec[4] = 0x01;      /* transport stream id */
+  sec[5] = 0xc1;                     /* version 0, current */
+  sec[6] = 0; sec[7] = 0;
+  for (i = 0; i < TSBENCH_SERVICES; i++) {
+    sec[off++] = 0; sec[off++] = i + 1;
+    sec[off++] = 0xe0 | (TSBENCH_PMT_PID(i) >> 8);
+    sec[off++] = TSBENCH_PMT_PID(i) & 0xff;
+  }
+  sec[1] = 0xb0 | (((off + 4 - 3) >> 8) & 0xf);
+  sec[2] = (off + 4 - 3) & 0xff;
+  return dvb_table_append_crc32(sec, off, maxlen);
+}
+
+static int
+tsbench_build_pmt(uint8_t *sec, int maxlen, int svc)
+{
+  int off = 12, j;
+
+  sec[0] = DVB_PMT_BASE;
+  sec[1] = 0xb0;
+  sec[3] = 0; sec[4] = svc + 1;      /* service id */
+  sec[5] = 0xc1;
+  sec[6] = 0; sec[7] = 0;
+  sec[8] = 0xe0 | (TSBENCH_ES_PID(svc, 0) >> 8);
+  sec[9] = TSBENCH_ES_PID(svc, 0) & 0xff;
+  sec[10] = 0xf0; sec[11] = 0;       /* no program descriptors */
+  for (j = 0; j < TSBENCH_ES_PIDS; j++) {
+    sec[off++] = j == 0 ? 0x02 : 0x04;  /* video + audio */
+    sec[off++] = 0xe0 | (TSBENCH_ES_PID(svc, j) >> 8);
+    sec[off++] = TSBENCH_ES_PID(svc, j) & 0xff;
+    sec[off++] = 0xf0; sec[off++] = 0;
+  }
+  sec[1] = 0xb0 | (((off + 4 - 3) >> 8) & 0xf);
+  sec[2] = (off + 4 - 3) & 0xff;
+  return dvb_table_append_crc32(sec, off, maxlen);
+}
+
+/*
+ * Fill the buffer with a plausible packet mix; returns the PSI packet
+ * count (the remainder is PES filler)
+ */
+static int
+tsbench_generate(uint8_t *buf, int npackets)
+{
+  uint8_t sec[188], cc[8192];
+  uint8_t *tsb;
+  int i, n, svc, es, psi = 0, pusi;
+  uint16_t pid;
+
+  memset(cc, 0, sizeof(cc));
+  for (i = 0; i < npackets; i++) {
+    tsb = buf + i * 188;
+    if ((i % TSBENCH_PSI_EVERY) == 0) {
+      svc = (i / TSBENCH_PSI_EVERY) % (TSBENCH_SERVICES + 1);
+      if (svc == 0) {
+        n = tsbench_build_pat(sec, sizeof(sec));
+        pid = DVB_PAT_PID;
+      } else {
+        n = tsbench_build_pmt(sec, sizeof(sec), svc - 1);
+        pid = TSBENCH_PMT_PID(svc - 1);
+      }
+      tsbench_psi_packet(tsb, pid, cc[pid]++, sec, n);
+      psi++;
+      continue;
+    }
+    svc = i % TSBENCH_SERVICES;
+    es = (i / TSBENCH_SERVICES) % TSBENCH_ES_PIDS;
+    pid = TSBENCH_ES_PID(svc, es);
+    pusi = (i % 40) == 1;
+    tsb[0] = 0x47;
+    tsb[1] = (pusi ? 0x40 : 0x00) | (pid >> 8);
+    tsb[2] = pid & 0xff;
+    /* scramble half of the services */
+    tsb[3] = ((svc & 1) ? 0x80 : 0x00) | 0x10 | (cc[pid]++ & 0xf);
+    for (n = 4; n < 188; n++)
+      tsb[n] = (uint8_t)(i + n);
+  }
+  return psi;
+}
+
+static void
+tsbench_psi_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
+{
+  *(uint64_t *)mt->mt_opaque += len;
+}
+
+/*
+ * Run the benchmark and print the results to stdout; called from the
+ * command line handling before the full server starts
+ */
+void
+tsbench_run(int npackets)
+{
+  mpegts_psi_table_t pat, pmt;
+  uint64_t sink = 0, clear = 0, scrambled = 0, words = 0;
+  uint8_t *buf, *tsb;
+  int64_t t1, t2;
+  int i, l, len, pid, iters = 4, it;
+  double secs;
+
+  if (npackets < TSBENCH_PSI_EVERY)
+    npackets = 1000000;
+  buf = malloc((size_t)npackets * 188);
+  if (buf == NULL)
+    return;
+  tsbench_generate(buf, npackets);
+
+  dvb_table_parse_init(&pat, "bench-pat", LS_TBL_PASS, DVB_PAT_PID,
+                       DVB_PAT_BASE, DVB_PAT_MASK, &sink);
+  dvb_table_parse_init(&pmt, "bench-pmt", LS_TBL_PASS, TSBENCH_PMT_PID(0),
+                       DVB_PMT_BASE, DVB_PMT_MASK, &sink);
+
+  t1 = getmonoclock();
+  for (it = 0; it < iters; it++) {
+    for (tsb = buf, len = npackets * 188; len > 0; tsb += l, len -= l) {
+      pid = (tsb[1] & 0x1f) << 8 | tsb[2];
+      /* run-length classification, as the pass muxer does it */
+      l = mpegts_word_count(tsb, len, 0x001FFF00);
+      words++;
+      if (pid == DVB_PAT_PID) {
+        dvb_table_parse(&pat, "bench", tsb, l, 1, 0, tsbench_psi_cb);
+      } else if (pid >= TSBENCH_PMT_PID(0) &&
+                 pid < TSBENCH_PMT_PID(TSBENCH_SERVICES)) {
+        pmt.mt_pid = pid;
+        dvb_table_parse(&pmt, "bench", tsb, l, 1, 0, tsbench_psi_cb);
+      } else {
+        /* scrambled payloads are skipped by the demux, count them the
+           same way so the ratio shows up in the report */
+        for (i = 0; i < l; i += 188)
+          if (tsb[i + 3] & 0x80)
+            scrambled++;
+          else
+            clear++;
+      }
+    }
+    dvb_table_parse_reinit_input(&pat);
+    dvb_table_parse_reinit_input(&pmt);
+  }
+  t2 = getmonoclock();
+
+  secs = (double)(t2 - t1) / MONOCLOCK_RESOLUTION;
+  printf("tsbench: %d packets x %d iterations in %.3f s\n",
+         npackets, iters, secs);
+  printf("tsbench: %.0f packets/sec, %.1f ns/packet\n",
+         (double)npackets * iters / secs,
+         (double)(t2 - t1) * 1000.0 / ((double)npackets * iters));
+  printf("tsbench: %"PRIu64" clear, %"PRIu64" scrambled, "
+         "%"PRIu64" section bytes, %"PRIu64" runs\n",
+         clear, scrambled, sink, words);
+
+  dvb_table_parse_done(&pat);
+  dvb_table_parse_done(&pmt);
+  free(buf);
+}
+
+/*
+ * Corpus mode - the same layers driven by a captured stream (tsfile
+ * format, i.e. a plain 188-byte packet dump), plus the pass muxer
+ * write path, so muxer changes ship with before/after numbers instead
+ * of being validated on production CPU graphs.
+ */
+
+#define TSBENCH_MAX_CORPUS  (256*1024*1024)
+#define TSBENCH_CHUNK       (256*188)
+#define TSBENCH_MAX_PMT     32
+
+/* per-component allocation accounting via the memoryinfo registry */
+typedef struct tsbench_meminfo {
+  int64_t size[64];
+  int64_t count[64];
+} tsbench_meminfo_t;
+
+static void
+tsbench_meminfo_get(tsbench_meminfo_t *snap)
+{
+  memoryinfo_t *my;
+  int i = 0;
+
+  LIST_FOREACH(my, &memoryinfo_entries, my_link) {
+    if (i >= ARRAY_SIZE(snap->size))
+      break;
+    snap->size[i]  = atomic_get_s64(&my->my_size);
+    snap->count[i] = atomic_get_s64(&my->my_count);
+    i++;
+  }
+}
+
+static void
+tsbench_meminfo_report(const char *stage, const tsbench_meminfo_t *before)
+{
+  memoryinfo_t *my;
+  int64_t ds, dc;
+  int i = 0;
+
+  LIST_FOREACH(my, &memoryinfo_entries, my_link) {
+    if (i >= ARRAY_SIZE(before->size))
+      break;
+    ds = atomic_get_s64(&my->my_size)  - before->size[i];
+    dc = atomic_get_s64(&my->my_count) - before->count[i];
+    if (ds || dc)
+      printf("tsbench: %s: %s %+"PRId64" allocs, %+"PRId64" bytes\n",
+             stage, my->my_name, dc, ds);
+    i++;
+  }
+}
+
+static uint16_t tsbench_corpus_pmt[TSBENCH_MAX_PMT];
+static int      tsbench_corpus_pmts;
+
+static void
+tsbench_corpus_pat_cb(mpegts_psi_table_t *mt, const uint8_t *buf, int len)
+{
+  uint16_t pid;
+  int i, j;
+
+  for (i = 8; i + 4 <= len - 4; i += 4) {
+    if ((buf[i] | buf[i+1]) == 0)
+      continue;                       /* network PID */
+    pid = (buf[i+2] & 0x1f) << 8 | buf[i+3];
+    for (j = 0; j < tsbench_corpus_pmts; j++)
+      if (tsbench_corpus_pmt[j] == pid)
+        break;
+    if (j == tsbench_corpus_pmts && j < TSBENCH_MAX_PMT)
+      tsbench_corpus_pmt[tsbench_corpus_pmts++] = pid;
+  }
+}
+
+static int
+tsbench_corpus_is_pmt(int pid)
+{
+  int j;
+  for (j = 0; j < tsbench_corpus_pmts; j++)
+    if (tsbench_corpus_pmt[j] == pid)
+      return 1;
+  return 0;
+}
+
+void
+tsbench_file_run(const char *path)
+{
+  mpegts_psi_table_t pat, pmt;
+  tsbench_meminfo_t snap;
+  muxer_config_t mc;
+  muxer_t *mux;
+  pktbuf_t *pb;
+  struct stat st;
+  uint64_t sink = 0, clear = 0, scrambled = 0;
+  uint8_t *buf, *tsb;
+  int64_t t1, t2;
+  ssize_t size, off;
+  int fd, l, len, pid, n;
+  double secs;
+
+  fd = tvh_open(path, O_RDONLY, 0);
+  if (fd < 0 || fstat(fd, &st)) {
+    fprintf(stderr, "tsbench: unable to open %s\n", path);
+    if (fd >= 0) close(fd);
+    return;
+  }
+  size = MIN(st.st_size, TSBENCH_MAX_CORPUS);
+  size -= size % 188;
+  if (size < 188 || (buf = malloc(size)) == NULL) {
+    close(fd);
+    return;
+  }
+  for (off = 0; off < size; off += n) {
+    n = read(fd, buf + off, size - off);
+    if (n <= 0) break;
+  }
+  close(fd);
+  size = off - off % 188;
+  if (buf[0] != 0x47)
+    fprintf(stderr, "tsbench: warning: %s does not start at a sync byte\n",
+            path);
+
+  /* stage 1: PID classification + PSI section reassembly */
+  tsbench_corpus_pmts = 0;
+  dvb_table_parse_init(&pat, "bench-pat", LS_TBL_PASS, DVB_PAT_PID,
+                       DVB_PAT_BASE, DVB_PAT_MASK, &sink);
+  dvb_table_parse_init(&pmt, "bench-pmt", LS_TBL_PASS, 0,
+                       DVB_PMT_BASE, DVB_PMT_MASK, &sink);
+  tsbench_meminfo_get(&snap);
+  t1 = getmonoclock();
+  for (tsb = buf, len = size; len > 0; tsb += l, len -= l) {
+    pid = (tsb[1] & 0x1f) << 8 | tsb[2];
+    l = mpegts_word_count(tsb, len, 0x001FFF00);
+    if (pid == DVB_PAT_PID) {
+      dvb_table_parse(&pat, "bench", tsb, l, 1, 0, tsbench_corpus_pat_cb);
+    } else if (tsbench_corpus_is_pmt(pid)) {
+      pmt.mt_pid = pid;
+      dvb_table_parse(&pmt, "bench", tsb, l, 1, 0, tsbench_psi_cb);
+    } else {
+      for (n = 0; n < l; n += 188)
+        if (tsb[n + 3] & 0x80)
+          scrambled++;
+        else
+          clear++;
+    }
+  }
+  t2 = getmonoclock();
+  secs = (double)(t2 - t1) / MONOCLOCK_RESOLUTION;
+  printf("tsbench: %s: %zd packets, %d services\n",
+         path, size / 188, tsbench_corpus_pmts);
+  printf("tsbench: parse: %.0f packets/sec, %.1f ns/packet, "
+         "%"PRIu64" clear, %"PRIu64" scrambled\n",
+         (double)(size / 188) / secs,
+         (double)(t2 - t1) * 1000.0 / (double)(size / 188),
+         clear, scrambled);
+  tsbench_meminfo_report("parse", &snap);
+  dvb_table_parse_done(&pat);
+  dvb_table_parse_done(&pmt);
+
+  /* stage 2: pass muxer write path (batched writev to /dev/null) */
+  memset(&mc, 0, sizeof(mc));
+  mc.m_type = MC_PASS;
+  mc.u.pass.m_flush_bytes = 65536;
+  mc.u.pass.m_flush_time  = 100;
+  mux = muxer_create(&mc, NULL);
+  if (mux && !muxer_open_file(mux, "/dev/null")) {
+    tsbench_meminfo_get(&snap);
+    t1 = getmonoclock();
+    for (off = 0; off < size; off += l) {
+      l = MIN(TSBENCH_CHUNK, size - off);
+      pb = pktbuf_alloc(buf + off, l);
+      muxer_write_pkt(mux, SMT_MPEGTS, pb);
+    }
+    t2 = getmonoclock();
+    secs = (double)(t2 - t1) / MONOCLOCK_RESOLUTION;
+    printf("tsbench: pass muxer: %.1f MB/s, %.1f ns/packet\n",
+           (double)size / (1024.0 * 1024.0) / secs,
+           (double)(t2 - t1) * 1000.0 / (double)(size / 188));
+    tsbench_meminfo_report("pass muxer", &snap);
+  } else {
+    fprintf(stderr, "tsbench: unable to create the pass muxer\n");
+  }
+  if (mux) {
+    muxer_close(mux);
+    muxer_destroy(mux);
+  }
+
+  free(buf);
+}
@@ -0,0 +1,25 @@
+/*
+ *  tvheadend, synthetic TS load generator and parser benchmark
+ *  Copyright (C) 2026 Tvheadend Foundation CIC
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __TVH_TSBENCH_H__
+#define __TVH_TSBENCH_H__
+
+void tsbench_run(int npackets);
+void tsbench_file_run(const char *path);
+
+#endif /* __TVH_TSBENCH_H__ */
@@ -1,4 +1,7 @@
 #define __USE_GNU
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #define TVH_THREAD_C 1
 #include "tvheadend.h"
 #include <assert.h>
@@ -11,10 +14,12 @@
 
 #include "settings.h"
 #include "htsbuf.h"
+#include "htsmsg.h"
 
 #ifdef PLATFORM_LINUX
 #include <sys/prctl.h>
 #include <sys/syscall.h>
+#include <sched.h>
 #endif
 
 #ifdef PLATFORM_FREEBSD
@@ -120,6 +125,49 @@ int tvh_thread_kill(pthread_t thread, int sig)
   return pthread_kill(thread, sig);
 }
 
+/*
+ * Pin a thread to a CPU list like "0-3,8,16-23". On NUMA machines
+ * keeping a whole input pipeline on the CPUs of one node also keeps its
+ * buffers node-local through first-touch allocation. Returns -1 when
+ * the list cannot be parsed or the platform has no affinity support.
+ */
+int
+tvh_thread_set_affinity(pthread_t thread, const char *cpulist)
+{
+#if defined(PLATFORM_LINUX)
+  cpu_set_t set;
+  const char *s = cpulist;
+  char *endp;
+  long a, b;
+
+  if (s == NULL || *s == '\0')
+    return -1;
+  CPU_ZERO(&set);
+  while (*s) {
+    a = strtol(s, &endp, 10);
+    if (endp == s || a < 0 || a >= CPU_SETSIZE)
+      return -1;
+    b = a;
+    s = endp;
+    if (*s == '-') {
+      b = strtol(s + 1, &endp, 10);
+      if (endp == s + 1 || b < a || b >= CPU_SETSIZE)
+        return -1;
+      s = endp;
+    }
+    for (; a <= b; a++)
+      CPU_SET(a, &set);
+    if (*s == ',')
+      s++;
+    else if (*s)
+      return -1;
+  }
+  return pthread_setaffinity_np(thread, sizeof(set), &set) ? -1 : 0;
+#else
+  return -1;
+#endif
+}
+
 /* linux style: -19 .. 20 */
 int
 tvh_thread_renice(int value)
@@ -281,6 +329,239 @@ int tvh__mutex_unlock(tvh_mutex_t *mutex)
 }
 #endif
 
+/*
+ * mutex contention profiler
+ *
+ * Cheap enough to stay enabled in production: the uncontended path
+ * costs one trylock, one atomic increment and one clock read.  The
+ * full acquisition latency is measured only when the trylock fails,
+ * which is exactly the contended case we are interested in.  Only
+ * mutexes registered with a name take the profiled path at all.
+ */
+
+int tvh_mutex_prof_running;
+static LIST_HEAD(, tvh_mutex_prof) mprof_list;
+static pthread_mutex_t mprof_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void tvh_mutex_prof_register(tvh_mutex_t *mutex, const char *name)
+{
+  tvh_mutex_prof_t *mp = calloc(1, sizeof(*mp));
+
+  mp->name = name;
+  mp->mutex = mutex;
+  pthread_mutex_lock(&mprof_mutex);
+  LIST_INSERT_HEAD(&mprof_list, mp, link);
+  pthread_mutex_unlock(&mprof_mutex);
+  mutex->prof = mp;
+}
+
+void tvh_mutex_prof_start(int on)
+{
+  tvh_mutex_prof_t *mp;
+
+  pthread_mutex_lock(&mprof_mutex);
+  if (on && !tvh_mutex_prof_running)
+    LIST_FOREACH(mp, &mprof_list, link) {
+      atomic_set_s64(&mp->locks, 0);
+      atomic_set_s64(&mp->contended, 0);
+      atomic_set_s64(&mp->wait_us, 0);
+      atomic_set_s64(&mp->wait_max_us, 0);
+      atomic_set_s64(&mp->hold_us, 0);
+      atomic_set_s64(&mp->hold_max_us, 0);
+    }
+  tvh_mutex_prof_running = !!on;
+  pthread_mutex_unlock(&mprof_mutex);
+}
+
+int tvh__mutex_lock_prof(tvh_mutex_t *mutex)
+{
+  tvh_mutex_prof_t *mp = mutex->prof;
+  int64_t t0, wait;
+  int r;
+
+  r = pthread_mutex_trylock(&mutex->mutex);
+  if (r == EBUSY) {
+    t0 = getmonoclock();
+    r = pthread_mutex_lock(&mutex->mutex);
+    wait = getmonoclock() - t0;
+    atomic_add_s64(&mp->contended, 1);
+    atomic_add_s64(&mp->wait_us, wait);
+    if (wait > atomic_get_s64(&mp->wait_max_us))
+      atomic_set_s64(&mp->wait_max_us, wait);
+  }
+  if (r == 0) {
+    atomic_add_s64(&mp->locks, 1);
+    mp->lock_tstamp = getmonoclock();
+  }
+  return r;
+}
+
+int tvh__mutex_unlock_prof(tvh_mutex_t *mutex)
+{
+  tvh_mutex_prof_t *mp = mutex->prof;
+  int64_t hold = 0;
+  int r;
+
+  if (mp->lock_tstamp) {
+    hold = getmonoclock() - mp->lock_tstamp;
+    mp->lock_tstamp = 0;
+  }
+  r = pthread_mutex_unlock(&mutex->mutex);
+  if (r == 0 && hold > 0) {
+    atomic_add_s64(&mp->hold_us, hold);
+    if (hold > atomic_get_s64(&mp->hold_max_us))
+      atomic_set_s64(&mp->hold_max_us, hold);
+  }
+  return r;
+}
+
+htsmsg_t *tvh_mutex_prof_stats(void)
+{
+  tvh_mutex_prof_t *mp;
+  htsmsg_t *m = htsmsg_create_map(), *l = htsmsg_create_list(), *e;
+  int64_t locks, contended, wait;
+
+  htsmsg_add_u32(m, "running", tvh_mutex_prof_running);
+  pthread_mutex_lock(&mprof_mutex);
+  LIST_FOREACH(mp, &mprof_list, link) {
+    locks     = atomic_get_s64(&mp->locks);
+    contended = atomic_get_s64(&mp->contended);
+    wait      = atomic_get_s64(&mp->wait_us);
+    e = htsmsg_create_map();
+    htsmsg_add_str(e, "name",        mp->name);
+    htsmsg_add_s64(e, "locks",       locks);
+    htsmsg_add_s64(e, "contended",   contended);
+    htsmsg_add_s64(e, "wait_us",     wait);
+    htsmsg_add_s64(e, "wait_avg_us", contended ? wait / contended : 0);
+    htsmsg_add_s64(e, "wait_max_us", atomic_get_s64(&mp->wait_max_us));
+    htsmsg_add_s64(e, "hold_us",     atomic_get_s64(&mp->hold_us));
+    htsmsg_add_s64(e, "hold_max_us", atomic_get_s64(&mp->hold_max_us));
+    htsmsg_add_msg(l, NULL, e);
+  }
+  pthread_mutex_unlock(&mprof_mutex);
+  htsmsg_add_msg(m, "mutexes", l);
+  return m;
+}
+
+/*
+ * subsystem domain gate
+ *
+ * A gated mutex (in practice: global_lock) write-locks one rwlock per
+ * subsystem domain on every acquisition, so the classic "take the
+ * global lock" discipline is unchanged for writers.  Read-mostly
+ * callers that only inspect a subset of the subsystems take the
+ * matching domain read locks instead and run concurrently with each
+ * other; any writer still excludes them all.  Readers must be truly
+ * read-only, must never take a gated mutex (self-deadlock, asserted
+ * below) and must acquire multiple domains in tvh_domain_t order.
+ */
+
+typedef struct tvh_mutex_gate {
+  pthread_rwlock_t domains[TVH_DOMAIN_COUNT];
+} tvh_mutex_gate_t;
+
+static tvh_mutex_gate_t tvh_mutex_gate0;
+static __thread int tvh_domain_read_depth;
+
+void tvh_mutex_gate_arm(tvh_mutex_t *mutex)
+{
+  pthread_rwlockattr_t attr;
+  int d;
+
+  assert(mutex->gate == NULL);
+  pthread_rwlockattr_init(&attr);
+#if defined(PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP)
+  /* the gated mutex keeps the old exclusive semantics - a steady
+   * stream of readers must not starve it */
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+  for (d = 0; d < TVH_DOMAIN_COUNT; d++)
+    pthread_rwlock_init(&tvh_mutex_gate0.domains[d], &attr);
+  pthread_rwlockattr_destroy(&attr);
+  mutex->gate = &tvh_mutex_gate0;
+}
+
+static void tvh_mutex_gate_enter(tvh_mutex_gate_t *gate)
+{
+  int d;
+
+  for (d = 0; d < TVH_DOMAIN_COUNT; d++)
+    pthread_rwlock_wrlock(&gate->domains[d]);
+}
+
+static void tvh_mutex_gate_leave(tvh_mutex_gate_t *gate)
+{
+  int d;
+
+  for (d = TVH_DOMAIN_COUNT - 1; d >= 0; d--)
+    pthread_rwlock_unlock(&gate->domains[d]);
+}
+
+int tvh__mutex_lock_gated(tvh_mutex_t *mutex, const char *filename, int lineno)
+{
+  int r;
+
+  assert(tvh_domain_read_depth == 0);
+#if ENABLE_TRACE
+  if (tvh_thread_debug != 0)
+    r = tvh__mutex_lock(mutex, filename ?: __FILE__, lineno);
+  else
+#endif
+  if (tvh_mutex_prof_running && mutex->prof)
+    r = tvh__mutex_lock_prof(mutex);
+  else
+    r = pthread_mutex_lock(&mutex->mutex);
+  if (r == 0)
+    tvh_mutex_gate_enter(mutex->gate);
+  return r;
+}
+
+int tvh__mutex_trylock_gated(tvh_mutex_t *mutex, const char *filename, int lineno)
+{
+  int r;
+
+  assert(tvh_domain_read_depth == 0);
+#if ENABLE_TRACE
+  if (tvh_thread_debug != 0)
+    r = tvh__mutex_trylock(mutex, filename ?: __FILE__, lineno);
+  else
+#endif
+    r = pthread_mutex_trylock(&mutex->mutex);
+  if (r == 0)
+    tvh_mutex_gate_enter(mutex->gate);
+  return r;
+}
+
+int tvh__mutex_unlock_gated(tvh_mutex_t *mutex)
+{
+  tvh_mutex_gate_leave(mutex->gate);
+#if ENABLE_TRACE
+  if (tvh_thread_debug != 0)
+    return tvh__mutex_unlock(mutex);
+#endif
+  if (tvh_mutex_prof_running && mutex->prof)
+    return tvh__mutex_unlock_prof(mutex);
+  return pthread_mutex_unlock(&mutex->mutex);
+}
+
+void tvh_domain_read_lock(tvh_domain_t domain)
+{
+  pthread_rwlock_rdlock(&tvh_mutex_gate0.domains[domain]);
+  tvh_domain_read_depth++;
+}
+
+void tvh_domain_read_unlock(tvh_domain_t domain)
+{
+  assert(tvh_domain_read_depth > 0);
+  tvh_domain_read_depth--;
+  pthread_rwlock_unlock(&tvh_mutex_gate0.domains[domain]);
+}
+
+int tvh_domain_read_held(void)
+{
+  return tvh_domain_read_depth > 0;
+}
+
 int
 tvh_mutex_timedlock
   ( tvh_mutex_t *mutex, int64_t usec )
@@ -296,6 +577,11 @@ tvh_mutex_timedlock
     tvh_safe_usleep(10000);
   }
 
+  if (retcode == 0 && mutex->gate) {
+    assert(tvh_domain_read_depth == 0);
+    tvh_mutex_gate_enter(mutex->gate);
+  }
+
   return retcode;
 }
 
@@ -360,7 +646,11 @@ tvh_cond_wait
   if (tvh_thread_debug > 0)
     tvh_mutex_remove_from_list(mutex, &filename, &lineno);
 #endif
+  if (mutex->gate)
+    tvh_mutex_gate_leave(mutex->gate);
   r = pthread_cond_wait(&cond->cond, &mutex->mutex);
+  if (mutex->gate)
+    tvh_mutex_gate_enter(mutex->gate);
 #if ENABLE_TRACE
   if (tvh_thread_debug > 0)
     tvh_mutex_add_to_list(mutex, filename, lineno);
@@ -395,13 +685,21 @@ tvh_cond_timedwait
   ts.tv_nsec = (relative % MONOCLOCK_RESOLUTION) *
                (1000000000ULL/MONOCLOCK_RESOLUTION);
 
+  if (mutex->gate)
+    tvh_mutex_gate_leave(mutex->gate);
   r = pthread_cond_timedwait_relative_np(&cond->cond, &mutex->mutex, &ts);
+  if (mutex->gate)
+    tvh_mutex_gate_enter(mutex->gate);
 #else
   struct timespec ts;
   ts.tv_sec = monoclock / MONOCLOCK_RESOLUTION;
   ts.tv_nsec = (monoclock % MONOCLOCK_RESOLUTION) *
                (1000000000ULL/MONOCLOCK_RESOLUTION);
+  if (mutex->gate)
+    tvh_mutex_gate_leave(mutex->gate);
   r = pthread_cond_timedwait(&cond->cond, &mutex->mutex, &ts);
+  if (mutex->gate)
+    tvh_mutex_gate_enter(mutex->gate);
 #endif
 
 #if ENABLE_TRACE
@@ -422,7 +720,11 @@ int tvh_cond_timedwait_ts(tvh_cond_t *cond, tvh_mutex_t *mutex, struct timespec
   if (tvh_thread_debug > 0)
     tvh_mutex_remove_from_list(mutex, &filename, &lineno);
 #endif
+  if (mutex->gate)
+    tvh_mutex_gate_leave(mutex->gate);
   r = pthread_cond_timedwait(&cond->cond, &mutex->mutex, ts);
+  if (mutex->gate)
+    tvh_mutex_gate_enter(mutex->gate);
 #if ENABLE_TRACE
   if (tvh_thread_debug > 0)
     tvh_mutex_add_to_list(mutex, filename, lineno);
@@ -44,8 +44,40 @@ typedef struct tvh_mutex_waiter {
 } tvh_mutex_waiter_t;
 #endif
 
+/**
+ * Contention profile attached to a named mutex; the counters are
+ * atomics so concurrent waiters can update them without extra locking
+ */
+typedef struct tvh_mutex_prof {
+  LIST_ENTRY(tvh_mutex_prof) link;
+  const char *name;
+  struct tvh_mutex *mutex;
+  int64_t locks;
+  int64_t contended;
+  int64_t wait_us;
+  int64_t wait_max_us;
+  int64_t hold_us;
+  int64_t hold_max_us;
+  int64_t lock_tstamp;    /* written by the owner only */
+} tvh_mutex_prof_t;
+
+/**
+ * Subsystem reader-writer domains gating the global lock.  The enum
+ * order is the mandatory acquisition order when a reader needs more
+ * than one domain; a gated mutex write-locks all of them.
+ */
+typedef enum {
+  TVH_DOMAIN_CONFIG = 0,  /* access entries, settings, idnode metadata */
+  TVH_DOMAIN_CHANNEL,     /* channels, tags, services */
+  TVH_DOMAIN_EPG,         /* EPG broadcasts and sets */
+  TVH_DOMAIN_DVR,         /* DVR entries, autorecs, timerecs */
+  TVH_DOMAIN_COUNT
+} tvh_domain_t;
+
 typedef struct tvh_mutex {
   pthread_mutex_t mutex;
+  tvh_mutex_prof_t *prof;
+  struct tvh_mutex_gate *gate;
 #if ENABLE_TRACE
   uint32_t magic1;
   long tid;
@@ -63,6 +95,7 @@ typedef struct tvh_mutex {
  */
 
 void tvh_mutex_not_held(const char *file, int line);
+int tvh_domain_read_held(void);
 
 static inline void
 lock_assert0(tvh_mutex_t *l, const char *file, int line)
@@ -70,6 +103,9 @@ lock_assert0(tvh_mutex_t *l, const char *file, int line)
 #if 0 && ENABLE_LOCKOWNER
   assert(l->mutex.__data.__owner == syscall(SYS_gettid));
 #else
+  /* a domain read lock excludes every writer of a gated mutex */
+  if(l->gate && tvh_domain_read_held())
+    return;
   if(pthread_mutex_trylock(&l->mutex) == EBUSY)
     return;
   tvh_mutex_not_held(file, line);
@@ -98,6 +134,22 @@ lock_assert0(tvh_mutex_t *l, const char *file, int line)
 extern int tvh_thread_debug;
 #endif
 
+extern int tvh_mutex_prof_running;
+
+void tvh_mutex_prof_register(struct tvh_mutex *mutex, const char *name);
+void tvh_mutex_prof_start(int on);
+struct htsmsg;
+struct htsmsg *tvh_mutex_prof_stats(void);
+int tvh__mutex_lock_prof(struct tvh_mutex *mutex);
+int tvh__mutex_unlock_prof(struct tvh_mutex *mutex);
+
+void tvh_mutex_gate_arm(struct tvh_mutex *mutex);
+void tvh_domain_read_lock(tvh_domain_t domain);
+void tvh_domain_read_unlock(tvh_domain_t domain);
+int tvh__mutex_lock_gated(struct tvh_mutex *mutex, const char *filename, int lineno);
+int tvh__mutex_trylock_gated(struct tvh_mutex *mutex, const char *filename, int lineno);
+int tvh__mutex_unlock_gated(struct tvh_mutex *mutex);
+
 void tvh_thread_init(int debug_level);
 void tvh_thread_done(void);
 
@@ -108,6 +160,7 @@ int tvh_thread_create
 
 int tvh_thread_kill(pthread_t thread, int sig);
 int tvh_thread_renice(int value);
+int tvh_thread_set_affinity(pthread_t thread, const char *cpulist);
 
 int tvh_mutex_init(tvh_mutex_t *mutex, const pthread_mutexattr_t *attr);
 int tvh_mutex_destroy(tvh_mutex_t *mutex);
@@ -115,13 +168,19 @@ int tvh_mutex_destroy(tvh_mutex_t *mutex);
 int tvh__mutex_lock(tvh_mutex_t *mutex, const char *filename, int lineno);
 #define tvh_mutex_lock(_mutex)					\
  ({								\
-    tvh_thread_debug == 0 ?					\
-      pthread_mutex_lock(&(_mutex)->mutex) :			\
-      tvh__mutex_lock((_mutex), __FILE__, __LINE__);		\
+    (_mutex)->gate != NULL ?					\
+      tvh__mutex_lock_gated((_mutex), __FILE__, __LINE__) :	\
+    tvh_thread_debug != 0 ?					\
+      tvh__mutex_lock((_mutex), __FILE__, __LINE__) :		\
+    tvh_mutex_prof_running && (_mutex)->prof ?			\
+      tvh__mutex_lock_prof(_mutex) :				\
+      pthread_mutex_lock(&(_mutex)->mutex);			\
  })
 int tvh__mutex_trylock(tvh_mutex_t *mutex, const char *filename, int lineno);
 #define tvh_mutex_trylock(_mutex)				\
  ({								\
+    (_mutex)->gate != NULL ?					\
+      tvh__mutex_trylock_gated((_mutex), __FILE__, __LINE__) :	\
     tvh_thread_debug == 0 ?					\
       pthread_mutex_trylock(&(_mutex)->mutex) :			\
       tvh__mutex_trylock((_mutex), __FILE__, __LINE__);		\
@@ -129,21 +188,35 @@ int tvh__mutex_trylock(tvh_mutex_t *mutex, const char *filename, int lineno);
 int tvh__mutex_unlock(tvh_mutex_t *mutex);
 static inline int tvh_mutex_unlock(tvh_mutex_t *mutex)
 {
-  if (tvh_thread_debug == 0)
-    return pthread_mutex_unlock(&mutex->mutex);
-  return tvh__mutex_unlock(mutex);
+  if (mutex->gate)
+    return tvh__mutex_unlock_gated(mutex);
+  if (tvh_thread_debug != 0)
+    return tvh__mutex_unlock(mutex);
+  if (tvh_mutex_prof_running && mutex->prof)
+    return tvh__mutex_unlock_prof(mutex);
+  return pthread_mutex_unlock(&mutex->mutex);
 }
 #else
 static inline int tvh_mutex_lock(tvh_mutex_t *mutex)
 {
+  if (mutex->gate)
+    return tvh__mutex_lock_gated(mutex, NULL, 0);
+  if (tvh_mutex_prof_running && mutex->prof)
+    return tvh__mutex_lock_prof(mutex);
   return pthread_mutex_lock(&mutex->mutex);
 }
 static inline int tvh_mutex_trylock(tvh_mutex_t *mutex)
 {
+  if (mutex->gate)
+    return tvh__mutex_trylock_gated(mutex, NULL, 0);
   return pthread_mutex_trylock(&mutex->mutex);
 }
 static inline int tvh_mutex_unlock(tvh_mutex_t *mutex)
 {
+  if (mutex->gate)
+    return tvh__mutex_unlock_gated(mutex);
+  if (tvh_mutex_prof_running && mutex->prof)
+    return tvh__mutex_unlock_prof(mutex);
   return pthread_mutex_unlock(&mutex->mutex);
 }
 #endif
@@ -66,6 +66,8 @@ static inline int tvheadend_is_running(void)
 
 htsmsg_t *tvheadend_capabilities_list(int check);
 
+htsmsg_t *tvh_startup_phases_msg(void);
+
 typedef struct str_list
 {
   int max;
@@ -129,10 +131,23 @@ extern int tvheadend_htsp_port;
 
 typedef void (mti_callback_t)(void *opaque);
 
+/*
+ * hierarchical timing wheel node, embedded first in mtimer/gtimer so
+ * the dispatcher can cast back; twn_head remembers the slot the node
+ * currently sits on so disarm stays O(1)
+ */
+typedef struct tvh_wheel_node {
+  TAILQ_ENTRY(tvh_wheel_node) twn_link;
+  struct tvh_wheel_list *twn_head;
+  uint64_t twn_ticks;
+} tvh_wheel_node_t;
+
+TAILQ_HEAD(tvh_wheel_list, tvh_wheel_node);
+
 #define MTIMER_MAGIC1 0x0d62a9de
 
 typedef struct mtimer {
-  LIST_ENTRY(mtimer) mti_link;
+  tvh_wheel_node_t mti_node;
 #if ENABLE_TRACE
   uint32_t mti_magic1;
 #endif
@@ -167,7 +182,7 @@ void mtimer_disarm(mtimer_t *mti);
 typedef void (gti_callback_t)(void *opaque);
 
 typedef struct gtimer {
-  LIST_ENTRY(gtimer) gti_link;
+  tvh_wheel_node_t gti_node;
 #if ENABLE_TRACE
   uint32_t gti_magic1;
 #endif
@@ -247,6 +262,9 @@ void tvh_pipe_close(th_pipe_t *pipe);
 
 int tvh_write(int fd, const void *buf, size_t len);
 
+struct iovec;
+int tvh_writev(int fd, struct iovec *iov, int iovcnt);
+
 int tvh_write_in_chunks(int fd, const void *buf, size_t len, size_t chunkSize);
 
 int tvh_nonblock_write(int fd, const void *buf, size_t len);
@@ -291,6 +309,10 @@ uint8_t *tvh_gzip_inflate ( const uint8_t *data, size_t size, size_t orig );
 uint8_t *tvh_gzip_deflate ( const uint8_t *data, size_t orig, size_t *size );
 int      tvh_gzip_deflate_fd ( int fd, const uint8_t *data, size_t orig, size_t *size, int speed );
 int      tvh_gzip_deflate_fd_header ( int fd, const uint8_t *data, size_t orig, size_t *size, int speed , const char *signature);
+typedef struct tvh_gzip_stream tvh_gzip_stream_t;
+tvh_gzip_stream_t *tvh_gzip_stream_open ( int fd, int speed );
+int      tvh_gzip_stream_write ( tvh_gzip_stream_t *gz, const void *data, size_t len );
+int      tvh_gzip_stream_close ( tvh_gzip_stream_t *gz );
 #endif
 
 /* URL decoding */
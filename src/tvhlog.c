@@ -46,8 +46,9 @@ bitops_ulong_t           tvhlog_trace[TVHLOG_BITARRAY];
 pthread_t                tvhlog_tid;
 tvh_mutex_t              tvhlog_mutex;
 tvh_cond_t               tvhlog_cond;
-TAILQ_HEAD(,tvhlog_msg)  tvhlog_queue;
+static void * volatile   tvhlog_queue_head;
 int                      tvhlog_queue_size;
+int                      tvhlog_queue_drops;
 int                      tvhlog_queue_full;
 #if ENABLE_TRACE
 int                      tvhlog_rtfd = STDOUT_FILENO;
@@ -59,11 +60,11 @@ struct sockaddr_storage  tvhlog_rtss;
 
 typedef struct tvhlog_msg
 {
-  TAILQ_ENTRY(tvhlog_msg)  link;
-  char                    *msg;
+  struct tvhlog_msg       *next;
   int                      severity;
   int                      notify;
   struct timeval           time;
+  char                     msg[0];
 } tvhlog_msg_t;
 
 static const char *logtxtmeta[9][2] = {
@@ -387,24 +388,78 @@ tvhlog_process
     }
   }
 
-  free(msg->msg);
   free(msg);
 }
 
+/*
+ * Message queue
+ *
+ * The producers push to a lock-free LIFO list, so a log call from a
+ * streaming thread never contends on tvhlog_mutex.  The mutex only
+ * protects the options/path/condvar handshake with the log thread.
+ */
+
+static tvhlog_msg_t *
+tvhlog_msg_create ( int severity, int notify, const char *str )
+{
+  size_t len = strlen(str) + 1;
+  tvhlog_msg_t *msg = malloc(sizeof(*msg) + len);
+  if (msg == NULL)
+    return NULL;
+  msg->next     = NULL;
+  msg->severity = severity;
+  msg->notify   = notify;
+  gettimeofday(&msg->time, NULL);
+  memcpy(msg->msg, str, len);
+  return msg;
+}
+
+static void
+tvhlog_msg_push ( tvhlog_msg_t *msg )
+{
+  void *head;
+  do {
+    head = atomic_get_ptr(&tvhlog_queue_head);
+    msg->next = head;
+  } while (!atomic_cas_ptr(&tvhlog_queue_head, head, msg));
+  atomic_add(&tvhlog_queue_size, 1);
+  if (head == NULL) {
+    /* empty to non-empty transition - the log thread may sleep */
+    tvh_mutex_lock(&tvhlog_mutex);
+    tvh_cond_signal(&tvhlog_cond, 0);
+    tvh_mutex_unlock(&tvhlog_mutex);
+  }
+}
+
+static tvhlog_msg_t *
+tvhlog_msg_popall ( void )
+{
+  tvhlog_msg_t *msg, *next, *prev = NULL;
+  msg = atomic_exchange_ptr(&tvhlog_queue_head, NULL);
+  /* the producers build a LIFO list, restore the insertion order */
+  while (msg) {
+    next = msg->next;
+    msg->next = prev;
+    prev = msg;
+    msg = next;
+  }
+  return prev;
+}
+
 /* Log */
 static void *
 tvhlog_thread ( void *p )
 {
-  int options;
-  char *path = NULL, buf[512];
+  int options, drops;
+  char *path = NULL, buf[512], dmsg[128];
   FILE *fp = NULL;
-  tvhlog_msg_t *msg;
+  tvhlog_msg_t *msg, *next;
 
   tvh_mutex_lock(&tvhlog_mutex);
   while (tvhlog_run) {
 
     /* Wait */
-    if (!(msg = TAILQ_FIRST(&tvhlog_queue))) {
+    if (atomic_get_ptr(&tvhlog_queue_head) == NULL) {
       if (fp) {
         fclose(fp); // only issue here is we close with mutex!
                     // but overall performance will be higher
@@ -413,10 +468,6 @@ tvhlog_thread ( void *p )
       tvh_cond_wait(&tvhlog_cond, &tvhlog_mutex);
       continue;
     }
-    TAILQ_REMOVE(&tvhlog_queue, msg, link);
-    tvhlog_queue_size--;
-    if (tvhlog_queue_size < (TVHLOG_QUEUE_MAXSIZE / 2))
-      tvhlog_queue_full = 0;
 
     /* Copy options and path */
     if (!fp) {
@@ -429,7 +480,17 @@ tvhlog_thread ( void *p )
     }
     options  = tvhlog_options;
     tvh_mutex_unlock(&tvhlog_mutex);
-    tvhlog_process(msg, options, &fp, path);
+    for (msg = tvhlog_msg_popall(); msg; msg = next) {
+      next = msg->next;
+      atomic_dec(&tvhlog_queue_size, 1);
+      tvhlog_process(msg, options, &fp, path);
+    }
+    if ((drops = atomic_exchange(&tvhlog_queue_drops, 0)) > 0) {
+      snprintf(dmsg, sizeof(dmsg), "%s: log buffer full, %d message%s dropped",
+               tvhlog_subsystems[LS_MAIN].name, drops, drops == 1 ? "" : "s");
+      if ((msg = tvhlog_msg_create(LOG_ERR, 1, dmsg)) != NULL)
+        tvhlog_process(msg, options, &fp, path);
+    }
     tvh_mutex_lock(&tvhlog_mutex);
   }
   if (fp)
@@ -444,6 +505,7 @@ void tvhlogv ( const char *file, int line, int severity,
   int ok, options, notify;
   size_t l;
   char buf[1024];
+  tvhlog_msg_t *msg;
 
   notify = (severity & LOG_TVH_NOTIFY) ? 1 : 0;
   severity &= ~LOG_TVH_NOTIFY;
@@ -463,23 +525,18 @@ void tvhlogv ( const char *file, int line, int severity,
   if (!ok)
     return;
 
-  tvh_mutex_lock(&tvhlog_mutex);
-
-  /* Check for full */
-  if (tvhlog_queue_full) {
-    tvh_mutex_unlock(&tvhlog_mutex);
+  /* Closed */
+  if (atomic_get(&tvhlog_queue_full))
     return;
-  }
 
-  /* FULL */
-  if (tvhlog_queue_size == TVHLOG_QUEUE_MAXSIZE) {
-    tvhlog_queue_full = 1;
-    fmt      = "log buffer full";
-    args     = NULL;
-    severity = LOG_ERR;
+  /* FULL - count the message, the log thread reports the total */
+  if (atomic_get(&tvhlog_queue_size) >= TVHLOG_QUEUE_MAXSIZE) {
+    atomic_add(&tvhlog_queue_drops, 1);
+    return;
   }
 
-  /* Basic message */
+  /* Basic message - formatted here, a va_list cannot be handed over
+   * to the log thread */
   options = tvhlog_options;
   l = 0;
   if (options & TVHLOG_OPT_THREAD) {
@@ -494,25 +551,21 @@ void tvhlogv ( const char *file, int line, int severity,
     snprintf(buf + l, sizeof(buf) - l, "%s", fmt);
 
   /* Store */
-  tvhlog_msg_t *msg = calloc(1, sizeof(tvhlog_msg_t));
-  gettimeofday(&msg->time, NULL);
-  msg->msg      = strdup(buf);
-  msg->severity = severity;
-  msg->notify   = notify;
+  if ((msg = tvhlog_msg_create(severity, notify, buf)) == NULL)
+    return;
 #if TVHLOG_THREAD
   if (tvhlog_run) {
-    TAILQ_INSERT_TAIL(&tvhlog_queue, msg, link);
-    tvhlog_queue_size++;
-    tvh_cond_signal(&tvhlog_cond, 0);
+    tvhlog_msg_push(msg);
   } else {
 #endif
     FILE *fp = NULL;
+    tvh_mutex_lock(&tvhlog_mutex);
     tvhlog_process(msg, tvhlog_options, &fp, tvhlog_path);
+    tvh_mutex_unlock(&tvhlog_mutex);
     if (fp) fclose(fp);
 #if TVHLOG_THREAD
   }
 #endif
-  tvh_mutex_unlock(&tvhlog_mutex);
 }
 
 
@@ -634,7 +687,6 @@ tvhlog_init ( int level, int options, const char *path )
   openlog("tvheadend", LOG_PID, LOG_DAEMON);
   tvh_mutex_init(&tvhlog_mutex, NULL);
   tvh_cond_init(&tvhlog_cond, 1);
-  TAILQ_INIT(&tvhlog_queue);
 #if ENABLE_TRACE
   {
     const char *rtport0 = getenv("TVHEADEND_RTLOG_UDP_PORT");
@@ -659,18 +711,19 @@ void
 tvhlog_end ( void )
 {
   FILE *fp = NULL;
-  tvhlog_msg_t *msg;
+  tvhlog_msg_t *msg, *next;
   tvh_mutex_lock(&tvhlog_mutex);
   tvhlog_run = 0;
   tvh_cond_signal(&tvhlog_cond, 0);
   tvh_mutex_unlock(&tvhlog_mutex);
   pthread_join(tvhlog_tid, NULL);
   tvh_mutex_lock(&tvhlog_mutex);
-  while ((msg = TAILQ_FIRST(&tvhlog_queue)) != NULL) {
-    TAILQ_REMOVE(&tvhlog_queue, msg, link);
+  atomic_set(&tvhlog_queue_full, 1);
+  for (msg = tvhlog_msg_popall(); msg; msg = next) {
+    next = msg->next;
+    atomic_dec(&tvhlog_queue_size, 1);
     tvhlog_process(msg, tvhlog_options, &fp, tvhlog_path);
   }
-  tvhlog_queue_full = 1;
   tvh_mutex_unlock(&tvhlog_mutex);
   if (fp)
     fclose(fp);
@@ -29,6 +29,7 @@
 #include <assert.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <netdb.h>
 #include <net/if.h>
 #ifndef IPV6_ADD_MEMBERSHIP
@@ -607,6 +608,23 @@ recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
 
 #endif
 
+#if defined(__linux__) && !defined(UDP_GRO)
+#define UDP_GRO 104
+#endif
+
+/* size of one receive buffer in GRO mode - the kernel coalesces up to
+ * ~64KB of same-flow datagrams into a single buffer + segment size */
+#define UDP_GRO_BUF_SIZE (64*1024)
+
+#if defined(__linux__)
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#endif
+
+/* per-message ancillary buffer - room for the GRO segment size and the
+ * SO_TIMESTAMPING stamps plus some slack */
+#define UDP_CMSG_SIZE 128
+
 void
 udp_multirecv_init( udp_multirecv_t *um, int packets, int psize )
 {
@@ -615,6 +633,11 @@ udp_multirecv_init( udp_multirecv_t *um, int packets, int psize )
   assert(um);
   um->um_psize   = psize;
   um->um_packets = packets;
+  um->um_gro     = 0;
+  um->um_bufs    = 0;
+  um->um_ts      = 0;
+  um->um_cmsg    = NULL;
+  um->um_stamps  = NULL;
   um->um_data    = malloc(packets * psize);
   um->um_iovec   = malloc(packets * sizeof(struct iovec));
   um->um_riovec  = malloc(packets * sizeof(struct iovec));
@@ -628,6 +651,126 @@ udp_multirecv_init( udp_multirecv_t *um, int packets, int psize )
   }
 }
 
+/*
+ * Upgrade an initialized multirecv context to kernel GRO coalescing.
+ * The datagram payloads are handed back split into the usual per-packet
+ * iovec list, so callers see exactly the recvmmsg semantics, just with
+ * far fewer syscalls. Returns 0 on success, -1 when the kernel (or the
+ * platform) does not support UDP_GRO - the context then stays in the
+ * plain recvmmsg mode.
+ */
+int
+udp_multirecv_gro_enable( udp_multirecv_t *um, int fd )
+{
+#ifdef UDP_GRO
+  struct mmsghdr *msg;
+  int i, one = 1, bufs;
+
+  assert(um);
+  if (setsockopt(fd, IPPROTO_UDP, UDP_GRO, &one, sizeof(one)))
+    return -1;
+  bufs = (um->um_packets * um->um_psize + UDP_GRO_BUF_SIZE - 1) /
+         UDP_GRO_BUF_SIZE;
+  if (bufs < 2)
+    bufs = 2;
+  free(um->um_data);
+  free(um->um_iovec);
+  free(um->um_msg);
+  um->um_gro    = 1;
+  um->um_bufs   = bufs;
+  um->um_data   = malloc(bufs * UDP_GRO_BUF_SIZE);
+  um->um_cmsg   = malloc(bufs * UDP_CMSG_SIZE);
+  um->um_iovec  = malloc(bufs * sizeof(struct iovec));
+  um->um_msg    = calloc(bufs,  sizeof(struct mmsghdr));
+  msg = (struct mmsghdr *)um->um_msg;
+  for (i = 0; i < bufs; i++) {
+    um->um_iovec[i].iov_base      = um->um_data + i * UDP_GRO_BUF_SIZE;
+    um->um_iovec[i].iov_len       = UDP_GRO_BUF_SIZE;
+    msg[i].msg_hdr.msg_iov        = &um->um_iovec[i];
+    msg[i].msg_hdr.msg_iovlen     = 1;
+    msg[i].msg_hdr.msg_control    = um->um_cmsg + i * UDP_CMSG_SIZE;
+    msg[i].msg_hdr.msg_controllen = UDP_CMSG_SIZE;
+  }
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+/*
+ * Ask the kernel for receive timestamps - hardware stamps where the NIC
+ * provides them, software stamps taken at interrupt time otherwise.
+ * udp_multirecv_read() then returns a wire arrival time per packet in
+ * um_stamps[], converted to the monotonic clock; 0 means no stamp was
+ * available for that packet. Returns 0 on success, -1 when the platform
+ * does not support SO_TIMESTAMPING.
+ */
+int
+udp_multirecv_timestamp_enable( udp_multirecv_t *um, int fd )
+{
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+  struct mmsghdr *msg;
+  int i, flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                 SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+  assert(um);
+  if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)))
+    return -1;
+  um->um_ts     = 1;
+  um->um_stamps = calloc(um->um_packets, sizeof(int64_t));
+  if (!um->um_gro) {
+    msg = (struct mmsghdr *)um->um_msg;
+    um->um_cmsg = malloc(um->um_packets * UDP_CMSG_SIZE);
+    for (i = 0; i < um->um_packets; i++) {
+      msg[i].msg_hdr.msg_control    = um->um_cmsg + i * UDP_CMSG_SIZE;
+      msg[i].msg_hdr.msg_controllen = UDP_CMSG_SIZE;
+    }
+  }
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+/* offset turning a CLOCK_REALTIME stamp into the monotonic clock */
+static int64_t
+udp_ts_mono_offset( void )
+{
+  struct timespec tp;
+  clock_gettime(CLOCK_REALTIME, &tp);
+  return getmonoclock() - (tp.tv_sec * MONOCLOCK_RESOLUTION +
+         tp.tv_nsec / (1000000000LL / MONOCLOCK_RESOLUTION));
+}
+
+static int64_t
+udp_cmsg_stamp( struct msghdr *mh, int64_t off )
+{
+  struct cmsghdr *cm;
+  struct scm_timestamping *t;
+  struct timespec *ts;
+
+  for (cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm)) {
+    if (cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_TIMESTAMPING)
+      continue;
+    t = (struct scm_timestamping *)CMSG_DATA(cm);
+    /* trust the NIC stamp only when it tracks the system clock (PHC
+     * disciplined by e.g. phc2sys), otherwise fall back to the
+     * software receive stamp */
+    ts = &t->ts[0];
+    if (t->ts[2].tv_sec &&
+        (ts->tv_sec == 0 ||
+         llabs((int64_t)(t->ts[2].tv_sec - ts->tv_sec)) <= 1))
+      ts = &t->ts[2];
+    if (ts->tv_sec == 0)
+      return 0;
+    return ts->tv_sec * MONOCLOCK_RESOLUTION +
+           ts->tv_nsec / (1000000000LL / MONOCLOCK_RESOLUTION) + off;
+  }
+  return 0;
+}
+#endif
+
 void
 udp_multirecv_free( udp_multirecv_t *um )
 {
@@ -636,9 +779,14 @@ udp_multirecv_free( udp_multirecv_t *um )
   free(um->um_msg);    um->um_msg   = NULL;
   free(um->um_riovec); um->um_riovec = NULL;
   free(um->um_iovec);  um->um_iovec = NULL;
+  free(um->um_cmsg);   um->um_cmsg  = NULL;
+  free(um->um_stamps); um->um_stamps = NULL;
   free(um->um_data);   um->um_data  = NULL;
   um->um_psize   = 0;
   um->um_packets = 0;
+  um->um_gro     = 0;
+  um->um_bufs    = 0;
+  um->um_ts      = 0;
 }
 
 int
@@ -651,8 +799,57 @@ udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
     errno = EINVAL;
     return -1;
   }
+#ifdef UDP_GRO
+  if (um->um_gro) {
+    struct mmsghdr *msg = (struct mmsghdr *)um->um_msg;
+    struct cmsghdr *cm;
+    uint8_t *p;
+    int j = 0, gso, seg, len;
+#ifdef SO_TIMESTAMPING
+    int64_t stamp, tsoff = um->um_ts ? udp_ts_mono_offset() : 0;
+#endif
+    for (i = 0; i < um->um_bufs; i++)
+      msg[i].msg_hdr.msg_controllen = UDP_CMSG_SIZE;
+    n = recvmmsg(fd, msg, um->um_bufs, MSG_DONTWAIT, NULL);
+    if (n <= 0)
+      return n;
+    for (i = 0; i < n && j < um->um_packets; i++) {
+      gso = 0;
+      for (cm = CMSG_FIRSTHDR(&msg[i].msg_hdr); cm;
+           cm = CMSG_NXTHDR(&msg[i].msg_hdr, cm))
+        if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO) {
+          memcpy(&gso, CMSG_DATA(cm), sizeof(gso));
+          break;
+        }
+#ifdef SO_TIMESTAMPING
+      stamp = um->um_ts ? udp_cmsg_stamp(&msg[i].msg_hdr, tsoff) : 0;
+#endif
+      p   = msg[i].msg_hdr.msg_iov->iov_base;
+      len = msg[i].msg_len;
+      if (gso <= 0)
+        gso = len; /* not coalesced - a single datagram */
+      while (len > 0 && j < um->um_packets) {
+        seg = len < gso ? len : gso;
+        um->um_riovec[j].iov_base = p;
+        um->um_riovec[j].iov_len  = seg;
+#ifdef SO_TIMESTAMPING
+        if (um->um_stamps)
+          um->um_stamps[j] = stamp; /* segments share the buffer stamp */
+#endif
+        j++; p += seg; len -= seg;
+      }
+    }
+    *iovec = um->um_riovec;
+    return j;
+  }
+#endif
   if (packets > um->um_packets)
     packets = um->um_packets;
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+  if (um->um_ts)
+    for (i = 0; i < packets; i++)
+      ((struct mmsghdr *)um->um_msg)[i].msg_hdr.msg_controllen = UDP_CMSG_SIZE;
+#endif
   if (!use_emul) {
     n = recvmmsg(fd, (struct mmsghdr *)um->um_msg, packets, MSG_DONTWAIT, NULL);
   } else {
@@ -664,8 +861,17 @@ udp_multirecv_read( udp_multirecv_t *um, int fd, int packets,
     n = recvmmsg_i(fd, (struct mmsghdr *)um->um_msg, packets, MSG_DONTWAIT);
   }
   if (n > 0) {
-    for (i = 0; i < n; i++)
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+    int64_t tsoff = um->um_ts ? udp_ts_mono_offset() : 0;
+#endif
+    for (i = 0; i < n; i++) {
       um->um_riovec[i].iov_len = ((struct mmsghdr *)um->um_msg)[i].msg_len;
+#if defined(__linux__) && defined(SO_TIMESTAMPING)
+      if (um->um_stamps)
+        um->um_stamps[i] =
+          udp_cmsg_stamp(&((struct mmsghdr *)um->um_msg)[i].msg_hdr, tsoff);
+#endif
+    }
     *iovec = um->um_riovec;
   }
   return n;
@@ -766,6 +972,66 @@ udp_multisend_clean( udp_multisend_t *um )
     um->um_iovec[i].iov_len = 0;
 }
 
+#if defined(__linux__) && defined(UDP_SEGMENT)
+/*
+ * Hand the kernel one contiguous super-packet per syscall and let it
+ * segment the datagrams itself (UDP GSO). Only applicable when every
+ * packet but the last fills its slot completely - then the slots form
+ * one linear buffer. Returns -2 when the caller should fall back to
+ * sendmmsg (uneven packets or a kernel without UDP GSO).
+ */
+static int
+udp_multisend_gso( udp_multisend_t *um, int fd, int packets )
+{
+  static char use_gso = 1;
+  char cbuf[CMSG_SPACE(sizeof(uint16_t))];
+  struct msghdr msg;
+  struct cmsghdr *cm;
+  struct iovec iov;
+  int i, seg, done = 0, max_seg;
+  ssize_t r;
+
+  if (!use_gso)
+    return -2;
+  for (i = 0; i < packets - 1; i++)
+    if (um->um_iovec[i].iov_len != um->um_psize)
+      return -2;
+  /* a super-packet must fit one datagram and the segment count cap */
+  max_seg = MIN(65535 / um->um_psize, 64 /* UDP_MAX_SEGMENTS */);
+  while (done < packets) {
+    seg = MIN(packets - done, max_seg);
+    iov.iov_base = um->um_data + done * um->um_psize;
+    iov.iov_len  = 0;
+    for (i = 0; i < seg; i++)
+      iov.iov_len += um->um_iovec[done + i].iov_len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+    if (seg > 1) {
+      memset(cbuf, 0, sizeof(cbuf));
+      msg.msg_control    = cbuf;
+      msg.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+      cm = CMSG_FIRSTHDR(&msg);
+      cm->cmsg_level = SOL_UDP;
+      cm->cmsg_type  = UDP_SEGMENT;
+      cm->cmsg_len   = CMSG_LEN(sizeof(uint16_t));
+      *(uint16_t *)CMSG_DATA(cm) = um->um_psize;
+    }
+    r = sendmsg(fd, &msg, MSG_DONTWAIT);
+    if (r < 0) {
+      if (done == 0 &&
+          (errno == EINVAL || errno == EOPNOTSUPP || errno == ENOPROTOOPT)) {
+        use_gso = 0;
+        return -2;
+      }
+      return done > 0 ? done : -1;
+    }
+    done += seg;
+  }
+  return packets;
+}
+#endif
+
 int
 udp_multisend_send( udp_multisend_t *um, int fd, int packets )
 {
@@ -779,6 +1045,11 @@ udp_multisend_send( udp_multisend_t *um, int fd, int packets )
     packets = um->um_packets;
   for (i = 0; i < packets; i++)
     ((struct mmsghdr *)um->um_msg)[i].msg_len = um->um_iovec[i].iov_len;
+#if defined(__linux__) && defined(UDP_SEGMENT)
+  n = udp_multisend_gso(um, fd, packets);
+  if (n != -2)
+    return n;
+#endif
   if (!use_emul) {
     n = sendmmsg(fd, (struct mmsghdr *)um->um_msg, packets, MSG_DONTWAIT);
   } else {
@@ -795,3 +1066,116 @@ udp_multisend_send( udp_multisend_t *um, int fd, int packets )
   }
   return n;
 }
+
+/*
+ * Vectored variant of the multi packet send - every packet is described
+ * by a fixed number of caller-owned iovecs (e.g. a private header plus
+ * a shared payload), so one payload buffer can be fanned out to several
+ * sockets without copying.  Returns the number of packets sent; a short
+ * count means the socket would block.
+ */
+int
+udp_sendvec( int fd, struct iovec *iov, int iovs, int packets )
+{
+  static char use_emul = 0;
+  struct mmsghdr msg[32];
+  int n, i, want, done = 0;
+
+  while (done < packets) {
+    want = MIN(packets - done, (int)ARRAY_SIZE(msg));
+    memset(msg, 0, want * sizeof(msg[0]));
+    for (i = 0; i < want; i++) {
+      msg[i].msg_hdr.msg_iov    = iov + (done + i) * iovs;
+      msg[i].msg_hdr.msg_iovlen = iovs;
+    }
+    if (!use_emul) {
+      n = sendmmsg(fd, msg, want, MSG_DONTWAIT);
+      if (n < 0 && errno == ENOSYS) {
+        use_emul = 1;
+        continue;
+      }
+    } else {
+      n = sendmmsg_i(fd, msg, want, MSG_DONTWAIT);
+    }
+    if (n < 0)
+      return done > 0 ? done : -1;
+    done += n;
+    if (n < want)
+      break;
+  }
+  return done;
+}
+
+/*
+ * Datagram pacing - learn the mux rate from the PCR spacing of the
+ * forwarded transport stream and meter writes with a token bucket, so
+ * a large buffered batch leaves the host as a smooth stream instead
+ * of a line-rate burst.
+ */
+
+void
+udp_pacer_init( udp_pacer_t *up )
+{
+  memset(up, 0, sizeof(*up));
+  up->up_pcr_pid = -1;
+  up->up_pcr_last = -1;
+}
+
+void
+udp_pacer_learn( udp_pacer_t *up, const uint8_t *tsb, size_t len )
+{
+  int64_t pcr, d, rate;
+  int pid;
+
+  for ( ; len >= 188; tsb += 188, len -= 188) {
+    up->up_pcr_bytes += 188;
+    if (tsb[0] != 0x47 || (tsb[3] & 0x20) == 0 ||
+        tsb[4] < 7 || (tsb[5] & 0x10) == 0)
+      continue;
+    pid = ((tsb[1] & 0x1f) << 8) | tsb[2];
+    if (up->up_pcr_pid < 0)
+      up->up_pcr_pid = pid;
+    else if (pid != up->up_pcr_pid)
+      continue;                      /* take the rate from one reference */
+    pcr  = (int64_t)tsb[6] << 25 | tsb[7] << 17 | tsb[8] << 9 |
+           tsb[9] << 1 | tsb[10] >> 7;
+    pcr  = pcr * 300 + (((tsb[10] & 1) << 8) | tsb[11]);
+    if (up->up_pcr_last >= 0) {
+      d = pcr - up->up_pcr_last;
+      if (d > 0 && d < 27000000) {   /* skip wraps and discontinuities */
+        rate = (up->up_pcr_bytes * 8 * 27000000) / d;
+        up->up_bitrate = up->up_bitrate ?
+                         (up->up_bitrate * 7 + rate) / 8 : rate;
+        /* allow 25ms bursts, but never less than a few datagrams */
+        up->up_burst = MAX(up->up_bitrate / (8 * 40), 8*1358);
+      }
+    }
+    up->up_pcr_last = pcr;
+    up->up_pcr_bytes = 0;
+  }
+}
+
+void
+udp_pacer_wait( udp_pacer_t *up, size_t len )
+{
+  int64_t now, add, us;
+
+  if (up->up_bitrate <= 0)
+    return;                          /* rate not learned yet */
+  now = getmonoclock();
+  if (up->up_last) {
+    add = ((now - up->up_last) * up->up_bitrate) / (8 * MONOCLOCK_RESOLUTION);
+    up->up_tokens = MIN(up->up_tokens + add, up->up_burst);
+  }
+  up->up_last = now;
+  while (up->up_tokens < (int64_t)len) {
+    us = (((int64_t)len - up->up_tokens) * 8 * MONOCLOCK_RESOLUTION) /
+         up->up_bitrate;
+    tvh_usleep(MINMAX(us, 1000, 100000));
+    now = getmonoclock();
+    add = ((now - up->up_last) * up->up_bitrate) / (8 * MONOCLOCK_RESOLUTION);
+    up->up_tokens = MIN(up->up_tokens + add, up->up_burst);
+    up->up_last = now;
+  }
+  up->up_tokens -= len;
+}
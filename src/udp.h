@@ -70,7 +70,12 @@ udp_write_queue( udp_connection_t *uc, htsbuf_queue_t *q,
 typedef struct udp_multirecv {
   int             um_psize;
   int             um_packets;
+  int             um_gro;     /* kernel GRO coalescing active */
+  int             um_bufs;    /* receive buffer count (GRO mode) */
+  int             um_ts;      /* kernel receive timestamping active */
   uint8_t        *um_data;
+  uint8_t        *um_cmsg;
+  int64_t        *um_stamps;  /* per-packet wire arrival (monoclock), 0 = none */
   struct iovec   *um_iovec;
   struct iovec   *um_riovec;
   struct mmsghdr *um_msg;
@@ -78,6 +83,10 @@ typedef struct udp_multirecv {
 
 void
 udp_multirecv_init( udp_multirecv_t *um, int packets, int psize );
+int
+udp_multirecv_gro_enable( udp_multirecv_t *um, int fd );
+int
+udp_multirecv_timestamp_enable( udp_multirecv_t *um, int fd );
 void
 udp_multirecv_free( udp_multirecv_t *um );
 int
@@ -101,5 +110,28 @@ void
 udp_multisend_free( udp_multisend_t *um );
 int
 udp_multisend_send( udp_multisend_t *um, int fd, int packets );
+int
+udp_sendvec( int fd, struct iovec *iov, int iovs, int packets );
+
+/*
+ * Token-bucket pacer for datagram output - the rate is learned from
+ * the PCR spacing of the forwarded transport stream.
+ */
+typedef struct udp_pacer {
+  int64_t up_bitrate;    /* learned rate, bits per second */
+  int64_t up_tokens;     /* available bytes */
+  int64_t up_burst;      /* bucket depth, bytes */
+  int64_t up_last;       /* last refill (monoclock) */
+  int     up_pcr_pid;    /* PCR reference PID (-1 = not locked yet) */
+  int64_t up_pcr_last;   /* previous PCR value (27 MHz) */
+  int64_t up_pcr_bytes;  /* bytes seen since the previous PCR */
+} udp_pacer_t;
+
+void
+udp_pacer_init( udp_pacer_t *up );
+void
+udp_pacer_learn( udp_pacer_t *up, const uint8_t *tsb, size_t len );
+void
+udp_pacer_wait( udp_pacer_t *up, size_t len );
 
 #endif /* UDP_H_ */
@@ -39,6 +39,7 @@ create_udp_stream ( udp_connection_t *uc, const char *hint )
 
   ustream->us_uc = uc;
   ustream->us_hint = strdup(hint);
+  udp_pacer_init(&ustream->us_pacer);
   snprintf(port_buf, 6, "%d", uc->port);  
   unlen = strlen(uc->host) + strlen(port_buf) + 8;
   ustream->us_udp_url = malloc(unlen);
@@ -158,6 +159,11 @@ udp_stream_thread ( void *aux )
         subscription_add_bytes_out(us->us_subscript, len = pktbuf_len(pb));
         if (len > 0)
           lastpkt = mclk();
+        if (sm->sm_type == SMT_MPEGTS && len > 0) {
+          /* smooth the datagram burst down to the learned mux rate */
+          udp_pacer_learn(&us->us_pacer, pktbuf_ptr(pb), len);
+          udp_pacer_wait(&us->us_pacer, len);
+        }
         muxer_write_pkt(mux, sm->sm_type, sm->sm_data);
         sm->sm_data = NULL;
       }
@@ -30,6 +30,7 @@ typedef struct udp_stream {
   udp_connection_t *us_uc;
   profile_chain_t us_prch;
   th_subscription_t *us_subscript;
+  udp_pacer_t us_pacer;
   char *us_content_name;
   pthread_t us_tid;
   int us_running;
@@ -36,6 +36,7 @@
 #include "tvheadend.h"
 #include "tvh_endian.h"
 #include "sbuf.h"
+#include "memoryinfo.h"
 
 /**
  * CRC32 
@@ -86,9 +87,42 @@ static uint32_t crc_tab[256] = {
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
+/* crc_tab4[k][i] is the CRC of byte i followed by k zero bytes,
+ * derived from crc_tab at startup for the slice-by-4 kernel */
+static uint32_t crc_tab4[4][256];
+
+static void __attribute__((constructor))
+tvh_crc32_init(void)
+{
+  uint32_t c;
+  int i, k;
+
+  for (i = 0; i < 256; i++) {
+    c = crc_tab[i];
+    crc_tab4[0][i] = c;
+    for (k = 1; k < 4; k++) {
+      c = (c << 8) ^ crc_tab[c >> 24];
+      crc_tab4[k][i] = c;
+    }
+  }
+}
+
 uint32_t
 tvh_crc32(const uint8_t *data, size_t datalen, uint32_t crc)
 {
+  uint32_t x;
+
+  /* slice-by-4 - four table lookups per 32-bit word instead of one
+   * per byte; the DVB (MPEG-2, non-reflected) polynomial is not
+   * covered by the SSE4.2/ARMv8 CRC instructions */
+  while(datalen >= 4) {
+    x = crc ^ ((uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+               (uint32_t)data[2] << 8  |  data[3]);
+    crc = crc_tab4[3][x >> 24]         ^ crc_tab4[2][(x >> 16) & 0xff] ^
+          crc_tab4[1][(x >> 8) & 0xff] ^ crc_tab4[0][x & 0xff];
+    data += 4;
+    datalen -= 4;
+  }
   while(datalen--)
     crc = (crc << 8) ^ crc_tab[((crc >> 24) ^ *data++) & 0xff];
 
@@ -359,6 +393,8 @@ char *utf8_validate_inplace(char *s)
  *
  */
 
+memoryinfo_t sbuf_memoryinfo = { .my_name = "sbuf" };
+
 static void
 sbuf_alloc_fail(size_t len)
 {
@@ -380,11 +416,14 @@ sbuf_init_fixed(sbuf_t *sb, int len)
   if (sb->sb_data == NULL)
     sbuf_alloc_fail(len);
   sb->sb_size = len;
+  memoryinfo_alloc(&sbuf_memoryinfo, len);
 }
 
 void
 sbuf_free(sbuf_t *sb)
 {
+  if (sb->sb_data)
+    memoryinfo_free(&sbuf_memoryinfo, sb->sb_size);
   free(sb->sb_data);
   sb->sb_size = sb->sb_ptr = sb->sb_err = 0;
   sb->sb_data = NULL;
@@ -397,6 +436,7 @@ sbuf_reset(sbuf_t *sb, int max_len)
   if (sb->sb_size > max_len) {
     void *n = realloc(sb->sb_data, max_len);
     if (n) {
+      memoryinfo_remove(&sbuf_memoryinfo, sb->sb_size - max_len);
       sb->sb_data = n;
       sb->sb_size = max_len;
     }
@@ -416,10 +456,14 @@ sbuf_alloc_(sbuf_t *sb, int len)
   if(sb->sb_data == NULL) {
     sb->sb_size = len * 4 > 4000 ? len * 4 : 4000;
     sb->sb_data = malloc(sb->sb_size);
+    if (sb->sb_data)
+      memoryinfo_alloc(&sbuf_memoryinfo, sb->sb_size);
     return;
   } else {
     sb->sb_size += len * 4;
     sb->sb_data = realloc(sb->sb_data, sb->sb_size);
+    if (sb->sb_data)
+      memoryinfo_append(&sbuf_memoryinfo, len * 4);
   }
 
   if(sb->sb_data == NULL)
@@ -433,6 +477,10 @@ sbuf_realloc(sbuf_t *sb, int len)
     if (len != sb->sb_size) {
       void *n = realloc(sb->sb_data, len);
       if (n) {
+        if (len > sb->sb_size)
+          memoryinfo_append(&sbuf_memoryinfo, len - sb->sb_size);
+        else
+          memoryinfo_remove(&sbuf_memoryinfo, sb->sb_size - len);
         sb->sb_data = n;
         sb->sb_size = len;
       }
@@ -440,11 +488,22 @@ sbuf_realloc(sbuf_t *sb, int len)
   } else {
     sb->sb_data = malloc(len);
     sb->sb_size = len;
+    if (sb->sb_data)
+      memoryinfo_alloc(&sbuf_memoryinfo, len);
   }
   if (sb->sb_data == NULL)
     sbuf_alloc_fail(len);
 }
 
+void
+sbuf_steal_data(sbuf_t *sb)
+{
+  if (sb->sb_data)
+    memoryinfo_free(&sbuf_memoryinfo, sb->sb_size);
+  sb->sb_data = NULL;
+  sb->sb_ptr = sb->sb_size = sb->sb_err = 0;
+}
+
 void
 sbuf_replace(sbuf_t *sb, sbuf_t *src)
 {
@@ -51,17 +51,126 @@ static memoryinfo_t comet_memoryinfo = {
   .my_name = "Comet",
 };
 
+/**
+ * One notify message, serialized to JSON exactly once and shared
+ * (refcounted) between all mailboxes it was delivered to.
+ */
+typedef struct comet_event {
+  int ce_refcount;
+  char *ce_json;
+  size_t ce_jsonlen;
+  char *ce_class;  /* notificationClass */
+  char *ce_key;    /* identity of periodic status rows, NULL = no coalescing */
+} comet_event_t;
+
+typedef struct comet_entry {
+  TAILQ_ENTRY(comet_entry) ent_link;
+  comet_event_t *ent_event;
+} comet_entry_t;
+
 typedef struct comet_mailbox {
   char *cmb_boxid; /* SHA-1 hash */
   char *cmb_lang;  /* UI language */
   int cmb_refcount;
   int cmb_restricted; /* !admin */
-  htsmsg_t *cmb_messages; /* A vector */
+  TAILQ_HEAD(,comet_entry) cmb_entries;
   int64_t cmb_last_used;
   LIST_ENTRY(comet_mailbox) cmb_link;
   int cmb_debug;
 } comet_mailbox_t;
 
+/**
+ *
+ */
+static comet_event_t *
+comet_event_create(htsmsg_t *m)
+{
+  comet_event_t *ce = calloc(1, sizeof(*ce));
+  const char *s;
+  char buf[16];
+  uint32_t u32;
+
+  ce->ce_refcount = 1;
+  ce->ce_json = htsmsg_json_serialize_to_str(m, 0);
+  ce->ce_jsonlen = strlen(ce->ce_json);
+  s = htsmsg_get_str(m, "notificationClass");
+  if (s) {
+    ce->ce_class = strdup(s);
+    /* periodic full-state rows (subscriptions, input status) supersede
+       older queued rows for the same entity */
+    if ((!htsmsg_get_u32(m, "updateEntry", &u32) && u32) ||
+        (!htsmsg_get_u32(m, "update", &u32) && u32)) {
+      if ((s = htsmsg_get_str(m, "uuid")) != NULL) {
+        ce->ce_key = strdup(s);
+      } else if (!htsmsg_get_u32(m, "id", &u32)) {
+        snprintf(buf, sizeof(buf), "%u", u32);
+        ce->ce_key = strdup(buf);
+      }
+    }
+  }
+  memoryinfo_alloc(&comet_memoryinfo,
+                   sizeof(*ce) + ce->ce_jsonlen + 1 +
+                     (ce->ce_class ? strlen(ce->ce_class) + 1 : 0) +
+                     (ce->ce_key ? strlen(ce->ce_key) + 1 : 0));
+  return ce;
+}
+
+static void
+comet_event_deref(comet_event_t *ce)
+{
+  if (--ce->ce_refcount > 0)
+    return;
+  memoryinfo_free(&comet_memoryinfo,
+                  sizeof(*ce) + ce->ce_jsonlen + 1 +
+                    (ce->ce_class ? strlen(ce->ce_class) + 1 : 0) +
+                    (ce->ce_key ? strlen(ce->ce_key) + 1 : 0));
+  free(ce->ce_json);
+  free(ce->ce_class);
+  free(ce->ce_key);
+  free(ce);
+}
+
+/**
+ * Queue an event, dropping queued messages it supersedes (same class
+ * and entity, or a byte-identical payload).
+ */
+static void
+comet_mailbox_append(comet_mailbox_t *cmb, comet_event_t *ce)
+{
+  comet_entry_t *ent, *next;
+  comet_event_t *old;
+
+  if (ce->ce_class) {
+    for (ent = TAILQ_FIRST(&cmb->cmb_entries); ent; ent = next) {
+      next = TAILQ_NEXT(ent, ent_link);
+      old = ent->ent_event;
+      if (old->ce_class == NULL || strcmp(old->ce_class, ce->ce_class))
+        continue;
+      if ((ce->ce_key && old->ce_key && !strcmp(old->ce_key, ce->ce_key)) ||
+          !strcmp(old->ce_json, ce->ce_json)) {
+        TAILQ_REMOVE(&cmb->cmb_entries, ent, ent_link);
+        comet_event_deref(old);
+        free(ent);
+      }
+    }
+  }
+  ent = malloc(sizeof(*ent));
+  ce->ce_refcount++;
+  ent->ent_event = ce;
+  TAILQ_INSERT_TAIL(&cmb->cmb_entries, ent, ent_link);
+}
+
+/**
+ * Queue a message built for one particular mailbox
+ */
+static void
+comet_mailbox_post(comet_mailbox_t *cmb, htsmsg_t *m)
+{
+  comet_event_t *ce = comet_event_create(m);
+  comet_mailbox_append(cmb, ce);
+  comet_event_deref(ce);
+  htsmsg_destroy(m);
+}
 
 /**
  *
@@ -69,10 +178,15 @@ typedef struct comet_mailbox {
 static void
 cmb_destroy(comet_mailbox_t *cmb)
 {
+  comet_entry_t *ent;
+
   mbdebug("mailbox[%s]: destroyed\n", cmb->cmb_boxid);
 
-  if(cmb->cmb_messages != NULL)
-    htsmsg_destroy(cmb->cmb_messages);
+  while ((ent = TAILQ_FIRST(&cmb->cmb_entries)) != NULL) {
+    TAILQ_REMOVE(&cmb->cmb_entries, ent, ent_link);
+    comet_event_deref(ent->ent_event);
+    free(ent);
+  }
 
   LIST_REMOVE(cmb, cmb_link);
 
@@ -135,6 +249,7 @@ comet_mailbox_create(const char *lang)
 
   cmb->cmb_boxid = strdup(id);
   cmb->cmb_lang = lang ? strdup(lang) : NULL;
+  TAILQ_INIT(&cmb->cmb_entries);
   cmb->cmb_refcount = 1;
   cmb->cmb_last_used = mclk();
   mailbox_tally++;
@@ -213,9 +328,7 @@ comet_access_update(http_connection_t *hc, comet_mailbox_t *cmb)
   if (admin && config.wizard)
     htsmsg_add_str(m, "wizard", config.wizard);
 
-  if(cmb->cmb_messages == NULL)
-    cmb->cmb_messages = htsmsg_create_list();
-  htsmsg_add_msg(cmb->cmb_messages, NULL, m);
+  comet_mailbox_post(cmb, m);
 }
 
 /**
@@ -243,28 +356,34 @@ comet_serverIpPort(http_connection_t *hc, comet_mailbox_t *cmb)
   htsmsg_add_str(m, "ip", buf);
   htsmsg_add_u32(m, "port", ntohs(port));
 
-  if(cmb->cmb_messages == NULL)
-    cmb->cmb_messages = htsmsg_create_list();
-  htsmsg_add_msg(cmb->cmb_messages, NULL, m);
+  comet_mailbox_post(cmb, m);
 }
 
 /**
  *
  */
-static htsmsg_t *
-comet_message(comet_mailbox_t *cmb, int include_boxid, int ignore_null)
+static void
+comet_message(comet_mailbox_t *cmb, int include_boxid, htsbuf_queue_t *hq)
 {
-  htsmsg_t *m;
+  comet_entry_t *ent;
+  int first = 1;
 
-  if (ignore_null && cmb->cmb_messages == NULL)
-    return NULL;
-  m = htsmsg_create_map();
   if (include_boxid)
-    htsmsg_add_str(m, "boxid", cmb->cmb_boxid);
-  htsmsg_add_msg(m, "messages", cmb->cmb_messages ?: htsmsg_create_list());
-  cmb->cmb_messages = NULL;
+    htsbuf_qprintf(hq, "{\"boxid\":\"%s\",\"messages\":[", cmb->cmb_boxid);
+  else
+    htsbuf_append_str(hq, "{\"messages\":[");
+  while ((ent = TAILQ_FIRST(&cmb->cmb_entries)) != NULL) {
+    TAILQ_REMOVE(&cmb->cmb_entries, ent, ent_link);
+    if (!first)
+      htsbuf_append(hq, ",", 1);
+    first = 0;
+    /* the JSON was serialized when the event was queued */
+    htsbuf_append(hq, ent->ent_event->ce_json, ent->ent_event->ce_jsonlen);
+    comet_event_deref(ent->ent_event);
+    free(ent);
+  }
+  htsbuf_append_str(hq, "]}");
   cmb->cmb_last_used = mclk();
-  return m;
 }
 
 /**
@@ -316,7 +435,6 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
   const char *lang = hc->hc_access->aa_lang_ui;
   int im = immediate ? atoi(immediate) : 0, e;
   int64_t mono;
-  htsmsg_t *m;
 
   if(!im)
     tvh_safe_usleep(100000); /* Always sleep 0.1 sec to avoid comet storms */
@@ -328,7 +446,7 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
     return HTTP_STATUS_BAD_REQUEST;
   }
 
-  if(!im && cmb->cmb_messages == NULL) {
+  if(!im && TAILQ_EMPTY(&cmb->cmb_entries)) {
     mono = mclk() + sec2mono(10);
     atomic_add(&comet_waiting, 1);
     do {
@@ -343,11 +461,9 @@ comet_mailbox_poll(http_connection_t *hc, const char *remain, void *opaque)
     }
   }
 
-  m = comet_message(cmb, 1, 0);
+  comet_message(cmb, 1, &hc->hc_reply);
   tvh_mutex_unlock(&comet_mutex);
 
-  htsmsg_json_serialize(m, &hc->hc_reply, 0);
-  htsmsg_destroy(m);
   http_output_content(hc, "application/json; charset=UTF-8");
   return 0;
 }
@@ -372,9 +488,6 @@ comet_mailbox_dbg(http_connection_t *hc, const char *remain, void *opaque)
     char buf[64];
     cmb->cmb_debug = !cmb->cmb_debug;
 
-    if(cmb->cmb_messages == NULL)
-      cmb->cmb_messages = htsmsg_create_list();
-
     if(cmb->cmb_restricted || http_access_verify(hc, ACCESS_ADMIN))
       s = N_("Only admin can watch the realtime log.");
     else if(cmb->cmb_debug)
@@ -386,7 +499,7 @@ comet_mailbox_dbg(http_connection_t *hc, const char *remain, void *opaque)
     htsmsg_t *m = htsmsg_create_map();
     htsmsg_add_str(m, "notificationClass", "logmessage");
     htsmsg_add_str(m, "logtxt", buf);
-    htsmsg_add_msg(cmb->cmb_messages, NULL, m);
+    comet_mailbox_post(cmb, m);
 
     tvh_cond_signal(&comet_cond, 1);
   }
@@ -402,18 +515,25 @@ comet_mailbox_dbg(http_connection_t *hc, const char *remain, void *opaque)
 static void
 comet_mailbox_ws_msg(http_connection_t *hc, comet_mailbox_t *cmb, int first, htsmsg_t *msg)
 {
-  htsmsg_t *m = NULL;
+  htsbuf_queue_t q;
+  char *s = NULL;
+
   tvh_mutex_lock(&comet_mutex);
   if (!atomic_get(&comet_running)) {
     tvh_mutex_unlock(&comet_mutex);
     return;
   }
-  m = comet_message(cmb, first, 1);
+  if (!TAILQ_EMPTY(&cmb->cmb_entries)) {
+    htsbuf_queue_init(&q, 0);
+    comet_message(cmb, first, &q);
+    s = htsbuf_to_string(&q);
+    htsbuf_queue_flush(&q);
+  }
   cmb->cmb_last_used = 0;
   tvh_mutex_unlock(&comet_mutex);
-  if (m) {
-    http_websocket_send_json(hc, m);
-    htsmsg_destroy(m);
+  if (s) {
+    http_websocket_send(hc, (uint8_t *)s, strlen(s), HTTP_WSOP_TEXT);
+    free(s);
   }
 }
 
@@ -552,10 +672,15 @@ comet_mailbox_rewrite_msg(int rewrite, htsmsg_t *m, const char *lang)
 /**
  *
  */
+#define COMET_EVENT_LANGS 8
+
 void
 comet_mailbox_add_message(htsmsg_t *m, int isdebug, int isrestricted, int rewrite)
 {
   comet_mailbox_t *cmb;
+  comet_event_t *ce = NULL, *lang_ce[COMET_EVENT_LANGS], *lce;
+  const char *lang_id[COMET_EVENT_LANGS];
+  int nlangs = 0, i;
   htsmsg_t *e;
 
   if (!atomic_get(&comet_running))
@@ -571,17 +696,45 @@ comet_mailbox_add_message(htsmsg_t *m, int isdebug, int isrestricted, int rewrit
 
       if(isdebug && !cmb->cmb_debug)
         continue;
-        
-      if(cmb->cmb_messages == NULL)
-        cmb->cmb_messages = htsmsg_create_list();
-      e = htsmsg_copy(m);
-      if (cmb->cmb_lang && rewrite)
-        comet_mailbox_rewrite_msg(rewrite, e, cmb->cmb_lang);
-      htsmsg_add_msg(cmb->cmb_messages, NULL, e);
+
+      if (cmb->cmb_lang && rewrite) {
+        /* serialize the rewritten variant once per language */
+        for (i = 0; i < nlangs; i++)
+          if (!strcmp(lang_id[i], cmb->cmb_lang))
+            break;
+        if (i < nlangs) {
+          lce = lang_ce[i];
+        } else {
+          e = htsmsg_copy(m);
+          comet_mailbox_rewrite_msg(rewrite, e, cmb->cmb_lang);
+          lce = comet_event_create(e);
+          htsmsg_destroy(e);
+          if (nlangs < COMET_EVENT_LANGS) {
+            lang_id[nlangs] = cmb->cmb_lang;
+            lang_ce[nlangs++] = lce;
+          } else {
+            comet_mailbox_append(cmb, lce);
+            comet_event_deref(lce);
+            continue;
+          }
+        }
+        comet_mailbox_append(cmb, lce);
+      } else {
+        /* serialize once, all plain mailboxes share the buffer */
+        if (ce == NULL)
+          ce = comet_event_create(m);
+        comet_mailbox_append(cmb, ce);
+      }
     }
     tvh_cond_signal(&comet_cond, 1);
   }
 
+  /* the refcounts are protected by comet_mutex */
+  if (ce)
+    comet_event_deref(ce);
+  for (i = 0; i < nlangs; i++)
+    comet_event_deref(lang_ce[i]);
+
   tvh_mutex_unlock(&comet_mutex);
 }
 
@@ -22,11 +22,49 @@
 #include "access.h"
 #include "epg.h"
 #include "channels.h"
+#include "htsmsg_json.h"
 
 extern char tvh_binshasum[20];
 
 int page_statedump(http_connection_t *hc, const char *remain, void *opaque);
 
+/*
+ * Streamed output - the dump is written to the socket in bounded
+ * pieces (optionally through a gzip stream) instead of being built
+ * as one in-memory blob, so it stays safe to take on a loaded box.
+ */
+
+#define STATEDUMP_BATCH 64
+
+typedef struct statedump_out {
+  http_connection_t *hc;
+#if ENABLE_ZLIB
+  tvh_gzip_stream_t *gz;
+#endif
+  int error;
+} statedump_out_t;
+
+static void
+statedump_flush(statedump_out_t *so, htsbuf_queue_t *hq)
+{
+  char buf[8192];
+  size_t c;
+
+  while ((c = htsbuf_read(hq, buf, sizeof(buf))) > 0) {
+    if (so->error)
+      continue;
+#if ENABLE_ZLIB
+    if (so->gz) {
+      if (tvh_gzip_stream_write(so->gz, buf, c))
+        so->error = 1;
+      continue;
+    }
+#endif
+    if (tvh_write(so->hc->hc_fd, buf, c))
+      so->error = 1;
+  }
+}
+
 static void
 outputtitle(htsbuf_queue_t *hq, int indent, const char *fmt, ...)
 {
@@ -132,10 +170,115 @@ dumpdvbadapters(htsbuf_queue_t *hq)
 }
 #endif
 
+/*
+ * Dump the idnode world class by class.  Nodes are snapshotted as
+ * uuids under the global lock and serialized in small batches, so the
+ * lock is never held across the whole dump and nodes deleted while we
+ * stream are simply skipped.  An optional class name restricts the
+ * dump, and start/limit page within each class.
+ */
+static void
+dumpidnodes(statedump_out_t *so, htsbuf_queue_t *hq,
+            const char *classname, uint32_t start, uint32_t limit)
+{
+  idclass_t const **all, *const *p;
+  const idclass_t *idc;
+  idnode_set_t *is;
+  idnode_t *in;
+  tvh_uuid_t *uuids;
+  htsmsg_t *m;
+  char ubuf[UUID_HEX_SIZE];
+  size_t i, j, k, count, end;
+
+  tvh_mutex_lock(&global_lock);
+  all = idclass_find_all();
+  tvh_mutex_unlock(&global_lock);
+  if (all == NULL)
+    return;
+
+  for (p = all; *p && !so->error; p++) {
+    idc = *p;
+    if (classname && strcmp(idc->ic_class, classname))
+      continue;
+
+    /* Snapshot the instances as uuids */
+    tvh_mutex_lock(&global_lock);
+    count = 0;
+    uuids = NULL;
+    if ((is = idnode_find_all(idc, NULL)) != NULL) {
+      uuids = malloc(sizeof(*uuids) * (is->is_count ?: 1));
+      for (i = 0; i < is->is_count; i++) {
+        in = is->is_array[i];
+        /* concrete class only - subclasses get their own section */
+        if (in->in_class != idc) continue;
+        uuids[count++] = in->in_uuid;
+      }
+      idnode_set_free(is);
+    }
+    tvh_mutex_unlock(&global_lock);
+
+    if (count == 0 || start >= count) {
+      free(uuids);
+      continue;
+    }
+    end = limit ? MIN(count, (size_t)start + limit) : count;
+
+    outputtitle(hq, 0, "Class %s (%zd of %zd)",
+                idc->ic_class, end - start, count);
+
+    for (j = start; j < end && !so->error; j += STATEDUMP_BATCH) {
+      tvh_mutex_lock(&global_lock);
+      for (k = j; k < MIN(j + STATEDUMP_BATCH, end); k++) {
+        in = idnode_find0(&uuids[k], NULL, NULL);
+        if (in == NULL || in->in_class != idc)
+          continue;   /* deleted or replaced while streaming */
+        htsbuf_qprintf(hq, "%s: ", idnode_uuid_as_str(in, ubuf));
+        if ((m = idnode_serialize0(in, NULL, 0, NULL)) != NULL) {
+          htsmsg_json_serialize(m, hq, 0);
+          htsmsg_destroy(m);
+        }
+        htsbuf_append(hq, "\n", 1);
+      }
+      tvh_mutex_unlock(&global_lock);
+      statedump_flush(so, hq);
+    }
+
+    free(uuids);
+  }
+
+  free(all);
+}
+
 int
 page_statedump(http_connection_t *hc, const char *remain, void *opaque)
 {
-  htsbuf_queue_t *hq = &hc->hc_reply;
+  htsbuf_queue_t hq0, *hq = &hq0;
+  statedump_out_t so;
+  const char *classname = http_arg_get(&hc->hc_req_args, "class");
+  const char *s;
+  uint32_t start = 0, limit = 0;
+
+  if ((s = http_arg_get(&hc->hc_req_args, "start")) != NULL)
+    start = atoll(s);
+  if ((s = http_arg_get(&hc->hc_req_args, "limit")) != NULL)
+    limit = atoll(s);
+
+  memset(&so, 0, sizeof(so));
+  so.hc = hc;
+  htsbuf_queue_init(hq, 0);
+
+  /* close-delimited body, written as it is produced */
+  hc->hc_keep_alive = 0;
+  http_send_begin(hc);
+#if ENABLE_ZLIB
+  if (http_encoding_valid(hc, "gzip")) {
+    http_send_header(hc, HTTP_STATUS_OK, "text/plain; charset=UTF-8", 0,
+                     "gzip", NULL, 0, 0, NULL, NULL);
+    so.gz = tvh_gzip_stream_open(hc->hc_fd, 3);
+  } else
+#endif
+    http_send_header(hc, HTTP_STATUS_OK, "text/plain; charset=UTF-8", 0,
+                     NULL, NULL, 0, 0, NULL, NULL);
 
   htsbuf_qprintf(hq, "Tvheadend %s  Binary SHA1: "
 		 "%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x"
@@ -162,11 +305,21 @@ page_statedump(http_connection_t *hc, const char *remain, void *opaque)
 		 tvh_binshasum[18],
 		 tvh_binshasum[19]);
 
-  tvh_mutex_lock(&global_lock);
-  dumpchannels(hq);
-  tvh_mutex_unlock(&global_lock);
+  if (classname == NULL) {
+    tvh_mutex_lock(&global_lock);
+    dumpchannels(hq);
+    tvh_mutex_unlock(&global_lock);
+  }
+  statedump_flush(&so, hq);
 
-  http_output_content(hc, "text/plain; charset=UTF-8");
+  dumpidnodes(&so, hq, classname, start, limit);
+
+#if ENABLE_ZLIB
+  if (so.gz && tvh_gzip_stream_close(so.gz))
+    so.error = 1;
+#endif
+  http_send_end(hc);
+  htsbuf_queue_flush(hq);
   return 0;
 }
 
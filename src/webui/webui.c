@@ -33,6 +33,8 @@
 #include "imagecache.h"
 #include "lang_codes.h"
 #include "intlconv.h"
+#include "api.h"
+#include "memoryinfo.h"
 #if ENABLE_MPEGTS
 #include "input.h"
 #endif
@@ -217,6 +219,141 @@ to reauthenticate."));
   return 0;
 }
 
+#if ENABLE_ZLIB
+/**
+ * Cache of deflated static assets.  Without it every page load deflates
+ * the ExtJS javascript/css payloads again; here the compressed bytes are
+ * kept around together with a strong ETag (SHA1 of the compressed data)
+ * so revalidating clients get a 304 instead of a fresh body.
+ */
+#define STATIC_CACHE_DEPTH 64
+
+typedef struct static_cache_entry {
+  TAILQ_ENTRY(static_cache_entry) sce_link;
+  char *sce_path;
+  time_t sce_mtime;             /* direct disk files only, 0 for bundled */
+  off_t sce_fsize;
+  uint8_t *sce_data;            /* gzip deflated contents */
+  size_t sce_size;
+  int sce_refcount;
+  char sce_etag[48];
+} static_cache_entry_t;
+
+static tvh_mutex_t static_cache_mutex = TVH_THREAD_MUTEX_INITIALIZER;
+static TAILQ_HEAD(static_cache_queue, static_cache_entry) static_cache =
+  TAILQ_HEAD_INITIALIZER(static_cache);
+static int static_cache_depth;
+
+static void
+static_cache_entry_deref(static_cache_entry_t *sce)
+{
+  if (--sce->sce_refcount == 0) {
+    free(sce->sce_path);
+    free(sce->sce_data);
+    free(sce);
+  }
+}
+
+static static_cache_entry_t *
+static_cache_get(const char *path)
+{
+  static_cache_entry_t *sce;
+  struct stat st;
+
+  TAILQ_FOREACH(sce, &static_cache, sce_link)
+    if (!strcmp(sce->sce_path, path))
+      break;
+  if (sce == NULL)
+    return NULL;
+  if (sce->sce_mtime &&
+      (stat(path, &st) || st.st_mtime != sce->sce_mtime ||
+       st.st_size != sce->sce_fsize)) {
+    /* the file changed on disk, drop the stale entry */
+    TAILQ_REMOVE(&static_cache, sce, sce_link);
+    static_cache_depth--;
+    static_cache_entry_deref(sce);
+    return NULL;
+  }
+  if (sce != TAILQ_FIRST(&static_cache)) {
+    TAILQ_REMOVE(&static_cache, sce, sce_link);
+    TAILQ_INSERT_HEAD(&static_cache, sce, sce_link);
+  }
+  return sce;
+}
+
+static static_cache_entry_t *
+static_cache_put(const char *path)
+{
+  static_cache_entry_t *sce, *last;
+  struct filebundle_stat fst;
+  struct stat st;
+  fb_file *fp;
+  uint8_t sha[20], *data;
+  char hex[48];
+  size_t size, off = 0;
+  ssize_t c;
+  time_t mtime = 0;
+  off_t fsize = 0;
+
+  if (!fb_stat(path, &fst) && fst.type == FB_DIRECT && !stat(path, &st)) {
+    mtime = st.st_mtime;
+    fsize = st.st_size;
+  }
+  fp = fb_open(path, 0, 1);
+  if (fp == NULL)
+    return NULL;
+  if (!fb_gzipped(fp)) {
+    fb_close(fp);
+    return NULL;
+  }
+  size = fb_size(fp);
+  data = malloc(size);
+  while (off < size && !fb_eof(fp)) {
+    c = fb_read(fp, data + off, size - off);
+    if (c <= 0)
+      break;
+    off += c;
+  }
+  fb_close(fp);
+  if (off != size) {
+    free(data);
+    return NULL;
+  }
+  sce = calloc(1, sizeof(*sce));
+  sce->sce_path = strdup(path);
+  sce->sce_mtime = mtime;
+  sce->sce_fsize = fsize;
+  sce->sce_data = data;
+  sce->sce_size = size;
+  sce->sce_refcount = 1;        /* the cache's own reference */
+  sha1_calc(sha, data, size, NULL, 0);
+  snprintf(sce->sce_etag, sizeof(sce->sce_etag), "\"%s\"",
+           bin2hex(hex, sizeof(hex), sha, sizeof(sha)));
+  TAILQ_INSERT_HEAD(&static_cache, sce, sce_link);
+  if (++static_cache_depth > STATIC_CACHE_DEPTH) {
+    last = TAILQ_LAST(&static_cache, static_cache_queue);
+    TAILQ_REMOVE(&static_cache, last, sce_link);
+    static_cache_depth--;
+    static_cache_entry_deref(last);
+  }
+  return sce;
+}
+
+static void
+static_cache_flush(void)
+{
+  static_cache_entry_t *sce;
+
+  tvh_mutex_lock(&static_cache_mutex);
+  while ((sce = TAILQ_FIRST(&static_cache)) != NULL) {
+    TAILQ_REMOVE(&static_cache, sce, sce_link);
+    static_cache_entry_deref(sce);
+  }
+  static_cache_depth = 0;
+  tvh_mutex_unlock(&static_cache_mutex);
+}
+#endif /* ENABLE_ZLIB */
+
 /**
  * Static download of a file from the filesystem
  */
@@ -231,6 +368,9 @@ page_static_file(http_connection_t *hc, const char *_remain, void *opaque)
   const char *content = NULL;
   char buf[4096];
   const char *gzip = NULL;
+  const char *inm;
+  char etag[64];
+  http_arg_list_t hdrs;
   int nogzip = 0;
   int maxage = 10;              /* Default age */
 
@@ -269,6 +409,41 @@ page_static_file(http_connection_t *hc, const char *_remain, void *opaque)
     }
   }
 
+  inm = http_arg_get(&hc->hc_args, "If-None-Match");
+
+#if ENABLE_ZLIB
+  if (!nogzip && !gzip) {
+    static_cache_entry_t *sce;
+    tvh_mutex_lock(&static_cache_mutex);
+    sce = static_cache_get(path);
+    if (sce == NULL)
+      sce = static_cache_put(path);
+    if (sce)
+      sce->sce_refcount++;
+    tvh_mutex_unlock(&static_cache_mutex);
+    if (sce) {
+      http_arg_init(&hdrs);
+      http_arg_set(&hdrs, "ETag", sce->sce_etag);
+      http_send_begin(hc);
+      if (inm && !strcmp(inm, sce->sce_etag)) {
+        http_send_header(hc, HTTP_STATUS_NOT_MODIFIED, NULL, 0, NULL, NULL,
+                         maxage, 0, NULL, &hdrs);
+      } else {
+        http_send_header(hc, 200, content, sce->sce_size, "gzip", NULL,
+                         maxage, 0, NULL, &hdrs);
+        if (tvh_write(hc->hc_fd, sce->sce_data, sce->sce_size))
+          ret = HTTP_STATUS_INTERNAL;
+      }
+      http_send_end(hc);
+      http_arg_flush(&hdrs);
+      tvh_mutex_lock(&static_cache_mutex);
+      static_cache_entry_deref(sce);
+      tvh_mutex_unlock(&static_cache_mutex);
+      return ret;
+    }
+  }
+#endif
+
   fb_file *fp = fb_open(path, 0, (nogzip || gzip) ? 0 : 1);
   if (!fp) {
     tvherror(LS_WEBUI, "failed to open %s", path);
@@ -278,8 +453,53 @@ page_static_file(http_connection_t *hc, const char *_remain, void *opaque)
   if (!gzip && fb_gzipped(fp))
     gzip = "gzip";
 
+  etag[0] = '\0';
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_FREEBSD) || defined(PLATFORM_DARWIN)
+  int fd = fb_fileno(fp);
+  struct stat fdst;
+  if (fd >= 0 && !fstat(fd, &fdst))
+    /* plain disk file: a stat-derived validator is strong enough */
+    snprintf(etag, sizeof(etag), "\"%llx-%llx-%llx\"",
+             (long long)fdst.st_ino, (long long)fdst.st_size,
+             (long long)fdst.st_mtime);
+#endif
+
+  http_arg_init(&hdrs);
+  if (etag[0])
+    http_arg_set(&hdrs, "ETag", etag);
   http_send_begin(hc);
-  http_send_header(hc, 200, content, size, gzip, NULL, maxage, 0, NULL, NULL);
+  if (etag[0] && inm && !strcmp(inm, etag)) {
+    http_send_header(hc, HTTP_STATUS_NOT_MODIFIED, NULL, 0, NULL, NULL,
+                     maxage, 0, NULL, &hdrs);
+    goto done;
+  }
+  http_send_header(hc, 200, content, size, gzip, NULL, maxage, 0, NULL,
+                   etag[0] ? &hdrs : NULL);
+#if defined(PLATFORM_LINUX) || defined(PLATFORM_FREEBSD) || defined(PLATFORM_DARWIN)
+  if (fd >= 0) {
+    /* plain disk file (image or pre-gzipped asset): zero-copy transfer,
+       bundled and (de)compressed content keeps the read/write loop */
+    off_t remain = size;
+    while (remain > 0) {
+#if defined(PLATFORM_LINUX)
+      ssize_t r = sendfile(hc->hc_fd, fd, NULL, remain);
+#elif defined(PLATFORM_FREEBSD)
+      off_t r = 0;
+      if (sendfile(fd, hc->hc_fd, size - remain, remain, NULL, &r, 0) < 0)
+        r = -1;
+#elif defined(PLATFORM_DARWIN)
+      off_t r = remain;
+      if (sendfile(fd, hc->hc_fd, size - remain, &r, NULL, 0) < 0)
+        r = -1;
+#endif
+      if (r <= 0) {
+        ret = HTTP_STATUS_INTERNAL;
+        break;
+      }
+      remain -= r;
+    }
+  } else
+#endif
   while (!fb_eof(fp)) {
     ssize_t c = fb_read(fp, buf, sizeof(buf));
     if (c < 0) {
@@ -291,7 +511,9 @@ page_static_file(http_connection_t *hc, const char *_remain, void *opaque)
       break;
     }
   }
+done:
   http_send_end(hc);
+  http_arg_flush(&hdrs);
   fb_close(fp);
 
   return ret;
@@ -352,6 +574,9 @@ http_stream_run(http_connection_t *hc, profile_chain_t *prch,
   tp.tv_sec  = 5;
   tp.tv_usec = 0;
   setsockopt(hc->hc_fd, SOL_SOCKET, SO_SNDTIMEO, &tp, sizeof(tp));
+  /* bound the unsent kernel backlog so stalled clients hit the write
+     timeout early instead of draining a deep socket buffer first */
+  tcp_socket_notsent_lowat(hc->hc_fd, 128 * 1024);
   if (config.dscp >= 0)
     socket_set_dscp(hc->hc_fd, config.dscp, NULL, 0);
 
@@ -414,11 +639,17 @@ http_stream_run(http_connection_t *hc, profile_chain_t *prch,
     case SMT_PACKET:
       if(started) {
         pktbuf_t *pb;
+        int64_t rtime;
         int len;
-        if (sm->sm_type == SMT_PACKET)
+        if (sm->sm_type == SMT_PACKET) {
           pb = ((th_pkt_t*)sm->sm_data)->pkt_payload;
-        else
+          rtime = ((th_pkt_t*)sm->sm_data)->pkt_ctime;
+        } else {
           pb = sm->sm_data;
+          rtime = pb->pb_rtime;
+        }
+        if (rtime)
+          subscription_latency_sample(s, getfastmonoclock() - rtime);
         subscription_add_bytes_out(s, len = pktbuf_len(pb));
         if (len > 0)
           lastpkt = mclk();
@@ -2229,6 +2460,238 @@ page_srvid2(http_connection_t *hc, const char *remain, void *opaque)
   return 0;
 }
 
+/**
+ * Append a Prometheus label value, escaping backslash, quote and newline
+ */
+static void
+metrics_label_escape(htsbuf_queue_t *hq, const char *s)
+{
+  char c;
+  while ((c = *s++) != '\0') {
+    if (c == '\\' || c == '"')
+      htsbuf_append(hq, "\\", 1);
+    else if (c == '\n') {
+      htsbuf_append(hq, "\\n", 2);
+      continue;
+    }
+    htsbuf_append(hq, &c, 1);
+  }
+}
+
+/**
+ * Emit one gauge line per numeric field of every entry in the list,
+ * using the named scalar fields as labels (the label set must make the
+ * series unique - e.g. the input uuid or the subscription id)
+ */
+static void
+metrics_write_list(htsbuf_queue_t *hq, const char *prefix,
+                   htsmsg_t *resp, const char *const *labels)
+{
+  htsmsg_t *entries, *e;
+  htsmsg_field_t *f, *f2;
+  htsbuf_queue_t lq;
+  const char *str;
+  const char *const *lbl;
+  char buf[32], *lstr;
+  int64_t s64;
+  int first;
+
+  if (resp == NULL || (entries = htsmsg_get_list(resp, "entries")) == NULL)
+    return;
+
+  HTSMSG_FOREACH(f, entries) {
+    if ((e = htsmsg_field_get_map(f)) == NULL)
+      continue;
+    /* build the shared label block once per entry */
+    htsbuf_queue_init(&lq, 0);
+    first = 1;
+    for (lbl = labels; *lbl; lbl++) {
+      if ((f2 = htsmsg_field_find(e, *lbl)) == NULL)
+        continue;
+      if ((str = htsmsg_field_get_str(f2)) == NULL) {
+        if (htsmsg_field_get_s64(f2, &s64))
+          continue;
+        snprintf(buf, sizeof(buf), "%"PRId64, s64);
+        str = buf;
+      }
+      htsbuf_qprintf(&lq, "%s%s=\"", first ? "{" : ",", *lbl);
+      metrics_label_escape(&lq, str);
+      htsbuf_append(&lq, "\"", 1);
+      first = 0;
+    }
+    if (!first)
+      htsbuf_append(&lq, "}", 1);
+    lstr = htsbuf_to_string(&lq);
+    htsbuf_queue_flush(&lq);
+    HTSMSG_FOREACH(f2, e) {
+      if (htsmsg_field_get_str(f2) != NULL ||
+          f2->hmf_type == HMF_LIST || f2->hmf_type == HMF_MAP)
+        continue;
+      for (lbl = labels; *lbl; lbl++)
+        if (strcmp(htsmsg_field_name(f2), *lbl) == 0)
+          break;
+      if (*lbl)
+        continue;
+      if (htsmsg_field_get_s64(f2, &s64))
+        continue;
+      htsbuf_qprintf(hq, "tvh_%s_%s%s %"PRId64"\n",
+                     prefix, htsmsg_field_name(f2), lstr ?: "", s64);
+    }
+    free(lstr);
+  }
+}
+
+/**
+ * Emit the tprofile timers as native Prometheus histograms
+ */
+static void
+metrics_write_tprofile(htsbuf_queue_t *hq, htsmsg_t *stats)
+{
+  htsmsg_t *timers, *e, *hist;
+  htsmsg_field_t *f, *f2;
+  const char *name;
+  int64_t count, avg;
+  uint64_t cum, le;
+  uint32_t b;
+
+  if ((timers = htsmsg_get_list(stats, "timers")) == NULL)
+    return;
+  HTSMSG_FOREACH(f, timers) {
+    if ((e = htsmsg_field_get_map(f)) == NULL)
+      continue;
+    if ((name = htsmsg_get_str(e, "name")) == NULL ||
+        (hist = htsmsg_get_list(e, "hist")) == NULL)
+      continue;
+    count = htsmsg_get_s64_or_default(e, "count", 0);
+    avg   = htsmsg_get_s64_or_default(e, "avg_us", 0);
+    cum = 0;
+    le = 2;
+    HTSMSG_FOREACH(f2, hist) {
+      if (htsmsg_field_get_u32(f2, &b))
+        continue;
+      cum += b;
+      htsbuf_qprintf(hq, "tvh_tprofile_latency_us_bucket{name=\"");
+      metrics_label_escape(hq, name);
+      htsbuf_qprintf(hq, "\",le=\"%"PRIu64"\"} %"PRIu64"\n", le, cum);
+      le <<= 1;
+    }
+    htsbuf_qprintf(hq, "tvh_tprofile_latency_us_bucket{name=\"");
+    metrics_label_escape(hq, name);
+    htsbuf_qprintf(hq, "\",le=\"+Inf\"} %"PRId64"\n", count);
+    htsbuf_qprintf(hq, "tvh_tprofile_latency_us_count{name=\"");
+    metrics_label_escape(hq, name);
+    htsbuf_qprintf(hq, "\"} %"PRId64"\n", count);
+    htsbuf_qprintf(hq, "tvh_tprofile_latency_us_sum{name=\"");
+    metrics_label_escape(hq, name);
+    htsbuf_qprintf(hq, "\"} %"PRId64"\n", avg * count);
+  }
+}
+
+/**
+ * Prometheus scrape endpoint; the input/subscription/connection data
+ * comes from the periodic status snapshots, so a scrape does not touch
+ * global_lock except for the cheap DVR state and memoryinfo walks
+ */
+static int
+page_metrics(http_connection_t *hc, const char *remain, void *opaque)
+{
+  static const char *const input_labels[] =
+    { "uuid", "input", "stream", NULL };
+  static const char *const subscription_labels[] =
+    { "id", "state", "hostname", "username", "client", "title",
+      "channel", "service", NULL };
+  static const char *const connection_labels[] =
+    { "id", "type", "peer", "user", NULL };
+  static const char *const dvr_states[] =
+    { "scheduled", "recording", "completed", "nostate", "missed_time" };
+  htsbuf_queue_t *hq = &hc->hc_reply;
+  htsmsg_t *args, *resp;
+  memoryinfo_t *mym;
+  dvr_entry_t *de;
+  service_t *t;
+  char ubuf[UUID_HEX_SIZE];
+  uint32_t dvr_count[ARRAY_SIZE(dvr_states)];
+  int i;
+
+  args = htsmsg_create_map();
+
+  resp = NULL;
+  if (!api_exec(hc->hc_access, "status/inputs", args, &resp) && resp) {
+    metrics_write_list(hq, "input", resp, input_labels);
+    htsmsg_destroy(resp);
+  }
+  resp = NULL;
+  if (!api_exec(hc->hc_access, "status/subscriptions", args, &resp) && resp) {
+    htsbuf_qprintf(hq, "tvh_subscriptions %u\n",
+                   htsmsg_get_u32_or_default(resp, "totalCount", 0));
+    metrics_write_list(hq, "subscription", resp, subscription_labels);
+    htsmsg_destroy(resp);
+  }
+  resp = NULL;
+  if (!api_exec(hc->hc_access, "status/connections", args, &resp) && resp) {
+    htsbuf_qprintf(hq, "tvh_connections %u\n",
+                   htsmsg_get_u32_or_default(resp, "totalCount", 0));
+    metrics_write_list(hq, "connection", resp, connection_labels);
+    htsmsg_destroy(resp);
+  }
+  htsmsg_destroy(args);
+
+  memset(dvr_count, 0, sizeof(dvr_count));
+  tvh_mutex_lock(&global_lock);
+  LIST_FOREACH(de, &dvrentries, de_global_link)
+    if ((unsigned)de->de_sched_state < ARRAY_SIZE(dvr_states))
+      dvr_count[de->de_sched_state]++;
+  TAILQ_FOREACH(t, &service_all, s_all_link) {
+    service_qual_t *sq;
+    if (t->s_status != SERVICE_RUNNING)
+      continue;
+    idnode_uuid_as_str(&t->s_id, ubuf);
+    tvh_mutex_lock(&t->s_stream_mutex);
+    sq = &t->s_qual;
+    for (i = 0; i < 4; i++) {
+      static const char *const qual_metrics[] =
+        { "packets", "cc_errors", "tei_errors", "descrambler_stalls" };
+      const uint64_t qual_vals[] =
+        { sq->sq_packets, sq->sq_cc_errors,
+          sq->sq_tei_errors, sq->sq_sc_stalls };
+      htsbuf_qprintf(hq, "tvh_service_%s_total{uuid=\"%s\",name=\"",
+                     qual_metrics[i], ubuf);
+      metrics_label_escape(hq, t->s_nicename ?: "");
+      htsbuf_qprintf(hq, "\"} %"PRIu64"\n", qual_vals[i]);
+    }
+    htsbuf_qprintf(hq, "tvh_service_pcr_jitter_max_us{uuid=\"%s\",name=\"",
+                   ubuf);
+    metrics_label_escape(hq, t->s_nicename ?: "");
+    htsbuf_qprintf(hq, "\"} %u\n",
+                   sq->sq_hist[sq->sq_cur].qb_pcr_jitter_max);
+    tvh_mutex_unlock(&t->s_stream_mutex);
+  }
+  LIST_FOREACH(mym, &memoryinfo_entries, my_link) {
+    if (mym->my_update)
+      mym->my_update(mym);
+    htsbuf_qprintf(hq, "tvh_memoryinfo_bytes{name=\"");
+    metrics_label_escape(hq, mym->my_name);
+    htsbuf_qprintf(hq, "\"} %"PRId64"\n", atomic_get_s64(&mym->my_size));
+    htsbuf_qprintf(hq, "tvh_memoryinfo_count{name=\"");
+    metrics_label_escape(hq, mym->my_name);
+    htsbuf_qprintf(hq, "\"} %"PRId64"\n", atomic_get_s64(&mym->my_count));
+  }
+  tvh_mutex_unlock(&global_lock);
+
+  for (i = 0; i < ARRAY_SIZE(dvr_states); i++)
+    htsbuf_qprintf(hq, "tvh_dvr_entries{state=\"%s\"} %u\n",
+                   dvr_states[i], dvr_count[i]);
+
+  if (tprofile_running) {
+    htsmsg_t *stats = tprofile_get_stats();
+    metrics_write_tprofile(hq, stats);
+    htsmsg_destroy(stats);
+  }
+
+  http_output_content(hc, "text/plain; version=0.0.4; charset=utf-8");
+  return 0;
+}
+
 /**
  * Sanitice a filename to remove illegal characters from it
  */
@@ -2245,6 +2708,8 @@ static char *sanitize_filename(char *filename) {
 /**
  * Send a file
  */
+#define HTTP_SERVE_FILE_READAHEAD (8*1024*1024)
+
 int
 http_serve_file(http_connection_t *hc, const char *fname,
                 int fconv, const char *content,
@@ -2257,10 +2722,12 @@ http_serve_file(http_connection_t *hc, const char *fname,
 {
   int fd, ret, close_ret;
   struct stat st;
-  const char *range;
+  const char *range, *inm;
   char *basename;
   char *str, *str0;
   char range_buf[255];
+  char etag[64];
+  http_arg_list_t hdrs;
   char *disposition = NULL;
   off_t content_len, total_len, chunk;
   intmax_t file_start, file_end;
@@ -2306,6 +2773,23 @@ http_serve_file(http_connection_t *hc, const char *fname,
     return HTTP_STATUS_NOT_FOUND;
   }
 
+  /* plain disk file: a stat-derived validator is strong enough */
+  snprintf(etag, sizeof(etag), "\"%llx-%llx-%llx\"",
+           (long long)st.st_ino, (long long)st.st_size,
+           (long long)st.st_mtime);
+  inm = http_arg_get(&hc->hc_args, "If-None-Match");
+  if (inm && !strcmp(inm, etag)) {
+    close(fd);
+    http_arg_init(&hdrs);
+    http_arg_set(&hdrs, "ETag", etag);
+    http_send_begin(hc);
+    http_send_header(hc, HTTP_STATUS_NOT_MODIFIED, NULL, 0, NULL, NULL,
+                     10, NULL, NULL, &hdrs);
+    http_send_end(hc);
+    http_arg_flush(&hdrs);
+    return 0;
+  }
+
   file_start = 0;
   file_end = st.st_size-1;
   
@@ -2329,10 +2813,30 @@ http_serve_file(http_connection_t *hc, const char *fname,
   }
 
   content_len = total_len = file_end - file_start+1;
-  
+
   sprintf(range_buf, "bytes %jd-%jd/%jd",
           file_start, file_end, (intmax_t)st.st_size);
 
+#if defined(PLATFORM_LINUX)
+  /* Players scrub through recordings by issuing a fresh ranged request
+   * on the same keep-alive connection. Steer the kernel readahead by
+   * the observed pattern: a request continuing the previous range (or a
+   * fresh file) streams sequentially, while a jump elsewhere gets the
+   * new window prefetched immediately and the readahead done at the
+   * abandoned position dropped again. */
+  posix_fadvise(fd, file_start, content_len, POSIX_FADV_SEQUENTIAL);
+  if (hc->hc_file_ino == (uint64_t)st.st_ino &&
+      file_start != hc->hc_file_next) {
+    if (hc->hc_file_next < st.st_size)
+      posix_fadvise(fd, hc->hc_file_next, HTTP_SERVE_FILE_READAHEAD,
+                    POSIX_FADV_DONTNEED);
+    posix_fadvise(fd, file_start, MIN(HTTP_SERVE_FILE_READAHEAD, content_len),
+                  POSIX_FADV_WILLNEED);
+  }
+  hc->hc_file_ino = st.st_ino;
+  hc->hc_file_next = file_end + 1;
+#endif
+
 #if defined(PLATFORM_LINUX)
   if(file_start > 0) {
     off_t off;
@@ -2355,10 +2859,12 @@ http_serve_file(http_connection_t *hc, const char *fname,
     }
   }
 
+  http_arg_init(&hdrs);
+  http_arg_set(&hdrs, "ETag", etag);
   http_send_begin(hc);
   http_send_header(hc, range ? HTTP_STATUS_PARTIAL_CONTENT : HTTP_STATUS_OK,
                    content, content_len, NULL, NULL, 10,
-                   range ? range_buf : NULL, disposition, NULL);
+                   range ? range_buf : NULL, disposition, &hdrs);
 
   ret = 0;
   if(!hc->hc_no_output) {
@@ -2389,6 +2895,7 @@ http_serve_file(http_connection_t *hc, const char *fname,
   }
 
   http_send_end(hc);
+  http_arg_flush(&hdrs);
   close_ret = close(fd);
   if (close_ret != 0)
     ret = close_ret;
@@ -2732,6 +3239,7 @@ webui_init(int xspf)
   http_path_add("/markdown", NULL, page_markdown, ACCESS_ANONYMOUS);
 
   http_path_add("/state", NULL, page_statedump, ACCESS_ADMIN);
+  http_path_add("/metrics", NULL, page_metrics, ACCESS_ADMIN);
 
   http_path_add("/stream",  NULL, http_stream,  ACCESS_ANONYMOUS);
   http_path_add("/udpstream/start",  NULL, start_udp_stream,  ACCESS_ANONYMOUS);
@@ -2752,5 +3260,8 @@ webui_init(int xspf)
 void
 webui_done(void)
 {
+#if ENABLE_ZLIB
+  static_cache_flush();
+#endif
   comet_done();
 }
@@ -2,6 +2,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include "tvheadend.h"
 #include "tvhregex.h"
@@ -87,6 +88,39 @@ tvh_write(int fd, const void *buf, size_t len)
   return len ? 1 : 0;
 }
 
+/* vectored variant of tvh_write(); the iovec array is modified to track
+   partial writes */
+int
+tvh_writev(int fd, struct iovec *iov, int iovcnt)
+{
+  int64_t limit = mclk() + sec2mono(25);
+  ssize_t c;
+
+  while (iovcnt > 0) {
+    c = writev(fd, iov, iovcnt);
+    if (c < 0) {
+      if (ERRNO_AGAIN(errno)) {
+        if (mclk() > limit)
+          break;
+        tvh_safe_usleep(100);
+        continue;
+      }
+      break;
+    }
+    while (iovcnt > 0 && (size_t)c >= iov->iov_len) {
+      c -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base += c;
+      iov->iov_len -= c;
+    }
+  }
+
+  return iovcnt ? 1 : 0;
+}
+
 int
 tvh_write_in_chunks(int fd, const void *buf, size_t len, size_t chunkSize)
 {
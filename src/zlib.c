@@ -182,3 +182,70 @@ int tvh_gzip_deflate_fd_header ( int fd, const uint8_t *data, size_t orig,
   data2[5] = (orig & 0xff);
   return tvh_write(fd, data2, 6);
 }
+
+/* **************************************************************************
+ * Streaming compression
+ * *************************************************************************/
+
+struct tvh_gzip_stream {
+  z_stream zstr;
+  int      fd;
+  uint8_t  buf[16*1024];
+};
+
+static int
+tvh_gzip_stream_run ( tvh_gzip_stream_t *gz, int flush )
+{
+  int err;
+
+  do {
+    gz->zstr.avail_out = sizeof(gz->buf);
+    gz->zstr.next_out  = gz->buf;
+    err = deflate(&gz->zstr, flush);
+    if (err != Z_OK && err != Z_STREAM_END)
+      return -1;
+    if (gz->zstr.avail_out != sizeof(gz->buf) &&
+        tvh_write(gz->fd, gz->buf, sizeof(gz->buf) - gz->zstr.avail_out))
+      return -1;
+  } while (gz->zstr.avail_out == 0 ||
+           (flush == Z_FINISH && err != Z_STREAM_END));
+  return 0;
+}
+
+tvh_gzip_stream_t *
+tvh_gzip_stream_open ( int fd, int speed )
+{
+  tvh_gzip_stream_t *gz = calloc(1, sizeof(*gz));
+
+  assert(speed >= Z_BEST_SPEED && speed <= Z_BEST_COMPRESSION);
+  if (deflateInit2(&gz->zstr, speed, Z_DEFLATED, MAX_WBITS + 16 /* gzip */,
+                   MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+    free(gz);
+    return NULL;
+  }
+  gz->fd = fd;
+  return gz;
+}
+
+int
+tvh_gzip_stream_write ( tvh_gzip_stream_t *gz, const void *data, size_t len )
+{
+  if (len == 0)
+    return 0;
+  gz->zstr.avail_in = len;
+  gz->zstr.next_in  = (z_const uint8_t *)data;
+  return tvh_gzip_stream_run(gz, Z_NO_FLUSH);
+}
+
+int
+tvh_gzip_stream_close ( tvh_gzip_stream_t *gz )
+{
+  int r;
+
+  gz->zstr.avail_in = 0;
+  gz->zstr.next_in  = NULL;
+  r = tvh_gzip_stream_run(gz, Z_FINISH);
+  deflateEnd(&gz->zstr);
+  free(gz);
+  return r;
+}